@@ -287,6 +287,25 @@
  */
 #define ID_MM_MAX_MULTIPLEXED_LINKS "ID_MM_MAX_MULTIPLEXED_LINKS"
 
+/**
+ * ID_MM_EXPECTED_PORTS:
+ *
+ * This is a device-specific tag that allows users to specify how many ports
+ * the device exposes in the subsystems monitored by ModemManager.
+ *
+ * An integer value greater than 0 must be given. Once the given amount of
+ * ports has been reported for the device, ModemManager stops waiting for
+ * additional ports to appear and finishes the device probing as soon as the
+ * ports have been probed, which may considerably reduce the time required to
+ * expose the modem.
+ *
+ * If the device exposes more ports than the amount given, the additional
+ * ports may be ignored.
+ *
+ * Since: 1.24
+ */
+#define ID_MM_EXPECTED_PORTS "ID_MM_EXPECTED_PORTS"
+
 /*
  * The following symbols are deprecated. We don't add them to -compat
  * because this -tags file is not really part of the installed API.
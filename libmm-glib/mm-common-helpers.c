@@ -1826,80 +1826,114 @@ mm_new_iso8601_time (guint    year,
 
 /*****************************************************************************/
 
-/* From hostap, Copyright (c) 2002-2005, Jouni Malinen <jkmaline@cc.hut.fi> */
-
-static gint
-hex2num (gchar c)
-{
-    if (c >= '0' && c <= '9')
-        return c - '0';
-    if (c >= 'a' && c <= 'f')
-        return c - 'a' + 10;
-    if (c >= 'A' && c <= 'F')
-        return c - 'A' + 10;
-    return -1;
-}
+/* Value of each hex digit, indexed by char; -1 if not a hex digit */
+static const gint8 hex_values[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+static const gchar hex_digits[] = "0123456789ABCDEF";
 
 gint
 mm_utils_hex2byte (const gchar *hex)
 {
     gint a, b;
 
-    a = hex2num (*hex++);
+    a = hex_values[(guint8) hex[0]];
     if (a < 0)
         return -1;
-    b = hex2num (*hex++);
+    b = hex_values[(guint8) hex[1]];
     if (b < 0)
         return -1;
     return (a << 4) | b;
 }
 
-guint8 *
-mm_utils_hexstr2bin (const gchar  *hex,
-                     gssize        len,
-                     gsize        *out_len,
-                     GError      **error)
+gboolean
+mm_utils_hexstr2bin_buf (const gchar  *hex,
+                         gsize         len,
+                         guint8       *out,
+                         GError      **error)
 {
-    const gchar *ipos = hex;
-    g_autofree guint8 *buf = NULL;
-    gssize i;
-    gint a;
-    guint8 *opos;
+    gint  invalid = 0;
+    gsize i;
 
-    if (len < 0)
-        len = strlen (hex);
+    g_return_val_if_fail (hex != NULL, FALSE);
+    g_return_val_if_fail (out != NULL, FALSE);
 
     if (len == 0) {
         g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_INVALID_ARGS,
                      "Hex conversion failed: empty string");
-        return NULL;
+        return FALSE;
     }
 
     /* Length must be a multiple of 2 */
     if ((len % 2) != 0) {
         g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_INVALID_ARGS,
                      "Hex conversion failed: invalid input length");
-        return NULL;
+        return FALSE;
     }
 
-    opos = buf = g_malloc0 (len / 2);
+    /* Invalid digits are only checked once the whole string is converted,
+     * so that the loop has no branches. Note that the output byte is always
+     * written after the input chars are read, which allows in-place
+     * conversions. */
     for (i = 0; i < len; i += 2) {
-        a = mm_utils_hex2byte (ipos);
-        if (a < 0) {
-            g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_INVALID_ARGS,
-                         "Hex byte conversion from '%c%c' failed",
-                         ipos[0], ipos[1]);
-            return NULL;
+        gint a, b;
+
+        a = hex_values[(guint8) hex[i]];
+        b = hex_values[(guint8) hex[i + 1]];
+        invalid |= a | b;
+        out[i / 2] = (guint8) (((guint) a << 4) | (guint) b);
+    }
+
+    if (invalid < 0) {
+        for (i = 0; i < len; i += 2) {
+            if (mm_utils_hex2byte (&hex[i]) < 0) {
+                g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_INVALID_ARGS,
+                             "Hex byte conversion from '%c%c' failed",
+                             hex[i], hex[i + 1]);
+                break;
+            }
         }
-        *opos++ = (guint8)a;
-        ipos += 2;
+        return FALSE;
     }
+
+    return TRUE;
+}
+
+guint8 *
+mm_utils_hexstr2bin (const gchar  *hex,
+                     gssize        len,
+                     gsize        *out_len,
+                     GError      **error)
+{
+    g_autofree guint8 *buf = NULL;
+
+    if (len < 0)
+        len = strlen (hex);
+
+    buf = g_malloc (len / 2 + 1);
+    if (!mm_utils_hexstr2bin_buf (hex, len, buf, error))
+        return NULL;
+
     *out_len = len / 2;
     return g_steal_pointer (&buf);
 }
 
-/* End from hostap */
-
 gboolean
 mm_utils_ishexstr (const gchar *hex)
 {
@@ -1913,31 +1947,41 @@ mm_utils_ishexstr (const gchar *hex)
 
     for (i = 0; i < len; i++) {
         /* Non-hex char? */
-        if (hex[i] >= '0' && hex[i] <= '9')
-            continue;
-        if (hex[i] >= 'a' && hex[i] <= 'f')
-            continue;
-        if (hex[i] >= 'A' && hex[i] <= 'F')
-            continue;
-        return FALSE;
+        if (hex_values[(guint8) hex[i]] < 0)
+            return FALSE;
     }
 
     return TRUE;
 }
 
+void
+mm_utils_bin2hexstr_buf (const guint8 *bin,
+                         gsize         len,
+                         gchar        *out)
+{
+    gsize i;
+
+    g_return_if_fail (bin != NULL);
+    g_return_if_fail (out != NULL);
+
+    for (i = 0; i < len; i++) {
+        out[2 * i]     = hex_digits[bin[i] >> 4];
+        out[2 * i + 1] = hex_digits[bin[i] & 0x0F];
+    }
+    out[2 * len] = '\0';
+}
+
 gchar *
 mm_utils_bin2hexstr (const guint8 *bin,
                      gsize         len)
 {
-    GString *ret;
-    gsize i;
+    gchar *ret;
 
     g_return_val_if_fail (bin != NULL, NULL);
 
-    ret = g_string_sized_new (len * 2 + 1);
-    for (i = 0; i < len; i++)
-        g_string_append_printf (ret, "%.2X", bin[i]);
-    return g_string_free (ret, FALSE);
+    ret = g_malloc (len * 2 + 1);
+    mm_utils_bin2hexstr_buf (bin, len, ret);
+    return ret;
 }
 
 gboolean
@@ -235,6 +235,11 @@ guint8   *mm_utils_hexstr2bin (const gchar *hex, gssize len, gsize *out_len, GEr
 gchar    *mm_utils_bin2hexstr (const guint8 *bin, gsize len);
 gboolean  mm_utils_ishexstr   (const gchar *hex);
 
+/* Same conversions, without allocations: 'out' must have room for len / 2
+ * bytes (and may be the same buffer as 'hex'), or for len * 2 + 1 chars */
+gboolean  mm_utils_hexstr2bin_buf (const gchar *hex, gsize len, guint8 *out, GError **error);
+void      mm_utils_bin2hexstr_buf (const guint8 *bin, gsize len, gchar *out);
+
 gboolean  mm_utils_check_for_single_value (guint32 value);
 
 gboolean  mm_is_string_mccmnc (const gchar *str);
@@ -428,6 +428,28 @@ mm_modem_3gpp_get_packet_service_state (MMModem3gpp *self)
 
 /*****************************************************************************/
 
+/**
+ * mm_modem_3gpp_get_last_scan_time:
+ * @self: A #MMModem3gpp.
+ *
+ * Gets the time when the network scan results that would be reported by
+ * mm_modem_3gpp_scan() were obtained.
+ *
+ * Returns: the time in seconds since the Epoch, or 0 if there are no
+ * results available.
+ *
+ * Since: 1.24
+ */
+guint64
+mm_modem_3gpp_get_last_scan_time (MMModem3gpp *self)
+{
+    g_return_val_if_fail (MM_IS_MODEM_3GPP (self), 0);
+
+    return mm_gdbus_modem3gpp_get_last_scan_time (MM_GDBUS_MODEM3GPP (self));
+}
+
+/*****************************************************************************/
+
 /**
  * mm_modem_3gpp_register_finish:
  * @self: A #MMModem3gpp.
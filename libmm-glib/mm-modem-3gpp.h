@@ -95,6 +95,8 @@ MMBearerProperties *mm_modem_3gpp_peek_initial_eps_bearer_settings (MMModem3gpp
 
 MMModem3gppPacketServiceState mm_modem_3gpp_get_packet_service_state (MMModem3gpp *self);
 
+guint64 mm_modem_3gpp_get_last_scan_time (MMModem3gpp *self);
+
 MMNr5gRegistrationSettings *mm_modem_3gpp_get_nr5g_registration_settings  (MMModem3gpp *self);
 MMNr5gRegistrationSettings *mm_modem_3gpp_peek_nr5g_registration_settings (MMModem3gpp *self);
 
@@ -598,6 +598,125 @@ hexstr_wrong_digits_some (void)
     common_hexstr2bin_test_failure ("012345k7");
 }
 
+/* The original nibble-at-a-time implementation, as reference */
+static gint
+reference_hex2byte (const gchar *hex)
+{
+    gint i;
+    gint ret = 0;
+
+    for (i = 0; i < 2; i++) {
+        ret <<= 4;
+        if (hex[i] >= '0' && hex[i] <= '9')
+            ret |= hex[i] - '0';
+        else if (hex[i] >= 'a' && hex[i] <= 'f')
+            ret |= hex[i] - 'a' + 10;
+        else if (hex[i] >= 'A' && hex[i] <= 'F')
+            ret |= hex[i] - 'A' + 10;
+        else
+            return -1;
+    }
+    return ret;
+}
+
+static void
+hexstr_random (void)
+{
+    static const gchar *chars = "0123456789abcdefABCDEFxX \"";
+    guint               n;
+
+    for (n = 0; n < 1000; n++) {
+        g_autofree gchar  *hex = NULL;
+        g_autofree guint8 *bin = NULL;
+        g_autofree gchar  *hex_2 = NULL;
+        g_autoptr(GError)  error = NULL;
+        gsize              len;
+        gsize              bin_len = 0;
+        gsize              i;
+        gboolean           valid = TRUE;
+
+        /* Mostly valid strings, with an invalid char here and there */
+        len = g_test_rand_int_range (1, 128);
+        hex = g_malloc (len + 1);
+        for (i = 0; i < len; i++)
+            hex[i] = chars[g_test_rand_int_range (0, g_test_rand_int_range (0, 100) ? 22 : strlen (chars))];
+        hex[len] = '\0';
+
+        for (i = 0; i + 1 < len; i += 2) {
+            if (reference_hex2byte (&hex[i]) < 0)
+                valid = FALSE;
+        }
+        if (len % 2)
+            valid = FALSE;
+
+        g_assert (mm_utils_ishexstr (hex) == valid);
+
+        bin = mm_utils_hexstr2bin (hex, -1, &bin_len, &error);
+        if (!valid) {
+            g_assert_null (bin);
+            g_assert_nonnull (error);
+            continue;
+        }
+        g_assert_no_error (error);
+        g_assert_cmpuint (bin_len, ==, len / 2);
+        for (i = 0; i < bin_len; i++)
+            g_assert_cmpint (bin[i], ==, reference_hex2byte (&hex[2 * i]));
+
+        hex_2 = mm_utils_bin2hexstr (bin, bin_len);
+        g_assert_cmpuint (strlen (hex_2), ==, len);
+        g_assert (g_ascii_strcasecmp (hex, hex_2) == 0);
+
+        /* In-place conversion */
+        g_assert (mm_utils_hexstr2bin_buf (hex, len, (guint8 *) hex, &error));
+        g_assert_no_error (error);
+        g_assert_cmpmem (hex, bin_len, bin, bin_len);
+    }
+}
+
+#define HEXSTR_BENCHMARK_ITERATIONS 100000
+
+static void
+hexstr_benchmark (void)
+{
+    guint8             bin[176];
+    gchar              hex[sizeof (bin) * 2 + 1];
+    guint8             bin_2[sizeof (bin)];
+    gdouble            elapsed;
+    guint              i;
+
+    if (!g_test_perf ()) {
+        g_test_skip ("only run in perf mode");
+        return;
+    }
+
+    /* The size of the longest SMS PDU */
+    for (i = 0; i < sizeof (bin); i++)
+        bin[i] = g_test_rand_int_range (0, 0x100);
+
+    g_test_timer_start ();
+    for (i = 0; i < HEXSTR_BENCHMARK_ITERATIONS; i++) {
+        g_autofree gchar  *str = NULL;
+        g_autofree guint8 *out = NULL;
+        gsize              out_len;
+
+        str = mm_utils_bin2hexstr (bin, sizeof (bin));
+        out = mm_utils_hexstr2bin (str, -1, &out_len, NULL);
+    }
+    elapsed = g_test_timer_elapsed ();
+    g_test_message ("hex encode/decode: %u iterations in %.3fs", HEXSTR_BENCHMARK_ITERATIONS, elapsed);
+
+    g_test_timer_start ();
+    for (i = 0; i < HEXSTR_BENCHMARK_ITERATIONS; i++) {
+        mm_utils_bin2hexstr_buf (bin, sizeof (bin), hex);
+        mm_utils_hexstr2bin_buf (hex, sizeof (hex) - 1, bin_2, NULL);
+    }
+    elapsed = g_test_timer_elapsed ();
+    g_test_message ("hex encode/decode without allocations: %u iterations in %.3fs", HEXSTR_BENCHMARK_ITERATIONS, elapsed);
+    g_test_minimized_result (elapsed, "%.3f s", elapsed);
+
+    g_assert_cmpmem (bin, sizeof (bin), bin_2, sizeof (bin_2));
+}
+
 static void
 date_time_iso8601 (void)
 {
@@ -1320,6 +1439,8 @@ int main (int argc, char **argv)
     g_test_add_func ("/MM/Common/HexStr/missing-digits",    hexstr_missing_digits);
     g_test_add_func ("/MM/Common/HexStr/wrong-digits-all",  hexstr_wrong_digits_all);
     g_test_add_func ("/MM/Common/HexStr/wrong-digits-some", hexstr_wrong_digits_some);
+    g_test_add_func ("/MM/Common/HexStr/random",            hexstr_random);
+    g_test_add_func ("/MM/Common/HexStr/benchmark",         hexstr_benchmark);
 
     g_test_add_func ("/MM/Common/DateTime/iso8601", date_time_iso8601);
 
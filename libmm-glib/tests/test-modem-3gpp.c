@@ -0,0 +1,46 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <glib.h>
+#include <libmm-glib.h>
+
+/**************************************************************/
+
+static void
+test_last_scan_time (void)
+{
+    g_autoptr(MMModem3gpp) modem_3gpp = NULL;
+
+    /* Properties are read from the proxy cache, which is filled here
+     * directly instead of from the bus */
+    modem_3gpp = g_object_new (MM_TYPE_MODEM_3GPP, NULL);
+    g_assert_cmpuint (mm_modem_3gpp_get_last_scan_time (modem_3gpp), ==, 0);
+
+    g_dbus_proxy_set_cached_property (G_DBUS_PROXY (modem_3gpp), "LastScanTime", g_variant_new_uint64 (1700000000));
+    g_assert_cmpuint (mm_modem_3gpp_get_last_scan_time (modem_3gpp), ==, 1700000000);
+
+    /* Cleared once the results expire */
+    g_dbus_proxy_set_cached_property (G_DBUS_PROXY (modem_3gpp), "LastScanTime", g_variant_new_uint64 (0));
+    g_assert_cmpuint (mm_modem_3gpp_get_last_scan_time (modem_3gpp), ==, 0);
+}
+
+/**************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/MM/Modem3gpp/last-scan-time", test_last_scan_time);
+
+    return g_test_run ();
+}
@@ -181,3 +181,184 @@ qcdm_log_item_evdo_pilot_sets_v2_get_pilot (QcdmResult *result,
 }
 
 /**********************************************************************/
+
+QcdmResult *
+qcdm_log_item_wcdma_rrc_state_new (const char *buf, size_t len, int *out_error)
+{
+    QcdmResult *result = NULL;
+    DMLogItemWcdmaRrcState *rrc;
+    DMCmdLog *log_cmd = (DMCmdLog *) buf;
+
+    qcdm_return_val_if_fail (buf != NULL, NULL);
+
+    if (!check_log_item (buf, len, DM_LOG_ITEM_WCDMA_RRC_STATE, sizeof (DMLogItemWcdmaRrcState), out_error))
+        return NULL;
+
+    rrc = (DMLogItemWcdmaRrcState *) log_cmd->data;
+    if (rrc->rrc_state > DM_LOG_ITEM_WCDMA_RRC_STATE_URA_PCH) {
+        qcdm_err (0, "Unknown WCDMA RRC state %u", rrc->rrc_state);
+        if (out_error)
+            *out_error = -QCDM_ERROR_RESPONSE_MALFORMED;
+        return NULL;
+    }
+
+    result = qcdm_result_new ();
+    qcdm_result_add_u8 (result, QCDM_LOG_ITEM_WCDMA_RRC_STATE_ITEM_STATE, rrc->rrc_state);
+    return result;
+}
+
+/**********************************************************************/
+
+QcdmResult *
+qcdm_log_item_wcdma_cell_id_new (const char *buf, size_t len, int *out_error)
+{
+    QcdmResult *result = NULL;
+    DMLogItemWcdmaCellId *cell;
+    DMCmdLog *log_cmd = (DMCmdLog *) buf;
+
+    qcdm_return_val_if_fail (buf != NULL, NULL);
+
+    if (!check_log_item (buf, len, DM_LOG_ITEM_WCDMA_CELL_ID, sizeof (DMLogItemWcdmaCellId), out_error))
+        return NULL;
+
+    cell = (DMLogItemWcdmaCellId *) log_cmd->data;
+
+    result = qcdm_result_new ();
+    qcdm_result_add_u32 (result, QCDM_LOG_ITEM_WCDMA_CELL_ID_ITEM_CELL_ID, le32toh (cell->cellid));
+    return result;
+}
+
+/**********************************************************************/
+
+#define WCDMA_AGC_INFO_TX_AGC_VALID 0x10
+
+QcdmResult *
+qcdm_log_item_wcdma_agc_info_new (const char *buf, size_t len, int *out_error)
+{
+    QcdmResult *result = NULL;
+    DMLogItemWcdmaAgcInfo *agc;
+    DMCmdLog *log_cmd = (DMCmdLog *) buf;
+
+    qcdm_return_val_if_fail (buf != NULL, NULL);
+
+    if (!check_log_item (buf, len, DM_LOG_ITEM_WCDMA_AGC_INFO, sizeof (DMLogItemWcdmaAgcInfo), out_error))
+        return NULL;
+
+    agc = (DMLogItemWcdmaAgcInfo *) log_cmd->data;
+
+    result = qcdm_result_new ();
+    qcdm_result_add_u32 (result, QCDM_LOG_ITEM_WCDMA_AGC_INFO_ITEM_RX_AGC, le16toh (agc->rx_agc));
+    if (agc->agc_info & WCDMA_AGC_INFO_TX_AGC_VALID)
+        qcdm_result_add_u32 (result, QCDM_LOG_ITEM_WCDMA_AGC_INFO_ITEM_TX_AGC, le16toh (agc->tx_agc));
+    return result;
+}
+
+/**********************************************************************/
+
+QcdmResult *
+qcdm_log_item_gsm_bcch_message_new (const char *buf, size_t len, int *out_error)
+{
+    QcdmResult *result = NULL;
+    DMLogItemGsmBcchMessage *bcch;
+    DMCmdLog *log_cmd = (DMCmdLog *) buf;
+    uint16_t arfcn;
+
+    qcdm_return_val_if_fail (buf != NULL, NULL);
+
+    if (!check_log_item (buf, len, DM_LOG_ITEM_GSM_BCCH_MESSAGE, sizeof (DMLogItemGsmBcchMessage), out_error))
+        return NULL;
+
+    bcch = (DMLogItemGsmBcchMessage *) log_cmd->data;
+
+    /* Band is top 4 bits; lower 12 is ARFCN */
+    arfcn = le16toh (bcch->bcch_arfcn);
+
+    result = qcdm_result_new ();
+    qcdm_result_add_u8 (result, QCDM_LOG_ITEM_GSM_BCCH_MESSAGE_ITEM_BAND, arfcn >> 12);
+    qcdm_result_add_u32 (result, QCDM_LOG_ITEM_GSM_BCCH_MESSAGE_ITEM_ARFCN, arfcn & 0x0FFF);
+    qcdm_result_add_u32 (result, QCDM_LOG_ITEM_GSM_BCCH_MESSAGE_ITEM_BSIC, le16toh (bcch->bsic));
+    qcdm_result_add_u32 (result, QCDM_LOG_ITEM_GSM_BCCH_MESSAGE_ITEM_CELL_ID, le16toh (bcch->cell_id));
+    return result;
+}
+
+/**********************************************************************/
+
+typedef QcdmResult * (*LogItemNewFunc) (const char *buf, size_t len, int *out_error);
+
+/* Sorted by log code */
+static const struct {
+    uint16_t log_code;
+    LogItemNewFunc new_func;
+} log_item_decoders[] = {
+    { DM_LOG_ITEM_EVDO_PILOT_SETS_V2, qcdm_log_item_evdo_pilot_sets_v2_new },
+    { DM_LOG_ITEM_WCDMA_AGC_INFO,     qcdm_log_item_wcdma_agc_info_new     },
+    { DM_LOG_ITEM_WCDMA_RRC_STATE,    qcdm_log_item_wcdma_rrc_state_new    },
+    { DM_LOG_ITEM_WCDMA_CELL_ID,      qcdm_log_item_wcdma_cell_id_new      },
+    { DM_LOG_ITEM_GSM_BCCH_MESSAGE,   qcdm_log_item_gsm_bcch_message_new   },
+};
+
+static LogItemNewFunc
+find_log_item_decoder (uint16_t log_code)
+{
+    size_t lo = 0, hi = sizeof (log_item_decoders) / sizeof (log_item_decoders[0]);
+
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+
+        if (log_item_decoders[mid].log_code == log_code)
+            return log_item_decoders[mid].new_func;
+        if (log_item_decoders[mid].log_code < log_code)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return NULL;
+}
+
+qcdmbool
+qcdm_log_item_get_code (const char *buf, size_t len, uint16_t *out_log_code)
+{
+    qcdm_return_val_if_fail (buf != NULL, FALSE);
+    qcdm_return_val_if_fail (out_log_code != NULL, FALSE);
+
+    if (len < sizeof (DMCmdLog) || buf[0] != DIAG_CMD_LOG)
+        return FALSE;
+
+    *out_log_code = le16toh (((DMCmdLog *) buf)->log_code);
+    return TRUE;
+}
+
+qcdmbool
+qcdm_log_item_is_supported (uint16_t log_code)
+{
+    return !!find_log_item_decoder (log_code);
+}
+
+QcdmResult *
+qcdm_log_item_new (const char *buf, size_t len, uint16_t *out_log_code, int *out_error)
+{
+    LogItemNewFunc new_func;
+    uint16_t log_code;
+
+    qcdm_return_val_if_fail (buf != NULL, NULL);
+
+    if (!qcdm_log_item_get_code (buf, len, &log_code)) {
+        if (out_error)
+            *out_error = -QCDM_ERROR_RESPONSE_UNEXPECTED;
+        return NULL;
+    }
+
+    if (out_log_code)
+        *out_log_code = log_code;
+
+    new_func = find_log_item_decoder (log_code);
+    if (!new_func) {
+        if (out_error)
+            *out_error = -QCDM_ERROR_VALUE_NOT_FOUND;
+        return NULL;
+    }
+
+    return new_func (buf, len, out_error);
+}
+
+/**********************************************************************/
@@ -47,4 +47,66 @@ qcdmbool    qcdm_log_item_evdo_pilot_sets_v2_get_pilot (QcdmResult *result,
 
 /**********************************************************************/
 
+enum {
+    QCDM_LOG_ITEM_WCDMA_RRC_STATE_DISCONNECTED = 0,
+    QCDM_LOG_ITEM_WCDMA_RRC_STATE_CONNECTING   = 1,
+    QCDM_LOG_ITEM_WCDMA_RRC_STATE_CELL_FACH    = 2,
+    QCDM_LOG_ITEM_WCDMA_RRC_STATE_CELL_DCH     = 3,
+    QCDM_LOG_ITEM_WCDMA_RRC_STATE_CELL_PCH     = 4,
+    QCDM_LOG_ITEM_WCDMA_RRC_STATE_URA_PCH      = 5,
+};
+
+#define QCDM_LOG_ITEM_WCDMA_RRC_STATE_ITEM_STATE "rrc-state"
+
+QcdmResult *qcdm_log_item_wcdma_rrc_state_new (const char *buf,
+                                               size_t len,
+                                               int *out_error);
+
+/**********************************************************************/
+
+#define QCDM_LOG_ITEM_WCDMA_CELL_ID_ITEM_CELL_ID "cell-id"
+
+QcdmResult *qcdm_log_item_wcdma_cell_id_new (const char *buf,
+                                             size_t len,
+                                             int *out_error);
+
+/**********************************************************************/
+
+/* Raw AGC values as reported by the device; TX AGC only when valid */
+#define QCDM_LOG_ITEM_WCDMA_AGC_INFO_ITEM_RX_AGC "rx-agc"
+#define QCDM_LOG_ITEM_WCDMA_AGC_INFO_ITEM_TX_AGC "tx-agc"
+
+QcdmResult *qcdm_log_item_wcdma_agc_info_new (const char *buf,
+                                              size_t len,
+                                              int *out_error);
+
+/**********************************************************************/
+
+#define QCDM_LOG_ITEM_GSM_BCCH_MESSAGE_ITEM_BAND    "band"
+#define QCDM_LOG_ITEM_GSM_BCCH_MESSAGE_ITEM_ARFCN   "arfcn"
+#define QCDM_LOG_ITEM_GSM_BCCH_MESSAGE_ITEM_BSIC    "bsic"
+#define QCDM_LOG_ITEM_GSM_BCCH_MESSAGE_ITEM_CELL_ID "cell-id"
+
+QcdmResult *qcdm_log_item_gsm_bcch_message_new (const char *buf,
+                                                size_t len,
+                                                int *out_error);
+
+/**********************************************************************/
+
+/* Returns the log code of a DIAG_CMD_LOG packet, without decoding it */
+qcdmbool    qcdm_log_item_get_code     (const char *buf,
+                                        size_t len,
+                                        uint16_t *out_log_code);
+
+/* Returns TRUE if qcdm_log_item_new() knows how to decode 'log_code' */
+qcdmbool    qcdm_log_item_is_supported (uint16_t log_code);
+
+/* Decodes any supported log item, dispatching on its log code */
+QcdmResult *qcdm_log_item_new          (const char *buf,
+                                        size_t len,
+                                        uint16_t *out_log_code,
+                                        int *out_error);
+
+/**********************************************************************/
+
 #endif  /* LIBQCDM_LOGS_H */
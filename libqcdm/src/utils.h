@@ -59,4 +59,13 @@ qcdmbool dm_decapsulate_buffer (const char *inbuf,
                                 size_t *out_used,
                                 qcdmbool *out_need_more);
 
+qcdmbool dm_decapsulate_frame (const char *inbuf,
+                               size_t inbuf_len,
+                               char *scratch,
+                               size_t scratch_len,
+                               const char **out_frame,
+                               size_t *out_frame_len,
+                               size_t *out_used,
+                               qcdmbool *out_need_more);
+
 #endif  /* LIBQCDM_UTILS_H */
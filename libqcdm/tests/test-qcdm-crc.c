@@ -63,3 +63,30 @@ test_crc16_1 (void *f, void *data)
     g_assert (crc == expected);
 }
 
+static guint16
+crc16_bitwise (const char *buf, gsize len)
+{
+    guint16 crc = 0xffff;
+    guint i;
+
+    while (len--) {
+        crc ^= (guint8) *buf++;
+        for (i = 0; i < 8; i++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0x8408 : (crc >> 1);
+    }
+    return ~crc;
+}
+
+void
+test_crc16_random (void *f, void *data)
+{
+    char buf[300];
+    guint i, len;
+
+    /* Every length, so that all the tails after 8-byte blocks are covered */
+    for (len = 0; len < sizeof (buf); len++) {
+        for (i = 0; i < len; i++)
+            buf[i] = g_test_rand_int_range (0, 256);
+        g_assert_cmphex (dm_crc16 (buf, len), ==, crc16_bitwise (buf, len));
+    }
+}
@@ -0,0 +1,168 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software: you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+#include <string.h>
+
+#include "test-qcdm-logs.h"
+#include "logs.h"
+#include "errors.h"
+
+/* Log packet header: code, more, len, len, log code, timestamp */
+#define LOG_HEADER(code_lo, code_hi, len) \
+    0x10, 0x00, len, 0x00, len, 0x00, code_lo, code_hi, \
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+
+static const char rrc_state_log[] = {
+    LOG_HEADER (0x25, 0x41, 13),
+    0x03
+};
+
+void
+test_log_item_wcdma_rrc_state (void *f, void *data)
+{
+    QcdmResult *result;
+    guint8 state = 0;
+    int err = QCDM_SUCCESS;
+
+    result = qcdm_log_item_wcdma_rrc_state_new (rrc_state_log, sizeof (rrc_state_log), &err);
+    g_assert (result);
+    g_assert_cmpint (qcdm_result_get_u8 (result, QCDM_LOG_ITEM_WCDMA_RRC_STATE_ITEM_STATE, &state), ==, 0);
+    g_assert_cmpuint (state, ==, QCDM_LOG_ITEM_WCDMA_RRC_STATE_CELL_DCH);
+    qcdm_result_unref (result);
+
+    /* Truncated */
+    result = qcdm_log_item_wcdma_rrc_state_new (rrc_state_log, sizeof (rrc_state_log) - 1, &err);
+    g_assert (result == NULL);
+    g_assert_cmpint (err, ==, -QCDM_ERROR_RESPONSE_BAD_LENGTH);
+}
+
+static const char cell_id_log[] = {
+    LOG_HEADER (0x27, 0x41, 28),
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x78, 0x56, 0x34, 0x02,
+    0x00, 0x00, 0x00, 0x00
+};
+
+void
+test_log_item_wcdma_cell_id (void *f, void *data)
+{
+    QcdmResult *result;
+    guint32 cell_id = 0;
+    int err = QCDM_SUCCESS;
+
+    result = qcdm_log_item_wcdma_cell_id_new (cell_id_log, sizeof (cell_id_log), &err);
+    g_assert (result);
+    g_assert_cmpint (qcdm_result_get_u32 (result, QCDM_LOG_ITEM_WCDMA_CELL_ID_ITEM_CELL_ID, &cell_id), ==, 0);
+    g_assert_cmphex (cell_id, ==, 0x02345678);
+    qcdm_result_unref (result);
+
+    /* Wrong log code */
+    result = qcdm_log_item_wcdma_cell_id_new (rrc_state_log, sizeof (rrc_state_log), &err);
+    g_assert (result == NULL);
+    g_assert_cmpint (err, ==, -QCDM_ERROR_RESPONSE_UNEXPECTED);
+}
+
+static const char bcch_log[] = {
+    LOG_HEADER (0x34, 0x51, 25),
+    0x80, 0xB0,                   /* GSM 850, ARFCN 128 */
+    0x25, 0x00,                   /* BSIC */
+    0x39, 0x30,                   /* cell ID */
+    0x00, 0xF1, 0x10, 0x00, 0x01, /* LAI */
+    0x00,
+    0x00
+};
+
+void
+test_log_item_gsm_bcch_message (void *f, void *data)
+{
+    QcdmResult *result;
+    guint8 band = 0;
+    guint32 arfcn = 0;
+    guint32 bsic = 0;
+    guint32 cell_id = 0;
+    int err = QCDM_SUCCESS;
+
+    result = qcdm_log_item_gsm_bcch_message_new (bcch_log, sizeof (bcch_log), &err);
+    g_assert (result);
+    g_assert_cmpint (qcdm_result_get_u8 (result, QCDM_LOG_ITEM_GSM_BCCH_MESSAGE_ITEM_BAND, &band), ==, 0);
+    g_assert_cmpuint (band, ==, 0x0B);
+    g_assert_cmpint (qcdm_result_get_u32 (result, QCDM_LOG_ITEM_GSM_BCCH_MESSAGE_ITEM_ARFCN, &arfcn), ==, 0);
+    g_assert_cmpuint (arfcn, ==, 128);
+    g_assert_cmpint (qcdm_result_get_u32 (result, QCDM_LOG_ITEM_GSM_BCCH_MESSAGE_ITEM_BSIC, &bsic), ==, 0);
+    g_assert_cmpuint (bsic, ==, 0x25);
+    g_assert_cmpint (qcdm_result_get_u32 (result, QCDM_LOG_ITEM_GSM_BCCH_MESSAGE_ITEM_CELL_ID, &cell_id), ==, 0);
+    g_assert_cmpuint (cell_id, ==, 12345);
+    qcdm_result_unref (result);
+}
+
+static const char agc_info_log[] = {
+    LOG_HEADER (0x05, 0x41, 24),
+    0x01,
+    0xB0, 0xFF, /* RX AGC */
+    0x10, 0x00, /* TX AGC */
+    0x00, 0x00,
+    0x00, 0x00,
+    0x00, 0x00,
+    0x00        /* TX AGC not valid */
+};
+
+static const char ta_finger_info_log[] = {
+    LOG_HEADER (0x03, 0x40, 12),
+    0x00
+};
+
+void
+test_log_item_dispatch (void *f, void *data)
+{
+    QcdmResult *result;
+    uint16_t log_code = 0;
+    guint32 rx_agc = 0;
+    guint32 tx_agc = 0;
+    guint8 state = 0;
+    int err = QCDM_SUCCESS;
+
+    g_assert (qcdm_log_item_get_code (cell_id_log, sizeof (cell_id_log), &log_code));
+    g_assert_cmphex (log_code, ==, 0x4127);
+    g_assert (qcdm_log_item_is_supported (0x4127));
+    g_assert (qcdm_log_item_is_supported (0x108B));
+    g_assert (!qcdm_log_item_is_supported (0x4003));
+
+    result = qcdm_log_item_new (rrc_state_log, sizeof (rrc_state_log), &log_code, &err);
+    g_assert (result);
+    g_assert_cmphex (log_code, ==, 0x4125);
+    g_assert_cmpint (qcdm_result_get_u8 (result, QCDM_LOG_ITEM_WCDMA_RRC_STATE_ITEM_STATE, &state), ==, 0);
+    g_assert_cmpuint (state, ==, QCDM_LOG_ITEM_WCDMA_RRC_STATE_CELL_DCH);
+    qcdm_result_unref (result);
+
+    result = qcdm_log_item_new (agc_info_log, sizeof (agc_info_log), &log_code, &err);
+    g_assert (result);
+    g_assert_cmphex (log_code, ==, 0x4105);
+    g_assert_cmpint (qcdm_result_get_u32 (result, QCDM_LOG_ITEM_WCDMA_AGC_INFO_ITEM_RX_AGC, &rx_agc), ==, 0);
+    g_assert_cmphex (rx_agc, ==, 0xFFB0);
+    g_assert_cmpint (qcdm_result_get_u32 (result, QCDM_LOG_ITEM_WCDMA_AGC_INFO_ITEM_TX_AGC, &tx_agc), !=, 0);
+    qcdm_result_unref (result);
+
+    /* Log items without a decoder */
+    result = qcdm_log_item_new (ta_finger_info_log, sizeof (ta_finger_info_log), &log_code, &err);
+    g_assert (result == NULL);
+    g_assert_cmphex (log_code, ==, 0x4003);
+    g_assert_cmpint (err, ==, -QCDM_ERROR_VALUE_NOT_FOUND);
+
+    /* Not a log item at all */
+    result = qcdm_log_item_new (ta_finger_info_log + 1, sizeof (ta_finger_info_log) - 1, NULL, &err);
+    g_assert (result == NULL);
+    g_assert_cmpint (err, ==, -QCDM_ERROR_RESPONSE_UNEXPECTED);
+}
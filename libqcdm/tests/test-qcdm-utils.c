@@ -104,3 +104,164 @@ test_utils_decapsulate_sierra_cns (void *f, void *data)
     g_assert (success == FALSE);
 }
 
+void
+test_utils_decapsulate_frame (void *f, void *data)
+{
+    static const char plain_inbuf[] = {
+        0x4b, 0x05, 0x08, 0x00, 0x01, 0xdd, 0x7e
+    };
+    char scratch[512];
+    const char *frame = NULL;
+    gsize frame_len = 0;
+    gsize used = 0;
+    qcdmbool more = FALSE;
+    gboolean success;
+
+    /* Packets without escaped bytes are returned in place */
+    success = dm_decapsulate_frame (plain_inbuf, sizeof (plain_inbuf),
+                                    scratch, sizeof (scratch),
+                                    &frame, &frame_len, &used, &more);
+    g_assert (success);
+    g_assert (more == FALSE);
+    g_assert (frame == plain_inbuf);
+    g_assert (frame_len == 4);
+    g_assert (used == sizeof (plain_inbuf));
+
+    /* Escaped ones are unescaped into the scratch buffer */
+    success = dm_decapsulate_frame (decap_inbuf, sizeof (decap_inbuf),
+                                    scratch, sizeof (scratch),
+                                    &frame, &frame_len, &used, &more);
+    g_assert (success);
+    g_assert (more == FALSE);
+    g_assert (frame == scratch);
+    g_assert (frame_len == 214);
+    g_assert (used == 221);
+
+    /* ...unless it is too small for them */
+    success = dm_decapsulate_frame (decap_inbuf, sizeof (decap_inbuf),
+                                    NULL, 0,
+                                    &frame, &frame_len, &used, &more);
+    g_assert (success == FALSE);
+    g_assert (used == 221);
+
+    /* Incomplete packets */
+    success = dm_decapsulate_frame (decap_inbuf, sizeof (decap_inbuf) - 1,
+                                    scratch, sizeof (scratch),
+                                    &frame, &frame_len, &used, &more);
+    g_assert (success);
+    g_assert (more == TRUE);
+}
+
+/* Builds a capture of back to back log packets, as read from a DM port */
+static GByteArray *
+build_capture (gsize capture_len, guint *out_n_packets)
+{
+    GByteArray *capture;
+    char packet[520];
+    char encap[1100];
+    guint n_packets = 0;
+
+    capture = g_byte_array_sized_new (capture_len + sizeof (encap));
+    while (capture->len < capture_len) {
+        gsize packet_len, encap_len, i;
+
+        packet_len = g_test_rand_int_range (16, sizeof (packet) - 2);
+        packet[0] = 0x10; /* DIAG_CMD_LOG */
+        for (i = 1; i < packet_len; i++)
+            packet[i] = g_test_rand_int_range (0, 256);
+
+        encap_len = dm_encapsulate_buffer (packet, packet_len, sizeof (packet),
+                                           encap, sizeof (encap));
+        g_assert (encap_len > 0);
+        g_byte_array_append (capture, (const guint8 *) encap, encap_len);
+        n_packets++;
+    }
+
+    *out_n_packets = n_packets;
+    return capture;
+}
+
+void
+test_utils_decapsulate_stream (void *f, void *data)
+{
+    GByteArray *capture;
+    char scratch[2048];
+    char outbuf[2048];
+    guint n_packets = 0;
+    guint n_found = 0;
+    gsize offset = 0;
+
+    /* Frames and buffer copies must agree on every packet of the stream */
+    capture = build_capture (256 * 1024, &n_packets);
+    while (offset < capture->len) {
+        const char *inbuf = (const char *) &capture->data[offset];
+        gsize inbuf_len = capture->len - offset;
+        const char *frame = NULL;
+        gsize frame_len = 0, decap_len = 0, used = 0;
+        qcdmbool more = FALSE;
+
+        g_assert (dm_decapsulate_frame (inbuf, inbuf_len, scratch, sizeof (scratch),
+                                        &frame, &frame_len, &used, &more));
+        g_assert (more == FALSE);
+        g_assert (frame_len > 0);
+        g_assert (frame[0] == 0x10);
+
+        g_assert (dm_decapsulate_buffer (inbuf, inbuf_len, outbuf, sizeof (outbuf),
+                                         &decap_len, &used, &more));
+        g_assert (decap_len == frame_len);
+        g_assert (memcmp (outbuf, frame, frame_len) == 0);
+
+        offset += used;
+        n_found++;
+    }
+    g_assert_cmpuint (n_found, ==, n_packets);
+
+    g_byte_array_unref (capture);
+}
+
+void
+test_utils_decapsulate_benchmark (void *f, void *data)
+{
+    GByteArray *capture;
+    char scratch[2048];
+    guint n_packets = 0;
+    guint n_found = 0;
+    guint rounds = 10;
+    guint i;
+    gdouble elapsed;
+
+    if (!g_test_perf ()) {
+        g_test_skip ("only run in perf mode");
+        return;
+    }
+
+    /* Replay a multi-megabyte capture as if it was read from the port */
+    capture = build_capture (8 * 1024 * 1024, &n_packets);
+
+    g_test_timer_start ();
+    for (i = 0; i < rounds; i++) {
+        gsize offset = 0;
+
+        while (offset < capture->len) {
+            const char *frame = NULL;
+            gsize frame_len = 0, used = 0;
+            qcdmbool more = FALSE;
+
+            dm_decapsulate_frame ((const char *) &capture->data[offset],
+                                  capture->len - offset,
+                                  scratch, sizeof (scratch),
+                                  &frame, &frame_len, &used, &more);
+            g_assert (used > 0);
+            offset += used;
+            n_found++;
+        }
+    }
+    elapsed = g_test_timer_elapsed ();
+
+    g_assert_cmpuint (n_found, ==, n_packets * rounds);
+    g_test_message ("deframed %u packets (%.1f MB) in %.3f s",
+                    n_found, (gdouble) capture->len * rounds / (1024 * 1024), elapsed);
+    g_test_minimized_result (elapsed, "deframing time: %.3f s", elapsed);
+
+    g_byte_array_unref (capture);
+}
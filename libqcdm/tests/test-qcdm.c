@@ -23,6 +23,7 @@
 #include "test-qcdm-com.h"
 #include "test-qcdm-result.h"
 #include "test-qcdm-utils.h"
+#include "test-qcdm-logs.h"
 
 typedef struct {
     gpointer com_data;
@@ -80,12 +81,20 @@ int main (int argc, char **argv)
 
     g_test_suite_add (suite, TESTCASE (test_crc16_1, NULL));
     g_test_suite_add (suite, TESTCASE (test_crc16_2, NULL));
+    g_test_suite_add (suite, TESTCASE (test_crc16_random, NULL));
     g_test_suite_add (suite, TESTCASE (test_escape1, NULL));
     g_test_suite_add (suite, TESTCASE (test_escape2, NULL));
     g_test_suite_add (suite, TESTCASE (test_escape_unescape, NULL));
     g_test_suite_add (suite, TESTCASE (test_utils_decapsulate_buffer, NULL));
     g_test_suite_add (suite, TESTCASE (test_utils_encapsulate_buffer, NULL));
     g_test_suite_add (suite, TESTCASE (test_utils_decapsulate_sierra_cns, NULL));
+    g_test_suite_add (suite, TESTCASE (test_utils_decapsulate_frame, NULL));
+    g_test_suite_add (suite, TESTCASE (test_utils_decapsulate_stream, NULL));
+    g_test_suite_add (suite, TESTCASE (test_utils_decapsulate_benchmark, NULL));
+    g_test_suite_add (suite, TESTCASE (test_log_item_wcdma_rrc_state, NULL));
+    g_test_suite_add (suite, TESTCASE (test_log_item_wcdma_cell_id, NULL));
+    g_test_suite_add (suite, TESTCASE (test_log_item_gsm_bcch_message, NULL));
+    g_test_suite_add (suite, TESTCASE (test_log_item_dispatch, NULL));
     g_test_suite_add (suite, TESTCASE (test_result_string, NULL));
     g_test_suite_add (suite, TESTCASE (test_result_uint32, NULL));
     g_test_suite_add (suite, TESTCASE (test_result_uint8, NULL));
@@ -440,3 +440,404 @@ out:
 
     return rules;
 }
+
+/*****************************************************************************/
+/* Compiled rules */
+
+typedef enum {
+    CONDITION_COMPILED,
+    CONDITION_BUCKETED,
+    CONDITION_ALWAYS_TRUE,
+    CONDITION_ALWAYS_FALSE,
+} ConditionCompileResult;
+
+/* Values a rule requires from the device; rules are only included in the
+ * programs of the buckets matching them */
+typedef struct {
+    gboolean     never;
+    gint         vid;
+    gint         pid;
+    const gchar *subsystem;
+} RuleBucket;
+
+struct _MMUdevRulesIndex {
+    volatile gint       ref_count;
+    GArray             *rules;
+    MMUdevCompiledRule *compiled;
+    RuleBucket         *buckets;
+    /* Programs built so far, indexed by VID, PID and SUBSYSTEM */
+    GHashTable         *programs;
+};
+
+G_DEFINE_BOXED_TYPE (MMUdevRulesIndex, mm_udev_rules_index, mm_udev_rules_index_ref, mm_udev_rules_index_unref)
+
+static ConditionCompileResult
+bucket_number (gint        *bucket_value,
+               const gchar *value)
+{
+    guint number;
+
+    if (!mm_get_uint_from_hex_str (value, &number))
+        return CONDITION_ALWAYS_FALSE;
+    if (*bucket_value >= 0 && (guint) *bucket_value != number)
+        return CONDITION_ALWAYS_FALSE;
+    *bucket_value = (gint) number;
+    return CONDITION_BUCKETED;
+}
+
+static ConditionCompileResult
+compile_condition (const MMUdevRuleMatch *match,
+                   MMUdevRuleCondition   *condition,
+                   RuleBucket            *bucket)
+{
+    condition->equal = (match->type == MM_UDEV_RULE_MATCH_TYPE_EQUAL);
+    condition->value = match->value;
+
+    /* We only apply 'add' rules */
+    if (g_str_equal (match->parameter, "ACTION"))
+        return (((!!strstr (match->value, "add")) == condition->equal) ? CONDITION_ALWAYS_TRUE : CONDITION_ALWAYS_FALSE);
+
+    if (g_str_equal (match->parameter, "SUBSYSTEM")) {
+        if (condition->equal) {
+            if (bucket->subsystem && !g_str_equal (bucket->subsystem, match->value))
+                return CONDITION_ALWAYS_FALSE;
+            bucket->subsystem = match->value;
+            return CONDITION_BUCKETED;
+        }
+        condition->type = MM_UDEV_RULE_CONDITION_TYPE_SUBSYSTEM;
+        return CONDITION_COMPILED;
+    }
+
+    if (g_str_equal (match->parameter, "SUBSYSTEMS")) {
+        condition->type = MM_UDEV_RULE_CONDITION_TYPE_SUBSYSTEMS;
+        return CONDITION_COMPILED;
+    }
+
+    if (g_str_equal (match->parameter, "DRIVER")) {
+        condition->type = MM_UDEV_RULE_CONDITION_TYPE_DRIVER;
+        return CONDITION_COMPILED;
+    }
+
+    if (g_str_equal (match->parameter, "DRIVERS")) {
+        condition->type = MM_UDEV_RULE_CONDITION_TYPE_DRIVERS;
+        return CONDITION_COMPILED;
+    }
+
+    if (g_str_equal (match->parameter, "KERNEL")) {
+        condition->type = MM_UDEV_RULE_CONDITION_TYPE_KERNEL;
+        return CONDITION_COMPILED;
+    }
+
+    if (g_str_equal (match->parameter, "DEVPATH")) {
+        condition->type = MM_UDEV_RULE_CONDITION_TYPE_DEVPATH;
+        /* If not already doing a prefix match, do an implicit one. This is so that
+         * we can add properties to the usb_device owning all ports, and then apply
+         * the property to all ports individually processed. */
+        if (match->value[0] && match->value[strlen (match->value) - 1] != '*')
+            condition->prefix_match = g_strdup_printf ("%s/*", match->value);
+        return CONDITION_COMPILED;
+    }
+
+    if (g_str_has_prefix (match->parameter, "ATTR")) {
+        g_autofree gchar *attribute = NULL;
+
+        attribute = g_strdup (&match->parameter[5]);
+        g_strdelimit (attribute, "{}", ' ');
+        g_strstrip (attribute);
+
+        if (g_str_equal (attribute, "idVendor") || g_str_equal (attribute, "vendor")) {
+            if (condition->equal)
+                return bucket_number (&bucket->vid, match->value);
+            condition->type = MM_UDEV_RULE_CONDITION_TYPE_VID;
+        } else if (g_str_equal (attribute, "idProduct") || g_str_equal (attribute, "device")) {
+            if (condition->equal)
+                return bucket_number (&bucket->pid, match->value);
+            condition->type = MM_UDEV_RULE_CONDITION_TYPE_PID;
+        } else if (g_str_equal (attribute, "subsystem_vendor"))
+            condition->type = MM_UDEV_RULE_CONDITION_TYPE_SUBSYSTEM_VID;
+        else if (g_str_equal (attribute, "manufacturer"))
+            condition->type = MM_UDEV_RULE_CONDITION_TYPE_MANUFACTURER;
+        else if (g_str_equal (attribute, "product"))
+            condition->type = MM_UDEV_RULE_CONDITION_TYPE_PRODUCT;
+        else if (g_str_equal (attribute, "bInterfaceClass"))
+            condition->type = MM_UDEV_RULE_CONDITION_TYPE_INTERFACE_CLASS;
+        else if (g_str_equal (attribute, "bInterfaceSubClass"))
+            condition->type = MM_UDEV_RULE_CONDITION_TYPE_INTERFACE_SUBCLASS;
+        else if (g_str_equal (attribute, "bInterfaceProtocol"))
+            condition->type = MM_UDEV_RULE_CONDITION_TYPE_INTERFACE_PROTOCOL;
+        else if (g_str_equal (attribute, "bInterfaceNumber"))
+            condition->type = MM_UDEV_RULE_CONDITION_TYPE_INTERFACE_NUMBER;
+        else {
+            condition->type    = MM_UDEV_RULE_CONDITION_TYPE_ATTRIBUTE;
+            condition->name    = g_intern_string (attribute);
+            condition->iterate = g_str_has_prefix (match->parameter, "ATTRS");
+            return CONDITION_COMPILED;
+        }
+
+        /* Any interface value matches the wildcard */
+        if (condition->type >= MM_UDEV_RULE_CONDITION_TYPE_INTERFACE_CLASS &&
+            condition->type <= MM_UDEV_RULE_CONDITION_TYPE_INTERFACE_NUMBER &&
+            g_str_equal (match->value, "?*"))
+            return CONDITION_ALWAYS_TRUE;
+
+        /* All other known attributes except for the strings are numeric */
+        if (condition->type != MM_UDEV_RULE_CONDITION_TYPE_MANUFACTURER &&
+            condition->type != MM_UDEV_RULE_CONDITION_TYPE_PRODUCT &&
+            !mm_get_uint_from_hex_str (match->value, &condition->number))
+            return CONDITION_ALWAYS_FALSE;
+
+        return CONDITION_COMPILED;
+    }
+
+    /* Previously set property checks */
+    if (g_str_has_prefix (match->parameter, "ENV")) {
+        g_autofree gchar *property = NULL;
+
+        property = g_strdup (&match->parameter[3]);
+        g_strdelimit (property, "{}", ' ');
+        g_strstrip (property);
+
+        condition->type = MM_UDEV_RULE_CONDITION_TYPE_PROPERTY;
+        condition->name = g_intern_string (property);
+        return CONDITION_COMPILED;
+    }
+
+    mm_warn ("unknown match condition parameter: %s", match->parameter);
+    return CONDITION_ALWAYS_FALSE;
+}
+
+static void
+compile_rule (const MMUdevRule   *rule,
+              guint               index,
+              MMUdevCompiledRule *compiled,
+              RuleBucket         *bucket)
+{
+    guint i;
+
+    compiled->index = index;
+    compiled->type  = rule->result.type;
+    bucket->vid     = -1;
+    bucket->pid     = -1;
+
+    switch (rule->result.type) {
+    case MM_UDEV_RULE_RESULT_TYPE_PROPERTY:
+        compiled->property_name  = g_intern_string (rule->result.content.property.name);
+        compiled->property_value = rule->result.content.property.value;
+        if (g_str_equal (compiled->property_value, "$attr{bInterfaceClass}"))
+            compiled->property_value_source = MM_UDEV_RULE_VALUE_SOURCE_INTERFACE_CLASS;
+        else if (g_str_equal (compiled->property_value, "$attr{bInterfaceSubClass}"))
+            compiled->property_value_source = MM_UDEV_RULE_VALUE_SOURCE_INTERFACE_SUBCLASS;
+        else if (g_str_equal (compiled->property_value, "$attr{bInterfaceProtocol}"))
+            compiled->property_value_source = MM_UDEV_RULE_VALUE_SOURCE_INTERFACE_PROTOCOL;
+        else if (g_str_equal (compiled->property_value, "$attr{bInterfaceNumber}"))
+            compiled->property_value_source = MM_UDEV_RULE_VALUE_SOURCE_INTERFACE_NUMBER;
+        else
+            compiled->property_value_source = MM_UDEV_RULE_VALUE_SOURCE_STATIC;
+        break;
+    case MM_UDEV_RULE_RESULT_TYPE_GOTO_INDEX:
+        break;
+    case MM_UDEV_RULE_RESULT_TYPE_LABEL:
+        /* Labels are noops, GOTO targets are resolved when building programs */
+        bucket->never = TRUE;
+        return;
+    case MM_UDEV_RULE_RESULT_TYPE_GOTO_TAG:
+    case MM_UDEV_RULE_RESULT_TYPE_UNKNOWN:
+    default:
+        g_assert_not_reached ();
+    }
+
+    if (!rule->conditions)
+        return;
+
+    compiled->conditions = g_new0 (MMUdevRuleCondition, rule->conditions->len);
+    for (i = 0; i < rule->conditions->len; i++) {
+        MMUdevRuleCondition *condition;
+
+        condition = &compiled->conditions[compiled->n_conditions];
+        switch (compile_condition (&g_array_index (rule->conditions, MMUdevRuleMatch, i), condition, bucket)) {
+        case CONDITION_COMPILED:
+            compiled->n_conditions++;
+            break;
+        case CONDITION_ALWAYS_FALSE:
+            bucket->never = TRUE;
+            /* fall through */
+        case CONDITION_BUCKETED:
+        case CONDITION_ALWAYS_TRUE:
+        default:
+            memset (condition, 0, sizeof (MMUdevRuleCondition));
+            break;
+        }
+        if (bucket->never)
+            return;
+    }
+}
+
+static void
+udev_rule_program_free (MMUdevRuleProgram *program)
+{
+    g_free (program->steps);
+    g_free (program);
+}
+
+static MMUdevRuleProgram *
+build_program (MMUdevRulesIndex *self,
+               guint16           vid,
+               guint16           pid,
+               const gchar      *subsystem)
+{
+    MMUdevRuleProgram *program;
+    GArray            *steps;
+    guint              i;
+
+    steps = g_array_new (FALSE, FALSE, sizeof (MMUdevRuleStep));
+    for (i = 0; i < self->rules->len; i++) {
+        const RuleBucket *bucket;
+        MMUdevRuleStep    step = { 0 };
+
+        bucket = &self->buckets[i];
+        if (bucket->never ||
+            (bucket->vid >= 0 && (guint) bucket->vid != vid) ||
+            (bucket->pid >= 0 && (guint) bucket->pid != pid) ||
+            (bucket->subsystem && g_strcmp0 (bucket->subsystem, subsystem) != 0))
+            continue;
+
+        step.rule = &self->compiled[i];
+        g_array_append_val (steps, step);
+    }
+
+    program = g_new0 (MMUdevRuleProgram, 1);
+    program->n_steps = steps->len;
+    program->steps = (MMUdevRuleStep *) g_array_free (steps, FALSE);
+
+    /* Resolve GOTO targets: continue from the first step with a rule at or
+     * after the label; labels always come after the GOTO rules */
+    for (i = 0; i < program->n_steps; i++) {
+        guint target;
+        guint low;
+        guint high;
+
+        if (program->steps[i].rule->type != MM_UDEV_RULE_RESULT_TYPE_GOTO_INDEX)
+            continue;
+
+        target = g_array_index (self->rules, MMUdevRule, program->steps[i].rule->index).result.content.index;
+        low = i + 1;
+        high = program->n_steps;
+        while (low < high) {
+            guint middle;
+
+            middle = low + (high - low) / 2;
+            if (program->steps[middle].rule->index < target)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        program->steps[i].goto_step = low;
+    }
+
+    return program;
+}
+
+const MMUdevRuleProgram *
+mm_udev_rules_index_lookup_program (MMUdevRulesIndex *self,
+                                    guint16           vid,
+                                    guint16           pid,
+                                    const gchar      *subsystem)
+{
+    g_autofree gchar  *key = NULL;
+    MMUdevRuleProgram *program;
+
+    key = g_strdup_printf ("%04x:%04x:%s", vid, pid, subsystem ? subsystem : "");
+    program = g_hash_table_lookup (self->programs, key);
+    if (!program) {
+        program = build_program (self, vid, pid, subsystem);
+        g_hash_table_insert (self->programs, g_steal_pointer (&key), program);
+    }
+    return program;
+}
+
+void
+mm_udev_rule_program_run (const MMUdevRuleProgram *program,
+                          MMUdevRuleConditionFunc  check_condition,
+                          MMUdevRulePropertyFunc   set_property,
+                          gpointer                 user_data)
+{
+    guint i = 0;
+
+    while (i < program->n_steps) {
+        const MMUdevRuleStep *step;
+        guint                 j;
+
+        step = &program->steps[i];
+        for (j = 0; j < step->rule->n_conditions; j++) {
+            if (!check_condition (&step->rule->conditions[j], user_data))
+                break;
+        }
+
+        /* Rule not applied, go to the next one */
+        if (j < step->rule->n_conditions) {
+            i++;
+            continue;
+        }
+
+        if (step->rule->type == MM_UDEV_RULE_RESULT_TYPE_GOTO_INDEX) {
+            i = step->goto_step;
+            continue;
+        }
+
+        set_property (step->rule, user_data);
+        i++;
+    }
+}
+
+guint
+mm_udev_rules_index_get_n_rules (MMUdevRulesIndex *self)
+{
+    return self->rules->len;
+}
+
+MMUdevRulesIndex *
+mm_udev_rules_index_new (GArray *rules)
+{
+    MMUdevRulesIndex *self;
+    guint             i;
+
+    self = g_slice_new0 (MMUdevRulesIndex);
+    self->ref_count = 1;
+    self->rules = g_array_ref (rules);
+    self->compiled = g_new0 (MMUdevCompiledRule, rules->len);
+    self->buckets = g_new0 (RuleBucket, rules->len);
+    self->programs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) udev_rule_program_free);
+
+    for (i = 0; i < rules->len; i++)
+        compile_rule (&g_array_index (rules, MMUdevRule, i), i, &self->compiled[i], &self->buckets[i]);
+
+    return self;
+}
+
+MMUdevRulesIndex *
+mm_udev_rules_index_ref (MMUdevRulesIndex *self)
+{
+    g_atomic_int_inc (&self->ref_count);
+    return self;
+}
+
+void
+mm_udev_rules_index_unref (MMUdevRulesIndex *self)
+{
+    if (g_atomic_int_dec_and_test (&self->ref_count)) {
+        guint i;
+
+        for (i = 0; i < self->rules->len; i++) {
+            guint j;
+
+            for (j = 0; j < self->compiled[i].n_conditions; j++)
+                g_free (self->compiled[i].conditions[j].prefix_match);
+            g_free (self->compiled[i].conditions);
+        }
+        g_hash_table_unref (self->programs);
+        g_free (self->buckets);
+        g_free (self->compiled);
+        g_array_unref (self->rules);
+        g_slice_free (MMUdevRulesIndex, self);
+    }
+}
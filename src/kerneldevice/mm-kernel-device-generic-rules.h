@@ -14,6 +14,7 @@
  */
 
 #include <glib.h>
+#include <glib-object.h>
 
 G_BEGIN_DECLS
 
@@ -59,4 +60,109 @@ typedef struct {
 GArray *mm_kernel_device_generic_rules_load (const gchar  *rules_dir,
                                              GError      **error);
 
+/*****************************************************************************/
+/* Compiled rules
+ *
+ * The list of rules loaded from the rule files is compiled into an index,
+ * where all conditions are pre-parsed and the GOTO targets are resolved
+ * beforehand. Rules are also bucketed by the VID, PID and SUBSYSTEM values
+ * they require, so that evaluating the rules for a given device only walks
+ * the subset of rules that may actually apply to it. The programs for each
+ * bucket are built on demand and kept in the index.
+ */
+
+typedef enum {
+    MM_UDEV_RULE_CONDITION_TYPE_SUBSYSTEM,
+    MM_UDEV_RULE_CONDITION_TYPE_SUBSYSTEMS,
+    MM_UDEV_RULE_CONDITION_TYPE_DRIVER,
+    MM_UDEV_RULE_CONDITION_TYPE_DRIVERS,
+    MM_UDEV_RULE_CONDITION_TYPE_KERNEL,
+    MM_UDEV_RULE_CONDITION_TYPE_DEVPATH,
+    MM_UDEV_RULE_CONDITION_TYPE_VID,
+    MM_UDEV_RULE_CONDITION_TYPE_PID,
+    MM_UDEV_RULE_CONDITION_TYPE_SUBSYSTEM_VID,
+    MM_UDEV_RULE_CONDITION_TYPE_MANUFACTURER,
+    MM_UDEV_RULE_CONDITION_TYPE_PRODUCT,
+    MM_UDEV_RULE_CONDITION_TYPE_INTERFACE_CLASS,
+    MM_UDEV_RULE_CONDITION_TYPE_INTERFACE_SUBCLASS,
+    MM_UDEV_RULE_CONDITION_TYPE_INTERFACE_PROTOCOL,
+    MM_UDEV_RULE_CONDITION_TYPE_INTERFACE_NUMBER,
+    MM_UDEV_RULE_CONDITION_TYPE_ATTRIBUTE,
+    MM_UDEV_RULE_CONDITION_TYPE_PROPERTY,
+} MMUdevRuleConditionType;
+
+typedef struct {
+    MMUdevRuleConditionType  type;
+    /* TRUE for '==', FALSE for '!=' */
+    gboolean                 equal;
+    /* Value to match, as given in the rule */
+    const gchar             *value;
+    /* Interned attribute or property name */
+    const gchar             *name;
+    /* Whether the attribute is looked for in the parent devices (ATTRS) */
+    gboolean                 iterate;
+    /* Numeric value, for VID/PID and interface checks */
+    guint                    number;
+    /* Implicit prefix match, for DEVPATH checks */
+    gchar                   *prefix_match;
+} MMUdevRuleCondition;
+
+typedef enum {
+    MM_UDEV_RULE_VALUE_SOURCE_STATIC,
+    MM_UDEV_RULE_VALUE_SOURCE_INTERFACE_CLASS,
+    MM_UDEV_RULE_VALUE_SOURCE_INTERFACE_SUBCLASS,
+    MM_UDEV_RULE_VALUE_SOURCE_INTERFACE_PROTOCOL,
+    MM_UDEV_RULE_VALUE_SOURCE_INTERFACE_NUMBER,
+} MMUdevRuleValueSource;
+
+typedef struct {
+    /* Index of the rule in the list of rules */
+    guint                  index;
+    /* Conditions still to check once the bucket has been selected */
+    MMUdevRuleCondition   *conditions;
+    guint                  n_conditions;
+    /* Either a PROPERTY or a GOTO_INDEX result */
+    MMUdevRuleResultType   type;
+    const gchar           *property_name;
+    const gchar           *property_value;
+    MMUdevRuleValueSource  property_value_source;
+} MMUdevCompiledRule;
+
+typedef struct {
+    const MMUdevCompiledRule *rule;
+    /* For GOTO rules, the step to continue from */
+    guint                     goto_step;
+} MMUdevRuleStep;
+
+typedef struct {
+    MMUdevRuleStep *steps;
+    guint           n_steps;
+} MMUdevRuleProgram;
+
+typedef struct _MMUdevRulesIndex MMUdevRulesIndex;
+
+#define MM_TYPE_UDEV_RULES_INDEX (mm_udev_rules_index_get_type ())
+GType mm_udev_rules_index_get_type (void);
+
+MMUdevRulesIndex        *mm_udev_rules_index_new            (GArray           *rules);
+MMUdevRulesIndex        *mm_udev_rules_index_ref            (MMUdevRulesIndex *self);
+void                     mm_udev_rules_index_unref          (MMUdevRulesIndex *self);
+guint                    mm_udev_rules_index_get_n_rules    (MMUdevRulesIndex *self);
+const MMUdevRuleProgram *mm_udev_rules_index_lookup_program (MMUdevRulesIndex *self,
+                                                             guint16           vid,
+                                                             guint16           pid,
+                                                             const gchar      *subsystem);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (MMUdevRulesIndex, mm_udev_rules_index_unref)
+
+typedef gboolean (* MMUdevRuleConditionFunc) (const MMUdevRuleCondition *condition,
+                                              gpointer                   user_data);
+typedef void     (* MMUdevRulePropertyFunc)  (const MMUdevCompiledRule  *rule,
+                                              gpointer                   user_data);
+
+void mm_udev_rule_program_run (const MMUdevRuleProgram *program,
+                               MMUdevRuleConditionFunc  check_condition,
+                               MMUdevRulePropertyFunc   set_property,
+                               gpointer                 user_data);
+
 G_END_DECLS
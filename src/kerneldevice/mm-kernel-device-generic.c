@@ -42,7 +42,7 @@ G_DEFINE_TYPE_EXTENDED (MMKernelDeviceGeneric, mm_kernel_device_generic,  MM_TYP
 enum {
     PROP_0,
     PROP_PROPERTIES,
-    PROP_RULES,
+    PROP_RULES_INDEX,
     PROP_LAST
 };
 
@@ -51,8 +51,13 @@ static GParamSpec *properties[PROP_LAST];
 struct _MMKernelDeviceGenericPrivate {
     /* Input properties */
     MMKernelEventProperties *properties;
-    /* Rules to apply */
-    GArray *rules;
+    /* Compiled rules to apply */
+    MMUdevRulesIndex *rules_index;
+
+    /* Properties preloaded or set by the rules, indexed by interned name */
+    GHashTable *device_properties;
+    /* Attributes read on request */
+    GHashTable *attributes;
 
     /* Contents from sysfs */
     gchar  **drivers;
@@ -160,6 +165,14 @@ lookup_sysfs_attribute_as_string (MMKernelDeviceGeneric *self,
     return NULL;
 }
 
+static void
+set_device_property (MMKernelDeviceGeneric *self,
+                     const gchar           *property,
+                     gchar                 *value)
+{
+    g_hash_table_replace (self->priv->device_properties, (gpointer) g_intern_string (property), value);
+}
+
 /*****************************************************************************/
 /* Load contents */
 
@@ -195,7 +208,7 @@ preload_sysfs_path (MMKernelDeviceGeneric *self)
         devpath = (g_str_has_prefix (self->priv->sysfs_path, "/sys") ?
                    &self->priv->sysfs_path[4] :
                    self->priv->sysfs_path);
-        g_object_set_data_full (G_OBJECT (self), "DEVPATH", g_strdup (devpath), g_free);
+        set_device_property (self, "DEVPATH", g_strdup (devpath));
     }
 }
 
@@ -206,26 +219,26 @@ preload_common_properties (MMKernelDeviceGeneric *self)
 {
     if (self->priv->interface_sysfs_path) {
         mm_obj_dbg (self, "  ID_USB_INTERFACE_NUM: 0x%02x", self->priv->interface_number);
-        g_object_set_data_full (G_OBJECT (self), "ID_USB_INTERFACE_NUM", g_strdup_printf ("%02x", self->priv->interface_number), g_free);
+        set_device_property (self, "ID_USB_INTERFACE_NUM", g_strdup_printf ("%02x", self->priv->interface_number));
     }
 
     if (self->priv->physdev_product) {
         mm_obj_dbg (self, "  ID_MODEL: %s", self->priv->physdev_product);
-        g_object_set_data_full (G_OBJECT (self), "ID_MODEL", g_strdup (self->priv->physdev_product), g_free);
+        set_device_property (self, "ID_MODEL", g_strdup (self->priv->physdev_product));
     }
 
     if (self->priv->physdev_manufacturer) {
         mm_obj_dbg (self, "  ID_VENDOR: %s", self->priv->physdev_manufacturer);
-        g_object_set_data_full (G_OBJECT (self), "ID_VENDOR", g_strdup (self->priv->physdev_manufacturer), g_free);
+        set_device_property (self, "ID_VENDOR", g_strdup (self->priv->physdev_manufacturer));
     }
 
     if (self->priv->physdev_sysfs_path) {
         mm_obj_dbg (self, "  ID_VENDOR_ID: 0x%04x", self->priv->physdev_vid);
-        g_object_set_data_full (G_OBJECT (self), "ID_VENDOR_ID", g_strdup_printf ("%04x", self->priv->physdev_vid), g_free);
+        set_device_property (self, "ID_VENDOR_ID", g_strdup_printf ("%04x", self->priv->physdev_vid));
         mm_obj_dbg (self, "  ID_MODEL_ID: 0x%04x", self->priv->physdev_pid);
-        g_object_set_data_full (G_OBJECT (self), "ID_MODEL_ID", g_strdup_printf ("%04x", self->priv->physdev_pid), g_free);
+        set_device_property (self, "ID_MODEL_ID", g_strdup_printf ("%04x", self->priv->physdev_pid));
         mm_obj_dbg (self, "  ID_REVISION: 0x%04x", self->priv->physdev_revision);
-        g_object_set_data_full (G_OBJECT (self), "ID_REVISION", g_strdup_printf ("%04x", self->priv->physdev_revision), g_free);
+        set_device_property (self, "ID_REVISION", g_strdup_printf ("%04x", self->priv->physdev_revision));
     }
 }
 
@@ -750,234 +763,143 @@ kernel_device_cmp (MMKernelDevice *a,
 /*****************************************************************************/
 
 static gboolean
-check_condition (MMKernelDeviceGeneric *self,
-                 MMUdevRuleMatch       *match)
+check_condition (const MMUdevRuleCondition *condition,
+                 MMKernelDeviceGeneric     *self)
 {
-    gboolean condition_equal;
-
-    condition_equal = (match->type == MM_UDEV_RULE_MATCH_TYPE_EQUAL);
-
-    /* We only apply 'add' rules */
-    if (g_str_equal (match->parameter, "ACTION"))
-        return ((!!strstr (match->value, "add")) == condition_equal);
-
-    /* Exact SUBSYSTEM match */
-    if (g_str_equal (match->parameter, "SUBSYSTEM"))
-        return ((self->priv->subsystems && !g_strcmp0 (self->priv->subsystems[0], match->value)) == condition_equal);
+    switch (condition->type) {
+    /* Exact SUBSYSTEM match; the positive match is already resolved by the
+     * rules index */
+    case MM_UDEV_RULE_CONDITION_TYPE_SUBSYSTEM:
+        return ((self->priv->subsystems && !g_strcmp0 (self->priv->subsystems[0], condition->value)) == condition->equal);
 
     /* Loose SUBSYSTEMS match */
-    if (g_str_equal (match->parameter, "SUBSYSTEMS"))
-        return ((self->priv->subsystems && g_strv_contains ((const gchar * const *) self->priv->subsystems, match->value)) == condition_equal);
+    case MM_UDEV_RULE_CONDITION_TYPE_SUBSYSTEMS:
+        return ((self->priv->subsystems && g_strv_contains ((const gchar * const *) self->priv->subsystems, condition->value)) == condition->equal);
 
     /* Exact DRIVER match */
-    if (g_str_equal (match->parameter, "DRIVER"))
-        return ((self->priv->drivers && !g_strcmp0 (self->priv->drivers[0], match->value)) == condition_equal);
+    case MM_UDEV_RULE_CONDITION_TYPE_DRIVER:
+        return ((self->priv->drivers && !g_strcmp0 (self->priv->drivers[0], condition->value)) == condition->equal);
 
     /* Loose DRIVERS match */
-    if (g_str_equal (match->parameter, "DRIVERS"))
-        return ((self->priv->drivers && g_strv_contains ((const gchar * const *) self->priv->drivers, match->value)) == condition_equal);
+    case MM_UDEV_RULE_CONDITION_TYPE_DRIVERS:
+        return ((self->priv->drivers && g_strv_contains ((const gchar * const *) self->priv->drivers, condition->value)) == condition->equal);
 
     /* Device name checks */
-    if (g_str_equal (match->parameter, "KERNEL"))
-        return (mm_kernel_device_generic_string_match (mm_kernel_device_get_name (MM_KERNEL_DEVICE (self)), match->value, self) == condition_equal);
+    case MM_UDEV_RULE_CONDITION_TYPE_KERNEL:
+        return (mm_kernel_device_generic_string_match (mm_kernel_device_get_name (MM_KERNEL_DEVICE (self)), condition->value, self) == condition->equal);
 
     /* Device sysfs path checks; we allow both a direct match and a prefix patch */
-    if (g_str_equal (match->parameter, "DEVPATH")) {
-        g_autofree gchar *prefix_match = NULL;
-
+    case MM_UDEV_RULE_CONDITION_TYPE_DEVPATH:
         /* If sysfs path invalid (e.g. path doesn't exist), no match */
         if (!self->priv->sysfs_path)
             return FALSE;
 
-        /* If not already doing a prefix match, do an implicit one. This is so that
-         * we can add properties to the usb_device owning all ports, and then apply
-         * the property to all ports individually processed here. */
-        if (match->value[0] && match->value[strlen (match->value) - 1] != '*')
-            prefix_match = g_strdup_printf ("%s/*", match->value);
-
-        if ((mm_kernel_device_generic_string_match (self->priv->sysfs_path, match->value, self) == condition_equal) ||
-            (prefix_match && mm_kernel_device_generic_string_match (self->priv->sysfs_path, prefix_match, self) == condition_equal))
+        if ((mm_kernel_device_generic_string_match (self->priv->sysfs_path, condition->value, self) == condition->equal) ||
+            (condition->prefix_match && mm_kernel_device_generic_string_match (self->priv->sysfs_path, condition->prefix_match, self) == condition->equal))
             return TRUE;
 
         if (g_str_has_prefix (self->priv->sysfs_path, "/sys")) {
-            if ((mm_kernel_device_generic_string_match (&self->priv->sysfs_path[4], match->value, self) == condition_equal) ||
-                (prefix_match && mm_kernel_device_generic_string_match (&self->priv->sysfs_path[4], prefix_match, self) == condition_equal))
+            if ((mm_kernel_device_generic_string_match (&self->priv->sysfs_path[4], condition->value, self) == condition->equal) ||
+                (condition->prefix_match && mm_kernel_device_generic_string_match (&self->priv->sysfs_path[4], condition->prefix_match, self) == condition->equal))
                 return TRUE;
         }
         return FALSE;
-    }
 
-    /* Attributes checks */
-    if (g_str_has_prefix (match->parameter, "ATTR")) {
-        gchar    *attribute;
-        gchar    *contents = NULL;
-        gboolean  result = FALSE;
-        guint     val;
-
-        attribute = g_strdup (&match->parameter[5]);
-        g_strdelimit (attribute, "{}", ' ');
-        g_strstrip (attribute);
-
-        /* VID/PID/SUBSYSTEM VID directly from our API */
-        if (g_str_equal (attribute, "idVendor") || g_str_equal (attribute, "vendor"))
-            result = ((mm_get_uint_from_hex_str (match->value, &val)) &&
-                      ((mm_kernel_device_get_physdev_vid (MM_KERNEL_DEVICE (self)) == val) == condition_equal));
-        else if (g_str_equal (attribute, "idProduct") || g_str_equal (attribute, "device"))
-            result = ((mm_get_uint_from_hex_str (match->value, &val)) &&
-                      ((mm_kernel_device_get_physdev_pid (MM_KERNEL_DEVICE (self)) == val) == condition_equal));
-        else if (g_str_equal (attribute, "subsystem_vendor"))
-            result = ((mm_get_uint_from_hex_str (match->value, &val)) &&
-                      ((mm_kernel_device_get_physdev_subsystem_vid (MM_KERNEL_DEVICE (self)) == val) == condition_equal));
-        /* manufacturer in the physdev */
-        else if (g_str_equal (attribute, "manufacturer"))
-            result = ((self->priv->physdev_manufacturer && g_str_equal (self->priv->physdev_manufacturer, match->value)) == condition_equal);
-        /* product in the physdev */
-        else if (g_str_equal (attribute, "product"))
-            result = ((self->priv->physdev_product && g_str_equal (self->priv->physdev_product, match->value)) == condition_equal);
-        /* interface class/subclass/protocol/number in the interface */
-        else if (g_str_equal (attribute, "bInterfaceClass"))
-            result = (g_str_equal (match->value, "?*") || ((mm_get_uint_from_hex_str (match->value, &val)) &&
-                                                           ((self->priv->interface_class == val) == condition_equal)));
-        else if (g_str_equal (attribute, "bInterfaceSubClass"))
-            result = (g_str_equal (match->value, "?*") || ((mm_get_uint_from_hex_str (match->value, &val)) &&
-                                                           ((self->priv->interface_subclass == val) == condition_equal)));
-        else if (g_str_equal (attribute, "bInterfaceProtocol"))
-            result = (g_str_equal (match->value, "?*") || ((mm_get_uint_from_hex_str (match->value, &val)) &&
-                                                           ((self->priv->interface_protocol == val) == condition_equal)));
-        else if (g_str_equal (attribute, "bInterfaceNumber"))
-            result = (g_str_equal (match->value, "?*") || ((mm_get_uint_from_hex_str (match->value, &val)) &&
-                                                           ((self->priv->interface_number == val) == condition_equal)));
-        else {
-            g_autofree gchar *found_value = NULL;
-
-            found_value = lookup_sysfs_attribute_as_string (self, attribute, g_str_has_prefix (match->parameter, "ATTRS"));
-            result = ((found_value && g_str_equal (found_value, match->value)) == condition_equal);
-        }
-
-        g_free (contents);
-        g_free (attribute);
-        return result;
+    /* VID/PID/SUBSYSTEM VID directly from our API; the positive VID/PID
+     * matches are already resolved by the rules index */
+    case MM_UDEV_RULE_CONDITION_TYPE_VID:
+        return ((mm_kernel_device_get_physdev_vid (MM_KERNEL_DEVICE (self)) == condition->number) == condition->equal);
+    case MM_UDEV_RULE_CONDITION_TYPE_PID:
+        return ((mm_kernel_device_get_physdev_pid (MM_KERNEL_DEVICE (self)) == condition->number) == condition->equal);
+    case MM_UDEV_RULE_CONDITION_TYPE_SUBSYSTEM_VID:
+        return ((mm_kernel_device_get_physdev_subsystem_vid (MM_KERNEL_DEVICE (self)) == condition->number) == condition->equal);
+
+    /* manufacturer and product in the physdev */
+    case MM_UDEV_RULE_CONDITION_TYPE_MANUFACTURER:
+        return ((self->priv->physdev_manufacturer && g_str_equal (self->priv->physdev_manufacturer, condition->value)) == condition->equal);
+    case MM_UDEV_RULE_CONDITION_TYPE_PRODUCT:
+        return ((self->priv->physdev_product && g_str_equal (self->priv->physdev_product, condition->value)) == condition->equal);
+
+    /* interface class/subclass/protocol/number in the interface */
+    case MM_UDEV_RULE_CONDITION_TYPE_INTERFACE_CLASS:
+        return ((self->priv->interface_class == condition->number) == condition->equal);
+    case MM_UDEV_RULE_CONDITION_TYPE_INTERFACE_SUBCLASS:
+        return ((self->priv->interface_subclass == condition->number) == condition->equal);
+    case MM_UDEV_RULE_CONDITION_TYPE_INTERFACE_PROTOCOL:
+        return ((self->priv->interface_protocol == condition->number) == condition->equal);
+    case MM_UDEV_RULE_CONDITION_TYPE_INTERFACE_NUMBER:
+        return ((self->priv->interface_number == condition->number) == condition->equal);
+
+    /* Other attributes from sysfs */
+    case MM_UDEV_RULE_CONDITION_TYPE_ATTRIBUTE: {
+        g_autofree gchar *found_value = NULL;
+
+        found_value = lookup_sysfs_attribute_as_string (self, condition->name, condition->iterate);
+        return ((found_value && g_str_equal (found_value, condition->value)) == condition->equal);
     }
 
     /* Previously set property checks */
-    if (g_str_has_prefix (match->parameter, "ENV")) {
-        gchar    *property;
-        gboolean  result = FALSE;
-
-        property = g_strdup (&match->parameter[3]);
-        g_strdelimit (property, "{}", ' ');
-        g_strstrip (property);
-
-        result = ((!g_strcmp0 ((const gchar *) g_object_get_data (G_OBJECT (self), property), match->value)) == condition_equal);
+    case MM_UDEV_RULE_CONDITION_TYPE_PROPERTY:
+        return ((!g_strcmp0 (g_hash_table_lookup (self->priv->device_properties, condition->name), condition->value)) == condition->equal);
 
-        g_free (property);
-        return result;
+    default:
+        g_assert_not_reached ();
     }
-
-    mm_obj_warn (self, "unknown match condition parameter: %s", match->parameter);
-    return FALSE;
 }
 
-static guint
-check_rule (MMKernelDeviceGeneric *self,
-            guint                  rule_i)
+static void
+apply_rule (const MMUdevCompiledRule *rule,
+            MMKernelDeviceGeneric    *self)
 {
-    MMUdevRule *rule;
-    gboolean    apply = TRUE;
-
-    g_assert (rule_i < self->priv->rules->len);
-
-    rule = &g_array_index (self->priv->rules, MMUdevRule, rule_i);
-    if (rule->conditions) {
-        guint condition_i;
-
-        for (condition_i = 0; condition_i < rule->conditions->len; condition_i++) {
-            MMUdevRuleMatch *match;
-
-            match = &g_array_index (rule->conditions, MMUdevRuleMatch, condition_i);
-            if (!check_condition (self, match)) {
-                apply = FALSE;
-                break;
-            }
-        }
-    }
-
-    if (apply) {
-        switch (rule->result.type) {
-        case MM_UDEV_RULE_RESULT_TYPE_PROPERTY: {
-            gchar *property_value_read = NULL;
-
-            if (g_str_equal (rule->result.content.property.value, "$attr{bInterfaceClass}"))
-                property_value_read = g_strdup_printf ("%02x", self->priv->interface_class);
-            else if (g_str_equal (rule->result.content.property.value, "$attr{bInterfaceSubClass}"))
-                property_value_read = g_strdup_printf ("%02x", self->priv->interface_subclass);
-            else if (g_str_equal (rule->result.content.property.value, "$attr{bInterfaceProtocol}"))
-                property_value_read = g_strdup_printf ("%02x", self->priv->interface_protocol);
-            else if (g_str_equal (rule->result.content.property.value, "$attr{bInterfaceNumber}"))
-                property_value_read = g_strdup_printf ("%02x", self->priv->interface_number);
-
-            /* add new property */
-            mm_obj_dbg (self, "property added: %s=%s",
-                        rule->result.content.property.name,
-                        property_value_read ? property_value_read : rule->result.content.property.value);
-
-            if (!property_value_read)
-                /* NOTE: we keep a reference to the list of rules ourselves, so it isn't
-                 * an issue if we re-use the same string (i.e. without g_strdup-ing it)
-                 * as a property value. */
-                g_object_set_data (G_OBJECT (self),
-                                   rule->result.content.property.name,
-                                   rule->result.content.property.value);
-            else
-                g_object_set_data_full (G_OBJECT (self),
-                                        rule->result.content.property.name,
-                                        property_value_read,
-                                        g_free);
-            break;
-        }
-
-        case MM_UDEV_RULE_RESULT_TYPE_LABEL:
-            /* noop */
-            break;
+    gchar *value;
 
-        case MM_UDEV_RULE_RESULT_TYPE_GOTO_INDEX:
-            /* Jump to a new index */
-            return rule->result.content.index;
-
-        case MM_UDEV_RULE_RESULT_TYPE_GOTO_TAG:
-        case MM_UDEV_RULE_RESULT_TYPE_UNKNOWN:
-        default:
-            g_assert_not_reached ();
-        }
+    switch (rule->property_value_source) {
+    case MM_UDEV_RULE_VALUE_SOURCE_INTERFACE_CLASS:
+        value = g_strdup_printf ("%02x", self->priv->interface_class);
+        break;
+    case MM_UDEV_RULE_VALUE_SOURCE_INTERFACE_SUBCLASS:
+        value = g_strdup_printf ("%02x", self->priv->interface_subclass);
+        break;
+    case MM_UDEV_RULE_VALUE_SOURCE_INTERFACE_PROTOCOL:
+        value = g_strdup_printf ("%02x", self->priv->interface_protocol);
+        break;
+    case MM_UDEV_RULE_VALUE_SOURCE_INTERFACE_NUMBER:
+        value = g_strdup_printf ("%02x", self->priv->interface_number);
+        break;
+    case MM_UDEV_RULE_VALUE_SOURCE_STATIC:
+    default:
+        value = g_strdup (rule->property_value);
+        break;
     }
 
-    /* Go to the next rule */
-    return rule_i + 1;
+    /* add new property */
+    mm_obj_dbg (self, "property added: %s=%s", rule->property_name, value);
+    g_hash_table_replace (self->priv->device_properties, (gpointer) rule->property_name, value);
 }
 
 static void
 preload_rule_properties (MMKernelDeviceGeneric *self)
 {
-    guint i;
-
-    g_assert (self->priv->rules);
-    g_assert (self->priv->rules->len > 0);
-
-    /* Start to process rules */
-    i = 0;
-    while (i < self->priv->rules->len) {
-        guint next_rule;
-
-        next_rule = check_rule (self, i);
-        i = next_rule;
-    }
+    const MMUdevRuleProgram *program;
+
+    g_assert (self->priv->rules_index);
+
+    /* Only the rules that may apply to this VID/PID/SUBSYSTEM are run */
+    program = mm_udev_rules_index_lookup_program (self->priv->rules_index,
+                                                  mm_kernel_device_get_physdev_vid (MM_KERNEL_DEVICE (self)),
+                                                  mm_kernel_device_get_physdev_pid (MM_KERNEL_DEVICE (self)),
+                                                  self->priv->subsystems ? self->priv->subsystems[0] : NULL);
+    mm_udev_rule_program_run (program,
+                              (MMUdevRuleConditionFunc) check_condition,
+                              (MMUdevRulePropertyFunc) apply_rule,
+                              self);
 }
 
 static void
 check_preload (MMKernelDeviceGeneric *self)
 {
     /* Only preload when properties and rules are set */
-    if (!self->priv->properties || !self->priv->rules)
+    if (!self->priv->properties || !self->priv->rules_index)
         return;
 
     /* Don't preload on "remove" actions, where we don't have the device any more */
@@ -997,24 +919,18 @@ static gboolean
 kernel_device_has_property (MMKernelDevice *self,
                             const gchar    *property)
 {
-    return !!g_object_get_data (G_OBJECT (self), property);
+    return g_hash_table_contains (MM_KERNEL_DEVICE_GENERIC (self)->priv->device_properties, property);
 }
 
 static const gchar *
 kernel_device_get_property (MMKernelDevice *self,
                             const gchar    *property)
 {
-    return g_object_get_data (G_OBJECT (self), property);
+    return g_hash_table_lookup (MM_KERNEL_DEVICE_GENERIC (self)->priv->device_properties, property);
 }
 
 /*****************************************************************************/
 
-static gchar *
-build_attribute_data_key (const gchar *attribute)
-{
-    return g_strdup_printf ("ATTR:%s", attribute);
-}
-
 static gboolean
 kernel_device_has_attribute (MMKernelDevice *self,
                              const gchar    *attribute)
@@ -1027,52 +943,65 @@ kernel_device_get_attribute (MMKernelDevice *_self,
                              const gchar    *attribute)
 {
     MMKernelDeviceGeneric *self;
-    g_autofree gchar      *key = NULL;
     gchar                 *value = NULL;
 
     self = MM_KERNEL_DEVICE_GENERIC (_self);
 
-    key = build_attribute_data_key (attribute);
-    value = g_object_get_data (G_OBJECT (self), key);
+    value = g_hash_table_lookup (self->priv->attributes, attribute);
     if (!value) {
         value = read_sysfs_attribute_as_string (self->priv->sysfs_path, attribute);
         if (value)
-            g_object_set_data_full (G_OBJECT (self), key, value, g_free);
+            g_hash_table_insert (self->priv->attributes, g_strdup (attribute), value);
     }
     return (const gchar *) value;
 }
 
 /*****************************************************************************/
 
+static MMKernelDevice *
+kernel_device_generic_new_with_rules_index (MMKernelEventProperties  *props,
+                                            MMUdevRulesIndex         *rules_index,
+                                            GError                  **error)
+{
+    return MM_KERNEL_DEVICE (g_initable_new (MM_TYPE_KERNEL_DEVICE_GENERIC,
+                                             NULL,
+                                             error,
+                                             "properties",  props,
+                                             "rules-index", rules_index,
+                                             NULL));
+}
+
 MMKernelDevice *
 mm_kernel_device_generic_new_with_rules (MMKernelEventProperties  *props,
                                          GArray                   *rules,
                                          GError                  **error)
 {
+    g_autoptr(MMUdevRulesIndex) rules_index = NULL;
+
     /* Note: we allow NULL rules, e.g. for virtual devices */
+    if (rules)
+        rules_index = mm_udev_rules_index_new (rules);
 
-    return MM_KERNEL_DEVICE (g_initable_new (MM_TYPE_KERNEL_DEVICE_GENERIC,
-                                             NULL,
-                                             error,
-                                             "properties", props,
-                                             "rules",      rules,
-                                             NULL));
+    return kernel_device_generic_new_with_rules_index (props, rules_index, error);
 }
 
 MMKernelDevice *
 mm_kernel_device_generic_new (MMKernelEventProperties  *props,
                               GError                  **error)
 {
-    static GArray *rules = NULL;
+    static MMUdevRulesIndex *rules_index = NULL;
+
+    /* We only try to load and compile the default list of rules once */
+    if (G_UNLIKELY (!rules_index)) {
+        g_autoptr(GArray) rules = NULL;
 
-    /* We only try to load the default list of rules once */
-    if (G_UNLIKELY (!rules)) {
         rules = mm_kernel_device_generic_rules_load (UDEVRULESDIR, error);
         if (!rules)
             return NULL;
+        rules_index = mm_udev_rules_index_new (rules);
     }
 
-    return mm_kernel_device_generic_new_with_rules (props, rules, error);
+    return kernel_device_generic_new_with_rules_index (props, rules_index, error);
 }
 
 /*****************************************************************************/
@@ -1082,6 +1011,10 @@ mm_kernel_device_generic_init (MMKernelDeviceGeneric *self)
 {
     /* Initialize private data */
     self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self, MM_TYPE_KERNEL_DEVICE_GENERIC, MMKernelDeviceGenericPrivate);
+
+    /* Property names are interned, so no need to free them */
+    self->priv->device_properties = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+    self->priv->attributes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 }
 
 static void
@@ -1097,9 +1030,9 @@ set_property (GObject      *object,
         g_assert (!self->priv->properties);
         self->priv->properties = g_value_dup_object (value);
         break;
-    case PROP_RULES:
-        g_assert (!self->priv->rules);
-        self->priv->rules = g_value_dup_boxed (value);
+    case PROP_RULES_INDEX:
+        g_assert (!self->priv->rules_index);
+        self->priv->rules_index = g_value_dup_boxed (value);
         break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -1119,8 +1052,8 @@ get_property (GObject    *object,
     case PROP_PROPERTIES:
         g_value_set_object (value, self->priv->properties);
         break;
-    case PROP_RULES:
-        g_value_set_boxed (value, self->priv->rules);
+    case PROP_RULES_INDEX:
+        g_value_set_boxed (value, self->priv->rules_index);
         break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -1182,7 +1115,9 @@ dispose (GObject *object)
     g_clear_pointer (&self->priv->sysfs_path,            g_free);
     g_clear_pointer (&self->priv->drivers,               g_strfreev);
     g_clear_pointer (&self->priv->subsystems,            g_strfreev);
-    g_clear_pointer (&self->priv->rules,                 g_array_unref);
+    g_clear_pointer (&self->priv->rules_index,           mm_udev_rules_index_unref);
+    g_clear_pointer (&self->priv->device_properties,     g_hash_table_unref);
+    g_clear_pointer (&self->priv->attributes,            g_hash_table_unref);
     g_clear_object  (&self->priv->properties);
 
     G_OBJECT_CLASS (mm_kernel_device_generic_parent_class)->dispose (object);
@@ -1244,11 +1179,11 @@ mm_kernel_device_generic_class_init (MMKernelDeviceGenericClass *klass)
                              G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY);
     g_object_class_install_property (object_class, PROP_PROPERTIES, properties[PROP_PROPERTIES]);
 
-    properties[PROP_RULES] =
-        g_param_spec_boxed ("rules",
-                            "Rules",
-                            "List of rules to apply",
-                            G_TYPE_ARRAY,
+    properties[PROP_RULES_INDEX] =
+        g_param_spec_boxed ("rules-index",
+                            "Rules index",
+                            "Compiled list of rules to apply",
+                            MM_TYPE_UDEV_RULES_INDEX,
                             G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY);
-    g_object_class_install_property (object_class, PROP_RULES, properties[PROP_RULES]);
+    g_object_class_install_property (object_class, PROP_RULES_INDEX, properties[PROP_RULES_INDEX]);
 }
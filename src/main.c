@@ -30,6 +30,7 @@
 #include "mm-log.h"
 #include "mm-base-manager.h"
 #include "mm-context.h"
+#include "mm-port-trace.h"
 
 #if defined WITH_SUSPEND_RESUME
 # include "mm-sleep-monitor.h"
@@ -184,6 +185,7 @@ main (int argc, char *argv[])
                        mm_context_get_log_timestamps (),
                        mm_context_get_log_relative_timestamps (),
                        mm_context_get_log_personal_info (),
+                       mm_context_get_log_async (),
                        &error)) {
         g_printerr ("error: failed to set up logging: %s\n", error->message);
         g_error_free (error);
@@ -202,6 +204,15 @@ main (int argc, char *argv[])
     /* Detect runtime charset conversion support */
     mm_modem_charsets_init ();
 
+    /* Capture port traffic if requested */
+    if (mm_context_get_trace_file ()) {
+        if (!mm_port_trace_open (mm_context_get_trace_file (), &error)) {
+            mm_warn ("couldn't enable port traffic capture: %s", error->message);
+            g_clear_error (&error);
+        } else
+            mm_msg ("capturing port traffic in %s", mm_context_get_trace_file ());
+    }
+
     /* Acquire name, don't allow replacement */
     name_id = g_bus_own_name (mm_context_get_test_session () ? G_BUS_TYPE_SESSION : G_BUS_TYPE_SYSTEM,
                               MM_DBUS_SERVICE,
@@ -269,6 +280,8 @@ main (int argc, char *argv[])
 
     g_bus_unown_name (name_id);
 
+    mm_port_trace_close ();
+
     mm_msg ("ModemManager is shut down");
 
     mm_log_shutdown ();
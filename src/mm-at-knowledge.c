@@ -0,0 +1,557 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <string.h>
+
+#include <ModemManager.h>
+#include "mm-errors-types.h"
+#include "mm-context.h"
+#include "mm-utils.h"
+#include "mm-log-object.h"
+#include "mm-keyfile-store.h"
+#include "mm-at-knowledge.h"
+
+#define KEY_FIRMWARE_REVISION "firmware-revision"
+#define KEY_SUPPORTED         "supported"
+#define KEY_FAILURES          "failures"
+#define KEY_UNSUPPORTED_SINCE "unsupported-since"
+#define KEY_SAMPLES           "samples"
+#define KEY_MAX_LATENCY       "max-latency-ms"
+
+/* Consecutive 'not supported' errors before a command is flagged as
+ * unsupported */
+#define UNSUPPORTED_FAILURES 3
+
+/* Commands flagged as unsupported are tried again after this time, in
+ * seconds, in case the device state (e.g. its configuration) changed */
+#define UNSUPPORTED_EXPIRY_DEFAULT (7 * 24 * 60 * 60)
+
+/* Replies needed before the timeout is adapted, and the limits of the
+ * adapted timeout, in seconds. Only commands with a short timeout are
+ * adapted, and never below a fraction of the requested timeout. */
+#define ADAPTIVE_TIMEOUT_MIN_SAMPLES 5
+#define ADAPTIVE_TIMEOUT_MIN         3
+#define ADAPTIVE_TIMEOUT_FACTOR      2
+#define ADAPTIVE_TIMEOUT_MAX_STATIC  10
+#define ADAPTIVE_TIMEOUT_MIN_DIVISOR 2
+
+/* Changes are written out at most every few seconds */
+#define SAVE_TIMEOUT 5
+
+static void log_object_iface_init (MMLogObjectInterface *iface);
+
+struct _MMAtKnowledge {
+    GObject         parent;
+    gchar          *path;
+    guint           unsupported_expiry;
+    MMKeyfileStore *store;
+    GKeyFile       *keyfile;
+};
+
+struct _MMAtKnowledgeClass {
+    GObjectClass parent;
+};
+
+G_DEFINE_TYPE_EXTENDED (MMAtKnowledge, mm_at_knowledge, G_TYPE_OBJECT, 0,
+                        G_IMPLEMENT_INTERFACE (MM_TYPE_LOG_OBJECT, log_object_iface_init))
+
+enum {
+    PROP_0,
+    PROP_PATH,
+    PROP_UNSUPPORTED_EXPIRY,
+    PROP_LAST
+};
+
+static GParamSpec *properties[PROP_LAST];
+
+/*****************************************************************************/
+
+static gchar *
+log_object_build_id (MMLogObject *_self)
+{
+    return g_strdup ("at-knowledge");
+}
+
+/*****************************************************************************/
+
+static gchar *
+build_command_key (const gchar *command)
+{
+    const gchar *body;
+    const gchar *name_end;
+
+    body = (g_ascii_strncasecmp (command, "AT", 2) == 0) ? command + 2 : command;
+
+    /* Only extended commands, standard or vendor specific */
+    if (!body[0] || !strchr ("+^$%*#!@_", body[0]))
+        return NULL;
+
+    for (name_end = body + 1; g_ascii_isalnum (*name_end); name_end++);
+    if (name_end == body + 1)
+        return NULL;
+
+    /* Execute, read and test forms only; commands with arguments are not
+     * tracked */
+    if (*name_end && !g_str_equal (name_end, "?") && !g_str_equal (name_end, "=?"))
+        return NULL;
+
+    return g_ascii_strup (body, -1);
+}
+
+/* Commands whose reply time depends on the network (or on the radio
+ * state), so their latency history says nothing about the next one */
+static const gchar *network_commands[] = {
+    "+CFUN",
+    "+CGACT",
+    "+CGATT",
+    "+COPS",
+};
+
+static gboolean
+is_network_command (const gchar *key)
+{
+    gsize name_len;
+    guint i;
+
+    name_len = strcspn (key, "=?");
+    for (i = 0; i < G_N_ELEMENTS (network_commands); i++) {
+        if (strlen (network_commands[i]) == name_len &&
+            g_ascii_strncasecmp (key, network_commands[i], name_len) == 0)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static gchar *
+build_device_id (MMAtKnowledge  *self,
+                 MMPortSerialAt *port)
+{
+    MMKernelDevice *kernel_device;
+
+    if (!self->keyfile)
+        return NULL;
+
+    kernel_device = mm_port_peek_kernel_device (MM_PORT (port));
+    if (!kernel_device || !mm_kernel_device_get_physdev_vid (kernel_device))
+        return NULL;
+
+    return g_strdup_printf ("%04x:%04x:%04x",
+                            mm_kernel_device_get_physdev_vid (kernel_device),
+                            mm_kernel_device_get_physdev_pid (kernel_device),
+                            mm_kernel_device_get_physdev_revision (kernel_device));
+}
+
+static gchar *
+build_group (MMAtKnowledge *self,
+             const gchar   *device,
+             const gchar   *command)
+{
+    g_autofree gchar *key = NULL;
+    g_autofree gchar *firmware = NULL;
+    gchar            *group;
+
+    if (!self->keyfile || !device)
+        return NULL;
+
+    key = build_command_key (command);
+    if (!key)
+        return NULL;
+
+    /* The firmware revision is only known once the modem has been
+     * initialized, so use the last one seen on this device until then */
+    firmware = g_key_file_get_string (self->keyfile, device, KEY_FIRMWARE_REVISION, NULL);
+
+    group = g_strdup_printf ("%s|%s|%s", device, firmware ? firmware : "", key);
+    /* Group names in key files cannot have brackets */
+    return g_strdelimit (group, "[]\n", '_');
+}
+
+static void
+schedule_save (MMAtKnowledge *self)
+{
+    mm_keyfile_store_schedule_save (self->store, SAVE_TIMEOUT);
+}
+
+/*****************************************************************************/
+
+gboolean
+mm_at_knowledge_device_is_unsupported (MMAtKnowledge *self,
+                                       const gchar   *device,
+                                       const gchar   *command)
+{
+    g_autofree gchar *group = NULL;
+    gint64            since;
+
+    group = build_group (self, device, command);
+    if (!group || !g_key_file_has_key (self->keyfile, group, KEY_SUPPORTED, NULL))
+        return FALSE;
+
+    if (g_key_file_get_boolean (self->keyfile, group, KEY_SUPPORTED, NULL))
+        return FALSE;
+
+    /* Once expired, let the command go through again; the next reply tells
+     * whether it is still unsupported */
+    since = g_key_file_get_int64 (self->keyfile, group, KEY_UNSUPPORTED_SINCE, NULL);
+    return (g_get_real_time () - since < (gint64) self->unsupported_expiry * G_USEC_PER_SEC);
+}
+
+guint
+mm_at_knowledge_device_get_timeout (MMAtKnowledge *self,
+                                    const gchar   *device,
+                                    const gchar   *command,
+                                    guint          timeout)
+{
+    g_autofree gchar *key = NULL;
+    g_autofree gchar *group = NULL;
+    gint              max_latency_ms;
+    guint             adaptive_timeout;
+
+    /* Long running commands (e.g. network scans) keep the requested
+     * timeout, as well as those depending on the network */
+    if (timeout > ADAPTIVE_TIMEOUT_MAX_STATIC)
+        return timeout;
+
+    key = build_command_key (command);
+    if (!key || is_network_command (key))
+        return timeout;
+
+    group = build_group (self, device, command);
+    if (!group)
+        return timeout;
+
+    if (g_key_file_get_integer (self->keyfile, group, KEY_SAMPLES, NULL) < ADAPTIVE_TIMEOUT_MIN_SAMPLES)
+        return timeout;
+
+    /* Never longer than the one requested, and never much shorter */
+    max_latency_ms = g_key_file_get_integer (self->keyfile, group, KEY_MAX_LATENCY, NULL);
+    adaptive_timeout = (ADAPTIVE_TIMEOUT_FACTOR * (guint) MAX (max_latency_ms, 0) + 999) / 1000;
+    adaptive_timeout = MAX (adaptive_timeout, ADAPTIVE_TIMEOUT_MIN);
+    adaptive_timeout = MAX (adaptive_timeout, timeout / ADAPTIVE_TIMEOUT_MIN_DIVISOR);
+    return MIN (timeout, adaptive_timeout);
+}
+
+static gboolean
+record_support (MMAtKnowledge *self,
+                const gchar   *group,
+                const GError  *error)
+{
+    gint failures;
+
+    if (!error) {
+        /* Any success resets what was learned about failures */
+        if (g_key_file_get_boolean (self->keyfile, group, KEY_SUPPORTED, NULL) &&
+            !g_key_file_has_key (self->keyfile, group, KEY_FAILURES, NULL))
+            return FALSE;
+        if (g_key_file_has_key (self->keyfile, group, KEY_UNSUPPORTED_SINCE, NULL))
+            mm_obj_dbg (self, "learned that %s is supported again", group);
+        g_key_file_set_boolean (self->keyfile, group, KEY_SUPPORTED, TRUE);
+        g_key_file_remove_key (self->keyfile, group, KEY_FAILURES, NULL);
+        g_key_file_remove_key (self->keyfile, group, KEY_UNSUPPORTED_SINCE, NULL);
+        return TRUE;
+    }
+
+    /* Only an explicit 'not supported' error tells that the command itself
+     * is not supported; a plain ERROR, or specific ones (e.g. SIM busy), may
+     * just depend on the device state */
+    if (!g_error_matches (error, MM_MOBILE_EQUIPMENT_ERROR, MM_MOBILE_EQUIPMENT_ERROR_NOT_SUPPORTED))
+        return FALSE;
+
+    /* Already flagged, and tried again after the flag expired: still
+     * unsupported */
+    if (g_key_file_has_key (self->keyfile, group, KEY_SUPPORTED, NULL) &&
+        !g_key_file_get_boolean (self->keyfile, group, KEY_SUPPORTED, NULL)) {
+        g_key_file_set_int64 (self->keyfile, group, KEY_UNSUPPORTED_SINCE, g_get_real_time ());
+        return TRUE;
+    }
+
+    failures = g_key_file_get_integer (self->keyfile, group, KEY_FAILURES, NULL) + 1;
+    if (failures < UNSUPPORTED_FAILURES) {
+        g_key_file_set_integer (self->keyfile, group, KEY_FAILURES, failures);
+        return TRUE;
+    }
+
+    mm_obj_dbg (self, "learned that %s is unsupported", group);
+    g_key_file_set_boolean (self->keyfile, group, KEY_SUPPORTED, FALSE);
+    g_key_file_set_int64 (self->keyfile, group, KEY_UNSUPPORTED_SINCE, g_get_real_time ());
+    g_key_file_remove_key (self->keyfile, group, KEY_FAILURES, NULL);
+    return TRUE;
+}
+
+static gboolean
+record_latency (MMAtKnowledge *self,
+                const gchar   *group,
+                gint64         latency)
+{
+    gboolean changed = FALSE;
+    gint     samples;
+    gint     latency_ms;
+
+    samples = g_key_file_get_integer (self->keyfile, group, KEY_SAMPLES, NULL);
+    if (samples < ADAPTIVE_TIMEOUT_MIN_SAMPLES) {
+        g_key_file_set_integer (self->keyfile, group, KEY_SAMPLES, samples + 1);
+        changed = TRUE;
+    }
+
+    latency_ms = (gint) MIN (latency / 1000, G_MAXINT);
+    if (latency_ms > g_key_file_get_integer (self->keyfile, group, KEY_MAX_LATENCY, NULL)) {
+        g_key_file_set_integer (self->keyfile, group, KEY_MAX_LATENCY, latency_ms);
+        changed = TRUE;
+    }
+
+    return changed;
+}
+
+void
+mm_at_knowledge_device_record (MMAtKnowledge *self,
+                               const gchar   *device,
+                               const gchar   *command,
+                               const GError  *error,
+                               gint64         latency)
+{
+    g_autofree gchar *group = NULL;
+    gboolean          changed;
+
+    group = build_group (self, device, command);
+    if (!group)
+        return;
+
+    /* A timeout may have been caused by an adapted timeout being too short,
+     * so start learning the response time from scratch */
+    if (g_error_matches (error, MM_SERIAL_ERROR, MM_SERIAL_ERROR_RESPONSE_TIMEOUT)) {
+        if (g_key_file_has_key (self->keyfile, group, KEY_SAMPLES, NULL)) {
+            mm_obj_dbg (self, "forgetting response time of %s after timeout", group);
+            g_key_file_remove_key (self->keyfile, group, KEY_SAMPLES, NULL);
+            g_key_file_remove_key (self->keyfile, group, KEY_MAX_LATENCY, NULL);
+            schedule_save (self);
+        }
+        return;
+    }
+
+    /* Only replies from the modem are meaningful */
+    if (error && error->domain != MM_MOBILE_EQUIPMENT_ERROR)
+        return;
+
+    changed = record_support (self, group, error);
+    changed |= record_latency (self, group, latency);
+    if (changed)
+        schedule_save (self);
+}
+
+void
+mm_at_knowledge_device_set_firmware_revision (MMAtKnowledge *self,
+                                              const gchar   *device,
+                                              const gchar   *revision)
+{
+    g_autofree gchar  *firmware = NULL;
+    g_autofree gchar  *previous = NULL;
+    g_auto(GStrv)      groups = NULL;
+    g_autofree gchar  *prefix = NULL;
+    guint              i;
+
+    if (!self->keyfile || !device || !revision)
+        return;
+
+    firmware = g_strdelimit (g_strdup (revision), "[]\n|", '_');
+    previous = g_key_file_get_string (self->keyfile, device, KEY_FIRMWARE_REVISION, NULL);
+    if (!g_strcmp0 (previous, firmware))
+        return;
+
+    /* What was learned about other firmware revisions no longer applies */
+    mm_obj_dbg (self, "firmware revision of %s is now '%s': forgetting previous knowledge", device, firmware);
+    prefix = g_strdup_printf ("%s|", device);
+    groups = g_key_file_get_groups (self->keyfile, NULL);
+    for (i = 0; groups[i]; i++) {
+        if (g_str_has_prefix (groups[i], prefix))
+            g_key_file_remove_group (self->keyfile, groups[i], NULL);
+    }
+
+    g_key_file_set_string (self->keyfile, device, KEY_FIRMWARE_REVISION, firmware);
+    schedule_save (self);
+}
+
+/*****************************************************************************/
+
+gboolean
+mm_at_knowledge_is_unsupported (MMAtKnowledge  *self,
+                                MMPortSerialAt *port,
+                                const gchar    *command)
+{
+    g_autofree gchar *device = NULL;
+
+    device = build_device_id (self, port);
+    return mm_at_knowledge_device_is_unsupported (self, device, command);
+}
+
+guint
+mm_at_knowledge_get_timeout (MMAtKnowledge  *self,
+                             MMPortSerialAt *port,
+                             const gchar    *command,
+                             guint           timeout)
+{
+    g_autofree gchar *device = NULL;
+
+    device = build_device_id (self, port);
+    return mm_at_knowledge_device_get_timeout (self, device, command, timeout);
+}
+
+void
+mm_at_knowledge_record (MMAtKnowledge  *self,
+                        MMPortSerialAt *port,
+                        const gchar    *command,
+                        const GError   *error,
+                        gint64          latency)
+{
+    g_autofree gchar *device = NULL;
+
+    device = build_device_id (self, port);
+    mm_at_knowledge_device_record (self, device, command, error, latency);
+}
+
+void
+mm_at_knowledge_set_firmware_revision (MMAtKnowledge  *self,
+                                       MMPortSerialAt *port,
+                                       const gchar    *revision)
+{
+    g_autofree gchar *device = NULL;
+
+    device = build_device_id (self, port);
+    mm_at_knowledge_device_set_firmware_revision (self, device, revision);
+}
+
+/*****************************************************************************/
+
+static void
+mm_at_knowledge_init (MMAtKnowledge *self)
+{
+}
+
+static void
+constructed (GObject *object)
+{
+    MMAtKnowledge *self = MM_AT_KNOWLEDGE (object);
+    g_auto(GStrv)  groups = NULL;
+    guint          i;
+
+    G_OBJECT_CLASS (mm_at_knowledge_parent_class)->constructed (object);
+
+    if (!self->path) {
+        mm_obj_dbg (self, "disabled");
+        return;
+    }
+
+    self->store = mm_keyfile_store_new (self->path, "AT knowledge base", self);
+    self->keyfile = mm_keyfile_store_peek_keyfile (self->store);
+
+    /* Entries written before the firmware revision was part of the group
+     * name can't be trusted */
+    groups = g_key_file_get_groups (self->keyfile, NULL);
+    for (i = 0; groups[i]; i++) {
+        const gchar *sep;
+
+        sep = strchr (groups[i], '|');
+        if (sep && !strchr (sep + 1, '|'))
+            g_key_file_remove_group (self->keyfile, groups[i], NULL);
+    }
+}
+
+static void
+set_property (GObject      *object,
+              guint         prop_id,
+              const GValue *value,
+              GParamSpec   *pspec)
+{
+    MMAtKnowledge *self = MM_AT_KNOWLEDGE (object);
+
+    switch (prop_id) {
+    case PROP_PATH:
+        g_free (self->path);
+        self->path = g_value_dup_string (value);
+        break;
+    case PROP_UNSUPPORTED_EXPIRY:
+        self->unsupported_expiry = g_value_get_uint (value);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+get_property (GObject    *object,
+              guint       prop_id,
+              GValue     *value,
+              GParamSpec *pspec)
+{
+    MMAtKnowledge *self = MM_AT_KNOWLEDGE (object);
+
+    switch (prop_id) {
+    case PROP_PATH:
+        g_value_set_string (value, self->path);
+        break;
+    case PROP_UNSUPPORTED_EXPIRY:
+        g_value_set_uint (value, self->unsupported_expiry);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+finalize (GObject *object)
+{
+    MMAtKnowledge *self = MM_AT_KNOWLEDGE (object);
+
+    /* Pending changes are written out right away */
+    g_clear_pointer (&self->store, mm_keyfile_store_free);
+    g_free (self->path);
+
+    G_OBJECT_CLASS (mm_at_knowledge_parent_class)->finalize (object);
+}
+
+static void
+log_object_iface_init (MMLogObjectInterface *iface)
+{
+    iface->build_id = log_object_build_id;
+}
+
+static void
+mm_at_knowledge_class_init (MMAtKnowledgeClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+    object_class->constructed  = constructed;
+    object_class->set_property = set_property;
+    object_class->get_property = get_property;
+    object_class->finalize     = finalize;
+
+    properties[PROP_PATH] =
+        g_param_spec_string (MM_AT_KNOWLEDGE_PATH,
+                             "Path",
+                             "Path to the AT knowledge base file",
+                             NULL,
+                             G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY);
+    g_object_class_install_property (object_class, PROP_PATH, properties[PROP_PATH]);
+
+    properties[PROP_UNSUPPORTED_EXPIRY] =
+        g_param_spec_uint (MM_AT_KNOWLEDGE_UNSUPPORTED_EXPIRY,
+                           "Unsupported expiry",
+                           "Seconds after which unsupported commands are tried again",
+                           1, G_MAXUINT, UNSUPPORTED_EXPIRY_DEFAULT,
+                           G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY);
+    g_object_class_install_property (object_class, PROP_UNSUPPORTED_EXPIRY, properties[PROP_UNSUPPORTED_EXPIRY]);
+}
+
+MM_DEFINE_SINGLETON_GETTER (MMAtKnowledge, mm_at_knowledge_get, MM_TYPE_AT_KNOWLEDGE,
+                            MM_AT_KNOWLEDGE_PATH, mm_context_get_at_knowledge ())
@@ -0,0 +1,90 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_AT_KNOWLEDGE_H
+#define MM_AT_KNOWLEDGE_H
+
+#include <config.h>
+#include <glib-object.h>
+
+#include "mm-port-serial-at.h"
+
+#define MM_TYPE_AT_KNOWLEDGE            (mm_at_knowledge_get_type ())
+#define MM_AT_KNOWLEDGE(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), MM_TYPE_AT_KNOWLEDGE, MMAtKnowledge))
+#define MM_AT_KNOWLEDGE_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass),  MM_TYPE_AT_KNOWLEDGE, MMAtKnowledgeClass))
+#define MM_IS_AT_KNOWLEDGE(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), MM_TYPE_AT_KNOWLEDGE))
+#define MM_IS_AT_KNOWLEDGE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),  MM_TYPE_AT_KNOWLEDGE))
+#define MM_AT_KNOWLEDGE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),  MM_TYPE_AT_KNOWLEDGE, MMAtKnowledgeClass))
+
+#define MM_AT_KNOWLEDGE_PATH               "path"               /* construct-only */
+#define MM_AT_KNOWLEDGE_UNSUPPORTED_EXPIRY "unsupported-expiry" /* construct-only */
+
+typedef struct _MMAtKnowledge      MMAtKnowledge;
+typedef struct _MMAtKnowledgeClass MMAtKnowledgeClass;
+
+/* AT command support learned from the replies of each device, kept across
+ * daemon restarts.
+ *
+ * Entries are keyed by the VID/PID/revision of the device owning the port,
+ * by its firmware revision, and by the command name and form (e.g. "+CESQ",
+ * "+WS46=?", "+CNUM"). Until the firmware revision is reported during modem
+ * initialization, the last one seen on the same device is assumed; a new
+ * one drops everything learned about the previous one.
+ *
+ * Only commands without arguments are tracked, as both the outcome and the
+ * response time of set commands depend on the arguments given. A command
+ * is considered unsupported once it has failed several times in a row with
+ * a 'not supported' error; any success resets the count. Unsupported
+ * commands are tried again once the flag expires. The maximum response time
+ * observed is used to shorten the timeout of the command. The knowledge base
+ * is only enabled if a file path is given with --at-knowledge. */
+
+GType          mm_at_knowledge_get_type (void);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (MMAtKnowledge, g_object_unref)
+
+MMAtKnowledge *mm_at_knowledge_get      (void);
+
+gboolean mm_at_knowledge_is_unsupported (MMAtKnowledge  *self,
+                                         MMPortSerialAt *port,
+                                         const gchar    *command);
+guint    mm_at_knowledge_get_timeout    (MMAtKnowledge  *self,
+                                         MMPortSerialAt *port,
+                                         const gchar    *command,
+                                         guint           timeout);
+void     mm_at_knowledge_record         (MMAtKnowledge  *self,
+                                         MMPortSerialAt *port,
+                                         const gchar    *command,
+                                         const GError   *error,
+                                         gint64          latency);
+void     mm_at_knowledge_set_firmware_revision (MMAtKnowledge  *self,
+                                                MMPortSerialAt *port,
+                                                const gchar    *revision);
+
+/* For testing purposes, with the device given as "VID:PID:revision" */
+gboolean mm_at_knowledge_device_is_unsupported        (MMAtKnowledge *self,
+                                                       const gchar   *device,
+                                                       const gchar   *command);
+guint    mm_at_knowledge_device_get_timeout           (MMAtKnowledge *self,
+                                                       const gchar   *device,
+                                                       const gchar   *command,
+                                                       guint          timeout);
+void     mm_at_knowledge_device_record                (MMAtKnowledge *self,
+                                                       const gchar   *device,
+                                                       const gchar   *command,
+                                                       const GError  *error,
+                                                       gint64         latency);
+void     mm_at_knowledge_device_set_firmware_revision (MMAtKnowledge *self,
+                                                       const gchar   *device,
+                                                       const gchar   *revision);
+
+#endif /* MM_AT_KNOWLEDGE_H */
@@ -0,0 +1,147 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+
+#include "mm-auth-cache.h"
+
+struct _MMAuthCache {
+    gint64      timeout;
+    /* Sender unique name to a table of authorization to expiration time
+     * (monotonic) */
+    GHashTable *senders;
+};
+
+/*****************************************************************************/
+
+static gboolean
+authorization_expired (gpointer  key,
+                       gint64   *expiration,
+                       gint64   *now)
+{
+    return *now >= *expiration;
+}
+
+static gboolean
+sender_expired (gpointer    key,
+                GHashTable *authorizations,
+                gint64     *now)
+{
+    g_hash_table_foreach_remove (authorizations, (GHRFunc) authorization_expired, now);
+    return !g_hash_table_size (authorizations);
+}
+
+/*****************************************************************************/
+
+gboolean
+mm_auth_cache_lookup (MMAuthCache *self,
+                      const gchar *sender,
+                      const gchar *authorization)
+{
+    GHashTable *authorizations;
+    gint64     *expiration;
+
+    if (!sender)
+        return FALSE;
+
+    authorizations = g_hash_table_lookup (self->senders, sender);
+    if (!authorizations)
+        return FALSE;
+
+    expiration = g_hash_table_lookup (authorizations, authorization);
+    if (!expiration)
+        return FALSE;
+
+    if (g_get_monotonic_time () >= *expiration) {
+        g_hash_table_remove (authorizations, authorization);
+        if (!g_hash_table_size (authorizations))
+            g_hash_table_remove (self->senders, sender);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+gboolean
+mm_auth_cache_add (MMAuthCache *self,
+                   const gchar *sender,
+                   const gchar *authorization,
+                   MMAuthGrant  grant)
+{
+    GHashTable *authorizations;
+    gint64     *expiration;
+    gint64      now;
+
+    /* The user must authenticate again on the next request, so reusing the
+     * decision would bypass the policy */
+    if (grant == MM_AUTH_GRANT_CHALLENGE)
+        return FALSE;
+
+    if (!sender)
+        return FALSE;
+
+    now = g_get_monotonic_time ();
+
+    authorizations = g_hash_table_lookup (self->senders, sender);
+    if (!authorizations) {
+        /* Senders may vanish without being removed, so cleanup the expired
+         * ones when adding new ones */
+        g_hash_table_foreach_remove (self->senders, (GHRFunc) sender_expired, &now);
+
+        authorizations = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+        g_hash_table_insert (self->senders, g_strdup (sender), authorizations);
+    }
+
+    expiration = g_new (gint64, 1);
+    *expiration = now + self->timeout;
+    g_hash_table_replace (authorizations, g_strdup (authorization), expiration);
+    return TRUE;
+}
+
+gboolean
+mm_auth_cache_remove_sender (MMAuthCache *self,
+                             const gchar *sender)
+{
+    return g_hash_table_remove (self->senders, sender);
+}
+
+void
+mm_auth_cache_clear (MMAuthCache *self)
+{
+    g_hash_table_remove_all (self->senders);
+}
+
+guint
+mm_auth_cache_get_n_senders (MMAuthCache *self)
+{
+    return g_hash_table_size (self->senders);
+}
+
+/*****************************************************************************/
+
+MMAuthCache *
+mm_auth_cache_new (guint timeout_ms)
+{
+    MMAuthCache *self;
+
+    self = g_slice_new0 (MMAuthCache);
+    self->timeout = (gint64) timeout_ms * 1000;
+    self->senders = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_hash_table_unref);
+    return self;
+}
+
+void
+mm_auth_cache_free (MMAuthCache *self)
+{
+    g_hash_table_unref (self->senders);
+    g_slice_free (MMAuthCache, self);
+}
@@ -0,0 +1,56 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_AUTH_CACHE_H
+#define MM_AUTH_CACHE_H
+
+#include <glib.h>
+
+/* How an authorization was granted by the authority */
+typedef enum {
+    /* Granted right away, e.g. "yes" policies or privileged callers */
+    MM_AUTH_GRANT_IMPLICIT,
+    /* Granted after the user authenticated, only for this request */
+    MM_AUTH_GRANT_CHALLENGE,
+    /* Granted after the user authenticated, and kept by the authority
+     * (auth_self_keep, auth_admin_keep) */
+    MM_AUTH_GRANT_CHALLENGE_RETAINED,
+} MMAuthGrant;
+
+/* Cache of positive authorization decisions, per sender and action.
+ *
+ * Decisions are only cached if the authority would have granted them again
+ * without asking the user, so that the cache never bypasses a policy that
+ * requires authentication on every request. Entries expire after the given
+ * timeout; senders whose bus name vanished must be removed explicitly.
+ */
+typedef struct _MMAuthCache MMAuthCache;
+
+MMAuthCache *mm_auth_cache_new           (guint         timeout_ms);
+void         mm_auth_cache_free          (MMAuthCache  *self);
+
+gboolean     mm_auth_cache_lookup        (MMAuthCache  *self,
+                                          const gchar  *sender,
+                                          const gchar  *authorization);
+gboolean     mm_auth_cache_add           (MMAuthCache  *self,
+                                          const gchar  *sender,
+                                          const gchar  *authorization,
+                                          MMAuthGrant   grant);
+gboolean     mm_auth_cache_remove_sender (MMAuthCache  *self,
+                                          const gchar  *sender);
+void         mm_auth_cache_clear         (MMAuthCache  *self);
+guint        mm_auth_cache_get_n_senders (MMAuthCache  *self);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (MMAuthCache, mm_auth_cache_free)
+
+#endif /* MM_AUTH_CACHE_H */
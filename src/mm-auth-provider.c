@@ -22,15 +22,25 @@
 #include "mm-log-object.h"
 #include "mm-utils.h"
 #include "mm-auth-provider.h"
+#include "mm-auth-cache.h"
 
 #if defined WITH_POLKIT
 # include <polkit/polkit.h>
 #endif
 
+/* Positive authorization decisions are reused during this time */
+#define AUTHORIZATION_CACHE_TIMEOUT_SECS 30
+
 struct _MMAuthProvider {
     GObject parent;
 #if defined WITH_POLKIT
     PolkitAuthority *authority;
+    gulong           authority_changed_id;
+    /* Authorization cache, and name owner watches of the cached senders */
+    MMAuthCache     *cache;
+    GHashTable      *watches;
+    guint            n_cached;
+    guint            n_checked;
 #endif
 };
 
@@ -55,10 +65,99 @@ mm_auth_provider_authorize_finish (MMAuthProvider  *self,
 
 #if defined WITH_POLKIT
 
+/*****************************************************************************/
+/* Authorization cache */
+
+typedef struct {
+    MMAuthProvider  *self;
+    gchar           *sender;
+    GDBusConnection *connection;
+    guint            name_owner_changed_id;
+} SenderWatch;
+
+static void
+sender_watch_free (SenderWatch *watch)
+{
+    g_dbus_connection_signal_unsubscribe (watch->connection, watch->name_owner_changed_id);
+    g_object_unref (watch->connection);
+    g_free (watch->sender);
+    g_slice_free (SenderWatch, watch);
+}
+
+static void
+name_owner_changed_cb (GDBusConnection *connection,
+                       const gchar     *sender_name,
+                       const gchar     *object_path,
+                       const gchar     *interface_name,
+                       const gchar     *signal_name,
+                       GVariant        *parameters,
+                       SenderWatch     *watch)
+{
+    MMAuthProvider *self = watch->self;
+    const gchar    *new_owner = NULL;
+
+    g_variant_get (parameters, "(&s&s&s)", NULL, NULL, &new_owner);
+    if (new_owner && new_owner[0])
+        return;
+
+    /* The unique name is gone, and it will never be reused */
+    if (mm_auth_cache_remove_sender (self->cache, watch->sender))
+        mm_obj_dbg (self, "sender %s vanished: authorizations removed from cache", watch->sender);
+    g_hash_table_remove (self->watches, watch->sender);
+}
+
+static void
+cache_add (MMAuthProvider        *self,
+           GDBusMethodInvocation *invocation,
+           const gchar           *authorization,
+           MMAuthGrant            grant)
+{
+    SenderWatch *watch;
+    const gchar *sender;
+
+    sender = g_dbus_method_invocation_get_sender (invocation);
+    if (!mm_auth_cache_add (self->cache, sender, authorization, grant))
+        return;
+
+    if (g_hash_table_contains (self->watches, sender))
+        return;
+
+    watch = g_slice_new0 (SenderWatch);
+    watch->self = self;
+    watch->sender = g_strdup (sender);
+    watch->connection = g_object_ref (g_dbus_method_invocation_get_connection (invocation));
+    watch->name_owner_changed_id =
+        g_dbus_connection_signal_subscribe (watch->connection,
+                                            "org.freedesktop.DBus",
+                                            "org.freedesktop.DBus",
+                                            "NameOwnerChanged",
+                                            "/org/freedesktop/DBus",
+                                            sender,
+                                            G_DBUS_SIGNAL_FLAGS_NONE,
+                                            (GDBusSignalCallback) name_owner_changed_cb,
+                                            watch,
+                                            NULL);
+    g_hash_table_insert (self->watches, watch->sender, watch);
+}
+
+static void
+authority_changed_cb (MMAuthProvider *self)
+{
+    /* Policies or sessions changed, all decisions must be checked again */
+    if (mm_auth_cache_get_n_senders (self->cache) > 0) {
+        mm_obj_dbg (self, "authority changed: authorization cache cleared");
+        mm_auth_cache_clear (self->cache);
+    }
+}
+
+/*****************************************************************************/
+
 typedef struct {
     PolkitSubject         *subject;
     gchar                 *authorization;
     GDBusMethodInvocation *invocation;
+    GCancellable          *cancellable;
+    gboolean               interactive;
 } AuthorizeContext;
 
 static void
@@ -66,15 +165,20 @@ authorize_context_free (AuthorizeContext *ctx)
 {
     g_object_unref (ctx->invocation);
     g_object_unref (ctx->subject);
+    g_clear_object (&ctx->cancellable);
     g_free (ctx->authorization);
     g_free (ctx);
 }
 
+static void check_authorization (MMAuthProvider *self,
+                                 GTask          *task);
+
 static void
 check_authorization_ready (PolkitAuthority *authority,
                            GAsyncResult    *res,
                            GTask           *task)
 {
+    MMAuthProvider            *self;
     PolkitAuthorizationResult *pk_result;
     GError                    *error = NULL;
     AuthorizeContext          *ctx;
@@ -84,6 +188,7 @@ check_authorization_ready (PolkitAuthority *authority,
         return;
     }
 
+    self = g_task_get_source_object (task);
     ctx = g_task_get_task_data (task);
     pk_result = polkit_authority_check_authorization_finish (authority, res, &error);
     if (!pk_result) {
@@ -94,10 +199,26 @@ check_authorization_ready (PolkitAuthority *authority,
                                  error->message);
         g_error_free (error);
     } else {
-        if (polkit_authorization_result_get_is_authorized (pk_result))
-            /* Good! */
+        if (polkit_authorization_result_get_is_authorized (pk_result)) {
+            MMAuthGrant grant;
+
+            /* Good! Only remember the decision if the authority would grant
+             * it again without asking the user */
+            if (!ctx->interactive)
+                grant = MM_AUTH_GRANT_IMPLICIT;
+            else if (polkit_authorization_result_get_retains_authorization (pk_result))
+                grant = MM_AUTH_GRANT_CHALLENGE_RETAINED;
+            else
+                grant = MM_AUTH_GRANT_CHALLENGE;
+            cache_add (self, ctx->invocation, ctx->authorization, grant);
             g_task_return_boolean (task, TRUE);
-        else if (polkit_authorization_result_get_is_challenge (pk_result))
+        } else if (polkit_authorization_result_get_is_challenge (pk_result) && !ctx->interactive) {
+            /* Ask again, now letting the user authenticate */
+            g_object_unref (pk_result);
+            ctx->interactive = TRUE;
+            check_authorization (self, task);
+            return;
+        } else if (polkit_authorization_result_get_is_challenge (pk_result))
             g_task_return_new_error (task,
                                      MM_CORE_ERROR,
                                      MM_CORE_ERROR_UNAUTHORIZED,
@@ -114,6 +235,28 @@ check_authorization_ready (PolkitAuthority *authority,
 
     g_object_unref (task);
 }
+
+static void
+check_authorization (MMAuthProvider *self,
+                     GTask          *task)
+{
+    AuthorizeContext *ctx;
+
+    ctx = g_task_get_task_data (task);
+
+    /* The first check never interacts with the user, so that we can tell
+     * implicit authorizations apart from the ones that needed a challenge */
+    polkit_authority_check_authorization (self->authority,
+                                          ctx->subject,
+                                          ctx->authorization,
+                                          NULL, /* details */
+                                          (ctx->interactive ?
+                                           POLKIT_CHECK_AUTHORIZATION_FLAGS_ALLOW_USER_INTERACTION :
+                                           POLKIT_CHECK_AUTHORIZATION_FLAGS_NONE),
+                                          ctx->cancellable,
+                                          (GAsyncReadyCallback)check_authorization_ready,
+                                          task);
+}
 #endif
 
 void
@@ -142,20 +285,26 @@ mm_auth_provider_authorize (MMAuthProvider        *self,
             return;
         }
 
+        /* Reuse a recent positive decision for the same sender, if any */
+        if (mm_auth_cache_lookup (self->cache, g_dbus_method_invocation_get_sender (invocation), authorization)) {
+            self->n_cached++;
+            mm_obj_dbg (self, "authorization '%s' found in cache (%u cached, %u checked)",
+                        authorization, self->n_cached, self->n_checked);
+            g_task_return_boolean (task, TRUE);
+            g_object_unref (task);
+            return;
+        }
+        self->n_checked++;
+
         ctx = g_new (AuthorizeContext, 1);
         ctx->invocation = g_object_ref (invocation);
         ctx->authorization = g_strdup (authorization);
         ctx->subject = polkit_system_bus_name_new (g_dbus_method_invocation_get_sender (ctx->invocation));
+        ctx->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+        ctx->interactive = FALSE;
         g_task_set_task_data (task, ctx, (GDestroyNotify)authorize_context_free);
 
-        polkit_authority_check_authorization (self->authority,
-                                              ctx->subject,
-                                              authorization,
-                                              NULL, /* details */
-                                              POLKIT_CHECK_AUTHORIZATION_FLAGS_ALLOW_USER_INTERACTION,
-                                              cancellable,
-                                              (GAsyncReadyCallback)check_authorization_ready,
-                                              task);
+        check_authorization (self, task);
     }
 #else
     /* Just create the result and complete it */
@@ -188,7 +337,14 @@ mm_auth_provider_init (MMAuthProvider *self)
             mm_obj_warn (self, "failed to create PolicyKit authority: '%s'",
                          error ? error->message : "unknown");
             g_clear_error (&error);
-        }
+        } else
+            self->authority_changed_id = g_signal_connect_swapped (self->authority,
+                                                                   "changed",
+                                                                   G_CALLBACK (authority_changed_cb),
+                                                                   self);
+
+        self->cache = mm_auth_cache_new (AUTHORIZATION_CACHE_TIMEOUT_SECS * 1000);
+        self->watches = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) sender_watch_free);
     }
 #endif
 }
@@ -197,7 +353,15 @@ static void
 dispose (GObject *object)
 {
 #if defined WITH_POLKIT
-    g_clear_object (&(MM_AUTH_PROVIDER (object)->authority));
+    MMAuthProvider *self = MM_AUTH_PROVIDER (object);
+
+    g_clear_pointer (&self->watches, g_hash_table_unref);
+    g_clear_pointer (&self->cache, mm_auth_cache_free);
+    if (self->authority_changed_id) {
+        g_signal_handler_disconnect (self->authority, self->authority_changed_id);
+        self->authority_changed_id = 0;
+    }
+    g_clear_object (&self->authority);
 #endif
 
     G_OBJECT_CLASS (mm_auth_provider_parent_class)->dispose (object);
@@ -41,14 +41,15 @@
 #include "mm-error-helpers.h"
 #include "mm-bearer-stats.h"
 #include "mm-dispatcher-connection.h"
+#include "mm-context.h"
+#include "mm-netlink.h"
+#include "mm-timer-wheel.h"
 
 /* We require up to 20s to get a proper IP when using PPP */
 #define BEARER_IP_TIMEOUT_DEFAULT 20
 
 #define BEARER_DEFERRED_UNREGISTRATION_TIMEOUT 15
 
-#define BEARER_STATS_UPDATE_TIMEOUT 30
-
 /* Initial connectivity check after 30s, then each 5s */
 #define BEARER_CONNECTION_MONITOR_INITIAL_TIMEOUT 30
 #define BEARER_CONNECTION_MONITOR_TIMEOUT          5
@@ -128,6 +129,9 @@ struct _MMBaseBearerPrivate {
     GTimer *duration_timer;
     /* Flag to specify whether reloading stats is supported or not */
     gboolean reload_stats_supported;
+    /* Kernel interface counters, used to compute the connection totals
+     * and rates */
+    MMNetlinkLinkSampler kernel_stats;
 };
 
 /*****************************************************************************/
@@ -159,7 +163,7 @@ static void
 connection_monitor_stop (MMBaseBearer *self)
 {
     if (self->priv->connection_monitor_id) {
-        g_source_remove (self->priv->connection_monitor_id);
+        mm_timer_wheel_remove (self->priv->connection_monitor_id);
         self->priv->connection_monitor_id = 0;
     }
 }
@@ -217,9 +221,9 @@ initial_connection_monitor_cb (MMBaseBearer *self)
             NULL);
 
     /* Add new monitor timeout at a higher rate */
-    self->priv->connection_monitor_id = g_timeout_add_seconds (BEARER_CONNECTION_MONITOR_TIMEOUT,
-                                                               (GSourceFunc) connection_monitor_cb,
-                                                               self);
+    self->priv->connection_monitor_id = mm_timer_wheel_add_seconds (BEARER_CONNECTION_MONITOR_TIMEOUT,
+                                                                    (GSourceFunc) connection_monitor_cb,
+                                                                    self);
 
     /* Remove the initial connection monitor timeout as we added a new one */
     return G_SOURCE_REMOVE;
@@ -238,9 +242,9 @@ connection_monitor_start (MMBaseBearer *self)
 
     /* Schedule initial check */
     g_assert (!self->priv->connection_monitor_id);
-    self->priv->connection_monitor_id = g_timeout_add_seconds (BEARER_CONNECTION_MONITOR_INITIAL_TIMEOUT,
-                                                               (GSourceFunc) initial_connection_monitor_cb,
-                                                               self);
+    self->priv->connection_monitor_id = mm_timer_wheel_add_seconds (BEARER_CONNECTION_MONITOR_INITIAL_TIMEOUT,
+                                                                    (GSourceFunc) initial_connection_monitor_cb,
+                                                                    self);
 }
 
 /*****************************************************************************/
@@ -342,6 +346,130 @@ bearer_set_ongoing_interface_stats (MMBaseBearer *self,
         bearer_update_interface_stats (self);
 }
 
+/*****************************************************************************/
+/* Kernel statistics sampler
+ *
+ * When the kernel is the configured stats source, the counters of the data
+ * interfaces of all connected bearers are loaded with a single netlink dump
+ * at each sampling interval, instead of one control transaction with the
+ * modem per bearer. Bearers whose interface isn't found in the dump (e.g.
+ * PPP connections, where the interface isn't managed by us) fall back to the
+ * modem-provided stats. */
+
+static GList    *kernel_stats_bearers;
+static guint     kernel_stats_update_id;
+static gboolean  kernel_stats_ongoing;
+
+static void stats_update_cb (MMBaseBearer *self);
+
+static void
+bearer_set_kernel_stats (MMBaseBearer             *self,
+                         const MMNetlinkLinkStats *link_stats,
+                         gint64                    now)
+{
+    MMNetlinkLinkStats totals;
+    guint64            rx_rate = 0;
+    guint64            tx_rate = 0;
+
+    if (mm_netlink_link_sampler_add (&self->priv->kernel_stats, link_stats, now, &totals, &rx_rate, &tx_rate)) {
+        mm_bearer_stats_set_uplink_speed (self->priv->stats, tx_rate);
+        mm_bearer_stats_set_downlink_speed (self->priv->stats, rx_rate);
+    }
+
+    mm_obj_dbg (self, "kernel stats: rx %" G_GUINT64_FORMAT " packets (%" G_GUINT64_FORMAT " dropped), "
+                "tx %" G_GUINT64_FORMAT " packets (%" G_GUINT64_FORMAT " dropped)",
+                totals.rx_packets, totals.rx_dropped, totals.tx_packets, totals.tx_dropped);
+
+    /* Rates are always updated, so always flush the interface */
+    bearer_set_ongoing_interface_stats (self,
+                                        (guint32) g_timer_elapsed (self->priv->duration_timer, NULL),
+                                        totals.rx_bytes,
+                                        totals.tx_bytes);
+    bearer_update_interface_stats (self);
+}
+
+static void
+kernel_stats_ready (MMNetlink    *netlink,
+                    GAsyncResult *res)
+{
+    g_autoptr(GHashTable)  link_stats = NULL;
+    g_autoptr(GError)      error = NULL;
+    GList                 *bearers;
+    GList                 *l;
+    gint64                 now;
+
+    kernel_stats_ongoing = FALSE;
+
+    link_stats = mm_netlink_get_link_stats_finish (netlink, res, &error);
+    if (!link_stats)
+        mm_obj_dbg (netlink, "couldn't load link stats: %s", error->message);
+
+    /* Bearers may be removed from the sampler while processing the list */
+    now = g_get_monotonic_time ();
+    bearers = g_list_copy_deep (kernel_stats_bearers, (GCopyFunc) g_object_ref, NULL);
+    for (l = bearers; l; l = g_list_next (l)) {
+        MMBaseBearer             *self = MM_BASE_BEARER (l->data);
+        const MMNetlinkLinkStats *stats = NULL;
+        const gchar              *interface;
+
+        if (!g_list_find (kernel_stats_bearers, self) ||
+            self->priv->status != MM_BEARER_STATUS_CONNECTED)
+            continue;
+
+        interface = mm_gdbus_bearer_get_interface (MM_GDBUS_BEARER (self));
+        if (link_stats && interface)
+            stats = g_hash_table_lookup (link_stats, interface);
+
+        if (stats)
+            bearer_set_kernel_stats (self, stats, now);
+        else
+            stats_update_cb (self);
+    }
+    g_list_free_full (bearers, g_object_unref);
+}
+
+static gboolean
+kernel_stats_update_cb (void)
+{
+    /* Never queue more than one dump */
+    if (!kernel_stats_ongoing) {
+        kernel_stats_ongoing = TRUE;
+        mm_netlink_get_link_stats (mm_netlink_get (),
+                                   NULL,
+                                   (GAsyncReadyCallback) kernel_stats_ready,
+                                   NULL);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static void
+kernel_stats_add (MMBaseBearer *self)
+{
+    memset (&self->priv->kernel_stats, 0, sizeof (self->priv->kernel_stats));
+    kernel_stats_bearers = g_list_prepend (kernel_stats_bearers, self);
+    if (!kernel_stats_update_id)
+        kernel_stats_update_id = mm_timer_wheel_add_seconds (mm_context_get_bearer_stats_interval (),
+                                                             (GSourceFunc) kernel_stats_update_cb,
+                                                             NULL);
+    /* Load initial values */
+    kernel_stats_update_cb ();
+}
+
+static void
+kernel_stats_remove (MMBaseBearer *self)
+{
+    if (!g_list_find (kernel_stats_bearers, self))
+        return;
+
+    kernel_stats_bearers = g_list_remove (kernel_stats_bearers, self);
+    if (!kernel_stats_bearers && kernel_stats_update_id) {
+        mm_timer_wheel_remove (kernel_stats_update_id);
+        kernel_stats_update_id = 0;
+    }
+}
+
+/*****************************************************************************/
+
 static void
 bearer_stats_stop (MMBaseBearer *self)
 {
@@ -355,9 +483,11 @@ bearer_stats_stop (MMBaseBearer *self)
     }
 
     if (self->priv->stats_update_id) {
-        g_source_remove (self->priv->stats_update_id);
+        mm_timer_wheel_remove (self->priv->stats_update_id);
         self->priv->stats_update_id = 0;
     }
+
+    kernel_stats_remove (self);
 }
 
 static void
@@ -374,6 +504,10 @@ reload_stats_ready (MMBaseBearer *self,
         return;
     }
 
+    /* Ignore if the bearer got disconnected meanwhile */
+    if (!self->priv->duration_timer)
+        return;
+
     /* We only update stats if they were retrieved properly */
     bearer_set_ongoing_interface_stats (self,
                                         (guint32) g_timer_elapsed (self->priv->duration_timer, NULL),
@@ -381,20 +515,16 @@ reload_stats_ready (MMBaseBearer *self,
                                         tx_bytes);
 }
 
-static gboolean
+static void
 stats_update_cb (MMBaseBearer *self)
 {
-    /* Ignore stats update if we're not connected */
-    if (self->priv->status != MM_BEARER_STATUS_CONNECTED)
-        return G_SOURCE_CONTINUE;
-
     /* If the implementation knows how to update stat values, run it */
     if (self->priv->reload_stats_supported) {
         MM_BASE_BEARER_GET_CLASS (self)->reload_stats (
             self,
             (GAsyncReadyCallback)reload_stats_ready,
             NULL);
-        return G_SOURCE_CONTINUE;
+        return;
     }
 
     /* Otherwise, just update duration and we're done */
@@ -402,6 +532,14 @@ stats_update_cb (MMBaseBearer *self)
                                         (guint32) g_timer_elapsed (self->priv->duration_timer, NULL),
                                         0,
                                         0);
+}
+
+static gboolean
+stats_update_timeout_cb (MMBaseBearer *self)
+{
+    /* Ignore stats update if we're not connected */
+    if (self->priv->status == MM_BEARER_STATUS_CONNECTED)
+        stats_update_cb (self);
     return G_SOURCE_CONTINUE;
 }
 
@@ -414,19 +552,24 @@ bearer_stats_start (MMBaseBearer *self,
     g_assert (!self->priv->duration_timer);
     self->priv->duration_timer = g_timer_new ();
 
-    /* Schedule */
-    g_assert (!self->priv->stats_update_id);
-    self->priv->stats_update_id = g_timeout_add_seconds (BEARER_STATS_UPDATE_TIMEOUT,
-                                                         (GSourceFunc) stats_update_cb,
-                                                         self);
-
     mm_bearer_stats_set_start_date (self->priv->stats, (guint64)(g_get_real_time() / G_USEC_PER_SEC));
     mm_bearer_stats_set_uplink_speed (self->priv->stats, uplink_speed);
     mm_bearer_stats_set_downlink_speed (self->priv->stats, downlink_speed);
     bearer_update_interface_stats (self);
 
+    /* Schedule, either in the shared kernel stats sampler or on our own */
+    if (mm_context_get_bearer_stats_kernel ()) {
+        kernel_stats_add (self);
+        return;
+    }
+
+    g_assert (!self->priv->stats_update_id);
+    self->priv->stats_update_id = mm_timer_wheel_add_seconds (mm_context_get_bearer_stats_interval (),
+                                                              (GSourceFunc) stats_update_timeout_cb,
+                                                              self);
+
     /* Load initial values */
-    stats_update_cb (self);
+    stats_update_timeout_cb (self);
 }
 
 /*****************************************************************************/
@@ -536,7 +679,7 @@ bearer_update_status (MMBaseBearer *self,
                                 "connection #%u finished: duration %us",
                                 mm_bearer_stats_get_attempts (self->priv->stats),
                                 mm_bearer_stats_get_duration (self->priv->stats));
-        if (self->priv->reload_stats_supported)
+        if (self->priv->reload_stats_supported || self->priv->kernel_stats.started)
             g_string_append_printf (report,
                                     ", tx: %" G_GUINT64_FORMAT " bytes, rx: %" G_GUINT64_FORMAT " bytes",
                                     mm_bearer_stats_get_tx_bytes (self->priv->stats),
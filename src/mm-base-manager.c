@@ -56,6 +56,7 @@
 #include "mm-plugin.h"
 #include "mm-filter.h"
 #include "mm-log-object.h"
+#include "mm-probe-cache.h"
 #include "mm-base-modem.h"
 #include "mm-iface-modem.h"
 
@@ -205,6 +206,9 @@ initialize_ready (MMBaseModem   *modem,
             mm_obj_warn (modem, "error initializing: %s", error->message);
             mm_base_modem_set_valid (modem, TRUE);
         }
+        /* Cached probing results may be the reason why the modem cannot be
+         * initialized, make sure the next attempt does a full probing */
+        mm_probe_cache_forget (mm_probe_cache_get (), mm_base_modem_get_device (modem));
     } else {
         mm_obj_dbg (modem, "modem initialized");
         mm_base_modem_set_valid (modem, TRUE);
@@ -335,6 +339,17 @@ device_support_check_ready (MMPluginManager          *plugin_manager,
 
     /* Receive plugin result from the plugin manager */
     plugin = mm_plugin_manager_device_support_check_finish (plugin_manager, res, &error);
+
+#if defined WITH_TESTS
+    /* Expose the updated probing stats */
+    if (ctx->self->priv->test_skeleton) {
+        mm_gdbus_test_set_probing_profiles (ctx->self->priv->test_skeleton,
+                                            mm_plugin_manager_build_probing_profiles (plugin_manager));
+        mm_gdbus_test_set_probing_history (ctx->self->priv->test_skeleton,
+                                           mm_plugin_manager_build_probing_history (plugin_manager));
+    }
+#endif
+
     if (!plugin) {
         mm_obj_msg (ctx->self, "couldn't check support for device '%s': %s",
                     mm_device_get_uid (ctx->device), error->message);
@@ -19,7 +19,10 @@
 #include <ModemManager.h>
 
 #include "mm-base-modem-at.h"
+#include "mm-at-knowledge.h"
 #include "mm-errors-types.h"
+#include "mm-log-object.h"
+#include "mm-modem-helpers.h"
 
 static gboolean
 abort_task_if_port_unusable (MMBaseModem *self,
@@ -92,11 +95,16 @@ typedef struct {
     GDestroyNotify              response_processor_context_free;
     GVariant                   *result;
     guint                       next_command_wait_id;
+    gboolean                    command_chaining;
+    guint                       n_chained;
 } AtSequenceContext;
 
-static void at_sequence_parse_response (MMPortSerialAt    *port,
-                                        GAsyncResult      *res,
-                                        GTask             *task);
+static void at_sequence_parse_response         (MMPortSerialAt    *port,
+                                                GAsyncResult      *res,
+                                                GTask             *task);
+static void at_sequence_parse_chained_response (MMPortSerialAt    *port,
+                                                GAsyncResult      *res,
+                                                GTask             *task);
 
 static void
 at_sequence_context_free (AtSequenceContext *ctx)
@@ -150,41 +158,164 @@ mm_base_modem_at_sequence_full_finish (MMBaseModem   *self,
     return result;
 }
 
-static gboolean
-at_sequence_next_command (GTask *task)
+/* Builds the chained command line with as many commands as possible from
+ * the current one, returning how many were chained */
+static guint
+at_sequence_build_chained (MMPortSerialAt             *port,
+                           const MMBaseModemAtCommand *current,
+                           GString                    *line,
+                           guint                      *out_timeout)
+{
+    const MMBaseModemAtCommand *command;
+    guint                       timeout = 0;
+    guint                       n = 0;
+
+    for (command = current; command->command; command++) {
+        /* Only commands explicitly flagged as chainable */
+        if (!command->chainable)
+            break;
+        /* A wait before a command breaks the chain */
+        if (n > 0 && command->wait_seconds)
+            break;
+        /* Only commands whose reply is just the final result code, and which
+         * abort the sequence on error, so that a failure anywhere in the
+         * chained command line doesn't change the outcome of the sequence */
+        if (command->response_processor != mm_base_modem_response_processor_no_result_continue ||
+            command->allow_cached)
+            break;
+        /* Known to fail, no need to try the whole command line */
+        if (mm_at_knowledge_is_unsupported (mm_at_knowledge_get (), port, command->command))
+            break;
+        if (!mm_at_command_chain_append (line, command->command))
+            break;
+        timeout += command->timeout;
+        n++;
+    }
+
+    *out_timeout = timeout;
+    return n;
+}
+
+static void at_sequence_process_response (GTask        *task,
+                                          const gchar  *response,
+                                          const GError *command_error);
+
+static void
+at_sequence_run_single (GTask *task)
 {
     AtSequenceContext *ctx;
+    MMAtKnowledge     *knowledge;
 
     ctx = g_task_get_task_data (task);
-    ctx->next_command_wait_id = 0;
+    ctx->n_chained = 1;
+
+    /* Don't wait for an error we already know we'll get, let the response
+     * processor handle it as if it had been received */
+    knowledge = mm_at_knowledge_get ();
+    if (mm_at_knowledge_is_unsupported (knowledge, ctx->port, ctx->current->command)) {
+        g_autoptr(GError) error = NULL;
+
+        mm_obj_dbg (ctx->port, "skipping command known to be unsupported: %s", ctx->current->command);
+        error = g_error_new (MM_MOBILE_EQUIPMENT_ERROR, MM_MOBILE_EQUIPMENT_ERROR_NOT_SUPPORTED,
+                             "Command known to be unsupported");
+        at_sequence_process_response (task, NULL, error);
+        return;
+    }
 
-    /* Schedule the next command in the probing group */
     mm_port_serial_at_command (
         ctx->port,
         ctx->current->command,
-        ctx->current->timeout,
+        mm_at_knowledge_get_timeout (knowledge, ctx->port, ctx->current->command, ctx->current->timeout),
         FALSE,
         ctx->current->allow_cached,
         g_task_get_cancellable (task),
         (GAsyncReadyCallback)at_sequence_parse_response,
         task);
+}
+
+static void
+at_sequence_run_current (GTask *task)
+{
+    AtSequenceContext *ctx;
+    g_autoptr(GString) line = NULL;
+    guint              timeout = 0;
+    guint              n_chained = 0;
+
+    ctx = g_task_get_task_data (task);
+
+    if (ctx->command_chaining) {
+        line = g_string_new (NULL);
+        n_chained = at_sequence_build_chained (ctx->port, ctx->current, line, &timeout);
+    }
+
+    if (n_chained < 2) {
+        at_sequence_run_single (task);
+        return;
+    }
+
+    /* Send all chainable commands in a single command line, saving one
+     * round trip per command */
+    ctx->n_chained = n_chained;
+    mm_port_serial_at_command (
+        ctx->port,
+        line->str,
+        timeout,
+        FALSE,
+        FALSE,
+        g_task_get_cancellable (task),
+        (GAsyncReadyCallback)at_sequence_parse_chained_response,
+        task);
+}
+
+static gboolean
+at_sequence_next_command (GTask *task)
+{
+    AtSequenceContext *ctx;
+
+    ctx = g_task_get_task_data (task);
+    ctx->next_command_wait_id = 0;
+
+    /* Schedule the next command in the probing group */
+    at_sequence_run_current (task);
 
     return G_SOURCE_REMOVE;
 }
 
 static void
-at_sequence_parse_response (MMPortSerialAt    *port,
-                            GAsyncResult      *res,
-                            GTask             *task)
+at_sequence_continue (GTask *task)
 {
-    MMBaseModemAtResponseProcessorResult  processor_result;
-    GVariant                             *result = NULL;
-    GError                               *result_error = NULL;
-    AtSequenceContext                    *ctx;
-    g_autofree gchar                     *response = NULL;
-    g_autoptr(GError)                     command_error = NULL;
+    AtSequenceContext *ctx;
 
-    response = mm_port_serial_at_command_finish (port, res, &command_error);
+    ctx = g_task_get_task_data (task);
+
+    if (ctx->current->command) {
+        g_assert (!ctx->next_command_wait_id);
+        /* Don't bounce through a whole-second timeout if there's nothing to wait */
+        if (ctx->current->wait_seconds)
+            ctx->next_command_wait_id = g_timeout_add_seconds (ctx->current->wait_seconds, (GSourceFunc) at_sequence_next_command, task);
+        else
+            at_sequence_run_current (task);
+        return;
+    }
+
+    /* On last command, end.
+     * transfer-none, the result remains owned by the GTask context */
+    g_task_return_pointer (task, ctx->result, NULL);
+    g_object_unref (task);
+}
+
+static void
+at_sequence_parse_chained_response (MMPortSerialAt *port,
+                                    GAsyncResult   *res,
+                                    GTask          *task)
+{
+    AtSequenceContext *ctx;
+    g_autofree gchar  *response = NULL;
+    g_autoptr(GError)  error = NULL;
+    gint64             send_time;
+
+    response = mm_port_serial_at_command_finish (port, res, &error);
+    send_time = mm_port_serial_at_command_get_send_time (port, res);
 
     /* Cancelled? */
     if (g_task_return_error_if_cancelled (task)) {
@@ -192,6 +323,50 @@ at_sequence_parse_response (MMPortSerialAt    *port,
         return;
     }
 
+    ctx = g_task_get_task_data (task);
+
+    /* On error we don't know which of the chained commands failed, so there
+     * is no support to learn; but a timeout makes all of them forget their
+     * response time. On success, the response time of the whole command line
+     * is an upper bound of the one of each command. */
+    if (send_time &&
+        (!error || g_error_matches (error, MM_SERIAL_ERROR, MM_SERIAL_ERROR_RESPONSE_TIMEOUT))) {
+        MMAtKnowledge *knowledge;
+        gint64         latency;
+        guint          i;
+
+        knowledge = mm_at_knowledge_get ();
+        latency = g_get_monotonic_time () - send_time;
+        for (i = 0; i < ctx->n_chained; i++)
+            mm_at_knowledge_record (knowledge, port, ctx->current[i].command, error, latency);
+    }
+
+    /* Chained commands abort the sequence on error, so fail right away. The
+     * commands can't be retried one by one, as the ones before the failed
+     * one already took effect and may not be run twice. */
+    if (error) {
+        mm_obj_dbg (port, "chained command failed: %s", error->message);
+        g_task_return_error (task, g_steal_pointer (&error));
+        g_object_unref (task);
+        return;
+    }
+
+    /* All chained commands succeeded; their response processors would just
+     * continue with the sequence */
+    ctx->current += ctx->n_chained;
+    at_sequence_continue (task);
+}
+
+static void
+at_sequence_process_response (GTask        *task,
+                              const gchar  *response,
+                              const GError *command_error)
+{
+    MMBaseModemAtResponseProcessorResult  processor_result;
+    GVariant                             *result = NULL;
+    GError                               *result_error = NULL;
+    AtSequenceContext                    *ctx;
+
     ctx = g_task_get_task_data (task);
     if (!ctx->current->response_processor)
         processor_result = MM_BASE_MODEM_AT_RESPONSE_PROCESSOR_RESULT_CONTINUE;
@@ -227,12 +402,8 @@ at_sequence_parse_response (MMPortSerialAt    *port,
 
     if (processor_result == MM_BASE_MODEM_AT_RESPONSE_PROCESSOR_RESULT_CONTINUE) {
         ctx->current++;
-        if (ctx->current->command) {
-            g_assert (!ctx->next_command_wait_id);
-            ctx->next_command_wait_id = g_timeout_add_seconds (ctx->current->wait_seconds, (GSourceFunc) at_sequence_next_command, task);
-            return;
-        }
-        /* On last command, end. */
+        at_sequence_continue (task);
+        return;
     }
 
     /* If we got a response, set it as result */
@@ -245,6 +416,37 @@ at_sequence_parse_response (MMPortSerialAt    *port,
     g_object_unref (task);
 }
 
+static void
+at_sequence_parse_response (MMPortSerialAt    *port,
+                            GAsyncResult      *res,
+                            GTask             *task)
+{
+    AtSequenceContext *ctx;
+    g_autofree gchar  *response = NULL;
+    g_autoptr(GError)  command_error = NULL;
+    gint64             send_time;
+
+    response = mm_port_serial_at_command_finish (port, res, &command_error);
+    send_time = mm_port_serial_at_command_get_send_time (port, res);
+
+    /* Cancelled? */
+    if (g_task_return_error_if_cancelled (task)) {
+        g_object_unref (task);
+        return;
+    }
+
+    /* Replies taken from the cache tell nothing new */
+    ctx = g_task_get_task_data (task);
+    if (send_time)
+        mm_at_knowledge_record (mm_at_knowledge_get (),
+                                port,
+                                ctx->current->command,
+                                command_error,
+                                g_get_monotonic_time () - send_time);
+
+    at_sequence_process_response (task, response, command_error);
+}
+
 static void
 at_sequence_common (MMBaseModem                *self,
                     MMPortSerialAt             *port,
@@ -266,6 +468,7 @@ at_sequence_common (MMBaseModem                *self,
     ctx->current = ctx->sequence = sequence;
     ctx->response_processor_context = response_processor_context;
     ctx->response_processor_context_free = response_processor_context_free;
+    g_object_get (port, MM_PORT_SERIAL_AT_COMMAND_CHAINING, &ctx->command_chaining, NULL);
 
     /* Ensure the cancellable that's already associated with the modem
      * will also get cancelled if the modem wide-one gets cancelled */
@@ -283,15 +486,7 @@ at_sequence_common (MMBaseModem                *self,
     g_task_set_task_data (task, ctx, (GDestroyNotify)at_sequence_context_free);
 
     /* Go on with the first one in the sequence */
-    mm_port_serial_at_command (
-        ctx->port,
-        ctx->current->command,
-        ctx->current->timeout,
-        FALSE,
-        ctx->current->allow_cached,
-        g_task_get_cancellable (task),
-        (GAsyncReadyCallback)at_sequence_parse_response,
-        task);
+    at_sequence_run_current (task);
 }
 
 void
@@ -489,6 +684,7 @@ typedef struct {
     MMPortSerialAt *port;
     gulong cancelled_id;
     GCancellable *parent_cancellable;
+    gchar *command;
     gchar *response;
 } AtCommandContext;
 
@@ -504,6 +700,7 @@ at_command_context_free (AtCommandContext *ctx)
     }
 
     g_object_unref (ctx->port);
+    g_free (ctx->command);
     g_free (ctx->response);
     g_free (ctx);
 }
@@ -523,11 +720,13 @@ at_command_ready (MMPortSerialAt *port,
 {
     AtCommandContext  *ctx;
     g_autoptr(GError)  command_error = NULL;
+    gint64             send_time;
 
     ctx = g_task_get_task_data (task);
 
     g_assert (!ctx->response);
     ctx->response = mm_port_serial_at_command_finish (port, res, &command_error);
+    send_time = mm_port_serial_at_command_get_send_time (port, res);
 
     /* Cancelled? */
     if (g_task_return_error_if_cancelled (task)) {
@@ -535,6 +734,15 @@ at_command_ready (MMPortSerialAt *port,
         return;
     }
 
+    /* Raw commands are not tracked, and replies taken from the cache tell
+     * nothing new */
+    if (ctx->command && send_time)
+        mm_at_knowledge_record (mm_at_knowledge_get (),
+                                port,
+                                ctx->command,
+                                command_error,
+                                g_get_monotonic_time () - send_time);
+
     /* Error coming from the serial port? */
     if (command_error)
         g_task_return_error (task, g_steal_pointer (&command_error));
@@ -558,11 +766,24 @@ at_command_common (MMBaseModem *self,
                    GCancellable *parent_cancellable)
 {
     AtCommandContext *ctx;
+    MMAtKnowledge    *knowledge;
 
     /* Ensure that we have an open port */
     if (!abort_task_if_port_unusable (self, port, task))
         return;
 
+    knowledge = mm_at_knowledge_get ();
+    if (!is_raw && mm_at_knowledge_is_unsupported (knowledge, port, command)) {
+        mm_obj_dbg (port, "skipping command known to be unsupported: %s", command);
+        mm_port_serial_close (MM_PORT_SERIAL (port));
+        g_task_return_new_error (task,
+                                 MM_MOBILE_EQUIPMENT_ERROR,
+                                 MM_MOBILE_EQUIPMENT_ERROR_NOT_SUPPORTED,
+                                 "Command known to be unsupported");
+        g_object_unref (task);
+        return;
+    }
+
     ctx = g_new0 (AtCommandContext, 1);
     ctx->port = g_object_ref (port);
 
@@ -581,6 +802,11 @@ at_command_common (MMBaseModem *self,
 
     g_task_set_task_data (task, ctx, (GDestroyNotify)at_command_context_free);
 
+    if (!is_raw) {
+        ctx->command = g_strdup (command);
+        timeout = mm_at_knowledge_get_timeout (knowledge, port, command, timeout);
+    }
+
     /* Go on with the command */
     mm_port_serial_at_command (
         port,
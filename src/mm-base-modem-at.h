@@ -69,6 +69,9 @@ typedef struct {
     MMBaseModemAtResponseProcessor response_processor;
     /* Time to wait before sending this command (in seconds) */
     guint wait_seconds;
+    /* Flag to allow sending the command in a single command line together
+     * with the adjacent chainable commands, if the port supports chaining */
+    gboolean chainable;
 } MMBaseModemAtCommand;
 
 /* Generic AT sequence handling, using the best AT port available and without
@@ -216,6 +219,7 @@ typedef struct {
     gboolean  allow_cached;
     MMBaseModemAtResponseProcessor response_processor;
     guint     wait_seconds;
+    gboolean  chainable;
 } MMBaseModemAtCommandAlloc;
 
 G_STATIC_ASSERT (sizeof (MMBaseModemAtCommandAlloc) == sizeof (MMBaseModemAtCommand));
@@ -223,6 +227,8 @@ G_STATIC_ASSERT (G_STRUCT_OFFSET (MMBaseModemAtCommandAlloc, command)
 G_STATIC_ASSERT (G_STRUCT_OFFSET (MMBaseModemAtCommandAlloc, timeout)            == G_STRUCT_OFFSET (MMBaseModemAtCommand, timeout));
 G_STATIC_ASSERT (G_STRUCT_OFFSET (MMBaseModemAtCommandAlloc, allow_cached)       == G_STRUCT_OFFSET (MMBaseModemAtCommand, allow_cached));
 G_STATIC_ASSERT (G_STRUCT_OFFSET (MMBaseModemAtCommandAlloc, response_processor) == G_STRUCT_OFFSET (MMBaseModemAtCommand, response_processor));
+G_STATIC_ASSERT (G_STRUCT_OFFSET (MMBaseModemAtCommandAlloc, wait_seconds)       == G_STRUCT_OFFSET (MMBaseModemAtCommand, wait_seconds));
+G_STATIC_ASSERT (G_STRUCT_OFFSET (MMBaseModemAtCommandAlloc, chainable)          == G_STRUCT_OFFSET (MMBaseModemAtCommand, chainable));
 
 void mm_base_modem_at_command_alloc_clear (MMBaseModemAtCommandAlloc *command);
 
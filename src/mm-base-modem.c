@@ -426,6 +426,7 @@ base_modem_internal_grab_port (MMBaseModem         *self,
     if (MM_IS_PORT_SERIAL_AT (port)) {
         mm_port_serial_at_set_response_parser (MM_PORT_SERIAL_AT (port),
                                                mm_serial_parser_v1_parse,
+                                               mm_serial_parser_v1_reset,
                                                mm_serial_parser_v1_new (),
                                                mm_serial_parser_v1_destroy);
         /* Prefer plugin-provided flags to the generic ones */
@@ -1239,6 +1240,22 @@ mm_base_modem_find_ports (MMBaseModem  *self,
     return g_list_sort (out, (GCompareFunc) port_cmp);
 }
 
+void
+mm_base_modem_clear_cached_replies (MMBaseModem *self)
+{
+    GHashTableIter iter;
+    gpointer       value;
+
+    if (!self->priv->ports)
+        return;
+
+    g_hash_table_iter_init (&iter, self->priv->ports);
+    while (g_hash_table_iter_next (&iter, NULL, &value)) {
+        if (MM_IS_PORT_SERIAL (value))
+            mm_port_serial_clear_cached_replies (MM_PORT_SERIAL (value));
+    }
+}
+
 static MMPort *
 peek_port_in_ht (GHashTable  *ht,
                  const gchar *name)
@@ -191,6 +191,10 @@ MMPort           *mm_base_modem_peek_port             (MMBaseModem  *self,
 MMPort           *mm_base_modem_get_port              (MMBaseModem  *self,
                                                        const gchar  *name);
 
+/* Drop the cached replies of all serial ports, to be used whenever the
+ * device state changes (e.g. SIM swap, power state change) */
+void              mm_base_modem_clear_cached_replies  (MMBaseModem  *self);
+
 void     mm_base_modem_set_hotplugged (MMBaseModem *self,
                                        gboolean hotplugged);
 gboolean mm_base_modem_get_hotplugged (MMBaseModem *self);
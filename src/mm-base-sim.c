@@ -34,6 +34,7 @@
 #include "mm-log-object.h"
 #include "mm-modem-helpers.h"
 #include "mm-error-helpers.h"
+#include "mm-sim-cache.h"
 
 static void async_initable_iface_init (GAsyncInitableIface *iface);
 static void log_object_iface_init     (MMLogObjectInterface *iface);
@@ -1461,7 +1462,7 @@ set_preferred_networks (MMBaseSim *self,
         self->priv->modem,
         "+CPOL=?",
         20,
-        FALSE, /* Do not cache, the response depends on SIM card properties */
+        TRUE, /* Depends on SIM card properties, cached replies are cleared on SIM swap */
         (GAsyncReadyCallback)set_preferred_networks_query_sim_capacity_ready,
         task);
 }
@@ -2380,6 +2381,7 @@ typedef enum {
     INITIALIZATION_STEP_SIM_TYPE,
     INITIALIZATION_STEP_ESIM_STATUS,
     INITIALIZATION_STEP_SIM_IDENTIFIER,
+    INITIALIZATION_STEP_CACHED_CONTENTS,
     INITIALIZATION_STEP_IMSI,
     INITIALIZATION_STEP_OPERATOR_ID,
     INITIALIZATION_STEP_OPERATOR_NAME,
@@ -2395,6 +2397,10 @@ typedef enum {
 struct _InitAsyncContext {
     InitializationStep step;
     guint sim_identifier_tries;
+    /* Whether the SIM contents were loaded from the cache */
+    gboolean cache_loaded;
+    /* Whether the contents are being reloaded to revalidate the cache */
+    gboolean revalidate;
 };
 
 MMBaseSim *
@@ -2425,6 +2431,33 @@ initable_init_finish (GAsyncInitable  *initable,
     return g_task_propagate_boolean (G_TASK (result), error);
 }
 
+/* Contents of a locked SIM can't be read, so they are neither taken from
+ * nor stored in the cache until it's unlocked */
+static gboolean
+sim_is_unlocked (MMBaseSim *self)
+{
+    return (self->priv->modem &&
+            mm_iface_modem_get_unlock_required (MM_IFACE_MODEM (self->priv->modem)) == MM_MODEM_LOCK_NONE);
+}
+
+/* When revalidating, a cached value is only kept if it couldn't be loaded
+ * because of a transient error; otherwise it's cleared like any other
+ * value that failed to load */
+static gboolean
+cached_value_kept (InitAsyncContext *ctx,
+                   const GError     *error)
+{
+    if (!ctx->revalidate || !error)
+        return FALSE;
+
+    return (error->domain == MM_SERIAL_ERROR ||
+            g_error_matches (error, MM_CORE_ERROR, MM_CORE_ERROR_TIMEOUT) ||
+            g_error_matches (error, MM_CORE_ERROR, MM_CORE_ERROR_RETRY) ||
+            g_error_matches (error, MM_CORE_ERROR, MM_CORE_ERROR_IN_PROGRESS) ||
+            g_error_matches (error, MM_CORE_ERROR, MM_CORE_ERROR_THROTTLED) ||
+            g_error_matches (error, MM_MOBILE_EQUIPMENT_ERROR, MM_MOBILE_EQUIPMENT_ERROR_SIM_BUSY));
+}
+
 #undef COMMON_STR_REPLY_READY_FN
 #define COMMON_STR_REPLY_READY_FN(NAME,DISPLAY,VALUE_FORMAT)                              \
     static void                                                                           \
@@ -2436,8 +2469,10 @@ initable_init_finish (GAsyncInitable  *initable,
         g_autoptr(GError)  error = NULL;                                                  \
         g_autofree gchar  *val = NULL;                                                    \
                                                                                           \
+        ctx = g_task_get_task_data (task);                                                \
         val = MM_BASE_SIM_GET_CLASS (self)->load_##NAME##_finish (self, res, &error);     \
-        mm_gdbus_sim_set_##NAME (MM_GDBUS_SIM (self), val);                               \
+        if (!cached_value_kept (ctx, error))                                              \
+            mm_gdbus_sim_set_##NAME (MM_GDBUS_SIM (self), val);                           \
                                                                                           \
         if (error)                                                                        \
             mm_obj_dbg (self, "couldn't load %s: %s", DISPLAY, error->message);           \
@@ -2445,7 +2480,6 @@ initable_init_finish (GAsyncInitable  *initable,
             mm_obj_info (self, "loaded %s: %s", DISPLAY, VALUE_FORMAT (val));             \
                                                                                           \
         /* Go on to next step */                                                          \
-        ctx = g_task_get_task_data (task);                                                \
         ctx->step++;                                                                      \
         interface_initialization_step (task);                                             \
     }
@@ -2492,14 +2526,16 @@ initable_init_finish (GAsyncInitable  *initable,
         g_autoptr(GError)      error = NULL;                                      \
         g_autoptr(GByteArray)  bytearray = NULL;                                  \
                                                                                   \
+        ctx = g_task_get_task_data (task);                                        \
         bytearray = MM_BASE_SIM_GET_CLASS (self)->load_##NAME##_finish (self, res, &error); \
-        mm_gdbus_sim_set_##NAME (MM_GDBUS_SIM (self),                             \
-                                 (bytearray ?                                     \
-                                  g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE, \
-                                                             bytearray->data,     \
-                                                             bytearray->len,      \
-                                                             sizeof (guint8)) :   \
-                                  NULL));                                         \
+        if (!cached_value_kept (ctx, error))                                      \
+            mm_gdbus_sim_set_##NAME (MM_GDBUS_SIM (self),                         \
+                                     (bytearray ?                                 \
+                                      g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE, \
+                                                                 bytearray->data, \
+                                                                 bytearray->len,  \
+                                                                 sizeof (guint8)) : \
+                                      NULL));                                     \
                                                                                   \
         if (error)                                                                \
             mm_obj_dbg (self, "couldn't load %s: %s", DISPLAY, error->message);   \
@@ -2511,7 +2547,6 @@ initable_init_finish (GAsyncInitable  *initable,
         }                                                                         \
                                                                                   \
         /* Go on to next step */                                                  \
-        ctx = g_task_get_task_data (task);                                        \
         ctx->step++;                                                              \
         interface_initialization_step (task);                                     \
     }
@@ -2530,6 +2565,7 @@ init_load_preferred_networks_ready (MMBaseSim    *self,
     g_autoptr(GError)  error = NULL;
     GList             *preferred_nets_list;
 
+    ctx = g_task_get_task_data (task);
     preferred_nets_list = MM_BASE_SIM_GET_CLASS (self)->load_preferred_networks_finish (self, res, &error);
     if (error)
         mm_obj_dbg (self, "couldn't load list of preferred networks: %s", error->message);
@@ -2550,13 +2586,13 @@ init_load_preferred_networks_ready (MMBaseSim    *self,
         mm_obj_info (self, "loaded list of preferred networks: %s", str->str);
     }
 
-    mm_gdbus_sim_set_preferred_networks (MM_GDBUS_SIM (self),
-                                         mm_sim_preferred_network_list_get_variant (preferred_nets_list));
+    if (!cached_value_kept (ctx, error))
+        mm_gdbus_sim_set_preferred_networks (MM_GDBUS_SIM (self),
+                                             mm_sim_preferred_network_list_get_variant (preferred_nets_list));
 
     g_list_free_full (preferred_nets_list, (GDestroyNotify) mm_sim_preferred_network_free);
 
     /* Go on to next step */
-    ctx = g_task_get_task_data (task);
     ctx->step++;
     interface_initialization_step (task);
 }
@@ -2570,6 +2606,7 @@ init_load_emergency_numbers_ready (MMBaseSim    *self,
     g_autoptr(GError)  error = NULL;
     g_auto(GStrv)      str_list = NULL;
 
+    ctx = g_task_get_task_data (task);
     str_list = MM_BASE_SIM_GET_CLASS (self)->load_emergency_numbers_finish (self, res, &error);
     if (error)
         mm_obj_dbg (self, "couldn't load list of emergency numbers: %s", error->message);
@@ -2583,10 +2620,10 @@ init_load_emergency_numbers_ready (MMBaseSim    *self,
         mm_obj_info (self, "loaded list of emergency numbers: %s", str->str);
     }
 
-    mm_gdbus_sim_set_emergency_numbers (MM_GDBUS_SIM (self), (const gchar *const *) str_list);
+    if (!cached_value_kept (ctx, error))
+        mm_gdbus_sim_set_emergency_numbers (MM_GDBUS_SIM (self), (const gchar *const *) str_list);
 
     /* Go on to next step */
-    ctx = g_task_get_task_data (task);
     ctx->step++;
     interface_initialization_step (task);
 }
@@ -2635,6 +2672,42 @@ init_load_sim_identifier_ready (MMBaseSim *self,
 ENUM_REPLY_READY_FN (esim_status, "esim status", MMSimEsimStatus, mm_sim_esim_status_get_string)
 ENUM_REPLY_READY_FN (sim_type,    "sim type",    MMSimType,       mm_sim_type_get_string)
 
+static void
+revalidate_cached_contents_ready (MMBaseSim    *self,
+                                  GAsyncResult *res)
+{
+    g_autoptr(GError) error = NULL;
+
+    if (!g_task_propagate_boolean (G_TASK (res), &error))
+        mm_obj_dbg (self, "couldn't revalidate cached SIM contents: %s", error->message);
+}
+
+static void
+revalidate_cached_contents (MMBaseSim *self)
+{
+    InitAsyncContext *ctx;
+    GTask            *task;
+
+    mm_obj_dbg (self, "revalidating cached SIM contents...");
+
+    /* Everything that may come from the cache is loaded again, and the
+     * cache is updated once done */
+    ctx = g_new0 (InitAsyncContext, 1);
+    ctx->step = INITIALIZATION_STEP_IMSI;
+    ctx->revalidate = TRUE;
+
+    task = g_task_new (self, NULL, (GAsyncReadyCallback) revalidate_cached_contents_ready, NULL);
+    g_task_set_task_data (task, ctx, g_free);
+
+    interface_initialization_step (task);
+}
+
+void
+mm_base_sim_forget_cached_contents (MMBaseSim *self)
+{
+    mm_sim_cache_forget (mm_sim_cache_get (), mm_gdbus_sim_get_sim_identifier (MM_GDBUS_SIM (self)));
+}
+
 static void
 init_wait_sim_ready (MMBaseSim    *self,
                      GAsyncResult *res,
@@ -2730,13 +2803,24 @@ interface_initialization_step (GTask *task)
         ctx->step++;
         /* Fall through */
 
+    case INITIALIZATION_STEP_CACHED_CONTENTS:
+        /* Contents of a known SIM are taken from the cache right away, and
+         * revalidated in the background once the initialization is done */
+        if (sim_is_unlocked (self) &&
+            mm_sim_cache_load (mm_sim_cache_get (), MM_GDBUS_SIM (self))) {
+            mm_obj_info (self, "using cached SIM contents");
+            ctx->cache_loaded = TRUE;
+        }
+        ctx->step++;
+        /* Fall through */
+
     case INITIALIZATION_STEP_IMSI:
         /* Don't load SIM IMSI if the SIM is known to be an eSIM without
          * profiles; otherwise (if physical SIM, or if eSIM with profile, or if
          * SIM type unknown) try to load it. */
         if (IS_ESIM_WITHOUT_PROFILES (self))
             mm_obj_dbg (self, "not loading IMSI in eSIM without profiles");
-        else if (mm_gdbus_sim_get_imsi (MM_GDBUS_SIM (self)) == NULL &&
+        else if ((ctx->revalidate || mm_gdbus_sim_get_imsi (MM_GDBUS_SIM (self)) == NULL) &&
                  MM_BASE_SIM_GET_CLASS (self)->load_imsi &&
                  MM_BASE_SIM_GET_CLASS (self)->load_imsi_finish) {
             MM_BASE_SIM_GET_CLASS (self)->load_imsi (
@@ -2754,7 +2838,7 @@ interface_initialization_step (GTask *task)
          * SIM type unknown) try to load it. */
         if (IS_ESIM_WITHOUT_PROFILES (self))
             mm_obj_dbg (self, "not loading operator ID in eSIM without profiles");
-        else if (mm_gdbus_sim_get_operator_identifier (MM_GDBUS_SIM (self)) == NULL &&
+        else if ((ctx->revalidate || mm_gdbus_sim_get_operator_identifier (MM_GDBUS_SIM (self)) == NULL) &&
                  MM_BASE_SIM_GET_CLASS (self)->load_operator_identifier &&
                  MM_BASE_SIM_GET_CLASS (self)->load_operator_identifier_finish) {
             MM_BASE_SIM_GET_CLASS (self)->load_operator_identifier (
@@ -2772,7 +2856,7 @@ interface_initialization_step (GTask *task)
          * SIM type unknown) try to load it. */
         if (IS_ESIM_WITHOUT_PROFILES (self))
             mm_obj_dbg (self, "not loading operator name in eSIM without profiles");
-        else if (mm_gdbus_sim_get_operator_name (MM_GDBUS_SIM (self)) == NULL &&
+        else if ((ctx->revalidate || mm_gdbus_sim_get_operator_name (MM_GDBUS_SIM (self)) == NULL) &&
                  MM_BASE_SIM_GET_CLASS (self)->load_operator_name &&
                  MM_BASE_SIM_GET_CLASS (self)->load_operator_name_finish) {
             MM_BASE_SIM_GET_CLASS (self)->load_operator_name (
@@ -2790,7 +2874,7 @@ interface_initialization_step (GTask *task)
          * SIM type unknown) try to load it. */
         if (IS_ESIM_WITHOUT_PROFILES (self))
             mm_obj_dbg (self, "not loading emergency numbers in eSIM without profiles");
-        else if (mm_gdbus_sim_get_emergency_numbers (MM_GDBUS_SIM (self)) == NULL &&
+        else if ((ctx->revalidate || mm_gdbus_sim_get_emergency_numbers (MM_GDBUS_SIM (self)) == NULL) &&
                  MM_BASE_SIM_GET_CLASS (self)->load_emergency_numbers &&
                  MM_BASE_SIM_GET_CLASS (self)->load_emergency_numbers_finish) {
             MM_BASE_SIM_GET_CLASS (self)->load_emergency_numbers (
@@ -2808,7 +2892,7 @@ interface_initialization_step (GTask *task)
          * SIM type unknown) try to load it. */
         if (IS_ESIM_WITHOUT_PROFILES (self))
             mm_obj_dbg (self, "not loading preferred networks in eSIM without profiles");
-        else if (mm_gdbus_sim_get_preferred_networks (MM_GDBUS_SIM (self)) == NULL &&
+        else if ((ctx->revalidate || mm_gdbus_sim_get_preferred_networks (MM_GDBUS_SIM (self)) == NULL) &&
                  MM_BASE_SIM_GET_CLASS (self)->load_preferred_networks &&
                  MM_BASE_SIM_GET_CLASS (self)->load_preferred_networks_finish) {
             MM_BASE_SIM_GET_CLASS (self)->load_preferred_networks (
@@ -2826,7 +2910,7 @@ interface_initialization_step (GTask *task)
          * SIM type unknown) try to load it. */
         if (IS_ESIM_WITHOUT_PROFILES (self))
             mm_obj_dbg (self, "not loading GID1 in eSIM without profiles");
-        else if (mm_gdbus_sim_get_gid1 (MM_GDBUS_SIM (self)) == NULL &&
+        else if ((ctx->revalidate || mm_gdbus_sim_get_gid1 (MM_GDBUS_SIM (self)) == NULL) &&
                  MM_BASE_SIM_GET_CLASS (self)->load_gid1 &&
                  MM_BASE_SIM_GET_CLASS (self)->load_gid1_finish) {
             MM_BASE_SIM_GET_CLASS (self)->load_gid1 (
@@ -2844,7 +2928,7 @@ interface_initialization_step (GTask *task)
          * SIM type unknown) try to load it. */
         if (IS_ESIM_WITHOUT_PROFILES (self))
             mm_obj_dbg (self, "not loading GID2 in eSIM without profiles");
-        else if (mm_gdbus_sim_get_gid2 (MM_GDBUS_SIM (self)) == NULL &&
+        else if ((ctx->revalidate || mm_gdbus_sim_get_gid2 (MM_GDBUS_SIM (self)) == NULL) &&
                  MM_BASE_SIM_GET_CLASS (self)->load_gid2 &&
                  MM_BASE_SIM_GET_CLASS (self)->load_gid2_finish) {
             MM_BASE_SIM_GET_CLASS (self)->load_gid2 (
@@ -2861,7 +2945,7 @@ interface_initialization_step (GTask *task)
          * (if eSIM with or without profiles) try to load it. */
         if (IS_PSIM (self))
             mm_obj_dbg (self, "not loading EID in physical SIM");
-        else if (mm_gdbus_sim_get_eid (MM_GDBUS_SIM (self)) == NULL &&
+        else if ((ctx->revalidate || mm_gdbus_sim_get_eid (MM_GDBUS_SIM (self)) == NULL) &&
                  MM_BASE_SIM_GET_CLASS (self)->load_eid &&
                  MM_BASE_SIM_GET_CLASS (self)->load_eid_finish) {
             MM_BASE_SIM_GET_CLASS (self)->load_eid (
@@ -2889,6 +2973,11 @@ interface_initialization_step (GTask *task)
         /* Fall through */
 
     case INITIALIZATION_STEP_LAST:
+        if (ctx->cache_loaded)
+            revalidate_cached_contents (self);
+        else if (sim_is_unlocked (self))
+            mm_sim_cache_store (mm_sim_cache_get (), MM_GDBUS_SIM (self));
+
         /* We are done without errors! */
         g_task_return_boolean (task, TRUE);
         g_object_unref (task);
@@ -2914,9 +3003,8 @@ common_init_async (GAsyncInitable *initable,
 
     self = MM_BASE_SIM (initable);
 
-    ctx = g_new (InitAsyncContext, 1);
+    ctx = g_new0 (InitAsyncContext, 1);
     ctx->step = INITIALIZATION_STEP_FIRST;
-    ctx->sim_identifier_tries = 0;
 
     task = g_task_new (self, cancellable, callback, user_data);
     g_task_set_task_data (task, ctx, g_free);
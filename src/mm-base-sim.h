@@ -272,4 +272,8 @@ gboolean     mm_base_sim_is_emergency_number (MMBaseSim   *self,
 
 gboolean     mm_base_sim_is_esim_without_profiles (MMBaseSim *self);
 
+/* Drop the cached contents of the SIM, e.g. when the card reports that
+ * its files have changed */
+void         mm_base_sim_forget_cached_contents (MMBaseSim *self);
+
 #endif /* MM_BASE_SIM_H */
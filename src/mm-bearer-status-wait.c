@@ -0,0 +1,389 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ModemManager.h>
+#include <libmm-glib.h>
+
+#include "mm-daemon-enums-types.h"
+#include "mm-log-object.h"
+#include "mm-bearer-status-wait.h"
+
+#define MAX_CHECK_FAILURES 10
+#define LATENCY_SAMPLES    64
+
+typedef struct {
+    guint samples[LATENCY_SAMPLES];
+    guint n_samples;
+    guint next;
+} LatencyHistory;
+
+struct _MMBearerStatusWait {
+    gpointer        source;
+    guint           initial_interval_ms;
+    guint           max_interval_ms;
+    /* Ongoing wait, if any */
+    GTask          *task;
+    /* Index 0 for connections, 1 for disconnections */
+    LatencyHistory  latencies[2];
+};
+
+typedef struct {
+    MMBearerStatusWait              *wait;
+    MMBearerConnectionStatus         status;
+    MMBearerStatusWaitCheckFn        check;
+    MMBearerStatusWaitCheckFinishFn  check_finish;
+    gpointer                         check_data;
+    gint64                           start;
+    gint64                           deadline;
+    guint                            interval_ms;
+    guint                            timeout_id;
+    gulong                           cancelled_id;
+    guint                            cancelled_idle_id;
+    guint                            n_checks;
+    guint                            n_check_failures;
+} StatusWaitContext;
+
+static void
+status_wait_context_free (StatusWaitContext *ctx)
+{
+    g_assert (!ctx->timeout_id);
+    g_assert (!ctx->cancelled_id);
+    g_assert (!ctx->cancelled_idle_id);
+    g_slice_free (StatusWaitContext, ctx);
+}
+
+/*****************************************************************************/
+
+static gint
+latency_cmp (gconstpointer a,
+             gconstpointer b)
+{
+    guint la = *((const guint *) a);
+    guint lb = *((const guint *) b);
+
+    return (la > lb) - (la < lb);
+}
+
+static void
+report_latency (MMBearerStatusWait *self,
+                StatusWaitContext  *ctx,
+                guint               latency_ms,
+                const gchar        *source)
+{
+    LatencyHistory *history;
+    guint           sorted[LATENCY_SAMPLES];
+
+    history = &self->latencies[ctx->status == MM_BEARER_CONNECTION_STATUS_CONNECTED ? 0 : 1];
+    history->samples[history->next] = latency_ms;
+    history->next = (history->next + 1) % LATENCY_SAMPLES;
+    history->n_samples = MIN (history->n_samples + 1, LATENCY_SAMPLES);
+
+    memcpy (sorted, history->samples, history->n_samples * sizeof (guint));
+    qsort (sorted, history->n_samples, sizeof (guint), latency_cmp);
+
+    mm_obj_dbg (self->source, "%s after %ums (%s, %u status checks); latency p50/p90/p99 over last %u attempts: %u/%u/%ums",
+                mm_bearer_connection_status_get_string (ctx->status),
+                latency_ms, source, ctx->n_checks, history->n_samples,
+                sorted[(history->n_samples - 1) * 50 / 100],
+                sorted[(history->n_samples - 1) * 90 / 100],
+                sorted[(history->n_samples - 1) * 99 / 100]);
+}
+
+static void
+complete (MMBearerStatusWait *self,
+          GError             *error,
+          const gchar        *source)
+{
+    GTask             *task;
+    StatusWaitContext *ctx;
+    guint              latency_ms;
+
+    task = g_steal_pointer (&self->task);
+    g_assert (task);
+    ctx = g_task_get_task_data (task);
+
+    if (ctx->timeout_id) {
+        g_source_remove (ctx->timeout_id);
+        ctx->timeout_id = 0;
+    }
+    if (ctx->cancelled_idle_id) {
+        g_source_remove (ctx->cancelled_idle_id);
+        ctx->cancelled_idle_id = 0;
+    }
+    if (ctx->cancelled_id) {
+        g_cancellable_disconnect (g_task_get_cancellable (task), ctx->cancelled_id);
+        ctx->cancelled_id = 0;
+    }
+
+    latency_ms = (guint) ((g_get_monotonic_time () - ctx->start) / 1000);
+    if (error) {
+        mm_obj_dbg (self->source, "waiting for %s status failed after %ums: %s",
+                    mm_bearer_connection_status_get_string (ctx->status), latency_ms, error->message);
+        g_task_return_error (task, error);
+    } else {
+        report_latency (self, ctx, latency_ms, source);
+        g_task_return_boolean (task, TRUE);
+    }
+    g_object_unref (task);
+}
+
+static gboolean check_cb (MMBearerStatusWait *self);
+
+static void
+schedule_check (MMBearerStatusWait *self,
+                StatusWaitContext  *ctx)
+{
+    gint64 remaining_ms;
+
+    g_assert (!ctx->timeout_id);
+
+    /* Never sleep past the deadline, so that there is always a last check */
+    remaining_ms = MAX (0, (ctx->deadline - g_get_monotonic_time ()) / 1000);
+    ctx->timeout_id = g_timeout_add ((guint) MIN ((gint64) ctx->interval_ms, remaining_ms),
+                                     (GSourceFunc) check_cb,
+                                     self);
+    ctx->interval_ms = MIN (ctx->interval_ms * 2, self->max_interval_ms);
+}
+
+static void
+check_ready (gpointer      source,
+             GAsyncResult *res,
+             GTask        *task)
+{
+    MMBearerStatusWait       *self;
+    StatusWaitContext        *ctx;
+    MMBearerConnectionStatus  status;
+    GError                   *error = NULL;
+
+    ctx = g_task_get_task_data (task);
+    self = ctx->wait;
+
+    status = ctx->check_finish (source, res, &error);
+
+    /* Already completed, e.g. by an unsolicited status report */
+    if (self->task != task) {
+        g_clear_error (&error);
+        g_object_unref (task);
+        return;
+    }
+    g_object_unref (task);
+
+    if (status == ctx->status) {
+        g_clear_error (&error);
+        complete (self, NULL, "status check");
+        return;
+    }
+
+    if (status == MM_BEARER_CONNECTION_STATUS_UNKNOWN) {
+        ctx->n_check_failures++;
+        mm_obj_dbg (self->source, "couldn't check bearer status: %s (%u failures so far)",
+                    error ? error->message : "unknown error", ctx->n_check_failures);
+        if (ctx->n_check_failures > MAX_CHECK_FAILURES) {
+            if (!error)
+                error = g_error_new (MM_CORE_ERROR, MM_CORE_ERROR_FAILED, "Couldn't check bearer status");
+            complete (self, error, NULL);
+            return;
+        }
+    } else {
+        ctx->n_check_failures = 0;
+        if (status == MM_BEARER_CONNECTION_STATUS_CONNECTION_FAILED &&
+            ctx->status == MM_BEARER_CONNECTION_STATUS_CONNECTED) {
+            g_clear_error (&error);
+            complete (self,
+                      g_error_new (MM_CORE_ERROR, MM_CORE_ERROR_FAILED, "Connection attempt failed"),
+                      NULL);
+            return;
+        }
+    }
+    g_clear_error (&error);
+
+    if (g_get_monotonic_time () >= ctx->deadline) {
+        complete (self,
+                  g_error_new (MM_MOBILE_EQUIPMENT_ERROR,
+                               MM_MOBILE_EQUIPMENT_ERROR_NETWORK_TIMEOUT,
+                               "Timed out waiting for the bearer to get %s",
+                               mm_bearer_connection_status_get_string (ctx->status)),
+                  NULL);
+        return;
+    }
+
+    schedule_check (self, ctx);
+}
+
+static gboolean
+check_cb (MMBearerStatusWait *self)
+{
+    StatusWaitContext *ctx;
+
+    g_assert (self->task);
+    ctx = g_task_get_task_data (self->task);
+    ctx->timeout_id = 0;
+
+    ctx->n_checks++;
+    ctx->check (self->source,
+                ctx->check_data,
+                (GAsyncReadyCallback) check_ready,
+                g_object_ref (self->task));
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean
+cancelled_idle_cb (MMBearerStatusWait *self)
+{
+    StatusWaitContext *ctx;
+    GError            *error = NULL;
+
+    g_assert (self->task);
+    ctx = g_task_get_task_data (self->task);
+    ctx->cancelled_idle_id = 0;
+
+    g_cancellable_set_error_if_cancelled (g_task_get_cancellable (self->task), &error);
+    g_assert (error);
+    complete (self, error, NULL);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+cancelled_cb (GCancellable       *cancellable,
+              MMBearerStatusWait *self)
+{
+    StatusWaitContext *ctx;
+
+    /* The handler can't be disconnected from within itself, so complete in
+     * an idle */
+    ctx = g_task_get_task_data (self->task);
+    if (!ctx->cancelled_idle_id)
+        ctx->cancelled_idle_id = g_idle_add ((GSourceFunc) cancelled_idle_cb, self);
+}
+
+/*****************************************************************************/
+
+gboolean
+mm_bearer_status_wait_is_running (MMBearerStatusWait *self)
+{
+    return !!self->task;
+}
+
+gboolean
+mm_bearer_status_wait_report (MMBearerStatusWait       *self,
+                              MMBearerConnectionStatus  status)
+{
+    StatusWaitContext *ctx;
+
+    if (!self->task)
+        return FALSE;
+
+    ctx = g_task_get_task_data (self->task);
+
+    if (status == ctx->status) {
+        complete (self, NULL, "unsolicited message");
+        return TRUE;
+    }
+
+    if (status == MM_BEARER_CONNECTION_STATUS_CONNECTION_FAILED &&
+        ctx->status == MM_BEARER_CONNECTION_STATUS_CONNECTED) {
+        complete (self,
+                  g_error_new (MM_CORE_ERROR, MM_CORE_ERROR_FAILED, "Connection attempt failed"),
+                  NULL);
+        return TRUE;
+    }
+
+    /* Any other report may be stale (e.g. sent before our request was
+     * processed), so just check right away and restart the backoff; unless
+     * still within the first check delay. If a check is already in flight
+     * (no timeout scheduled), its result is awaited, and only the next check
+     * is scheduled with the restarted backoff. */
+    if (ctx->timeout_id && ctx->n_checks > 0) {
+        g_source_remove (ctx->timeout_id);
+        ctx->timeout_id = g_idle_add ((GSourceFunc) check_cb, self);
+    }
+    ctx->interval_ms = self->initial_interval_ms;
+    return FALSE;
+}
+
+gboolean
+mm_bearer_status_wait_run_finish (GAsyncResult  *res,
+                                  GError       **error)
+{
+    return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+void
+mm_bearer_status_wait_run (MMBearerStatusWait              *self,
+                           MMBearerConnectionStatus         status,
+                           guint                            first_check_delay_ms,
+                           guint                            timeout_ms,
+                           MMBearerStatusWaitCheckFn        check,
+                           MMBearerStatusWaitCheckFinishFn  check_finish,
+                           gpointer                         check_data,
+                           GCancellable                    *cancellable,
+                           GAsyncReadyCallback              callback,
+                           gpointer                         user_data)
+{
+    StatusWaitContext *ctx;
+
+    g_assert (status == MM_BEARER_CONNECTION_STATUS_CONNECTED ||
+              status == MM_BEARER_CONNECTION_STATUS_DISCONNECTED);
+    g_assert (!self->task);
+
+    ctx = g_slice_new0 (StatusWaitContext);
+    ctx->wait = self;
+    ctx->status = status;
+    ctx->check = check;
+    ctx->check_finish = check_finish;
+    ctx->check_data = check_data;
+    ctx->start = g_get_monotonic_time ();
+    ctx->deadline = ctx->start + (gint64) timeout_ms * 1000;
+    ctx->interval_ms = self->initial_interval_ms;
+
+    self->task = g_task_new (self->source, cancellable, callback, user_data);
+    g_task_set_task_data (self->task, ctx, (GDestroyNotify) status_wait_context_free);
+
+    /* The status may have been reported before the wait started, so don't
+     * wait for the backoff before the first check */
+    if (first_check_delay_ms)
+        ctx->timeout_id = g_timeout_add (first_check_delay_ms, (GSourceFunc) check_cb, self);
+    else
+        ctx->timeout_id = g_idle_add ((GSourceFunc) check_cb, self);
+
+    if (cancellable)
+        ctx->cancelled_id = g_cancellable_connect (cancellable, G_CALLBACK (cancelled_cb), self, NULL);
+}
+
+/*****************************************************************************/
+
+MMBearerStatusWait *
+mm_bearer_status_wait_new (gpointer source,
+                           guint    initial_interval_ms,
+                           guint    max_interval_ms)
+{
+    MMBearerStatusWait *self;
+
+    self = g_slice_new0 (MMBearerStatusWait);
+    self->source = source;
+    self->initial_interval_ms = initial_interval_ms;
+    self->max_interval_ms = MAX (initial_interval_ms, max_interval_ms);
+    return self;
+}
+
+void
+mm_bearer_status_wait_free (MMBearerStatusWait *self)
+{
+    /* A running wait keeps a reference to the source object */
+    g_assert (!self->task);
+    g_slice_free (MMBearerStatusWait, self);
+}
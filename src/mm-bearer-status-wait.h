@@ -0,0 +1,73 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_BEARER_STATUS_WAIT_H
+#define MM_BEARER_STATUS_WAIT_H
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "mm-base-bearer.h"
+
+/* Wait until a bearer reaches a given connection status (CONNECTED or
+ * DISCONNECTED).
+ *
+ * The wait completes as soon as the status is reported with
+ * mm_bearer_status_wait_report(), e.g. from an unsolicited message handler.
+ * The given status check is only used as fallback: it runs once after the
+ * first check delay, and then with an exponential backoff until the timeout.
+ *
+ * The check must report either a connection status, or UNKNOWN if it
+ * couldn't be checked; in the latter case the error is optional. Failed
+ * checks are retried until too many of them fail in a row.
+ *
+ * A report only completes the wait if it is the expected status, or a
+ * connection failure while waiting to get connected; any other report just
+ * triggers a check right away, and is left for the caller to process.
+ *
+ * At most one wait runs at a time. The GTask of the wait uses the given
+ * source object, which is not referenced by the MMBearerStatusWait itself.
+ */
+typedef struct _MMBearerStatusWait MMBearerStatusWait;
+
+typedef void                     (* MMBearerStatusWaitCheckFn)       (gpointer              source,
+                                                                      gpointer              check_data,
+                                                                      GAsyncReadyCallback   callback,
+                                                                      gpointer              user_data);
+typedef MMBearerConnectionStatus (* MMBearerStatusWaitCheckFinishFn) (gpointer              source,
+                                                                      GAsyncResult         *res,
+                                                                      GError              **error);
+
+MMBearerStatusWait *mm_bearer_status_wait_new        (gpointer                          source,
+                                                      guint                             initial_interval_ms,
+                                                      guint                             max_interval_ms);
+void                mm_bearer_status_wait_free       (MMBearerStatusWait               *self);
+
+void                mm_bearer_status_wait_run        (MMBearerStatusWait               *self,
+                                                      MMBearerConnectionStatus          status,
+                                                      guint                             first_check_delay_ms,
+                                                      guint                             timeout_ms,
+                                                      MMBearerStatusWaitCheckFn         check,
+                                                      MMBearerStatusWaitCheckFinishFn   check_finish,
+                                                      gpointer                          check_data,
+                                                      GCancellable                     *cancellable,
+                                                      GAsyncReadyCallback               callback,
+                                                      gpointer                          user_data);
+gboolean            mm_bearer_status_wait_run_finish (GAsyncResult                     *res,
+                                                      GError                          **error);
+
+gboolean            mm_bearer_status_wait_is_running (MMBearerStatusWait               *self);
+gboolean            mm_bearer_status_wait_report     (MMBearerStatusWait               *self,
+                                                      MMBearerConnectionStatus          status);
+
+#endif /* MM_BEARER_STATUS_WAIT_H */
@@ -28,6 +28,7 @@
 #include <libmm-glib.h>
 
 #include "mm-broadband-bearer.h"
+#include "mm-bearer-status-wait.h"
 #include "mm-iface-modem.h"
 #include "mm-iface-modem-3gpp.h"
 #include "mm-iface-modem-3gpp-profile-manager.h"
@@ -37,6 +38,7 @@
 #include "mm-modem-helpers.h"
 #include "mm-port-enums-types.h"
 #include "mm-helper-enums-types.h"
+#include "mm-daemon-enums-types.h"
 
 static void async_initable_iface_init (GAsyncInitableIface *iface);
 
@@ -71,6 +73,9 @@ struct _MMBroadbandBearerPrivate {
     /*-- 3GPP specific --*/
     /* CID of the PDP context */
     gint profile_id;
+
+    /* Bearer status wait */
+    MMBearerStatusWait *status_wait;
 };
 
 /*****************************************************************************/
@@ -1726,6 +1731,51 @@ load_connection_status (MMBaseBearer        *self,
                                    task);
 }
 
+/*****************************************************************************/
+/* Bearer status wait */
+
+#define STATUS_WAIT_CHECK_INTERVAL_INITIAL_MS 500
+#define STATUS_WAIT_CHECK_INTERVAL_MAX_MS     4000
+
+gboolean
+mm_broadband_bearer_wait_for_status_finish (MMBroadbandBearer  *self,
+                                            GAsyncResult       *res,
+                                            GError            **error)
+{
+    return mm_bearer_status_wait_run_finish (res, error);
+}
+
+gboolean
+mm_broadband_bearer_report_wait_status (MMBroadbandBearer        *self,
+                                        MMBearerConnectionStatus  status)
+{
+    return mm_bearer_status_wait_report (self->priv->status_wait, status);
+}
+
+void
+mm_broadband_bearer_wait_for_status (MMBroadbandBearer                    *self,
+                                     MMBearerConnectionStatus              status,
+                                     guint                                 first_check_delay,
+                                     guint                                 timeout,
+                                     MMBroadbandBearerStatusCheckFn        check,
+                                     MMBroadbandBearerStatusCheckFinishFn  check_finish,
+                                     gpointer                              check_data,
+                                     GCancellable                         *cancellable,
+                                     GAsyncReadyCallback                   callback,
+                                     gpointer                              user_data)
+{
+    mm_bearer_status_wait_run (self->priv->status_wait,
+                               status,
+                               first_check_delay * 1000,
+                               timeout * 1000,
+                               (MMBearerStatusWaitCheckFn) check,
+                               (MMBearerStatusWaitCheckFinishFn) check_finish,
+                               check_data,
+                               cancellable,
+                               callback,
+                               user_data);
+}
+
 /*****************************************************************************/
 
 static void
@@ -1733,6 +1783,11 @@ report_connection_status (MMBaseBearer             *self,
                           MMBearerConnectionStatus  status,
                           const GError             *connection_error)
 {
+    /* Reports that complete an ongoing wait for a given status (e.g. during
+     * a connection attempt) are handled by whoever waits */
+    if (mm_broadband_bearer_report_wait_status (MM_BROADBAND_BEARER (self), status))
+        return;
+
     if (status == MM_BEARER_CONNECTION_STATUS_DISCONNECTED)
         /* Cleanup all connection related data */
         reset_bearer_connection (MM_BROADBAND_BEARER (self));
@@ -2012,6 +2067,9 @@ mm_broadband_bearer_init (MMBroadbandBearer *self)
     /* Set defaults */
     self->priv->connection_type = CONNECTION_TYPE_NONE;
     self->priv->flow_control    = MM_FLOW_CONTROL_NONE;
+    self->priv->status_wait     = mm_bearer_status_wait_new (self,
+                                                             STATUS_WAIT_CHECK_INTERVAL_INITIAL_MS,
+                                                             STATUS_WAIT_CHECK_INTERVAL_MAX_MS);
 }
 
 static void
@@ -2024,6 +2082,16 @@ dispose (GObject *object)
     G_OBJECT_CLASS (mm_broadband_bearer_parent_class)->dispose (object);
 }
 
+static void
+finalize (GObject *object)
+{
+    MMBroadbandBearer *self = MM_BROADBAND_BEARER (object);
+
+    mm_bearer_status_wait_free (self->priv->status_wait);
+
+    G_OBJECT_CLASS (mm_broadband_bearer_parent_class)->finalize (object);
+}
+
 static void
 async_initable_iface_init (GAsyncInitableIface *iface)
 {
@@ -2042,6 +2110,7 @@ mm_broadband_bearer_class_init (MMBroadbandBearerClass *klass)
     object_class->get_property = get_property;
     object_class->set_property = set_property;
     object_class->dispose      = dispose;
+    object_class->finalize     = finalize;
 
     base_bearer_class->connect = connect;
     base_bearer_class->connect_finish = connect_finish;
@@ -141,4 +141,36 @@ void          mm_broadband_bearer_new        (MMBroadbandModem *modem,
 MMBaseBearer *mm_broadband_bearer_new_finish (GAsyncResult *res,
                                               GError **error);
 
+/* Wait until the bearer reaches the given connection status (CONNECTED or
+ * DISCONNECTED). The wait completes as soon as the status is reported with
+ * mm_broadband_bearer_report_wait_status(), e.g. from an unsolicited message
+ * handler; the given status check is only used as fallback, run after the
+ * first check delay and then with an exponential backoff until the timeout
+ * (both in seconds). The check returns UNKNOWN, with an optional error, if
+ * the status couldn't be checked. Reports only return TRUE if they
+ * completed the wait, see mm-bearer-status-wait.h. */
+typedef void                     (* MMBroadbandBearerStatusCheckFn)       (MMBroadbandBearer    *self,
+                                                                           gpointer              check_data,
+                                                                           GAsyncReadyCallback   callback,
+                                                                           gpointer              user_data);
+typedef MMBearerConnectionStatus (* MMBroadbandBearerStatusCheckFinishFn) (MMBroadbandBearer    *self,
+                                                                           GAsyncResult         *res,
+                                                                           GError              **error);
+
+void     mm_broadband_bearer_wait_for_status        (MMBroadbandBearer                    *self,
+                                                     MMBearerConnectionStatus              status,
+                                                     guint                                 first_check_delay,
+                                                     guint                                 timeout,
+                                                     MMBroadbandBearerStatusCheckFn        check,
+                                                     MMBroadbandBearerStatusCheckFinishFn  check_finish,
+                                                     gpointer                              check_data,
+                                                     GCancellable                         *cancellable,
+                                                     GAsyncReadyCallback                   callback,
+                                                     gpointer                              user_data);
+gboolean mm_broadband_bearer_wait_for_status_finish (MMBroadbandBearer                    *self,
+                                                     GAsyncResult                         *res,
+                                                     GError                              **error);
+gboolean mm_broadband_bearer_report_wait_status     (MMBroadbandBearer                    *self,
+                                                     MMBearerConnectionStatus              status);
+
 #endif /* MM_BROADBAND_BEARER_H */
@@ -54,6 +54,7 @@
 #include "mm-log-object.h"
 #include "mm-modem-helpers.h"
 #include "mm-error-helpers.h"
+#include "mm-parallel-run.h"
 #include "mm-port-serial-qcdm.h"
 #include "libqcdm/src/errors.h"
 #include "libqcdm/src/commands.h"
@@ -4242,6 +4243,9 @@ complete_sim_swap_check (GTask       *task,
                     str,
                     mm_log_str_personal_info (cached ? cached : ""),
                     mm_log_str_personal_info (current ? current : ""));
+        /* Same card with new contents (e.g. IMSI switch) */
+        if (ctx->step == SIM_SWAP_CHECK_STEP_IMSI_CHANGED)
+            mm_base_sim_forget_cached_contents (ctx->sim);
         mm_iface_modem_process_sim_event (MM_IFACE_MODEM (self));
         ctx->step = SIM_SWAP_CHECK_STEP_LAST;
     } else {
@@ -7532,16 +7536,77 @@ sms_pdu_type_from_str (const gchar *str)
     return MM_SMS_PDU_TYPE_UNKNOWN;
 }
 
+typedef struct {
+    MMBroadbandModem *self;
+    MMSmsStorage      list_storage;
+} ListPartsEntryContext;
+
+static void
+sms_text_part_list_entry (const gchar           *header,
+                          const gchar           *data,
+                          ListPartsEntryContext *ctx)
+{
+    MMBroadbandModem      *self = ctx->self;
+    MMSmsPart             *part;
+    guint                  idx;
+    g_autofree gchar      *stat = NULL;
+    g_autofree gchar      *raw_number = NULL;
+    g_autofree gchar      *number = NULL;
+    g_autofree gchar      *timestamp = NULL;
+    g_autofree gchar      *text = NULL;
+    g_autoptr(GByteArray)  raw = NULL;
+    g_autoptr(GError)      inner_error = NULL;
+
+    if (!mm_3gpp_parse_text_cmgl_header (header, &idx, &stat, &raw_number, &timestamp, &inner_error)) {
+        mm_obj_dbg (self, "%s", inner_error->message);
+        return;
+    }
+
+    /* Get and parse number */
+    number = mm_modem_charset_str_to_utf8 (raw_number, -1, self->priv->modem_current_charset, FALSE, &inner_error);
+    if (!number) {
+        mm_obj_dbg (self, "failed to convert message sender number to UTF-8: %s", inner_error->message);
+        return;
+    }
+
+    /* Get and parse text */
+    text = mm_modem_charset_str_to_utf8 (data, -1, self->priv->modem_current_charset, FALSE, &inner_error);
+    if (!text) {
+        mm_obj_dbg (self, "failed to convert message text to UTF-8: %s", inner_error->message);
+        return;
+    }
+
+    /* The raw SMS data can only be GSM, UCS2, or unknown (8-bit), so we
+     * need to convert to UCS2 here.
+     */
+    raw = mm_modem_charset_bytearray_from_utf8 (text, MM_MODEM_CHARSET_UCS2, FALSE, NULL);
+    g_assert (raw);
+
+    /* all take() methods pass ownership of the value as well */
+    part = mm_sms_part_new (idx, sms_pdu_type_from_str (stat));
+    mm_sms_part_take_number (part, g_steal_pointer (&number));
+    mm_sms_part_take_timestamp (part, g_steal_pointer (&timestamp));
+    mm_sms_part_take_text (part, g_steal_pointer (&text));
+    mm_sms_part_take_data (part, g_steal_pointer (&raw));
+    mm_sms_part_set_class (part, -1);
+
+    mm_obj_dbg (self, "correctly parsed SMS list entry (%d)", idx);
+    mm_iface_modem_messaging_take_part (MM_IFACE_MODEM_MESSAGING (self),
+                                        part,
+                                        sms_state_from_str (stat),
+                                        ctx->list_storage);
+}
+
 static void
 sms_text_part_list_ready (MMBroadbandModem *self,
                           GAsyncResult *res,
                           GTask *task)
 {
-    ListPartsContext      *ctx;
-    g_autoptr(GRegex)      r = NULL;
-    g_autoptr(GMatchInfo)  match_info = NULL;
-    const gchar           *response;
-    GError                *error = NULL;
+    ListPartsContext            *ctx;
+    ListPartsEntryContext        entry_ctx;
+    g_autoptr(MM3gppCmglParser)  parser = NULL;
+    const gchar                 *response;
+    GError                      *error = NULL;
 
     response = mm_base_modem_at_command_finish (MM_BASE_MODEM (self), res, &error);
     if (error) {
@@ -7550,12 +7615,7 @@ sms_text_part_list_ready (MMBroadbandModem *self,
         return;
     }
 
-    /* +CMGL: <index>,<stat>,<oa/da>,[alpha],<scts><CR><LF><data><CR><LF> */
-    r = g_regex_new ("\\+CMGL:\\s*(\\d+)\\s*,\\s*([^,]*),\\s*([^,]*),\\s*([^,]*),\\s*([^\\r\\n]*)\\r\\n([^\\r\\n]*)",
-                     0, 0, NULL);
-    g_assert (r);
-
-    if (!g_regex_match (r, response, 0, &match_info)) {
+    if (!strstr (response, "+CMGL:")) {
         g_task_return_new_error (task,
                                  MM_CORE_ERROR,
                                  MM_CORE_ERROR_INVALID_ARGS,
@@ -7565,87 +7625,13 @@ sms_text_part_list_ready (MMBroadbandModem *self,
     }
 
     ctx = g_task_get_task_data (task);
+    entry_ctx.self = self;
+    entry_ctx.list_storage = ctx->list_storage;
 
-    while (g_match_info_matches (match_info)) {
-        MMSmsPart            *part;
-        guint                 matches;
-        guint                 idx;
-        g_autofree gchar      *number_enc = NULL;
-        g_autofree gchar      *number = NULL;
-        g_autofree gchar      *timestamp = NULL;
-        g_autofree gchar      *text_enc = NULL;
-        g_autofree gchar      *text = NULL;
-        g_autofree gchar      *stat = NULL;
-        g_autoptr(GByteArray)  raw = NULL;
-        g_autoptr(GError)      inner_error = NULL;
-
-        matches = g_match_info_get_match_count (match_info);
-        if (matches != 7) {
-            mm_obj_dbg (self, "failed to match entire CMGL response (count %d)", matches);
-            goto next;
-        }
-
-        if (!mm_get_uint_from_match_info (match_info, 1, &idx)) {
-            mm_obj_dbg (self, "failed to convert message index");
-            goto next;
-        }
-
-        /* Get part state */
-        stat = mm_get_string_unquoted_from_match_info (match_info, 2);
-        if (!stat) {
-            mm_obj_dbg (self, "failed to get part status");
-            goto next;
-        }
-
-        /* Get and parse number */
-        number_enc = mm_get_string_unquoted_from_match_info (match_info, 3);
-        if (!number_enc) {
-            mm_obj_dbg (self, "failed to get message sender number");
-            goto next;
-        }
-        number = mm_modem_charset_str_to_utf8 (number_enc, -1, self->priv->modem_current_charset, FALSE, &inner_error);
-        if (!number) {
-            mm_obj_dbg (self, "failed to convert message sender number to UTF-8: %s", inner_error->message);
-            goto next;
-        }
-
-        /* Get and parse timestamp (always expected in ASCII) */
-        timestamp = mm_get_string_unquoted_from_match_info (match_info, 5);
-        if (timestamp && !g_str_is_ascii (timestamp)) {
-            mm_obj_dbg (self, "failed to parse input timestamp as ASCII");
-            goto next;
-        }
-
-        /* Get and parse text */
-        text_enc = g_match_info_fetch (match_info, 6);
-        text = mm_modem_charset_str_to_utf8 (text_enc, -1, self->priv->modem_current_charset, FALSE, &inner_error);
-        if (!text) {
-            mm_obj_dbg (self, "failed to convert message text to UTF-8: %s", inner_error->message);
-            goto next;
-        }
-
-        /* The raw SMS data can only be GSM, UCS2, or unknown (8-bit), so we
-         * need to convert to UCS2 here.
-         */
-        raw = mm_modem_charset_bytearray_from_utf8 (text, MM_MODEM_CHARSET_UCS2, FALSE, NULL);
-        g_assert (raw);
-
-        /* all take() methods pass ownership of the value as well */
-        part = mm_sms_part_new (idx, sms_pdu_type_from_str (stat));
-        mm_sms_part_take_number (part, g_steal_pointer (&number));
-        mm_sms_part_take_timestamp (part, g_steal_pointer (&timestamp));
-        mm_sms_part_take_text (part, g_steal_pointer (&text));
-        mm_sms_part_take_data (part, g_steal_pointer (&raw));
-        mm_sms_part_set_class (part, -1);
-
-        mm_obj_dbg (self, "correctly parsed SMS list entry (%d)", idx);
-        mm_iface_modem_messaging_take_part (MM_IFACE_MODEM_MESSAGING (self),
-                                            part,
-                                            sms_state_from_str (stat),
-                                            ctx->list_storage);
-next:
-        g_match_info_next (match_info, NULL);
-    }
+    /* +CMGL: <index>,<stat>,<oa/da>,[alpha],<scts><CR><LF><data><CR><LF> */
+    parser = mm_3gpp_cmgl_parser_new ((MM3gppCmglEntryFunc) sms_text_part_list_entry, &entry_ctx);
+    mm_3gpp_cmgl_parser_feed (parser, response, strlen (response));
+    mm_3gpp_cmgl_parser_finish (parser);
 
     /* We consider all done */
     g_task_return_boolean (task, TRUE);
@@ -7669,16 +7655,49 @@ sms_state_from_index (guint index)
     }
 }
 
+static void
+sms_pdu_part_list_entry (const gchar           *header,
+                         const gchar           *data,
+                         ListPartsEntryContext *ctx)
+{
+    MMBroadbandModem *self = ctx->self;
+    MM3gppPduInfo    *info;
+    MMSmsPart        *part;
+    GError           *error = NULL;
+
+    info = mm_3gpp_parse_pdu_cmgl_entry (header, data, &error);
+    if (!info) {
+        mm_obj_dbg (self, "%s", error->message);
+        g_error_free (error);
+        return;
+    }
+
+    part = mm_sms_part_3gpp_new_from_pdu (info->index, info->pdu, self, &error);
+    if (part) {
+        mm_obj_dbg (self, "correctly parsed PDU (%d)", info->index);
+        mm_iface_modem_messaging_take_part (MM_IFACE_MODEM_MESSAGING (self),
+                                            part,
+                                            sms_state_from_index (info->status),
+                                            ctx->list_storage);
+    } else {
+        /* Don't treat the error as critical */
+        mm_obj_dbg (self, "error parsing PDU (%d): %s", info->index, error->message);
+        g_error_free (error);
+    }
+
+    mm_3gpp_pdu_info_free (info);
+}
+
 static void
 sms_pdu_part_list_ready (MMBroadbandModem *self,
                          GAsyncResult *res,
                          GTask *task)
 {
-    ListPartsContext *ctx;
-    const gchar *response;
-    GError *error = NULL;
-    GList *info_list;
-    GList *l;
+    ListPartsContext            *ctx;
+    ListPartsEntryContext        entry_ctx;
+    g_autoptr(MM3gppCmglParser)  parser = NULL;
+    const gchar                 *response;
+    GError                      *error = NULL;
 
     /* Always always always unlock mem1 storage. Warned you've been. */
     mm_broadband_modem_unlock_sms_storages (self, TRUE, FALSE);
@@ -7690,34 +7709,15 @@ sms_pdu_part_list_ready (MMBroadbandModem *self,
         return;
     }
 
-    info_list = mm_3gpp_parse_pdu_cmgl_response (response, &error);
-    if (error) {
-        g_task_return_error (task, error);
-        g_object_unref (task);
-        return;
-    }
-
     ctx = g_task_get_task_data (task);
+    entry_ctx.self = self;
+    entry_ctx.list_storage = ctx->list_storage;
 
-    for (l = info_list; l; l = g_list_next (l)) {
-        MM3gppPduInfo *info = l->data;
-        MMSmsPart *part;
-
-        part = mm_sms_part_3gpp_new_from_pdu (info->index, info->pdu, self, &error);
-        if (part) {
-            mm_obj_dbg (self, "correctly parsed PDU (%d)", info->index);
-            mm_iface_modem_messaging_take_part (MM_IFACE_MODEM_MESSAGING (self),
-                                                part,
-                                                sms_state_from_index (info->status),
-                                                ctx->list_storage);
-        } else {
-            /* Don't treat the error as critical */
-            mm_obj_dbg (self, "error parsing PDU (%d): %s", info->index, error->message);
-            g_clear_error (&error);
-        }
-    }
-
-    mm_3gpp_pdu_info_list_free (info_list);
+    /* Each PDU is processed as soon as its entry is parsed, without
+     * building the whole list first */
+    parser = mm_3gpp_cmgl_parser_new ((MM3gppCmglEntryFunc) sms_pdu_part_list_entry, &entry_ctx);
+    mm_3gpp_cmgl_parser_feed (parser, response, strlen (response));
+    mm_3gpp_cmgl_parser_finish (parser);
 
     /* We consider all done */
     g_task_return_boolean (task, TRUE);
@@ -12391,23 +12391,28 @@ typedef enum {
     INITIALIZE_STEP_IFACE_3GPP_PROFILE_MANAGER,
     INITIALIZE_STEP_IFACE_3GPP_USSD,
     INITIALIZE_STEP_IFACE_CDMA,
-    INITIALIZE_STEP_IFACE_MESSAGING,
-    INITIALIZE_STEP_IFACE_TIME,
-    INITIALIZE_STEP_IFACE_SIGNAL,
-    INITIALIZE_STEP_IFACE_OMA,
-    INITIALIZE_STEP_IFACE_SAR,
-    INITIALIZE_STEP_FALLBACK_LIMITED,
-    INITIALIZE_STEP_IFACE_LOCATION,
-    INITIALIZE_STEP_IFACE_VOICE,
-    INITIALIZE_STEP_IFACE_FIRMWARE,
+    INITIALIZE_STEP_IFACES,
     INITIALIZE_STEP_IFACE_SIMPLE,
     INITIALIZE_STEP_LAST,
 } InitializeStep;
 
+/* Max number of optional interfaces being initialized at the same time in
+ * modems with QMI or MBIM control ports, where requests go through
+ * independent clients. */
+#define INITIALIZE_IFACES_MAX_PARALLEL 4
+
+/* Group of the optional interfaces that may use the primary AT port, even in
+ * QMI or MBIM modems, which are initialized one at a time */
+#define INITIALIZE_IFACES_GROUP_AT_PRIMARY 1
+
 typedef struct {
     MMBroadbandModem *self;
     InitializeStep step;
     gpointer ports_ctx;
+    gint64 start_time;
+    /* Optional interfaces */
+    gboolean limited;
+    gint64 *ifaces_start_time;
 } InitializeContext;
 
 static void initialize_step (GTask *task);
@@ -12424,6 +12429,7 @@ initialize_context_free (InitializeContext *ctx)
         g_error_free (error);
     }
 
+    g_free (ctx->ifaces_start_time);
     g_object_unref (ctx->self);
     g_free (ctx);
 }
@@ -12569,14 +12575,190 @@ INTERFACE_INIT_READY_FN (iface_modem_3gpp,                 MM_IFACE_MODEM_3GPP,
 INTERFACE_INIT_READY_FN (iface_modem_3gpp_profile_manager, MM_IFACE_MODEM_3GPP_PROFILE_MANAGER, FALSE)
 INTERFACE_INIT_READY_FN (iface_modem_3gpp_ussd,            MM_IFACE_MODEM_3GPP_USSD,            FALSE)
 INTERFACE_INIT_READY_FN (iface_modem_cdma,                 MM_IFACE_MODEM_CDMA,                 TRUE)
-INTERFACE_INIT_READY_FN (iface_modem_location,             MM_IFACE_MODEM_LOCATION,             FALSE)
-INTERFACE_INIT_READY_FN (iface_modem_messaging,            MM_IFACE_MODEM_MESSAGING,            FALSE)
-INTERFACE_INIT_READY_FN (iface_modem_voice,                MM_IFACE_MODEM_VOICE,                FALSE)
-INTERFACE_INIT_READY_FN (iface_modem_time,                 MM_IFACE_MODEM_TIME,                 FALSE)
-INTERFACE_INIT_READY_FN (iface_modem_signal,               MM_IFACE_MODEM_SIGNAL,               FALSE)
-INTERFACE_INIT_READY_FN (iface_modem_oma,                  MM_IFACE_MODEM_OMA,                  FALSE)
-INTERFACE_INIT_READY_FN (iface_modem_firmware,             MM_IFACE_MODEM_FIRMWARE,             FALSE)
-INTERFACE_INIT_READY_FN (iface_modem_sar,                  MM_IFACE_MODEM_SAR,                  FALSE)
+
+/*****************************************************************************/
+/* Optional interfaces
+ *
+ * Once the Modem interface (and the 3GPP or CDMA ones) are initialized, all
+ * the remaining interfaces only depend on those, not on each other, so they
+ * may be initialized at the same time. Errors in these are never fatal, the
+ * interface is just shutdown.
+ */
+
+typedef struct {
+    const gchar *name;
+    /* Initialized also in locked or failed state */
+    gboolean     limited;
+    /* May use the primary AT port, e.g. in plugins implementing it with AT
+     * commands on top of QMI or MBIM */
+    gboolean     at_primary;
+    void       (* initialize)         (MMBroadbandModem *self,
+                                       GCancellable *cancellable,
+                                       GAsyncReadyCallback callback,
+                                       gpointer user_data);
+    gboolean   (* initialize_finish)  (MMBroadbandModem *self,
+                                       GAsyncResult *res,
+                                       GError **error);
+    void       (* shutdown)           (MMBroadbandModem *self);
+    void       (* bind_simple_status) (MMBroadbandModem *self,
+                                       MMSimpleStatus *status);
+} InitializeIface;
+
+#undef INTERFACE_INIT_COMMON_FN
+#define INTERFACE_INIT_COMMON_FN(NAME,TYPE)                             \
+    static gboolean                                                     \
+    NAME##_initialize_iface_finish (MMBroadbandModem *self,             \
+                                    GAsyncResult *res,                  \
+                                    GError **error)                     \
+    {                                                                   \
+        return mm_##NAME##_initialize_finish (TYPE (self), res, error); \
+    }                                                                   \
+                                                                        \
+    static void                                                         \
+    NAME##_shutdown_iface (MMBroadbandModem *self)                      \
+    {                                                                   \
+        mm_##NAME##_shutdown (TYPE (self));                             \
+    }                                                                   \
+                                                                        \
+    static void                                                         \
+    NAME##_bind_simple_status_iface (MMBroadbandModem *self,            \
+                                     MMSimpleStatus *status)            \
+    {                                                                   \
+        mm_##NAME##_bind_simple_status (TYPE (self), status);           \
+    }
+
+#undef INTERFACE_INIT_FN
+#define INTERFACE_INIT_FN(NAME,TYPE)                                    \
+    INTERFACE_INIT_COMMON_FN (NAME, TYPE)                               \
+    static void                                                         \
+    NAME##_initialize_iface (MMBroadbandModem *self,                    \
+                             GCancellable *cancellable,                 \
+                             GAsyncReadyCallback callback,              \
+                             gpointer user_data)                        \
+    {                                                                   \
+        mm_##NAME##_initialize (TYPE (self), cancellable, callback, user_data); \
+    }
+
+INTERFACE_INIT_FN (iface_modem_location,  MM_IFACE_MODEM_LOCATION)
+INTERFACE_INIT_FN (iface_modem_messaging, MM_IFACE_MODEM_MESSAGING)
+INTERFACE_INIT_FN (iface_modem_voice,     MM_IFACE_MODEM_VOICE)
+INTERFACE_INIT_FN (iface_modem_time,      MM_IFACE_MODEM_TIME)
+INTERFACE_INIT_FN (iface_modem_signal,    MM_IFACE_MODEM_SIGNAL)
+INTERFACE_INIT_FN (iface_modem_oma,       MM_IFACE_MODEM_OMA)
+INTERFACE_INIT_FN (iface_modem_firmware,  MM_IFACE_MODEM_FIRMWARE)
+INTERFACE_INIT_FN (iface_modem_sar,       MM_IFACE_MODEM_SAR)
+
+#define INITIALIZE_IFACE(NAME,DESCRIPTION,LIMITED,AT_PRIMARY) { \
+        .name               = DESCRIPTION,                      \
+        .limited            = LIMITED,                          \
+        .at_primary         = AT_PRIMARY,                       \
+        .initialize         = NAME##_initialize_iface,          \
+        .initialize_finish  = NAME##_initialize_iface_finish,   \
+        .shutdown           = NAME##_shutdown_iface,            \
+        .bind_simple_status = NAME##_bind_simple_status_iface   \
+    }
+
+/* Listed in the order they are launched, which is the order in which they
+ * are fully serialized in AT-only modems. Signal, OMA and SAR go through the
+ * QMI or MBIM clients only, in the modems where they may run in parallel. */
+static const InitializeIface initialize_ifaces[] = {
+    INITIALIZE_IFACE (iface_modem_messaging, "messaging", FALSE, TRUE),
+    INITIALIZE_IFACE (iface_modem_time,      "time",      FALSE, TRUE),
+    INITIALIZE_IFACE (iface_modem_signal,    "signal",    FALSE, FALSE),
+    INITIALIZE_IFACE (iface_modem_oma,       "OMA",       FALSE, FALSE),
+    INITIALIZE_IFACE (iface_modem_sar,       "SAR",       FALSE, FALSE),
+    INITIALIZE_IFACE (iface_modem_location,  "location",  TRUE,  TRUE),
+    INITIALIZE_IFACE (iface_modem_voice,     "voice",     TRUE,  TRUE),
+    INITIALIZE_IFACE (iface_modem_firmware,  "firmware",  TRUE,  TRUE),
+};
+
+static guint
+initialize_ifaces_get_max_running (MMBroadbandModem *self)
+{
+    GList *ports;
+    guint  max_running = 1;
+
+    /* Requests in AT ports are serialized anyways, and the order in which
+     * the interfaces are initialized is kept in AT-only modems */
+    ports = mm_base_modem_find_ports (MM_BASE_MODEM (self), MM_PORT_SUBSYS_UNKNOWN, MM_PORT_TYPE_QMI);
+    if (!ports)
+        ports = mm_base_modem_find_ports (MM_BASE_MODEM (self), MM_PORT_SUBSYS_UNKNOWN, MM_PORT_TYPE_MBIM);
+    if (ports)
+        max_running = INITIALIZE_IFACES_MAX_PARALLEL;
+
+    g_list_free_full (ports, g_object_unref);
+    return max_running;
+}
+
+static gboolean
+initialize_iface_start (InitializeContext   *ctx,
+                        guint                index,
+                        GCancellable        *cancellable,
+                        GAsyncReadyCallback  callback,
+                        gpointer             user_data)
+{
+    const InitializeIface *iface;
+
+    iface = &initialize_ifaces[index];
+    if (ctx->limited && !iface->limited)
+        return FALSE;
+
+    ctx->ifaces_start_time[index] = g_get_monotonic_time ();
+    iface->initialize (ctx->self, cancellable, callback, user_data);
+    return TRUE;
+}
+
+static guint
+initialize_iface_group (InitializeContext *ctx,
+                        guint              index)
+{
+    /* Requests in the primary AT port are serialized anyways, and the
+     * interfaces expect their own sequences not to be interleaved with
+     * the ones of other interfaces */
+    if (initialize_ifaces[index].at_primary &&
+        mm_base_modem_peek_port_primary (MM_BASE_MODEM (ctx->self)))
+        return INITIALIZE_IFACES_GROUP_AT_PRIMARY;
+    return 0;
+}
+
+static void
+initialize_iface_finish (InitializeContext *ctx,
+                         guint              index,
+                         GAsyncResult      *result)
+{
+    const InitializeIface *iface;
+    g_autoptr(GError)      error = NULL;
+
+    iface = &initialize_ifaces[index];
+
+    if (!iface->initialize_finish (ctx->self, result, &error)) {
+        mm_obj_dbg (ctx->self, "couldn't initialize %s interface: '%s'", iface->name, error->message);
+        /* Just shutdown this interface */
+        iface->shutdown (ctx->self);
+        return;
+    }
+
+    /* bind simple properties */
+    iface->bind_simple_status (ctx->self, ctx->self->priv->modem_simple_status);
+    mm_obj_dbg (ctx->self, "%s interface initialized in %" G_GINT64_FORMAT "ms", iface->name,
+                (g_get_monotonic_time () - ctx->ifaces_start_time[index]) / 1000);
+}
+
+static void
+initialize_ifaces_ready (MMBroadbandModem *self,
+                         GAsyncResult     *res,
+                         GTask            *task)
+{
+    InitializeContext *ctx;
+
+    ctx = g_task_get_task_data (task);
+
+    /* Only fails if cancelled, which is checked in the next step */
+    mm_parallel_run_finish (res, NULL);
+
+    ctx->step++;
+    initialize_step (task);
+}
 
 static void
 initialize_step (GTask *task)
@@ -12646,9 +12828,10 @@ initialize_step (GTask *task)
     case INITIALIZE_STEP_JUMP_TO_LIMITED:
         if (ctx->self->priv->modem_state == MM_MODEM_STATE_LOCKED ||
             ctx->self->priv->modem_state == MM_MODEM_STATE_FAILED) {
-            /* Jump to the fallback step when locked or failed, we will allow some additional
-             * interfaces even in locked or failed state. */
-            ctx->step = INITIALIZE_STEP_FALLBACK_LIMITED;
+            /* Only initialize the interfaces flagged as limited when locked
+             * or failed, we will allow those even in locked or failed state. */
+            ctx->limited = TRUE;
+            ctx->step = INITIALIZE_STEP_IFACES;
             initialize_step (task);
             return;
         }
@@ -12689,75 +12872,26 @@ initialize_step (GTask *task)
         ctx->step++;
        /* fall through */
 
-    case INITIALIZE_STEP_IFACE_MESSAGING:
-        /* Initialize the Messaging interface */
-        mm_iface_modem_messaging_initialize (MM_IFACE_MODEM_MESSAGING (ctx->self),
-                                             g_task_get_cancellable (task),
-                                             (GAsyncReadyCallback)iface_modem_messaging_initialize_ready,
-                                             task);
-        return;
-
-    case INITIALIZE_STEP_IFACE_TIME:
-        /* Initialize the Time interface */
-        mm_iface_modem_time_initialize (MM_IFACE_MODEM_TIME (ctx->self),
-                                        g_task_get_cancellable (task),
-                                        (GAsyncReadyCallback)iface_modem_time_initialize_ready,
-                                        task);
-        return;
-
-    case INITIALIZE_STEP_IFACE_SIGNAL:
-        /* Initialize the Signal interface */
-        mm_iface_modem_signal_initialize (MM_IFACE_MODEM_SIGNAL (ctx->self),
-                                          g_task_get_cancellable (task),
-                                          (GAsyncReadyCallback)iface_modem_signal_initialize_ready,
-                                          task);
-        return;
-
-    case INITIALIZE_STEP_IFACE_OMA:
-        /* Initialize the Oma interface */
-        mm_iface_modem_oma_initialize (MM_IFACE_MODEM_OMA (ctx->self),
-                                       g_task_get_cancellable (task),
-                                       (GAsyncReadyCallback)iface_modem_oma_initialize_ready,
-                                       task);
-        return;
-
-    case INITIALIZE_STEP_IFACE_SAR:
-        /* Initialize the SAR interface */
-        mm_iface_modem_sar_initialize (MM_IFACE_MODEM_SAR (ctx->self),
-                                       g_task_get_cancellable (task),
-                                       (GAsyncReadyCallback)iface_modem_sar_initialize_ready,
-                                       task);
-        return;
-
-    case INITIALIZE_STEP_FALLBACK_LIMITED:
-        /* All the initialization steps after this one will be run both on
-         * successful and locked/failed initializations. */
-        ctx->step++;
-       /* fall through */
-
-    case INITIALIZE_STEP_IFACE_LOCATION:
-        /* Initialize the Location interface */
-        mm_iface_modem_location_initialize (MM_IFACE_MODEM_LOCATION (ctx->self),
-                                            g_task_get_cancellable (task),
-                                            (GAsyncReadyCallback)iface_modem_location_initialize_ready,
-                                            task);
-        return;
+    case INITIALIZE_STEP_IFACES: {
+        guint max_running;
 
-    case INITIALIZE_STEP_IFACE_VOICE:
-        /* Initialize the Voice interface */
-        mm_iface_modem_voice_initialize (MM_IFACE_MODEM_VOICE (ctx->self),
-                                         g_task_get_cancellable (task),
-                                         (GAsyncReadyCallback)iface_modem_voice_initialize_ready,
-                                         task);
-        return;
-
-    case INITIALIZE_STEP_IFACE_FIRMWARE:
-        /* Initialize the Firmware interface */
-        mm_iface_modem_firmware_initialize (MM_IFACE_MODEM_FIRMWARE (ctx->self),
-                                            g_task_get_cancellable (task),
-                                            (GAsyncReadyCallback)iface_modem_firmware_initialize_ready,
-                                            task);
+        /* Initialize all the remaining interfaces, possibly in parallel */
+        max_running = initialize_ifaces_get_max_running (ctx->self);
+        ctx->ifaces_start_time = g_new0 (gint64, G_N_ELEMENTS (initialize_ifaces));
+        mm_obj_dbg (ctx->self, "initializing %s interfaces (up to %u at the same time)...",
+                    ctx->limited ? "limited" : "all", max_running);
+        mm_parallel_run (ctx->self,
+                         G_N_ELEMENTS (initialize_ifaces),
+                         max_running,
+                         (MMParallelRunStartFn) initialize_iface_start,
+                         (MMParallelRunGroupFn) initialize_iface_group,
+                         (MMParallelRunFinishFn) initialize_iface_finish,
+                         ctx,
+                         g_task_get_cancellable (task),
+                         (GAsyncReadyCallback) initialize_ifaces_ready,
+                         task);
         return;
+    }
 
     case INITIALIZE_STEP_IFACE_SIMPLE:
         if (ctx->self->priv->modem_state != MM_MODEM_STATE_FAILED)
@@ -12766,6 +12900,9 @@ initialize_step (GTask *task)
        /* fall through */
 
     case INITIALIZE_STEP_LAST:
+        mm_obj_dbg (ctx->self, "initialization sequence finished in %" G_GINT64_FORMAT "ms",
+                    (g_get_monotonic_time () - ctx->start_time) / 1000);
+
         if (ctx->self->priv->modem_state == MM_MODEM_STATE_FAILED) {
             GError *error = NULL;
 
@@ -12860,6 +12997,7 @@ initialize (MMBaseModem *self,
         ctx = g_new0 (InitializeContext, 1);
         ctx->self = MM_BROADBAND_MODEM (g_object_ref (self));
         ctx->step = INITIALIZE_STEP_FIRST;
+        ctx->start_time = g_get_monotonic_time ();
 
         g_task_set_task_data (task, ctx, (GDestroyNotify)initialize_context_free);
 
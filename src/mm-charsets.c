@@ -37,18 +37,18 @@ typedef struct {
     MMModemCharset  charset;
     const gchar    *gsm_name;
     const gchar    *other_name;
-    const gchar    *iconv_name;
+    const gchar    *iconv_name; /* NULL if converted without iconv */
 } CharsetSettings;
 
 static const CharsetSettings charset_settings[] = {
-    { MM_MODEM_CHARSET_UTF8,    "UTF-8",   "UTF8",   "UTF-8"     },
-    { MM_MODEM_CHARSET_UCS2,    "UCS2",    NULL,     "UCS-2BE"   },
-    { MM_MODEM_CHARSET_IRA,     "IRA",     "ASCII",  "ASCII"     },
+    { MM_MODEM_CHARSET_UTF8,    "UTF-8",   "UTF8",   NULL        },
+    { MM_MODEM_CHARSET_UCS2,    "UCS2",    NULL,     NULL        },
+    { MM_MODEM_CHARSET_IRA,     "IRA",     "ASCII",  NULL        },
     { MM_MODEM_CHARSET_GSM,     "GSM",     NULL,     NULL        },
     { MM_MODEM_CHARSET_8859_1,  "8859-1",  NULL,     "ISO8859-1" },
     { MM_MODEM_CHARSET_PCCP437, "PCCP437", "CP437",  "CP437"     },
     { MM_MODEM_CHARSET_PCDN,    "PCDN",    "CP850",  "CP850"     },
-    { MM_MODEM_CHARSET_UTF16,   "UTF-16",  "UTF16",  "UTF-16BE"  },
+    { MM_MODEM_CHARSET_UTF16,   "UTF-16",  "UTF16",  NULL        },
 };
 
 MMModemCharset
@@ -180,33 +180,27 @@ static const GsmUtf8Mapping gsm_def_utf8_alphabet[GSM_DEF_ALPHABET_SIZE] = {
     TWO(0xc3, 0xb6), TWO(0xc3, 0xb1), TWO(0xc3, 0xbc), TWO(0xc3, 0xa0)
 };
 
-static guint8
-gsm_def_char_to_utf8 (const guint8 gsm,
-                      guint8       out_utf8[2])
-{
-    g_return_val_if_fail (gsm < GSM_DEF_ALPHABET_SIZE, 0);
-    memcpy (&out_utf8[0], &gsm_def_utf8_alphabet[gsm].chars[0], gsm_def_utf8_alphabet[gsm].len);
-    return gsm_def_utf8_alphabet[gsm].len;
-}
+/* Results of the UTF-8 to GSM lookup: the GSM char, and whether it is found
+ * in the default or in the extended alphabet (0 if not found in any) */
+#define GSM_LOOKUP_CHAR_MASK 0x7f
+#define GSM_LOOKUP_DEF       0x100
+#define GSM_LOOKUP_EXT       0x200
+
+static guint16 utf8_to_gsm_lookup (const gchar *utf8,
+                                   guint32      len);
 
 static gboolean
 utf8_to_gsm_def_char (const gchar *utf8,
                       guint32      len,
                       guint8      *out_gsm)
 {
-    gint i;
+    guint16 entry;
 
-    if (len > 0 && len < 4) {
-        for (i = 0; i < GSM_DEF_ALPHABET_SIZE; i++) {
-            if (gsm_def_utf8_alphabet[i].len == len) {
-                if (memcmp (&gsm_def_utf8_alphabet[i].chars[0], utf8, len) == 0) {
-                    *out_gsm = i;
-                    return TRUE;
-                }
-            }
-        }
-    }
-    return FALSE;
+    entry = utf8_to_gsm_lookup (utf8, len);
+    if (!(entry & GSM_LOOKUP_DEF))
+        return FALSE;
+    *out_gsm = entry & GSM_LOOKUP_CHAR_MASK;
+    return TRUE;
 }
 
 static gboolean
@@ -246,17 +240,67 @@ static const GsmUtf8Mapping gsm_ext_utf8_alphabet[GSM_EXT_ALPHABET_SIZE] = {
 
 #define GSM_ESCAPE_CHAR 0x1b
 
-static guint8
-gsm_ext_char_to_utf8 (const guint8 gsm,
-                      guint8       out_utf8[3])
+/* All the chars of both alphabets have code points below this one, except
+ * for the euro sign in the extended alphabet */
+#define GSM_REVERSE_TABLE_SIZE 0x400
+
+/* Precomputed from the alphabets above: the UTF-8 to GSM lookup for every
+ * code point below GSM_REVERSE_TABLE_SIZE, and the extended alphabet
+ * indexed by GSM char */
+static guint16               gsm_reverse_table[GSM_REVERSE_TABLE_SIZE];
+static const GsmUtf8Mapping *gsm_ext_table[GSM_DEF_ALPHABET_SIZE];
+
+static void
+gsm_tables_init (void)
 {
-    int i;
+    static gsize initialized = 0;
 
-    for (i = 0; i < GSM_EXT_ALPHABET_SIZE; i++) {
-        if (gsm == gsm_ext_utf8_alphabet[i].gsm) {
-            memcpy (&out_utf8[0], &gsm_ext_utf8_alphabet[i].chars[0], gsm_ext_utf8_alphabet[i].len);
-            return gsm_ext_utf8_alphabet[i].len;
+    if (g_once_init_enter (&initialized)) {
+        guint i;
+
+        for (i = 0; i < GSM_DEF_ALPHABET_SIZE; i++) {
+            gunichar c;
+
+            /* The escape code is not valid UTF-8, and is skipped here */
+            c = g_utf8_get_char_validated (gsm_def_utf8_alphabet[i].chars, gsm_def_utf8_alphabet[i].len);
+            if (c < GSM_REVERSE_TABLE_SIZE)
+                gsm_reverse_table[c] = GSM_LOOKUP_DEF | i;
+        }
+
+        for (i = 0; i < GSM_EXT_ALPHABET_SIZE; i++) {
+            gunichar c;
+
+            c = g_utf8_get_char_validated (gsm_ext_utf8_alphabet[i].chars, gsm_ext_utf8_alphabet[i].len);
+            if (c < GSM_REVERSE_TABLE_SIZE && !gsm_reverse_table[c])
+                gsm_reverse_table[c] = GSM_LOOKUP_EXT | gsm_ext_utf8_alphabet[i].gsm;
+            gsm_ext_table[gsm_ext_utf8_alphabet[i].gsm] = &gsm_ext_utf8_alphabet[i];
         }
+
+        g_once_init_leave (&initialized, 1);
+    }
+}
+
+static guint16
+utf8_to_gsm_lookup (const gchar *utf8,
+                    guint32      len)
+{
+    gunichar c;
+    guint    i;
+
+    /* Only full single chars are looked up */
+    if (len == 0 || len > 3 || g_utf8_skip[*(const guchar *) utf8] != len)
+        return 0;
+
+    c = g_utf8_get_char_validated (utf8, len);
+    if (c < GSM_REVERSE_TABLE_SIZE) {
+        gsm_tables_init ();
+        return gsm_reverse_table[c];
+    }
+
+    for (i = 0; i < GSM_EXT_ALPHABET_SIZE; i++) {
+        if (gsm_ext_utf8_alphabet[i].len == len &&
+            memcmp (&gsm_ext_utf8_alphabet[i].chars[0], utf8, len) == 0)
+            return GSM_LOOKUP_EXT | gsm_ext_utf8_alphabet[i].gsm;
     }
     return 0;
 }
@@ -266,19 +310,13 @@ utf8_to_gsm_ext_char (const gchar *utf8,
                       guint32      len,
                       guint8      *out_gsm)
 {
-    int i;
+    guint16 entry;
 
-    if (len > 0 && len < 4) {
-        for (i = 0; i < GSM_EXT_ALPHABET_SIZE; i++) {
-            if (gsm_ext_utf8_alphabet[i].len == len) {
-                if (memcmp (&gsm_ext_utf8_alphabet[i].chars[0], utf8, len) == 0) {
-                    *out_gsm = gsm_ext_utf8_alphabet[i].gsm;
-                    return TRUE;
-                }
-            }
-        }
-    }
-    return FALSE;
+    entry = utf8_to_gsm_lookup (utf8, len);
+    if (!(entry & GSM_LOOKUP_EXT))
+        return FALSE;
+    *out_gsm = entry & GSM_LOOKUP_CHAR_MASK;
+    return TRUE;
 }
 
 static guint8
@@ -299,57 +337,54 @@ charset_gsm_unpacked_to_utf8 (const guint8  *gsm,
                               gboolean       translit,
                               GError       **error)
 {
-    g_autoptr(GByteArray) utf8 = NULL;
-    guint                 i;
+    g_autofree guint8 *utf8 = NULL;
+    guint8            *out;
+    guint32            end;
+    guint              i;
 
     g_return_val_if_fail (gsm != NULL, NULL);
     g_return_val_if_fail (len < 4096, NULL);
 
-    /* worst case initial length */
-    utf8 = g_byte_array_sized_new (len * 2 + 1);
-
-    for (i = 0; i < len; i++) {
-        guint8 uchars[4];
-        guint8 ulen = 0;
-
-        /*
-         * 	0x00 is NULL (when followed only by 0x00 up to the
-         * 	end of (fixed byte length) message, possibly also up to
-         * 	FORM FEED.  But 0x00 is also the code for COMMERCIAL AT
-         * 	when some other character (CARRIAGE RETURN if nothing else)
-         * 	comes after the 0x00.
-         *  http://unicode.org/Public/MAPPINGS/ETSI/GSM0338.TXT
-         *
-         * So, if we find a '@' (0x00) and all the next chars after that
-         * are also 0x00, we can consider the string finished already.
-         */
-        if (gsm[i] == 0x00) {
-            gsize j;
+    gsm_tables_init ();
 
-            for (j = i + 1; j < len; j++) {
-                if (gsm[j] != 0x00)
-                    break;
-            }
-            if (j == len)
-                break;
-        }
+    /*
+     * 	0x00 is NULL (when followed only by 0x00 up to the
+     * 	end of (fixed byte length) message, possibly also up to
+     * 	FORM FEED.  But 0x00 is also the code for COMMERCIAL AT
+     * 	when some other character (CARRIAGE RETURN if nothing else)
+     * 	comes after the 0x00.
+     *  http://unicode.org/Public/MAPPINGS/ETSI/GSM0338.TXT
+     *
+     * So, if we find a '@' (0x00) and all the next chars after that
+     * are also 0x00, we can consider the string finished already.
+     */
+    for (end = len; end > 0 && gsm[end - 1] == 0x00; end--);
+
+    /* worst case length, as every char in the default alphabet takes up to
+     * 2 bytes in UTF-8, and every escaped char up to 3 bytes */
+    utf8 = g_malloc (len * 2 + 1);
+    out = utf8;
+
+    for (i = 0; i < end; i++) {
+        const GsmUtf8Mapping *mapping = NULL;
 
         if (gsm[i] == GSM_ESCAPE_CHAR) {
             /* Extended alphabet, decode next char */
-            if (i + 1 < len) {
-                ulen = gsm_ext_char_to_utf8 (gsm[i + 1], uchars);
-                if (ulen)
+            if (i + 1 < len && gsm[i + 1] < GSM_DEF_ALPHABET_SIZE) {
+                mapping = gsm_ext_table[gsm[i + 1]];
+                if (mapping)
                     i += 1;
             }
-        } else {
+        } else if (gsm[i] < GSM_DEF_ALPHABET_SIZE) {
             /* Default alphabet */
-            ulen = gsm_def_char_to_utf8 (gsm[i], uchars);
+            mapping = &gsm_def_utf8_alphabet[gsm[i]];
         }
 
-        if (ulen)
-            g_byte_array_append (utf8, &uchars[0], ulen);
-        else if (translit)
-            g_byte_array_append (utf8, (guint8 *) translit_fallback, strlen (translit_fallback));
+        if (mapping) {
+            memcpy (out, &mapping->chars[0], mapping->len);
+            out += mapping->len;
+        } else if (translit)
+            *out++ = translit_fallback[0];
         else {
             g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_INVALID_ARGS,
                          "Invalid conversion from GSM7");
@@ -358,8 +393,8 @@ charset_gsm_unpacked_to_utf8 (const guint8  *gsm,
     }
 
     /* Always make sure returned string is NUL terminated */
-    g_byte_array_append (utf8, (guint8 *) "\0", 1);
-    return g_byte_array_free (g_steal_pointer (&utf8), FALSE);
+    *out = '\0';
+    return g_steal_pointer (&utf8);
 }
 
 static guint8 *
@@ -368,10 +403,9 @@ charset_utf8_to_unpacked_gsm (const gchar  *utf8,
                               guint32      *out_len,
                               GError      **error)
 {
-    g_autoptr(GByteArray)  gsm = NULL;
-    const gchar           *c;
-    const gchar           *next;
-    static const guint8    gesc = GSM_ESCAPE_CHAR;
+    g_autofree guint8 *gsm = NULL;
+    const gchar       *c;
+    guint32            n = 0;
 
     if (!utf8 || !g_utf8_validate (utf8, -1, NULL)) {
         g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_INVALID_ARGS,
@@ -379,50 +413,35 @@ charset_utf8_to_unpacked_gsm (const gchar  *utf8,
         return NULL;
     }
 
-    /* worst case initial length */
-    gsm = g_byte_array_sized_new (g_utf8_strlen (utf8, -1) * 2 + 1);
-
-    if (*utf8 == 0x00) {
-        /* Zero-length string */
-        g_byte_array_append (gsm, (guint8 *) "\0", 1);
-        if (out_len)
-            *out_len = 0;
-        return g_byte_array_free (g_steal_pointer (&gsm), FALSE);
-    }
+    /* worst case length, as every UTF-8 char takes at least 1 byte, and is
+     * encoded in at most 2 bytes (escape char and extended char) */
+    gsm = g_malloc (strlen (utf8) * 2 + 1);
 
-    next = utf8;
-    c    = utf8;
-    while (next && *next) {
-        guint8 gch = 0x3f;  /* 0x3f == '?' */
+    for (c = utf8; *c; c = g_utf8_next_char (c)) {
+        guint16 entry;
 
-        next = g_utf8_next_char (c);
-
-        /* Try escaped chars first, then default alphabet */
-        if (utf8_to_gsm_ext_char (c, next - c, &gch)) {
-            /* Add the escape char */
-            g_byte_array_append (gsm, &gesc, 1);
-            g_byte_array_append (gsm, &gch, 1);
-        } else if (utf8_to_gsm_def_char (c, next - c, &gch)) {
-            g_byte_array_append (gsm, &gch, 1);
+        entry = utf8_to_gsm_lookup (c, g_utf8_skip[*(const guchar *) c]);
+        if (entry & GSM_LOOKUP_EXT) {
+            gsm[n++] = GSM_ESCAPE_CHAR;
+            gsm[n++] = entry & GSM_LOOKUP_CHAR_MASK;
+        } else if (entry & GSM_LOOKUP_DEF) {
+            gsm[n++] = entry & GSM_LOOKUP_CHAR_MASK;
         } else if (translit) {
-            /* add ? */
-            g_byte_array_append (gsm, &gch, 1);
+            gsm[n++] = 0x3f;  /* 0x3f == '?' */
         } else {
             g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_INVALID_ARGS,
                          "Couldn't convert UTF-8 char to GSM");
             return NULL;
         }
-
-        c = next;
     }
 
     /* Output length doesn't consider terminating NUL byte */
     if (out_len)
-        *out_len = gsm->len;
+        *out_len = n;
 
     /* Always make sure returned string is NUL terminated */
-    g_byte_array_append (gsm, (guint8 *) "\0", 1);
-    return g_byte_array_free (g_steal_pointer (&gsm), FALSE);
+    gsm[n] = '\0';
+    return g_steal_pointer (&gsm);
 }
 
 /******************************************************************************/
@@ -604,40 +623,74 @@ mm_charset_can_convert_to (const gchar    *utf8,
 /******************************************************************************/
 /* GSM-7 pack/unpack operations */
 
+static inline guint8
+gsm_unpack_septet (const guint8 *gsm,
+                   guint32       start_bit)
+{
+    guint8 offset;
+    guint8 c;
+
+    offset = start_bit % 8;  /* Offset to start of char in this byte */
+
+    /* Grab bits in the current byte, and any bits that spilled over to next byte */
+    c = gsm[start_bit / 8] >> offset;
+    if (offset > 1)
+        c |= gsm[(start_bit / 8) + 1] << (8 - offset);
+    return c & 0x7F;
+}
+
+static inline void
+gsm_pack_septet (guint8   *packed,
+                 guint32   start_bit,
+                 guint8    c)
+{
+    guint8 offset;
+
+    offset = start_bit % 8;
+    c &= 0x7F;
+
+    packed[start_bit / 8] |= c << offset;
+    if (offset > 1)
+        packed[(start_bit / 8) + 1] |= c >> (8 - offset);
+}
+
+/*
+ * Every 8 septets take exactly 7 bytes, so once the septets sharing bytes
+ * with the start offset are processed, the remaining ones are handled in
+ * blocks of 8 septets, moved in a single 64-bit word from/to 7 bytes.
+ */
+
 guint8 *
 mm_charset_gsm_unpack (const guint8 *gsm,
                        guint32       num_septets,
                        guint8        start_offset,  /* in _bits_ */
                        guint32      *out_unpacked_len)
 {
-    GByteArray *unpacked;
-    guint i;
-
-    unpacked = g_byte_array_sized_new (num_septets + 1);
+    guint8  *unpacked;
+    guint32  i = 0;
 
-    for (i = 0; i < num_septets; i++) {
-        guint8 bits_here, bits_in_next, octet, offset, c;
-        guint32 start_bit;
+    unpacked = g_malloc (num_septets + 1);
 
-        start_bit = start_offset + (i * 7); /* Overall bit offset of char in buffer */
-        offset = start_bit % 8;  /* Offset to start of char in this byte */
-        bits_here = offset ? (8 - offset) : 7;
-        bits_in_next = 7 - bits_here;
+    for (; i < num_septets && ((start_offset + (i * 7)) % 8) != 0; i++)
+        unpacked[i] = gsm_unpack_septet (gsm, start_offset + (i * 7));
 
-        /* Grab bits in the current byte */
-        octet = gsm[start_bit / 8];
-        c = (octet >> offset) & (0xFF >> (8 - bits_here));
+    for (; i + 8 <= num_septets; i += 8) {
+        const guint8 *block;
+        guint64       word = 0;
+        guint         j;
 
-        /* Grab any bits that spilled over to next byte */
-        if (bits_in_next) {
-            octet = gsm[(start_bit / 8) + 1];
-            c |= (octet & (0xFF >> (8 - bits_in_next))) << bits_here;
-        }
-        g_byte_array_append (unpacked, &c, 1);
+        block = &gsm[(start_offset + (i * 7)) / 8];
+        for (j = 0; j < 7; j++)
+            word |= (guint64) block[j] << (8 * j);
+        for (j = 0; j < 8; j++)
+            unpacked[i + j] = (word >> (7 * j)) & 0x7F;
     }
 
-    *out_unpacked_len = unpacked->len;
-    return g_byte_array_free (unpacked, FALSE);
+    for (; i < num_septets; i++)
+        unpacked[i] = gsm_unpack_septet (gsm, start_offset + (i * 7));
+
+    *out_unpacked_len = num_septets;
+    return unpacked;
 }
 
 guint8 *
@@ -647,8 +700,8 @@ mm_charset_gsm_pack (const guint8 *src,
                      guint32      *out_packed_len)
 {
     guint8 *packed;
-    guint octet = 0, lshift, plen;
-    guint i = 0;
+    guint   plen;
+    guint   i = 0;
 
     g_return_val_if_fail (start_offset < 8, NULL);
 
@@ -659,18 +712,24 @@ mm_charset_gsm_pack (const guint8 *src,
 
     packed = g_malloc0 (plen);
 
-    for (i = 0, lshift = start_offset; i < src_len; i++) {
-        packed[octet] |= (src[i] & 0x7F) << lshift;
-        if (lshift > 1) {
-            /* Grab the lost bits and add to next octet */
-            g_assert (octet + 1 < plen);
-            packed[octet + 1] = (src[i] & 0x7F) >> (8 - lshift);
-        }
-        if (lshift)
-            octet++;
-        lshift = lshift ? lshift - 1 : 7;
+    for (; i < src_len && ((start_offset + (i * 7)) % 8) != 0; i++)
+        gsm_pack_septet (packed, start_offset + (i * 7), src[i]);
+
+    for (; i + 8 <= src_len; i += 8) {
+        guint8  *block;
+        guint64  word = 0;
+        guint    j;
+
+        block = &packed[(start_offset + (i * 7)) / 8];
+        for (j = 0; j < 8; j++)
+            word |= (guint64) (src[i + j] & 0x7F) << (7 * j);
+        for (j = 0; j < 7; j++)
+            block[j] = (word >> (8 * j)) & 0xFF;
     }
 
+    for (; i < src_len; i++)
+        gsm_pack_septet (packed, start_offset + (i * 7), src[i]);
+
     if (out_packed_len)
         *out_packed_len = plen;
     return packed;
@@ -679,6 +738,187 @@ mm_charset_gsm_pack (const guint8 *src,
 /*****************************************************************************/
 /* Main conversion functions */
 
+/* UCS-2, UTF-16, IRA and UTF-8 are converted natively, as these are by far
+ * the most common ones; iconv is only used for the other charsets. */
+
+static guint8 *
+charset_native_from_utf8 (const gchar            *utf8,
+                          const CharsetSettings  *settings,
+                          gboolean                translit,
+                          guint                  *out_size,
+                          GError                **error)
+{
+    g_autofree guint8 *encoded = NULL;
+    const gchar       *p;
+    guint              n = 0;
+
+    if (!utf8 || !g_utf8_validate (utf8, -1, NULL)) {
+        g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_INVALID_ARGS,
+                     "Couldn't convert from UTF-8 to %s: input UTF-8 validation failed",
+                     settings->gsm_name);
+        return NULL;
+    }
+
+    if (settings->charset == MM_MODEM_CHARSET_UTF8) {
+        if (out_size)
+            *out_size = strlen (utf8);
+        return (guint8 *) g_strdup (utf8);
+    }
+
+    /* worst case length, as every UTF-8 char of 1, 2 or 3 bytes takes 2 bytes
+     * in UCS-2 or UTF-16, and every UTF-8 char of 4 bytes takes a UTF-16
+     * surrogate pair; plus a 2-byte NUL terminator */
+    encoded = g_malloc (strlen (utf8) * 2 + 2);
+
+    for (p = utf8; *p; p = g_utf8_next_char (p)) {
+        gunichar c;
+
+        c = g_utf8_get_char (p);
+
+        if (settings->charset == MM_MODEM_CHARSET_IRA) {
+            if (c > 0x7F) {
+                if (!translit)
+                    goto unsupported;
+                c = translit_fallback[0];
+            }
+            encoded[n++] = c;
+            continue;
+        }
+
+        if (c > 0xFFFF) {
+            if (settings->charset == MM_MODEM_CHARSET_UTF16) {
+                c -= 0x10000;
+                encoded[n++] = 0xD8 | (c >> 18);
+                encoded[n++] = (c >> 10) & 0xFF;
+                encoded[n++] = 0xDC | ((c >> 8) & 0x03);
+                encoded[n++] = c & 0xFF;
+                continue;
+            }
+            if (!translit)
+                goto unsupported;
+            c = translit_fallback[0];
+        }
+        encoded[n++] = c >> 8;
+        encoded[n++] = c & 0xFF;
+    }
+
+    encoded[n] = '\0';
+    encoded[n + 1] = '\0';
+    if (out_size)
+        *out_size = n;
+    return g_steal_pointer (&encoded);
+
+unsupported:
+    g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_INVALID_ARGS,
+                 "Couldn't convert from UTF-8 to %s: character not supported in target charset",
+                 settings->gsm_name);
+    return NULL;
+}
+
+static gchar *
+charset_native_to_utf8 (const guint8           *data,
+                        guint32                 len,
+                        const CharsetSettings  *settings,
+                        gboolean                translit,
+                        GError                **error)
+{
+    g_autofree gchar *utf8 = NULL;
+    gchar            *out;
+    guint32           i;
+
+    if (settings->charset == MM_MODEM_CHARSET_UTF8) {
+        if (!g_utf8_validate ((const gchar *) data, len, NULL)) {
+            g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_INVALID_ARGS,
+                         "Couldn't convert from UTF-8 to UTF-8: invalid UTF-8");
+            return NULL;
+        }
+        utf8 = g_malloc (len + 1);
+        memcpy (utf8, data, len);
+        utf8[len] = '\0';
+        return g_steal_pointer (&utf8);
+    }
+
+    if (settings->charset == MM_MODEM_CHARSET_IRA) {
+        utf8 = g_malloc (len + 1);
+        for (i = 0; i < len; i++) {
+            if (data[i] > 0x7F) {
+                if (!translit)
+                    goto invalid;
+                utf8[i] = translit_fallback[0];
+            } else
+                utf8[i] = data[i];
+        }
+        utf8[len] = '\0';
+        return g_steal_pointer (&utf8);
+    }
+
+    if (len % 2) {
+        g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_INVALID_ARGS,
+                     "Couldn't convert from %s to UTF-8: partial character sequence at end of input",
+                     settings->gsm_name);
+        return NULL;
+    }
+
+    /* worst case length, as every 2 bytes take up to 3 bytes in UTF-8, and
+     * every 4-byte UTF-16 surrogate pair takes 4 bytes in UTF-8 */
+    utf8 = g_malloc ((len / 2) * 3 + 1);
+    out = utf8;
+
+    for (i = 0; i < len; i += 2) {
+        gunichar c;
+
+        c = (data[i] << 8) | data[i + 1];
+        if (c >= 0xD800 && c <= 0xDFFF) {
+            gunichar low = 0;
+
+            if (i + 3 < len)
+                low = (data[i + 2] << 8) | data[i + 3];
+
+            if (settings->charset == MM_MODEM_CHARSET_UTF16 &&
+                c < 0xDC00 && low >= 0xDC00 && low <= 0xDFFF) {
+                c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                i += 2;
+            } else if (translit)
+                c = translit_fallback[0];
+            else
+                goto invalid;
+        }
+        out += g_unichar_to_utf8 (c, out);
+    }
+
+    *out = '\0';
+    return g_steal_pointer (&utf8);
+
+invalid:
+    g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_INVALID_ARGS,
+                 "Couldn't convert from %s to UTF-8: invalid input sequence",
+                 settings->gsm_name);
+    return NULL;
+}
+
+/* The iconv conversion descriptors are opened once per charset and direction,
+ * and reused afterwards; (GIConv) -1 is kept if not supported. */
+static GIConv
+charset_iconv_get (const CharsetSettings *settings,
+                   gboolean               from_utf8)
+{
+    static GIConv  cache[G_N_ELEMENTS (charset_settings)][2];
+    GIConv        *cd;
+
+    cd = &cache[settings - charset_settings][from_utf8 ? 1 : 0];
+    if (!*cd) {
+        if (from_utf8)
+            *cd = g_iconv_open (settings->iconv_name, "UTF-8");
+        else
+            *cd = g_iconv_open ("UTF-8", settings->iconv_name);
+    } else if (*cd != (GIConv) -1) {
+        /* Reset the conversion state, a previous conversion may have
+         * failed halfway */
+        g_iconv (*cd, NULL, NULL, NULL, NULL);
+    }
+    return *cd;
+}
+
 static guint8 *
 charset_iconv_from_utf8 (const gchar            *utf8,
                          const CharsetSettings  *settings,
@@ -689,10 +929,14 @@ charset_iconv_from_utf8 (const gchar            *utf8,
     g_autoptr(GError)      inner_error = NULL;
     gsize                  bytes_written = 0;
     g_autofree guint8     *encoded = NULL;
-
-    encoded = (guint8 *) g_convert (utf8, -1,
-                                    settings->iconv_name, "UTF-8",
-                                    NULL, &bytes_written, &inner_error);
+    GIConv                 cd;
+
+    cd = charset_iconv_get (settings, TRUE);
+    if (cd == (GIConv) -1)
+        g_set_error (&inner_error, G_CONVERT_ERROR, G_CONVERT_ERROR_NO_CONVERSION,
+                     "Conversion from UTF-8 to %s is not supported", settings->iconv_name);
+    else
+        encoded = (guint8 *) g_convert_with_iconv (utf8, -1, cd, NULL, &bytes_written, &inner_error);
     if (encoded) {
         if (out_size)
             *out_size = (guint) bytes_written;
@@ -741,12 +985,14 @@ mm_modem_charset_bytearray_from_utf8 (const gchar     *utf8,
             encoded = charset_utf8_to_unpacked_gsm (utf8, translit, &encoded_size, error);
             break;
         case MM_MODEM_CHARSET_IRA:
-        case MM_MODEM_CHARSET_8859_1:
         case MM_MODEM_CHARSET_UTF8:
         case MM_MODEM_CHARSET_UCS2:
+        case MM_MODEM_CHARSET_UTF16:
+            encoded = charset_native_from_utf8 (utf8, settings, translit, &encoded_size, error);
+            break;
+        case MM_MODEM_CHARSET_8859_1:
         case MM_MODEM_CHARSET_PCCP437:
         case MM_MODEM_CHARSET_PCDN:
-        case MM_MODEM_CHARSET_UTF16:
             encoded = charset_iconv_from_utf8 (utf8, settings, translit, &encoded_size, error);
             break;
         case MM_MODEM_CHARSET_UNKNOWN:
@@ -813,11 +1059,14 @@ charset_iconv_to_utf8 (const guint8           *data,
 {
     g_autoptr(GError)  inner_error = NULL;
     g_autofree gchar  *utf8 = NULL;
-
-    utf8 = g_convert ((const gchar *) data, len,
-                      "UTF-8",
-                      settings->iconv_name,
-                      NULL, NULL, &inner_error);
+    GIConv             cd;
+
+    cd = charset_iconv_get (settings, FALSE);
+    if (cd == (GIConv) -1)
+        g_set_error (&inner_error, G_CONVERT_ERROR, G_CONVERT_ERROR_NO_CONVERSION,
+                     "Conversion from %s to UTF-8 is not supported", settings->iconv_name);
+    else
+        utf8 = g_convert_with_iconv ((const gchar *) data, len, cd, NULL, NULL, &inner_error);
     if (utf8)
         return g_steal_pointer (&utf8);
 
@@ -863,11 +1112,17 @@ mm_modem_charset_bytearray_to_utf8 (GByteArray      *bytearray,
             break;
         case MM_MODEM_CHARSET_IRA:
         case MM_MODEM_CHARSET_UTF8:
+        case MM_MODEM_CHARSET_UCS2:
+        case MM_MODEM_CHARSET_UTF16:
+            utf8 = charset_native_to_utf8 (bytearray->data,
+                                           bytearray->len,
+                                           settings,
+                                           translit,
+                                           error);
+            break;
         case MM_MODEM_CHARSET_8859_1:
         case MM_MODEM_CHARSET_PCCP437:
         case MM_MODEM_CHARSET_PCDN:
-        case MM_MODEM_CHARSET_UCS2:
-        case MM_MODEM_CHARSET_UTF16:
             utf8 = charset_iconv_to_utf8 (bytearray->data,
                                           bytearray->len,
                                           settings,
@@ -41,6 +41,14 @@ static gboolean      debug;
 static MMFilterRule  filter_policy = MM_FILTER_POLICY_STRICT;
 static gboolean      no_auto_scan = NO_AUTO_SCAN_DEFAULT;
 static const gchar  *initial_kernel_events;
+static const gchar  *probe_cache;
+static const gchar  *at_knowledge;
+static const gchar  *sim_cache;
+static const gchar  *trace_file;
+static gboolean      bearer_stats_kernel;
+static gint          bearer_stats_interval = MM_CONTEXT_BEARER_STATS_INTERVAL_DEFAULT;
+static gint          scan_cache_time;
+static gint          cell_info_cache_time;
 
 static gboolean
 filter_policy_option_arg (const gchar  *option_name,
@@ -68,6 +76,28 @@ filter_policy_option_arg (const gchar  *option_name,
     return FALSE;
 }
 
+static gboolean
+bearer_stats_source_option_arg (const gchar  *option_name,
+                                const gchar  *value,
+                                gpointer      data,
+                                GError      **error)
+{
+    if (!g_ascii_strcasecmp (value, "modem")) {
+        bearer_stats_kernel = FALSE;
+        return TRUE;
+    }
+
+    if (!g_ascii_strcasecmp (value, "kernel")) {
+        bearer_stats_kernel = TRUE;
+        return TRUE;
+    }
+
+    g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
+                 "Invalid bearer stats source value given: %s",
+                 value);
+    return FALSE;
+}
+
 static const GOptionEntry entries[] = {
     {
         "filter-policy", 0, 0, G_OPTION_ARG_CALLBACK, filter_policy_option_arg,
@@ -84,6 +114,46 @@ static const GOptionEntry entries[] = {
         "Path to initial kernel events file",
         "[PATH]"
     },
+    {
+        "probe-cache", 0, 0, G_OPTION_ARG_FILENAME, &probe_cache,
+        "Path to the file where port probing results are kept across restarts",
+        "[PATH]"
+    },
+    {
+        "at-knowledge", 0, 0, G_OPTION_ARG_FILENAME, &at_knowledge,
+        "Path to the file where the learned AT command support of each device is kept",
+        "[PATH]"
+    },
+    {
+        "sim-cache", 0, 0, G_OPTION_ARG_FILENAME, &sim_cache,
+        "Path to the file where the SIM card contents are kept across restarts",
+        "[PATH]"
+    },
+    {
+        "trace-file", 0, 0, G_OPTION_ARG_FILENAME, &trace_file,
+        "Path to the file where the raw traffic with the modem ports is captured",
+        "[PATH]"
+    },
+    {
+        "bearer-stats-source", 0, 0, G_OPTION_ARG_CALLBACK, bearer_stats_source_option_arg,
+        "Source of connected bearer statistics: one of MODEM, KERNEL",
+        "[SOURCE]"
+    },
+    {
+        "bearer-stats-interval", 0, 0, G_OPTION_ARG_INT, &bearer_stats_interval,
+        "Interval between connected bearer statistics updates, in seconds",
+        "[SECONDS]"
+    },
+    {
+        "scan-cache-time", 0, 0, G_OPTION_ARG_INT, &scan_cache_time,
+        "Time during which network scan results are reused, in seconds",
+        "[SECONDS]"
+    },
+    {
+        "cell-info-cache-time", 0, 0, G_OPTION_ARG_INT, &cell_info_cache_time,
+        "Time during which cell info results are reused, in seconds",
+        "[SECONDS]"
+    },
     {
         "debug", 0, 0, G_OPTION_ARG_NONE, &debug,
         "Run with extended debugging capabilities",
@@ -114,6 +184,54 @@ mm_context_get_initial_kernel_events (void)
     return initial_kernel_events;
 }
 
+const gchar *
+mm_context_get_probe_cache (void)
+{
+    return probe_cache;
+}
+
+const gchar *
+mm_context_get_at_knowledge (void)
+{
+    return at_knowledge;
+}
+
+const gchar *
+mm_context_get_sim_cache (void)
+{
+    return sim_cache;
+}
+
+const gchar *
+mm_context_get_trace_file (void)
+{
+    return trace_file;
+}
+
+gboolean
+mm_context_get_bearer_stats_kernel (void)
+{
+    return bearer_stats_kernel;
+}
+
+guint
+mm_context_get_bearer_stats_interval (void)
+{
+    return (guint) bearer_stats_interval;
+}
+
+guint
+mm_context_get_scan_cache_time (void)
+{
+    return (guint) scan_cache_time;
+}
+
+guint
+mm_context_get_cell_info_cache_time (void)
+{
+    return (guint) cell_info_cache_time;
+}
+
 gboolean
 mm_context_get_no_auto_scan (void)
 {
@@ -135,6 +253,7 @@ static gboolean     log_journal;
 static gboolean     log_show_ts;
 static gboolean     log_rel_ts;
 static gboolean     log_personal_info;
+static gboolean     log_async;
 
 static const GOptionEntry log_entries[] = {
     {
@@ -169,6 +288,11 @@ static const GOptionEntry log_entries[] = {
         "Show personal info in logs",
         NULL
     },
+    {
+        "log-async", 0, 0, G_OPTION_ARG_NONE, &log_async,
+        "Write logs from a separate thread, dropping messages if it can't keep up",
+        NULL
+    },
     { NULL }
 };
 
@@ -222,6 +346,12 @@ mm_context_get_log_personal_info (void)
     return log_personal_info;
 }
 
+gboolean
+mm_context_get_log_async (void)
+{
+    return log_async;
+}
+
 /*****************************************************************************/
 /* Test context */
 
@@ -465,6 +595,21 @@ mm_context_init (gint argc,
             log_show_ts = TRUE;
     }
 
+    if (bearer_stats_interval < 1) {
+        g_printerr ("error: --bearer-stats-interval must be at least 1 second\n");
+        exit (1);
+    }
+
+    if (scan_cache_time < 0) {
+        g_printerr ("error: --scan-cache-time must not be negative\n");
+        exit (1);
+    }
+
+    if (cell_info_cache_time < 0) {
+        g_printerr ("error: --cell-info-cache-time must not be negative\n");
+        exit (1);
+    }
+
     /* Initial kernel events processing may only be used if autoscan is disabled */
 #if defined WITH_UDEV || defined WITH_QRTR
     if (!no_auto_scan && initial_kernel_events) {
@@ -30,8 +30,21 @@ void mm_context_init (gint    argc,
 
 gboolean     mm_context_get_debug                 (void);
 const gchar *mm_context_get_initial_kernel_events (void);
+const gchar *mm_context_get_probe_cache           (void);
+const gchar *mm_context_get_at_knowledge          (void);
+const gchar *mm_context_get_sim_cache             (void);
+const gchar *mm_context_get_trace_file            (void);
 gboolean     mm_context_get_no_auto_scan          (void);
 
+/* Bearer statistics support */
+#define MM_CONTEXT_BEARER_STATS_INTERVAL_DEFAULT 30
+gboolean     mm_context_get_bearer_stats_kernel   (void);
+guint        mm_context_get_bearer_stats_interval (void);
+
+/* Network scan and cell info support */
+guint        mm_context_get_scan_cache_time       (void);
+guint        mm_context_get_cell_info_cache_time  (void);
+
 /* Filter support */
 MMFilterRule mm_context_get_filter_policy (void);
 
@@ -42,6 +55,7 @@ gboolean     mm_context_get_log_journal             (void);
 gboolean     mm_context_get_log_timestamps          (void);
 gboolean     mm_context_get_log_relative_timestamps (void);
 gboolean     mm_context_get_log_personal_info       (void);
+gboolean     mm_context_get_log_async               (void);
 
 /* Testing support */
 gboolean     mm_context_get_test_session           (void);
@@ -25,6 +25,7 @@
 
 #include "mm-device.h"
 #include "mm-plugin.h"
+#include "mm-probe-cache.h"
 #include "mm-log-object.h"
 #include "mm-daemon-enums-types.h"
 
@@ -448,13 +449,33 @@ reprobe (MMDevice *self)
     return G_SOURCE_REMOVE;
 }
 
+static void
+store_probe_results (MMDevice *self)
+{
+    GList *probes;
+
+    probes = g_list_concat (g_list_copy (self->priv->port_probes),
+                            g_list_copy (self->priv->ignored_port_probes));
+    mm_probe_cache_store (mm_probe_cache_get (),
+                          self->priv->uid,
+                          mm_plugin_get_name (self->priv->plugin),
+                          probes,
+                          (MMProbeCachePeekPortFn) mm_port_probe_peek_port,
+                          (MMProbeCacheSaveFn) mm_port_probe_save_results);
+    g_list_free (probes);
+}
+
 static void
 modem_valid (MMBaseModem *modem,
              GParamSpec  *pspec,
              MMDevice    *self)
 {
     if (!mm_base_modem_get_valid (modem)) {
-        /* Modem no longer valid */
+        /* Modem no longer valid; the cached probing results may be stale
+         * (e.g. after a firmware switch), so make sure the next attempt does
+         * a full probing */
+        if (!self->priv->virtual)
+            mm_probe_cache_forget (mm_probe_cache_get (), self->priv->uid);
         mm_device_remove_modem (self);
         if (mm_base_modem_get_reprobe (modem))
             self->priv->reprobe_id = g_timeout_add_seconds (REPROBE_SECS, (GSourceFunc)reprobe, self);
@@ -463,9 +484,12 @@ modem_valid (MMBaseModem *modem,
          * It may happen that the initialization sequence fails because the
          * modem gets disconnected, and in that case we don't really need
          * to export it */
-        if (self->priv->modem)
+        if (self->priv->modem) {
+            /* Keep the probing results for the next time this device shows up */
+            if (!self->priv->virtual)
+                store_probe_results (self);
             export_modem (self);
-        else
+        } else
             mm_obj_dbg (self, "not exporting modem; no longer available");
     }
 }
@@ -509,14 +533,20 @@ mm_device_create_modem (MMDevice  *self,
     }
 
     self->priv->modem = mm_plugin_create_modem (self->priv->plugin, self, error);
-    if (self->priv->modem)
-        /* We want to get notified when the modem becomes valid/invalid */
-        self->priv->modem_valid_id = g_signal_connect (self->priv->modem,
-                                                       "notify::" MM_BASE_MODEM_VALID,
-                                                       G_CALLBACK (modem_valid),
-                                                       self);
+    if (!self->priv->modem) {
+        /* Cached probing results may be the reason why the modem cannot be
+         * created, make sure the next attempt does a full probing */
+        if (!self->priv->virtual)
+            mm_probe_cache_forget (mm_probe_cache_get (), self->priv->uid);
+        return FALSE;
+    }
 
-    return !!self->priv->modem;
+    /* We want to get notified when the modem becomes valid/invalid */
+    self->priv->modem_valid_id = g_signal_connect (self->priv->modem,
+                                                   "notify::" MM_BASE_MODEM_VALID,
+                                                   G_CALLBACK (modem_valid),
+                                                   self);
+    return TRUE;
 }
 
 /*****************************************************************************/
@@ -624,6 +654,12 @@ mm_device_peek_port_probe_list (MMDevice *self)
     return self->priv->port_probes;
 }
 
+GList *
+mm_device_peek_ignored_port_probe_list (MMDevice *self)
+{
+    return self->priv->ignored_port_probes;
+}
+
 void
 mm_device_reset_port_probe_list (MMDevice *self)
 {
@@ -113,6 +113,7 @@ GObject         *mm_device_peek_port_probe       (MMDevice       *self,
 GObject         *mm_device_get_port_probe        (MMDevice       *self,
                                                   MMKernelDevice *kernel_port);
 GList           *mm_device_peek_port_probe_list  (MMDevice       *self);
+GList           *mm_device_peek_ignored_port_probe_list (MMDevice *self);
 void             mm_device_reset_port_probe_list (MMDevice       *self);
 
 /* For testing purposes */
@@ -30,6 +30,9 @@
 #include "mm-error-helpers.h"
 #include "mm-log.h"
 #include "mm-log-helpers.h"
+#include "mm-context.h"
+#include "mm-shared-request.h"
+#include "mm-timer-wheel.h"
 
 #define SUBSYSTEM_3GPP "3gpp"
 
@@ -78,6 +81,8 @@ typedef struct {
     gboolean check_running;
     /* Packet service state */
     gboolean packet_service_state_update_supported;
+    /* Network scans, shared by concurrent requests */
+    MMSharedRequest *scan;
 } Private;
 
 static void
@@ -89,7 +94,8 @@ private_free (Private *priv)
         g_object_unref (priv->pending_registration_cancellable);
     }
     if (priv->check_timeout_source)
-        g_source_remove (priv->check_timeout_source);
+        mm_timer_wheel_remove (priv->check_timeout_source);
+    g_clear_pointer (&priv->scan, mm_shared_request_free);
     g_slice_free (Private, priv);
 }
 
@@ -981,27 +987,74 @@ build_scan_networks_result (MMIfaceModem3gpp *self,
     return g_variant_ref_sink (g_variant_builder_end (&builder));
 }
 
+/* Scan requests received while a scan is ongoing are completed with the
+ * results of that same scan, instead of queueing a new one. If a cache time
+ * is configured, the results of the last scan are also reused for the
+ * requests received within that time. */
+
+static GVariant *
+scan_load_finish (MMIfaceModem3gpp  *self,
+                  GAsyncResult      *res,
+                  GError           **error)
+{
+    GList    *info_list;
+    GVariant *dict_array;
+    GError   *inner_error = NULL;
+
+    info_list = MM_IFACE_MODEM_3GPP_GET_INTERFACE (self)->scan_networks_finish (self, res, &inner_error);
+    if (inner_error) {
+        mm_obj_warn (self, "failed scanning networks: %s", inner_error->message);
+        g_propagate_error (error, inner_error);
+        return NULL;
+    }
+
+    mm_obj_info (self, "network scan performed: %u found", g_list_length (info_list));
+    dict_array = build_scan_networks_result (self, info_list);
+    mm_3gpp_network_info_list_free (info_list);
+    return dict_array;
+}
+
+static void
+scan_cache_changed (MMIfaceModem3gpp *self,
+                    gint64            cached_time)
+{
+    g_autoptr(MmGdbusModem3gpp) skeleton = NULL;
+
+    g_object_get (self,
+                  MM_IFACE_MODEM_3GPP_DBUS_SKELETON, &skeleton,
+                  NULL);
+    if (skeleton)
+        mm_gdbus_modem3gpp_set_last_scan_time (skeleton, (guint64) (cached_time / G_USEC_PER_SEC));
+}
+
+static void
+scan_invalidate (MMIfaceModem3gpp *self)
+{
+    Private           *priv;
+    g_autoptr(GError)  error = NULL;
+
+    priv = get_private (self);
+    if (!priv->scan)
+        return;
+
+    error = g_error_new_literal (MM_CORE_ERROR, MM_CORE_ERROR_WRONG_STATE,
+                                 "Modem disabled while scanning networks");
+    mm_shared_request_invalidate (priv->scan, error);
+}
+
 static void
 handle_scan_ready (MMIfaceModem3gpp  *self,
                    GAsyncResult      *res,
                    HandleScanContext *ctx)
 {
     GError              *error = NULL;
-    GList               *info_list;
     g_autoptr(GVariant)  dict_array = NULL;
 
-    info_list = MM_IFACE_MODEM_3GPP_GET_INTERFACE (self)->scan_networks_finish (self, res, &error);
-    if (error) {
-        mm_obj_warn (self, "failed scanning networks: %s", error->message);
+    dict_array = mm_shared_request_run_finish (res, &error);
+    if (!dict_array)
         mm_dbus_method_invocation_take_error (ctx->invocation, error);
-        handle_scan_context_free (ctx);
-        return;
-    }
-
-    mm_obj_info (self, "network scan performed: %u found", g_list_length (info_list));
-    dict_array = build_scan_networks_result (self, info_list);
-    mm_gdbus_modem3gpp_complete_scan (ctx->skeleton, ctx->invocation, dict_array);
-    mm_3gpp_network_info_list_free (info_list);
+    else
+        mm_gdbus_modem3gpp_complete_scan (ctx->skeleton, ctx->invocation, dict_array);
     handle_scan_context_free (ctx);
 }
 
@@ -1010,7 +1063,8 @@ handle_scan_auth_ready (MMBaseModem       *self,
                         GAsyncResult      *res,
                         HandleScanContext *ctx)
 {
-    GError *error = NULL;
+    Private *priv;
+    GError  *error = NULL;
 
     if (!mm_base_modem_authorize_finish (self, res, &error)) {
         mm_dbus_method_invocation_take_error (ctx->invocation, error);
@@ -1034,10 +1088,17 @@ handle_scan_auth_ready (MMBaseModem       *self,
         return;
     }
 
-    MM_IFACE_MODEM_3GPP_GET_INTERFACE (self)->scan_networks (
-        MM_IFACE_MODEM_3GPP (self),
-        (GAsyncReadyCallback)handle_scan_ready,
-        ctx);
+    priv = get_private (MM_IFACE_MODEM_3GPP (self));
+    if (!priv->scan)
+        priv->scan = mm_shared_request_new (self,
+                                            (MMSharedRequestLoadFn) MM_IFACE_MODEM_3GPP_GET_INTERFACE (self)->scan_networks,
+                                            (MMSharedRequestLoadFinishFn) scan_load_finish,
+                                            mm_context_get_scan_cache_time () * 1000,
+                                            (MMSharedRequestCacheChangedFn) scan_cache_changed);
+
+    mm_shared_request_run (priv->scan,
+                           (GAsyncReadyCallback)handle_scan_ready,
+                           ctx);
 }
 
 static gboolean
@@ -2426,7 +2487,7 @@ periodic_registration_check_disable (MMIfaceModem3gpp *self)
     if (!priv->check_timeout_source)
         return;
 
-    g_source_remove (priv->check_timeout_source);
+    mm_timer_wheel_remove (priv->check_timeout_source);
     priv->check_timeout_source = 0;
 
     mm_obj_dbg (self, "periodic 3GPP registration checks disabled");
@@ -2445,9 +2506,9 @@ periodic_registration_check_enable (MMIfaceModem3gpp *self)
 
     /* Create context and keep it as object data */
     mm_obj_dbg (self, "periodic 3GPP registration checks enabled");
-    priv->check_timeout_source = g_timeout_add_seconds (REGISTRATION_CHECK_TIMEOUT_SEC,
-                                                        (GSourceFunc)periodic_registration_check,
-                                                        self);
+    priv->check_timeout_source = mm_timer_wheel_add_seconds (REGISTRATION_CHECK_TIMEOUT_SEC,
+                                                             (GSourceFunc)periodic_registration_check,
+                                                             self);
 }
 
 /*****************************************************************************/
@@ -2713,6 +2774,8 @@ interface_disabling_step (GTask *task)
         /* Interface state is assumed enabled until the very end of the disabling sequence,
          * so that updates are taken into account and not ignored. */
         priv->iface_enabled = FALSE;
+        /* Scan results are no longer valid */
+        scan_invalidate (self);
         /* We are done without errors! */
         g_task_return_boolean (task, TRUE);
         g_object_unref (task);
@@ -203,8 +203,11 @@ change_current_ready (MMIfaceModemFirmware *self,
 
     if (!MM_IFACE_MODEM_FIRMWARE_GET_INTERFACE (self)->change_current_finish (self, res, &error))
         mm_dbus_method_invocation_take_error (ctx->invocation, error);
-    else
+    else {
+        /* Identification and capabilities may change with the new firmware */
+        mm_base_modem_clear_cached_replies (MM_BASE_MODEM (self));
         mm_gdbus_modem_firmware_complete_select (ctx->skeleton, ctx->invocation);
+    }
     handle_select_context_free (ctx);
 }
 
@@ -26,10 +26,12 @@
 #define SUPPORT_CHECKED_TAG "messaging-support-checked-tag"
 #define SUPPORTED_TAG       "messaging-supported-tag"
 #define STORAGE_CONTEXT_TAG "messaging-storage-context-tag"
+#define MESSAGE_LIST_TAG    "messaging-message-list-tag"
 
 static GQuark support_checked_quark;
 static GQuark supported_quark;
 static GQuark storage_context_quark;
+static GQuark message_list_quark;
 
 /*****************************************************************************/
 
@@ -454,17 +456,142 @@ mm_iface_modem_messaging_is_storage_supported_for_receiving (MMIfaceModemMessagi
 
 /*****************************************************************************/
 
+/* The list of paths exposed in the Messages property is kept in the
+ * skeleton and updated incrementally. Updates are coalesced, so that the
+ * property is emitted at most once per main loop iteration, or once at the
+ * end of a batch (e.g. while loading the messages already in the storages).
+ * The Added/Deleted signals are queued as well, so that they are always
+ * emitted after the property includes the change. */
+
+typedef struct {
+    gchar    *path;
+    gboolean  deleted;
+    gboolean  received;
+} MessageListEvent;
+
+typedef struct {
+    MmGdbusModemMessaging *skeleton;
+    /* NULL-terminated array of paths */
+    GPtrArray             *paths;
+    /* Pending signals */
+    GArray                *events;
+    guint                  batch;
+    guint                  flush_id;
+} MessageList;
+
 static void
-update_message_list (MmGdbusModemMessaging *skeleton,
-                     MMSmsList *list)
+message_list_event_clear (MessageListEvent *event)
 {
-    gchar **paths;
+    g_free (event->path);
+}
 
-    paths = mm_sms_list_get_paths (list);
-    mm_gdbus_modem_messaging_set_messages (skeleton, (const gchar *const *)paths);
-    g_strfreev (paths);
+static void
+message_list_free (MessageList *ctx)
+{
+    if (ctx->flush_id)
+        g_source_remove (ctx->flush_id);
+    g_ptr_array_unref (ctx->paths);
+    g_array_unref (ctx->events);
+    g_slice_free (MessageList, ctx);
+}
+
+static MessageList *
+get_message_list (MmGdbusModemMessaging *skeleton)
+{
+    MessageList *ctx;
+
+    if (G_UNLIKELY (!message_list_quark))
+        message_list_quark = g_quark_from_static_string (MESSAGE_LIST_TAG);
+
+    ctx = g_object_get_qdata (G_OBJECT (skeleton), message_list_quark);
+    if (!ctx) {
+        ctx = g_slice_new0 (MessageList);
+        ctx->skeleton = skeleton;
+        ctx->paths = g_ptr_array_new_with_free_func (g_free);
+        g_ptr_array_add (ctx->paths, NULL);
+        ctx->events = g_array_new (FALSE, FALSE, sizeof (MessageListEvent));
+        g_array_set_clear_func (ctx->events, (GDestroyNotify) message_list_event_clear);
+        g_object_set_qdata_full (G_OBJECT (skeleton),
+                                 message_list_quark,
+                                 ctx,
+                                 (GDestroyNotify) message_list_free);
+    }
+
+    return ctx;
+}
+
+static void
+message_list_flush (MessageList *ctx)
+{
+    g_autoptr(GArray) events = NULL;
+    guint             i;
+
+    if (ctx->flush_id) {
+        g_source_remove (ctx->flush_id);
+        ctx->flush_id = 0;
+    }
+
+    mm_gdbus_modem_messaging_set_messages (ctx->skeleton, (const gchar *const *) ctx->paths->pdata);
+    g_dbus_interface_skeleton_flush (G_DBUS_INTERFACE_SKELETON (ctx->skeleton));
+
+    /* Signal handlers may end up modifying the list */
+    events = g_steal_pointer (&ctx->events);
+    ctx->events = g_array_new (FALSE, FALSE, sizeof (MessageListEvent));
+    g_array_set_clear_func (ctx->events, (GDestroyNotify) message_list_event_clear);
+
+    for (i = 0; i < events->len; i++) {
+        MessageListEvent *event;
+
+        event = &g_array_index (events, MessageListEvent, i);
+        if (event->deleted)
+            mm_gdbus_modem_messaging_emit_deleted (ctx->skeleton, event->path);
+        else
+            mm_gdbus_modem_messaging_emit_added (ctx->skeleton, event->path, event->received);
+    }
+}
+
+static gboolean
+message_list_flush_cb (MessageList *ctx)
+{
+    ctx->flush_id = 0;
+    message_list_flush (ctx);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+message_list_schedule_flush (MessageList *ctx)
+{
+    if (!ctx->batch && !ctx->flush_id)
+        ctx->flush_id = g_idle_add ((GSourceFunc) message_list_flush_cb, ctx);
+}
+
+static void
+message_list_batch_begin (MmGdbusModemMessaging *skeleton)
+{
+    get_message_list (skeleton)->batch++;
+}
+
+static void
+message_list_batch_end (MmGdbusModemMessaging *skeleton)
+{
+    MessageList *ctx;
+
+    ctx = get_message_list (skeleton);
+    g_assert (ctx->batch > 0);
+    if (--ctx->batch == 0)
+        message_list_flush (ctx);
+}
 
-    g_dbus_interface_skeleton_flush (G_DBUS_INTERFACE_SKELETON (skeleton));
+static void
+message_list_reset (MmGdbusModemMessaging *skeleton)
+{
+    MessageList *ctx;
+
+    ctx = get_message_list (skeleton);
+    g_ptr_array_set_size (ctx->paths, 0);
+    g_ptr_array_add (ctx->paths, NULL);
+    g_array_set_size (ctx->events, 0);
+    message_list_schedule_flush (ctx);
 }
 
 static void
@@ -473,8 +600,18 @@ sms_added (MMSmsList             *list,
            gboolean               received,
            MmGdbusModemMessaging *skeleton)
 {
-    update_message_list (skeleton, list);
-    mm_gdbus_modem_messaging_emit_added (skeleton, sms_path, received);
+    MessageList      *ctx;
+    MessageListEvent  event;
+
+    ctx = get_message_list (skeleton);
+    g_ptr_array_insert (ctx->paths, ctx->paths->len - 1, g_strdup (sms_path));
+
+    event.path = g_strdup (sms_path);
+    event.deleted = FALSE;
+    event.received = received;
+    g_array_append_val (ctx->events, event);
+
+    message_list_schedule_flush (ctx);
 }
 
 static void
@@ -482,8 +619,24 @@ sms_deleted (MMSmsList             *list,
              const gchar           *sms_path,
              MmGdbusModemMessaging *skeleton)
 {
-    update_message_list (skeleton, list);
-    mm_gdbus_modem_messaging_emit_deleted (skeleton, sms_path);
+    MessageList      *ctx;
+    MessageListEvent  event;
+    guint             i;
+
+    ctx = get_message_list (skeleton);
+    for (i = 0; i < ctx->paths->len - 1; i++) {
+        if (g_str_equal (g_ptr_array_index (ctx->paths, i), sms_path)) {
+            g_ptr_array_remove_index (ctx->paths, i);
+            break;
+        }
+    }
+
+    event.path = g_strdup (sms_path);
+    event.deleted = TRUE;
+    event.received = FALSE;
+    g_array_append_val (ctx->events, event);
+
+    message_list_schedule_flush (ctx);
 }
 
 /*****************************************************************************/
@@ -781,6 +934,7 @@ load_initial_sms_parts_from_storages (GTask *task)
     }
 
     if (all_loaded) {
+        message_list_batch_end (ctx->skeleton);
         /* Go on with next step */
         ctx->step++;
         interface_enabling_step (task);
@@ -906,6 +1060,7 @@ interface_enabling_step (GTask *task)
         g_object_set (self,
                       MM_IFACE_MODEM_MESSAGING_SMS_LIST, list,
                       NULL);
+        message_list_reset (ctx->skeleton);
 
         /* Connect to list's signals */
         g_signal_connect (list,
@@ -968,6 +1123,8 @@ interface_enabling_step (GTask *task)
         /* Allow loading the initial list of SMS parts */
         if (MM_IFACE_MODEM_MESSAGING_GET_INTERFACE (self)->load_initial_sms_parts &&
             MM_IFACE_MODEM_MESSAGING_GET_INTERFACE (self)->load_initial_sms_parts_finish) {
+            /* Report all the messages found in a single update */
+            message_list_batch_begin (ctx->skeleton);
             load_initial_sms_parts_from_storages (task);
             return;
         }
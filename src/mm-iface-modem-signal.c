@@ -22,6 +22,7 @@
 #include "mm-iface-modem-signal.h"
 #include "mm-error-helpers.h"
 #include "mm-log-object.h"
+#include "mm-timer-wheel.h"
 
 #define SUPPORT_CHECKED_TAG "signal-support-checked-tag"
 #define SUPPORTED_TAG       "signal-supported-tag"
@@ -54,7 +55,7 @@ private_free (Private *priv)
     if (priv->info_log_timer)
         g_timer_destroy (priv->info_log_timer);
     if (priv->timeout_source)
-        g_source_remove (priv->timeout_source);
+        mm_timer_wheel_remove (priv->timeout_source);
     g_slice_free (Private, priv);
 }
 
@@ -277,7 +278,7 @@ polling_restart (MMIfaceModemSignal *self)
     /* Stop polling */
     if (!polling_setup) {
         if (priv->timeout_source) {
-            g_source_remove (priv->timeout_source);
+            mm_timer_wheel_remove (priv->timeout_source);
             priv->timeout_source = 0;
         }
         return;
@@ -285,8 +286,8 @@ polling_restart (MMIfaceModemSignal *self)
 
     /* Start/restart polling */
     if (priv->timeout_source)
-        g_source_remove (priv->timeout_source);
-    priv->timeout_source = g_timeout_add_seconds (priv->rate, (GSourceFunc) query_signal_values, self);
+        mm_timer_wheel_remove (priv->timeout_source);
+    priv->timeout_source = mm_timer_wheel_add_seconds (priv->rate, (GSourceFunc) query_signal_values, self);
 
     /* Also launch right away */
     query_signal_values (self);
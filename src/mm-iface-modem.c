@@ -34,6 +34,9 @@
 #include "mm-log-helpers.h"
 #include "mm-context.h"
 #include "mm-dispatcher-fcc-unlock.h"
+#include "mm-shared-request.h"
+#include "mm-timer-wheel.h"
+#include "mm-at-knowledge.h"
 #if defined WITH_QMI
 # include "mm-broadband-modem-qmi.h"
 #endif
@@ -91,6 +94,9 @@ typedef struct {
     /* Timer that tracks when the last power operation request was
      * performed, so that we can throttle the requests to the modem. */
     GTimer *power_state_timer;
+
+    /* Cell info loads, shared by concurrent requests */
+    MMSharedRequest *cell_info;
 } Private;
 
 static void
@@ -101,10 +107,11 @@ private_free (Private *priv)
     if (priv->signal_quality_recent_timeout_source)
         g_source_remove (priv->signal_quality_recent_timeout_source);
     if (priv->signal_check_timeout_source)
-        g_source_remove (priv->signal_check_timeout_source);
+        mm_timer_wheel_remove (priv->signal_check_timeout_source);
     if (priv->restart_initialize_idle_id)
         g_source_remove (priv->restart_initialize_idle_id);
     g_clear_pointer (&priv->power_state_timer, (GDestroyNotify) g_timer_destroy);
+    g_clear_pointer (&priv->cell_info, mm_shared_request_free);
     g_slice_free (Private, priv);
 }
 
@@ -346,6 +353,9 @@ mm_iface_modem_process_sim_event (MMIfaceModem *self)
 {
     mm_obj_info (self, "Processing SIM event");
 
+    /* Replies to e.g. SIM related queries are no longer valid */
+    mm_base_modem_clear_cached_replies (MM_BASE_MODEM (self));
+
     if (MM_IFACE_MODEM_GET_INTERFACE (self)->cleanup_sim_hot_swap)
         MM_IFACE_MODEM_GET_INTERFACE (self)->cleanup_sim_hot_swap (self);
 
@@ -1478,27 +1488,46 @@ get_cell_info_build_result (GList *info_list)
     return g_variant_ref_sink (g_variant_builder_end (&builder));
 }
 
+/* Cell info requests received while a load is ongoing are completed with
+ * the result of that same load. If a cache time is configured, the last
+ * cell info loaded is also reused for the requests received within that
+ * time. */
+
+static GVariant *
+cell_info_load_finish (MMIfaceModem  *self,
+                       GAsyncResult  *res,
+                       GError       **error)
+{
+    GList    *info_list;
+    GVariant *dict_array;
+    GError   *inner_error = NULL;
+
+    info_list = MM_IFACE_MODEM_GET_INTERFACE (self)->get_cell_info_finish (self, res, &inner_error);
+    if (inner_error) {
+        mm_obj_dbg (self, "failed retrieving cell info: %s", inner_error->message);
+        g_propagate_error (error, inner_error);
+        return NULL;
+    }
+
+    mm_obj_dbg (self, "cell info retrieved");
+    dict_array = get_cell_info_build_result (info_list);
+    g_list_free_full (info_list, (GDestroyNotify)g_object_unref);
+    return dict_array;
+}
+
 static void
 get_cell_info_ready (MMIfaceModem             *self,
                      GAsyncResult             *res,
                      HandleGetCellInfoContext *ctx)
 {
-    GError *error = NULL;
-    GList  *info_list;
+    GError              *error = NULL;
+    g_autoptr(GVariant)  dict_array = NULL;
 
-    info_list = MM_IFACE_MODEM_GET_INTERFACE (self)->get_cell_info_finish (self, res, &error);
-    if (error) {
-        mm_obj_dbg (self, "failed retrieving cell info: %s", error->message);
+    dict_array = mm_shared_request_run_finish (res, &error);
+    if (!dict_array)
         mm_dbus_method_invocation_take_error (ctx->invocation, error);
-    } else {
-        g_autoptr(GVariant) dict_array = NULL;
-
-        mm_obj_dbg (self, "cell info retrieved");
-        dict_array = get_cell_info_build_result (info_list);
+    else
         mm_gdbus_modem_complete_get_cell_info (ctx->skeleton, ctx->invocation, dict_array);
-    }
-
-    g_list_free_full (info_list, (GDestroyNotify)g_object_unref);
     handle_get_cell_info_context_free (ctx);
 }
 
@@ -1507,7 +1536,8 @@ handle_get_cell_info_auth_ready (MMBaseModem              *self,
                                  GAsyncResult             *res,
                                  HandleGetCellInfoContext *ctx)
 {
-    GError *error = NULL;
+    Private *priv;
+    GError  *error = NULL;
 
     if (!mm_base_modem_authorize_finish (self, res, &error)) {
         mm_dbus_method_invocation_take_error (ctx->invocation, error);
@@ -1529,10 +1559,18 @@ handle_get_cell_info_auth_ready (MMBaseModem              *self,
         return;
     }
 
+    priv = get_private (ctx->self);
+    if (!priv->cell_info)
+        priv->cell_info = mm_shared_request_new (ctx->self,
+                                                 (MMSharedRequestLoadFn) MM_IFACE_MODEM_GET_INTERFACE (self)->get_cell_info,
+                                                 (MMSharedRequestLoadFinishFn) cell_info_load_finish,
+                                                 mm_context_get_cell_info_cache_time () * 1000,
+                                                 NULL);
+
     mm_obj_info (self, "processing user request to retrieve cell info...");
-    MM_IFACE_MODEM_GET_INTERFACE (self)->get_cell_info (ctx->self,
-                                                        (GAsyncReadyCallback)get_cell_info_ready,
-                                                        ctx);
+    mm_shared_request_run (priv->cell_info,
+                           (GAsyncReadyCallback)get_cell_info_ready,
+                           ctx);
 }
 
 static gboolean
@@ -1904,9 +1942,9 @@ periodic_signal_check_step (GTask *task)
         } else {
             mm_obj_dbg (self, "periodic signal quality and access technology checks scheduled");
             g_assert (!priv->signal_check_timeout_source);
-            priv->signal_check_timeout_source = g_timeout_add_seconds (priv->signal_check_initial_done ? SIGNAL_CHECK_TIMEOUT_SEC : SIGNAL_CHECK_INITIAL_TIMEOUT_SEC,
-                                                                       (GSourceFunc) periodic_signal_check_run,
-                                                                       self);
+            priv->signal_check_timeout_source = mm_timer_wheel_add_seconds (priv->signal_check_initial_done ? SIGNAL_CHECK_TIMEOUT_SEC : SIGNAL_CHECK_INITIAL_TIMEOUT_SEC,
+                                                                            (GSourceFunc) periodic_signal_check_run,
+                                                                            self);
         }
 
         periodic_signal_check_complete (task);
@@ -1970,7 +2008,7 @@ mm_iface_modem_refresh_signal (MMIfaceModem *self)
     /* Remove the scheduled timeout as we're going to refresh
      * right away */
     if (priv->signal_check_timeout_source) {
-        g_source_remove (priv->signal_check_timeout_source);
+        mm_timer_wheel_remove (priv->signal_check_timeout_source);
         priv->signal_check_timeout_source = 0;
     }
 
@@ -2004,7 +2042,7 @@ periodic_signal_check_disable (MMIfaceModem *self,
 
     /* Remove scheduled timeout */
     if (priv->signal_check_timeout_source) {
-        g_source_remove (priv->signal_check_timeout_source);
+        mm_timer_wheel_remove (priv->signal_check_timeout_source);
         priv->signal_check_timeout_source = 0;
     }
 
@@ -4376,6 +4414,9 @@ set_power_state_step (GTask *task)
             return;
         }
 
+        /* The modem may reply differently once in the new power state */
+        mm_base_modem_clear_cached_replies (MM_BASE_MODEM (self));
+
         ctx->requested_power_setup (self, (GAsyncReadyCallback)requested_power_setup_ready, task);
         return;
 
@@ -4493,6 +4534,7 @@ mm_iface_modem_disable (MMIfaceModem *self,
                         GAsyncReadyCallback callback,
                         gpointer user_data)
 {
+    Private      *priv;
     MmGdbusModem *skeleton = NULL;
     GTask        *task;
 
@@ -4511,6 +4553,16 @@ mm_iface_modem_disable (MMIfaceModem *self,
         g_object_unref (skeleton);
     }
 
+    /* Cell info is no longer valid */
+    priv = get_private (self);
+    if (priv->cell_info) {
+        g_autoptr(GError) error = NULL;
+
+        error = g_error_new_literal (MM_CORE_ERROR, MM_CORE_ERROR_WRONG_STATE,
+                                     "Modem disabled while retrieving cell info");
+        mm_shared_request_invalidate (priv->cell_info, error);
+    }
+
     /* Just complete, nothing to do */
     task = g_task_new (self, NULL, callback, user_data);
     g_task_return_boolean (task, TRUE);
@@ -5782,6 +5834,14 @@ interface_initialization_step (GTask *task)
          * number, because certain modems may have multiplexing support only in
          * new releases. */
         g_autoptr(MMBearerList) list = NULL;
+        MMPortSerialAt         *port;
+
+        /* What is learned about AT commands depends on the firmware */
+        port = mm_base_modem_peek_port_primary (MM_BASE_MODEM (self));
+        if (port)
+            mm_at_knowledge_set_firmware_revision (mm_at_knowledge_get (),
+                                                   port,
+                                                   mm_gdbus_modem_get_revision (ctx->skeleton));
 
         /* Bearers setup is meant to be loaded only once during the whole
          * lifetime of the modem, so check if it exists; and if it doesn't,
@@ -0,0 +1,163 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+
+#include "mm-log-object.h"
+#include "mm-keyfile-store.h"
+
+struct _MMKeyfileStore {
+    gchar    *path;
+    gchar    *description;
+    gpointer  owner;
+    GKeyFile *keyfile;
+    guint     save_id;
+};
+
+/*****************************************************************************/
+
+static gboolean
+write_all (gint          fd,
+           const gchar  *data,
+           gsize         length)
+{
+    while (length > 0) {
+        gssize n;
+
+        n = write (fd, data, length);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return FALSE;
+        }
+        data += n;
+        length -= n;
+    }
+    return TRUE;
+}
+
+void
+mm_keyfile_store_save (MMKeyfileStore *self)
+{
+    g_autofree gchar *data = NULL;
+    g_autofree gchar *tmp_path = NULL;
+    gsize             length = 0;
+    gint              fd;
+    gint              saved_errno;
+
+    if (self->save_id) {
+        g_source_remove (self->save_id);
+        self->save_id = 0;
+    }
+
+    data = g_key_file_to_data (self->keyfile, &length, NULL);
+
+    /* Caches may hold subscriber or device identifiers, so they must only be
+     * readable by their owner, regardless of the umask. The file is created
+     * with the right mode from the start and then moved in place, so that
+     * there is no window where it is readable by others, and so that the
+     * old file is kept if writing the new one fails. g_file_set_contents_full()
+     * would do the same, but needs GLib 2.66. */
+    tmp_path = g_strdup_printf ("%s.XXXXXX", self->path);
+    fd = g_mkstemp_full (tmp_path, O_RDWR, 0600);
+    if (fd < 0) {
+        saved_errno = errno;
+        mm_obj_warn (self->owner, "couldn't create %s file in %s: %s",
+                     self->description, self->path, g_strerror (saved_errno));
+        return;
+    }
+
+    if (!write_all (fd, data, length)) {
+        saved_errno = errno;
+        close (fd);
+        goto out;
+    }
+
+    if (close (fd) < 0 || g_rename (tmp_path, self->path) < 0) {
+        saved_errno = errno;
+        goto out;
+    }
+
+    return;
+
+out:
+    mm_obj_warn (self->owner, "couldn't write %s to %s: %s",
+                 self->description, self->path, g_strerror (saved_errno));
+    g_unlink (tmp_path);
+}
+
+static gboolean
+save_cb (MMKeyfileStore *self)
+{
+    self->save_id = 0;
+    mm_keyfile_store_save (self);
+    return G_SOURCE_REMOVE;
+}
+
+void
+mm_keyfile_store_schedule_save (MMKeyfileStore *self,
+                                guint           delay_seconds)
+{
+    if (!self->save_id)
+        self->save_id = g_timeout_add_seconds (delay_seconds, (GSourceFunc) save_cb, self);
+}
+
+/*****************************************************************************/
+
+GKeyFile *
+mm_keyfile_store_peek_keyfile (MMKeyfileStore *self)
+{
+    return self->keyfile;
+}
+
+MMKeyfileStore *
+mm_keyfile_store_new (const gchar *path,
+                      const gchar *description,
+                      gpointer     owner)
+{
+    MMKeyfileStore    *self;
+    g_autoptr(GError)  error = NULL;
+
+    self = g_slice_new0 (MMKeyfileStore);
+    self->path        = g_strdup (path);
+    self->description = g_strdup (description);
+    self->owner       = owner;
+    self->keyfile     = g_key_file_new ();
+
+    if (!g_key_file_load_from_file (self->keyfile, self->path, G_KEY_FILE_NONE, &error)) {
+        /* A missing file just means nothing stored yet */
+        if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+            mm_obj_warn (owner, "couldn't load %s from %s: %s", description, path, error->message);
+    } else
+        mm_obj_dbg (owner, "loaded from %s", path);
+
+    return self;
+}
+
+void
+mm_keyfile_store_free (MMKeyfileStore *self)
+{
+    /* Write out pending changes right away */
+    if (self->save_id)
+        mm_keyfile_store_save (self);
+
+    g_key_file_unref (self->keyfile);
+    g_free (self->description);
+    g_free (self->path);
+    g_slice_free (MMKeyfileStore, self);
+}
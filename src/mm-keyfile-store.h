@@ -0,0 +1,43 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_KEYFILE_STORE_H
+#define MM_KEYFILE_STORE_H
+
+#include <glib.h>
+
+/* Key file kept on disk by the caches that persist across daemon restarts.
+ *
+ * The file is loaded when the store is created; a missing or unreadable
+ * file just gives an empty key file. Changes are written to a temporary
+ * file readable by its owner only, which is then renamed over the previous
+ * one, so that the file is never left half written. Writes may be deferred
+ * to batch several changes; pending changes are written when the store is
+ * freed. Errors are logged on behalf of the given owner object.
+ */
+typedef struct _MMKeyfileStore MMKeyfileStore;
+
+MMKeyfileStore *mm_keyfile_store_new           (const gchar    *path,
+                                                const gchar    *description,
+                                                gpointer        owner);
+void            mm_keyfile_store_free          (MMKeyfileStore *self);
+
+GKeyFile       *mm_keyfile_store_peek_keyfile  (MMKeyfileStore *self);
+
+void            mm_keyfile_store_save          (MMKeyfileStore *self);
+void            mm_keyfile_store_schedule_save (MMKeyfileStore *self,
+                                                guint           delay_seconds);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (MMKeyfileStore, mm_keyfile_store_free)
+
+#endif /* MM_KEYFILE_STORE_H */
@@ -0,0 +1,187 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <string.h>
+
+#include "mm-log-ring.h"
+
+#define TRUNCATED_SUFFIX     "...\n"
+#define TRUNCATED_SUFFIX_LEN (sizeof (TRUNCATED_SUFFIX) - 1)
+
+/* Each slot has a sequence number telling who owns it: the slot at
+ * position 'pos' is free for producers when its sequence is 'pos', and
+ * ready for the consumer when its sequence is 'pos + 1'. The consumer
+ * hands it back to producers for the next lap by setting it to
+ * 'pos + size'. All positions wrap around as unsigned integers. */
+typedef struct {
+    gint        sequence;
+    MMLogRecord record;
+} Slot;
+
+struct _MMLogRing {
+    Slot  *slots;
+    guint  mask;
+    gint   push_pos;
+    gint   dropped;
+    /* Only used by the consumer */
+    guint  pop_pos;
+};
+
+MMLogRing *
+mm_log_ring_new (guint n_records)
+{
+    MMLogRing *self;
+    guint      size;
+    guint      i;
+
+    g_assert (n_records > 0 && n_records <= (G_MAXUINT / 2));
+
+    /* Round up to a power of two, so that positions can be masked */
+    for (size = 1; size < n_records; size <<= 1);
+
+    self = g_new0 (MMLogRing, 1);
+    self->slots = g_new (Slot, size);
+    self->mask = size - 1;
+    for (i = 0; i < size; i++)
+        self->slots[i].sequence = (gint) i;
+    return self;
+}
+
+void
+mm_log_ring_free (MMLogRing *self)
+{
+    g_free (self->slots);
+    g_free (self);
+}
+
+guint
+mm_log_ring_get_size (MMLogRing *self)
+{
+    return self->mask + 1;
+}
+
+gboolean
+mm_log_ring_push (MMLogRing   *self,
+                  const gchar *loc,
+                  const gchar *func,
+                  gint         syslog_level,
+                  const gchar *message,
+                  gsize        length)
+{
+    Slot  *slot;
+    guint  pos;
+
+    pos = (guint) g_atomic_int_get (&self->push_pos);
+    while (TRUE) {
+        gint diff;
+
+        slot = &self->slots[pos & self->mask];
+        diff = (gint) ((guint) g_atomic_int_get (&slot->sequence) - pos);
+        if (diff == 0) {
+            /* Slot free, try to reserve it */
+            if (g_atomic_int_compare_and_exchange (&self->push_pos, (gint) pos, (gint) (pos + 1)))
+                break;
+        } else if (diff < 0) {
+            /* Consumer is still one lap behind: full */
+            g_atomic_int_inc (&self->dropped);
+            return FALSE;
+        }
+        /* Another producer took the slot first, retry with the new position */
+        pos = (guint) g_atomic_int_get (&self->push_pos);
+    }
+
+    slot->record.loc = loc;
+    slot->record.func = func;
+    slot->record.syslog_level = syslog_level;
+    if (length > MM_LOG_RING_MESSAGE_SIZE - 1) {
+        length = MM_LOG_RING_MESSAGE_SIZE - 1;
+        memcpy (slot->record.message, message, length - TRUNCATED_SUFFIX_LEN);
+        memcpy (&slot->record.message[length - TRUNCATED_SUFFIX_LEN], TRUNCATED_SUFFIX, TRUNCATED_SUFFIX_LEN);
+    } else
+        memcpy (slot->record.message, message, length);
+    slot->record.message[length] = '\0';
+    slot->record.length = length;
+
+    /* Publish the record */
+    g_atomic_int_set (&slot->sequence, (gint) (pos + 1));
+    return TRUE;
+}
+
+const MMLogRecord *
+mm_log_ring_peek (MMLogRing *self)
+{
+    Slot *slot;
+
+    slot = &self->slots[self->pop_pos & self->mask];
+    if ((guint) g_atomic_int_get (&slot->sequence) != self->pop_pos + 1)
+        return NULL;
+    return &slot->record;
+}
+
+void
+mm_log_ring_release (MMLogRing *self)
+{
+    Slot *slot;
+
+    slot = &self->slots[self->pop_pos & self->mask];
+    g_atomic_int_set (&slot->sequence, (gint) (self->pop_pos + self->mask + 1));
+    self->pop_pos++;
+}
+
+guint
+mm_log_ring_steal_dropped (MMLogRing *self)
+{
+    return (guint) g_atomic_int_and ((guint *) &self->dropped, 0);
+}
+
+/*****************************************************************************/
+
+/* Tokens are kept in millionths, so that the refill doesn't need floating
+ * point operations with microsecond timestamps */
+#define TOKEN_UNIT G_USEC_PER_SEC
+
+void
+mm_log_rate_limit_init (MMLogRateLimit *self,
+                        guint           burst,
+                        gint64          now)
+{
+    self->tokens = (guint64) burst * TOKEN_UNIT;
+    self->last_refill = now;
+    self->n_suppressed = 0;
+}
+
+gboolean
+mm_log_rate_limit_check (MMLogRateLimit *self,
+                         guint           rate,
+                         guint           burst,
+                         gint64          now,
+                         guint          *out_n_suppressed)
+{
+    if (now > self->last_refill) {
+        self->tokens = MIN ((guint64) burst * TOKEN_UNIT,
+                            self->tokens + (guint64) (now - self->last_refill) * rate);
+        self->last_refill = now;
+    }
+
+    if (self->tokens < TOKEN_UNIT) {
+        self->n_suppressed++;
+        return FALSE;
+    }
+
+    self->tokens -= TOKEN_UNIT;
+    if (out_n_suppressed)
+        *out_n_suppressed = self->n_suppressed;
+    self->n_suppressed = 0;
+    return TRUE;
+}
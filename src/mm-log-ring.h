@@ -0,0 +1,74 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_LOG_RING_H
+#define MM_LOG_RING_H
+
+#include <glib.h>
+
+/* Bounded ring of preallocated fixed-size log records, used by the
+ * asynchronous logging mode.
+ *
+ * Any number of threads may push records without taking any lock; a single
+ * consumer thread peeks and releases them in order. When the ring is full,
+ * new records are dropped and accounted so that the consumer can report
+ * them. Messages longer than the record size are truncated. */
+
+#define MM_LOG_RING_MESSAGE_SIZE 1024
+
+typedef struct {
+    /* Static strings, as given by G_STRLOC and G_STRFUNC */
+    const gchar *loc;
+    const gchar *func;
+    gint         syslog_level;
+    gsize        length;
+    gchar        message[MM_LOG_RING_MESSAGE_SIZE];
+} MMLogRecord;
+
+typedef struct _MMLogRing MMLogRing;
+
+MMLogRing         *mm_log_ring_new           (guint        n_records);
+void               mm_log_ring_free          (MMLogRing   *self);
+guint              mm_log_ring_get_size      (MMLogRing   *self);
+gboolean           mm_log_ring_push          (MMLogRing   *self,
+                                              const gchar *loc,
+                                              const gchar *func,
+                                              gint         syslog_level,
+                                              const gchar *message,
+                                              gsize        length);
+const MMLogRecord *mm_log_ring_peek          (MMLogRing   *self);
+void               mm_log_ring_release       (MMLogRing   *self);
+guint              mm_log_ring_steal_dropped (MMLogRing   *self);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (MMLogRing, mm_log_ring_free)
+
+/* Token bucket used to rate limit the log messages of the hottest sites.
+ * Up to 'burst' messages are allowed at once, and the bucket is refilled
+ * with 'rate' messages per second. */
+
+typedef struct {
+    guint64 tokens;
+    gint64  last_refill;
+    guint   n_suppressed;
+} MMLogRateLimit;
+
+void     mm_log_rate_limit_init  (MMLogRateLimit *self,
+                                  guint           burst,
+                                  gint64          now);
+gboolean mm_log_rate_limit_check (MMLogRateLimit *self,
+                                  guint           rate,
+                                  guint           burst,
+                                  gint64          now,
+                                  guint          *out_n_suppressed);
+
+#endif /* MM_LOG_RING_H */
@@ -43,4 +43,27 @@ _mm_log (gpointer     obj,
     g_free (msg);
 }
 
+void
+_mm_log_ratelimited (gpointer     obj,
+                     const gchar *module,
+                     const gchar *loc,
+                     const gchar *func,
+                     MMLogLevel   level,
+                     const gchar *fmt,
+                     ...)
+{
+    va_list  args;
+    gchar   *msg;
+
+    if (!g_test_verbose ())
+        return;
+
+    /* No rate limiting in tests */
+    va_start (args, fmt);
+    msg = g_strdup_vprintf (fmt, args);
+    va_end (args);
+    _mm_log (obj, module, loc, func, level, "%s", msg);
+    g_free (msg);
+}
+
 #endif /* MM_LOG_TEST_H */
@@ -46,6 +46,7 @@
 
 #include "mm-log.h"
 #include "mm-log-object.h"
+#include "mm-log-ring.h"
 
 enum {
     TS_FLAG_NONE = 0,
@@ -55,8 +56,9 @@ enum {
 
 static gboolean ts_flags = TS_FLAG_NONE;
 static guint32  log_level = MM_LOG_LEVEL_MSG | MM_LOG_LEVEL_WARN | MM_LOG_LEVEL_ERR;
-static GTimeVal rel_start = { 0, 0 };
+static gint64   rel_start = 0;
 static int      logfd = -1;
+static gint     logfd_sync = TRUE; /* atomic, read by the writer thread */
 static gboolean append_log_level_text = TRUE;
 static gboolean personal_info = FALSE;
 
@@ -80,8 +82,37 @@ static const LogDesc level_descs[] = {
     { 0, NULL }
 };
 
-static GString *msgbuf = NULL;
-static gsize msgbuf_once = 0;
+/* Each thread formats its messages in its own buffer */
+static GPrivate msgbuf_private = G_PRIVATE_INIT ((GDestroyNotify) g_string_free);
+
+/* Asynchronous logging: messages are formatted by the caller into the ring
+ * and written out by a separate thread, so that a slow backend (e.g. the
+ * journal applying back-pressure) never blocks the main loop */
+#define LOG_RING_RECORDS            4096
+#define LOG_WRITER_IDLE_TIMEOUT_USEC (G_USEC_PER_SEC / 2)
+
+/* Producers push to the ring with the reader lock held, so that it can be
+ * freed on shutdown once nobody is using it anymore */
+static MMLogRing *log_ring;
+static GRWLock    log_ring_lock;
+static MMLogRing *log_writer_ring;
+static GThread   *log_writer;
+static GMutex     log_writer_mutex;
+static GCond      log_writer_cond;
+static gint       log_writer_sleeping;
+static gboolean   log_writer_stop;
+
+/* Rate limiting of the hottest log sites, per log object; only with async
+ * logging, so that the synchronous output (e.g. with --debug) is complete */
+#define LOG_RATE_LIMIT_BURST 200
+#define LOG_RATE_LIMIT_RATE  50
+#define LOG_RATE_LIMIT_KEY   "mm-log-rate-limit"
+
+/* Log objects are used from any thread, so the token buckets are only ever
+ * looked up and updated with the lock held */
+static GMutex          rate_limit_mutex;
+static MMLogRateLimit *rate_limit_no_object;
+static gint            rate_limit_enabled;
 
 static int
 mm_to_syslog_priority (MMLogLevel level)
@@ -165,7 +196,10 @@ log_backend_file (const char *loc,
     ign = write (logfd, message, length);
     if (ign) {} /* whatever; really shut up about unused result */
 
-    fsync (logfd);  /* Make sure output is dumped to disk immediately  */
+    /* Make sure output is dumped to disk immediately; the async writer
+     * thread syncs once per batch instead */
+    if (g_atomic_int_get (&logfd_sync))
+        fsync (logfd);
 }
 
 static void
@@ -227,6 +261,88 @@ mm_log_check_level_enabled (MMLogLevel level)
     return (log_level & level);
 }
 
+static void
+log_append_prefix (GString     *buf,
+                   const gchar *loc,
+                   const gchar *func,
+                   MMLogLevel   level)
+{
+    if (append_log_level_text)
+        g_string_append_printf (buf, "%s ", log_level_description (level));
+
+    if (ts_flags == TS_FLAG_WALL) {
+        gint64 now;
+
+        now = g_get_real_time ();
+        g_string_append_printf (buf, "[%09" G_GINT64_FORMAT ".%06" G_GINT64_FORMAT "] ",
+                                now / G_USEC_PER_SEC, now % G_USEC_PER_SEC);
+    } else if (ts_flags == TS_FLAG_REL) {
+        gint64 elapsed;
+
+        elapsed = g_get_monotonic_time () - rel_start;
+        g_string_append_printf (buf, "[%06" G_GINT64_FORMAT ".%06" G_GINT64_FORMAT "] ",
+                                elapsed / G_USEC_PER_SEC, elapsed % G_USEC_PER_SEC);
+    }
+
+#if defined MM_LOG_FUNC_LOC
+    if (loc && func)
+        g_string_append_printf (buf, "[%s] %s(): ", loc, func);
+#endif
+}
+
+static void
+log_writev (gpointer     obj,
+            const gchar *module,
+            const gchar *loc,
+            const gchar *func,
+            MMLogLevel   level,
+            const gchar *fmt,
+            va_list      args)
+{
+    GString   *msgbuf;
+    MMLogRing *ring;
+    gboolean   pushed = FALSE;
+
+    msgbuf = g_private_get (&msgbuf_private);
+    if (!msgbuf) {
+        msgbuf = g_string_sized_new (512);
+        g_private_set (&msgbuf_private, msgbuf);
+    } else
+        g_string_truncate (msgbuf, 0);
+
+    log_append_prefix (msgbuf, loc, func, level);
+
+    if (obj)
+        g_string_append_printf (msgbuf, "[%s] ", mm_log_object_get_id (MM_LOG_OBJECT (obj)));
+    if (module)
+        g_string_append_printf (msgbuf, "(%s) ", module);
+
+    g_string_append_vprintf (msgbuf, fmt, args);
+
+    g_string_append_c (msgbuf, '\n');
+
+    g_rw_lock_reader_lock (&log_ring_lock);
+    ring = log_ring;
+    if (ring)
+        pushed = mm_log_ring_push (ring, loc, func, mm_to_syslog_priority (level), msgbuf->str, msgbuf->len);
+    g_rw_lock_reader_unlock (&log_ring_lock);
+
+    if (!ring) {
+        log_backend (loc, func, mm_to_syslog_priority (level), msgbuf->str, msgbuf->len);
+        return;
+    }
+
+    if (!pushed)
+        return;
+
+    /* Wake up the writer thread only if it is waiting for new records */
+    if (g_atomic_int_get (&log_writer_sleeping)) {
+        g_mutex_lock (&log_writer_mutex);
+        g_cond_signal (&log_writer_cond);
+        g_mutex_unlock (&log_writer_mutex);
+    }
+}
+
 void
 _mm_log (gpointer     obj,
          const gchar *module,
@@ -236,56 +352,135 @@ _mm_log (gpointer     obj,
          const gchar *fmt,
          ...)
 {
-    va_list  args;
-    GTimeVal tv;
+    va_list args;
 
     if (!mm_log_check_level_enabled (level))
         return;
 
-    if (g_once_init_enter (&msgbuf_once)) {
-        msgbuf = g_string_sized_new (512);
-        g_once_init_leave (&msgbuf_once, 1);
-    } else
-        g_string_truncate (msgbuf, 0);
+    va_start (args, fmt);
+    log_writev (obj, module, loc, func, level, fmt, args);
+    va_end (args);
+}
 
-    if (append_log_level_text)
-        g_string_append_printf (msgbuf, "%s ", log_level_description (level));
+static MMLogRateLimit *
+log_rate_limit_get (gpointer obj,
+                    gint64   now)
+{
+    /* Called with the rate limit lock held */
+    MMLogRateLimit *rate_limit;
+
+    rate_limit = obj ? g_object_get_data (G_OBJECT (obj), LOG_RATE_LIMIT_KEY) : rate_limit_no_object;
+    if (!rate_limit) {
+        rate_limit = g_new (MMLogRateLimit, 1);
+        mm_log_rate_limit_init (rate_limit, LOG_RATE_LIMIT_BURST, now);
+        if (obj)
+            g_object_set_data_full (G_OBJECT (obj), LOG_RATE_LIMIT_KEY, rate_limit, g_free);
+        else
+            rate_limit_no_object = rate_limit;
+    }
+    return rate_limit;
+}
 
-    if (ts_flags == TS_FLAG_WALL) {
-        g_get_current_time (&tv);
-        g_string_append_printf (msgbuf, "[%09ld.%06ld] ", tv.tv_sec, tv.tv_usec);
-    } else if (ts_flags == TS_FLAG_REL) {
-        glong secs;
-        glong usecs;
-
-        g_get_current_time (&tv);
-        secs = tv.tv_sec - rel_start.tv_sec;
-        usecs = tv.tv_usec - rel_start.tv_usec;
-        if (usecs < 0) {
-            secs--;
-            usecs += 1000000;
-        }
+void
+_mm_log_ratelimited (gpointer     obj,
+                     const gchar *module,
+                     const gchar *loc,
+                     const gchar *func,
+                     MMLogLevel   level,
+                     const gchar *fmt,
+                     ...)
+{
+    va_list  args;
+    gint64   now;
+    guint    n_suppressed = 0;
+    gboolean allowed;
+
+    if (!mm_log_check_level_enabled (level))
+        return;
 
-        g_string_append_printf (msgbuf, "[%06ld.%06ld] ", secs, usecs);
+    if (!g_atomic_int_get (&rate_limit_enabled)) {
+        va_start (args, fmt);
+        log_writev (obj, module, loc, func, level, fmt, args);
+        va_end (args);
+        return;
     }
 
-#if defined MM_LOG_FUNC_LOC
-    if (loc && func)
-        g_string_append_printf (msgbuf, "[%s] %s(): ", loc, func);
-#endif
+    g_mutex_lock (&rate_limit_mutex);
+    now = g_get_monotonic_time ();
+    allowed = mm_log_rate_limit_check (log_rate_limit_get (obj, now),
+                                       LOG_RATE_LIMIT_RATE,
+                                       LOG_RATE_LIMIT_BURST,
+                                       now,
+                                       &n_suppressed);
+    g_mutex_unlock (&rate_limit_mutex);
 
-    if (obj)
-        g_string_append_printf (msgbuf, "[%s] ", mm_log_object_get_id (MM_LOG_OBJECT (obj)));
-    if (module)
-        g_string_append_printf (msgbuf, "(%s) ", module);
+    if (!allowed)
+        return;
+
+    if (n_suppressed > 0)
+        _mm_log (obj, module, loc, func, level, "%u similar messages suppressed", n_suppressed);
 
     va_start (args, fmt);
-    g_string_append_vprintf (msgbuf, fmt, args);
+    log_writev (obj, module, loc, func, level, fmt, args);
     va_end (args);
+}
 
-    g_string_append_c (msgbuf, '\n');
+/******************************************************************************/
+
+static void
+log_writer_flush (void)
+{
+    const MMLogRecord *record;
+    guint              n_dropped;
+    gboolean           written = FALSE;
+
+    while ((record = mm_log_ring_peek (log_writer_ring)) != NULL) {
+        log_backend (record->loc, record->func, record->syslog_level, record->message, record->length);
+        mm_log_ring_release (log_writer_ring);
+        written = TRUE;
+    }
+
+    /* Report dropped messages after the ones that made it */
+    n_dropped = mm_log_ring_steal_dropped (log_writer_ring);
+    if (n_dropped > 0) {
+        g_autoptr(GString) buf = NULL;
+
+        buf = g_string_new (NULL);
+        log_append_prefix (buf, NULL, NULL, MM_LOG_LEVEL_WARN);
+        g_string_append_printf (buf, "%u log messages dropped\n", n_dropped);
+        log_backend (NULL, NULL, mm_to_syslog_priority (MM_LOG_LEVEL_WARN), buf->str, buf->len);
+        written = TRUE;
+    }
+
+    if (written && logfd >= 0)
+        fsync (logfd);
+}
 
-    log_backend (loc, func, mm_to_syslog_priority (level), msgbuf->str, msgbuf->len);
+static gpointer
+log_writer_thread (gpointer user_data)
+{
+    while (TRUE) {
+        log_writer_flush ();
+
+        g_mutex_lock (&log_writer_mutex);
+        if (log_writer_stop) {
+            g_mutex_unlock (&log_writer_mutex);
+            break;
+        }
+        /* Records pushed after setting the flag are seen right away,
+         * otherwise the producer will signal us */
+        g_atomic_int_set (&log_writer_sleeping, 1);
+        if (!mm_log_ring_peek (log_writer_ring))
+            g_cond_wait_until (&log_writer_cond,
+                               &log_writer_mutex,
+                               g_get_monotonic_time () + LOG_WRITER_IDLE_TIMEOUT_USEC);
+        g_atomic_int_set (&log_writer_sleeping, 0);
+        g_mutex_unlock (&log_writer_mutex);
+    }
+
+    /* Write whatever was queued before stopping */
+    log_writer_flush ();
+    return NULL;
 }
 
 static void
@@ -340,6 +535,7 @@ mm_log_setup (const gchar  *level,
               gboolean      show_timestamps,
               gboolean      rel_timestamps,
               gboolean      show_personal_info,
+              gboolean      log_async,
               GError      **error)
 {
     /* levels */
@@ -354,7 +550,7 @@ mm_log_setup (const gchar  *level,
         ts_flags = TS_FLAG_REL;
 
     /* Grab start time for relative timestamps */
-    g_get_current_time (&rel_start);
+    rel_start = g_get_monotonic_time ();
 
 #if defined WITH_SYSTEMD_JOURNAL
     if (log_journal) {
@@ -378,6 +574,15 @@ mm_log_setup (const gchar  *level,
         log_backend = log_backend_file;
     }
 
+    if (log_async) {
+        g_atomic_int_set (&logfd_sync, FALSE);
+        log_writer_stop = FALSE;
+        log_writer_ring = mm_log_ring_new (LOG_RING_RECORDS);
+        log_ring = log_writer_ring;
+        log_writer = g_thread_new ("mm-log-writer", log_writer_thread, NULL);
+        g_atomic_int_set (&rate_limit_enabled, TRUE);
+    }
+
     g_log_set_handler (G_LOG_DOMAIN,
                        G_LOG_LEVEL_MASK | G_LOG_FLAG_FATAL | G_LOG_FLAG_RECURSION,
                        log_handler,
@@ -412,6 +617,29 @@ mm_log_setup (const gchar  *level,
 void
 mm_log_shutdown (void)
 {
+    if (log_writer) {
+        /* Any further message is written synchronously. Once the writer
+         * lock is taken, no other thread is pushing to the ring anymore */
+        g_rw_lock_writer_lock (&log_ring_lock);
+        log_ring = NULL;
+        g_rw_lock_writer_unlock (&log_ring_lock);
+        g_atomic_int_set (&logfd_sync, TRUE);
+        g_atomic_int_set (&rate_limit_enabled, FALSE);
+
+        g_mutex_lock (&log_writer_mutex);
+        log_writer_stop = TRUE;
+        g_cond_signal (&log_writer_cond);
+        g_mutex_unlock (&log_writer_mutex);
+        g_clear_pointer (&log_writer, g_thread_join);
+
+        /* The writer thread flushed everything before exiting */
+        g_clear_pointer (&log_writer_ring, mm_log_ring_free);
+    }
+
+    g_mutex_lock (&rate_limit_mutex);
+    g_clear_pointer (&rate_limit_no_object, g_free);
+    g_mutex_unlock (&rate_limit_mutex);
+
     if (logfd < 0)
         closelog ();
     else
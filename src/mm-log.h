@@ -42,6 +42,9 @@ typedef enum {
 #define mm_obj_info(obj, ...)       _mm_log (obj, MM_LOG_MODULE_NAME, G_STRLOC, G_STRFUNC, MM_LOG_LEVEL_INFO,  ## __VA_ARGS__ )
 #define mm_obj_dbg(obj, ...)        _mm_log (obj, MM_LOG_MODULE_NAME, G_STRLOC, G_STRFUNC, MM_LOG_LEVEL_DEBUG, ## __VA_ARGS__ )
 
+/* rate limited logging, per object, for the hottest sites (e.g. port traffic) */
+#define mm_obj_dbg_ratelimited(obj, ...) _mm_log_ratelimited (obj, MM_LOG_MODULE_NAME, G_STRLOC, G_STRFUNC, MM_LOG_LEVEL_DEBUG, ## __VA_ARGS__ )
+
 /* only allow using non-object logging API if explicitly requested
  * (e.g. in the main daemon source) */
 #if defined MM_LOG_NO_OBJECT
@@ -66,6 +69,14 @@ void _mm_log (gpointer     obj,
               const gchar *fmt,
               ...)  __attribute__((__format__ (__printf__, 6, 7)));
 
+void _mm_log_ratelimited (gpointer     obj,
+                          const gchar *module,
+                          const gchar *loc,
+                          const gchar *func,
+                          MMLogLevel   level,
+                          const gchar *fmt,
+                          ...)  __attribute__((__format__ (__printf__, 6, 7)));
+
 gboolean mm_log_set_level              (const gchar  *level,
                                         GError      **error);
 gboolean mm_log_setup                  (const gchar  *level,
@@ -74,6 +85,7 @@ gboolean mm_log_setup                  (const gchar  *level,
                                         gboolean      show_ts,
                                         gboolean      rel_ts,
                                         gboolean      show_personal_info,
+                                        gboolean      log_async,
                                         GError      **error);
 gboolean mm_log_check_level_enabled    (MMLogLevel    level);
 gboolean mm_log_get_show_personal_info (void);
@@ -71,6 +71,37 @@ mm_strip_tag (const gchar *str, const gchar *cmd)
 
 /*****************************************************************************/
 
+gboolean
+mm_at_command_chain_append (GString     *line,
+                            const gchar *command)
+{
+    const gchar *body;
+    gsize        length;
+
+    /* Same prefix logic as when building the command to send */
+    body = g_str_has_prefix (command, "AT") ? command + 2 : command;
+
+    /* Only extended commands may be chained with ';' */
+    if (body[0] != '+' || strpbrk (body, ";\r\n"))
+        return FALSE;
+
+    /* Length of the command line without the "AT" prefix */
+    length = strlen (body);
+    if (line->len > 0)
+        length += line->len - 2 + 1;
+    if (length > MM_AT_CHAINED_COMMAND_MAX_LENGTH)
+        return FALSE;
+
+    if (line->len > 0)
+        g_string_append_c (line, ';');
+    else
+        g_string_append (line, "AT");
+    g_string_append (line, body);
+    return TRUE;
+}
+
+/*****************************************************************************/
+
 gchar **
 mm_split_string_groups (const gchar *str)
 {
@@ -3895,14 +3926,138 @@ mm_3gpp_pdu_info_list_free (GList *info_list)
     g_list_free_full (info_list, (GDestroyNotify)mm_3gpp_pdu_info_free);
 }
 
-GList *
-mm_3gpp_parse_pdu_cmgl_response (const gchar *str,
-                                 GError **error)
+struct _MM3gppCmglParser {
+    MM3gppCmglEntryFunc  func;
+    gpointer             user_data;
+    /* Line not fully received yet */
+    GString             *line;
+    /* Header waiting for its data line */
+    GString             *header;
+    gboolean             header_pending;
+};
+
+MM3gppCmglParser *
+mm_3gpp_cmgl_parser_new (MM3gppCmglEntryFunc func,
+                         gpointer            user_data)
 {
-    g_autoptr(GRegex)      r = NULL;
-    g_autoptr(GMatchInfo)  match_info = NULL;
-    GError                *inner_error = NULL;
-    GList                 *list = NULL;
+    MM3gppCmglParser *self;
+
+    self = g_slice_new0 (MM3gppCmglParser);
+    self->func = func;
+    self->user_data = user_data;
+    self->line = g_string_sized_new (512);
+    self->header = g_string_sized_new (64);
+    return self;
+}
+
+void
+mm_3gpp_cmgl_parser_free (MM3gppCmglParser *self)
+{
+    g_string_free (self->line, TRUE);
+    g_string_free (self->header, TRUE);
+    g_slice_free (MM3gppCmglParser, self);
+}
+
+static void
+cmgl_parser_process_line (MM3gppCmglParser *self)
+{
+    const gchar *p;
+
+    /* Line terminators are always \r\n, but be lenient with a single \n */
+    if (self->line->len > 0 && self->line->str[self->line->len - 1] == '\r')
+        g_string_truncate (self->line, self->line->len - 1);
+
+    /* Whatever comes right after the header is its data, even if empty */
+    if (self->header_pending) {
+        self->header_pending = FALSE;
+        self->func (self->header->str, self->line->str, self->user_data);
+        return;
+    }
+
+    p = self->line->str;
+    while (g_ascii_isspace (*p))
+        p++;
+    if (!g_str_has_prefix (p, "+CMGL:"))
+        return;
+    p += strlen ("+CMGL:");
+    while (g_ascii_isspace (*p))
+        p++;
+
+    g_string_assign (self->header, p);
+    self->header_pending = TRUE;
+}
+
+void
+mm_3gpp_cmgl_parser_feed (MM3gppCmglParser *self,
+                          const gchar      *data,
+                          gsize             len)
+{
+    while (len > 0) {
+        const gchar *eol;
+        gsize        line_len;
+
+        eol = memchr (data, '\n', len);
+        if (!eol) {
+            g_string_append_len (self->line, data, len);
+            return;
+        }
+
+        line_len = eol - data;
+        g_string_append_len (self->line, data, line_len);
+        cmgl_parser_process_line (self);
+        g_string_truncate (self->line, 0);
+
+        data += line_len + 1;
+        len -= line_len + 1;
+    }
+}
+
+void
+mm_3gpp_cmgl_parser_finish (MM3gppCmglParser *self)
+{
+    /* The last data line may come without terminator */
+    if (self->line->len > 0) {
+        cmgl_parser_process_line (self);
+        g_string_truncate (self->line, 0);
+    }
+    self->header_pending = FALSE;
+}
+
+static gboolean
+cmgl_header_read_int (const gchar **p,
+                      gint         *out)
+{
+    gchar  *end = NULL;
+    gint64  value;
+
+    while (g_ascii_isspace (**p))
+        (*p)++;
+    if (!g_ascii_isdigit (**p))
+        return FALSE;
+
+    value = g_ascii_strtoll (*p, &end, 10);
+    if (value > G_MAXINT)
+        return FALSE;
+    *p = end;
+    while (g_ascii_isspace (**p))
+        (*p)++;
+
+    /* Always expect a comma after the integer */
+    if (**p != ',')
+        return FALSE;
+    (*p)++;
+
+    *out = (gint) value;
+    return TRUE;
+}
+
+MM3gppPduInfo *
+mm_3gpp_parse_pdu_cmgl_entry (const gchar  *header,
+                              const gchar  *data,
+                              GError      **error)
+{
+    MM3gppPduInfo *info;
+    const gchar   *p = header;
 
     /*
      * +CMGL: <index>, <status>, [<alpha>], <length>
@@ -3911,37 +4066,112 @@ mm_3gpp_parse_pdu_cmgl_response (const gchar *str,
      *
      * We just read <index>, <stat> and the PDU itself.
      */
-    r = g_regex_new ("\\+CMGL:\\s*(\\d+)\\s*,\\s*(\\d+)\\s*,(.*)\\r\\n([^\\r\\n]*)(\\r\\n)?",
-                     G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
-    g_assert (r != NULL);
+    info = g_new0 (MM3gppPduInfo, 1);
+    if (!cmgl_header_read_int (&p, &info->index) ||
+        !cmgl_header_read_int (&p, &info->status)) {
+        mm_3gpp_pdu_info_free (info);
+        g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
+                     "Error parsing +CMGL header: '%s'", header);
+        return NULL;
+    }
 
-    g_regex_match_full (r, str, strlen (str), 0, 0, &match_info, &inner_error);
-    while (!inner_error && g_match_info_matches (match_info)) {
-        MM3gppPduInfo *info;
-
-        info = g_new0 (MM3gppPduInfo, 1);
-        if (mm_get_int_from_match_info (match_info, 1, &info->index) &&
-            mm_get_int_from_match_info (match_info, 2, &info->status) &&
-            (info->pdu = mm_get_string_unquoted_from_match_info (match_info, 4)) != NULL) {
-            /* Append to our list of results and keep on */
-            list = g_list_append (list, info);
-            g_match_info_next (match_info, &inner_error);
-        } else {
-            mm_3gpp_pdu_info_free (info);
-            inner_error = g_error_new (MM_CORE_ERROR,
-                                       MM_CORE_ERROR_FAILED,
-                                       "Error parsing +CMGL response: '%s'",
-                                       str);
+    info->pdu = mm_strip_quotes (g_strdup (data));
+    return info;
+}
+
+gboolean
+mm_3gpp_parse_text_cmgl_header (const gchar  *header,
+                                guint        *out_index,
+                                gchar       **out_stat,
+                                gchar       **out_number,
+                                gchar       **out_timestamp,
+                                GError      **error)
+{
+    g_auto(GStrv)  fields = NULL;
+    guint          n_fields;
+    guint          idx;
+    const gchar   *timestamp = NULL;
+    guint          i;
+
+    /*
+     * +CMGL: <index>,<stat>,<oa/da>,[<alpha>][,<scts>]
+     *
+     * The timestamp has a comma itself, so split in 5 fields at most. Some
+     * modems add whitespace after the commas, and stored messages have no
+     * timestamp.
+     */
+    fields = g_strsplit (header, ",", 5);
+    n_fields = g_strv_length (fields);
+    if (n_fields < 3) {
+        g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
+                     "Error parsing +CMGL header: '%s' (%u fields)", header, n_fields);
+        return FALSE;
+    }
+
+    for (i = 0; i < n_fields; i++)
+        mm_strip_quotes (g_strstrip (fields[i]));
+
+    if (!mm_get_uint_from_str (fields[0], &idx)) {
+        g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
+                     "Error parsing +CMGL header: invalid index '%s'", fields[0]);
+        return FALSE;
+    }
+
+    if (n_fields == 5) {
+        timestamp = fields[4];
+        if (!g_str_is_ascii (timestamp)) {
+            g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
+                         "Error parsing +CMGL header: timestamp is not ASCII");
+            return FALSE;
         }
     }
 
-    if (inner_error) {
-        g_propagate_error (error, inner_error);
-        mm_3gpp_pdu_info_list_free (list);
+    *out_index = idx;
+    *out_stat = g_strdup (fields[1]);
+    *out_number = g_strdup (fields[2]);
+    *out_timestamp = g_strdup (timestamp);
+    return TRUE;
+}
+
+typedef struct {
+    GList  *list;
+    GError *error;
+} PduCmglContext;
+
+static void
+pdu_cmgl_entry_cb (const gchar    *header,
+                   const gchar    *data,
+                   PduCmglContext *ctx)
+{
+    MM3gppPduInfo *info;
+
+    if (ctx->error)
+        return;
+
+    info = mm_3gpp_parse_pdu_cmgl_entry (header, data, &ctx->error);
+    if (info)
+        ctx->list = g_list_prepend (ctx->list, info);
+}
+
+GList *
+mm_3gpp_parse_pdu_cmgl_response (const gchar *str,
+                                 GError **error)
+{
+    PduCmglContext    ctx = { 0 };
+    MM3gppCmglParser *parser;
+
+    parser = mm_3gpp_cmgl_parser_new ((MM3gppCmglEntryFunc) pdu_cmgl_entry_cb, &ctx);
+    mm_3gpp_cmgl_parser_feed (parser, str, strlen (str));
+    mm_3gpp_cmgl_parser_finish (parser);
+    mm_3gpp_cmgl_parser_free (parser);
+
+    if (ctx.error) {
+        g_propagate_error (error, ctx.error);
+        mm_3gpp_pdu_info_list_free (ctx.list);
         return NULL;
     }
 
-    return list;
+    return g_list_reverse (ctx.list);
 }
 
 /*************************************************************************/
@@ -48,6 +48,16 @@ gchar       *mm_strip_quotes (gchar *str);
 const gchar *mm_strip_tag    (const gchar *str,
                               const gchar *cmd);
 
+/* V.250 only requires the DCE to accept 40 characters in a command line,
+ * not counting the "AT" prefix */
+#define MM_AT_CHAINED_COMMAND_MAX_LENGTH 40
+
+/* Appends an extended command to a ';'-chained command line, which must be
+ * empty before the first one. Returns FALSE, leaving the line untouched, if
+ * the command cannot be chained or the line would become too long. */
+gboolean mm_at_command_chain_append (GString     *line,
+                                     const gchar *command);
+
 gchar **mm_split_string_groups (const gchar *str);
 
 GArray *mm_parse_uint_list (const gchar  *str,
@@ -351,6 +361,34 @@ void   mm_3gpp_pdu_info_free           (MM3gppPduInfo *info);
 void   mm_3gpp_pdu_info_list_free      (GList *info_list);
 GList *mm_3gpp_parse_pdu_cmgl_response (const gchar *str,
                                         GError **error);
+MM3gppPduInfo *mm_3gpp_parse_pdu_cmgl_entry (const gchar  *header,
+                                             const gchar  *data,
+                                             GError      **error);
+
+/* AT+CMGL (list sms parts) text mode entry header parser; the number is
+ * given as is, in the current modem charset, and the timestamp is optional */
+gboolean mm_3gpp_parse_text_cmgl_header (const gchar  *header,
+                                         guint        *out_index,
+                                         gchar       **out_stat,
+                                         gchar       **out_number,
+                                         gchar       **out_timestamp,
+                                         GError      **error);
+
+/* Line-oriented +CMGL response parser, which may be fed with the response
+ * in chunks. Each entry is reported as soon as its data line is complete,
+ * with the +CMGL header contents (tag removed) and the data line. */
+typedef struct _MM3gppCmglParser MM3gppCmglParser;
+typedef void (* MM3gppCmglEntryFunc) (const gchar *header,
+                                      const gchar *data,
+                                      gpointer     user_data);
+MM3gppCmglParser *mm_3gpp_cmgl_parser_new    (MM3gppCmglEntryFunc  func,
+                                              gpointer             user_data);
+void              mm_3gpp_cmgl_parser_feed   (MM3gppCmglParser    *self,
+                                              const gchar         *data,
+                                              gsize                len);
+void              mm_3gpp_cmgl_parser_finish (MM3gppCmglParser    *self);
+void              mm_3gpp_cmgl_parser_free   (MM3gppCmglParser    *self);
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (MM3gppCmglParser, mm_3gpp_cmgl_parser_free)
 
 /* AT+CMGR (Read message) response parser */
 MM3gppPduInfo *mm_3gpp_parse_cmgr_read_response (const gchar *reply,
@@ -22,6 +22,7 @@
 #include <net/if.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <string.h>
 
 #include <config.h>
 
@@ -160,6 +161,21 @@ netlink_message_new_setlink (guint    ifindex,
     return msg;
 }
 
+static NetlinkMessage *
+netlink_message_new_getlink_dump (void)
+{
+    NetlinkMessage *msg;
+    NetlinkHeader  *hdr;
+
+    msg = netlink_message_new (0, RTM_GETLINK);
+    hdr = netlink_message_header (msg);
+
+    /* Dumps are terminated with NLMSG_DONE, no ACK needed */
+    hdr->msghdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+
+    return msg;
+}
+
 static void
 netlink_message_free (NetlinkMessage *msg)
 {
@@ -174,6 +190,8 @@ typedef struct {
     guint32    sequence_id;
     GSource   *timeout_source;
     GTask     *completion_task;
+    /* Link stats collected while a dump is ongoing */
+    GHashTable *link_stats;
 } Transaction;
 
 static gboolean
@@ -215,17 +233,24 @@ static void
 transaction_complete (Transaction *tr,
                       gint         saved_errno)
 {
-    GTask *task;
-    guint32 sequence_id;
+    g_autoptr(GHashTable)  link_stats = NULL;
+    GTask                 *task;
+    guint32                sequence_id;
 
     task = g_steal_pointer (&tr->completion_task);
+    link_stats = g_steal_pointer (&tr->link_stats);
     sequence_id = tr->sequence_id;
 
     g_hash_table_remove (tr->self->transactions,
                          GUINT_TO_POINTER (tr->sequence_id));
 
     if (!saved_errno) {
-        g_task_return_boolean (task, TRUE);
+        if (link_stats)
+            g_task_return_pointer (task,
+                                   g_steal_pointer (&link_stats),
+                                   (GDestroyNotify) g_hash_table_unref);
+        else
+            g_task_return_boolean (task, TRUE);
     } else {
         g_task_return_new_error (task, G_IO_ERROR, g_io_error_from_errno (saved_errno),
                                  "Netlink message with transaction %u failed",
@@ -239,6 +264,7 @@ static void
 transaction_free (Transaction *tr)
 {
     g_assert (tr->completion_task == NULL);
+    g_clear_pointer (&tr->link_stats, g_hash_table_unref);
     g_source_destroy (tr->timeout_source);
     g_source_unref (tr->timeout_source);
     g_slice_free (Transaction, tr);
@@ -327,13 +353,173 @@ mm_netlink_setlink (MMNetlink           *self,
 
 /*****************************************************************************/
 
+GHashTable *
+mm_netlink_get_link_stats_finish (MMNetlink     *self,
+                                  GAsyncResult  *res,
+                                  GError       **error)
+{
+    return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+void
+mm_netlink_get_link_stats (MMNetlink           *self,
+                           GCancellable        *cancellable,
+                           GAsyncReadyCallback  callback,
+                           gpointer             user_data)
+{
+    GTask          *task;
+    NetlinkMessage *msg;
+    Transaction    *tr;
+    gssize          bytes_sent;
+    GError         *error = NULL;
+
+    task = g_task_new (self, cancellable, callback, user_data);
+
+    if (!self->socket) {
+        g_task_return_new_error (task, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
+                                 "netlink support not available");
+        g_object_unref (task);
+        return;
+    }
+
+    msg = netlink_message_new_getlink_dump ();
+
+    /* The task ownership is transferred to the transaction. */
+    tr = transaction_new (self, msg, 5, task);
+    tr->link_stats = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+    bytes_sent = g_socket_send (self->socket,
+                                (const gchar *) msg->data,
+                                msg->len,
+                                cancellable,
+                                &error);
+    netlink_message_free (msg);
+
+    if (bytes_sent < 0)
+        transaction_complete_with_error (tr, error);
+
+    g_object_unref (task);
+}
+
+static void
+process_newlink (Transaction     *tr,
+                 struct nlmsghdr *hdr)
+{
+    struct ifinfomsg               *ifinfo;
+    struct rtattr                  *attr;
+    gint                            attr_len;
+    const gchar                    *ifname = NULL;
+    const struct rtnl_link_stats64 *stats64 = NULL;
+    MMNetlinkLinkStats             *stats;
+
+    if (hdr->nlmsg_len < NLMSG_LENGTH (sizeof (struct ifinfomsg)))
+        return;
+
+    ifinfo = NLMSG_DATA (hdr);
+    attr_len = IFLA_PAYLOAD (hdr);
+    for (attr = IFLA_RTA (ifinfo); RTA_OK (attr, attr_len); attr = RTA_NEXT (attr, attr_len)) {
+        if (attr->rta_type == IFLA_IFNAME)
+            ifname = RTA_DATA (attr);
+        else if (attr->rta_type == IFLA_STATS64 && RTA_PAYLOAD (attr) >= sizeof (struct rtnl_link_stats64))
+            stats64 = RTA_DATA (attr);
+    }
+
+    if (!ifname || !stats64)
+        return;
+
+    stats = g_new0 (MMNetlinkLinkStats, 1);
+    /* The attribute payload may not be 64-bit aligned */
+    memcpy (&stats->rx_bytes,   &stats64->rx_bytes,   sizeof (guint64));
+    memcpy (&stats->tx_bytes,   &stats64->tx_bytes,   sizeof (guint64));
+    memcpy (&stats->rx_packets, &stats64->rx_packets, sizeof (guint64));
+    memcpy (&stats->tx_packets, &stats64->tx_packets, sizeof (guint64));
+    memcpy (&stats->rx_dropped, &stats64->rx_dropped, sizeof (guint64));
+    memcpy (&stats->tx_dropped, &stats64->tx_dropped, sizeof (guint64));
+    g_hash_table_replace (tr->link_stats, g_strdup (ifname), stats);
+}
+
+/*****************************************************************************/
+
+static const gsize link_stats_counters[] = {
+    G_STRUCT_OFFSET (MMNetlinkLinkStats, rx_bytes),
+    G_STRUCT_OFFSET (MMNetlinkLinkStats, tx_bytes),
+    G_STRUCT_OFFSET (MMNetlinkLinkStats, rx_packets),
+    G_STRUCT_OFFSET (MMNetlinkLinkStats, tx_packets),
+    G_STRUCT_OFFSET (MMNetlinkLinkStats, rx_dropped),
+    G_STRUCT_OFFSET (MMNetlinkLinkStats, tx_dropped),
+};
+
+static guint64
+link_sampler_rate (guint64 previous_bytes,
+                   guint64 current_bytes,
+                   gint64  elapsed)
+{
+    if (elapsed <= 0)
+        return 0;
+    /* bits per second */
+    return ((current_bytes - previous_bytes) * 8 * G_USEC_PER_SEC) / (guint64) elapsed;
+}
+
+gboolean
+mm_netlink_link_sampler_add (MMNetlinkLinkSampler     *self,
+                             const MMNetlinkLinkStats *sample,
+                             gint64                    time,
+                             MMNetlinkLinkStats       *totals,
+                             guint64                  *rx_rate,
+                             guint64                  *tx_rate)
+{
+    gboolean new_base;
+    guint    i;
+
+    /* Counters only go backwards if the interface was recreated */
+    new_base = !self->started;
+    for (i = 0; !new_base && i < G_N_ELEMENTS (link_stats_counters); i++)
+        new_base = (G_STRUCT_MEMBER (guint64, sample, link_stats_counters[i]) <
+                    G_STRUCT_MEMBER (guint64, &self->last, link_stats_counters[i]));
+
+    for (i = 0; i < G_N_ELEMENTS (link_stats_counters); i++) {
+        gsize    offset;
+        guint64 *base;
+        guint64  current;
+
+        offset = link_stats_counters[i];
+        base = &G_STRUCT_MEMBER (guint64, &self->base, offset);
+        current = G_STRUCT_MEMBER (guint64, sample, offset);
+
+        /* Totals go on from the ones until the new base. The base wraps
+         * around if those are greater than the current counter, which is
+         * fine as the subtraction below wraps back. */
+        if (new_base) {
+            guint64 previous_total = 0;
+
+            if (self->started)
+                previous_total = G_STRUCT_MEMBER (guint64, &self->last, offset) - *base;
+            *base = current - previous_total;
+        }
+        G_STRUCT_MEMBER (guint64, totals, offset) = current - *base;
+    }
+
+    if (!new_base) {
+        *rx_rate = link_sampler_rate (self->last.rx_bytes, sample->rx_bytes, time - self->last_time);
+        *tx_rate = link_sampler_rate (self->last.tx_bytes, sample->tx_bytes, time - self->last_time);
+    }
+
+    self->started = TRUE;
+    self->last = *sample;
+    self->last_time = time;
+    return !new_base;
+}
+
+/*****************************************************************************/
+
 static gboolean
 netlink_message_cb (GSocket      *socket,
                     GIOCondition  condition,
                     MMNetlink    *self)
 {
     g_autoptr(GError) error = NULL;
-    gchar             buf[512];
+    /* Large enough for the multipart replies of link dumps */
+    gchar             buf[16384];
     gssize            bytes_received;
     guint             buffer_len;
     struct nlmsghdr  *hdr;
@@ -351,20 +537,30 @@ netlink_message_cb (GSocket      *socket,
 
     buffer_len = (guint) bytes_received;
     for (hdr = (struct nlmsghdr *) buf; NLMSG_OK (hdr, buffer_len);
-         NLMSG_NEXT (hdr, buffer_len)) {
+         hdr = NLMSG_NEXT (hdr, buffer_len)) {
         Transaction     *tr;
         struct nlmsgerr *err;
 
-        if (hdr->nlmsg_type != NLMSG_ERROR)
-            continue;
-
         tr = g_hash_table_lookup (self->transactions,
                                   GUINT_TO_POINTER (hdr->nlmsg_seq));
         if (!tr)
             continue;
 
-        err = NLMSG_DATA (buf);
-        transaction_complete (tr, err->error);
+        switch (hdr->nlmsg_type) {
+        case RTM_NEWLINK:
+            if (tr->link_stats)
+                process_newlink (tr, hdr);
+            break;
+        case NLMSG_DONE:
+            transaction_complete (tr, 0);
+            break;
+        case NLMSG_ERROR:
+            err = NLMSG_DATA (hdr);
+            transaction_complete (tr, -err->error);
+            break;
+        default:
+            break;
+        }
     }
     return G_SOURCE_CONTINUE;
 }
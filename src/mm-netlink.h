@@ -36,6 +36,7 @@ typedef struct _MMNetlink         MMNetlink;
 typedef struct _MMNetlinkClass    MMNetlinkClass;
 
 GType      mm_netlink_get_type     (void) G_GNUC_CONST;
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (MMNetlink, g_object_unref)
 MMNetlink *mm_netlink_get          (void);
 
 void     mm_netlink_setlink        (MMNetlink           *self,
@@ -49,6 +50,47 @@ gboolean mm_netlink_setlink_finish (MMNetlink            *self,
                                     GAsyncResult         *res,
                                     GError              **error);
 
+/* Counters of a network interface, as reported in IFLA_STATS64 */
+typedef struct {
+    guint64 rx_bytes;
+    guint64 tx_bytes;
+    guint64 rx_packets;
+    guint64 tx_packets;
+    guint64 rx_dropped;
+    guint64 tx_dropped;
+} MMNetlinkLinkStats;
+
+/* Dumps the counters of all network interfaces in a single request. The
+ * returned table maps the interface names to MMNetlinkLinkStats. */
+void        mm_netlink_get_link_stats        (MMNetlink            *self,
+                                              GCancellable         *cancellable,
+                                              GAsyncReadyCallback   callback,
+                                              gpointer              user_data);
+GHashTable *mm_netlink_get_link_stats_finish (MMNetlink            *self,
+                                              GAsyncResult         *res,
+                                              GError              **error);
+
+/* Per-connection totals and rates computed from the counters of an
+ * interface, which may have been in use before the connection, or even be
+ * recreated during it. Must be zero-initialized when the connection starts. */
+typedef struct {
+    gboolean           started;
+    MMNetlinkLinkStats base;
+    MMNetlinkLinkStats last;
+    gint64             last_time;
+} MMNetlinkLinkSampler;
+
+/* Adds a sample of the interface counters, taken at the given monotonic
+ * time, and gives the totals since the connection started. Returns TRUE if
+ * the rates, in bits per second, could be computed, i.e. if there was a
+ * previous sample of the same interface. */
+gboolean mm_netlink_link_sampler_add (MMNetlinkLinkSampler     *self,
+                                      const MMNetlinkLinkStats *sample,
+                                      gint64                    time,
+                                      MMNetlinkLinkStats       *totals,
+                                      guint64                  *rx_rate,
+                                      guint64                  *tx_rate);
+
 G_END_DECLS
 
 #endif  /* MM_MODEM_HELPERS_NETLINK_H */
@@ -0,0 +1,196 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+
+#include "mm-parallel-run.h"
+
+typedef enum {
+    OPERATION_STATE_PENDING,
+    OPERATION_STATE_RUNNING,
+    OPERATION_STATE_DONE,
+} OperationState;
+
+typedef struct {
+    guint                 n_operations;
+    guint                 max_running;
+    MMParallelRunStartFn  start;
+    MMParallelRunFinishFn finish;
+    gpointer              data;
+    OperationState       *states;
+    guint                *groups;
+    guint                 running;
+    gboolean              scheduling;
+} ParallelRunContext;
+
+typedef struct {
+    GTask *task;
+    guint  index;
+} Operation;
+
+static void schedule (GTask *task);
+
+static void
+parallel_run_context_free (ParallelRunContext *ctx)
+{
+    g_free (ctx->states);
+    g_free (ctx->groups);
+    g_slice_free (ParallelRunContext, ctx);
+}
+
+/*****************************************************************************/
+
+gboolean
+mm_parallel_run_finish (GAsyncResult  *res,
+                        GError       **error)
+{
+    return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+static void
+operation_ready (GObject      *source,
+                 GAsyncResult *res,
+                 Operation    *op)
+{
+    ParallelRunContext *ctx;
+    GTask              *task;
+
+    task = op->task;
+    ctx = g_task_get_task_data (task);
+    ctx->finish (ctx->data, op->index, res);
+
+    g_assert (ctx->running > 0);
+    ctx->running--;
+    ctx->states[op->index] = OPERATION_STATE_DONE;
+    g_slice_free (Operation, op);
+
+    schedule (task);
+}
+
+static gboolean
+group_is_running (ParallelRunContext *ctx,
+                  guint               group)
+{
+    guint i;
+
+    for (i = 0; i < ctx->n_operations; i++) {
+        if (ctx->states[i] == OPERATION_STATE_RUNNING && ctx->groups[i] == group)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* Lowest pending operation that may be started now */
+static gboolean
+find_next (ParallelRunContext *ctx,
+           guint              *index)
+{
+    guint i;
+
+    for (i = 0; i < ctx->n_operations; i++) {
+        if (ctx->states[i] != OPERATION_STATE_PENDING)
+            continue;
+        if (ctx->groups[i] && group_is_running (ctx, ctx->groups[i]))
+            continue;
+        *index = i;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static void
+schedule (GTask *task)
+{
+    ParallelRunContext *ctx;
+    guint               index;
+
+    ctx = g_task_get_task_data (task);
+
+    /* Operations completed right from their start function are accounted
+     * for by the loop already running */
+    if (ctx->scheduling)
+        return;
+
+    /* The start functions may complete their operation right away, make
+     * sure the task and its context outlive the loop */
+    g_object_ref (task);
+    ctx->scheduling = TRUE;
+
+    /* Once cancelled, just wait for the ongoing operations to finish */
+    while (!g_cancellable_is_cancelled (g_task_get_cancellable (task)) &&
+           ctx->running < ctx->max_running &&
+           find_next (ctx, &index)) {
+        Operation *op;
+
+        op = g_slice_new (Operation);
+        op->task = task;
+        op->index = index;
+
+        ctx->states[index] = OPERATION_STATE_RUNNING;
+        ctx->running++;
+        if (!ctx->start (ctx->data,
+                         index,
+                         g_task_get_cancellable (task),
+                         (GAsyncReadyCallback) operation_ready,
+                         op)) {
+            ctx->states[index] = OPERATION_STATE_DONE;
+            ctx->running--;
+            g_slice_free (Operation, op);
+        }
+    }
+
+    ctx->scheduling = FALSE;
+
+    if (ctx->running == 0) {
+        if (!g_task_return_error_if_cancelled (task))
+            g_task_return_boolean (task, TRUE);
+        g_object_unref (task);
+    }
+    g_object_unref (task);
+}
+
+void
+mm_parallel_run (gpointer               source,
+                 guint                  n_operations,
+                 guint                  max_running,
+                 MMParallelRunStartFn   start,
+                 MMParallelRunGroupFn   group,
+                 MMParallelRunFinishFn  finish,
+                 gpointer               data,
+                 GCancellable          *cancellable,
+                 GAsyncReadyCallback    callback,
+                 gpointer               user_data)
+{
+    ParallelRunContext *ctx;
+    GTask              *task;
+    guint               i;
+
+    g_assert (max_running > 0);
+    g_assert (start && finish);
+
+    task = g_task_new (source, cancellable, callback, user_data);
+
+    ctx = g_slice_new0 (ParallelRunContext);
+    ctx->n_operations = n_operations;
+    ctx->max_running = max_running;
+    ctx->start = start;
+    ctx->finish = finish;
+    ctx->data = data;
+    ctx->states = g_new0 (OperationState, n_operations);
+    ctx->groups = g_new0 (guint, n_operations);
+    for (i = 0; group && i < n_operations; i++)
+        ctx->groups[i] = group (data, i);
+    g_task_set_task_data (task, ctx, (GDestroyNotify) parallel_run_context_free);
+
+    schedule (task);
+}
@@ -0,0 +1,61 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_PARALLEL_RUN_H
+#define MM_PARALLEL_RUN_H
+
+#include <glib.h>
+#include <gio/gio.h>
+
+/* Runs a set of independent async operations, e.g. the initialization of
+ * the optional modem interfaces.
+ *
+ * Operations are launched in index order, with at most max_running of them
+ * ongoing at the same time, so with a max of 1 they are fully serialized.
+ * The start callback launches the given operation, or returns FALSE if it
+ * doesn't apply and is skipped. The finish callback gets its result; errors
+ * must be handled there, as they never stop the remaining operations.
+ *
+ * The optional group callback gives a non-zero group to the operations that
+ * share a resource, e.g. a port. Operations of the same group never run at
+ * the same time; while one of them waits for its turn, the next operations
+ * in index order may be launched.
+ *
+ * Once cancelled, no new operations are launched, and the run fails when
+ * the ongoing ones are finished.
+ */
+typedef gboolean (* MMParallelRunStartFn)  (gpointer              data,
+                                            guint                 index,
+                                            GCancellable         *cancellable,
+                                            GAsyncReadyCallback   callback,
+                                            gpointer              user_data);
+typedef guint    (* MMParallelRunGroupFn)  (gpointer              data,
+                                            guint                 index);
+typedef void     (* MMParallelRunFinishFn) (gpointer              data,
+                                            guint                 index,
+                                            GAsyncResult         *res);
+
+void     mm_parallel_run        (gpointer                source,
+                                 guint                   n_operations,
+                                 guint                   max_running,
+                                 MMParallelRunStartFn    start,
+                                 MMParallelRunGroupFn    group,
+                                 MMParallelRunFinishFn   finish,
+                                 gpointer                data,
+                                 GCancellable           *cancellable,
+                                 GAsyncReadyCallback     callback,
+                                 gpointer                user_data);
+gboolean mm_parallel_run_finish (GAsyncResult           *res,
+                                 GError                **error);
+
+#endif /* MM_PARALLEL_RUN_H */
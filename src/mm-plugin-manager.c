@@ -25,11 +25,13 @@
 #include <config.h>
 
 #include <ModemManager.h>
+#include <ModemManager-tags.h>
 #include <mm-errors-types.h>
 
 #include "mm-plugin-manager.h"
 #include "mm-plugin.h"
 #include "mm-shared.h"
+#include "mm-probe-cache.h"
 #include "mm-utils.h"
 #include "mm-log-object.h"
 
@@ -77,6 +79,11 @@ struct _MMPluginManagerPrivate {
 
     /* Full list of subsystems requested by the registered plugins */
     gchar **subsystems;
+
+    /* Per VID/PID values learned from previous device support checks */
+    GHashTable *device_profiles;
+    /* Timeline of the most recent device support checks */
+    GQueue *probing_history;
 };
 
 /*****************************************************************************/
@@ -736,6 +743,44 @@ port_context_new (MMPluginManager *self,
 /* The wait time we define must always be less than the probing time */
 G_STATIC_ASSERT (MIN_WAIT_TIME_MSECS < MIN_PROBING_TIME_MSECS);
 
+/* Time to wait after the moment the last port was reported in previous checks
+ * of the same device, before giving up on more ports appearing. */
+#define LEARNED_PROBING_MARGIN_MSECS 500
+
+/* Amount of device support checks kept in the probing history */
+#define PROBING_HISTORY_MAX_ITEMS 16
+
+/*
+ * Device profile
+ *
+ * Values learned from previous device support checks of devices with the same
+ * VID/PID. The amount of ports is the maximum ever reported, so that a device
+ * exposing less ports than usual just falls back to the default wait times.
+ * The time of the last port is taken from the most recent check in which all
+ * those ports were reported, and is used to shorten the probing windows.
+ * Profiles are only kept in memory, so they are learned again from scratch
+ * after every daemon restart.
+ */
+typedef struct {
+    guint n_ports;
+    guint last_port_ms;
+    guint finished_ms;
+} DeviceProfile;
+
+#define DEVICE_PROFILE_KEY(vid, pid) GUINT_TO_POINTER (((guint)(vid) << 16) | (guint)(pid))
+
+typedef struct {
+    gchar *name;
+    guint  added_ms;
+    guint  probed_ms;
+} PortTimelineEntry;
+
+static void
+port_timeline_entry_clear (PortTimelineEntry *entry)
+{
+    g_free (entry->name);
+}
+
 /*
  * Device context
  *
@@ -791,6 +836,28 @@ struct _DeviceContext {
 
     /* Port support check contexts being run */
     GList *port_contexts;
+
+    /* VID/PID of the device, as reported by the first port */
+    guint16 vid;
+    guint16 pid;
+    /* Amount of ports reported so far */
+    guint n_ports;
+    /* Amount of ports expected, either from udev tags, from the probe cache
+     * or from the learned device profile; 0 if unknown */
+    guint n_expected_ports;
+    gboolean expected_ports_from_tag;
+    gboolean expected_ports_from_cache;
+    /* Time when the last port was reported in previous checks of the same
+     * device, only valid if learned_timing is set */
+    gboolean learned_timing;
+    guint    learned_last_port_ms;
+    /* Set once all expected ports have been reported, the probing wait
+     * windows are not used any more afterwards */
+    gboolean all_ports_reported;
+    /* Time when the last port was reported */
+    guint last_port_ms;
+    /* Per port timeline, for the probing history */
+    GArray *timeline;
 };
 
 static void
@@ -809,6 +876,7 @@ device_context_unref (DeviceContext *device_context)
         g_assert (!device_context->task);
 
         g_free (device_context->name);
+        g_array_unref (device_context->timeline);
         g_timer_destroy (device_context->timer);
         if (device_context->cancellable)
             g_object_unref (device_context->cancellable);
@@ -861,6 +929,52 @@ device_context_peek_waiting_port_context (DeviceContext  *device_context,
     return NULL;
 }
 
+static guint
+device_context_get_elapsed_ms (DeviceContext *device_context)
+{
+    return (guint) (g_timer_elapsed (device_context->timer, NULL) * 1000);
+}
+
+static void
+device_context_port_probed (DeviceContext  *device_context,
+                            MMKernelDevice *port)
+{
+    guint i;
+
+    /* Look for the last entry, the same port may have been reported twice */
+    for (i = device_context->timeline->len; i > 0; i--) {
+        PortTimelineEntry *entry;
+
+        entry = &g_array_index (device_context->timeline, PortTimelineEntry, i - 1);
+        if (g_str_equal (entry->name, mm_kernel_device_get_name (port))) {
+            entry->probed_ms = device_context_get_elapsed_ms (device_context);
+            return;
+        }
+    }
+}
+
+/* Length of a probing window that would last default_ms, shortened so that it
+ * ends shortly after the time at which the last port was reported in previous
+ * checks of the same device. The window never ends before the min wait time,
+ * and if ports keep appearing later than learned, the default is used. */
+static guint
+device_context_get_probing_window_ms (DeviceContext *device_context,
+                                      guint          default_ms)
+{
+    guint elapsed_ms;
+    guint deadline_ms;
+
+    if (!device_context->learned_timing)
+        return default_ms;
+
+    elapsed_ms  = device_context_get_elapsed_ms (device_context);
+    deadline_ms = MAX (device_context->learned_last_port_ms, MIN_WAIT_TIME_MSECS) + LEARNED_PROBING_MARGIN_MSECS;
+    if (deadline_ms <= elapsed_ms)
+        return default_ms;
+
+    return MIN (default_ms, deadline_ms - elapsed_ms);
+}
+
 static MMPlugin *
 device_context_run_finish (MMPluginManager  *self,
                            GAsyncResult     *res,
@@ -869,11 +983,86 @@ device_context_run_finish (MMPluginManager  *self,
     return MM_PLUGIN (g_task_propagate_pointer (G_TASK (res), error));
 }
 
+static void
+device_context_learn_profile (MMPluginManager *self,
+                              DeviceContext   *device_context,
+                              guint            finished_ms)
+{
+    DeviceProfile *profile;
+
+    /* Only learn from successful checks of devices we can identify; if the
+     * amount of ports comes from udev tags there is nothing to learn */
+    if (!device_context->best_plugin ||
+        g_cancellable_is_cancelled (device_context->cancellable) ||
+        device_context->expected_ports_from_tag ||
+        (!device_context->vid && !device_context->pid))
+        return;
+
+    profile = g_hash_table_lookup (self->priv->device_profiles,
+                                   DEVICE_PROFILE_KEY (device_context->vid, device_context->pid));
+    if (!profile) {
+        profile = g_new0 (DeviceProfile, 1);
+        g_hash_table_insert (self->priv->device_profiles,
+                             DEVICE_PROFILE_KEY (device_context->vid, device_context->pid),
+                             profile);
+    }
+
+    /* The timing of checks with less ports than usual is not representative */
+    if (device_context->n_ports < profile->n_ports)
+        return;
+
+    profile->n_ports      = device_context->n_ports;
+    profile->last_port_ms = device_context->last_port_ms;
+    profile->finished_ms  = finished_ms;
+
+    mm_obj_dbg (self, "task %s: learned profile for %04x:%04x: %u ports, last port after %ums",
+                device_context->name, device_context->vid, device_context->pid,
+                profile->n_ports, profile->last_port_ms);
+}
+
+static void
+device_context_record_history (MMPluginManager *self,
+                               DeviceContext   *device_context,
+                               guint            finished_ms)
+{
+    GVariantBuilder builder;
+    GVariantBuilder ports_builder;
+    guint           i;
+
+    g_variant_builder_init (&ports_builder, G_VARIANT_TYPE ("aa{sv}"));
+    for (i = 0; i < device_context->timeline->len; i++) {
+        PortTimelineEntry *entry;
+
+        entry = &g_array_index (device_context->timeline, PortTimelineEntry, i);
+        g_variant_builder_open (&ports_builder, G_VARIANT_TYPE ("a{sv}"));
+        g_variant_builder_add (&ports_builder, "{sv}", "name",      g_variant_new_string (entry->name));
+        g_variant_builder_add (&ports_builder, "{sv}", "added-ms",  g_variant_new_uint32 (entry->added_ms));
+        g_variant_builder_add (&ports_builder, "{sv}", "probed-ms", g_variant_new_uint32 (entry->probed_ms));
+        g_variant_builder_close (&ports_builder);
+    }
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+    g_variant_builder_add (&builder, "{sv}", "uid",              g_variant_new_string (mm_device_get_uid (device_context->device)));
+    g_variant_builder_add (&builder, "{sv}", "plugin",           g_variant_new_string (device_context->best_plugin ?
+                                                                                       mm_plugin_get_name (device_context->best_plugin) : ""));
+    g_variant_builder_add (&builder, "{sv}", "vid",              g_variant_new_uint32 (device_context->vid));
+    g_variant_builder_add (&builder, "{sv}", "pid",              g_variant_new_uint32 (device_context->pid));
+    g_variant_builder_add (&builder, "{sv}", "expected-ports",   g_variant_new_uint32 (device_context->n_expected_ports));
+    g_variant_builder_add (&builder, "{sv}", "finished-ms",      g_variant_new_uint32 (finished_ms));
+    g_variant_builder_add (&builder, "{sv}", "early-completion", g_variant_new_boolean (device_context->all_ports_reported));
+    g_variant_builder_add (&builder, "{sv}", "ports",            g_variant_builder_end (&ports_builder));
+
+    g_queue_push_tail (self->priv->probing_history, g_variant_ref_sink (g_variant_builder_end (&builder)));
+    if (g_queue_get_length (self->priv->probing_history) > PROBING_HISTORY_MAX_ITEMS)
+        g_variant_unref (g_queue_pop_head (self->priv->probing_history));
+}
+
 static void
 device_context_complete (DeviceContext *device_context)
 {
     MMPluginManager *self;
     GTask           *task;
+    guint            finished_ms;
 
     self = g_task_get_source_object (device_context->task);
 
@@ -902,6 +1091,10 @@ device_context_complete (DeviceContext *device_context)
     mm_obj_dbg (self, "task %s: finished in '%lf' seconds",
                 device_context->name, g_timer_elapsed (device_context->timer, NULL));
 
+    finished_ms = device_context_get_elapsed_ms (device_context);
+    device_context_learn_profile (self, device_context, finished_ms);
+    device_context_record_history (self, device_context, finished_ms);
+
     /* Remove signal handlers */
     if (device_context->released_id) {
         g_signal_handler_disconnect (device_context->device, device_context->released_id);
@@ -1121,6 +1314,9 @@ port_context_run_ready (MMPluginManager    *self,
         g_object_unref (best_plugin);
     }
 
+    /* Keep track of when the port was probed */
+    device_context_port_probed (common->device_context, common->port_context->port);
+
     /* We MUST have the port context in the list at this point, because we're
      * going to remove the reference, so assert if this is not true. The caller
      * must always make sure that the port_context is available in the list */
@@ -1186,6 +1382,17 @@ device_context_run_port_context (DeviceContext *device_context,
      * unless it is the generic plugin */
     if (device_context->best_plugin && !mm_plugin_is_generic (device_context->best_plugin))
         suggested = device_context->best_plugin;
+    /* Otherwise, start with the plugin that managed this same port before */
+    else if (!device_context->best_plugin) {
+        g_autofree gchar *cached_plugin_name = NULL;
+
+        cached_plugin_name = mm_probe_cache_lookup_plugin (mm_probe_cache_get (), port_context->port);
+        if (cached_plugin_name) {
+            suggested = mm_plugin_manager_peek_plugin (self, cached_plugin_name);
+            if (suggested && (mm_plugin_is_generic (suggested) || !g_list_find (plugins, suggested)))
+                suggested = NULL;
+        }
+    }
 
     port_context_run (self,
                       port_context,
@@ -1268,12 +1475,114 @@ device_context_port_released (DeviceContext  *device_context,
                 device_context->name, mm_kernel_device_get_name (port));
 }
 
+static void
+device_context_load_expected_ports (MMPluginManager *self,
+                                    DeviceContext   *device_context,
+                                    MMKernelDevice  *port)
+{
+    DeviceProfile *profile;
+    guint          n_cached_ports;
+
+    device_context->vid = mm_kernel_device_get_physdev_vid (port);
+    device_context->pid = mm_kernel_device_get_physdev_pid (port);
+
+    /* Explicit amount of ports given in udev tags */
+    if (mm_kernel_device_has_global_property (port, ID_MM_EXPECTED_PORTS)) {
+        gint n_expected_ports;
+
+        n_expected_ports = mm_kernel_device_get_global_property_as_int (port, ID_MM_EXPECTED_PORTS);
+        if (n_expected_ports > 0) {
+            device_context->n_expected_ports = (guint) n_expected_ports;
+            device_context->expected_ports_from_tag = TRUE;
+            mm_obj_dbg (self, "task %s: expecting %u ports (udev tag)",
+                        device_context->name, device_context->n_expected_ports);
+            return;
+        }
+        mm_obj_warn (self, "task %s: invalid %s value", device_context->name, ID_MM_EXPECTED_PORTS);
+    }
+
+    /* Ports of the device whose probing results are cached; if all of them
+     * show up again, probing ends as soon as the results are applied */
+    n_cached_ports = mm_probe_cache_get_n_ports (mm_probe_cache_get (), mm_device_get_uid (device_context->device));
+    if (n_cached_ports > 0) {
+        device_context->n_expected_ports = n_cached_ports;
+        device_context->expected_ports_from_cache = TRUE;
+        mm_obj_dbg (self, "task %s: expecting %u ports (probe cache)",
+                    device_context->name, device_context->n_expected_ports);
+        return;
+    }
+
+    /* Otherwise, what we learned from previous checks of the same device.
+     * Note that bNumInterfaces is not used, as not all interfaces expose
+     * ports in the subsystems we monitor. */
+    profile = g_hash_table_lookup (self->priv->device_profiles,
+                                   DEVICE_PROFILE_KEY (device_context->vid, device_context->pid));
+    if (profile) {
+        guint elapsed_ms;
+        guint window_ms;
+
+        device_context->n_expected_ports     = profile->n_ports;
+        device_context->learned_timing       = TRUE;
+        device_context->learned_last_port_ms = profile->last_port_ms;
+        mm_obj_dbg (self, "task %s: expecting %u ports (learned, last port after %ums, finished after %ums)",
+                    device_context->name, profile->n_ports, profile->last_port_ms, profile->finished_ms);
+
+        /* Shorten the min probing time to what the device needs */
+        if (device_context->min_probing_time_id) {
+            elapsed_ms = device_context_get_elapsed_ms (device_context);
+            window_ms = device_context_get_probing_window_ms (device_context,
+                                                              MIN_PROBING_TIME_MSECS - MIN (elapsed_ms, MIN_PROBING_TIME_MSECS));
+            g_source_remove (device_context->min_probing_time_id);
+            device_context->min_probing_time_id = g_timeout_add (window_ms,
+                                                                 (GSourceFunc) device_context_min_probing_time_elapsed,
+                                                                 device_context);
+            mm_obj_dbg (self, "task %s: min probing time set to %ums from now", device_context->name, window_ms);
+        }
+    }
+}
+
+static gboolean
+device_context_check_all_ports_reported (MMPluginManager *self,
+                                         DeviceContext   *device_context)
+{
+    if (device_context->all_ports_reported)
+        return TRUE;
+
+    if (!device_context->n_expected_ports || device_context->n_ports < device_context->n_expected_ports)
+        return FALSE;
+
+    mm_obj_dbg (self, "task %s: all %u expected ports reported after %ums",
+                device_context->name, device_context->n_expected_ports, device_context->last_port_ms);
+    device_context->all_ports_reported = TRUE;
+
+    /* No need to wait for other ports to appear */
+    if (device_context->min_probing_time_id) {
+        g_source_remove (device_context->min_probing_time_id);
+        device_context->min_probing_time_id = 0;
+    }
+    if (device_context->extra_probing_time_id) {
+        g_source_remove (device_context->extra_probing_time_id);
+        device_context->extra_probing_time_id = 0;
+    }
+
+    /* Start probing right away if we were still waiting; the port filters
+     * requiring all ports to be known already have them */
+    if (device_context->min_wait_time_id) {
+        g_source_remove (device_context->min_wait_time_id);
+        device_context->min_wait_time_id = g_idle_add ((GSourceFunc) device_context_min_wait_time_elapsed,
+                                                       device_context);
+    }
+
+    return TRUE;
+}
+
 static void
 device_context_port_added (MMPluginManager *self,
                            DeviceContext   *device_context,
                            MMKernelDevice  *port)
 {
-    PortContext *port_context;
+    PortContext       *port_context;
+    PortTimelineEntry  entry;
 
     mm_obj_dbg (self, "task %s: port added: %s",
                 device_context->name, mm_kernel_device_get_name (port));
@@ -1294,12 +1603,40 @@ device_context_port_added (MMPluginManager *self,
         return;
     }
 
-    /* Refresh the extra probing timeout. */
-    if (device_context->extra_probing_time_id)
-        g_source_remove (device_context->extra_probing_time_id);
-    device_context->extra_probing_time_id = g_timeout_add (EXTRA_PROBING_TIME_MSECS,
-                                                           (GSourceFunc) device_context_extra_probing_time_elapsed,
-                                                           device_context);
+    /* Keep track of the new port */
+    device_context->n_ports++;
+    device_context->last_port_ms = device_context_get_elapsed_ms (device_context);
+    entry.name      = g_strdup (mm_kernel_device_get_name (port));
+    entry.added_ms  = device_context->last_port_ms;
+    entry.probed_ms = 0;
+    g_array_append_val (device_context->timeline, entry);
+
+    if (device_context->n_ports == 1)
+        device_context_load_expected_ports (self, device_context, port);
+
+    /* A port without cached probing results means the device changed, so
+     * the amount of ports in the cache can't be trusted */
+    if (device_context->expected_ports_from_cache && !device_context->all_ports_reported) {
+        g_autofree gchar *cached_plugin_name = NULL;
+
+        cached_plugin_name = mm_probe_cache_lookup_plugin (mm_probe_cache_get (), port);
+        if (!cached_plugin_name) {
+            mm_obj_dbg (self, "task %s: port %s not in probe cache, not expecting a fixed amount of ports",
+                        device_context->name, mm_kernel_device_get_name (port));
+            device_context->expected_ports_from_cache = FALSE;
+            device_context->n_expected_ports = 0;
+        }
+    }
+
+    /* Refresh the extra probing timeout, unless all the expected ports are
+     * already reported. */
+    if (!device_context_check_all_ports_reported (self, device_context)) {
+        if (device_context->extra_probing_time_id)
+            g_source_remove (device_context->extra_probing_time_id);
+        device_context->extra_probing_time_id = g_timeout_add (device_context_get_probing_window_ms (device_context, EXTRA_PROBING_TIME_MSECS),
+                                                               (GSourceFunc) device_context_extra_probing_time_elapsed,
+                                                               device_context);
+    }
 
     /* Setup a new port context for the newly added port */
     port_context = port_context_new (self,
@@ -1437,6 +1774,8 @@ device_context_new (MMPluginManager *self,
     device_context->self        = g_object_ref (self);
     device_context->device      = g_object_ref (device);
     device_context->timer       = g_timer_new ();
+    device_context->timeline    = g_array_new (FALSE, FALSE, sizeof (PortTimelineEntry));
+    g_array_set_clear_func (device_context->timeline, (GDestroyNotify) port_timeline_entry_clear);
 
     /* Set context name (just for logging) */
     device_context->name = g_strdup_printf ("%lu", unique_task_id++);
@@ -1637,6 +1976,43 @@ mm_plugin_manager_peek_plugin (MMPluginManager *self,
     return NULL;
 }
 
+/*****************************************************************************/
+/* Probing stats */
+
+GVariant *
+mm_plugin_manager_build_probing_profiles (MMPluginManager *self)
+{
+    GVariantBuilder builder;
+    GHashTableIter  iter;
+    gpointer        key;
+    DeviceProfile  *profile;
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+    g_hash_table_iter_init (&iter, self->priv->device_profiles);
+    while (g_hash_table_iter_next (&iter, &key, (gpointer *) &profile)) {
+        g_variant_builder_open (&builder, G_VARIANT_TYPE ("a{sv}"));
+        g_variant_builder_add (&builder, "{sv}", "vid",          g_variant_new_uint32 (GPOINTER_TO_UINT (key) >> 16));
+        g_variant_builder_add (&builder, "{sv}", "pid",          g_variant_new_uint32 (GPOINTER_TO_UINT (key) & 0xFFFF));
+        g_variant_builder_add (&builder, "{sv}", "ports",        g_variant_new_uint32 (profile->n_ports));
+        g_variant_builder_add (&builder, "{sv}", "last-port-ms", g_variant_new_uint32 (profile->last_port_ms));
+        g_variant_builder_add (&builder, "{sv}", "finished-ms",  g_variant_new_uint32 (profile->finished_ms));
+        g_variant_builder_close (&builder);
+    }
+    return g_variant_builder_end (&builder);
+}
+
+GVariant *
+mm_plugin_manager_build_probing_history (MMPluginManager *self)
+{
+    GVariantBuilder  builder;
+    GList           *l;
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+    for (l = self->priv->probing_history->head; l; l = g_list_next (l))
+        g_variant_builder_add_value (&builder, (GVariant *) l->data);
+    return g_variant_builder_end (&builder);
+}
+
 /*****************************************************************************/
 
 const gchar **
@@ -2040,6 +2416,9 @@ mm_plugin_manager_init (MMPluginManager *self)
     self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self,
                                               MM_TYPE_PLUGIN_MANAGER,
                                               MMPluginManagerPrivate);
+
+    self->priv->device_profiles = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+    self->priv->probing_history = g_queue_new ();
 }
 
 static void
@@ -2111,6 +2490,11 @@ dispose (GObject *object)
     g_clear_object (&self->priv->generic);
     g_clear_object (&self->priv->filter);
     g_clear_pointer (&self->priv->subsystems, g_strfreev);
+    g_clear_pointer (&self->priv->device_profiles, g_hash_table_unref);
+    if (self->priv->probing_history) {
+        g_queue_free_full (self->priv->probing_history, (GDestroyNotify) g_variant_unref);
+        self->priv->probing_history = NULL;
+    }
 #if !defined WITH_BUILTIN_PLUGINS
     g_clear_pointer (&self->priv->plugin_dir, g_free);
 #endif
@@ -79,4 +79,9 @@ MMPlugin        *mm_plugin_manager_peek_plugin                 (MMPluginManager
                                                                 const gchar          *plugin_name);
 const gchar    **mm_plugin_manager_get_subsystems              (MMPluginManager      *self);
 
+/* Debug information about the device support checks, for the Test interface.
+ * Both return floating references. */
+GVariant        *mm_plugin_manager_build_probing_profiles      (MMPluginManager      *self);
+GVariant        *mm_plugin_manager_build_probing_history       (MMPluginManager      *self);
+
 #endif /* MM_PLUGIN_MANAGER_H */
@@ -34,6 +34,7 @@
 #include "mm-port-serial-qcdm.h"
 #include "mm-serial-parsers.h"
 #include "mm-private-boxed-types.h"
+#include "mm-probe-cache.h"
 #include "mm-log-object.h"
 #include "mm-daemon-enums-types.h"
 
@@ -865,6 +866,19 @@ mm_plugin_supports_port (MMPlugin            *self,
         mm_port_probe_set_result_at (probe, FALSE);
     }
 
+    /* Reuse the results of a previous probing of the same port if this plugin
+     * ended up managing the device back then. Plugins with their own AT
+     * probing or initialization logic always probe their AT ports again, as
+     * they may keep additional state in the probes; the results of any other
+     * port (e.g. QMI, MBIM or QCDM) don't depend on that logic. */
+    mm_probe_cache_load (mm_probe_cache_get (),
+                         port,
+                         self->priv->name,
+                         (self->priv->custom_init || self->priv->custom_at_probe) ?
+                           (MMProbeCacheLoadFn) mm_port_probe_load_non_at_results :
+                           (MMProbeCacheLoadFn) mm_port_probe_load_results,
+                         probe);
+
     /* Setup async call context */
     ctx = g_slice_new0 (PortProbeRunContext);
     ctx->self   = g_object_ref (self);
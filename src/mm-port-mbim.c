@@ -27,6 +27,7 @@
 
 #include "mm-port-mbim.h"
 #include "mm-port-net.h"
+#include "mm-port-trace.h"
 #include "mm-log-object.h"
 
 G_DEFINE_TYPE (MMPortMbim, mm_port_mbim, MM_TYPE_PORT)
@@ -47,6 +48,9 @@ struct _MMPortMbimPrivate {
     gulong timeout_monitoring_id;
     gulong removed_monitoring_id;
 
+    /* Id of the port in the traffic capture, 0 if not announced */
+    guint16 trace_port_id;
+
 #if defined WITH_QMI && QMI_MBIM_QMUX_SUPPORTED
     gboolean    qmi_supported;
     QmiDevice  *qmi_device;
@@ -432,10 +436,32 @@ device_removed_cb (MMPortMbim  *self)
     g_signal_emit_by_name (self, MM_PORT_SIGNAL_REMOVED);
 }
 
+static void
+notification_trace (MMPortMbim  *self,
+                    MbimMessage *notification)
+{
+    const guint8 *raw;
+    guint32       raw_len;
+
+    raw = mbim_message_get_raw (notification, &raw_len, NULL);
+    if (!raw)
+        return;
+
+    if (!self->priv->trace_port_id)
+        self->priv->trace_port_id = mm_port_trace_register_port (mm_port_get_device (MM_PORT (self)),
+                                                                 MM_PORT_TRACE_PORT_TYPE_MBIM);
+    mm_port_trace_record (self->priv->trace_port_id, MM_PORT_TRACE_RECORD_TYPE_RX, raw, raw_len);
+}
+
 static void
 notification_cb (MMPortMbim  *self,
                  MbimMessage *notification)
 {
+    /* Commands and responses are handled within libmbim, only the raw
+     * notifications are exposed */
+    if (G_UNLIKELY (mm_port_trace_is_enabled ()))
+        notification_trace (self, notification);
+
     g_signal_emit (self, signals[SIGNAL_NOTIFICATION], 0, notification);
 }
 
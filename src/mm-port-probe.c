@@ -127,6 +127,92 @@ mm_port_probe_reset (MMPortProbe *self)
     self->priv->is_mbim = FALSE;
 }
 
+/*****************************************************************************/
+/* Persistent probing results */
+
+#define RESULTS_KEY_FLAGS   "flags"
+#define RESULTS_KEY_AT      "at"
+#define RESULTS_KEY_QCDM    "qcdm"
+#define RESULTS_KEY_QMI     "qmi"
+#define RESULTS_KEY_MBIM    "mbim"
+#define RESULTS_KEY_VENDOR  "vendor"
+#define RESULTS_KEY_PRODUCT "product"
+#define RESULTS_KEY_ICERA   "icera"
+#define RESULTS_KEY_XMM     "xmm"
+
+void
+mm_port_probe_save_results (MMPortProbe *self,
+                            GKeyFile    *keyfile,
+                            const gchar *group)
+{
+    g_key_file_set_integer (keyfile, group, RESULTS_KEY_FLAGS, (gint) self->priv->flags);
+    g_key_file_set_boolean (keyfile, group, RESULTS_KEY_AT, self->priv->is_at);
+    g_key_file_set_boolean (keyfile, group, RESULTS_KEY_QCDM, self->priv->is_qcdm);
+    g_key_file_set_boolean (keyfile, group, RESULTS_KEY_QMI, self->priv->is_qmi);
+    g_key_file_set_boolean (keyfile, group, RESULTS_KEY_MBIM, self->priv->is_mbim);
+    g_key_file_set_boolean (keyfile, group, RESULTS_KEY_ICERA, self->priv->is_icera);
+    g_key_file_set_boolean (keyfile, group, RESULTS_KEY_XMM, self->priv->is_xmm);
+    if (self->priv->vendor)
+        g_key_file_set_string (keyfile, group, RESULTS_KEY_VENDOR, self->priv->vendor);
+    else
+        g_key_file_remove_key (keyfile, group, RESULTS_KEY_VENDOR, NULL);
+    if (self->priv->product)
+        g_key_file_set_string (keyfile, group, RESULTS_KEY_PRODUCT, self->priv->product);
+    else
+        g_key_file_remove_key (keyfile, group, RESULTS_KEY_PRODUCT, NULL);
+}
+
+gboolean
+mm_port_probe_load_results (MMPortProbe *self,
+                            GKeyFile    *keyfile,
+                            const gchar *group)
+{
+    g_autoptr(GError)  error = NULL;
+    g_autofree gchar  *flags_str = NULL;
+    guint32            flags;
+
+    /* Never override results already available */
+    if (self->priv->flags)
+        return FALSE;
+
+    flags = (guint32) g_key_file_get_integer (keyfile, group, RESULTS_KEY_FLAGS, &error);
+    if (error) {
+        mm_obj_dbg (self, "couldn't load probing results: %s", error->message);
+        return FALSE;
+    }
+    if (!flags)
+        return FALSE;
+
+    self->priv->flags = flags;
+    self->priv->is_at = g_key_file_get_boolean (keyfile, group, RESULTS_KEY_AT, NULL);
+    self->priv->is_qcdm = g_key_file_get_boolean (keyfile, group, RESULTS_KEY_QCDM, NULL);
+    self->priv->is_qmi = g_key_file_get_boolean (keyfile, group, RESULTS_KEY_QMI, NULL);
+    self->priv->is_mbim = g_key_file_get_boolean (keyfile, group, RESULTS_KEY_MBIM, NULL);
+    self->priv->is_icera = g_key_file_get_boolean (keyfile, group, RESULTS_KEY_ICERA, NULL);
+    self->priv->is_xmm = g_key_file_get_boolean (keyfile, group, RESULTS_KEY_XMM, NULL);
+    self->priv->vendor = g_key_file_get_string (keyfile, group, RESULTS_KEY_VENDOR, NULL);
+    self->priv->product = g_key_file_get_string (keyfile, group, RESULTS_KEY_PRODUCT, NULL);
+
+    flags_str = mm_port_probe_flag_build_string_from_mask (flags);
+    mm_obj_dbg (self, "loaded previous probing results: '%s'", flags_str);
+    return TRUE;
+}
+
+gboolean
+mm_port_probe_load_non_at_results (MMPortProbe *self,
+                                   GKeyFile    *keyfile,
+                                   const gchar *group)
+{
+    guint32 flags;
+
+    /* Only if the port was found not to be an AT port */
+    flags = (guint32) g_key_file_get_integer (keyfile, group, RESULTS_KEY_FLAGS, NULL);
+    if (!(flags & MM_PORT_PROBE_AT) || g_key_file_get_boolean (keyfile, group, RESULTS_KEY_AT, NULL))
+        return FALSE;
+
+    return mm_port_probe_load_results (self, keyfile, group);
+}
+
 /*****************************************************************************/
 /* Probe task completions.
  * Always make sure that the stored task is NULL when the task is completed.
@@ -1274,13 +1360,16 @@ serial_flash_ready (MMPortSerial *port,
 }
 
 static void
-serial_buffer_full (MMPortSerial *serial,
-                    GByteArray   *buffer,
-                    MMPortProbe  *self)
+serial_buffer_full (MMPortSerial   *serial,
+                    MMSerialBuffer *buffer,
+                    MMPortProbe    *self)
 {
     PortProbeRunContext *ctx;
+    const guint8        *data;
+    gsize                len;
 
-    if (!is_non_at_response (buffer->data, buffer->len))
+    data = mm_serial_buffer_peek (buffer, &len);
+    if (!is_non_at_response (data, len))
         return;
 
     g_assert (self->priv->task);
@@ -1362,6 +1451,7 @@ serial_open_at (MMPortProbe *self)
                                         NULL);
         mm_port_serial_at_set_response_parser (MM_PORT_SERIAL_AT (ctx->serial),
                                                mm_serial_parser_v1_parse,
+                                               mm_serial_parser_v1_reset,
                                                parser,
                                                mm_serial_parser_v1_destroy);
     }
@@ -110,6 +110,18 @@ void mm_port_probe_set_result_qmi        (MMPortProbe *self,
 void mm_port_probe_set_result_mbim       (MMPortProbe *self,
                                           gboolean mbim);
 
+/* Persistent probing results */
+void     mm_port_probe_save_results (MMPortProbe *self,
+                                     GKeyFile    *keyfile,
+                                     const gchar *group);
+gboolean mm_port_probe_load_results (MMPortProbe *self,
+                                     GKeyFile    *keyfile,
+                                     const gchar *group);
+/* Same, but only if the port is known not to be an AT port */
+gboolean mm_port_probe_load_non_at_results (MMPortProbe *self,
+                                            GKeyFile    *keyfile,
+                                            const gchar *group);
+
 /* Run probing */
 void     mm_port_probe_run        (MMPortProbe *self,
                                    MMPortProbeFlag flags,
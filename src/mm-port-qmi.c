@@ -27,6 +27,7 @@
 #include "mm-port-net.h"
 #include "mm-port-enums-types.h"
 #include "mm-modem-helpers-qmi.h"
+#include "mm-port-trace.h"
 #include "mm-log-object.h"
 
 /* as internally defined in the kernel */
@@ -67,6 +68,9 @@ struct _MMPortQmiPrivate {
     /* port monitoring */
     gulong timeout_monitoring_id;
     gulong removed_monitoring_id;
+    gulong indication_monitoring_id;
+    /* Id of the port in the traffic capture, 0 if not announced */
+    guint16 trace_port_id;
     /* endpoint info */
     QmiDataEndpointType endpoint_type;
     gint                endpoint_interface_number;
@@ -204,6 +208,10 @@ reset_monitoring (MMPortQmi *self,
         g_signal_handler_disconnect (qmi_device, self->priv->removed_monitoring_id);
         self->priv->removed_monitoring_id = 0;
     }
+    if (self->priv->indication_monitoring_id && qmi_device) {
+        g_signal_handler_disconnect (qmi_device, self->priv->indication_monitoring_id);
+        self->priv->indication_monitoring_id = 0;
+    }
 }
 
 static void
@@ -220,6 +228,16 @@ device_removed_cb (MMPortQmi  *self)
     g_signal_emit_by_name (self, MM_PORT_SIGNAL_REMOVED);
 }
 
+static void
+indication_trace_cb (MMPortQmi  *self,
+                     GByteArray *message)
+{
+    if (!self->priv->trace_port_id)
+        self->priv->trace_port_id = mm_port_trace_register_port (mm_port_get_device (MM_PORT (self)),
+                                                                 MM_PORT_TRACE_PORT_TYPE_QMI);
+    mm_port_trace_record (self->priv->trace_port_id, MM_PORT_TRACE_RECORD_TYPE_RX, message->data, message->len);
+}
+
 static void
 setup_monitoring (MMPortQmi *self,
                   QmiDevice *qmi_device)
@@ -239,6 +257,15 @@ setup_monitoring (MMPortQmi *self,
                                                                   QMI_DEVICE_SIGNAL_REMOVED,
                                                                   G_CALLBACK (device_removed_cb),
                                                                   self);
+
+    /* Requests and responses are handled within libqmi, only the raw
+     * indications are exposed */
+    g_assert (!self->priv->indication_monitoring_id);
+    if (mm_port_trace_is_enabled ())
+        self->priv->indication_monitoring_id = g_signal_connect_swapped (qmi_device,
+                                                                         QMI_DEVICE_SIGNAL_INDICATION,
+                                                                         G_CALLBACK (indication_trace_cb),
+                                                                         self);
 }
 
 /*****************************************************************************/
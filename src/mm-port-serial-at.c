@@ -32,16 +32,29 @@ enum {
     PROP_INIT_SEQUENCE_ENABLED,
     PROP_INIT_SEQUENCE,
     PROP_SEND_LF,
+    PROP_COMMAND_CHAINING,
     LAST_PROP
 };
 
 struct _MMPortSerialAtPrivate {
     /* Response parser data */
     MMPortSerialAtResponseParserFn response_parser_fn;
+    MMPortSerialAtResponseParserResetFn response_parser_reset_fn;
     gpointer response_parser_user_data;
     GDestroyNotify response_parser_notify;
+    /* Whether the parser was last given an incomplete response, the
+     * generation and length of the buffer holding it, and the string
+     * given to the parser, which is only extended with new data */
+    gboolean response_incomplete;
+    guint response_generation;
+    gsize response_len;
+    GString *response;
 
     GSList *unsolicited_msg_handlers;
+    /* Handlers with a known line prefix, indexed by its first two chars */
+    GHashTable *unsolicited_msg_handlers_index;
+    guint       unsolicited_msg_serial;
+    GArray     *unsolicited_msg_matches;
 
     MMPortSerialAtFlag flags;
 
@@ -50,6 +63,7 @@ struct _MMPortSerialAtPrivate {
     guint init_sequence_enabled;
     gchar **init_sequence;
     gboolean send_lf;
+    gboolean command_chaining;
 };
 
 /*****************************************************************************/
@@ -57,6 +71,7 @@ struct _MMPortSerialAtPrivate {
 void
 mm_port_serial_at_set_response_parser (MMPortSerialAt *self,
                                        MMPortSerialAtResponseParserFn fn,
+                                       MMPortSerialAtResponseParserResetFn reset_fn,
                                        gpointer user_data,
                                        GDestroyNotify notify)
 {
@@ -66,24 +81,29 @@ mm_port_serial_at_set_response_parser (MMPortSerialAt *self,
         self->priv->response_parser_notify (self->priv->response_parser_user_data);
 
     self->priv->response_parser_fn = fn;
+    self->priv->response_parser_reset_fn = reset_fn;
     self->priv->response_parser_user_data = user_data;
     self->priv->response_parser_notify = notify;
+    self->priv->response_incomplete = FALSE;
 }
 
 void
-mm_port_serial_at_remove_echo (GByteArray *response)
+mm_port_serial_at_remove_echo (MMSerialBuffer *response)
 {
-    guint i;
+    const guint8 *data;
+    gsize         len;
+    gsize         i;
 
-    if (response->len <= 2)
+    data = mm_serial_buffer_peek (response, &len);
+    if (len <= 2)
         return;
 
-    for (i = 0; i < (response->len - 1); i++) {
+    for (i = 0; i < (len - 1); i++) {
         /* If there is any content before the first
          * <CR><LF>, assume it's echo or garbage, and skip it */
-        if (response->data[i] == '\r' && response->data[i + 1] == '\n') {
+        if (data[i] == '\r' && data[i + 1] == '\n') {
             if (i > 0)
-                g_byte_array_remove_range (response, 0, i);
+                mm_serial_buffer_consume (response, i);
             /* else, good, we're already started with <CR><LF> */
             break;
         }
@@ -92,12 +112,13 @@ mm_port_serial_at_remove_echo (GByteArray *response)
 
 static MMPortSerialResponseType
 parse_response (MMPortSerial *port,
-                GByteArray *response,
+                MMSerialBuffer *response,
                 GByteArray **parsed_response,
                 GError **error)
 {
     MMPortSerialAt *self = MM_PORT_SERIAL_AT (port);
-    GString *string;
+    const guint8 *data;
+    gsize len;
     gsize parsed_len;
     GError *inner_error = NULL;
 
@@ -109,36 +130,54 @@ parse_response (MMPortSerial *port,
 
     /* If there's no response to receive, we're done; e.g. if we only got
      * unsolicited messages */
-    if (!response->len)
+    data = mm_serial_buffer_peek (response, &len);
+    if (!len)
         return MM_PORT_SERIAL_RESPONSE_NONE;
 
-    /* Construct the string that AT-parsing functions expect */
-    string = g_string_sized_new (response->len + 1);
-    g_string_append_len (string, (const char *) response->data, response->len);
-
-    /* Fully cleanup the response array, we'll consider the contents we got
-     * as the full reply that the command may expect. */
-    g_byte_array_remove_range (response, 0, response->len);
+    if (!self->priv->response)
+        self->priv->response = g_string_sized_new (len + 1);
+
+    /* Construct the string that AT-parsing functions expect. If no data was
+     * removed since the previous attempt, the buffer only grew, so just the
+     * new data is added to the string and the parser may resume where it
+     * stopped. */
+    if (self->priv->response_incomplete &&
+        self->priv->response_generation == mm_serial_buffer_get_generation (response)) {
+        g_string_append_len (self->priv->response,
+                             (const char *) data + self->priv->response_len,
+                             len - self->priv->response_len);
+    } else {
+        if (self->priv->response_incomplete && self->priv->response_parser_reset_fn)
+            self->priv->response_parser_reset_fn (self->priv->response_parser_user_data);
+        g_string_truncate (self->priv->response, 0);
+        g_string_append_len (self->priv->response, (const char *) data, len);
+    }
+    self->priv->response_incomplete = FALSE;
 
     /* Parse it; returns FALSE if there is nothing we can do with this
-     * response yet. */
-    if (!self->priv->response_parser_fn (self->priv->response_parser_user_data, string, self, &inner_error)) {
-        /* Copy what we got back in the response buffer. */
-        g_byte_array_append (response, (const guint8 *) string->str, string->len);
-        g_string_free (string, TRUE);
+     * response yet. The data is kept in the response buffer meanwhile. */
+    if (!self->priv->response_parser_fn (self->priv->response_parser_user_data, self->priv->response, self, &inner_error)) {
+        self->priv->response_incomplete = TRUE;
+        self->priv->response_generation = mm_serial_buffer_get_generation (response);
+        self->priv->response_len = len;
         return MM_PORT_SERIAL_RESPONSE_NONE;
     }
 
+    /* Fully cleanup the response buffer, we'll consider the contents we got
+     * as the full reply that the command may expect. */
+    mm_serial_buffer_clear (response);
+
     /* If we got an error, propagate it without any further response string */
     if (inner_error) {
-        g_string_free (string, TRUE);
+        g_string_truncate (self->priv->response, 0);
         g_propagate_error (error, inner_error);
         return MM_PORT_SERIAL_RESPONSE_ERROR;
     }
 
-    /* Otherwise, build a new GByteArray considered as parsed response */
-    parsed_len = string->len;
-    *parsed_response = g_byte_array_new_take ((guint8 *) g_string_free (string, FALSE), parsed_len);
+    /* Otherwise, the string becomes the parsed response */
+    parsed_len = self->priv->response->len;
+    *parsed_response = g_byte_array_new_take ((guint8 *) g_string_free (self->priv->response, FALSE), parsed_len);
+    self->priv->response = NULL;
     return MM_PORT_SERIAL_RESPONSE_BUFFER;
 }
 
@@ -150,8 +189,15 @@ typedef struct {
     gboolean enable;
     gpointer user_data;
     GDestroyNotify notify;
+    /* Literal text found right after a <CR><LF> in every match, if known */
+    gchar *line_prefix;
+    gsize  line_prefix_len;
+    guint  candidate_serial;
 } MMAtUnsolicitedMsgHandler;
 
+#define LINE_PREFIX_KEY(str) \
+    GUINT_TO_POINTER ((guint)((const guint8 *)(str))[0] | ((guint)((const guint8 *)(str))[1] << 8))
+
 static gint
 unsolicited_msg_handler_cmp (MMAtUnsolicitedMsgHandler *handler,
                              GRegex *regex)
@@ -160,6 +206,136 @@ unsolicited_msg_handler_cmp (MMAtUnsolicitedMsgHandler *handler,
                       g_regex_get_pattern (regex));
 }
 
+/* Returns TRUE if the group starting at the given '(' must always match, i.e.
+ * if it has no alternations and it isn't followed by an optional quantifier */
+static gboolean
+regex_group_is_mandatory (const gchar *group)
+{
+    const gchar *p;
+    guint        depth = 0;
+    gboolean     in_class = FALSE;
+
+    for (p = group; *p; p++) {
+        if (*p == '\\') {
+            if (!p[1])
+                return FALSE;
+            p++;
+            continue;
+        }
+        if (in_class) {
+            if (*p == ']')
+                in_class = FALSE;
+            continue;
+        }
+        switch (*p) {
+        case '[':
+            in_class = TRUE;
+            break;
+        case '(':
+            depth++;
+            break;
+        case ')':
+            if (--depth == 0)
+                return (p[1] != '?' && p[1] != '*' && p[1] != '{');
+            break;
+        case '|':
+            if (depth == 1)
+                return FALSE;
+            break;
+        default:
+            break;
+        }
+    }
+    return FALSE;
+}
+
+/* Find the literal text that every match of the URC regex must have right
+ * after a <CR><LF> line delimiter, e.g. "+CREG:" in "\r\n\+CREG:(.*)\r\n".
+ * Returns NULL if there's no such prefix, or if it cannot be safely guessed. */
+static gchar *
+unsolicited_regex_get_line_prefix (GRegex *regex)
+{
+    const gchar *pattern;
+    const gchar *p;
+    GString     *prefix;
+    guint        depth = 0;
+    gboolean     in_class = FALSE;
+
+    if (g_regex_get_compile_flags (regex) & (G_REGEX_CASELESS | G_REGEX_EXTENDED))
+        return NULL;
+
+    pattern = g_regex_get_pattern (regex);
+
+    /* Top-level alternations may match anything */
+    for (p = pattern; *p; p++) {
+        if (*p == '\\') {
+            if (!p[1])
+                return NULL;
+            p++;
+            continue;
+        }
+        if (in_class) {
+            if (*p == ']')
+                in_class = FALSE;
+            continue;
+        }
+        if (*p == '[')
+            in_class = TRUE;
+        else if (*p == '(')
+            depth++;
+        else if (*p == ')' && depth > 0)
+            depth--;
+        else if (*p == '|' && depth == 0)
+            return NULL;
+    }
+
+    if (g_str_has_prefix (pattern, "\\r\\n"))
+        p = pattern + strlen ("\\r\\n");
+    else if (g_str_has_prefix (pattern, "(?:\\r)+\\n"))
+        p = pattern + strlen ("(?:\\r)+\\n");
+    else
+        return NULL;
+
+    prefix = g_string_new (NULL);
+    while (*p) {
+        const gchar *next;
+        gchar        c;
+
+        if (*p == '(' && p[1] != '?' && regex_group_is_mandatory (p)) {
+            p++;
+            continue;
+        }
+
+        if (*p == '\\') {
+            /* Only escaped punctuation chars are literals, e.g. "\+" */
+            if (!p[1] || g_ascii_isalnum (p[1]))
+                break;
+            c = p[1];
+            next = p + 2;
+        } else if (strchr (".[]()|?*+{}^$", *p))
+            break;
+        else {
+            c = *p;
+            next = p + 1;
+        }
+
+        /* Quantifiers allowing zero repetitions make the char optional */
+        if (*next == '?' || *next == '*' || *next == '{')
+            break;
+
+        g_string_append_c (prefix, c);
+        if (*next == '+')
+            break;
+        p = next;
+    }
+
+    if (prefix->len < 2) {
+        g_string_free (prefix, TRUE);
+        return NULL;
+    }
+    return g_string_free (prefix, FALSE);
+}
+
 void
 mm_port_serial_at_add_unsolicited_msg_handler (MMPortSerialAt *self,
                                                GRegex *regex,
@@ -185,9 +361,21 @@ mm_port_serial_at_add_unsolicited_msg_handler (MMPortSerialAt *self,
         /* The new handler is always PREPENDED, so that e.g. plugins can provide
          * more specific matches for URCs that are also handled by the generic
          * plugin. */
-        handler = g_slice_new (MMAtUnsolicitedMsgHandler);
+        handler = g_slice_new0 (MMAtUnsolicitedMsgHandler);
         handler->regex = g_regex_ref (regex);
         self->priv->unsolicited_msg_handlers = g_slist_prepend (self->priv->unsolicited_msg_handlers, handler);
+
+        handler->line_prefix = unsolicited_regex_get_line_prefix (regex);
+        if (handler->line_prefix) {
+            gpointer  key;
+            GSList   *indexed;
+
+            handler->line_prefix_len = strlen (handler->line_prefix);
+            key = LINE_PREFIX_KEY (handler->line_prefix);
+            indexed = g_hash_table_lookup (self->priv->unsolicited_msg_handlers_index, key);
+            g_hash_table_steal (self->priv->unsolicited_msg_handlers_index, key);
+            g_hash_table_insert (self->priv->unsolicited_msg_handlers_index, key, g_slist_prepend (indexed, handler));
+        }
     }
 
     handler->callback = callback;
@@ -216,26 +404,78 @@ mm_port_serial_at_enable_unsolicited_msg_handler (MMPortSerialAt *self,
     }
 }
 
-static gboolean
-remove_eval_cb (const GMatchInfo *match_info,
-                GString *result,
-                gpointer user_data)
+/* Split the response in lines once, and flag as candidates all the handlers
+ * with a line prefix found at the beginning of any line */
+static void
+unsolicited_msg_handlers_flag_candidates (MMPortSerialAt *self,
+                                          const guint8   *data,
+                                          gsize           len)
 {
-    int *result_len = (int *) user_data;
-    int start;
-    int end;
+    gsize i = 0;
 
-    if (g_match_info_fetch_pos  (match_info, 0, &start, &end))
-        *result_len -= (end - start);
+    self->priv->unsolicited_msg_serial++;
 
-    return FALSE;
+    while (i + 1 < len) {
+        const guint8 *cr;
+        GSList       *l;
+
+        cr = memchr (data + i, '\r', len - i - 1);
+        if (!cr)
+            break;
+        i = (cr - data) + 1;
+        if (data[i] != '\n')
+            continue;
+        i++;
+        if (i + 1 >= len)
+            break;
+
+        for (l = g_hash_table_lookup (self->priv->unsolicited_msg_handlers_index, LINE_PREFIX_KEY (data + i)); l; l = g_slist_next (l)) {
+            MMAtUnsolicitedMsgHandler *handler = (MMAtUnsolicitedMsgHandler *) l->data;
+
+            if (handler->line_prefix_len <= (len - i) &&
+                memcmp (data + i, handler->line_prefix, handler->line_prefix_len) == 0)
+                handler->candidate_serial = self->priv->unsolicited_msg_serial;
+        }
+    }
 }
 
+typedef struct {
+    gint start;
+    gint end;
+} UnsolicitedMsgMatch;
+
 static void
-parse_unsolicited (MMPortSerial *port, GByteArray *response)
+remove_matches (MMSerialBuffer *response,
+                GArray         *matches)
+{
+    guint8 *data;
+    gsize   len;
+    gsize   r = 0;
+    gsize   w = 0;
+    guint   i;
+
+    data = mm_serial_buffer_peek (response, &len);
+    for (i = 0; i < matches->len; i++) {
+        UnsolicitedMsgMatch *match = &g_array_index (matches, UnsolicitedMsgMatch, i);
+
+        if (w != r)
+            memmove (data + w, data + r, match->start - r);
+        w += match->start - r;
+        r = match->end;
+    }
+
+    if (w != r)
+        memmove (data + w, data + r, len - r);
+    w += len - r;
+    mm_serial_buffer_truncate (response, w);
+}
+
+static void
+parse_unsolicited (MMPortSerial *port, MMSerialBuffer *response)
 {
     MMPortSerialAt *self = MM_PORT_SERIAL_AT (port);
     GSList *iter;
+    gboolean candidates_flagged = FALSE;
 
     /* Remove echo */
     if (self->priv->remove_echo)
@@ -244,35 +484,47 @@ parse_unsolicited (MMPortSerial *port, GByteArray *response)
     for (iter = self->priv->unsolicited_msg_handlers; iter; iter = iter->next) {
         MMAtUnsolicitedMsgHandler *handler = (MMAtUnsolicitedMsgHandler *) iter->data;
         g_autoptr(GMatchInfo)      match_info = NULL;
-        gboolean                   matches;
+        const guint8              *data;
+        gsize                      len;
 
         if (!handler->enable)
             continue;
 
-        matches = g_regex_match_full (handler->regex,
-                                      (const char *) response->data,
-                                      response->len,
-                                      0, 0, &match_info, NULL);
-        if (handler->callback) {
-            while (g_match_info_matches (match_info)) {
-                handler->callback (self, match_info, handler->user_data);
-                g_match_info_next (match_info, NULL);
+        data = mm_serial_buffer_peek (response, &len);
+
+        /* Handlers with a known line prefix only run their regex if any line
+         * in the response starts with it */
+        if (handler->line_prefix) {
+            if (!candidates_flagged) {
+                unsolicited_msg_handlers_flag_candidates (self, data, len);
+                candidates_flagged = TRUE;
             }
+            if (handler->candidate_serial != self->priv->unsolicited_msg_serial)
+                continue;
         }
 
-        if (matches) {
-            /* Remove matches */
-            g_autofree gchar *str = NULL;
-            gint              result_len = response->len;
+        if (!g_regex_match_full (handler->regex,
+                                 (const char *) data,
+                                 len,
+                                 0, 0, &match_info, NULL))
+            continue;
 
-            str = g_regex_replace_eval (handler->regex,
-                                        (const char *) response->data,
-                                        response->len,
-                                        0, 0,
-                                        remove_eval_cb, &result_len, NULL);
+        g_array_set_size (self->priv->unsolicited_msg_matches, 0);
+        while (g_match_info_matches (match_info)) {
+            UnsolicitedMsgMatch match;
 
-            g_byte_array_remove_range (response, 0, response->len);
-            g_byte_array_append (response, (const guint8 *) str, result_len);
+            if (handler->callback)
+                handler->callback (self, match_info, handler->user_data);
+            if (g_match_info_fetch_pos (match_info, 0, &match.start, &match.end) && match.end > match.start)
+                g_array_append_val (self->priv->unsolicited_msg_matches, match);
+            g_match_info_next (match_info, NULL);
+        }
+
+        /* Remove all matches in a single pass; as the response changed, the
+         * candidate handlers need to be flagged again. */
+        if (self->priv->unsolicited_msg_matches->len) {
+            remove_matches (response, self->priv->unsolicited_msg_matches);
+            candidates_flagged = FALSE;
         }
     }
 }
@@ -322,32 +574,41 @@ mm_port_serial_at_command_finish (MMPortSerialAt *self,
     return g_task_propagate_pointer (G_TASK (res), error);
 }
 
+gint64
+mm_port_serial_at_command_get_send_time (MMPortSerialAt *self,
+                                         GAsyncResult *res)
+{
+    gint64 *send_time;
+
+    send_time = g_task_get_task_data (G_TASK (res));
+    return send_time ? *send_time : 0;
+}
+
 static void
 serial_command_ready (MMPortSerial *port,
                       GAsyncResult *res,
                       GTask *task)
 {
-    GByteArray *response_buffer;
-    GError *error = NULL;
-    GString *response;
-    gchar *str;
-
-    response_buffer = mm_port_serial_command_finish (port, res, &error);
-    if (!response_buffer) {
+    g_autoptr(GBytes)  response = NULL;
+    GError            *error = NULL;
+    gconstpointer      data;
+    gsize              len;
+    gint64            *send_time;
+
+    send_time = g_new (gint64, 1);
+    *send_time = mm_port_serial_command_get_send_time (port, res);
+    g_task_set_task_data (task, send_time, g_free);
+
+    response = mm_port_serial_command_finish (port, res, &error);
+    if (!response) {
         g_task_return_error (task, error);
         g_object_unref (task);
         return;
     }
 
-    /* Build a GString just with the response we need, and clear the
-     * processed range from the response buffer */
-    response = g_string_new_len ((const gchar *)response_buffer->data, response_buffer->len);
-    if (response_buffer->len > 0)
-        g_byte_array_remove_range (response_buffer, 0, response_buffer->len);
-    g_byte_array_unref (response_buffer);
-
-    str = g_string_free (response, FALSE);
-    g_task_return_pointer (task, str, g_free);
+    /* The response may be shared with the reply cache, so just copy it */
+    data = g_bytes_get_data (response, &len);
+    g_task_return_pointer (task, g_strndup ((const gchar *) data, len), g_free);
     g_object_unref (task);
 }
 
@@ -388,6 +649,54 @@ mm_port_serial_at_command (MMPortSerialAt *self,
     g_byte_array_unref (buf);
 }
 
+/* Seconds during which replies to read commands may be reused */
+#define CACHED_REPLY_STATE_TTL 10
+
+/* Commands whose reply doesn't change unless the device state changes (SIM
+ * swap, power state change, firmware switch...), on top of test commands */
+static const gchar *static_reply_commands[] = {
+    "+CGMI", "+GMI", "+CGMM", "+GMM", "+CGMR", "+GMR", "+CGSN", "+GSN",
+    "+GCAP", "+CLAC", "I", "I0", "I1", "I2", "I3", "I4", "I5", "I6", "I7",
+};
+
+static guint
+get_cached_reply_ttl (MMPortSerial     *self,
+                      const GByteArray *command)
+{
+    const gchar *body;
+    gsize        len;
+    guint        i;
+
+    body = (const gchar *) command->data;
+    len = command->len;
+
+    /* Skip the "AT" prefix and the trailing CR/LF */
+    if (len >= 2 && g_ascii_strncasecmp (body, "AT", 2) == 0) {
+        body += 2;
+        len -= 2;
+    }
+    while (len > 0 && (body[len - 1] == '\r' || body[len - 1] == '\n'))
+        len--;
+
+    if (len >= 2 && body[len - 2] == '=' && body[len - 1] == '?')
+        return MM_PORT_SERIAL_CACHED_REPLY_TTL_FOREVER;
+
+    for (i = 0; i < G_N_ELEMENTS (static_reply_commands); i++) {
+        if (strlen (static_reply_commands[i]) == len &&
+            g_ascii_strncasecmp (body, static_reply_commands[i], len) == 0)
+            return MM_PORT_SERIAL_CACHED_REPLY_TTL_FOREVER;
+    }
+
+    /* Set commands and basic commands (e.g. ATD, ATH, ATZ) act on the
+     * device, their replies are never reused */
+    if (len == 0 || !strchr ("+^$%*#!@_", body[0]) || memchr (body, '=', len))
+        return 0;
+
+    /* Read and execute commands reflect the current device state, only
+     * avoid sending them again in bursts */
+    return CACHED_REPLY_STATE_TTL;
+}
+
 static void
 debug_log (MMPortSerial *self,
            const gchar  *prefix,
@@ -418,7 +727,7 @@ debug_log (MMPortSerial *self,
     }
 
     g_string_append_c (debug, '\'');
-    mm_obj_dbg (self, "%s", debug->str);
+    mm_obj_dbg_ratelimited (self, "%s", debug->str);
     g_string_truncate (debug, 0);
 }
 
@@ -505,6 +814,15 @@ mm_port_serial_at_init (MMPortSerialAt *self)
 
     /* By default, don't send line feed */
     self->priv->send_lf = FALSE;
+
+    /* By default, send each command of a sequence in its own command line */
+    self->priv->command_chaining = FALSE;
+
+    self->priv->unsolicited_msg_handlers_index = g_hash_table_new_full (g_direct_hash,
+                                                                        g_direct_equal,
+                                                                        NULL,
+                                                                        (GDestroyNotify) g_slist_free);
+    self->priv->unsolicited_msg_matches = g_array_new (FALSE, FALSE, sizeof (UnsolicitedMsgMatch));
 }
 
 static void
@@ -529,6 +847,9 @@ set_property (GObject *object,
     case PROP_SEND_LF:
         self->priv->send_lf = g_value_get_boolean (value);
         break;
+    case PROP_COMMAND_CHAINING:
+        self->priv->command_chaining = g_value_get_boolean (value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
         break;
@@ -556,6 +877,9 @@ get_property (GObject *object,
     case PROP_SEND_LF:
         g_value_set_boolean (value, self->priv->send_lf);
         break;
+    case PROP_COMMAND_CHAINING:
+        g_value_set_boolean (value, self->priv->command_chaining);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
         break;
@@ -574,15 +898,21 @@ finalize (GObject *object)
             handler->notify (handler->user_data);
 
         g_regex_unref (handler->regex);
+        g_free (handler->line_prefix);
         g_slice_free (MMAtUnsolicitedMsgHandler, handler);
         self->priv->unsolicited_msg_handlers = g_slist_delete_link (self->priv->unsolicited_msg_handlers,
                                                                     self->priv->unsolicited_msg_handlers);
     }
 
+    g_hash_table_unref (self->priv->unsolicited_msg_handlers_index);
+    g_array_unref (self->priv->unsolicited_msg_matches);
+
     if (self->priv->response_parser_notify)
         self->priv->response_parser_notify (self->priv->response_parser_user_data);
 
     g_strfreev (self->priv->init_sequence);
+    if (self->priv->response)
+        g_string_free (self->priv->response, TRUE);
 
     G_OBJECT_CLASS (mm_port_serial_at_parent_class)->finalize (object);
 }
@@ -604,6 +934,7 @@ mm_port_serial_at_class_init (MMPortSerialAtClass *klass)
     serial_class->parse_response = parse_response;
     serial_class->debug_log = debug_log;
     serial_class->config = config;
+    serial_class->get_cached_reply_ttl = get_cached_reply_ttl;
 
     g_object_class_install_property
         (object_class, PROP_REMOVE_ECHO,
@@ -636,4 +967,12 @@ mm_port_serial_at_class_init (MMPortSerialAtClass *klass)
                                "Send line-feed at the end of each AT command sent",
                                FALSE,
                                G_PARAM_READWRITE));
+
+    g_object_class_install_property
+        (object_class, PROP_COMMAND_CHAINING,
+         g_param_spec_boolean (MM_PORT_SERIAL_AT_COMMAND_CHAINING,
+                               "Command chaining",
+                               "Whether consecutive commands of a sequence may be sent in a single command line",
+                               FALSE,
+                               G_PARAM_READWRITE));
 }
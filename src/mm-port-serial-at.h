@@ -61,6 +61,11 @@ typedef gboolean (*MMPortSerialAtResponseParserFn) (gpointer   user_data,
                                                     gpointer   log_object,
                                                     GError   **error);
 
+/* Called before parsing a response which is not the one given in the previous
+ * attempt with more data appended, e.g. because unsolicited messages were
+ * removed from it */
+typedef void (*MMPortSerialAtResponseParserResetFn) (gpointer user_data);
+
 typedef void (*MMPortSerialAtUnsolicitedMsgFn) (MMPortSerialAt *port,
                                                 GMatchInfo *match_info,
                                                 gpointer user_data);
@@ -69,6 +74,7 @@ typedef void (*MMPortSerialAtUnsolicitedMsgFn) (MMPortSerialAt *port,
 #define MM_PORT_SERIAL_AT_INIT_SEQUENCE_ENABLED "init-sequence-enabled"
 #define MM_PORT_SERIAL_AT_INIT_SEQUENCE         "init-sequence"
 #define MM_PORT_SERIAL_AT_SEND_LF               "send-lf"
+#define MM_PORT_SERIAL_AT_COMMAND_CHAINING      "command-chaining"
 
 struct _MMPortSerialAt {
     MMPortSerial parent;
@@ -97,6 +103,7 @@ void     mm_port_serial_at_enable_unsolicited_msg_handler (MMPortSerialAt *self,
 
 void     mm_port_serial_at_set_response_parser (MMPortSerialAt *self,
                                                 MMPortSerialAtResponseParserFn fn,
+                                                MMPortSerialAtResponseParserResetFn reset_fn,
                                                 gpointer user_data,
                                                 GDestroyNotify notify);
 
@@ -111,9 +118,11 @@ void         mm_port_serial_at_command        (MMPortSerialAt *self,
 gchar *mm_port_serial_at_command_finish       (MMPortSerialAt *self,
                                                GAsyncResult *res,
                                                GError **error);
+gint64 mm_port_serial_at_command_get_send_time (MMPortSerialAt *self,
+                                                GAsyncResult *res);
 
 /* Just for unit tests */
-void     mm_port_serial_at_remove_echo (GByteArray *response);
+void     mm_port_serial_at_remove_echo (MMSerialBuffer *response);
 
 void     mm_port_serial_at_set_flags (MMPortSerialAt *self,
                                       MMPortSerialAtFlag flags);
@@ -70,7 +70,7 @@ remove_eval_cb (const GMatchInfo *match_info,
 
 static MMPortSerialResponseType
 parse_response (MMPortSerial *port,
-                GByteArray *response,
+                MMSerialBuffer *response,
                 GByteArray **parsed_response,
                 GError **error)
 {
@@ -79,22 +79,22 @@ parse_response (MMPortSerial *port,
     gboolean               matches;
     gchar                 *str;
     gint                   result_len;
-    guint                  i;
-
-    for (i = 0; i < response->len; i++) {
-        /* If there is any content before the first $,
-         * assume it's garbage, and skip it */
-        if (response->data[i] == '$') {
-            if (i > 0)
-                g_byte_array_remove_range (response, 0, i);
-            /* else, good, we're already started with $ */
-            break;
-        }
+    const guint8          *data;
+    gsize                  len;
+    const guint8          *dollar;
+
+    /* If there is any content before the first $,
+     * assume it's garbage, and skip it */
+    data = mm_serial_buffer_peek (response, &len);
+    dollar = memchr (data, '$', len);
+    if (dollar && dollar > data) {
+        mm_serial_buffer_consume (response, dollar - data);
+        data = mm_serial_buffer_peek (response, &len);
     }
 
     matches = g_regex_match_full (self->priv->known_traces_regex,
-                                  (const gchar *) response->data,
-                                  response->len,
+                                  (const gchar *) data,
+                                  len,
                                   0, 0, &match_info, NULL);
 
     if (self->priv->callback) {
@@ -114,15 +114,15 @@ parse_response (MMPortSerial *port,
         return MM_PORT_SERIAL_RESPONSE_NONE;
 
     /* Remove matches */
-    result_len = response->len;
+    result_len = len;
     str = g_regex_replace_eval (self->priv->known_traces_regex,
-                                (const char *) response->data,
-                                response->len,
+                                (const char *) data,
+                                len,
                                 0, 0,
                                 remove_eval_cb, &result_len, NULL);
 
     /* Cleanup response buffer */
-    g_byte_array_remove_range (response, 0, response->len);
+    mm_serial_buffer_clear (response);
 
     /* Build parsed response */
     *parsed_response = g_byte_array_new_take ((guint8 *)str, result_len);
@@ -162,7 +162,7 @@ debug_log (MMPortSerial *self,
     }
 
     g_string_append_c (debug, '\'');
-    mm_obj_dbg (self, "%s", debug->str);
+    mm_obj_dbg_ratelimited (self, "%s", debug->str);
     g_string_truncate (debug, 0);
 }
 
@@ -37,11 +37,15 @@ struct _MMPortSerialQcdmPrivate {
 
 /*****************************************************************************/
 
+/* Packets needing unescaping must fit in this; others are used in place */
+#define QCDM_SCRATCH_SIZE 1024
+
 static gboolean
-find_qcdm_start (GByteArray *response, gsize *start)
+find_qcdm_start (const guint8 *data, gsize len, gsize *start)
 {
-    guint i;
-    gint  last = -1;
+    const guint8 *marker;
+    gsize         pos = 0;
+    gssize        last = -1;
 
     /* Look for 3 bytes and a QCDM frame marker, ie enough data for a valid
      * frame.  There will usually be three cases here; (1) a QCDM frame
@@ -49,41 +53,48 @@ find_qcdm_start (GByteArray *response, gsize *start)
      * with 0x7E and ending with 0x7E, and (3) a non-QCDM frame that still
      * uses HDLC framing (like Sierra CnS) that starts and ends with 0x7E.
      */
-    for (i = 0; i < response->len; i++) {
-        /* Marker found */
-        if (response->data[i] == 0x7E) {
-            /* If we didn't get an initial marker, count at least 3 bytes since
-             * origin; if we did get an initial marker, count at least 3 bytes
-             * since the marker.
-             */
-            if (((last == -1) && (i >= 3)) || ((last >= 0) && (i > (guint)(last + 3)))) {
-                /* Got a full QCDM frame; 3 non-0x7E bytes and a terminator */
-                if (start)
-                    *start = last + 1;
-                return TRUE;
-            }
+    while ((marker = memchr (data + pos, 0x7E, len - pos)) != NULL) {
+        gsize i = marker - data;
 
-            /* Save position of the last QCDM frame marker */
-            last = i;
+        /* If we didn't get an initial marker, count at least 3 bytes since
+         * origin; if we did get an initial marker, count at least 3 bytes
+         * since the marker.
+         */
+        if (((last == -1) && (i >= 3)) || ((last >= 0) && (i > (gsize)(last + 3)))) {
+            /* Got a full QCDM frame; 3 non-0x7E bytes and a terminator */
+            if (start)
+                *start = last + 1;
+            return TRUE;
         }
+
+        /* Save position of the last QCDM frame marker */
+        last = i;
+        pos = i + 1;
     }
     return FALSE;
 }
 
+/* Looks for a QCDM packet at the start of the buffer, without removing it.
+ * The packet is either left in the buffer itself or unescaped into 'scratch',
+ * so it is only valid until the buffer is modified; the caller removes
+ * 'out_used' bytes once done with it. */
 static MMPortSerialResponseType
-parse_qcdm (GByteArray *response,
-            gboolean want_log,
-            GByteArray **parsed_response,
-            GError **error)
+peek_qcdm (MMSerialBuffer  *response,
+           guint8          *scratch,
+           gsize            scratch_len,
+           const guint8   **out_frame,
+           gsize           *out_frame_len,
+           gsize           *out_used,
+           GError         **error)
 {
+    const guint8 *data;
+    gsize len;
     gsize start = 0;
-    gsize used = 0;
-    gsize unescaped_len = 0;
-    guint8 *unescaped_buffer;
     qcdmbool more = FALSE;
 
     /* Get the offset into the buffer of where the QCDM frame starts */
-    if (!find_qcdm_start (response, &start)) {
+    data = mm_serial_buffer_peek (response, &len);
+    if (!find_qcdm_start (data, len, &start)) {
         /* Discard the unparsable data right away, we do need a QCDM
          * start, and anything that comes before it is unknown data
          * that we'll never use. */
@@ -91,19 +102,20 @@ parse_qcdm (GByteArray *response,
     }
 
     /* If there is anything before the start marker, remove it */
-    g_byte_array_remove_range (response, 0, start);
-    if (response->len == 0)
+    mm_serial_buffer_consume (response, start);
+    data = mm_serial_buffer_peek (response, &len);
+    if (len == 0)
         return MM_PORT_SERIAL_RESPONSE_NONE;
 
-    /* Try to decapsulate the response into a buffer */
-    unescaped_buffer = g_malloc (1024);
-    if (!dm_decapsulate_buffer ((const char *)(response->data),
-                                response->len,
-                                (char *)unescaped_buffer,
-                                1024,
-                                &unescaped_len,
-                                &used,
-                                &more)) {
+    /* Try to decapsulate the response */
+    if (!dm_decapsulate_frame ((const char *)data,
+                               len,
+                               (char *)scratch,
+                               scratch_len,
+                               (const char **)out_frame,
+                               out_frame_len,
+                               out_used,
+                               &more)) {
         /* Report an error right away. Not being able to decapsulate a QCDM
          * packet once we got message start marker likely means that this
          * data that we got is not a QCDM message. */
@@ -111,45 +123,44 @@ parse_qcdm (GByteArray *response,
                      MM_SERIAL_ERROR,
                      MM_SERIAL_ERROR_PARSE_FAILED,
                      "Failed to unescape QCDM packet");
-        g_free (unescaped_buffer);
         return MM_PORT_SERIAL_RESPONSE_ERROR;
     }
 
     if (more) {
-        /* Need more data, we leave the original byte array untouched so that
+        /* Need more data, we leave the original buffer untouched so that
          * we can retry later when more data arrives. */
-        g_free (unescaped_buffer);
-        return MM_PORT_SERIAL_RESPONSE_NONE;
-    }
-
-    if (want_log && unescaped_buffer[0] != DIAG_CMD_LOG) {
-        /* If we only want log items and this isn't one, don't remove this
-         * DM packet from the buffer.
-         */
-        g_free (unescaped_buffer);
         return MM_PORT_SERIAL_RESPONSE_NONE;
     }
 
-    /* Successfully decapsulated the DM command. We'll build a new byte array
-     * with the response, and leave the input buffer cleaned up. */
-    g_assert (unescaped_len <= 1024);
-    unescaped_buffer = g_realloc (unescaped_buffer, unescaped_len);
-    *parsed_response = g_byte_array_new_take (unescaped_buffer, unescaped_len);
-
-    /* Remove the data we used from the input buffer, leaving out any
-     * additional data that may already been received (e.g. from the following
-     * message). */
-    g_byte_array_remove_range (response, 0, used);
     return MM_PORT_SERIAL_RESPONSE_BUFFER;
 }
 
 static MMPortSerialResponseType
 parse_response (MMPortSerial *port,
-                GByteArray *response,
+                MMSerialBuffer *response,
                 GByteArray **parsed_response,
                 GError **error)
 {
-    return parse_qcdm (response, FALSE, parsed_response, error);
+    MMPortSerialResponseType type;
+    guint8 scratch[QCDM_SCRATCH_SIZE];
+    const guint8 *frame = NULL;
+    gsize frame_len = 0;
+    gsize used = 0;
+
+    type = peek_qcdm (response, scratch, sizeof (scratch), &frame, &frame_len, &used, error);
+    if (type != MM_PORT_SERIAL_RESPONSE_BUFFER)
+        return type;
+
+    /* Successfully decapsulated the DM command. We'll build a new byte array
+     * with the response, and leave the input buffer cleaned up. */
+    *parsed_response = g_byte_array_sized_new (frame_len);
+    g_byte_array_append (*parsed_response, frame, frame_len);
+
+    /* Remove the data we used from the input buffer, leaving out any
+     * additional data that may already been received (e.g. from the following
+     * message). */
+    mm_serial_buffer_consume (response, used);
+    return MM_PORT_SERIAL_RESPONSE_BUFFER;
 }
 
 /*****************************************************************************/
@@ -167,14 +178,15 @@ serial_command_ready (MMPortSerial *port,
                       GAsyncResult *res,
                       GTask *task)
 {
-    GByteArray *response;
+    GBytes *response;
     GError *error = NULL;
 
     response = mm_port_serial_command_finish (port, res, &error);
     if (!response)
         g_task_return_error (task, error);
     else
-        g_task_return_pointer (task, response, (GDestroyNotify)g_byte_array_unref);
+        /* QCDM replies are never cached, so this doesn't copy the data */
+        g_task_return_pointer (task, g_bytes_unref_to_array (response), (GDestroyNotify)g_byte_array_unref);
 
     g_object_unref (task);
 }
@@ -222,7 +234,7 @@ debug_log (MMPortSerial *self,
     while (len--)
         g_string_append_printf (debug, " %02x", (guint8) (*s++ & 0xFF));
 
-    mm_obj_dbg (self, "%s", debug->str);
+    mm_obj_dbg_ratelimited (self, "%s", debug->str);
     g_string_truncate (debug, 0);
 }
 
@@ -296,38 +308,71 @@ mm_port_serial_qcdm_enable_unsolicited_msg_handler (MMPortSerialQcdm *self,
     }
 }
 
-static void
-parse_unsolicited (MMPortSerial *port, GByteArray *response)
+static gboolean
+unsolicited_msg_handler_enabled (MMPortSerialQcdm *self,
+                                 guint log_code)
 {
-    MMPortSerialQcdm *self = MM_PORT_SERIAL_QCDM (port);
-    GByteArray *log_buffer = NULL;
     GSList *iter;
 
-    if (parse_qcdm (response,
-                    TRUE,
-                    &log_buffer,
-                    NULL) != MM_PORT_SERIAL_RESPONSE_BUFFER) {
-        return;
-    }
+    for (iter = self->priv->unsolicited_msg_handlers; iter; iter = iter->next) {
+        MMQcdmUnsolicitedMsgHandler *handler = (MMQcdmUnsolicitedMsgHandler *) iter->data;
 
-    /* These should be guaranteed by parse_qcdm() */
-    g_return_if_fail (log_buffer);
-    g_return_if_fail (log_buffer->len > 0);
-    g_return_if_fail (log_buffer->data[0] == DIAG_CMD_LOG);
+        if (handler->enable && handler->callback && handler->log_code == log_code)
+            return TRUE;
+    }
+    return FALSE;
+}
 
-    if (log_buffer->len < sizeof (DMCmdLog))
-        return;
+static void
+parse_unsolicited (MMPortSerial *port, MMSerialBuffer *response)
+{
+    MMPortSerialQcdm *self = MM_PORT_SERIAL_QCDM (port);
+    guint8 scratch[QCDM_SCRATCH_SIZE];
+    const guint8 *frame = NULL;
+    gsize frame_len = 0;
+    gsize used = 0;
 
-    for (iter = self->priv->unsolicited_msg_handlers; iter; iter = iter->next) {
-        MMQcdmUnsolicitedMsgHandler *handler = (MMQcdmUnsolicitedMsgHandler *) iter->data;
-        DMCmdLog *log_cmd = (DMCmdLog *) log_buffer->data;
+    /* Process all the log items already received, not just the first one, so
+     * that they don't pile up in the buffer when the device sends them in
+     * bursts. Stop at the first packet that isn't a log item, which is left
+     * for parse_response(). */
+    while (peek_qcdm (response,
+                      scratch,
+                      sizeof (scratch),
+                      &frame,
+                      &frame_len,
+                      &used,
+                      NULL) == MM_PORT_SERIAL_RESPONSE_BUFFER) {
+        g_autoptr(GByteArray) log_buffer = NULL;
+        GSList *iter;
+        guint16 log_code = 0;
+
+        if (frame_len == 0 || frame[0] != DIAG_CMD_LOG)
+            return;
+
+        /* Only copy the log item out of the serial buffer if someone wants it */
+        if (frame_len >= sizeof (DMCmdLog)) {
+            log_code = le16toh (((const DMCmdLog *) frame)->log_code);
+            if (unsolicited_msg_handler_enabled (self, log_code)) {
+                log_buffer = g_byte_array_sized_new (frame_len);
+                g_byte_array_append (log_buffer, frame, frame_len);
+            }
+        }
 
-        if (!handler->enable)
-            continue;
-        if (handler->log_code != le16toh (log_cmd->log_code))
+        mm_serial_buffer_consume (response, used);
+        if (!log_buffer)
             continue;
-        if (handler->callback)
-            handler->callback (self, log_buffer, handler->user_data);
+
+        for (iter = self->priv->unsolicited_msg_handlers; iter; iter = iter->next) {
+            MMQcdmUnsolicitedMsgHandler *handler = (MMQcdmUnsolicitedMsgHandler *) iter->data;
+
+            if (!handler->enable)
+                continue;
+            if (handler->log_code != log_code)
+                continue;
+            if (handler->callback)
+                handler->callback (self, log_buffer, handler->user_data);
+        }
     }
 }
 
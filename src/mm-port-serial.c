@@ -34,6 +34,7 @@
 #include <mm-errors-types.h>
 
 #include "mm-port-serial.h"
+#include "mm-port-trace.h"
 #include "mm-log-object.h"
 #include "mm-helper-enums-types.h"
 
@@ -44,7 +45,7 @@ static void     port_serial_close_force            (MMPortSerial *self);
 static void     port_serial_reopen_cancel          (MMPortSerial *self);
 static void     port_serial_set_cached_reply       (MMPortSerial *self,
                                                     const GByteArray *command,
-                                                    const GByteArray *response);
+                                                    GBytes *response);
 
 G_DEFINE_TYPE (MMPortSerial, mm_port_serial, MM_TYPE_PORT)
 
@@ -73,13 +74,23 @@ static guint signals[LAST_SIGNAL] = { 0 };
 
 #define SERIAL_BUF_SIZE 2048
 
+/* After a command timed out or was cancelled, the queue is held until the
+ * final result of that command is received, so that it isn't taken as the
+ * response to the next command. If nothing at all is received in the first
+ * milliseconds the command is assumed to never reply; while part of a reply
+ * is pending the wait goes on, up to a limit. */
+#define LATE_REPLY_WAIT_MS     200
+#define LATE_REPLY_WAIT_MAX_MS 3000
+
 struct _MMPortSerialPrivate {
     guint32 open_count;
     gboolean forced_close;
     int fd;
     GHashTable *reply_cache;
+    guint n_cache_hits;
+    guint n_cache_misses;
     GQueue *queue;
-    GByteArray *response;
+    MMSerialBuffer *response;
 
     /* For real ports, iochannel, and we implement the eagain limit */
     GIOChannel *iochannel;
@@ -102,6 +113,14 @@ struct _MMPortSerialPrivate {
     guint queue_id;
     guint timeout_id;
 
+    /* Sequence number of the last command queued */
+    guint command_seq;
+    /* Sequence number of a timed out or cancelled command whose reply may
+     * still arrive, 0 if none */
+    guint late_reply_seq;
+    guint late_reply_wait_id;
+    gint64 late_reply_deadline;
+
     GCancellable *cancellable;
     gulong cancellable_id;
 
@@ -111,6 +130,9 @@ struct _MMPortSerialPrivate {
 
     GTask *flash_task;
     GTask *reopen_task;
+
+    /* Id of the port in the traffic capture, 0 if not yet announced */
+    guint16 trace_port_id;
 };
 
 /*****************************************************************************/
@@ -120,11 +142,15 @@ typedef struct {
     GByteArray *command;
     guint32 timeout;
     gboolean allow_cached;
+    gboolean cached_reply;
     guint32 eagain_count;
+    guint seq;
 
     guint32 idx;
     gboolean started;
     gboolean done;
+    /* When the command was first written to the port, 0 if never */
+    gint64 send_time;
 } CommandContext;
 
 static void
@@ -134,7 +160,7 @@ command_context_free (CommandContext *ctx)
     g_slice_free (CommandContext, ctx);
 }
 
-GByteArray *
+GBytes *
 mm_port_serial_command_finish (MMPortSerial *self,
                                GAsyncResult *res,
                                GError **error)
@@ -142,6 +168,16 @@ mm_port_serial_command_finish (MMPortSerial *self,
     return g_task_propagate_pointer (G_TASK (res), error);
 }
 
+gint64
+mm_port_serial_command_get_send_time (MMPortSerial *self,
+                                      GAsyncResult *res)
+{
+    CommandContext *ctx;
+
+    ctx = g_task_get_task_data (G_TASK (res));
+    return ctx->send_time;
+}
+
 void
 mm_port_serial_command (MMPortSerial *self,
                         GByteArray *command,
@@ -167,6 +203,7 @@ mm_port_serial_command (MMPortSerial *self,
     ctx->command = g_byte_array_ref (command);
     ctx->allow_cached = allow_cached;
     ctx->timeout = timeout_seconds;
+    ctx->seq = ++self->priv->command_seq;
 
     /* Only accept about 3 seconds of EAGAIN for this command */
     if (self->priv->send_delay && mm_port_get_subsys (MM_PORT (self)) == MM_PORT_SUBSYS_TTY)
@@ -519,13 +556,28 @@ serial_debug (MMPortSerial *self,
         MM_PORT_SERIAL_GET_CLASS (self)->debug_log (self, prefix, buf, len);
 }
 
+static void
+serial_trace (MMPortSerial          *self,
+              MMPortTraceRecordType  type,
+              const gchar           *buf,
+              gsize                  len)
+{
+    if (G_LIKELY (!mm_port_trace_is_enabled ()))
+        return;
+
+    if (!self->priv->trace_port_id)
+        self->priv->trace_port_id = mm_port_trace_register_port (mm_port_get_device (MM_PORT (self)),
+                                                                 MM_PORT_TRACE_PORT_TYPE_SERIAL);
+    mm_port_trace_record (self->priv->trace_port_id, type, (const guint8 *) buf, len);
+}
+
 static gboolean
 port_serial_process_command (MMPortSerial *self,
                              CommandContext *ctx,
                              GError **error)
 {
     const gchar *p;
-    gsize written;
+    gsize written = 0;
     gssize send_len;
 
     if (self->priv->iochannel == NULL && self->priv->socket == NULL) {
@@ -543,6 +595,7 @@ port_serial_process_command (MMPortSerial *self,
     /* Only print command the first time */
     if (ctx->started == FALSE) {
         ctx->started = TRUE;
+        ctx->send_time = g_get_monotonic_time ();
         serial_debug (self, "-->", (const gchar *) ctx->command->data, ctx->command->len);
     }
 
@@ -638,39 +691,105 @@ port_serial_process_command (MMPortSerial *self,
     } else
         g_assert_not_reached ();
 
+    if (written > 0)
+        serial_trace (self, MM_PORT_TRACE_RECORD_TYPE_TX, p, written);
+
     if (ctx->idx >= ctx->command->len)
         ctx->done = TRUE;
 
     return TRUE;
 }
 
+/*****************************************************************************/
+/* Reply cache */
+
+typedef struct {
+    GBytes *response;
+    /* Monotonic time after which the reply is no longer valid, 0 if never */
+    gint64  expiration;
+} CachedReply;
+
+static void
+cached_reply_free (CachedReply *cached)
+{
+    g_bytes_unref (cached->response);
+    g_slice_free (CachedReply, cached);
+}
+
 static void
 port_serial_set_cached_reply (MMPortSerial *self,
                               const GByteArray *command,
-                              const GByteArray *response)
+                              GBytes *response)
 {
+    g_autoptr(GBytes) key = NULL;
+    guint             ttl = MM_PORT_SERIAL_CACHED_REPLY_TTL_FOREVER;
+
     g_return_if_fail (self != NULL);
     g_return_if_fail (MM_IS_PORT_SERIAL (self));
     g_return_if_fail (command != NULL);
 
-    if (response) {
-        GByteArray *cmd_copy = g_byte_array_sized_new (command->len);
-        GByteArray *rsp_copy = g_byte_array_sized_new (response->len);
+    if (response && MM_PORT_SERIAL_GET_CLASS (self)->get_cached_reply_ttl)
+        ttl = MM_PORT_SERIAL_GET_CLASS (self)->get_cached_reply_ttl (self, command);
 
-        g_byte_array_append (cmd_copy, command->data, command->len);
-        g_byte_array_append (rsp_copy, response->data, response->len);
-        g_hash_table_insert (self->priv->reply_cache, cmd_copy, rsp_copy);
-    } else
-        g_hash_table_remove (self->priv->reply_cache, command);
+    if (response && ttl) {
+        CachedReply *cached;
+
+        /* The response is shared with the caller, not copied */
+        cached = g_slice_new0 (CachedReply);
+        cached->response = g_bytes_ref (response);
+        if (ttl != MM_PORT_SERIAL_CACHED_REPLY_TTL_FOREVER)
+            cached->expiration = g_get_monotonic_time () + (gint64) ttl * G_USEC_PER_SEC;
+        g_hash_table_insert (self->priv->reply_cache,
+                             g_bytes_new (command->data, command->len),
+                             cached);
+        return;
+    }
+
+    key = g_bytes_new_static (command->data, command->len);
+    g_hash_table_remove (self->priv->reply_cache, key);
 }
 
-static const GByteArray *
+/* Returns a new reference */
+static GBytes *
 port_serial_get_cached_reply (MMPortSerial *self,
                               GByteArray *command)
 {
-    return (const GByteArray *)g_hash_table_lookup (self->priv->reply_cache, command);
+    g_autoptr(GBytes)  key = NULL;
+    CachedReply       *cached;
+
+    key = g_bytes_new_static (command->data, command->len);
+    cached = g_hash_table_lookup (self->priv->reply_cache, key);
+    if (cached && cached->expiration && g_get_monotonic_time () > cached->expiration) {
+        g_hash_table_remove (self->priv->reply_cache, key);
+        cached = NULL;
+    }
+
+    if (!cached) {
+        self->priv->n_cache_misses++;
+        return NULL;
+    }
+
+    self->priv->n_cache_hits++;
+    return g_bytes_ref (cached->response);
+}
+
+void
+mm_port_serial_clear_cached_replies (MMPortSerial *self)
+{
+    g_return_if_fail (MM_IS_PORT_SERIAL (self));
+
+    if (!g_hash_table_size (self->priv->reply_cache))
+        return;
+
+    mm_obj_dbg (self, "clearing %u cached replies (%u hits, %u misses)",
+                g_hash_table_size (self->priv->reply_cache),
+                self->priv->n_cache_hits,
+                self->priv->n_cache_misses);
+    g_hash_table_remove_all (self->priv->reply_cache);
 }
 
+/*****************************************************************************/
+
 static void
 port_serial_schedule_queue_process (MMPortSerial *self, guint timeout_ms)
 {
@@ -684,6 +803,11 @@ port_serial_schedule_queue_process (MMPortSerial *self, guint timeout_ms)
         return;
     }
 
+    if (self->priv->late_reply_wait_id) {
+        /* Waiting for a late reply, the queue is processed once it's done */
+        return;
+    }
+
     if (timeout_ms)
         self->priv->queue_id = g_timeout_add (timeout_ms, port_serial_queue_process, self);
     else
@@ -692,7 +816,7 @@ port_serial_schedule_queue_process (MMPortSerial *self, guint timeout_ms)
 
 static void
 port_serial_got_response (MMPortSerial *self,
-                          GByteArray   *parsed_response,
+                          GBytes       *parsed_response,
                           GError *error)
 {
     /* Either one or the other, not both */
@@ -729,11 +853,12 @@ port_serial_got_response (MMPortSerial *self,
                 CommandContext *ctx;
 
 		ctx = g_task_get_task_data (task);
-                if (ctx->allow_cached)
+                /* A reply taken from the cache doesn't extend its lifetime */
+                if (ctx->allow_cached && !ctx->cached_reply)
                     port_serial_set_cached_reply (self, ctx->command, parsed_response);
                 g_task_return_pointer (task,
-                                       g_byte_array_ref (parsed_response),
-                                       (GDestroyNotify) g_byte_array_unref);
+                                       g_bytes_ref (parsed_response),
+                                       (GDestroyNotify) g_bytes_unref);
             }
 
 	    g_object_unref (task);
@@ -746,6 +871,72 @@ port_serial_got_response (MMPortSerial *self,
     g_clear_error (&error);
 }
 
+static gboolean
+port_serial_late_reply_wait_expired (MMPortSerial *self)
+{
+    gint64 remaining_ms;
+
+    self->priv->late_reply_wait_id = 0;
+
+    /* Part of the reply is already in, keep on waiting for its final result */
+    remaining_ms = (self->priv->late_reply_deadline - g_get_monotonic_time ()) / 1000;
+    if (mm_serial_buffer_get_length (self->priv->response) > 0 && remaining_ms > 0) {
+        self->priv->late_reply_wait_id = g_timeout_add (MIN (remaining_ms, LATE_REPLY_WAIT_MS),
+                                                        (GSourceFunc) port_serial_late_reply_wait_expired,
+                                                        self);
+        return G_SOURCE_REMOVE;
+    }
+
+    if (mm_serial_buffer_get_length (self->priv->response) > 0)
+        mm_obj_dbg (self, "no final result received for command #%u", self->priv->late_reply_seq);
+    else
+        mm_obj_dbg (self, "no late reply received for command #%u", self->priv->late_reply_seq);
+    self->priv->late_reply_seq = 0;
+
+    if (!g_queue_is_empty (self->priv->queue))
+        port_serial_schedule_queue_process (self, 0);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+port_serial_expect_late_reply (MMPortSerial *self)
+{
+    GTask          *task;
+    CommandContext *ctx;
+
+    task = g_queue_peek_head (self->priv->queue);
+    if (!task)
+        return;
+
+    ctx = g_task_get_task_data (task);
+    self->priv->late_reply_seq = ctx->seq;
+    self->priv->late_reply_deadline = g_get_monotonic_time () + LATE_REPLY_WAIT_MAX_MS * 1000;
+
+    if (self->priv->late_reply_wait_id)
+        g_source_remove (self->priv->late_reply_wait_id);
+    self->priv->late_reply_wait_id = g_timeout_add (LATE_REPLY_WAIT_MS,
+                                                    (GSourceFunc) port_serial_late_reply_wait_expired,
+                                                    self);
+}
+
+static gboolean
+port_serial_discard_late_reply (MMPortSerial *self)
+{
+    /* Only if no other command is waiting for its reply; commands are not
+     * sent while a late reply is expected, so this is just a safety check */
+    if (!self->priv->late_reply_wait_id || self->priv->timeout_id)
+        return FALSE;
+
+    mm_obj_dbg (self, "discarding late reply to command #%u", self->priv->late_reply_seq);
+    self->priv->late_reply_seq = 0;
+    g_source_remove (self->priv->late_reply_wait_id);
+    self->priv->late_reply_wait_id = 0;
+
+    if (!g_queue_is_empty (self->priv->queue))
+        port_serial_schedule_queue_process (self, 0);
+    return TRUE;
+}
+
 static gboolean
 port_serial_timed_out (gpointer data)
 {
@@ -757,9 +948,9 @@ port_serial_timed_out (gpointer data)
     /* Update number of consecutive timeouts found */
     self->priv->n_consecutive_timeouts++;
 
-    /* FIXME: This is not completely correct - if the response finally arrives and there's
-     * some other command waiting for response right now, the other command will
-     * get the output of the timed out command. Not sure what to do here. */
+    /* The reply may still arrive, make sure it isn't given to the next command */
+    port_serial_expect_late_reply (self);
+
     error = g_error_new_literal (MM_SERIAL_ERROR,
                                  MM_SERIAL_ERROR_RESPONSE_TIMEOUT,
                                  "Serial command timed out");
@@ -787,9 +978,9 @@ port_serial_response_wait_cancelled (GCancellable *cancellable,
     /* We don't want to call disconnect () while in the signal handler */
     self->priv->cancellable_id = 0;
 
-    /* FIXME: This is not completely correct - if the response finally arrives and there's
-     * some other command waiting for response right now, the other command will
-     * get the output of the cancelled command. Not sure what to do here. */
+    /* The reply may still arrive, make sure it isn't given to the next command */
+    port_serial_expect_late_reply (self);
+
     error = g_error_new_literal (G_IO_ERROR, G_IO_ERROR_CANCELLED,
                                  "Waiting for the reply cancelled");
     /* Note: may complete last operation and unref the MMPortSerial */
@@ -813,23 +1004,26 @@ port_serial_queue_process (gpointer data)
     ctx = g_task_get_task_data (task);
 
     if (ctx->allow_cached) {
-        const GByteArray *cached;
+        g_autoptr(GBytes) cached = NULL;
 
         cached = port_serial_get_cached_reply (self, ctx->command);
         if (cached) {
-            GByteArray *parsed_response;
-
-            parsed_response = g_byte_array_sized_new (cached->len);
-            g_byte_array_append (parsed_response, cached->data, cached->len);
+            mm_obj_dbg (self, "using cached reply for command #%u (%u hits, %u misses)",
+                        ctx->seq, self->priv->n_cache_hits, self->priv->n_cache_misses);
+            ctx->cached_reply = TRUE;
             /* Note: may complete last operation and unref the MMPortSerial */
-            port_serial_got_response (self, parsed_response, NULL);
-            g_byte_array_unref (parsed_response);
+            port_serial_got_response (self, cached, NULL);
             return G_SOURCE_REMOVE;
         }
 
         /* Cached reply wasn't found, keep on */
     }
 
+    /* Hold the command while the reply to a previous one may still arrive,
+     * otherwise that reply would be taken as the response to this one */
+    if (self->priv->late_reply_wait_id && !ctx->started)
+        return G_SOURCE_REMOVE;
+
     /* If error, report it */
     if (!port_serial_process_command (self, ctx, &error)) {
         /* Note: may complete last operation and unref the MMPortSerial */
@@ -882,6 +1076,7 @@ parse_response_buffer (MMPortSerial *self)
 {
     GError *error = NULL;
     GByteArray *parsed_response = NULL;
+    GBytes *response_bytes;
 
     /* Parse unsolicited messages in the subclass.
      *
@@ -907,14 +1102,23 @@ parse_response_buffer (MMPortSerial *self)
         /* We have a valid response to process */
         g_assert (parsed_response);
         self->priv->n_consecutive_timeouts = 0;
+        if (port_serial_discard_late_reply (self)) {
+            g_byte_array_unref (parsed_response);
+            break;
+        }
         /* Note: may complete last operation and unref the MMPortSerial */
-        port_serial_got_response (self, parsed_response, NULL);
-        g_byte_array_unref (parsed_response);
+        response_bytes = g_byte_array_free_to_bytes (parsed_response);
+        port_serial_got_response (self, response_bytes, NULL);
+        g_bytes_unref (response_bytes);
         break;
     case MM_PORT_SERIAL_RESPONSE_ERROR:
         /* We have an error to process */
         g_assert (error);
         self->priv->n_consecutive_timeouts = 0;
+        if (port_serial_discard_late_reply (self)) {
+            g_error_free (error);
+            break;
+        }
         /* Note: may complete last operation and unref the MMPortSerial */
         port_serial_got_response (self, NULL, error);
         break;
@@ -941,8 +1145,7 @@ common_input_available (MMPortSerial *self,
 
     if (condition & G_IO_HUP) {
         mm_obj_dbg (self, "unexpected port hangup!");
-        if (self->priv->response->len)
-            g_byte_array_remove_range (self->priv->response, 0, self->priv->response->len);
+        mm_serial_buffer_clear (self->priv->response);
         /* The completion of the commands with an error may end up fully disposing the
          * serial port object. In order to cope with that, we make sure we have
          * our own reference to the object while the close runs. */
@@ -955,8 +1158,7 @@ common_input_available (MMPortSerial *self,
     }
 
     if (condition & G_IO_ERR) {
-        if (self->priv->response->len)
-            g_byte_array_remove_range (self->priv->response, 0, self->priv->response->len);
+        mm_serial_buffer_clear (self->priv->response);
         return G_SOURCE_CONTINUE;
     }
 
@@ -1008,7 +1210,8 @@ common_input_available (MMPortSerial *self,
 
         g_assert (bytes_read > 0);
         serial_debug (self, "<--", buf, bytes_read);
-        g_byte_array_append (self->priv->response, (const guint8 *) buf, bytes_read);
+        serial_trace (self, MM_PORT_TRACE_RECORD_TYPE_RX, buf, bytes_read);
+        mm_serial_buffer_append (self->priv->response, (const guint8 *) buf, bytes_read);
 
         /* See if we can parse anything. The response parsing may actually
          * schedule the completion of a serial command, and that in turn may end
@@ -1019,10 +1222,10 @@ common_input_available (MMPortSerial *self,
         g_object_ref (self);
         {
             /* Make sure the response doesn't grow too long */
-            if ((self->priv->response->len > SERIAL_BUF_SIZE) && self->priv->spew_control) {
+            if ((mm_serial_buffer_get_length (self->priv->response) > SERIAL_BUF_SIZE) && self->priv->spew_control) {
                 /* Notify listeners and then trim the buffer */
                 g_signal_emit (self, signals[BUFFER_FULL], 0, self->priv->response);
-                g_byte_array_remove_range (self->priv->response, 0, (SERIAL_BUF_SIZE / 2));
+                mm_serial_buffer_consume (self->priv->response, (SERIAL_BUF_SIZE / 2));
             }
 
             parse_response_buffer (self);
@@ -1454,6 +1657,12 @@ _close_internal (MMPortSerial *self, gboolean force)
         self->priv->queue_id = 0;
     }
 
+    if (self->priv->late_reply_wait_id) {
+        g_source_remove (self->priv->late_reply_wait_id);
+        self->priv->late_reply_wait_id = 0;
+    }
+    self->priv->late_reply_seq = 0;
+
     if (self->priv->cancellable_id) {
         g_assert (self->priv->cancellable != NULL);
         g_cancellable_disconnect (self->priv->cancellable,
@@ -1899,54 +2108,15 @@ mm_port_serial_new (const char *name, MMPortType ptype)
                                          NULL));
 }
 
-static gboolean
-ba_equal (gconstpointer v1, gconstpointer v2)
-{
-    const GByteArray *a = v1;
-    const GByteArray *b = v2;
-
-    if (!a && b)
-        return -1;
-    else if (a && !b)
-        return 1;
-    else if (!a && !b)
-        return 0;
-
-    g_assert (a && b);
-    if (a->len < b->len)
-        return -1;
-    else if (a->len > b->len)
-        return 1;
-
-    g_assert (a->len == b->len);
-    return !memcmp (a->data, b->data, a->len);
-}
-
-static guint
-ba_hash (gconstpointer v)
-{
-    /* 31 bit hash function */
-    const GByteArray *array = v;
-    guint32 i, h = (const signed char) array->data[0];
-
-    for (i = 1; i < array->len; i++)
-        h = (h << 5) - h + (const signed char) array->data[i];
-
-    return h;
-}
-
-static void
-ba_free (gpointer v)
-{
-    g_byte_array_unref ((GByteArray *) v);
-}
-
 static void
 mm_port_serial_init (MMPortSerial *self)
 {
     self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self, MM_TYPE_PORT_SERIAL, MMPortSerialPrivate);
 
-    self->priv->reply_cache = g_hash_table_new_full (ba_hash, ba_equal, ba_free, ba_free);
+    self->priv->reply_cache = g_hash_table_new_full (g_bytes_hash,
+                                                     g_bytes_equal,
+                                                     (GDestroyNotify) g_bytes_unref,
+                                                     (GDestroyNotify) cached_reply_free);
 
     self->priv->fd = -1;
     self->priv->baud = 57600;
@@ -1957,7 +2127,7 @@ mm_port_serial_init (MMPortSerial *self)
     self->priv->send_delay = 1000;
 
     self->priv->queue = g_queue_new ();
-    self->priv->response = g_byte_array_sized_new (500);
+    self->priv->response = mm_serial_buffer_new (500);
 }
 
 static void
@@ -2064,8 +2234,11 @@ finalize (GObject *object)
     if (self->priv->queue_id)
         g_source_remove (self->priv->queue_id);
 
+    if (self->priv->late_reply_wait_id)
+        g_source_remove (self->priv->late_reply_wait_id);
+
     g_hash_table_destroy (self->priv->reply_cache);
-    g_byte_array_unref (self->priv->response);
+    mm_serial_buffer_free (self->priv->response);
     g_queue_free (self->priv->queue);
 
     G_OBJECT_CLASS (mm_port_serial_parent_class)->finalize (object);
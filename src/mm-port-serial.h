@@ -23,6 +23,7 @@
 
 #include "mm-modem-helpers.h"
 #include "mm-port.h"
+#include "mm-serial-buffer.h"
 
 #define MM_TYPE_PORT_SERIAL            (mm_port_serial_get_type ())
 #define MM_PORT_SERIAL(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), MM_TYPE_PORT_SERIAL, MMPortSerial))
@@ -41,6 +42,8 @@
 #define MM_PORT_SERIAL_SPEW_CONTROL "spew-control"
 #define MM_PORT_SERIAL_FLASH_OK     "flash-ok"
 
+#define MM_PORT_SERIAL_CACHED_REPLY_TTL_FOREVER G_MAXUINT
+
 typedef enum {
     MM_PORT_SERIAL_RESPONSE_NONE,
     MM_PORT_SERIAL_RESPONSE_BUFFER,
@@ -61,9 +64,9 @@ struct _MMPortSerialClass {
 
     /* Called for subclasses to parse unsolicited responses.  If any recognized
      * unsolicited response is found, it should be removed from the 'response'
-     * byte array before returning.
+     * buffer before returning.
      */
-    void     (*parse_unsolicited) (MMPortSerial *self, GByteArray *response);
+    void     (*parse_unsolicited) (MMPortSerial *self, MMSerialBuffer *response);
 
     /*
      * Called to parse the device's response to a command or determine if the
@@ -78,11 +81,11 @@ struct _MMPortSerialClass {
      * If there is no response, @MM_PORT_SERIAL_RESPONSE_NONE will be returned,
      * and neither @error nor @parsed_response will be set.
      *
-     * The implementation is allowed to cleanup the @response byte array, e.g. to
+     * The implementation is allowed to cleanup the @response buffer, e.g. to
      * just remove 1 single response if more than one found.
      */
     MMPortSerialResponseType (*parse_response) (MMPortSerial *self,
-                                                GByteArray *response,
+                                                MMSerialBuffer *response,
                                                 GByteArray **parsed_response,
                                                 GError **error);
 
@@ -100,8 +103,15 @@ struct _MMPortSerialClass {
                                    const gchar  *buf,
                                    gsize         len);
 
+    /* Called to get for how long the reply to a command may be given from
+     * the cache, in seconds. 0 disables caching for the command, and
+     * MM_PORT_SERIAL_CACHED_REPLY_TTL_FOREVER keeps the reply until the cache
+     * is explicitly cleared. If not given, replies never expire. */
+    guint (*get_cached_reply_ttl) (MMPortSerial     *self,
+                                   const GByteArray *command);
+
     /* Signals */
-    void (*buffer_full)           (MMPortSerial *port, const GByteArray *buffer);
+    void (*buffer_full)           (MMPortSerial *port, MMSerialBuffer *buffer);
     void (*forced_close)          (MMPortSerial *port);
 };
 
@@ -148,9 +158,17 @@ void        mm_port_serial_command        (MMPortSerial *self,
                                            GCancellable *cancellable,
                                            GAsyncReadyCallback callback,
                                            gpointer user_data);
-GByteArray *mm_port_serial_command_finish (MMPortSerial *self,
+GBytes     *mm_port_serial_command_finish (MMPortSerial *self,
                                            GAsyncResult *res,
                                            GError **error);
+/* Monotonic time at which the command was written to the port; 0 if it
+ * never was, e.g. when the reply was taken from the cache */
+gint64      mm_port_serial_command_get_send_time (MMPortSerial *self,
+                                                  GAsyncResult *res);
+
+/* Drop all cached replies, e.g. when the device state changes in a way
+ * that may change the reply to commands allowing cached replies */
+void        mm_port_serial_clear_cached_replies (MMPortSerial *self);
 
 gboolean mm_port_serial_set_flow_control (MMPortSerial   *self,
                                           MMFlowControl   flow_control,
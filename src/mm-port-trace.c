@@ -0,0 +1,272 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <ModemManager.h>
+#include <mm-errors-types.h>
+
+#include "mm-port-trace.h"
+
+#define TRACE_MAGIC          "MMTRACE"
+#define TRACE_MAGIC_SIZE     8
+#define TRACE_VERSION        1
+#define TRACE_FILE_HEADER    (TRACE_MAGIC_SIZE + 4)
+#define TRACE_RECORD_HEADER  16
+#define TRACE_BUFFER_SIZE    (64 * 1024)
+#define TRACE_FLUSH_TIMEOUT  1
+
+/*****************************************************************************/
+/* Capture */
+
+static FILE    *trace_file;
+static guint16  trace_last_port_id;
+static guint    trace_flush_id;
+
+gboolean
+mm_port_trace_is_enabled (void)
+{
+    return !!trace_file;
+}
+
+static void
+trace_write_header (gint64                timestamp,
+                    guint16               port_id,
+                    MMPortTraceRecordType type,
+                    MMPortTracePortType   port_type,
+                    guint32               length)
+{
+    guint8  header[TRACE_RECORD_HEADER];
+    guint64 timestamp_le;
+    guint16 port_id_le;
+    guint32 length_le;
+
+    timestamp_le = GUINT64_TO_LE ((guint64) timestamp);
+    port_id_le = GUINT16_TO_LE (port_id);
+    length_le = GUINT32_TO_LE (length);
+
+    memcpy (&header[0], &timestamp_le, 8);
+    memcpy (&header[8], &port_id_le, 2);
+    header[10] = (guint8) type;
+    header[11] = (guint8) port_type;
+    memcpy (&header[12], &length_le, 4);
+
+    fwrite (header, 1, sizeof (header), trace_file);
+}
+
+static gboolean
+trace_flush_cb (void)
+{
+    trace_flush_id = 0;
+    if (trace_file)
+        fflush (trace_file);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+trace_schedule_flush (void)
+{
+    /* Records are buffered, and written out at most a second later */
+    if (!trace_flush_id)
+        trace_flush_id = g_timeout_add_seconds (TRACE_FLUSH_TIMEOUT, (GSourceFunc) trace_flush_cb, NULL);
+}
+
+guint16
+mm_port_trace_register_port (const gchar         *name,
+                             MMPortTracePortType  port_type)
+{
+    gsize length;
+
+    if (!trace_file)
+        return 0;
+
+    /* Port id 0 is never used, so that it can be used as 'unregistered' */
+    if (trace_last_port_id == G_MAXUINT16)
+        return 0;
+    trace_last_port_id++;
+
+    length = strlen (name);
+    trace_write_header (g_get_monotonic_time (), trace_last_port_id, MM_PORT_TRACE_RECORD_TYPE_PORT, port_type, length);
+    fwrite (name, 1, length, trace_file);
+    trace_schedule_flush ();
+    return trace_last_port_id;
+}
+
+void
+mm_port_trace_record (guint16                port_id,
+                      MMPortTraceRecordType  type,
+                      const guint8          *data,
+                      gsize                  length)
+{
+    if (!trace_file || !port_id || !length)
+        return;
+
+    /* The port type is only given in the port announcement */
+    trace_write_header (g_get_monotonic_time (), port_id, type, 0, length);
+    fwrite (data, 1, length, trace_file);
+    trace_schedule_flush ();
+}
+
+gboolean
+mm_port_trace_open (const gchar  *path,
+                    GError      **error)
+{
+    guint32 version_le;
+
+    g_assert (!trace_file);
+
+    trace_file = fopen (path, "we");
+    if (!trace_file) {
+        g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
+                     "Couldn't open trace file: (%d) %s",
+                     errno, g_strerror (errno));
+        return FALSE;
+    }
+    setvbuf (trace_file, NULL, _IOFBF, TRACE_BUFFER_SIZE);
+
+    version_le = GUINT32_TO_LE (TRACE_VERSION);
+    fwrite (TRACE_MAGIC, 1, TRACE_MAGIC_SIZE, trace_file);
+    fwrite (&version_le, 1, sizeof (version_le), trace_file);
+    return TRUE;
+}
+
+void
+mm_port_trace_close (void)
+{
+    if (trace_flush_id) {
+        g_source_remove (trace_flush_id);
+        trace_flush_id = 0;
+    }
+    if (trace_file) {
+        fclose (trace_file);
+        trace_file = NULL;
+    }
+    trace_last_port_id = 0;
+}
+
+/*****************************************************************************/
+/* Capture reading */
+
+struct _MMPortTraceReader {
+    GMappedFile *mapped;
+    const guint8 *data;
+    gsize         size;
+    gsize         offset;
+    /* Port names, indexed by port id */
+    GHashTable   *port_names;
+};
+
+MMPortTraceReader *
+mm_port_trace_reader_new (const gchar  *path,
+                          GError      **error)
+{
+    MMPortTraceReader *self;
+    GMappedFile       *mapped;
+    const guint8      *data;
+    guint32            version;
+
+    mapped = g_mapped_file_new (path, FALSE, error);
+    if (!mapped)
+        return NULL;
+
+    data = (const guint8 *) g_mapped_file_get_contents (mapped);
+    if (g_mapped_file_get_length (mapped) < TRACE_FILE_HEADER ||
+        memcmp (data, TRACE_MAGIC, TRACE_MAGIC_SIZE) != 0) {
+        g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_INVALID_ARGS,
+                     "Not a trace file");
+        g_mapped_file_unref (mapped);
+        return NULL;
+    }
+
+    memcpy (&version, &data[TRACE_MAGIC_SIZE], sizeof (version));
+    version = GUINT32_FROM_LE (version);
+    if (version != TRACE_VERSION) {
+        g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_UNSUPPORTED,
+                     "Unsupported trace file version: %u", version);
+        g_mapped_file_unref (mapped);
+        return NULL;
+    }
+
+    self = g_new0 (MMPortTraceReader, 1);
+    self->mapped = mapped;
+    self->data = data;
+    self->size = g_mapped_file_get_length (mapped);
+    self->offset = TRACE_FILE_HEADER;
+    self->port_names = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+    return self;
+}
+
+void
+mm_port_trace_reader_free (MMPortTraceReader *self)
+{
+    g_hash_table_unref (self->port_names);
+    g_mapped_file_unref (self->mapped);
+    g_free (self);
+}
+
+gboolean
+mm_port_trace_reader_next (MMPortTraceReader  *self,
+                           MMPortTraceRecord  *out_record,
+                           GError            **error)
+{
+    const guint8 *header;
+    guint64       timestamp;
+    guint16       port_id;
+    guint32       length;
+
+    /* End of capture */
+    if (self->offset == self->size)
+        return FALSE;
+
+    if (self->size - self->offset < TRACE_RECORD_HEADER) {
+        g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
+                     "Truncated record header at offset %" G_GSIZE_FORMAT, self->offset);
+        return FALSE;
+    }
+
+    header = &self->data[self->offset];
+    memcpy (&timestamp, &header[0], 8);
+    memcpy (&port_id, &header[8], 2);
+    memcpy (&length, &header[12], 4);
+    length = GUINT32_FROM_LE (length);
+
+    if (self->size - self->offset - TRACE_RECORD_HEADER < length) {
+        g_set_error (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
+                     "Truncated record data at offset %" G_GSIZE_FORMAT, self->offset);
+        return FALSE;
+    }
+
+    out_record->timestamp = (gint64) GUINT64_FROM_LE (timestamp);
+    out_record->port_id = GUINT16_FROM_LE (port_id);
+    out_record->type = (MMPortTraceRecordType) header[10];
+    out_record->port_type = (MMPortTracePortType) header[11];
+    out_record->data = &header[TRACE_RECORD_HEADER];
+    out_record->length = length;
+    self->offset += TRACE_RECORD_HEADER + length;
+
+    if (out_record->type == MM_PORT_TRACE_RECORD_TYPE_PORT)
+        g_hash_table_replace (self->port_names,
+                              GUINT_TO_POINTER (out_record->port_id),
+                              g_strndup ((const gchar *) out_record->data, out_record->length));
+    return TRUE;
+}
+
+const gchar *
+mm_port_trace_reader_get_port_name (MMPortTraceReader *self,
+                                    guint16            port_id)
+{
+    return g_hash_table_lookup (self->port_names, GUINT_TO_POINTER (port_id));
+}
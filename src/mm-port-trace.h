@@ -0,0 +1,81 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_PORT_TRACE_H
+#define MM_PORT_TRACE_H
+
+#include <glib.h>
+
+/* Binary capture of the raw traffic exchanged with the modem ports.
+ *
+ * The capture file starts with the 8-byte "MMTRACE\0" magic followed by a
+ * little endian 32-bit format version. Then, a sequence of records, each
+ * one with a little endian header:
+ *   - 64-bit monotonic timestamp, in microseconds
+ *   - 16-bit port id
+ *   - 8-bit record type (MMPortTraceRecordType)
+ *   - 8-bit port type (MMPortTracePortType)
+ *   - 32-bit data length
+ * followed by the data itself. Ports are announced with a PORT record,
+ * whose data is the port name, before any traffic record for them. */
+
+typedef enum {
+    MM_PORT_TRACE_RECORD_TYPE_PORT = 0,
+    MM_PORT_TRACE_RECORD_TYPE_RX   = 1, /* from the modem */
+    MM_PORT_TRACE_RECORD_TYPE_TX   = 2, /* to the modem */
+} MMPortTraceRecordType;
+
+typedef enum {
+    MM_PORT_TRACE_PORT_TYPE_SERIAL = 0,
+    MM_PORT_TRACE_PORT_TYPE_QMI    = 1,
+    MM_PORT_TRACE_PORT_TYPE_MBIM   = 2,
+} MMPortTracePortType;
+
+typedef struct {
+    gint64                 timestamp;
+    guint16                port_id;
+    MMPortTraceRecordType  type;
+    MMPortTracePortType    port_type;
+    const guint8          *data;
+    gsize                  length;
+} MMPortTraceRecord;
+
+/* Capture, enabled globally */
+
+gboolean mm_port_trace_open          (const gchar            *path,
+                                      GError                **error);
+void     mm_port_trace_close         (void);
+gboolean mm_port_trace_is_enabled    (void);
+guint16  mm_port_trace_register_port (const gchar            *name,
+                                      MMPortTracePortType     port_type);
+void     mm_port_trace_record        (guint16                 port_id,
+                                      MMPortTraceRecordType   type,
+                                      const guint8           *data,
+                                      gsize                   length);
+
+/* Capture reading, for offline replay */
+
+typedef struct _MMPortTraceReader MMPortTraceReader;
+
+MMPortTraceReader *mm_port_trace_reader_new           (const gchar        *path,
+                                                       GError            **error);
+void               mm_port_trace_reader_free          (MMPortTraceReader  *self);
+gboolean           mm_port_trace_reader_next          (MMPortTraceReader  *self,
+                                                       MMPortTraceRecord  *out_record,
+                                                       GError            **error);
+const gchar       *mm_port_trace_reader_get_port_name (MMPortTraceReader  *self,
+                                                       guint16             port_id);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (MMPortTraceReader, mm_port_trace_reader_free)
+
+#endif /* MM_PORT_TRACE_H */
@@ -0,0 +1,336 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+
+#include <ModemManager.h>
+#include "mm-context.h"
+#include "mm-utils.h"
+#include "mm-log-object.h"
+#include "mm-keyfile-store.h"
+#include "mm-probe-cache.h"
+
+#define KEY_PLUGIN "plugin"
+
+/* Changes are written out at most every few seconds */
+#define SAVE_TIMEOUT 5
+
+static void log_object_iface_init (MMLogObjectInterface *iface);
+
+struct _MMProbeCache {
+    GObject         parent;
+    gchar          *path;
+    MMKeyfileStore *store;
+    GKeyFile       *keyfile;
+};
+
+struct _MMProbeCacheClass {
+    GObjectClass parent;
+};
+
+G_DEFINE_TYPE_EXTENDED (MMProbeCache, mm_probe_cache, G_TYPE_OBJECT, 0,
+                        G_IMPLEMENT_INTERFACE (MM_TYPE_LOG_OBJECT, log_object_iface_init))
+
+enum {
+    PROP_0,
+    PROP_PATH,
+    PROP_LAST
+};
+
+static GParamSpec *properties[PROP_LAST];
+
+/*****************************************************************************/
+
+static gchar *
+log_object_build_id (MMLogObject *_self)
+{
+    return g_strdup ("probe-cache");
+}
+
+/*****************************************************************************/
+
+static gchar *
+build_device_prefix (const gchar *physdev_uid)
+{
+    gchar *prefix;
+
+    /* Group names in key files cannot have brackets */
+    prefix = g_strdup_printf ("%s|", physdev_uid);
+    return g_strdelimit (prefix, "[]\n", '_');
+}
+
+static gchar *
+build_port_group (MMKernelDevice *port)
+{
+    g_autofree gchar *prefix = NULL;
+    const gchar      *physdev_uid;
+    gint              interface_number;
+    gchar            *group;
+
+    physdev_uid = mm_kernel_device_get_physdev_uid (port);
+    if (!physdev_uid)
+        return NULL;
+
+    prefix = build_device_prefix (physdev_uid);
+
+    /* The port name is only used when there is no interface number, e.g. in
+     * ports of non-USB devices; tty names are not stable across resets */
+    interface_number = mm_kernel_device_get_interface_number (port);
+    if (interface_number >= 0)
+        group = g_strdup_printf ("%s%04x:%04x:%04x|%s|%d",
+                                 prefix,
+                                 mm_kernel_device_get_physdev_vid (port),
+                                 mm_kernel_device_get_physdev_pid (port),
+                                 mm_kernel_device_get_physdev_revision (port),
+                                 mm_kernel_device_get_subsystem (port),
+                                 interface_number);
+    else
+        group = g_strdup_printf ("%s%04x:%04x:%04x|%s|%s",
+                                 prefix,
+                                 mm_kernel_device_get_physdev_vid (port),
+                                 mm_kernel_device_get_physdev_pid (port),
+                                 mm_kernel_device_get_physdev_revision (port),
+                                 mm_kernel_device_get_subsystem (port),
+                                 mm_kernel_device_get_name (port));
+    return g_strdelimit (group, "[]\n", '_');
+}
+
+/*****************************************************************************/
+
+gchar *
+mm_probe_cache_lookup_plugin (MMProbeCache   *self,
+                              MMKernelDevice *port)
+{
+    g_autofree gchar *group = NULL;
+
+    if (!self->keyfile)
+        return NULL;
+
+    group = build_port_group (port);
+    if (!group)
+        return NULL;
+
+    return g_key_file_get_string (self->keyfile, group, KEY_PLUGIN, NULL);
+}
+
+gboolean
+mm_probe_cache_load (MMProbeCache       *self,
+                     MMKernelDevice     *port,
+                     const gchar        *plugin_name,
+                     MMProbeCacheLoadFn  load,
+                     gpointer            probe)
+{
+    g_autofree gchar *group = NULL;
+    g_autofree gchar *cached_plugin_name = NULL;
+
+    if (!self->keyfile)
+        return FALSE;
+
+    group = build_port_group (port);
+    if (!group)
+        return FALSE;
+
+    /* Results are only valid for the plugin that managed the device, as the
+     * set of probings run depends on the plugin */
+    cached_plugin_name = g_key_file_get_string (self->keyfile, group, KEY_PLUGIN, NULL);
+    if (!cached_plugin_name || !g_str_equal (cached_plugin_name, plugin_name))
+        return FALSE;
+
+    return load (probe, self->keyfile, group);
+}
+
+guint
+mm_probe_cache_get_n_ports (MMProbeCache *self,
+                            const gchar  *device_uid)
+{
+    g_autofree gchar *prefix = NULL;
+    g_auto(GStrv)     groups = NULL;
+    guint             n_ports = 0;
+    guint             i;
+
+    if (!self->keyfile)
+        return 0;
+
+    prefix = build_device_prefix (device_uid);
+    groups = g_key_file_get_groups (self->keyfile, NULL);
+    for (i = 0; groups[i]; i++) {
+        if (g_str_has_prefix (groups[i], prefix))
+            n_ports++;
+    }
+
+    return n_ports;
+}
+
+static gboolean
+remove_device (MMProbeCache *self,
+               const gchar  *device_uid)
+{
+    g_autofree gchar *prefix = NULL;
+    g_auto(GStrv)     groups = NULL;
+    gboolean          removed = FALSE;
+    guint             i;
+
+    prefix = build_device_prefix (device_uid);
+    groups = g_key_file_get_groups (self->keyfile, NULL);
+    for (i = 0; groups[i]; i++) {
+        if (g_str_has_prefix (groups[i], prefix)) {
+            g_key_file_remove_group (self->keyfile, groups[i], NULL);
+            removed = TRUE;
+        }
+    }
+
+    return removed;
+}
+
+void
+mm_probe_cache_forget (MMProbeCache *self,
+                       const gchar  *device_uid)
+{
+    if (!self->keyfile)
+        return;
+
+    if (remove_device (self, device_uid)) {
+        mm_obj_dbg (self, "removed probing results of device %s", device_uid);
+        mm_keyfile_store_schedule_save (self->store, SAVE_TIMEOUT);
+    }
+}
+
+void
+mm_probe_cache_store (MMProbeCache           *self,
+                      const gchar            *device_uid,
+                      const gchar            *plugin_name,
+                      GList                  *probes,
+                      MMProbeCachePeekPortFn  peek_port,
+                      MMProbeCacheSaveFn      save)
+{
+    GList *l;
+
+    if (!self->keyfile)
+        return;
+
+    /* Drop whatever we had for the device, ports may have changed */
+    remove_device (self, device_uid);
+
+    for (l = probes; l; l = g_list_next (l)) {
+        g_autofree gchar *group = NULL;
+
+        group = build_port_group (peek_port (l->data));
+        if (!group)
+            continue;
+
+        g_key_file_set_string (self->keyfile, group, KEY_PLUGIN, plugin_name);
+        save (l->data, self->keyfile, group);
+    }
+
+    mm_obj_dbg (self, "stored probing results of device %s", device_uid);
+    mm_keyfile_store_schedule_save (self->store, SAVE_TIMEOUT);
+}
+
+/*****************************************************************************/
+
+static void
+mm_probe_cache_init (MMProbeCache *self)
+{
+}
+
+static void
+constructed (GObject *object)
+{
+    MMProbeCache *self = MM_PROBE_CACHE (object);
+
+    G_OBJECT_CLASS (mm_probe_cache_parent_class)->constructed (object);
+
+    if (!self->path) {
+        mm_obj_dbg (self, "disabled");
+        return;
+    }
+
+    self->store = mm_keyfile_store_new (self->path, "probe cache", self);
+    self->keyfile = mm_keyfile_store_peek_keyfile (self->store);
+}
+
+static void
+set_property (GObject      *object,
+              guint         prop_id,
+              const GValue *value,
+              GParamSpec   *pspec)
+{
+    MMProbeCache *self = MM_PROBE_CACHE (object);
+
+    switch (prop_id) {
+    case PROP_PATH:
+        g_free (self->path);
+        self->path = g_value_dup_string (value);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+get_property (GObject    *object,
+              guint       prop_id,
+              GValue     *value,
+              GParamSpec *pspec)
+{
+    MMProbeCache *self = MM_PROBE_CACHE (object);
+
+    switch (prop_id) {
+    case PROP_PATH:
+        g_value_set_string (value, self->path);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+finalize (GObject *object)
+{
+    MMProbeCache *self = MM_PROBE_CACHE (object);
+
+    g_clear_pointer (&self->store, mm_keyfile_store_free);
+    g_free (self->path);
+
+    G_OBJECT_CLASS (mm_probe_cache_parent_class)->finalize (object);
+}
+
+static void
+log_object_iface_init (MMLogObjectInterface *iface)
+{
+    iface->build_id = log_object_build_id;
+}
+
+static void
+mm_probe_cache_class_init (MMProbeCacheClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+    object_class->constructed  = constructed;
+    object_class->set_property = set_property;
+    object_class->get_property = get_property;
+    object_class->finalize     = finalize;
+
+    properties[PROP_PATH] =
+        g_param_spec_string (MM_PROBE_CACHE_PATH,
+                             "Path",
+                             "Path to the probe cache file",
+                             NULL,
+                             G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY);
+    g_object_class_install_property (object_class, PROP_PATH, properties[PROP_PATH]);
+}
+
+MM_DEFINE_SINGLETON_GETTER (MMProbeCache, mm_probe_cache_get, MM_TYPE_PROBE_CACHE,
+                            MM_PROBE_CACHE_PATH, mm_context_get_probe_cache ())
@@ -0,0 +1,78 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_PROBE_CACHE_H
+#define MM_PROBE_CACHE_H
+
+#include <config.h>
+#include <glib-object.h>
+
+#include "mm-kernel-device.h"
+
+#define MM_TYPE_PROBE_CACHE            (mm_probe_cache_get_type ())
+#define MM_PROBE_CACHE(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), MM_TYPE_PROBE_CACHE, MMProbeCache))
+#define MM_PROBE_CACHE_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass),  MM_TYPE_PROBE_CACHE, MMProbeCacheClass))
+#define MM_IS_PROBE_CACHE(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), MM_TYPE_PROBE_CACHE))
+#define MM_IS_PROBE_CACHE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),  MM_TYPE_PROBE_CACHE))
+#define MM_PROBE_CACHE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),  MM_TYPE_PROBE_CACHE, MMProbeCacheClass))
+
+#define MM_PROBE_CACHE_PATH "path" /* construct-only */
+
+typedef struct _MMProbeCache      MMProbeCache;
+typedef struct _MMProbeCacheClass MMProbeCacheClass;
+
+/* Port probing results kept across daemon restarts and device resets.
+ *
+ * Results are stored per port, keyed by the physical device UID, the
+ * VID/PID/revision of the device and the interface number (or port name
+ * if the interface number is unknown), along with the name of the plugin
+ * that ended up managing the device. The cache is only enabled if a file
+ * path is given with --probe-cache. Changes are written out after a few
+ * seconds, so that the results of several devices are written at once.
+ *
+ * The results themselves are written and read by the port probes, through
+ * the given callbacks, e.g. mm_port_probe_save_results() and
+ * mm_port_probe_load_results(). */
+
+typedef MMKernelDevice *(* MMProbeCachePeekPortFn) (gpointer     probe);
+typedef void            (* MMProbeCacheSaveFn)     (gpointer     probe,
+                                                    GKeyFile    *keyfile,
+                                                    const gchar *group);
+typedef gboolean        (* MMProbeCacheLoadFn)     (gpointer     probe,
+                                                    GKeyFile    *keyfile,
+                                                    const gchar *group);
+
+GType         mm_probe_cache_get_type (void);
+MMProbeCache *mm_probe_cache_get      (void);
+
+gchar    *mm_probe_cache_lookup_plugin (MMProbeCache           *self,
+                                        MMKernelDevice         *port);
+gboolean  mm_probe_cache_load          (MMProbeCache           *self,
+                                        MMKernelDevice         *port,
+                                        const gchar            *plugin_name,
+                                        MMProbeCacheLoadFn      load,
+                                        gpointer                probe);
+void      mm_probe_cache_store         (MMProbeCache           *self,
+                                        const gchar            *device_uid,
+                                        const gchar            *plugin_name,
+                                        GList                  *probes,
+                                        MMProbeCachePeekPortFn  peek_port,
+                                        MMProbeCacheSaveFn      save);
+void      mm_probe_cache_forget        (MMProbeCache           *self,
+                                        const gchar            *device_uid);
+guint     mm_probe_cache_get_n_ports   (MMProbeCache           *self,
+                                        const gchar            *device_uid);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (MMProbeCache, g_object_unref)
+
+#endif /* MM_PROBE_CACHE_H */
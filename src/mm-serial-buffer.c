@@ -0,0 +1,148 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <string.h>
+
+#include "mm-serial-buffer.h"
+
+struct _MMSerialBuffer {
+    guint8 *data;
+    gsize   allocated;
+    /* Read cursor */
+    gsize   start;
+    /* Pending bytes, from the read cursor */
+    gsize   len;
+    /* Changed whenever pending data is removed */
+    guint   generation;
+};
+
+MMSerialBuffer *
+mm_serial_buffer_new (gsize reserved_size)
+{
+    MMSerialBuffer *self;
+
+    self = g_slice_new0 (MMSerialBuffer);
+    self->allocated = MAX (reserved_size, 16);
+    self->data = g_malloc (self->allocated);
+    return self;
+}
+
+void
+mm_serial_buffer_free (MMSerialBuffer *self)
+{
+    if (!self)
+        return;
+    g_free (self->data);
+    g_slice_free (MMSerialBuffer, self);
+}
+
+guint8 *
+mm_serial_buffer_peek (MMSerialBuffer *self,
+                       gsize          *len)
+{
+    if (len)
+        *len = self->len;
+    return self->data + self->start;
+}
+
+gsize
+mm_serial_buffer_get_length (MMSerialBuffer *self)
+{
+    return self->len;
+}
+
+guint
+mm_serial_buffer_get_generation (MMSerialBuffer *self)
+{
+    return self->generation;
+}
+
+gsize
+mm_serial_buffer_get_allocated_size (MMSerialBuffer *self)
+{
+    return self->allocated;
+}
+
+void
+mm_serial_buffer_append (MMSerialBuffer *self,
+                         const guint8   *data,
+                         gsize           len)
+{
+    if (!len)
+        return;
+
+    if (self->start + self->len + len > self->allocated) {
+        /* Only move the pending data back to the start when at least as many
+         * bytes were already consumed, so that the cost of the memmove() is
+         * amortized; otherwise, grow. */
+        if ((self->start >= self->len) && (self->len + len <= self->allocated)) {
+            memmove (self->data, self->data + self->start, self->len);
+        } else {
+            guint8 *new_data;
+            gsize   new_allocated;
+
+            new_allocated = self->allocated * 2;
+            while (new_allocated < self->len + len)
+                new_allocated *= 2;
+
+            new_data = g_malloc (new_allocated);
+            memcpy (new_data, self->data + self->start, self->len);
+            g_free (self->data);
+            self->data = new_data;
+            self->allocated = new_allocated;
+        }
+        self->start = 0;
+    }
+
+    memcpy (self->data + self->start + self->len, data, len);
+    self->len += len;
+}
+
+void
+mm_serial_buffer_consume (MMSerialBuffer *self,
+                          gsize           len)
+{
+    g_assert (len <= self->len);
+
+    if (!len)
+        return;
+
+    self->generation++;
+    self->len -= len;
+    /* Rewind the cursor for free whenever the buffer gets empty */
+    self->start = self->len ? (self->start + len) : 0;
+}
+
+void
+mm_serial_buffer_truncate (MMSerialBuffer *self,
+                           gsize           len)
+{
+    g_assert (len <= self->len);
+
+    if (len == self->len)
+        return;
+
+    self->generation++;
+    self->len = len;
+    if (!self->len)
+        self->start = 0;
+}
+
+void
+mm_serial_buffer_clear (MMSerialBuffer *self)
+{
+    if (self->len)
+        self->generation++;
+    self->start = 0;
+    self->len = 0;
+}
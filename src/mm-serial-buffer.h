@@ -0,0 +1,52 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_SERIAL_BUFFER_H
+#define MM_SERIAL_BUFFER_H
+
+#include <glib.h>
+
+/* Input buffer for serial ports.
+ *
+ * Data is appended at the end and consumed from the beginning. Consuming data
+ * just moves a read cursor, the pending data is only moved back to the start
+ * of the allocated memory when more room is needed, so that removing a
+ * processed prefix doesn't require a memmove() of the whole buffer each time.
+ * The pending data is always available as a single contiguous chunk.
+ *
+ * The generation changes whenever pending data is removed, so that users can
+ * tell whether the pending data only grew since they last looked at it.
+ */
+typedef struct _MMSerialBuffer MMSerialBuffer;
+
+MMSerialBuffer *mm_serial_buffer_new                (gsize           reserved_size);
+void            mm_serial_buffer_free               (MMSerialBuffer *self);
+
+guint8         *mm_serial_buffer_peek               (MMSerialBuffer *self,
+                                                     gsize          *len);
+gsize           mm_serial_buffer_get_length         (MMSerialBuffer *self);
+gsize           mm_serial_buffer_get_allocated_size (MMSerialBuffer *self);
+guint           mm_serial_buffer_get_generation     (MMSerialBuffer *self);
+
+void            mm_serial_buffer_append             (MMSerialBuffer *self,
+                                                     const guint8   *data,
+                                                     gsize           len);
+void            mm_serial_buffer_consume            (MMSerialBuffer *self,
+                                                     gsize           len);
+void            mm_serial_buffer_truncate           (MMSerialBuffer *self,
+                                                     gsize           len);
+void            mm_serial_buffer_clear              (MMSerialBuffer *self);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (MMSerialBuffer, mm_serial_buffer_free)
+
+#endif /* MM_SERIAL_BUFFER_H */
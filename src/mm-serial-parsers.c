@@ -98,8 +98,384 @@ typedef struct {
     /* User-provided parser filter */
     mm_serial_parser_v1_filter_fn filter_callback;
     gpointer                      filter_user_data;
+    /* Single-pass classifier, used unless custom regexes are given */
+    gboolean  fast_classifier;
+    /* Length of the response last scanned without finding a result code,
+     * and where to resume scanning it once it grows */
+    gsize     scanned_len;
+    gsize     scanned_resume;
 } MMSerialParserV1;
 
+/*****************************************************************************/
+/* Single-pass final result code classifier
+ *
+ * Instead of running one regex per result code type over the whole response,
+ * the response is split in <CR><LF>-delimited lines once, and each line is
+ * classified by its leading characters. The classification is equivalent to
+ * the one done by the default regexes: when several result codes are found,
+ * the one with the highest precedence (lowest ResultCode value) is reported,
+ * and for each type the first occurrence in the response is used.
+ *
+ * The default regexes for unknown errors and connection failures are not
+ * anchored to whole lines, as the alternation takes precedence over the
+ * surrounding <CR><LF>. Those result codes are looked for as plain strings
+ * anywhere in the response instead of line by line.
+ */
+
+typedef enum {
+    /* Successful replies */
+    RESULT_CODE_OK,
+    RESULT_CODE_CONNECT,
+    RESULT_CODE_SMS_PROMPT,
+    /* Error replies */
+    RESULT_CODE_CME_ERROR,
+    RESULT_CODE_CMS_ERROR,
+    RESULT_CODE_CME_ERROR_STR,
+    RESULT_CODE_CMS_ERROR_STR,
+    RESULT_CODE_EZX_ERROR,
+    RESULT_CODE_UNKNOWN_ERROR,
+    RESULT_CODE_CONNECT_FAILED,
+    RESULT_CODE_NA,
+    RESULT_CODE_NONE,
+} ResultCode;
+
+typedef struct {
+    ResultCode code;
+    /* Position of the error string or number in the response */
+    gsize      arg_start;
+    gsize      arg_len;
+} ResultMatch;
+
+typedef struct {
+    const gchar *str;
+    gsize        len;
+    ResultCode   code;
+} UnanchoredResultCode;
+
+#define UNANCHORED_RESULT_CODE(str, code) { str, sizeof (str) - 1, code }
+
+/* Same alternatives as in the unknown error and connection failure regexes */
+static const UnanchoredResultCode unanchored_result_codes[] = {
+    UNANCHORED_RESULT_CODE ("\r\nERROR",               RESULT_CODE_UNKNOWN_ERROR),
+    UNANCHORED_RESULT_CODE ("COMMAND NOT SUPPORT\r\n", RESULT_CODE_UNKNOWN_ERROR),
+    UNANCHORED_RESULT_CODE ("\r\nNO CARRIER",          RESULT_CODE_CONNECT_FAILED),
+    UNANCHORED_RESULT_CODE ("BUSY",                    RESULT_CODE_CONNECT_FAILED),
+    UNANCHORED_RESULT_CODE ("NO ANSWER",               RESULT_CODE_CONNECT_FAILED),
+    UNANCHORED_RESULT_CODE ("NO DIALTONE\r\n",         RESULT_CODE_CONNECT_FAILED),
+};
+
+#define LINE_HAS_PREFIX(line, len, prefix) \
+    ((len) >= (sizeof (prefix) - 1) && memcmp ((line), (prefix), sizeof (prefix) - 1) == 0)
+
+#define LINE_IS(line, len, value) \
+    ((len) == (sizeof (value) - 1) && memcmp ((line), (value), sizeof (value) - 1) == 0)
+
+static ResultCode
+classify_error_argument (const gchar *line,
+                         gsize        len,
+                         gsize        prefix_len,
+                         ResultCode   numeric_code,
+                         ResultCode   string_code,
+                         gsize       *arg_start,
+                         gsize       *arg_len)
+{
+    gsize i;
+
+    /* Numeric error: optional whitespaces followed by digits only */
+    for (i = prefix_len; i < len && g_ascii_isspace (line[i]); i++);
+    if (i < len) {
+        gsize j;
+
+        for (j = i; j < len && g_ascii_isdigit (line[j]); j++);
+        if (j == len) {
+            *arg_start = i;
+            *arg_len = len - i;
+            return numeric_code;
+        }
+    }
+
+    if (string_code == RESULT_CODE_NONE || prefix_len == len)
+        return RESULT_CODE_NONE;
+
+    /* String error: whitespaces skipped, but at least one char must be left */
+    for (i = prefix_len; i < (len - 1) && g_ascii_isspace (line[i]); i++);
+    *arg_start = i;
+    *arg_len = len - i;
+    return string_code;
+}
+
+static ResultCode
+classify_line (const gchar *line,
+               gsize        len,
+               gboolean     complete,
+               gsize       *arg_start,
+               gsize       *arg_len)
+{
+    *arg_start = 0;
+    *arg_len = 0;
+
+    switch (len ? line[0] : '\0') {
+    case 'O':
+        if (complete && LINE_IS (line, len, "OK"))
+            return RESULT_CODE_OK;
+        break;
+    case 'C':
+        if (complete && LINE_HAS_PREFIX (line, len, "CONNECT"))
+            return RESULT_CODE_CONNECT;
+        break;
+    case '+':
+        if (complete && LINE_HAS_PREFIX (line, len, "+CME ERROR:"))
+            return classify_error_argument (line, len, strlen ("+CME ERROR:"),
+                                            RESULT_CODE_CME_ERROR, RESULT_CODE_CME_ERROR_STR,
+                                            arg_start, arg_len);
+        if (complete && LINE_HAS_PREFIX (line, len, "+CMS ERROR:"))
+            return classify_error_argument (line, len, strlen ("+CMS ERROR:"),
+                                            RESULT_CODE_CMS_ERROR, RESULT_CODE_CMS_ERROR_STR,
+                                            arg_start, arg_len);
+        break;
+    case 'M':
+        if (complete && LINE_HAS_PREFIX (line, len, "MODEM ERROR:"))
+            return classify_error_argument (line, len, strlen ("MODEM ERROR:"),
+                                            RESULT_CODE_EZX_ERROR, RESULT_CODE_NONE,
+                                            arg_start, arg_len);
+        break;
+    case 'N':
+        /* Samsung Z810 may reply "NA" to report a not-available error */
+        if (complete && LINE_IS (line, len, "NA"))
+            return RESULT_CODE_NA;
+        break;
+    default:
+        break;
+    }
+
+    return RESULT_CODE_NONE;
+}
+
+static void
+scan_unanchored_result_codes (const gchar *str,
+                              gsize        len,
+                              gsize        from,
+                              ResultMatch *match)
+{
+    gsize pos;
+
+    for (pos = from; pos < len && match->code > RESULT_CODE_UNKNOWN_ERROR; pos++) {
+        guint i;
+
+        if (!strchr ("\rCBN", str[pos]))
+            continue;
+
+        for (i = 0; i < G_N_ELEMENTS (unanchored_result_codes); i++) {
+            const UnanchoredResultCode *result_code = &unanchored_result_codes[i];
+
+            /* Only the first occurrence of each type is used */
+            if (result_code->code < match->code &&
+                result_code->len <= len - pos &&
+                memcmp (str + pos, result_code->str, result_code->len) == 0) {
+                match->code = result_code->code;
+                match->arg_start = 0;
+                match->arg_len = 0;
+                break;
+            }
+        }
+    }
+}
+
+static const gchar *
+find_line_delimiter (const gchar *str,
+                     gsize        len,
+                     gsize        from)
+{
+    while (from + 1 < len) {
+        const gchar *p;
+
+        p = memchr (str + from, '\r', len - from - 1);
+        if (!p)
+            return NULL;
+        if (p[1] == '\n')
+            return p;
+        from = (p - str) + 1;
+    }
+    return NULL;
+}
+
+/* Returns the offset from which the next scan over the same (grown) response
+ * should start, i.e. the offset of the last line delimiter found. */
+static gsize
+scan_result_code (const gchar *str,
+                  gsize        len,
+                  gsize        from,
+                  ResultMatch *match)
+{
+    const gchar *delimiter;
+    gsize        resume = from;
+
+    match->code = RESULT_CODE_NONE;
+
+    delimiter = find_line_delimiter (str, len, from);
+    while (delimiter) {
+        const gchar *line;
+        const gchar *next;
+        gsize        line_len;
+        ResultCode   code;
+        gsize        arg_start;
+        gsize        arg_len;
+
+        resume = delimiter - str;
+        line = delimiter + 2;
+        next = find_line_delimiter (str, len, line - str);
+        line_len = next ? (gsize)(next - line) : (gsize)(str + len - line);
+
+        code = classify_line (line, line_len, !!next, &arg_start, &arg_len);
+        if (code < match->code) {
+            match->code = code;
+            match->arg_start = (line - str) + arg_start;
+            match->arg_len = arg_len;
+            /* Nothing takes precedence over OK */
+            if (code == RESULT_CODE_OK)
+                break;
+        }
+        delimiter = next;
+    }
+
+    if (match->code > RESULT_CODE_UNKNOWN_ERROR)
+        scan_unanchored_result_codes (str, len, from, match);
+
+    /* The SMS prompt is only valid at the end of the response */
+    if (match->code > RESULT_CODE_SMS_PROMPT) {
+        gsize i = len;
+
+        while (i > 0 && g_ascii_isspace (str[i - 1]))
+            i--;
+        if (i >= 3 && str[i - 1] == '>' && str[i - 2] == '\n' && str[i - 3] == '\r')
+            match->code = RESULT_CODE_SMS_PROMPT;
+    }
+
+    return resume;
+}
+
+/* Equivalent to removing all matches of "\r\nOK(\r\n)+" */
+static void
+remove_ok_matches (GString *response)
+{
+    gchar *str = response->str;
+    gsize  len = response->len;
+    gsize  pos = 0;
+    gsize  r = 0;
+    gsize  w = 0;
+
+    while (pos + 6 <= len) {
+        const gchar *p;
+
+        p = memchr (str + pos, '\r', len - pos);
+        if (!p)
+            break;
+        pos = p - str;
+        if (pos + 6 > len || memcmp (p, "\r\nOK\r\n", 6) != 0) {
+            pos++;
+            continue;
+        }
+
+        if (w != r)
+            memmove (str + w, str + r, pos - r);
+        w += pos - r;
+
+        pos += 6;
+        while (pos + 2 <= len && str[pos] == '\r' && str[pos + 1] == '\n')
+            pos += 2;
+        r = pos;
+    }
+
+    if (w != r)
+        memmove (str + w, str + r, len - r);
+    w += len - r;
+    g_string_truncate (response, w);
+}
+
+static GError *
+result_match_build_error (const ResultMatch *match,
+                          GString           *response,
+                          gpointer           log_object)
+{
+    g_autofree gchar *str = NULL;
+
+    switch (match->code) {
+    case RESULT_CODE_CME_ERROR:
+        return mm_mobile_equipment_error_for_code (atoi (response->str + match->arg_start), log_object);
+    case RESULT_CODE_CMS_ERROR:
+        return mm_message_error_for_code (atoi (response->str + match->arg_start), log_object);
+    case RESULT_CODE_CME_ERROR_STR:
+        str = g_strndup (response->str + match->arg_start, match->arg_len);
+        return mm_mobile_equipment_error_for_string (str, log_object);
+    case RESULT_CODE_CMS_ERROR_STR:
+        str = g_strndup (response->str + match->arg_start, match->arg_len);
+        return mm_message_error_for_string (str, log_object);
+    case RESULT_CODE_EZX_ERROR:
+    case RESULT_CODE_UNKNOWN_ERROR:
+        return mm_mobile_equipment_error_for_code (MM_MOBILE_EQUIPMENT_ERROR_UNKNOWN, log_object);
+    case RESULT_CODE_CONNECT_FAILED:
+        /* As the default regex does, which only captures NO CARRIER */
+        return mm_connection_error_for_code (MM_CONNECTION_ERROR_NO_CARRIER, log_object);
+    case RESULT_CODE_NA:
+        /* Assume NA means 'Not Allowed' :) */
+        return g_error_new (MM_MOBILE_EQUIPMENT_ERROR,
+                            MM_MOBILE_EQUIPMENT_ERROR_NOT_ALLOWED,
+                            "Not Allowed");
+    case RESULT_CODE_OK:
+    case RESULT_CODE_CONNECT:
+    case RESULT_CODE_SMS_PROMPT:
+    case RESULT_CODE_NONE:
+    default:
+        break;
+    }
+
+    g_assert_not_reached ();
+    return NULL;
+}
+
+static gboolean
+parse_fast (MMSerialParserV1  *parser,
+            GString           *response,
+            gpointer           log_object,
+            GError           **error)
+{
+    ResultMatch  match;
+    GError      *local_error;
+    gsize        from = 0;
+
+    /* Unless the parser was reset, the response only grew since the last time
+     * we tried to parse it, so we can skip all the lines we already know
+     * don't have a result code. */
+    if (parser->scanned_len && parser->scanned_len <= response->len)
+        from = parser->scanned_resume;
+
+    parser->scanned_resume = scan_result_code (response->str, response->len, from, &match);
+
+    if (match.code == RESULT_CODE_NONE) {
+        parser->scanned_len = response->len;
+        return FALSE;
+    }
+
+    parser->scanned_len = 0;
+    parser->scanned_resume = 0;
+
+    if (match.code <= RESULT_CODE_SMS_PROMPT) {
+        if (match.code == RESULT_CODE_OK)
+            remove_ok_matches (response);
+        response_clean (response);
+        return TRUE;
+    }
+
+    local_error = result_match_build_error (&match, response, log_object);
+    response_clean (response);
+
+    mm_obj_dbg (log_object, "operation failure: %d (%s)", local_error->code, local_error->message);
+    g_propagate_error (error, local_error);
+    return TRUE;
+}
+
+/*****************************************************************************/
+
 gpointer
 mm_serial_parser_v1_new (void)
 {
@@ -126,6 +502,10 @@ mm_serial_parser_v1_new (void)
     parser->filter_callback = NULL;
     parser->filter_user_data = NULL;
 
+    parser->fast_classifier = TRUE;
+    parser->scanned_len = 0;
+    parser->scanned_resume = 0;
+
     return parser;
 }
 
@@ -147,6 +527,29 @@ mm_serial_parser_v1_set_custom_regex (gpointer data,
     parser->regex_custom_error = error ? g_regex_ref (error) : NULL;
 }
 
+void
+mm_serial_parser_v1_set_fast_classifier (gpointer data,
+                                         gboolean enable)
+{
+    MMSerialParserV1 *parser = (MMSerialParserV1 *) data;
+
+    g_return_if_fail (parser != NULL);
+
+    parser->fast_classifier = enable;
+    mm_serial_parser_v1_reset (parser);
+}
+
+void
+mm_serial_parser_v1_reset (gpointer data)
+{
+    MMSerialParserV1 *parser = (MMSerialParserV1 *) data;
+
+    g_return_if_fail (parser != NULL);
+
+    parser->scanned_len = 0;
+    parser->scanned_resume = 0;
+}
+
 void
 mm_serial_parser_v1_add_filter (gpointer data,
                                 mm_serial_parser_v1_filter_fn callback,
@@ -195,6 +598,13 @@ mm_serial_parser_v1_parse (gpointer   data,
         return TRUE;
     }
 
+    /* Custom regexes may override the default ones in any way, so the
+     * single-pass classifier is only used when there are none. */
+    if (parser->fast_classifier &&
+        !parser->regex_custom_successful &&
+        !parser->regex_custom_error)
+        return parse_fast (parser, response, log_object, error);
+
     /* Then, check for successful responses */
 
     /* Custom successful replies first, if any */
@@ -22,10 +22,15 @@ gpointer mm_serial_parser_v1_new                  (void);
 void     mm_serial_parser_v1_set_custom_regex     (gpointer data,
                                                    GRegex *successful,
                                                    GRegex *error);
+void     mm_serial_parser_v1_set_fast_classifier  (gpointer data,
+                                                   gboolean enable);
 gboolean mm_serial_parser_v1_parse                (gpointer parser,
                                                    GString *response,
                                                    gpointer log_object,
                                                    GError **error);
+/* Responses are expected to only grow between parse attempts; the parser must
+ * be reset before parsing any other response */
+void     mm_serial_parser_v1_reset                (gpointer parser);
 void     mm_serial_parser_v1_destroy              (gpointer parser);
 gboolean mm_serial_parser_v1_is_known_error       (const GError *error);
 
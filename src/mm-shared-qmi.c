@@ -3702,6 +3702,14 @@ uim_refresh_indication_cb (QmiClientUim                  *client,
      * we start a timer at 'start' stage and if it expires, the SIM change
      * check is triggered anyway. */
     if (stage == QMI_UIM_REFRESH_STAGE_START) {
+        g_autoptr(MMBaseSim) sim = NULL;
+
+        /* Whatever the mode, files in the card are being updated, so the
+         * cached contents of the SIM are no longer valid */
+        g_object_get (self, MM_IFACE_MODEM_SIM, &sim, NULL);
+        if (sim)
+            mm_base_sim_forget_cached_contents (sim);
+
         if (mode == QMI_UIM_REFRESH_MODE_RESET || mode == QMI_UIM_REFRESH_MODE_INIT_FULL_FCN) {
             if (!priv->uim_refresh_start_timeout_id)
                 priv->uim_refresh_start_timeout_id = g_timeout_add_seconds (REFRESH_START_TIMEOUT_SECS,
@@ -0,0 +1,217 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+
+#include "mm-log-object.h"
+#include "mm-shared-request.h"
+
+struct _MMSharedRequest {
+    gpointer                       source;
+    MMSharedRequestLoadFn          load;
+    MMSharedRequestLoadFinishFn    load_finish;
+    guint                          cache_time_ms;
+    MMSharedRequestCacheChangedFn  cache_changed;
+    /* Requests waiting for the ongoing load */
+    GList                         *pending;
+    gboolean                       loading;
+    /* Bumped when invalidated, so that the result of a load started
+     * before is dropped */
+    guint                          generation;
+    /* Last result, when it was obtained (monotonic), and the timeout to
+     * clear it */
+    GVariant                      *cached;
+    gint64                         cached_time;
+    guint                          cache_expiry_id;
+};
+
+typedef struct {
+    MMSharedRequest *self;
+    guint            generation;
+} LoadContext;
+
+/*****************************************************************************/
+
+static void
+cache_clear (MMSharedRequest *self)
+{
+    if (self->cache_expiry_id) {
+        g_source_remove (self->cache_expiry_id);
+        self->cache_expiry_id = 0;
+    }
+
+    if (!self->cached)
+        return;
+
+    g_clear_pointer (&self->cached, g_variant_unref);
+    self->cached_time = 0;
+    if (self->cache_changed)
+        self->cache_changed (self->source, 0);
+}
+
+static gboolean
+cache_expired (MMSharedRequest *self)
+{
+    self->cache_expiry_id = 0;
+    mm_obj_dbg (self->source, "cached result expired");
+    cache_clear (self);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+cache_set (MMSharedRequest *self,
+           GVariant        *result)
+{
+    if (!self->cache_time_ms)
+        return;
+
+    cache_clear (self);
+    self->cached = g_variant_ref (result);
+    self->cached_time = g_get_monotonic_time ();
+    self->cache_expiry_id = g_timeout_add (self->cache_time_ms, (GSourceFunc) cache_expired, self);
+    if (self->cache_changed)
+        self->cache_changed (self->source, g_get_real_time ());
+}
+
+/*****************************************************************************/
+
+GVariant *
+mm_shared_request_run_finish (GAsyncResult  *res,
+                              GError       **error)
+{
+    return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+static void
+load_ready (GObject      *source,
+            GAsyncResult *res,
+            LoadContext  *ctx)
+{
+    MMSharedRequest     *self;
+    guint                generation;
+    g_autoptr(GVariant)  result = NULL;
+    g_autoptr(GError)    error = NULL;
+    GList               *pending;
+    GList               *l;
+
+    self = ctx->self;
+    generation = ctx->generation;
+    g_slice_free (LoadContext, ctx);
+
+    result = self->load_finish (self->source, res, &error);
+
+    /* The requests waiting for this load were already completed */
+    if (generation != self->generation) {
+        mm_obj_dbg (self->source, "dropping result of a load started before invalidating");
+        return;
+    }
+
+    self->loading = FALSE;
+    pending = g_steal_pointer (&self->pending);
+
+    if (result)
+        cache_set (self, result);
+
+    for (l = pending; l; l = g_list_next (l)) {
+        GTask *task = l->data;
+
+        if (result)
+            g_task_return_pointer (task, g_variant_ref (result), (GDestroyNotify) g_variant_unref);
+        else
+            g_task_return_error (task, g_error_copy (error));
+    }
+    g_list_free_full (pending, g_object_unref);
+}
+
+void
+mm_shared_request_run (MMSharedRequest     *self,
+                       GAsyncReadyCallback  callback,
+                       gpointer             user_data)
+{
+    GTask       *task;
+    LoadContext *ctx;
+
+    task = g_task_new (self->source, NULL, callback, user_data);
+
+    if (self->cached) {
+        mm_obj_dbg (self->source, "reusing result obtained %" G_GINT64_FORMAT "ms ago",
+                    (g_get_monotonic_time () - self->cached_time) / 1000);
+        g_task_return_pointer (task, g_variant_ref (self->cached), (GDestroyNotify) g_variant_unref);
+        g_object_unref (task);
+        return;
+    }
+
+    self->pending = g_list_append (self->pending, task);
+    if (self->loading) {
+        mm_obj_dbg (self->source, "load already ongoing, waiting for its result");
+        return;
+    }
+
+    self->loading = TRUE;
+    ctx = g_slice_new (LoadContext);
+    ctx->self = self;
+    ctx->generation = self->generation;
+    self->load (self->source, (GAsyncReadyCallback) load_ready, ctx);
+}
+
+void
+mm_shared_request_invalidate (MMSharedRequest *self,
+                              const GError    *error)
+{
+    GList *pending;
+    GList *l;
+
+    self->generation++;
+    self->loading = FALSE;
+
+    pending = g_steal_pointer (&self->pending);
+    for (l = pending; l; l = g_list_next (l))
+        g_task_return_error (G_TASK (l->data), g_error_copy (error));
+    g_list_free_full (pending, g_object_unref);
+
+    cache_clear (self);
+}
+
+/*****************************************************************************/
+
+MMSharedRequest *
+mm_shared_request_new (gpointer                       source,
+                       MMSharedRequestLoadFn          load,
+                       MMSharedRequestLoadFinishFn    load_finish,
+                       guint                          cache_time_ms,
+                       MMSharedRequestCacheChangedFn  cache_changed)
+{
+    MMSharedRequest *self;
+
+    g_assert (load && load_finish);
+
+    self = g_slice_new0 (MMSharedRequest);
+    self->source = source;
+    self->load = load;
+    self->load_finish = load_finish;
+    self->cache_time_ms = cache_time_ms;
+    self->cache_changed = cache_changed;
+    return self;
+}
+
+void
+mm_shared_request_free (MMSharedRequest *self)
+{
+    /* Pending requests keep the source alive */
+    g_assert (!self->pending);
+
+    if (self->cache_expiry_id)
+        g_source_remove (self->cache_expiry_id);
+    g_clear_pointer (&self->cached, g_variant_unref);
+    g_slice_free (MMSharedRequest, self);
+}
@@ -0,0 +1,63 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_SHARED_REQUEST_H
+#define MM_SHARED_REQUEST_H
+
+#include <glib.h>
+#include <gio/gio.h>
+
+/* Expensive query shared by all the requests for it, e.g. a network scan.
+ *
+ * Requests received while a load is ongoing wait for it, and are all
+ * completed with its result. If a cache time is given, the last result is
+ * also reused for the requests received within that time; the cache
+ * changed callback is called when a result is cached, with the real time
+ * when it was obtained, and when it is cleared, with 0.
+ *
+ * Invalidating fails the requests waiting for the ongoing load with the
+ * given error, clears the cache, and drops the result of the ongoing load
+ * when it arrives.
+ *
+ * The GTasks of the requests use the given source object, which is not
+ * referenced by the MMSharedRequest itself, and which must outlive any
+ * load.
+ */
+typedef struct _MMSharedRequest MMSharedRequest;
+
+typedef void      (* MMSharedRequestLoadFn)         (gpointer              source,
+                                                     GAsyncReadyCallback   callback,
+                                                     gpointer              user_data);
+typedef GVariant *(* MMSharedRequestLoadFinishFn)   (gpointer              source,
+                                                     GAsyncResult         *res,
+                                                     GError              **error);
+typedef void      (* MMSharedRequestCacheChangedFn) (gpointer              source,
+                                                     gint64                cached_time);
+
+MMSharedRequest *mm_shared_request_new        (gpointer                        source,
+                                               MMSharedRequestLoadFn           load,
+                                               MMSharedRequestLoadFinishFn     load_finish,
+                                               guint                           cache_time_ms,
+                                               MMSharedRequestCacheChangedFn   cache_changed);
+void             mm_shared_request_free       (MMSharedRequest                *self);
+
+void             mm_shared_request_run        (MMSharedRequest                *self,
+                                               GAsyncReadyCallback             callback,
+                                               gpointer                        user_data);
+GVariant        *mm_shared_request_run_finish (GAsyncResult                   *res,
+                                               GError                        **error);
+
+void             mm_shared_request_invalidate (MMSharedRequest                *self,
+                                               const GError                   *error);
+
+#endif /* MM_SHARED_REQUEST_H */
@@ -0,0 +1,370 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+
+#include <ModemManager.h>
+#include "mm-context.h"
+#include "mm-utils.h"
+#include "mm-log-object.h"
+#include "mm-keyfile-store.h"
+#include "mm-sim-cache.h"
+
+#define KEY_LAST_USED "last-used"
+
+/* Number of SIM cards remembered */
+#define MAX_ENTRIES 16
+
+static void log_object_iface_init (MMLogObjectInterface *iface);
+
+struct _MMSimCache {
+    GObject         parent;
+    gchar          *path;
+    MMKeyfileStore *store;
+    GKeyFile       *keyfile;
+};
+
+struct _MMSimCacheClass {
+    GObjectClass parent;
+};
+
+G_DEFINE_TYPE_EXTENDED (MMSimCache, mm_sim_cache, G_TYPE_OBJECT, 0,
+                        G_IMPLEMENT_INTERFACE (MM_TYPE_LOG_OBJECT, log_object_iface_init))
+
+enum {
+    PROP_0,
+    PROP_PATH,
+    PROP_LAST
+};
+
+static GParamSpec *properties[PROP_LAST];
+
+/* SIM properties kept in the cache, stored with the same key names */
+typedef enum {
+    CACHED_PROPERTY_STRING,
+    CACHED_PROPERTY_STRV,
+    CACHED_PROPERTY_VARIANT,
+} CachedPropertyType;
+
+typedef struct {
+    const gchar        *name;
+    CachedPropertyType  type;
+    const gchar        *variant_type;
+} CachedProperty;
+
+static const CachedProperty cached_properties[] = {
+    { "imsi",                CACHED_PROPERTY_STRING,  NULL    },
+    { "eid",                 CACHED_PROPERTY_STRING,  NULL    },
+    { "operator-identifier", CACHED_PROPERTY_STRING,  NULL    },
+    { "operator-name",       CACHED_PROPERTY_STRING,  NULL    },
+    { "emergency-numbers",   CACHED_PROPERTY_STRV,    NULL    },
+    { "preferred-networks",  CACHED_PROPERTY_VARIANT, "a(su)" },
+    { "gid1",                CACHED_PROPERTY_VARIANT, "ay"    },
+    { "gid2",                CACHED_PROPERTY_VARIANT, "ay"    },
+};
+
+/*****************************************************************************/
+
+static gchar *
+log_object_build_id (MMLogObject *_self)
+{
+    return g_strdup ("sim-cache");
+}
+
+/*****************************************************************************/
+
+static gchar *
+build_group (MMSimCache  *self,
+             const gchar *sim_identifier)
+{
+    if (!self->keyfile || !sim_identifier || !sim_identifier[0])
+        return NULL;
+
+    /* Group names in key files cannot have brackets */
+    return g_strdelimit (g_strdup (sim_identifier), "[]\n", '_');
+}
+
+static void
+sim_cache_prune (MMSimCache *self)
+{
+    g_auto(GStrv) groups = NULL;
+    gsize         n_groups = 0;
+
+    groups = g_key_file_get_groups (self->keyfile, &n_groups);
+    while (n_groups > MAX_ENTRIES) {
+        const gchar *oldest = NULL;
+        gint64       oldest_last_used = G_MAXINT64;
+        guint        i;
+
+        for (i = 0; groups[i]; i++) {
+            gint64 last_used;
+
+            if (!g_key_file_has_group (self->keyfile, groups[i]))
+                continue;
+            last_used = g_key_file_get_int64 (self->keyfile, groups[i], KEY_LAST_USED, NULL);
+            if (last_used < oldest_last_used) {
+                oldest = groups[i];
+                oldest_last_used = last_used;
+            }
+        }
+
+        g_assert (oldest);
+        g_key_file_remove_group (self->keyfile, oldest, NULL);
+        n_groups--;
+    }
+}
+
+/*****************************************************************************/
+
+gboolean
+mm_sim_cache_load (MMSimCache *self,
+                   MmGdbusSim *sim)
+{
+    g_autofree gchar *group = NULL;
+    guint             n_loaded = 0;
+    guint             i;
+
+    group = build_group (self, mm_gdbus_sim_get_sim_identifier (sim));
+    if (!group || !g_key_file_has_group (self->keyfile, group))
+        return FALSE;
+
+    for (i = 0; i < G_N_ELEMENTS (cached_properties); i++) {
+        const CachedProperty *property = &cached_properties[i];
+
+        if (!g_key_file_has_key (self->keyfile, group, property->name, NULL))
+            continue;
+
+        switch (property->type) {
+        case CACHED_PROPERTY_STRING: {
+            g_autofree gchar *value = NULL;
+
+            value = g_key_file_get_string (self->keyfile, group, property->name, NULL);
+            if (!value)
+                continue;
+            g_object_set (sim, property->name, value, NULL);
+            break;
+        }
+        case CACHED_PROPERTY_STRV: {
+            g_auto(GStrv) value = NULL;
+
+            value = g_key_file_get_string_list (self->keyfile, group, property->name, NULL, NULL);
+            if (!value)
+                continue;
+            g_object_set (sim, property->name, value, NULL);
+            break;
+        }
+        case CACHED_PROPERTY_VARIANT: {
+            g_autofree gchar    *str = NULL;
+            g_autoptr(GVariant)  value = NULL;
+            g_autoptr(GError)    error = NULL;
+
+            str = g_key_file_get_string (self->keyfile, group, property->name, NULL);
+            if (!str)
+                continue;
+            value = g_variant_parse (G_VARIANT_TYPE (property->variant_type), str, NULL, NULL, &error);
+            if (!value) {
+                mm_obj_dbg (self, "ignoring invalid cached %s: %s", property->name, error->message);
+                continue;
+            }
+            g_object_set (sim, property->name, value, NULL);
+            break;
+        }
+        default:
+            g_assert_not_reached ();
+        }
+        n_loaded++;
+    }
+
+    /* A SIM without any cached value needs to be stored again */
+    if (!n_loaded)
+        return FALSE;
+
+    mm_obj_dbg (self, "loaded %u cached values for SIM %s",
+                n_loaded, mm_log_str_personal_info (mm_gdbus_sim_get_sim_identifier (sim)));
+    return TRUE;
+}
+
+void
+mm_sim_cache_store (MMSimCache *self,
+                    MmGdbusSim *sim)
+{
+    g_autofree gchar *group = NULL;
+    guint             i;
+
+    group = build_group (self, mm_gdbus_sim_get_sim_identifier (sim));
+    if (!group)
+        return;
+
+    /* Whatever was cached for the SIM is replaced */
+    g_key_file_remove_group (self->keyfile, group, NULL);
+
+    for (i = 0; i < G_N_ELEMENTS (cached_properties); i++) {
+        const CachedProperty *property = &cached_properties[i];
+
+        switch (property->type) {
+        case CACHED_PROPERTY_STRING: {
+            g_autofree gchar *value = NULL;
+
+            g_object_get (sim, property->name, &value, NULL);
+            if (value)
+                g_key_file_set_string (self->keyfile, group, property->name, value);
+            break;
+        }
+        case CACHED_PROPERTY_STRV: {
+            g_auto(GStrv) value = NULL;
+
+            /* Empty lists are not stored, as they can't be told apart from
+             * missing ones when read back */
+            g_object_get (sim, property->name, &value, NULL);
+            if (value && value[0])
+                g_key_file_set_string_list (self->keyfile, group, property->name,
+                                            (const gchar * const *) value, g_strv_length (value));
+            break;
+        }
+        case CACHED_PROPERTY_VARIANT: {
+            g_autoptr(GVariant) value = NULL;
+
+            g_object_get (sim, property->name, &value, NULL);
+            if (value) {
+                g_autofree gchar *str = NULL;
+
+                str = g_variant_print (value, TRUE);
+                g_key_file_set_string (self->keyfile, group, property->name, str);
+            }
+            break;
+        }
+        default:
+            g_assert_not_reached ();
+        }
+    }
+
+    g_key_file_set_int64 (self->keyfile, group, KEY_LAST_USED, g_get_real_time () / G_USEC_PER_SEC);
+    sim_cache_prune (self);
+
+    mm_obj_dbg (self, "stored contents of SIM %s",
+                mm_log_str_personal_info (mm_gdbus_sim_get_sim_identifier (sim)));
+    mm_keyfile_store_save (self->store);
+}
+
+void
+mm_sim_cache_forget (MMSimCache  *self,
+                     const gchar *sim_identifier)
+{
+    g_autofree gchar *group = NULL;
+
+    group = build_group (self, sim_identifier);
+    if (!group || !g_key_file_remove_group (self->keyfile, group, NULL))
+        return;
+
+    mm_obj_dbg (self, "forgot contents of SIM %s", mm_log_str_personal_info (sim_identifier));
+    mm_keyfile_store_save (self->store);
+}
+
+/*****************************************************************************/
+
+static void
+mm_sim_cache_init (MMSimCache *self)
+{
+}
+
+static void
+constructed (GObject *object)
+{
+    MMSimCache *self = MM_SIM_CACHE (object);
+
+    G_OBJECT_CLASS (mm_sim_cache_parent_class)->constructed (object);
+
+    if (!self->path) {
+        mm_obj_dbg (self, "disabled");
+        return;
+    }
+
+    self->store = mm_keyfile_store_new (self->path, "SIM cache", self);
+    self->keyfile = mm_keyfile_store_peek_keyfile (self->store);
+}
+
+static void
+set_property (GObject      *object,
+              guint         prop_id,
+              const GValue *value,
+              GParamSpec   *pspec)
+{
+    MMSimCache *self = MM_SIM_CACHE (object);
+
+    switch (prop_id) {
+    case PROP_PATH:
+        g_free (self->path);
+        self->path = g_value_dup_string (value);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+get_property (GObject    *object,
+              guint       prop_id,
+              GValue     *value,
+              GParamSpec *pspec)
+{
+    MMSimCache *self = MM_SIM_CACHE (object);
+
+    switch (prop_id) {
+    case PROP_PATH:
+        g_value_set_string (value, self->path);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+finalize (GObject *object)
+{
+    MMSimCache *self = MM_SIM_CACHE (object);
+
+    g_clear_pointer (&self->store, mm_keyfile_store_free);
+    g_free (self->path);
+
+    G_OBJECT_CLASS (mm_sim_cache_parent_class)->finalize (object);
+}
+
+static void
+log_object_iface_init (MMLogObjectInterface *iface)
+{
+    iface->build_id = log_object_build_id;
+}
+
+static void
+mm_sim_cache_class_init (MMSimCacheClass *klass)
+{
+    GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+    object_class->constructed  = constructed;
+    object_class->set_property = set_property;
+    object_class->get_property = get_property;
+    object_class->finalize     = finalize;
+
+    properties[PROP_PATH] =
+        g_param_spec_string (MM_SIM_CACHE_PATH,
+                             "Path",
+                             "Path to the SIM cache file",
+                             NULL,
+                             G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY);
+    g_object_class_install_property (object_class, PROP_PATH, properties[PROP_PATH]);
+}
+
+MM_DEFINE_SINGLETON_GETTER (MMSimCache, mm_sim_cache_get, MM_TYPE_SIM_CACHE,
+                            MM_SIM_CACHE_PATH, mm_context_get_sim_cache ())
@@ -0,0 +1,56 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_SIM_CACHE_H
+#define MM_SIM_CACHE_H
+
+#include <config.h>
+#include <glib-object.h>
+
+#include <mm-gdbus-sim.h>
+
+#define MM_TYPE_SIM_CACHE            (mm_sim_cache_get_type ())
+#define MM_SIM_CACHE(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), MM_TYPE_SIM_CACHE, MMSimCache))
+#define MM_SIM_CACHE_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass),  MM_TYPE_SIM_CACHE, MMSimCacheClass))
+#define MM_IS_SIM_CACHE(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), MM_TYPE_SIM_CACHE))
+#define MM_IS_SIM_CACHE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),  MM_TYPE_SIM_CACHE))
+#define MM_SIM_CACHE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),  MM_TYPE_SIM_CACHE, MMSimCacheClass))
+
+#define MM_SIM_CACHE_PATH "path" /* construct-only */
+
+typedef struct _MMSimCache      MMSimCache;
+typedef struct _MMSimCacheClass MMSimCacheClass;
+
+/* SIM card contents kept across daemon restarts, modem reprobes and
+ * resumes.
+ *
+ * Entries are keyed by the SIM identifier (ICCID), and hold the IMSI,
+ * operator identifier and name, GID1/GID2, emergency numbers, preferred
+ * networks and, for eSIMs, the EID. Only the values actually read from the
+ * card are stored, so anything missing is still loaded from the card. The
+ * least recently used entries are dropped once the cache is full. The
+ * cache is only enabled if a file path is given with --sim-cache. */
+
+GType       mm_sim_cache_get_type (void);
+MMSimCache *mm_sim_cache_get      (void);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (MMSimCache, g_object_unref)
+
+gboolean mm_sim_cache_load   (MMSimCache  *self,
+                              MmGdbusSim  *sim);
+void     mm_sim_cache_store  (MMSimCache  *self,
+                              MmGdbusSim  *sim);
+void     mm_sim_cache_forget (MMSimCache  *self,
+                              const gchar *sim_identifier);
+
+#endif /* MM_SIM_CACHE_H */
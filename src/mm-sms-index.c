@@ -0,0 +1,142 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+
+#include "mm-sms-index.h"
+
+struct _MMSmsIndex {
+    /* Indexed by storage and part index */
+    GHashTable *parts;
+    /* Indexed by storage, number and concat reference */
+    GHashTable *multiparts;
+};
+
+/*****************************************************************************/
+
+static gint64
+part_key (MMSmsStorage storage,
+          guint        index)
+{
+    return ((gint64) storage << 32) | index;
+}
+
+void
+mm_sms_index_add_part (MMSmsIndex   *self,
+                       MMSmsStorage  storage,
+                       guint         index,
+                       gpointer      sms)
+{
+    gint64 key;
+
+    key = part_key (storage, index);
+    if (!g_hash_table_contains (self->parts, &key))
+        g_hash_table_insert (self->parts, g_memdup (&key, sizeof (key)), sms);
+}
+
+void
+mm_sms_index_remove_part (MMSmsIndex   *self,
+                          MMSmsStorage  storage,
+                          guint         index,
+                          gpointer      sms)
+{
+    gint64 key;
+
+    key = part_key (storage, index);
+    if (g_hash_table_lookup (self->parts, &key) == sms)
+        g_hash_table_remove (self->parts, &key);
+}
+
+gpointer
+mm_sms_index_lookup_part (MMSmsIndex   *self,
+                          MMSmsStorage  storage,
+                          guint         index)
+{
+    gint64 key;
+
+    key = part_key (storage, index);
+    return g_hash_table_lookup (self->parts, &key);
+}
+
+/*****************************************************************************/
+
+static gchar *
+multipart_key (MMSmsStorage  storage,
+               const gchar  *number,
+               guint         reference)
+{
+    return g_strdup_printf ("%u|%s|%u", storage, number ? number : "", reference);
+}
+
+void
+mm_sms_index_add_multipart (MMSmsIndex   *self,
+                            MMSmsStorage  storage,
+                            const gchar  *number,
+                            guint         reference,
+                            gpointer      sms)
+{
+    gchar *key;
+
+    key = multipart_key (storage, number, reference);
+    if (!g_hash_table_contains (self->multiparts, key))
+        g_hash_table_insert (self->multiparts, key, sms);
+    else
+        g_free (key);
+}
+
+void
+mm_sms_index_remove_multipart (MMSmsIndex   *self,
+                               MMSmsStorage  storage,
+                               const gchar  *number,
+                               guint         reference,
+                               gpointer      sms)
+{
+    g_autofree gchar *key = NULL;
+
+    key = multipart_key (storage, number, reference);
+    if (g_hash_table_lookup (self->multiparts, key) == sms)
+        g_hash_table_remove (self->multiparts, key);
+}
+
+gpointer
+mm_sms_index_lookup_multipart (MMSmsIndex   *self,
+                               MMSmsStorage  storage,
+                               const gchar  *number,
+                               guint         reference)
+{
+    g_autofree gchar *key = NULL;
+
+    key = multipart_key (storage, number, reference);
+    return g_hash_table_lookup (self->multiparts, key);
+}
+
+/*****************************************************************************/
+
+MMSmsIndex *
+mm_sms_index_new (void)
+{
+    MMSmsIndex *self;
+
+    self = g_slice_new0 (MMSmsIndex);
+    self->parts = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, NULL);
+    self->multiparts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    return self;
+}
+
+void
+mm_sms_index_free (MMSmsIndex *self)
+{
+    g_hash_table_unref (self->parts);
+    g_hash_table_unref (self->multiparts);
+    g_slice_free (MMSmsIndex, self);
+}
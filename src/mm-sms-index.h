@@ -0,0 +1,62 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_SMS_INDEX_H
+#define MM_SMS_INDEX_H
+
+#include <glib.h>
+
+#include <ModemManager.h>
+
+/* Lookup tables of the SMS list, so that taking each new part doesn't need
+ * to walk all the messages.
+ *
+ * Messages are indexed by the storage and index of each of their parts,
+ * and multipart messages also by the storage, number and concat reference
+ * of their parts. Only one message is kept for each key; additions never replace
+ * the current one, and removals only drop the key if it still refers to
+ * the given message. Messages are not referenced.
+ */
+typedef struct _MMSmsIndex MMSmsIndex;
+
+MMSmsIndex *mm_sms_index_new              (void);
+void        mm_sms_index_free             (MMSmsIndex   *self);
+
+void        mm_sms_index_add_part         (MMSmsIndex   *self,
+                                           MMSmsStorage  storage,
+                                           guint         index,
+                                           gpointer      sms);
+void        mm_sms_index_remove_part      (MMSmsIndex   *self,
+                                           MMSmsStorage  storage,
+                                           guint         index,
+                                           gpointer      sms);
+gpointer    mm_sms_index_lookup_part      (MMSmsIndex   *self,
+                                           MMSmsStorage  storage,
+                                           guint         index);
+
+void        mm_sms_index_add_multipart    (MMSmsIndex   *self,
+                                           MMSmsStorage  storage,
+                                           const gchar  *number,
+                                           guint         reference,
+                                           gpointer      sms);
+void        mm_sms_index_remove_multipart (MMSmsIndex   *self,
+                                           MMSmsStorage  storage,
+                                           const gchar  *number,
+                                           guint         reference,
+                                           gpointer      sms);
+gpointer    mm_sms_index_lookup_multipart (MMSmsIndex   *self,
+                                           MMSmsStorage  storage,
+                                           const gchar  *number,
+                                           guint         reference);
+
+#endif /* MM_SMS_INDEX_H */
@@ -26,6 +26,7 @@
 
 #include "mm-iface-modem-messaging.h"
 #include "mm-sms-list.h"
+#include "mm-sms-index.h"
 #include "mm-base-sms.h"
 #include "mm-log-object.h"
 
@@ -51,36 +52,142 @@ static guint signals[SIGNAL_LAST];
 struct _MMSmsListPrivate {
     /* The owner modem */
     MMBaseModem *modem;
-    /* List of sms objects */
-    GList *list;
+    /* Queue of sms objects, most recent first */
+    GQueue *queue;
+    /* Links in the queue, indexed by DBus path */
+    GHashTable *links_by_path;
+    /* Received sms objects, indexed by the storage and index of their
+     * parts, and by storage, number and concat reference if multipart */
+    MMSmsIndex *index;
+    /* Sms objects created by the user, which may get stored afterwards */
+    GList *local_sms;
 };
 
 /*****************************************************************************/
 
+/* The number is only set in the sms object once all parts are available,
+ * so keep the one it was indexed with */
+#define SMS_LIST_MULTIPART_NUMBER "sms-list-multipart-number"
+
+static void
+index_sms (MMSmsList *self,
+           MMBaseSms *sms)
+{
+    const gchar  *multipart_number;
+    MMSmsStorage  storage;
+    GList        *l;
+
+    storage = mm_base_sms_get_storage (sms);
+
+    multipart_number = g_object_get_data (G_OBJECT (sms), SMS_LIST_MULTIPART_NUMBER);
+    if (multipart_number)
+        mm_sms_index_add_multipart (self->priv->index,
+                                    storage,
+                                    multipart_number,
+                                    mm_base_sms_get_multipart_reference (sms),
+                                    sms);
+
+    if (storage == MM_SMS_STORAGE_UNKNOWN)
+        return;
+
+    for (l = mm_base_sms_get_parts (sms); l; l = g_list_next (l)) {
+        guint index;
+
+        index = mm_sms_part_get_index ((MMSmsPart *)l->data);
+        if (index != SMS_PART_INVALID_INDEX)
+            mm_sms_index_add_part (self->priv->index, storage, index, sms);
+    }
+}
+
+static void
+unindex_sms (MMSmsList *self,
+             MMBaseSms *sms)
+{
+    const gchar  *multipart_number;
+    MMSmsStorage  storage;
+    GList        *l;
+
+    self->priv->local_sms = g_list_remove (self->priv->local_sms, sms);
+
+    storage = mm_base_sms_get_storage (sms);
+
+    multipart_number = g_object_get_data (G_OBJECT (sms), SMS_LIST_MULTIPART_NUMBER);
+    if (multipart_number)
+        mm_sms_index_remove_multipart (self->priv->index,
+                                       storage,
+                                       multipart_number,
+                                       mm_base_sms_get_multipart_reference (sms),
+                                       sms);
+
+    if (storage == MM_SMS_STORAGE_UNKNOWN)
+        return;
+
+    for (l = mm_base_sms_get_parts (sms); l; l = g_list_next (l)) {
+        guint index;
+
+        index = mm_sms_part_get_index ((MMSmsPart *)l->data);
+        if (index != SMS_PART_INVALID_INDEX)
+            mm_sms_index_remove_part (self->priv->index, storage, index, sms);
+    }
+}
+
+/* Takes ownership of the sms object */
+static void
+queue_sms (MMSmsList *self,
+           MMBaseSms *sms)
+{
+    const gchar *path;
+
+    g_queue_push_head (self->priv->queue, sms);
+
+    /* Not yet exported sms objects cannot be looked up by path */
+    path = mm_base_sms_get_path (sms);
+    if (path)
+        g_hash_table_insert (self->priv->links_by_path, g_strdup (path), self->priv->queue->head);
+}
+
+/*****************************************************************************/
+
+static gboolean
+is_local_multipart_reference (MMBaseSms   *sms,
+                              const gchar *number,
+                              guint8       reference)
+{
+    return (mm_base_sms_is_multipart (sms) &&
+            mm_gdbus_sms_get_pdu_type (MM_GDBUS_SMS (sms)) == MM_SMS_PDU_TYPE_SUBMIT &&
+            mm_base_sms_get_storage (sms) != MM_SMS_STORAGE_UNKNOWN &&
+            mm_base_sms_get_multipart_reference (sms) == reference &&
+            g_str_equal (mm_gdbus_sms_get_number (MM_GDBUS_SMS (sms)), number));
+}
+
 gboolean
 mm_sms_list_has_local_multipart_reference (MMSmsList *self,
                                            const gchar *number,
                                            guint8 reference)
 {
-    GList *l;
+    MMBaseSms    *sms;
+    MMSmsStorage  storage;
+    GList        *l;
 
     /* No one should look for multipart reference 0, which isn't valid */
     g_assert (reference != 0);
 
-    for (l = self->priv->list; l; l = g_list_next (l)) {
-        MMBaseSms *sms = MM_BASE_SMS (l->data);
-
-        if (mm_base_sms_is_multipart (sms) &&
-            mm_gdbus_sms_get_pdu_type (MM_GDBUS_SMS (sms)) == MM_SMS_PDU_TYPE_SUBMIT &&
-            mm_base_sms_get_storage (sms) != MM_SMS_STORAGE_UNKNOWN &&
-            mm_base_sms_get_multipart_reference (sms) == reference &&
-            g_str_equal (mm_gdbus_sms_get_number (MM_GDBUS_SMS (sms)), number)) {
+    /* Messages created by the user */
+    for (l = self->priv->local_sms; l; l = g_list_next (l)) {
+        if (is_local_multipart_reference (MM_BASE_SMS (l->data), number, reference)) {
             /* Yes, the SMS list has an SMS with the same destination number
              * and multipart reference */
             return TRUE;
         }
     }
 
+    /* Messages read from the storages, in any of them */
+    for (storage = MM_SMS_STORAGE_SM; storage <= MM_SMS_STORAGE_TA; storage++) {
+        sms = mm_sms_index_lookup_multipart (self->priv->index, storage, number, reference);
+        if (sms && is_local_multipart_reference (sms, number, reference))
+            return TRUE;
+    }
+
     return FALSE;
 }
 
@@ -89,7 +196,7 @@ mm_sms_list_has_local_multipart_reference (MMSmsList *self,
 guint
 mm_sms_list_get_count (MMSmsList *self)
 {
-    return g_list_length (self->priv->list);
+    return g_queue_get_length (self->priv->queue);
 }
 
 GStrv
@@ -100,9 +207,9 @@ mm_sms_list_get_paths (MMSmsList *self)
     guint i;
 
     path_list = g_new0 (gchar *,
-                        1 + g_list_length (self->priv->list));
+                        1 + g_queue_get_length (self->priv->queue));
 
-    for (i = 0, l = self->priv->list; l; l = g_list_next (l)) {
+    for (i = 0, l = self->priv->queue->head; l; l = g_list_next (l)) {
         const gchar *path;
 
         /* Don't try to add NULL paths (not yet exported SMS objects) */
@@ -124,13 +231,6 @@ mm_sms_list_delete_sms_finish (MMSmsList *self,
     return g_task_propagate_boolean (G_TASK (res), error);
 }
 
-static guint
-cmp_sms_by_path (MMBaseSms *sms,
-                 const gchar *path)
-{
-    return g_strcmp0 (mm_base_sms_get_path (sms), path);
-}
-
 static void
 delete_ready (MMBaseSms *sms,
               GAsyncResult *res,
@@ -141,22 +241,26 @@ delete_ready (MMBaseSms *sms,
     GError *error = NULL;
     GList *l;
 
+    self = g_task_get_source_object (task);
+
     if (!mm_base_sms_delete_finish (sms, res, &error)) {
+        /* Index again the parts that couldn't be deleted, if still around */
+        if (g_hash_table_contains (self->priv->links_by_path, g_task_get_task_data (task)))
+            index_sms (self, sms);
+
         /* We report the error */
         g_task_return_error (task, error);
         g_object_unref (task);
         return;
     }
 
-    self = g_task_get_source_object (task);
     path = g_task_get_task_data (task);
     /* The SMS was properly deleted, we now remove it from our list */
-    l = g_list_find_custom (self->priv->list,
-                            path,
-                            (GCompareFunc)cmp_sms_by_path);
+    l = g_hash_table_lookup (self->priv->links_by_path, path);
     if (l) {
+        g_hash_table_remove (self->priv->links_by_path, path);
         g_object_unref (MM_BASE_SMS (l->data));
-        self->priv->list = g_list_delete_link (self->priv->list, l);
+        g_queue_delete_link (self->priv->queue, l);
     }
 
     /* We don't need to unref the SMS any more, but we can use the
@@ -181,9 +285,7 @@ mm_sms_list_delete_sms (MMSmsList *self,
     GList *l;
     GTask *task;
 
-    l = g_list_find_custom (self->priv->list,
-                            (gpointer)sms_path,
-                            (GCompareFunc)cmp_sms_by_path);
+    l = g_hash_table_lookup (self->priv->links_by_path, sms_path);
     if (!l) {
         g_task_report_new_error (self,
                                  callback,
@@ -196,6 +298,10 @@ mm_sms_list_delete_sms (MMSmsList *self,
         return;
     }
 
+    /* The indices of the parts are reset while deleting them, so stop
+     * tracking them right away */
+    unindex_sms (self, MM_BASE_SMS (l->data));
+
     /* Delete all SMS parts */
     task = g_task_new (self, NULL, callback, user_data);
     g_task_set_task_data (task, g_strdup (sms_path), g_free);
@@ -211,7 +317,10 @@ void
 mm_sms_list_add_sms (MMSmsList *self,
                      MMBaseSms *sms)
 {
-    self->priv->list = g_list_prepend (self->priv->list, g_object_ref (sms));
+    /* Parts of messages created by the user only get an index once stored,
+     * so these are not indexed */
+    self->priv->local_sms = g_list_prepend (self->priv->local_sms, sms);
+    queue_sms (self, g_object_ref (sms));
     g_signal_emit (self, signals[SIGNAL_ADDED], 0,
                    mm_base_sms_get_path (sms),
                    FALSE);
@@ -219,29 +328,6 @@ mm_sms_list_add_sms (MMSmsList *self,
 
 /*****************************************************************************/
 
-static guint
-cmp_sms_by_concat_reference (MMBaseSms *sms,
-                             gpointer user_data)
-{
-    if (!mm_base_sms_is_multipart (sms))
-        return -1;
-
-    return (GPOINTER_TO_UINT (user_data) - mm_base_sms_get_multipart_reference (sms));
-}
-
-typedef struct {
-    guint part_index;
-    MMSmsStorage storage;
-} PartIndexAndStorage;
-
-static guint
-cmp_sms_by_part_index_and_storage (MMBaseSms *sms,
-                                   PartIndexAndStorage *ctx)
-{
-    return !(mm_base_sms_get_storage (sms) == ctx->storage &&
-             mm_base_sms_has_part_index (sms, ctx->part_index));
-}
-
 static gboolean
 take_singlepart (MMSmsList *self,
                  MMSmsPart *part,
@@ -259,7 +345,8 @@ take_singlepart (MMSmsList *self,
     if (!sms)
         return FALSE;
 
-    self->priv->list = g_list_prepend (self->priv->list, sms);
+    queue_sms (self, sms);
+    index_sms (self, sms);
     g_signal_emit (self, signals[SIGNAL_ADDED], 0,
                    mm_base_sms_get_path (sms),
                    state == MM_SMS_STATE_RECEIVED);
@@ -273,20 +360,29 @@ take_multipart (MMSmsList *self,
                 MMSmsStorage storage,
                 GError **error)
 {
-    GList *l;
-    MMBaseSms *sms;
-    guint concat_reference;
+    const gchar *number;
+    MMBaseSms   *sms;
+    guint        concat_reference;
 
+    number = mm_sms_part_get_number (part);
     concat_reference = mm_sms_part_get_concat_reference (part);
-    l = g_list_find_custom (self->priv->list,
-                            GUINT_TO_POINTER (concat_reference),
-                            (GCompareFunc)cmp_sms_by_concat_reference);
-    if (l) {
+    sms = mm_sms_index_lookup_multipart (self->priv->index, storage, number, concat_reference);
+
+    /* Concat references are only 8 or 16 bits long, so they get reused
+     * by the sender; a completed message never takes more parts */
+    if (sms && !mm_base_sms_multipart_is_complete (sms)) {
         /* Try to take the part */
         mm_obj_dbg (self, "found existing multipart SMS object with reference '%u': adding new part", concat_reference);
-        return mm_base_sms_multipart_take_part (MM_BASE_SMS (l->data), part, error);
+        if (!mm_base_sms_multipart_take_part (sms, part, error))
+            return FALSE;
+        index_sms (self, sms);
+        return TRUE;
     }
 
+    /* Replaces any completed multipart sms with the same reference */
+    if (sms)
+        mm_sms_index_remove_multipart (self->priv->index, storage, number, concat_reference, sms);
+
     /* Create new Multipart */
     sms = mm_base_sms_multipart_new (self->priv->modem,
                                      state,
@@ -301,7 +397,9 @@ take_multipart (MMSmsList *self,
     mm_obj_dbg (self, "creating new multipart SMS object: need to receive %u parts with reference '%u'",
                 mm_sms_part_get_concat_max (part),
                 concat_reference);
-    self->priv->list = g_list_prepend (self->priv->list, sms);
+    g_object_set_data_full (G_OBJECT (sms), SMS_LIST_MULTIPART_NUMBER, g_strdup (number ? number : ""), g_free);
+    queue_sms (self, sms);
+    index_sms (self, sms);
     g_signal_emit (self, signals[SIGNAL_ADDED], 0,
                    mm_base_sms_get_path (sms),
                    (state == MM_SMS_STATE_RECEIVED ||
@@ -315,18 +413,24 @@ mm_sms_list_has_part (MMSmsList *self,
                       MMSmsStorage storage,
                       guint index)
 {
-    PartIndexAndStorage ctx;
+    GList *l;
 
     if (storage == MM_SMS_STORAGE_UNKNOWN ||
         index == SMS_PART_INVALID_INDEX)
         return FALSE;
 
-    ctx.part_index = index;
-    ctx.storage = storage;
+    if (mm_sms_index_lookup_part (self->priv->index, storage, index))
+        return TRUE;
+
+    for (l = self->priv->local_sms; l; l = g_list_next (l)) {
+        MMBaseSms *sms = MM_BASE_SMS (l->data);
 
-    return !!g_list_find_custom (self->priv->list,
-                                 &ctx,
-                                 (GCompareFunc)cmp_sms_by_part_index_and_storage);
+        if (mm_base_sms_get_storage (sms) == storage &&
+            mm_base_sms_has_part_index (sms, index))
+            return TRUE;
+    }
+
+    return FALSE;
 }
 
 gboolean
@@ -443,6 +547,10 @@ mm_sms_list_init (MMSmsList *self)
     self->priv = G_TYPE_INSTANCE_GET_PRIVATE (self,
                                               MM_TYPE_SMS_LIST,
                                               MMSmsListPrivate);
+
+    self->priv->queue = g_queue_new ();
+    self->priv->links_by_path = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    self->priv->index = mm_sms_index_new ();
 }
 
 static void
@@ -451,8 +559,13 @@ dispose (GObject *object)
     MMSmsList *self = MM_SMS_LIST (object);
 
     g_clear_object (&self->priv->modem);
-    g_list_free_full (self->priv->list, g_object_unref);
-    self->priv->list = NULL;
+    g_clear_pointer (&self->priv->local_sms, g_list_free);
+    g_clear_pointer (&self->priv->links_by_path, g_hash_table_unref);
+    g_clear_pointer (&self->priv->index, mm_sms_index_free);
+    if (self->priv->queue) {
+        g_queue_free_full (self->priv->queue, g_object_unref);
+        self->priv->queue = NULL;
+    }
 
     G_OBJECT_CLASS (mm_sms_list_parent_class)->dispose (object);
 }
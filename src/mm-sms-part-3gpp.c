@@ -355,12 +355,20 @@ mm_sms_part_3gpp_new_from_pdu (guint         index,
                                gpointer      log_object,
                                GError      **error)
 {
-    g_autofree guint8 *pdu = NULL;
+    guint8             pdu_buf[PDU_SIZE];
+    g_autofree guint8 *pdu_heap = NULL;
+    guint8            *pdu;
     gsize              pdu_len;
 
-    /* Convert PDU from hex to binary */
-    pdu = mm_utils_hexstr2bin (hexpdu, -1, &pdu_len, error);
-    if (!pdu) {
+    /* Convert PDU from hex to binary; valid PDUs always fit in the stack
+     * buffer, so only bogus ones need a heap allocation */
+    pdu_len = strlen (hexpdu) / 2;
+    if (pdu_len <= sizeof (pdu_buf))
+        pdu = pdu_buf;
+    else
+        pdu = pdu_heap = g_malloc (pdu_len);
+
+    if (!mm_utils_hexstr2bin_buf (hexpdu, strlen (hexpdu), pdu, error)) {
         g_prefix_error (error, "Couldn't convert 3GPP PDU from hex to binary: ");
         return NULL;
     }
@@ -0,0 +1,387 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+
+#include "mm-timer-wheel.h"
+#include "mm-context.h"
+#include "mm-log.h"
+
+#if defined WITH_SUSPEND_RESUME
+# include "mm-sleep-monitor.h"
+#endif
+
+/* Maximum time a job may be delayed in order to share a wakeup */
+#define TIMER_WHEEL_MAX_SLACK_SECS 5
+
+/* Seconds covered by one turn of the wheel, one slot per second */
+#define TIMER_WHEEL_N_SLOTS 64
+
+/* How often the wakeup statistics are reported */
+#define TIMER_WHEEL_STATS_PERIOD_SECS 60
+
+typedef struct {
+    guint       id;
+    guint       interval;
+    gint64      deadline;
+    gint64      slack;
+    GSourceFunc function;
+    gpointer    user_data;
+    /* Link in the slot of the second by which the job must run */
+    GList       link;
+} Job;
+
+/* Jobs are looked up by id, and queued in the slot of the second by which
+ * they must run, i.e. deadline plus slack; slots are reused every turn, so
+ * a slot may also hold jobs due in later turns */
+static GHashTable *jobs;
+static GQueue      slots[TIMER_WHEEL_N_SLOTS];
+/* No job must run before this second */
+static gint64      wheel_sec;
+static guint       last_id;
+static guint       source_id;
+static gint64      source_time;
+static gboolean    dispatching;
+static gboolean    paused;
+
+/* Statistics */
+static gint64 stats_start;
+static guint  stats_wakeups;
+static guint  stats_dispatched;
+
+static void timer_wheel_arm (void);
+
+/*****************************************************************************/
+
+static gint64
+job_next_deadline (guint  interval,
+                   gint64 now)
+{
+    gint64 deadline;
+
+    /* Deadlines are aligned to full seconds, so that jobs with different
+     * intervals and start times still end up sharing wakeups */
+    deadline = now + (gint64) interval * G_USEC_PER_SEC;
+    return ((deadline + G_USEC_PER_SEC - 1) / G_USEC_PER_SEC) * G_USEC_PER_SEC;
+}
+
+static gint64
+job_expiry_sec (Job *job)
+{
+    return (job->deadline + job->slack) / G_USEC_PER_SEC;
+}
+
+static GQueue *
+job_slot (Job *job)
+{
+    return &slots[job_expiry_sec (job) % TIMER_WHEEL_N_SLOTS];
+}
+
+/* Jobs must be unscheduled before updating their deadline */
+static void
+job_schedule (Job *job)
+{
+    g_queue_push_tail_link (job_slot (job), &job->link);
+}
+
+static void
+job_unschedule (Job *job)
+{
+    g_queue_unlink (job_slot (job), &job->link);
+}
+
+static void
+job_free (Job *job)
+{
+    job_unschedule (job);
+    g_free (job);
+}
+
+static gint
+job_cmp (Job **a,
+         Job **b)
+{
+    if ((*a)->deadline != (*b)->deadline)
+        return (*a)->deadline < (*b)->deadline ? -1 : 1;
+    /* Same deadline, first added first */
+    return (*a)->id < (*b)->id ? -1 : 1;
+}
+
+static void
+timer_wheel_report_stats (gint64 now)
+{
+    gdouble elapsed;
+
+    if (!stats_start) {
+        stats_start = now;
+        return;
+    }
+
+    if (now - stats_start < (gint64) TIMER_WHEEL_STATS_PERIOD_SECS * G_USEC_PER_SEC)
+        return;
+
+    elapsed = (gdouble) (now - stats_start) / G_USEC_PER_SEC;
+    mm_dbg ("timer wheel: %.2f wakeups/s, %.2f jobs/s, %u jobs scheduled",
+            stats_wakeups / elapsed,
+            stats_dispatched / elapsed,
+            g_hash_table_size (jobs));
+    stats_start = now;
+    stats_wakeups = 0;
+    stats_dispatched = 0;
+}
+
+static gboolean
+timer_wheel_dispatch_cb (void)
+{
+    g_autoptr(GPtrArray) due_jobs = NULL;
+    g_autoptr(GArray)    due = NULL;
+    Job                 *job;
+    gint64               now;
+    gint64               now_sec;
+    gint64               n_secs;
+    gint64               sec;
+    GList               *l;
+    guint                i;
+
+    source_id = 0;
+    now = g_get_monotonic_time ();
+    now_sec = now / G_USEC_PER_SEC;
+
+    /* Run every job whose deadline has already been reached, not only the
+     * one that armed the source. Those must run by now plus the maximum
+     * slack, so only the slots up to that second are looked at. */
+    due_jobs = g_ptr_array_new ();
+    n_secs = MIN (now_sec + TIMER_WHEEL_MAX_SLACK_SECS - wheel_sec + 1, TIMER_WHEEL_N_SLOTS);
+    for (sec = wheel_sec; sec < wheel_sec + n_secs; sec++) {
+        for (l = slots[sec % TIMER_WHEEL_N_SLOTS].head; l; l = g_list_next (l)) {
+            job = l->data;
+            if (job->deadline <= now)
+                g_ptr_array_add (due_jobs, job);
+        }
+    }
+
+    /* Earliest deadline first; the ids are kept, as jobs may be removed by
+     * the ones run before */
+    g_ptr_array_sort (due_jobs, (GCompareFunc) job_cmp);
+    due = g_array_sized_new (FALSE, FALSE, sizeof (guint), due_jobs->len);
+    for (i = 0; i < due_jobs->len; i++)
+        g_array_append_val (due, ((Job *) g_ptr_array_index (due_jobs, i))->id);
+
+    stats_wakeups++;
+    dispatching = TRUE;
+    for (i = 0; i < due->len; i++) {
+        guint    id;
+        gboolean keep;
+
+        id = g_array_index (due, guint, i);
+
+        /* The job may have been removed by a previous one */
+        job = g_hash_table_lookup (jobs, GUINT_TO_POINTER (id));
+        if (!job)
+            continue;
+
+        stats_dispatched++;
+        keep = job->function (job->user_data);
+
+        /* The job may have removed itself */
+        job = g_hash_table_lookup (jobs, GUINT_TO_POINTER (id));
+        if (!job)
+            continue;
+
+        if (keep == G_SOURCE_REMOVE) {
+            g_hash_table_remove (jobs, GUINT_TO_POINTER (id));
+            continue;
+        }
+
+        /* Keep the period of the job, unless it is too late for that */
+        job_unschedule (job);
+        job->deadline += (gint64) job->interval * G_USEC_PER_SEC;
+        if (job->deadline <= now)
+            job->deadline = job_next_deadline (job->interval, now);
+        job_schedule (job);
+    }
+    dispatching = FALSE;
+
+    /* All the jobs left are due after now */
+    wheel_sec = now_sec;
+
+    timer_wheel_report_stats (now);
+    timer_wheel_arm ();
+    return G_SOURCE_REMOVE;
+}
+
+static gint64
+timer_wheel_next_wakeup (void)
+{
+    GHashTableIter  iter;
+    Job            *job;
+    gint64          wakeup = G_MAXINT64;
+    gint64          sec;
+    GList          *l;
+
+    /* The first second in which a slot holds a job due in this turn is the
+     * one of the next wakeup */
+    for (sec = wheel_sec; sec < wheel_sec + TIMER_WHEEL_N_SLOTS; sec++) {
+        for (l = slots[sec % TIMER_WHEEL_N_SLOTS].head; l; l = g_list_next (l)) {
+            job = l->data;
+            if (job_expiry_sec (job) == sec)
+                wakeup = MIN (wakeup, job->deadline + job->slack);
+        }
+        if (wakeup != G_MAXINT64)
+            return wakeup;
+    }
+
+    /* All jobs are due in later turns, which only happens with long
+     * intervals */
+    g_hash_table_iter_init (&iter, jobs);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &job))
+        wakeup = MIN (wakeup, job->deadline + job->slack);
+    return wakeup;
+}
+
+static void
+timer_wheel_arm (void)
+{
+    gint64 wakeup = G_MAXINT64;
+    gint64 now;
+
+    if (dispatching)
+        return;
+
+    /* Wake up when the first job runs out of slack */
+    if (!paused && jobs && g_hash_table_size (jobs))
+        wakeup = timer_wheel_next_wakeup ();
+
+    if (source_id) {
+        if (source_time == wakeup)
+            return;
+        g_source_remove (source_id);
+        source_id = 0;
+    }
+
+    if (wakeup == G_MAXINT64)
+        return;
+
+    now = g_get_monotonic_time ();
+    source_time = wakeup;
+    source_id = g_timeout_add (wakeup > now ? (guint) ((wakeup - now + 999) / 1000) : 0,
+                               (GSourceFunc) timer_wheel_dispatch_cb,
+                               NULL);
+}
+
+/*****************************************************************************/
+
+#if defined WITH_SUSPEND_RESUME
+
+static void
+sleeping_cb (MMSleepMonitor *sleep_monitor)
+{
+    mm_dbg ("timer wheel: jobs paused (sleeping)");
+    paused = TRUE;
+    timer_wheel_arm ();
+}
+
+static void
+resuming_cb (MMSleepMonitor *sleep_monitor)
+{
+    GHashTableIter  iter;
+    Job            *job;
+    gint64          now;
+
+    /* The monotonic clock doesn't run while suspended, so the deadlines are
+     * restarted instead of firing all the overdue jobs at once */
+    mm_dbg ("timer wheel: jobs rescheduled (resuming)");
+    now = g_get_monotonic_time ();
+    g_hash_table_iter_init (&iter, jobs);
+    while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &job)) {
+        job_unschedule (job);
+        job->deadline = job_next_deadline (job->interval, now);
+        job_schedule (job);
+    }
+    wheel_sec = now / G_USEC_PER_SEC;
+    paused = FALSE;
+    timer_wheel_arm ();
+}
+
+#endif
+
+static void
+timer_wheel_init (void)
+{
+    if (jobs)
+        return;
+
+    jobs = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) job_free);
+    wheel_sec = g_get_monotonic_time () / G_USEC_PER_SEC;
+
+#if defined WITH_SUSPEND_RESUME
+    if (!mm_context_get_test_no_suspend_resume ()) {
+        MMSleepMonitor *sleep_monitor;
+
+        sleep_monitor = mm_sleep_monitor_get ();
+        g_signal_connect (sleep_monitor, MM_SLEEP_MONITOR_SLEEPING, G_CALLBACK (sleeping_cb), NULL);
+        g_signal_connect (sleep_monitor, MM_SLEEP_MONITOR_RESUMING, G_CALLBACK (resuming_cb), NULL);
+    }
+#endif
+}
+
+/*****************************************************************************/
+
+guint
+mm_timer_wheel_add_seconds (guint       interval,
+                            GSourceFunc function,
+                            gpointer    user_data)
+{
+    Job *job;
+
+    g_return_val_if_fail (function != NULL, 0);
+
+    timer_wheel_init ();
+
+    /* Id 0 is never used, as with main loop sources */
+    if (++last_id == 0)
+        last_id++;
+
+    job = g_new0 (Job, 1);
+    job->id = last_id;
+    job->interval = interval;
+    job->deadline = job_next_deadline (interval, g_get_monotonic_time ());
+    job->slack = MIN ((gint64) interval * G_USEC_PER_SEC / 4,
+                      (gint64) TIMER_WHEEL_MAX_SLACK_SECS * G_USEC_PER_SEC);
+    job->function = function;
+    job->user_data = user_data;
+    job->link.data = job;
+    job_schedule (job);
+    g_hash_table_insert (jobs, GUINT_TO_POINTER (job->id), job);
+
+    timer_wheel_arm ();
+    return job->id;
+}
+
+void
+mm_timer_wheel_remove (guint id)
+{
+    g_return_if_fail (id != 0);
+
+    if (!jobs || !g_hash_table_remove (jobs, GUINT_TO_POINTER (id)))
+        return;
+
+    /* The source may have been armed for the removed job */
+    timer_wheel_arm ();
+}
+
+gint64
+mm_timer_wheel_peek_wakeup (void)
+{
+    return source_id ? source_time : 0;
+}
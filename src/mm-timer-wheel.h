@@ -0,0 +1,38 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef MM_TIMER_WHEEL_H
+#define MM_TIMER_WHEEL_H
+
+#include <glib.h>
+
+/* Shared timer service for the periodic jobs of all modems.
+ *
+ * Jobs are scheduled with the same semantics as g_timeout_add_seconds(),
+ * i.e. the job is run again after the given interval until the callback
+ * returns G_SOURCE_REMOVE or the job is removed. Instead of one main loop
+ * source per job, a single source is armed for the whole daemon, and every
+ * job is allowed to run slightly late (up to a quarter of its interval,
+ * bounded) so that jobs due around the same time are run in a single
+ * wakeup. Jobs are paused while the system is going to sleep, and
+ * rescheduled from scratch when resuming. */
+
+guint mm_timer_wheel_add_seconds (guint       interval,
+                                  GSourceFunc function,
+                                  gpointer    user_data);
+void  mm_timer_wheel_remove      (guint       id);
+
+/* Just for unit tests: monotonic time of the next wakeup, 0 if none */
+gint64 mm_timer_wheel_peek_wakeup (void);
+
+#endif /* MM_TIMER_WHEEL_H */
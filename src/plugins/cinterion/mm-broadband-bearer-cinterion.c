@@ -101,21 +101,6 @@ load_connection_status_finish (MMBaseBearer  *bearer,
     return (MMBearerConnectionStatus) aux;
 }
 
-typedef struct {
-    guint     cid;
-    guint     retries;
-    gboolean  delay;
-    gboolean  retry;
-} LoadConnectionContext;
-
-static void
-load_connection_context_free (LoadConnectionContext *ctx)
-{
-    g_slice_free (LoadConnectionContext, ctx);
-}
-
-static gboolean swwan_check_status (GTask *task);
-
 static void
 swwan_check_status_ready (MMBaseModem  *modem,
                           GAsyncResult *res,
@@ -125,10 +110,10 @@ swwan_check_status_ready (MMBaseModem  *modem,
     const gchar                *response;
     GError                     *error = NULL;
     MMBearerConnectionStatus    status;
-    LoadConnectionContext       *ctx;
+    guint                       cid;
 
     self = g_task_get_source_object (task);
-    ctx  = g_task_get_task_data (task);
+    cid  = GPOINTER_TO_UINT (g_task_get_task_data (task));
 
     response = mm_base_modem_at_command_finish (modem, res, &error);
     if (!response) {
@@ -136,25 +121,10 @@ swwan_check_status_ready (MMBaseModem  *modem,
         goto out;
     }
 
-    status = mm_cinterion_parse_swwan_response (response, ctx->cid, self, &error);
+    status = mm_cinterion_parse_swwan_response (response, cid, self, &error);
     if (status == MM_BEARER_CONNECTION_STATUS_UNKNOWN) {
         g_task_return_error (task, error);
         goto out;
-    } else if (ctx->retry && status == MM_BEARER_CONNECTION_STATUS_DISCONNECTED) {
-        mm_obj_dbg (self, "check status retry");
-        if (ctx->retries == 0) {
-            g_task_return_new_error (task, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
-                                 "CID %u status check retry exceeded", ctx->cid);
-            goto out;
-        } else {
-            if (ctx->delay) {
-                g_timeout_add_seconds (1, (GSourceFunc)swwan_check_status, task);
-            } else {
-                g_idle_add ((GSourceFunc)swwan_check_status, task);
-            }
-            ctx->retries--;
-            return;
-        }
     }
 
     g_assert (status == MM_BEARER_CONNECTION_STATUS_DISCONNECTED ||
@@ -165,13 +135,24 @@ out:
     g_object_unref (task);
 }
 
-static gboolean
-swwan_check_status (GTask *task)
+static void
+load_connection_status_by_cid (MMBroadbandBearerCinterion *bearer,
+                               gint                        cid,
+                               GAsyncReadyCallback         callback,
+                               gpointer                    user_data)
 {
-    MMBroadbandBearerCinterion *bearer;
+    GTask                  *task;
     g_autoptr(MMBaseModem)  modem = NULL;
 
-    bearer = g_task_get_source_object (task);
+    task = g_task_new (bearer, NULL, callback, user_data);
+    if (cid == MM_3GPP_PROFILE_ID_UNKNOWN) {
+        g_task_return_new_error (task, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
+                                 "Unknown profile id to check connection status");
+        g_object_unref (task);
+        return;
+    }
+    g_task_set_task_data (task, GUINT_TO_POINTER ((guint) cid), NULL);
+
     g_object_get (bearer,
                   MM_BASE_BEARER_MODEM, &modem,
                   NULL);
@@ -181,46 +162,38 @@ swwan_check_status (GTask *task)
                               FALSE,
                               (GAsyncReadyCallback) swwan_check_status_ready,
                               task);
-
-    return G_SOURCE_REMOVE;
 }
 
+/* Used as status check when waiting for the connection status of a CID
+ * after ^SWWAN, as some modems take a while to report it updated; some
+ * modems also require a delay before querying it at all */
+#define CONNECTION_STATUS_WAIT_FIRST_CHECK_DELAY_SECS 1
+#define CONNECTION_STATUS_WAIT_TIMEOUT_SECS           6
+
 static void
-load_connection_status_by_cid (MMBroadbandBearerCinterion *bearer,
-                               gint                        cid,
-                               gboolean                    delay,
-                               gboolean                    retry,
-                               GAsyncReadyCallback         callback,
-                               gpointer                    user_data)
+swwan_status_check (MMBroadbandBearerCinterion *self,
+                    gpointer                    cid,
+                    GAsyncReadyCallback         callback,
+                    gpointer                    user_data)
 {
-    GTask                 *task;
-    LoadConnectionContext *ctx;
-
-    task = g_task_new (bearer, NULL, callback, user_data);
-    if (cid == MM_3GPP_PROFILE_ID_UNKNOWN) {
-        g_task_return_new_error (task, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
-                                 "Unknown profile id to check connection status");
-        g_object_unref (task);
-        return;
-    }
+    load_connection_status_by_cid (self, GPOINTER_TO_INT (cid), callback, user_data);
+}
 
-    ctx = g_slice_new0 (LoadConnectionContext);
-    g_task_set_task_data (task, ctx, (GDestroyNotify) load_connection_context_free);
+static MMBearerConnectionStatus
+swwan_disconnect_status_check_finish (MMBaseBearer  *self,
+                                      GAsyncResult  *res,
+                                      GError       **error)
+{
+    MMBearerConnectionStatus  status;
+    g_autoptr(GError)         inner_error = NULL;
 
-    /* Setup context */
-    ctx->cid     = cid;
-    ctx->retries = 5;
-    ctx->delay = delay;
-    ctx->retry = retry;
-
-    /* Some modems require a delay before querying the SWWAN status
-     * This is only needed for step DIAL_3GPP_CONTEXT_STEP_VALIDATE_CONNECTION
-     * and DISCONNECT_3GPP_CONTEXT_STEP_CONNECTION_STATUS. */
-    if (delay) {
-        g_timeout_add_seconds (1, (GSourceFunc)swwan_check_status, task);
-    } else {
-        g_idle_add ((GSourceFunc)swwan_check_status, task);
+    /* If the status can't be checked after ^SWWAN, assume disconnected */
+    status = load_connection_status_finish (self, res, &inner_error);
+    if (status == MM_BEARER_CONNECTION_STATUS_UNKNOWN) {
+        mm_obj_dbg (self, "couldn't get CID status, assume disconnected: %s", inner_error->message);
+        return MM_BEARER_CONNECTION_STATUS_DISCONNECTED;
     }
+    return status;
 }
 
 static void
@@ -230,8 +203,6 @@ load_connection_status (MMBaseBearer        *bearer,
 {
     load_connection_status_by_cid (MM_BROADBAND_BEARER_CINTERION (bearer),
                                    mm_base_bearer_get_profile_id (bearer),
-                                   FALSE,
-                                   FALSE,
                                    callback,
                                    user_data);
 }
@@ -278,32 +249,26 @@ dial_3gpp_finish (MMBroadbandBearer  *self,
 static void dial_3gpp_context_step (GTask *task);
 
 static void
-dial_connection_status_ready (MMBroadbandBearerCinterion *self,
-                              GAsyncResult               *res,
-                              GTask                      *task)
+dial_connection_status_ready (MMBroadbandBearer *self,
+                              GAsyncResult      *res,
+                              GTask             *task)
 {
-    MMBearerConnectionStatus  status;
-    Dial3gppContext          *ctx;
-    GError                   *error = NULL;
+    Dial3gppContext *ctx;
+    GError          *error = NULL;
 
     ctx = (Dial3gppContext *) g_task_get_task_data (task);
 
-    status = load_connection_status_finish (MM_BASE_BEARER (self), res, &error);
-    if (status == MM_BEARER_CONNECTION_STATUS_UNKNOWN) {
-        g_task_return_error (task, error);
-        g_object_unref (task);
-        return;
-    }
-
-    if (status == MM_BEARER_CONNECTION_STATUS_DISCONNECTED) {
-        g_task_return_new_error (task, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
+    if (!mm_broadband_bearer_wait_for_status_finish (self, res, &error)) {
+        if (g_error_matches (error, MM_MOBILE_EQUIPMENT_ERROR, MM_MOBILE_EQUIPMENT_ERROR_NETWORK_TIMEOUT)) {
+            g_clear_error (&error);
+            error = g_error_new (MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
                                  "CID %u is reported disconnected", ctx->cid);
+        }
+        g_task_return_error (task, error);
         g_object_unref (task);
         return;
     }
 
-    g_assert (status == MM_BEARER_CONNECTION_STATUS_CONNECTED);
-
     /* Go to next step */
     ctx->step++;
     dial_3gpp_context_step (task);
@@ -468,12 +433,16 @@ dial_3gpp_context_step (GTask *task)
         g_assert (default_swwan_behavior);
         mm_obj_dbg (self, "dial step %u/%u: checking SWWAN interface %u status...",
                     ctx->step, DIAL_3GPP_CONTEXT_STEP_LAST, usb_interface_configs[ctx->usb_interface_config_index].swwan_index);
-        load_connection_status_by_cid (ctx->self,
-                                       (gint) ctx->cid,
-                                       TRUE,
-                                       TRUE,
-                                       (GAsyncReadyCallback) dial_connection_status_ready,
-                                       task);
+        mm_broadband_bearer_wait_for_status (MM_BROADBAND_BEARER (self),
+                                             MM_BEARER_CONNECTION_STATUS_CONNECTED,
+                                             CONNECTION_STATUS_WAIT_FIRST_CHECK_DELAY_SECS,
+                                             CONNECTION_STATUS_WAIT_TIMEOUT_SECS,
+                                             (MMBroadbandBearerStatusCheckFn) swwan_status_check,
+                                             (MMBroadbandBearerStatusCheckFinishFn) load_connection_status_finish,
+                                             GUINT_TO_POINTER (ctx->cid),
+                                             NULL,
+                                             (GAsyncReadyCallback) dial_connection_status_ready,
+                                             task);
         return;
 
     case DIAL_3GPP_CONTEXT_STEP_LAST:
@@ -577,34 +546,24 @@ disconnect_3gpp_finish (MMBroadbandBearer  *self,
 static void disconnect_3gpp_context_step (GTask *task);
 
 static void
-disconnect_connection_status_ready (MMBroadbandBearerCinterion *self,
-                                    GAsyncResult               *res,
-                                    GTask                      *task)
+disconnect_connection_status_ready (MMBroadbandBearer *self,
+                                    GAsyncResult      *res,
+                                    GTask             *task)
 {
-    MMBearerConnectionStatus  status;
-    Disconnect3gppContext    *ctx;
-    GError                   *error = NULL;
+    Disconnect3gppContext *ctx;
+    GError                *error = NULL;
 
     ctx = (Disconnect3gppContext *) g_task_get_task_data (task);
 
-    status = load_connection_status_finish (MM_BASE_BEARER (self), res, &error);
-    switch (status) {
-    case MM_BEARER_CONNECTION_STATUS_UNKNOWN:
-        /* Assume disconnected */
-        mm_obj_dbg (self, "couldn't get CID %u status, assume disconnected: %s", ctx->cid, error->message);
-        g_clear_error (&error);
-        break;
-    case MM_BEARER_CONNECTION_STATUS_DISCONNECTED:
-        break;
-    case MM_BEARER_CONNECTION_STATUS_CONNECTED:
+    /* Errors checking the status complete the wait as disconnected, so a
+     * failed wait means the CID kept being reported connected */
+    if (!mm_broadband_bearer_wait_for_status_finish (self, res, &error)) {
+        mm_obj_dbg (self, "CID %u still connected: %s", ctx->cid, error->message);
+        g_error_free (error);
         g_task_return_new_error (task, MM_CORE_ERROR, MM_CORE_ERROR_FAILED,
                                  "CID %u is reported connected", ctx->cid);
         g_object_unref (task);
         return;
-    case MM_BEARER_CONNECTION_STATUS_DISCONNECTING:
-    case MM_BEARER_CONNECTION_STATUS_CONNECTION_FAILED:
-    default:
-        g_assert_not_reached ();
     }
 
     /* Go on to next step */
@@ -668,12 +627,16 @@ disconnect_3gpp_context_step (GTask *task)
         mm_obj_dbg (self, "disconnect step %u/%u: checking SWWAN interface %u status...",
                     ctx->step, DISCONNECT_3GPP_CONTEXT_STEP_LAST,
                     usb_interface_configs[ctx->usb_interface_config_index].swwan_index);
-        load_connection_status_by_cid (MM_BROADBAND_BEARER_CINTERION (ctx->self),
-                                       (gint) ctx->cid,
-                                       TRUE,
-                                       FALSE,
-                                       (GAsyncReadyCallback) disconnect_connection_status_ready,
-                                       task);
+        mm_broadband_bearer_wait_for_status (MM_BROADBAND_BEARER (self),
+                                             MM_BEARER_CONNECTION_STATUS_DISCONNECTED,
+                                             CONNECTION_STATUS_WAIT_FIRST_CHECK_DELAY_SECS,
+                                             CONNECTION_STATUS_WAIT_TIMEOUT_SECS,
+                                             (MMBroadbandBearerStatusCheckFn) swwan_status_check,
+                                             (MMBroadbandBearerStatusCheckFinishFn) swwan_disconnect_status_check_finish,
+                                             GUINT_TO_POINTER (ctx->cid),
+                                             NULL,
+                                             (GAsyncReadyCallback) disconnect_connection_status_ready,
+                                             task);
          return;
 
     case DISCONNECT_3GPP_CONTEXT_STEP_LAST:
@@ -557,7 +557,7 @@ modem_power_down (MMIfaceModem        *_self,
             MM_BASE_MODEM (self),
             "+CFUN=?",
             3,
-            FALSE,
+            TRUE,
             (GAsyncReadyCallback)supported_functionality_status_query_ready,
             task);
 }
@@ -2232,7 +2232,7 @@ load_supported_bands (MMIfaceModem        *_self,
     mm_base_modem_at_command (MM_BASE_MODEM (_self),
                               "AT^SCFG=?",
                               3,
-                              FALSE,
+                              TRUE,
                               (GAsyncReadyCallback)scfg_test_ready,
                               task);
 }
@@ -2852,7 +2852,7 @@ after_sim_unlock (MMIfaceModem        *self,
     mm_base_modem_at_command (MM_BASE_MODEM (self),
                               "AT^SIND=?",
                               3,
-                              FALSE,
+                              TRUE,
                               (GAsyncReadyCallback)sind_indicators_ready,
                               task);
 }
@@ -58,6 +58,79 @@ get_dial_port (MMBroadbandModemHuawei *modem,
     return g_object_ref (primary);
 }
 
+/*****************************************************************************/
+/* Connection status check, used while waiting for ^NDISSTAT */
+
+static MMBearerConnectionStatus
+ndisstatqry_check_finish (MMBroadbandBearerHuawei  *self,
+                          GAsyncResult             *res,
+                          GError                  **error)
+{
+    GError *inner_error = NULL;
+    gssize  value;
+
+    value = g_task_propagate_int (G_TASK (res), &inner_error);
+    if (inner_error) {
+        g_propagate_error (error, inner_error);
+        return MM_BEARER_CONNECTION_STATUS_UNKNOWN;
+    }
+    return (MMBearerConnectionStatus) value;
+}
+
+static void
+ndisstatqry_check_ready (MMBaseModem  *modem,
+                         GAsyncResult *res,
+                         GTask        *task)
+{
+    const gchar *response;
+    GError      *error = NULL;
+    gboolean     ipv4_available = FALSE;
+    gboolean     ipv4_connected = FALSE;
+    gboolean     ipv6_available = FALSE;
+    gboolean     ipv6_connected = FALSE;
+
+    response = mm_base_modem_at_command_full_finish (modem, res, &error);
+    if (!response ||
+        !mm_huawei_parse_ndisstatqry_response (response,
+                                               &ipv4_available,
+                                               &ipv4_connected,
+                                               &ipv6_available,
+                                               &ipv6_connected,
+                                               &error)) {
+        g_prefix_error (&error, "unexpected response to ^NDISSTATQRY command: ");
+        g_task_return_error (task, error);
+    } else if ((ipv4_available && ipv4_connected) || (ipv6_available && ipv6_connected))
+        g_task_return_int (task, MM_BEARER_CONNECTION_STATUS_CONNECTED);
+    else
+        g_task_return_int (task, MM_BEARER_CONNECTION_STATUS_DISCONNECTED);
+    g_object_unref (task);
+}
+
+static void
+ndisstatqry_check (MMBroadbandBearerHuawei *self,
+                   MMPortSerialAt          *port,
+                   GAsyncReadyCallback      callback,
+                   gpointer                 user_data)
+{
+    GTask                  *task;
+    g_autoptr(MMBaseModem)  modem = NULL;
+
+    task = g_task_new (self, NULL, callback, user_data);
+
+    g_object_get (self,
+                  MM_BASE_BEARER_MODEM, &modem,
+                  NULL);
+    mm_base_modem_at_command_full (modem,
+                                   port,
+                                   "^NDISSTATQRY?",
+                                   3,
+                                   FALSE,
+                                   FALSE,
+                                   NULL,
+                                   (GAsyncReadyCallback)ndisstatqry_check_ready,
+                                   task);
+}
+
 /*****************************************************************************/
 /* Connect 3GPP */
 
@@ -74,8 +147,6 @@ typedef struct {
     MMPortSerialAt *primary;
     MMPort *data;
     Connect3gppContextStep step;
-    guint check_count;
-    guint failed_ndisstatqry_count;
     MMBearerIpFamily ip_family;
     MMBearerIpConfig *ipv4_config;
     MMBearerIpConfig *ipv6_config;
@@ -185,37 +256,14 @@ connect_dhcp_check_ready (MMBaseModem *modem,
     connect_3gpp_context_step (task);
 }
 
-static gboolean
-connect_retry_ndisstatqry_check_cb (MMBroadbandBearerHuawei *self)
-{
-    GTask *task;
-
-    /* Recover context */
-    task = self->priv->connect_pending;
-    g_assert (task != NULL);
-
-    /* Balance refcount */
-    g_object_unref (self);
-
-    /* Retry same step */
-    connect_3gpp_context_step (task);
-
-    return G_SOURCE_REMOVE;
-}
-
 static void
-connect_ndisstatqry_check_ready (MMBaseModem *modem,
-                                 GAsyncResult *res,
-                                 MMBroadbandBearerHuawei *self)
+connect_wait_ready (MMBroadbandBearer       *bearer,
+                    GAsyncResult            *res,
+                    MMBroadbandBearerHuawei *self)
 {
-    GTask *task;
+    GTask              *task;
     Connect3gppContext *ctx;
-    const gchar *response;
-    GError *error = NULL;
-    gboolean ipv4_available = FALSE;
-    gboolean ipv4_connected = FALSE;
-    gboolean ipv6_available = FALSE;
-    gboolean ipv6_connected = FALSE;
+    GError             *error = NULL;
 
     task = self->priv->connect_pending;
     g_assert (task != NULL);
@@ -225,32 +273,24 @@ connect_ndisstatqry_check_ready (MMBaseModem *modem,
     /* Balance refcount */
     g_object_unref (self);
 
-    response = mm_base_modem_at_command_full_finish (modem, res, &error);
-    if (!response ||
-        !mm_huawei_parse_ndisstatqry_response (response,
-                                               &ipv4_available,
-                                               &ipv4_connected,
-                                               &ipv6_available,
-                                               &ipv6_connected,
-                                               &error)) {
-        ctx->failed_ndisstatqry_count++;
-        mm_obj_dbg (self, "unexpected response to ^NDISSTATQRY command: %s (%u attempts so far)",
-                    error->message, ctx->failed_ndisstatqry_count);
-        g_error_free (error);
-    }
+    if (!mm_broadband_bearer_wait_for_status_finish (bearer, res, &error)) {
+        /* Cancellation is handled in the step itself */
+        if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+            g_error_free (error);
+            connect_3gpp_context_step (task);
+            return;
+        }
 
-    /* Connected? */
-    if ((ipv4_available && ipv4_connected) || (ipv6_available && ipv6_connected)) {
-        /* Success! */
-        ctx->step++;
-        connect_3gpp_context_step (task);
+        /* Clear context */
+        self->priv->connect_pending = NULL;
+        g_task_return_error (task, error);
+        g_object_unref (task);
         return;
     }
 
-    /* Setup timeout to retry the same step */
-    g_timeout_add_seconds (1,
-                           (GSourceFunc)connect_retry_ndisstatqry_check_cb,
-                           g_object_ref (self));
+    /* Success! */
+    ctx->step++;
+    connect_3gpp_context_step (task);
 }
 
 static void
@@ -398,44 +438,17 @@ connect_3gpp_context_step (GTask *task)
     }
 
     case CONNECT_3GPP_CONTEXT_STEP_NDISSTATQRY:
-        /* Wait for dial up timeout, retries for 180 times
-         * (1s between the retries, so it means 3 minutes).
-         * If too many retries, failed
-         */
-        if (ctx->check_count > MM_BASE_BEARER_DEFAULT_CONNECTION_TIMEOUT) {
-            /* Clear context */
-            self->priv->connect_pending = NULL;
-            g_task_return_new_error (task,
-                                     MM_MOBILE_EQUIPMENT_ERROR,
-                                     MM_MOBILE_EQUIPMENT_ERROR_NETWORK_TIMEOUT,
-                                     "Connection attempt timed out");
-            g_object_unref (task);
-            return;
-        }
-
-        /* Give up if too many unexpected responses to NIDSSTATQRY are encountered. */
-        if (ctx->failed_ndisstatqry_count > 10) {
-            /* Clear context */
-            self->priv->connect_pending = NULL;
-            g_task_return_new_error (task,
-                                     MM_MOBILE_EQUIPMENT_ERROR,
-                                     MM_MOBILE_EQUIPMENT_ERROR_NOT_SUPPORTED,
-                                     "Connection attempt not supported.");
-            g_object_unref (task);
-            return;
-        }
-
-        /* Check if connected */
-        ctx->check_count++;
-        mm_base_modem_at_command_full (ctx->modem,
-                                       ctx->primary,
-                                       "^NDISSTATQRY?",
-                                       3,
-                                       FALSE,
-                                       FALSE,
-                                       NULL,
-                                       (GAsyncReadyCallback)connect_ndisstatqry_check_ready,
-                                       g_object_ref (self));
+        /* Wait until connected, as reported by ^NDISSTAT or ^NDISSTATQRY? */
+        mm_broadband_bearer_wait_for_status (MM_BROADBAND_BEARER (self),
+                                             MM_BEARER_CONNECTION_STATUS_CONNECTED,
+                                             0, /* ^NDISSTAT usually arrives first */
+                                             MM_BASE_BEARER_DEFAULT_CONNECTION_TIMEOUT,
+                                             (MMBroadbandBearerStatusCheckFn)ndisstatqry_check,
+                                             (MMBroadbandBearerStatusCheckFinishFn)ndisstatqry_check_finish,
+                                             ctx->primary,
+                                             g_task_get_cancellable (task),
+                                             (GAsyncReadyCallback)connect_wait_ready,
+                                             g_object_ref (self));
         return;
 
     case CONNECT_3GPP_CONTEXT_STEP_IP_CONFIG:
@@ -545,8 +558,6 @@ typedef struct {
     MMBaseModem *modem;
     MMPortSerialAt *primary;
     Disconnect3gppContextStep step;
-    guint check_count;
-    guint failed_ndisstatqry_count;
 } Disconnect3gppContext;
 
 static void
@@ -567,36 +578,14 @@ disconnect_3gpp_finish (MMBroadbandBearer *self,
 
 static void disconnect_3gpp_context_step (GTask *task);
 
-static gboolean
-disconnect_retry_ndisstatqry_check_cb (MMBroadbandBearerHuawei *self)
-{
-    GTask *task;
-
-    /* Recover context */
-    task = self->priv->disconnect_pending;
-    g_assert (task != NULL);
-
-    /* Balance refcount */
-    g_object_unref (self);
-
-    /* Retry same step */
-    disconnect_3gpp_context_step (task);
-    return G_SOURCE_REMOVE;
-}
-
 static void
-disconnect_ndisstatqry_check_ready (MMBaseModem *modem,
-                                    GAsyncResult *res,
-                                    MMBroadbandBearerHuawei *self)
+disconnect_wait_ready (MMBroadbandBearer       *bearer,
+                       GAsyncResult            *res,
+                       MMBroadbandBearerHuawei *self)
 {
-    GTask *task;
+    GTask                 *task;
     Disconnect3gppContext *ctx;
-    const gchar *response;
-    GError *error = NULL;
-    gboolean ipv4_available = FALSE;
-    gboolean ipv4_connected = FALSE;
-    gboolean ipv6_available = FALSE;
-    gboolean ipv6_connected = FALSE;
+    GError                *error = NULL;
 
     task = self->priv->disconnect_pending;
     g_assert (task != NULL);
@@ -606,32 +595,17 @@ disconnect_ndisstatqry_check_ready (MMBaseModem *modem,
     /* Balance refcount */
     g_object_unref (self);
 
-    response = mm_base_modem_at_command_full_finish (modem, res, &error);
-    if (!response ||
-        !mm_huawei_parse_ndisstatqry_response (response,
-                                               &ipv4_available,
-                                               &ipv4_connected,
-                                               &ipv6_available,
-                                               &ipv6_connected,
-                                               &error)) {
-        ctx->failed_ndisstatqry_count++;
-        mm_obj_dbg (self, "unexpected response to ^NDISSTATQRY command: %s (%u attempts so far)",
-                    error->message, ctx->failed_ndisstatqry_count);
-        g_error_free (error);
-    }
-
-    /* Disconnected? */
-    if (!((ipv4_available && ipv4_connected) || (ipv6_available && ipv6_connected))) {
-        /* Success! */
-        ctx->step++;
-        disconnect_3gpp_context_step (task);
+    if (!mm_broadband_bearer_wait_for_status_finish (bearer, res, &error)) {
+        /* Clear task */
+        self->priv->disconnect_pending = NULL;
+        g_task_return_error (task, error);
+        g_object_unref (task);
         return;
     }
 
-    /* Setup timeout to retry the same step */
-    g_timeout_add_seconds (1,
-                           (GSourceFunc)disconnect_retry_ndisstatqry_check_cb,
-                           g_object_ref (self));
+    /* Success! */
+    ctx->step++;
+    disconnect_3gpp_context_step (task);
 }
 
 static void
@@ -690,41 +664,17 @@ disconnect_3gpp_context_step (GTask *task)
         return;
 
     case DISCONNECT_3GPP_CONTEXT_STEP_NDISSTATQRY:
-        /* If too many retries (1s of wait between the retries), failed */
-        if (ctx->check_count > MM_BASE_BEARER_DEFAULT_DISCONNECTION_TIMEOUT) {
-            /* Clear task */
-            self->priv->disconnect_pending = NULL;
-            g_task_return_new_error (task,
-                                     MM_MOBILE_EQUIPMENT_ERROR,
-                                     MM_MOBILE_EQUIPMENT_ERROR_NETWORK_TIMEOUT,
-                                     "Disconnection attempt timed out");
-            g_object_unref (task);
-            return;
-        }
-
-        /* Give up if too many unexpected responses to NIDSSTATQRY are encountered. */
-        if (ctx->failed_ndisstatqry_count > 10) {
-            /* Clear task */
-            self->priv->disconnect_pending = NULL;
-            g_task_return_new_error (task,
-                                     MM_MOBILE_EQUIPMENT_ERROR,
-                                     MM_MOBILE_EQUIPMENT_ERROR_NOT_SUPPORTED,
-                                     "Disconnection attempt not supported.");
-            g_object_unref (task);
-            return;
-        }
-
-        /* Check if disconnected */
-        ctx->check_count++;
-        mm_base_modem_at_command_full (ctx->modem,
-                                       ctx->primary,
-                                       "^NDISSTATQRY?",
-                                       3,
-                                       FALSE,
-                                       FALSE,
-                                       NULL,
-                                       (GAsyncReadyCallback)disconnect_ndisstatqry_check_ready,
-                                       g_object_ref (self));
+        /* Wait until disconnected, as reported by ^NDISSTAT or ^NDISSTATQRY? */
+        mm_broadband_bearer_wait_for_status (MM_BROADBAND_BEARER (self),
+                                             MM_BEARER_CONNECTION_STATUS_DISCONNECTED,
+                                             0, /* ^NDISSTAT usually arrives first */
+                                             MM_BASE_BEARER_DEFAULT_DISCONNECTION_TIMEOUT,
+                                             (MMBroadbandBearerStatusCheckFn)ndisstatqry_check,
+                                             (MMBroadbandBearerStatusCheckFinishFn)ndisstatqry_check_finish,
+                                             ctx->primary,
+                                             NULL,
+                                             (GAsyncReadyCallback)disconnect_wait_ready,
+                                             g_object_ref (self));
         return;
 
     case DISCONNECT_3GPP_CONTEXT_STEP_LAST:
@@ -786,11 +736,13 @@ report_connection_status (MMBaseBearer             *bearer,
               status == MM_BEARER_CONNECTION_STATUS_DISCONNECTING ||
               status == MM_BEARER_CONNECTION_STATUS_DISCONNECTED);
 
-    /* When a pending connection / disconnection attempt is in progress, we use
-     * ^NDISSTATQRY? to check the connection status and thus temporarily ignore
-     * ^NDISSTAT unsolicited messages */
-    if (self->priv->connect_pending || self->priv->disconnect_pending)
+    /* When a pending connection / disconnection attempt is in progress, the
+     * ^NDISSTAT unsolicited messages are only used to complete the wait for
+     * the connection status, if any */
+    if (self->priv->connect_pending || self->priv->disconnect_pending) {
+        mm_broadband_bearer_report_wait_status (MM_BROADBAND_BEARER (self), status);
         return;
+    }
 
     mm_obj_dbg (self, "received spontaneous ^NDISSTAT (%s)", mm_bearer_connection_status_get_string (status));
 
@@ -241,7 +241,7 @@ load_supported_modes (MMIfaceModem *self,
     mm_base_modem_at_command (MM_BASE_MODEM (self),
                               "+CFUN=?",
                               3,
-                              FALSE,
+                              TRUE,
                               callback,
                               user_data);
 }
@@ -149,6 +149,12 @@ mm_shared_quectel_setup_ports (MMBroadbandModem *self)
         if (!ports[i])
             continue;
 
+        /* Several extended commands may be given in one command line; only
+         * done for the commands of a sequence flagged as chainable */
+        g_object_set (ports[i],
+                      MM_PORT_SERIAL_AT_COMMAND_CHAINING, TRUE,
+                      NULL);
+
         /* Ignore +QGPSURC */
         mm_port_serial_at_add_unsolicited_msg_handler (
             ports[i],
@@ -773,8 +779,8 @@ mm_shared_quectel_location_load_capabilities (MMIfaceModemLocation *_self,
  *     faster GNSS location locks.
  */
 static const MMBaseModemAtCommand gps_startup[] = {
-    { "+QGPSCFG=\"outport\",\"usbnmea\"", 3, FALSE, mm_base_modem_response_processor_no_result_continue },
-    { "+QGPS=1",                          3, FALSE, mm_base_modem_response_processor_no_result_continue },
+    { "+QGPSCFG=\"outport\",\"usbnmea\"", 3, FALSE, mm_base_modem_response_processor_no_result_continue, 0, TRUE },
+    { "+QGPS=1",                          3, FALSE, mm_base_modem_response_processor_no_result_continue, 0, TRUE },
     { "+QGPSXTRA=1",                      3, FALSE, mm_base_modem_response_processor_no_result_continue },
     { NULL }
 };
@@ -877,7 +877,7 @@ reload_stats (MMBaseBearer        *self,
         mm_base_modem_at_command (MM_BASE_MODEM (modem),
                                   "+UGCNTRD=?",
                                   3,
-                                  FALSE,
+                                  TRUE,
                                   (GAsyncReadyCallback) ugcntrd_test_ready,
                                   task);
         g_object_unref (modem);
@@ -197,7 +197,7 @@ load_supported_modes (MMIfaceModem        *self,
         MM_BASE_MODEM (self),
         "+CGCLASS=?",
         3,
-        FALSE,
+        TRUE,
         (GAsyncReadyCallback)supported_ms_classes_query_ready,
         task);
 }
@@ -1245,6 +1245,7 @@ setup_ports (MMBroadbandModem *self)
 
     mm_port_serial_at_set_response_parser (MM_PORT_SERIAL_AT (primary),
                                            mm_serial_parser_v1_parse,
+                                           mm_serial_parser_v1_reset,
                                            parser,
                                            mm_serial_parser_v1_destroy);
 }
@@ -754,7 +754,7 @@ mm_shared_xmm_signal_check_support (MMIfaceModemSignal  *self,
     mm_base_modem_at_command (MM_BASE_MODEM (self),
                               "+XCESQ=?",
                               3,
-                              FALSE,
+                              TRUE,
                               callback,
                               user_data);
 }
@@ -0,0 +1,233 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <glib.h>
+
+#include <ModemManager.h>
+#include "mm-errors-types.h"
+#include "mm-at-knowledge.h"
+#include "mm-log-test.h"
+#include "test-keyfile-fixture.h"
+
+#define DEVICE "1199:9071:0006"
+
+/*****************************************************************************/
+
+static MMAtKnowledge *
+knowledge_new (Fixture *fixture,
+               guint    unsupported_expiry)
+{
+    return fixture_new_object (fixture, MM_TYPE_AT_KNOWLEDGE,
+                               MM_AT_KNOWLEDGE_UNSUPPORTED_EXPIRY, unsupported_expiry,
+                               NULL);
+}
+
+static void
+record_error (MMAtKnowledge          *knowledge,
+              const gchar            *command,
+              MMMobileEquipmentError  code)
+{
+    g_autoptr(GError) error = NULL;
+
+    error = g_error_new (MM_MOBILE_EQUIPMENT_ERROR, code, "failed");
+    mm_at_knowledge_device_record (knowledge, DEVICE, command, error, 10000);
+}
+
+static void
+record_not_supported (MMAtKnowledge *knowledge,
+                      const gchar   *command,
+                      guint          times)
+{
+    guint i;
+
+    for (i = 0; i < times; i++)
+        record_error (knowledge, command, MM_MOBILE_EQUIPMENT_ERROR_NOT_SUPPORTED);
+}
+
+/*****************************************************************************/
+
+static void
+test_not_supported (Fixture       *fixture,
+                    gconstpointer  data)
+{
+    g_autoptr(MMAtKnowledge) knowledge = NULL;
+
+    knowledge = knowledge_new (fixture, 3600);
+
+    record_not_supported (knowledge, "AT+CESQ", 2);
+    g_assert (!mm_at_knowledge_device_is_unsupported (knowledge, DEVICE, "AT+CESQ"));
+    record_not_supported (knowledge, "AT+CESQ", 1);
+    g_assert (mm_at_knowledge_device_is_unsupported (knowledge, DEVICE, "AT+CESQ"));
+
+    /* Other forms of the same command are tracked separately */
+    g_assert (!mm_at_knowledge_device_is_unsupported (knowledge, DEVICE, "AT+CESQ=?"));
+    /* And so are other devices */
+    g_assert (!mm_at_knowledge_device_is_unsupported (knowledge, "1199:9071:0007", "AT+CESQ"));
+}
+
+static void
+test_generic_error (Fixture       *fixture,
+                    gconstpointer  data)
+{
+    g_autoptr(MMAtKnowledge) knowledge = NULL;
+    guint                    i;
+
+    knowledge = knowledge_new (fixture, 3600);
+
+    /* A plain ERROR, or state-dependent errors, never flag the command */
+    for (i = 0; i < 10; i++) {
+        record_error (knowledge, "AT+CNUM", MM_MOBILE_EQUIPMENT_ERROR_UNKNOWN);
+        record_error (knowledge, "AT+CNUM", MM_MOBILE_EQUIPMENT_ERROR_SIM_BUSY);
+    }
+    g_assert (!mm_at_knowledge_device_is_unsupported (knowledge, DEVICE, "AT+CNUM"));
+}
+
+static void
+test_success_resets (Fixture       *fixture,
+                     gconstpointer  data)
+{
+    g_autoptr(MMAtKnowledge) knowledge = NULL;
+
+    knowledge = knowledge_new (fixture, 3600);
+
+    record_not_supported (knowledge, "AT+WS46=?", 2);
+    mm_at_knowledge_device_record (knowledge, DEVICE, "AT+WS46=?", NULL, 10000);
+    record_not_supported (knowledge, "AT+WS46=?", 2);
+    g_assert (!mm_at_knowledge_device_is_unsupported (knowledge, DEVICE, "AT+WS46=?"));
+
+    /* Even a command known to work may stop working */
+    record_not_supported (knowledge, "AT+WS46=?", 1);
+    g_assert (mm_at_knowledge_device_is_unsupported (knowledge, DEVICE, "AT+WS46=?"));
+    mm_at_knowledge_device_record (knowledge, DEVICE, "AT+WS46=?", NULL, 10000);
+    g_assert (!mm_at_knowledge_device_is_unsupported (knowledge, DEVICE, "AT+WS46=?"));
+}
+
+static void
+test_expiry (Fixture       *fixture,
+             gconstpointer  data)
+{
+    g_autoptr(MMAtKnowledge) knowledge = NULL;
+
+    knowledge = knowledge_new (fixture, 1);
+
+    record_not_supported (knowledge, "AT^SYSINFO", 3);
+    g_assert (mm_at_knowledge_device_is_unsupported (knowledge, DEVICE, "AT^SYSINFO"));
+
+    /* Probed again once expired */
+    g_usleep (1200 * G_TIME_SPAN_MILLISECOND);
+    g_assert (!mm_at_knowledge_device_is_unsupported (knowledge, DEVICE, "AT^SYSINFO"));
+
+    /* A single failure is enough to flag it again */
+    record_not_supported (knowledge, "AT^SYSINFO", 1);
+    g_assert (mm_at_knowledge_device_is_unsupported (knowledge, DEVICE, "AT^SYSINFO"));
+}
+
+static void
+test_firmware_revision (Fixture       *fixture,
+                        gconstpointer  data)
+{
+    g_autoptr(MMAtKnowledge) knowledge = NULL;
+
+    knowledge = knowledge_new (fixture, 3600);
+
+    mm_at_knowledge_device_set_firmware_revision (knowledge, DEVICE, "SWI9X30C_02.24.05.06");
+    record_not_supported (knowledge, "AT+CESQ", 3);
+    g_assert (mm_at_knowledge_device_is_unsupported (knowledge, DEVICE, "AT+CESQ"));
+
+    /* Same firmware, nothing changes */
+    mm_at_knowledge_device_set_firmware_revision (knowledge, DEVICE, "SWI9X30C_02.24.05.06");
+    g_assert (mm_at_knowledge_device_is_unsupported (knowledge, DEVICE, "AT+CESQ"));
+
+    /* Firmware update, learn again */
+    mm_at_knowledge_device_set_firmware_revision (knowledge, DEVICE, "SWI9X30C_02.33.03.00");
+    g_assert (!mm_at_knowledge_device_is_unsupported (knowledge, DEVICE, "AT+CESQ"));
+}
+
+static void
+test_persistence (Fixture       *fixture,
+                  gconstpointer  data)
+{
+    MMAtKnowledge *knowledge;
+    guint          i;
+
+    knowledge = knowledge_new (fixture, 3600);
+    mm_at_knowledge_device_set_firmware_revision (knowledge, DEVICE, "REV1");
+    record_not_supported (knowledge, "AT+CESQ", 3);
+    for (i = 0; i < 5; i++)
+        mm_at_knowledge_device_record (knowledge, DEVICE, "AT+CSQ", NULL, 400 * G_TIME_SPAN_MILLISECOND);
+    /* Pending changes are written out when disposed */
+    g_object_unref (knowledge);
+
+    /* Before the firmware revision is reported, the last one is assumed */
+    knowledge = knowledge_new (fixture, 3600);
+    g_assert (mm_at_knowledge_device_is_unsupported (knowledge, DEVICE, "AT+CESQ"));
+    g_assert_cmpuint (mm_at_knowledge_device_get_timeout (knowledge, DEVICE, "AT+CSQ", 10), ==, 5);
+    g_assert_cmpuint (mm_at_knowledge_device_get_timeout (knowledge, DEVICE, "AT+CSQ", 6), ==, 3);
+    g_assert_cmpuint (mm_at_knowledge_device_get_timeout (knowledge, DEVICE, "AT+CSQ", 2), ==, 2);
+    g_object_unref (knowledge);
+}
+
+static void
+test_timeout_kept (Fixture       *fixture,
+                   gconstpointer  data)
+{
+    g_autoptr(MMAtKnowledge) knowledge = NULL;
+    guint                    i;
+
+    knowledge = knowledge_new (fixture, 3600);
+    for (i = 0; i < 5; i++) {
+        mm_at_knowledge_device_record (knowledge, DEVICE, "AT+CSQ", NULL, 400 * G_TIME_SPAN_MILLISECOND);
+        mm_at_knowledge_device_record (knowledge, DEVICE, "AT+COPS=?", NULL, 400 * G_TIME_SPAN_MILLISECOND);
+        mm_at_knowledge_device_record (knowledge, DEVICE, "AT+CGATT?", NULL, 400 * G_TIME_SPAN_MILLISECOND);
+    }
+
+    /* Long running commands keep their timeout */
+    g_assert_cmpuint (mm_at_knowledge_device_get_timeout (knowledge, DEVICE, "AT+CSQ", 30), ==, 30);
+    g_assert_cmpuint (mm_at_knowledge_device_get_timeout (knowledge, DEVICE, "AT+COPS=?", 120), ==, 120);
+    /* And so do network dependent ones */
+    g_assert_cmpuint (mm_at_knowledge_device_get_timeout (knowledge, DEVICE, "AT+CGATT?", 10), ==, 10);
+}
+
+static void
+test_untracked (Fixture       *fixture,
+                gconstpointer  data)
+{
+    g_autoptr(MMAtKnowledge) knowledge = NULL;
+
+    knowledge = knowledge_new (fixture, 3600);
+
+    /* Commands with arguments and basic commands are not tracked */
+    record_not_supported (knowledge, "AT+CFUN=4", 3);
+    g_assert (!mm_at_knowledge_device_is_unsupported (knowledge, DEVICE, "AT+CFUN=4"));
+    record_not_supported (knowledge, "ATE0", 3);
+    g_assert (!mm_at_knowledge_device_is_unsupported (knowledge, DEVICE, "ATE0"));
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add ("/MM/at-knowledge/not-supported",     Fixture, NULL, fixture_setup, test_not_supported,     fixture_teardown);
+    g_test_add ("/MM/at-knowledge/generic-error",     Fixture, NULL, fixture_setup, test_generic_error,     fixture_teardown);
+    g_test_add ("/MM/at-knowledge/success-resets",    Fixture, NULL, fixture_setup, test_success_resets,    fixture_teardown);
+    g_test_add ("/MM/at-knowledge/expiry",            Fixture, NULL, fixture_setup, test_expiry,            fixture_teardown);
+    g_test_add ("/MM/at-knowledge/firmware-revision", Fixture, NULL, fixture_setup, test_firmware_revision, fixture_teardown);
+    g_test_add ("/MM/at-knowledge/persistence",       Fixture, NULL, fixture_setup, test_persistence,       fixture_teardown);
+    g_test_add ("/MM/at-knowledge/timeout-kept",      Fixture, NULL, fixture_setup, test_timeout_kept,      fixture_teardown);
+    g_test_add ("/MM/at-knowledge/untracked",         Fixture, NULL, fixture_setup, test_untracked,         fixture_teardown);
+
+    return g_test_run ();
+}
@@ -14,8 +14,15 @@
  */
 
 #include <config.h>
+#include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <glib.h>
+#include <glib-unix.h>
+
+#include <ModemManager.h>
+#include <mm-errors-types.h>
 
 #include "mm-port-serial-at.h"
 #include "mm-serial-parsers.h"
@@ -83,26 +90,70 @@ static const ParseResponseTest parse_error_tests[] = {
     { "\r\nNO DIALTONE\r\n\r\nSomething extra\r\n", TRUE, TRUE}
 };
 
+/* Sample replies as seen in real AT port traces, used to compare the regex
+ * based parser with the single-pass classifier */
+static const gchar *parse_traces[] = {
+    "\r\nOK\r\n",
+    "\r\nhuawei\r\n\r\nOK\r\n",
+    "\r\n+CGMR: 11.608.12.02.21\r\n\r\nOK\r\n\r\n^RSSI:17\r\n",
+    "\r\n+CREG: 2,1,\"1F2C\",\"00C4D0E5\",7\r\n\r\nOK\r\n",
+    "\r\n+CMGL: 1,1,,25\r\n07914306073011F0040B914316709807F20000112062419574000641F27C3E9F01\r\n"
+    "+CMGL: 2,1,,25\r\n07914306073011F0040B914316709807F20000112062419574000641F27C3E9F01\r\n\r\nOK\r\n",
+    "\r\nCONNECT 150000000\r\n",
+    "\r\nCONNECT\r\n",
+    "\r\n> ",
+    "\r\n>\r\n",
+    "\r\nERROR\r\n",
+    "\r\nERROR",
+    "\r\n+CME ERROR: 10\r\n",
+    "\r\n+CME ERROR: SIM not inserted\r\n",
+    "\r\n+CMS ERROR: 500\r\n",
+    "\r\n+CMS ERROR: unknown error\r\n",
+    "\r\n+CMS ERROR: 500\r\n\r\n+CME ERROR: 3\r\n",
+    "\r\n+CME ERROR: foo\r\n\r\n+CMS ERROR: 3\r\n",
+    "\r\nMODEM ERROR: 5\r\n",
+    "\r\nNO CARRIER\r\n",
+    "\r\nNO ANSWER\r\n",
+    "\r\nNO DIALTONE\r\n",
+    "\r\nNA\r\n",
+    "\r\nCOMMAND NOT SUPPORT\r\n",
+    "\r\nBUSY\r\n",
+    /* Not anchored to whole lines in the default regexes */
+    "\r\nLINE BUSY\r\n",
+    "\r\n+CPAS: NO ANSWER",
+    "\r\nNO CARRIER FOUND\r\n",
+    "\r\nERROR: 3\r\n",
+    "\r\nAT COMMAND NOT SUPPORT\r\n",
+    "\r\nCALL NO DIALTONE\r\n",
+    "\r\nCALL NO DIALTONE",
+    "\r\nOK\r\nOK\r\n",
+    "\r\nOK\r\n\r\n\r\n\r\n+CMTI: \"SM\",3\r\n",
+    "\r\n+CSQ: 20,99\r\n",
+    "\r\n+CSQ: 20,99\r\n\r\nO",
+    "\r\nOKAY\r\n",
+    "\r\nERRORS\r\n",
+    "no delimiters at all",
+    "",
+};
+
 static void
 at_serial_echo_removal (void)
 {
     guint i;
 
     for (i = 0; i < G_N_ELEMENTS (echo_removal_tests); i++) {
-        GByteArray *ba;
+        g_autoptr(MMSerialBuffer) buffer = NULL;
 
-        /* Note that we add last NUL also to the byte array, so that we can compare
+        /* Note that we add last NUL also to the buffer, so that we can compare
          * C strings later on */
-        ba = g_byte_array_sized_new (strlen (echo_removal_tests[i].original) + 1);
-        g_byte_array_prepend (ba,
-                              (guint8 *)echo_removal_tests[i].original,
-                              strlen (echo_removal_tests[i].original) + 1);
-
-        mm_port_serial_at_remove_echo (ba);
+        buffer = mm_serial_buffer_new (strlen (echo_removal_tests[i].original) + 1);
+        mm_serial_buffer_append (buffer,
+                                 (const guint8 *)echo_removal_tests[i].original,
+                                 strlen (echo_removal_tests[i].original) + 1);
 
-        g_assert_cmpstr ((gchar *)ba->data, ==, echo_removal_tests[i].without_echo);
+        mm_port_serial_at_remove_echo (buffer);
 
-        g_byte_array_unref (ba);
+        g_assert_cmpstr ((gchar *)mm_serial_buffer_peek (buffer, NULL), ==, echo_removal_tests[i].without_echo);
     }
 }
 
@@ -149,6 +200,777 @@ at_serial_parse_error (void)
     _run_parse_test (parse_error_tests, G_N_ELEMENTS(parse_error_tests));
 }
 
+/* Same tests, with the regex based parser instead of the single-pass
+ * classifier */
+static void
+_run_parse_regex_test (const ParseResponseTest tests[], guint number_of_tests)
+{
+    guint i;
+
+    for (i = 0; i < number_of_tests; i++) {
+        gpointer          parser;
+        g_autoptr(GError) error = NULL;
+        GString          *response;
+        gboolean          found;
+
+        parser = mm_serial_parser_v1_new ();
+        mm_serial_parser_v1_set_fast_classifier (parser, FALSE);
+        response = g_string_new (tests[i].response);
+        found = mm_serial_parser_v1_parse (parser, response, NULL, &error);
+
+        g_assert_cmpint (found, ==, tests[i].found);
+        if (tests[i].expected_error)
+            g_assert (error != NULL);
+        else
+            g_assert_no_error (error);
+
+        g_string_free (response, TRUE);
+        mm_serial_parser_v1_destroy (parser);
+    }
+}
+
+static void
+at_serial_parse_ok_regex (void)
+{
+    _run_parse_regex_test (parse_ok_tests, G_N_ELEMENTS (parse_ok_tests));
+}
+
+static void
+at_serial_parse_error_regex (void)
+{
+    _run_parse_regex_test (parse_error_tests, G_N_ELEMENTS (parse_error_tests));
+}
+
+static void
+at_serial_parse_resume (void)
+{
+    gpointer          parser;
+    g_autoptr(GError) error = NULL;
+    GString          *response;
+
+    parser = mm_serial_parser_v1_new ();
+
+    /* The scan resumes on the last line seen as the response grows, so a
+     * result code split across reads is still found */
+    response = g_string_new ("\r\n+CSQ: 20,99\r\n\r\nO");
+    g_assert (!mm_serial_parser_v1_parse (parser, response, NULL, &error));
+    g_string_append (response, "K\r\n");
+    g_assert (mm_serial_parser_v1_parse (parser, response, NULL, &error));
+    g_assert_no_error (error);
+    g_assert_cmpstr (response->str, ==, "+CSQ: 20,99");
+    g_string_free (response, TRUE);
+
+    /* Once reset, the whole response is scanned again, e.g. if data was
+     * removed from it before the last line seen */
+    response = g_string_new ("\r\n+CMTI: \"SM\",2\r\n\r\n+CSQ: 20,99\r\n");
+    g_assert (!mm_serial_parser_v1_parse (parser, response, NULL, &error));
+    g_string_assign (response, "\r\nERROR\r\n\r\n+CSQ: 20,99\r\n\r\n+CSQ: 20,99\r\n");
+    mm_serial_parser_v1_reset (parser);
+    g_assert (mm_serial_parser_v1_parse (parser, response, NULL, &error));
+    g_assert (error != NULL);
+    g_clear_error (&error);
+    g_string_free (response, TRUE);
+
+    /* A shorter response is never resumed */
+    response = g_string_new ("\r\n+CMTI: \"SM\",2\r\n\r\n+CSQ: 20,99\r\n");
+    g_assert (!mm_serial_parser_v1_parse (parser, response, NULL, &error));
+    g_string_assign (response, "\r\nOK\r\n");
+    g_assert (mm_serial_parser_v1_parse (parser, response, NULL, &error));
+    g_assert_no_error (error);
+    g_string_free (response, TRUE);
+
+    mm_serial_parser_v1_destroy (parser);
+}
+
+/* Feeds the trace in chunks of the given size, as if it was being read from
+ * the serial port, and returns the parsed response once found */
+static gboolean
+_parse_trace_in_chunks (gpointer      parser,
+                        const gchar  *trace,
+                        gsize         chunk_size,
+                        GString     **out_response,
+                        GError      **error)
+{
+    GString *response;
+    gsize    trace_len;
+    gsize    i;
+
+    response = g_string_new (NULL);
+    trace_len = strlen (trace);
+    for (i = 0; i < trace_len; i += chunk_size) {
+        g_string_append_len (response, trace + i, MIN (chunk_size, trace_len - i));
+        if (mm_serial_parser_v1_parse (parser, response, NULL, error)) {
+            *out_response = response;
+            return TRUE;
+        }
+    }
+
+    *out_response = response;
+    return FALSE;
+}
+
+static void
+at_serial_parse_equivalence (void)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (parse_traces); i++) {
+        gsize chunk_size;
+
+        for (chunk_size = 1; chunk_size <= 64; chunk_size *= 2) {
+            gpointer          regex_parser;
+            gpointer          fast_parser;
+            g_autoptr(GError) regex_error = NULL;
+            g_autoptr(GError) fast_error = NULL;
+            GString          *regex_response = NULL;
+            GString          *fast_response = NULL;
+            gboolean          regex_found;
+            gboolean          fast_found;
+
+            regex_parser = mm_serial_parser_v1_new ();
+            mm_serial_parser_v1_set_fast_classifier (regex_parser, FALSE);
+            fast_parser = mm_serial_parser_v1_new ();
+
+            regex_found = _parse_trace_in_chunks (regex_parser, parse_traces[i], chunk_size, &regex_response, &regex_error);
+            fast_found = _parse_trace_in_chunks (fast_parser, parse_traces[i], chunk_size, &fast_response, &fast_error);
+
+            g_assert_cmpint (regex_found, ==, fast_found);
+            g_assert_cmpstr (regex_response->str, ==, fast_response->str);
+            if (regex_error) {
+                g_assert (fast_error);
+                g_assert_cmpuint (regex_error->domain, ==, fast_error->domain);
+                g_assert_cmpint (regex_error->code, ==, fast_error->code);
+            } else
+                g_assert (!fast_error);
+
+            g_string_free (regex_response, TRUE);
+            g_string_free (fast_response, TRUE);
+            mm_serial_parser_v1_destroy (regex_parser);
+            mm_serial_parser_v1_destroy (fast_parser);
+        }
+    }
+}
+
+typedef struct {
+    const gchar *pattern;
+    guint        n_calls;
+} UnsolicitedTestHandler;
+
+static void
+unsolicited_test_cb (MMPortSerialAt *port,
+                     GMatchInfo     *match_info,
+                     gpointer        user_data)
+{
+    UnsolicitedTestHandler *handler = user_data;
+
+    handler->n_calls++;
+}
+
+static void
+at_serial_parse_unsolicited (void)
+{
+    g_autoptr(MMPortSerialAt) port = NULL;
+    g_autoptr(MMSerialBuffer) response = NULL;
+    guint                     i;
+    UnsolicitedTestHandler    handlers[] = {
+        /* indexed by line prefix */
+        { "\\r\\n\\+CREG:(.*)\\r\\n", 0 },
+        { "\\r\\n\\+CMTI:\\s*\"(\\S+)\",(\\d+)\\r\\n", 0 },
+        { "\\r\\n(\\^HCSQ:.+)\\r+\\n", 0 },
+        { "\\r\\nRING(?:\\r)?\\r\\n", 0 },
+        /* not indexed */
+        { "\\r\\n(NO CARRIER|BUSY)\\r\\n", 0 },
+        { "\\^SIND:\\s*(.*),(\\d+)\\r\\n", 0 },
+        { "\\r\\n(PB DONE)|(SMS DONE)\\r\\n", 0 },
+    };
+    const gchar *input =
+        "\r\n+CREG: 1\r\n"
+        "\r\n+CMTI: \"SM\",2\r\n"
+        "\r\n^HCSQ: \"LTE\",50,40,100\r\n"
+        "\r\nRING\r\n"
+        "\r\nRING\r\n"
+        "\r\nBUSY\r\n"
+        "\r\n^SIND: service,1\r\n"
+        "\r\nSMS DONE\r\n"
+        "\r\n+CSQ: 20,99\r\n"
+        "\r\n+CREG: 5\r\n";
+
+    port = mm_port_serial_at_new ("ttyTEST0", MM_PORT_SUBSYS_TTY);
+    for (i = 0; i < G_N_ELEMENTS (handlers); i++) {
+        g_autoptr(GRegex) regex = NULL;
+
+        regex = g_regex_new (handlers[i].pattern, G_REGEX_RAW | G_REGEX_OPTIMIZE, 0, NULL);
+        g_assert (regex);
+        mm_port_serial_at_add_unsolicited_msg_handler (port, regex, unsolicited_test_cb, &handlers[i], NULL);
+    }
+
+    response = mm_serial_buffer_new (strlen (input));
+    mm_serial_buffer_append (response, (const guint8 *) input, strlen (input));
+    MM_PORT_SERIAL_GET_CLASS (port)->parse_unsolicited (MM_PORT_SERIAL (port), response);
+
+    g_assert_cmpuint (handlers[0].n_calls, ==, 2);
+    g_assert_cmpuint (handlers[1].n_calls, ==, 1);
+    g_assert_cmpuint (handlers[2].n_calls, ==, 1);
+    g_assert_cmpuint (handlers[3].n_calls, ==, 2);
+    g_assert_cmpuint (handlers[4].n_calls, ==, 1);
+    g_assert_cmpuint (handlers[5].n_calls, ==, 1);
+    g_assert_cmpuint (handlers[6].n_calls, ==, 1);
+
+    /* Only the line without handler is kept; the ^SIND and SMS DONE matches
+     * don't include the leading <CR><LF>, so those are also left */
+    mm_serial_buffer_append (response, (const guint8 *) "", 1);
+    g_assert_cmpstr ((const gchar *) mm_serial_buffer_peek (response, NULL), ==, "\r\n\r\n\r\n+CSQ: 20,99\r\n");
+}
+
+#define PARSE_BENCHMARK_ITERATIONS 2000
+
+static gdouble
+_run_parse_benchmark (gboolean fast)
+{
+    gpointer parser;
+    guint    i;
+    guint    j;
+
+    parser = mm_serial_parser_v1_new ();
+    mm_serial_parser_v1_set_fast_classifier (parser, fast);
+
+    g_test_timer_start ();
+    for (i = 0; i < PARSE_BENCHMARK_ITERATIONS; i++) {
+        for (j = 0; j < G_N_ELEMENTS (parse_traces); j++) {
+            g_autoptr(GError)  error = NULL;
+            GString           *response = NULL;
+
+            /* Reads of 16 bytes, as usually seen with USB serial ports */
+            _parse_trace_in_chunks (parser, parse_traces[j], 16, &response, &error);
+            g_string_free (response, TRUE);
+            mm_serial_parser_v1_reset (parser);
+        }
+    }
+
+    mm_serial_parser_v1_destroy (parser);
+    return g_test_timer_elapsed ();
+}
+
+static void
+at_serial_parse_benchmark (void)
+{
+    gdouble regex_elapsed;
+    gdouble fast_elapsed;
+
+    if (!g_test_perf ()) {
+        g_test_skip ("only run in perf mode");
+        return;
+    }
+
+    regex_elapsed = _run_parse_benchmark (FALSE);
+    fast_elapsed = _run_parse_benchmark (TRUE);
+
+    g_test_message ("regex parser: %.3fs, single-pass classifier: %.3fs (%.1fx)",
+                    regex_elapsed, fast_elapsed, regex_elapsed / fast_elapsed);
+    g_test_minimized_result (fast_elapsed, "single-pass classifier: %.3fs", fast_elapsed);
+}
+
+/*****************************************************************************/
+/* Ports talking to a fake modem through a pty */
+
+static MMPortSerialAt *
+open_pty_port (GType  port_type,
+               gint  *master)
+{
+    MMPortSerialAt    *port;
+    g_autoptr(GError)  error = NULL;
+    gint               slave;
+
+    *master = posix_openpt (O_RDWR | O_NOCTTY);
+    g_assert_cmpint (*master, >=, 0);
+    g_assert_cmpint (grantpt (*master), ==, 0);
+    g_assert_cmpint (unlockpt (*master), ==, 0);
+    slave = open (ptsname (*master), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    g_assert_cmpint (slave, >=, 0);
+
+    /* The port owns the slave fd from now on */
+    port = g_object_new (port_type,
+                         MM_PORT_DEVICE, "pts",
+                         MM_PORT_SUBSYS, MM_PORT_SUBSYS_TTY,
+                         MM_PORT_TYPE, MM_PORT_TYPE_AT,
+                         MM_PORT_SERIAL_FD, slave,
+                         MM_PORT_SERIAL_SEND_DELAY, (guint64) 0,
+                         MM_PORT_SERIAL_AT_INIT_SEQUENCE_ENABLED, FALSE,
+                         NULL);
+    mm_port_serial_at_set_response_parser (port,
+                                           mm_serial_parser_v1_parse,
+                                           mm_serial_parser_v1_reset,
+                                           mm_serial_parser_v1_new (),
+                                           mm_serial_parser_v1_destroy);
+    g_assert (mm_port_serial_open (MM_PORT_SERIAL (port), &error));
+    g_assert_no_error (error);
+    return port;
+}
+
+/*****************************************************************************/
+/* Late replies */
+
+/* Same as in the serial port */
+#define LATE_REPLY_WAIT_MS 200
+
+typedef enum {
+    LATE_REPLY_NONE,
+    LATE_REPLY_FULL,
+    /* Part of the reply right away, its final result after the wait */
+    LATE_REPLY_SPLIT,
+} LateReply;
+
+typedef struct {
+    LateReply       late_reply;
+    gint            master;
+    MMPortSerialAt *port;
+    /* Everything the port sent to the modem */
+    GString        *sent;
+    gint64          timed_out_time;
+    gint64          next_sent_time;
+    gchar          *next_response;
+    GError         *next_error;
+    gboolean        next_done;
+} LateReplyContext;
+
+static void
+fake_modem_write (LateReplyContext *ctx,
+                  const gchar      *data)
+{
+    g_assert_cmpint (write (ctx->master, data, strlen (data)), ==, (gssize) strlen (data));
+}
+
+static gboolean
+fake_modem_write_final_result (LateReplyContext *ctx)
+{
+    fake_modem_write (ctx, "\r\nOK\r\n");
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean
+fake_modem_readable (gint              fd,
+                     GIOCondition      condition,
+                     LateReplyContext *ctx)
+{
+    gchar   buffer[64];
+    gssize  n_read;
+
+    n_read = read (fd, buffer, sizeof (buffer));
+    if (n_read > 0)
+        g_string_append_len (ctx->sent, buffer, n_read);
+
+    /* +SLOW is never replied on time */
+    if (!ctx->next_sent_time && strstr (ctx->sent->str, "AT+NEXT")) {
+        ctx->next_sent_time = g_get_monotonic_time ();
+        fake_modem_write (ctx, "\r\n+NEXT: 1\r\n\r\nOK\r\n");
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static void
+next_ready (MMPortSerialAt   *port,
+            GAsyncResult     *res,
+            LateReplyContext *ctx)
+{
+    ctx->next_response = mm_port_serial_at_command_finish (port, res, &ctx->next_error);
+    ctx->next_done = TRUE;
+}
+
+static void
+slow_ready (MMPortSerialAt   *port,
+            GAsyncResult     *res,
+            LateReplyContext *ctx)
+{
+    g_autoptr(GError)  error = NULL;
+    g_autofree gchar  *response = NULL;
+
+    response = mm_port_serial_at_command_finish (port, res, &error);
+    g_assert_error (error, MM_SERIAL_ERROR, MM_SERIAL_ERROR_RESPONSE_TIMEOUT);
+    ctx->timed_out_time = g_get_monotonic_time ();
+
+    if (ctx->late_reply == LATE_REPLY_FULL)
+        fake_modem_write (ctx, "\r\nOK\r\n");
+    else if (ctx->late_reply == LATE_REPLY_SPLIT) {
+        fake_modem_write (ctx, "\r\n+SLOW: 1\r\n");
+        g_timeout_add (2 * LATE_REPLY_WAIT_MS, (GSourceFunc) fake_modem_write_final_result, ctx);
+    }
+
+    mm_port_serial_at_command (port, "+NEXT", 3, FALSE, FALSE, NULL, (GAsyncReadyCallback) next_ready, ctx);
+}
+
+static void
+_run_late_reply_test (LateReply late_reply)
+{
+    LateReplyContext ctx = { 0 };
+    guint            watch_id;
+
+    ctx.late_reply = late_reply;
+    ctx.sent = g_string_new (NULL);
+    ctx.port = open_pty_port (MM_TYPE_PORT_SERIAL_AT, &ctx.master);
+    watch_id = g_unix_fd_add (ctx.master, G_IO_IN, (GUnixFDSourceFunc) fake_modem_readable, &ctx);
+
+    mm_port_serial_at_command (ctx.port, "+SLOW", 1, FALSE, FALSE, NULL, (GAsyncReadyCallback) slow_ready, &ctx);
+    while (!ctx.next_done)
+        g_main_context_iteration (NULL, TRUE);
+
+    /* The late reply must not be taken as the reply to the next command */
+    g_assert_no_error (ctx.next_error);
+    g_assert_cmpstr (ctx.next_response, ==, "+NEXT: 1");
+
+    /* Without late reply, the next command is only sent once the wait is over;
+     * with part of the reply in, only once its final result is received */
+    g_assert_cmpint (ctx.next_sent_time, >, 0);
+    if (late_reply == LATE_REPLY_NONE)
+        g_assert_cmpint (ctx.next_sent_time - ctx.timed_out_time, >=, LATE_REPLY_WAIT_MS * 1000);
+    else if (late_reply == LATE_REPLY_SPLIT)
+        g_assert_cmpint (ctx.next_sent_time - ctx.timed_out_time, >=, 2 * LATE_REPLY_WAIT_MS * 1000);
+
+    mm_port_serial_close (MM_PORT_SERIAL (ctx.port));
+    g_object_unref (ctx.port);
+    g_source_remove (watch_id);
+    close (ctx.master);
+    g_string_free (ctx.sent, TRUE);
+    g_free (ctx.next_response);
+}
+
+static void
+at_serial_late_reply_discarded (void)
+{
+    _run_late_reply_test (LATE_REPLY_FULL);
+}
+
+static void
+at_serial_late_reply_split (void)
+{
+    _run_late_reply_test (LATE_REPLY_SPLIT);
+}
+
+static void
+at_serial_late_reply_wait_expired (void)
+{
+    _run_late_reply_test (LATE_REPLY_NONE);
+}
+
+/*****************************************************************************/
+/* Replies received in several reads */
+
+typedef struct {
+    gint            master;
+    GString        *sent;
+    const gchar   **chunks;
+    guint           n_chunks_written;
+    gchar          *response;
+    GError         *error;
+    gboolean        done;
+} SplitReplyContext;
+
+static gboolean
+split_reply_write_next_chunk (SplitReplyContext *ctx)
+{
+    const gchar *chunk;
+
+    chunk = ctx->chunks[ctx->n_chunks_written++];
+    g_assert_cmpint (write (ctx->master, chunk, strlen (chunk)), ==, (gssize) strlen (chunk));
+    return ctx->chunks[ctx->n_chunks_written] ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+}
+
+static gboolean
+split_reply_modem_readable (gint               fd,
+                            GIOCondition       condition,
+                            SplitReplyContext *ctx)
+{
+    gchar   buffer[64];
+    gssize  n_read;
+
+    n_read = read (fd, buffer, sizeof (buffer));
+    if (n_read > 0)
+        g_string_append_len (ctx->sent, buffer, n_read);
+
+    /* Reply in chunks far enough apart to be read separately */
+    if (!ctx->n_chunks_written && strchr (ctx->sent->str, '\r'))
+        g_timeout_add (20, (GSourceFunc) split_reply_write_next_chunk, ctx);
+    return G_SOURCE_CONTINUE;
+}
+
+static void
+split_reply_ready (MMPortSerialAt    *port,
+                   GAsyncResult      *res,
+                   SplitReplyContext *ctx)
+{
+    ctx->response = mm_port_serial_at_command_finish (port, res, &ctx->error);
+    ctx->done = TRUE;
+}
+
+static void
+_run_split_reply_test (const gchar **chunks,
+                       const gchar  *expected_response)
+{
+    SplitReplyContext  ctx = { 0 };
+    MMPortSerialAt    *port;
+    guint              watch_id;
+
+    ctx.chunks = chunks;
+    ctx.sent = g_string_new (NULL);
+    port = open_pty_port (MM_TYPE_PORT_SERIAL_AT, &ctx.master);
+    watch_id = g_unix_fd_add (ctx.master, G_IO_IN, (GUnixFDSourceFunc) split_reply_modem_readable, &ctx);
+
+    mm_port_serial_at_command (port, "+SPLIT", 3, FALSE, FALSE, NULL, (GAsyncReadyCallback) split_reply_ready, &ctx);
+    while (!ctx.done)
+        g_main_context_iteration (NULL, TRUE);
+    g_assert_cmpuint (ctx.n_chunks_written, ==, g_strv_length ((gchar **) chunks));
+
+    if (expected_response) {
+        g_assert_no_error (ctx.error);
+        g_assert_cmpstr (ctx.response, ==, expected_response);
+    } else
+        g_assert_error (ctx.error, MM_MOBILE_EQUIPMENT_ERROR, MM_MOBILE_EQUIPMENT_ERROR_SIM_NOT_INSERTED);
+
+    mm_port_serial_close (MM_PORT_SERIAL (port));
+    g_object_unref (port);
+    g_source_remove (watch_id);
+    close (ctx.master);
+    g_string_free (ctx.sent, TRUE);
+    g_free (ctx.response);
+    g_clear_error (&ctx.error);
+}
+
+static void
+at_serial_split_reply (void)
+{
+    const gchar *ok_chunks[] = {
+        "\r\n+SPLIT: 1,",
+        "2,3\r\n",
+        "\r\n+SPLIT: 4\r\n\r\nO",
+        "K\r\n",
+        NULL
+    };
+    const gchar *error_chunks[] = {
+        "\r\n+CME ERR",
+        "OR: 10\r\n",
+        NULL
+    };
+
+    _run_split_reply_test (ok_chunks, "+SPLIT: 1,2,3\r\n\r\n+SPLIT: 4");
+    _run_split_reply_test (error_chunks, NULL);
+}
+
+/*****************************************************************************/
+/* Reply cache */
+
+/* Port keeping all cached replies for one second */
+typedef MMPortSerialAt      TestPortSerialAt;
+typedef MMPortSerialAtClass TestPortSerialAtClass;
+
+G_DEFINE_TYPE (TestPortSerialAt, test_port_serial_at, MM_TYPE_PORT_SERIAL_AT)
+
+static guint
+test_port_serial_at_get_cached_reply_ttl (MMPortSerial     *self,
+                                          const GByteArray *command)
+{
+    return 1;
+}
+
+static void
+test_port_serial_at_init (TestPortSerialAt *self)
+{
+}
+
+static void
+test_port_serial_at_class_init (TestPortSerialAtClass *klass)
+{
+    MM_PORT_SERIAL_CLASS (klass)->get_cached_reply_ttl = test_port_serial_at_get_cached_reply_ttl;
+}
+
+typedef struct {
+    gint            master;
+    MMPortSerialAt *port;
+    /* Received and not yet replied */
+    GString        *received;
+    guint           n_commands;
+    gchar          *response;
+    gint64          send_time;
+    gboolean        done;
+} ReplyCacheContext;
+
+static gboolean
+counting_modem_readable (gint               fd,
+                         GIOCondition       condition,
+                         ReplyCacheContext *ctx)
+{
+    gchar   buffer[64];
+    gssize  n_read;
+    gchar  *end;
+
+    n_read = read (fd, buffer, sizeof (buffer));
+    if (n_read > 0)
+        g_string_append_len (ctx->received, buffer, n_read);
+
+    /* Every reply is different, so that cached ones can be told apart */
+    while ((end = strchr (ctx->received->str, '\r')) != NULL) {
+        g_autofree gchar *command = NULL;
+        g_autofree gchar *reply = NULL;
+
+        command = g_strndup (ctx->received->str, end - ctx->received->str);
+        g_string_erase (ctx->received, 0, end - ctx->received->str + 1);
+        g_assert (g_str_has_prefix (command, "AT"));
+
+        reply = g_strdup_printf ("\r\n%s: %u\r\n\r\nOK\r\n", command + 2, ++ctx->n_commands);
+        g_assert_cmpint (write (ctx->master, reply, strlen (reply)), ==, (gssize) strlen (reply));
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static void
+reply_cache_command_ready (MMPortSerialAt    *port,
+                           GAsyncResult      *res,
+                           ReplyCacheContext *ctx)
+{
+    g_autoptr(GError) error = NULL;
+
+    ctx->response = mm_port_serial_at_command_finish (port, res, &error);
+    g_assert_no_error (error);
+    ctx->send_time = mm_port_serial_at_command_get_send_time (port, res);
+    ctx->done = TRUE;
+}
+
+static void
+reply_cache_command (ReplyCacheContext *ctx,
+                     const gchar       *command,
+                     gboolean           allow_cached,
+                     const gchar       *expected_response)
+{
+    guint  n_commands;
+    gint64 start_time;
+
+    g_clear_pointer (&ctx->response, g_free);
+    ctx->done = FALSE;
+    n_commands = ctx->n_commands;
+    start_time = g_get_monotonic_time ();
+    mm_port_serial_at_command (ctx->port, command, 3, FALSE, allow_cached, NULL,
+                               (GAsyncReadyCallback) reply_cache_command_ready, ctx);
+    while (!ctx->done)
+        g_main_context_iteration (NULL, TRUE);
+    g_assert_cmpstr (ctx->response, ==, expected_response);
+
+    /* Only commands written to the port have a send time */
+    if (ctx->n_commands == n_commands)
+        g_assert_cmpint (ctx->send_time, ==, 0);
+    else
+        g_assert_cmpint (ctx->send_time, >=, start_time);
+}
+
+static void
+reply_cache_context_init (ReplyCacheContext *ctx,
+                          GType              port_type,
+                          guint             *watch_id)
+{
+    ctx->received = g_string_new (NULL);
+    ctx->port = open_pty_port (port_type, &ctx->master);
+    *watch_id = g_unix_fd_add (ctx->master, G_IO_IN, (GUnixFDSourceFunc) counting_modem_readable, ctx);
+}
+
+static void
+reply_cache_context_clear (ReplyCacheContext *ctx,
+                           guint              watch_id)
+{
+    mm_port_serial_close (MM_PORT_SERIAL (ctx->port));
+    g_object_unref (ctx->port);
+    g_source_remove (watch_id);
+    close (ctx->master);
+    g_string_free (ctx->received, TRUE);
+    g_free (ctx->response);
+}
+
+static guint
+get_cached_reply_ttl (MMPortSerialAt *port,
+                      const gchar    *command)
+{
+    g_autoptr(GByteArray) array = NULL;
+
+    array = g_byte_array_new ();
+    g_byte_array_append (array, (const guint8 *) command, strlen (command));
+    return MM_PORT_SERIAL_GET_CLASS (port)->get_cached_reply_ttl (MM_PORT_SERIAL (port), array);
+}
+
+static void
+at_serial_reply_cache_ttl (void)
+{
+    g_autoptr(MMPortSerialAt) port = NULL;
+
+    port = mm_port_serial_at_new ("ttyTEST0", MM_PORT_SUBSYS_TTY);
+
+    /* Test and identification commands, kept until the cache is cleared */
+    g_assert_cmpuint (get_cached_reply_ttl (port, "AT+CGDCONT=?\r"), ==, MM_PORT_SERIAL_CACHED_REPLY_TTL_FOREVER);
+    g_assert_cmpuint (get_cached_reply_ttl (port, "AT+CGMI\r"), ==, MM_PORT_SERIAL_CACHED_REPLY_TTL_FOREVER);
+    g_assert_cmpuint (get_cached_reply_ttl (port, "at+cgmr\r\n"), ==, MM_PORT_SERIAL_CACHED_REPLY_TTL_FOREVER);
+    g_assert_cmpuint (get_cached_reply_ttl (port, "ATI\r"), ==, MM_PORT_SERIAL_CACHED_REPLY_TTL_FOREVER);
+    g_assert_cmpuint (get_cached_reply_ttl (port, "AT+CLAC\r"), ==, MM_PORT_SERIAL_CACHED_REPLY_TTL_FOREVER);
+
+    /* Read and execute commands, which only expire */
+    g_assert_cmpuint (get_cached_reply_ttl (port, "AT+CGDCONT?\r"), >, 0);
+    g_assert_cmpuint (get_cached_reply_ttl (port, "AT+CGDCONT?\r"), !=, MM_PORT_SERIAL_CACHED_REPLY_TTL_FOREVER);
+    g_assert_cmpuint (get_cached_reply_ttl (port, "AT+CGMIX\r"), >, 0);
+    g_assert_cmpuint (get_cached_reply_ttl (port, "AT+CGMIX\r"), !=, MM_PORT_SERIAL_CACHED_REPLY_TTL_FOREVER);
+
+    /* Set and basic commands, never cached */
+    g_assert_cmpuint (get_cached_reply_ttl (port, "AT+CFUN=1\r"), ==, 0);
+    g_assert_cmpuint (get_cached_reply_ttl (port, "AT+CFUN=?1\r"), ==, 0);
+    g_assert_cmpuint (get_cached_reply_ttl (port, "ATZ\r"), ==, 0);
+    g_assert_cmpuint (get_cached_reply_ttl (port, "ATE0\r"), ==, 0);
+}
+
+static void
+at_serial_reply_cache_invalidation (void)
+{
+    ReplyCacheContext ctx = { 0 };
+    guint             watch_id;
+
+    reply_cache_context_init (&ctx, MM_TYPE_PORT_SERIAL_AT, &watch_id);
+
+    /* Replies only cached when allowed */
+    reply_cache_command (&ctx, "+CGMI", FALSE, "+CGMI: 1");
+    reply_cache_command (&ctx, "+CGMI", TRUE,  "+CGMI: 2");
+    reply_cache_command (&ctx, "+CGMI", TRUE,  "+CGMI: 2");
+    reply_cache_command (&ctx, "+CGMR", TRUE,  "+CGMR: 3");
+    g_assert_cmpuint (ctx.n_commands, ==, 3);
+
+    /* Asking for a fresh reply drops the cached one */
+    reply_cache_command (&ctx, "+CGMI", FALSE, "+CGMI: 4");
+    reply_cache_command (&ctx, "+CGMI", TRUE,  "+CGMI: 5");
+    reply_cache_command (&ctx, "+CGMR", TRUE,  "+CGMR: 3");
+
+    /* Cleared on device state changes */
+    mm_port_serial_clear_cached_replies (MM_PORT_SERIAL (ctx.port));
+    reply_cache_command (&ctx, "+CGMI", TRUE, "+CGMI: 6");
+    reply_cache_command (&ctx, "+CGMR", TRUE, "+CGMR: 7");
+    reply_cache_command (&ctx, "+CGMI", TRUE, "+CGMI: 6");
+    g_assert_cmpuint (ctx.n_commands, ==, 7);
+
+    reply_cache_context_clear (&ctx, watch_id);
+}
+
+static void
+at_serial_reply_cache_expired (void)
+{
+    ReplyCacheContext ctx = { 0 };
+    guint             watch_id;
+
+    reply_cache_context_init (&ctx, test_port_serial_at_get_type (), &watch_id);
+
+    reply_cache_command (&ctx, "+CSQ", TRUE, "+CSQ: 1");
+    reply_cache_command (&ctx, "+CSQ", TRUE, "+CSQ: 1");
+
+    /* A reply taken from the cache doesn't extend its lifetime */
+    g_usleep (G_USEC_PER_SEC / 2);
+    reply_cache_command (&ctx, "+CSQ", TRUE, "+CSQ: 1");
+    g_usleep (G_USEC_PER_SEC / 2 + G_USEC_PER_SEC / 10);
+    reply_cache_command (&ctx, "+CSQ", TRUE, "+CSQ: 2");
+    reply_cache_command (&ctx, "+CSQ", TRUE, "+CSQ: 2");
+    g_assert_cmpuint (ctx.n_commands, ==, 2);
+
+    reply_cache_context_clear (&ctx, watch_id);
+}
+
 int main (int argc, char **argv)
 {
     g_test_init (&argc, &argv, NULL);
@@ -156,6 +978,19 @@ int main (int argc, char **argv)
     g_test_add_func ("/ModemManager/AT-serial/echo-removal", at_serial_echo_removal);
     g_test_add_func ("/ModemManager/AT-serial/parse-ok", at_serial_parse_ok);
     g_test_add_func ("/ModemManager/AT-serial/parse-error", at_serial_parse_error);
+    g_test_add_func ("/ModemManager/AT-serial/parse-ok-regex", at_serial_parse_ok_regex);
+    g_test_add_func ("/ModemManager/AT-serial/parse-error-regex", at_serial_parse_error_regex);
+    g_test_add_func ("/ModemManager/AT-serial/parse-resume", at_serial_parse_resume);
+    g_test_add_func ("/ModemManager/AT-serial/parse-equivalence", at_serial_parse_equivalence);
+    g_test_add_func ("/ModemManager/AT-serial/parse-benchmark", at_serial_parse_benchmark);
+    g_test_add_func ("/ModemManager/AT-serial/parse-unsolicited", at_serial_parse_unsolicited);
+    g_test_add_func ("/ModemManager/AT-serial/split-reply", at_serial_split_reply);
+    g_test_add_func ("/ModemManager/AT-serial/late-reply-discarded", at_serial_late_reply_discarded);
+    g_test_add_func ("/ModemManager/AT-serial/late-reply-split", at_serial_late_reply_split);
+    g_test_add_func ("/ModemManager/AT-serial/late-reply-wait-expired", at_serial_late_reply_wait_expired);
+    g_test_add_func ("/ModemManager/AT-serial/reply-cache-ttl", at_serial_reply_cache_ttl);
+    g_test_add_func ("/ModemManager/AT-serial/reply-cache-invalidation", at_serial_reply_cache_invalidation);
+    g_test_add_func ("/ModemManager/AT-serial/reply-cache-expired", at_serial_reply_cache_expired);
 
     return g_test_run ();
 }
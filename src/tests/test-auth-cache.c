@@ -0,0 +1,134 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <glib.h>
+
+#include "mm-auth-cache.h"
+
+#define SENDER_A  ":1.10"
+#define SENDER_B  ":1.11"
+#define CONTROL   "org.freedesktop.ModemManager1.Control"
+#define DEVICE    "org.freedesktop.ModemManager1.Device.Control"
+
+/*****************************************************************************/
+
+static void
+test_implicit (void)
+{
+    g_autoptr(MMAuthCache) cache = NULL;
+
+    cache = mm_auth_cache_new (30000);
+    g_assert (!mm_auth_cache_lookup (cache, SENDER_A, CONTROL));
+    g_assert (mm_auth_cache_add (cache, SENDER_A, CONTROL, MM_AUTH_GRANT_IMPLICIT));
+    g_assert (mm_auth_cache_lookup (cache, SENDER_A, CONTROL));
+    g_assert_cmpuint (mm_auth_cache_get_n_senders (cache), ==, 1);
+}
+
+static void
+test_challenge_not_cached (void)
+{
+    g_autoptr(MMAuthCache) cache = NULL;
+
+    /* e.g. auth_admin: the user must authenticate on every request */
+    cache = mm_auth_cache_new (30000);
+    g_assert (!mm_auth_cache_add (cache, SENDER_A, CONTROL, MM_AUTH_GRANT_CHALLENGE));
+    g_assert (!mm_auth_cache_lookup (cache, SENDER_A, CONTROL));
+    g_assert_cmpuint (mm_auth_cache_get_n_senders (cache), ==, 0);
+}
+
+static void
+test_challenge_retained (void)
+{
+    g_autoptr(MMAuthCache) cache = NULL;
+
+    /* e.g. auth_admin_keep: the authority itself remembers the decision */
+    cache = mm_auth_cache_new (30000);
+    g_assert (mm_auth_cache_add (cache, SENDER_A, CONTROL, MM_AUTH_GRANT_CHALLENGE_RETAINED));
+    g_assert (mm_auth_cache_lookup (cache, SENDER_A, CONTROL));
+}
+
+static void
+test_no_sender (void)
+{
+    g_autoptr(MMAuthCache) cache = NULL;
+
+    /* Peer-to-peer connections have no unique name */
+    cache = mm_auth_cache_new (30000);
+    g_assert (!mm_auth_cache_add (cache, NULL, CONTROL, MM_AUTH_GRANT_IMPLICIT));
+    g_assert (!mm_auth_cache_lookup (cache, NULL, CONTROL));
+}
+
+static void
+test_isolation (void)
+{
+    g_autoptr(MMAuthCache) cache = NULL;
+
+    cache = mm_auth_cache_new (30000);
+    g_assert (mm_auth_cache_add (cache, SENDER_A, CONTROL, MM_AUTH_GRANT_IMPLICIT));
+    g_assert (!mm_auth_cache_lookup (cache, SENDER_A, DEVICE));
+    g_assert (!mm_auth_cache_lookup (cache, SENDER_B, CONTROL));
+}
+
+static void
+test_expiry (void)
+{
+    g_autoptr(MMAuthCache) cache = NULL;
+
+    cache = mm_auth_cache_new (50);
+    g_assert (mm_auth_cache_add (cache, SENDER_A, CONTROL, MM_AUTH_GRANT_IMPLICIT));
+    g_assert (mm_auth_cache_lookup (cache, SENDER_A, CONTROL));
+    g_usleep (100 * G_TIME_SPAN_MILLISECOND);
+    g_assert (!mm_auth_cache_lookup (cache, SENDER_A, CONTROL));
+    /* the sender is gone once all its entries expired */
+    g_assert_cmpuint (mm_auth_cache_get_n_senders (cache), ==, 0);
+}
+
+static void
+test_remove_sender (void)
+{
+    g_autoptr(MMAuthCache) cache = NULL;
+
+    cache = mm_auth_cache_new (30000);
+    g_assert (mm_auth_cache_add (cache, SENDER_A, CONTROL, MM_AUTH_GRANT_IMPLICIT));
+    g_assert (mm_auth_cache_add (cache, SENDER_A, DEVICE, MM_AUTH_GRANT_IMPLICIT));
+    g_assert (mm_auth_cache_add (cache, SENDER_B, CONTROL, MM_AUTH_GRANT_IMPLICIT));
+    g_assert_cmpuint (mm_auth_cache_get_n_senders (cache), ==, 2);
+
+    g_assert (mm_auth_cache_remove_sender (cache, SENDER_A));
+    g_assert (!mm_auth_cache_remove_sender (cache, SENDER_A));
+    g_assert (!mm_auth_cache_lookup (cache, SENDER_A, CONTROL));
+    g_assert (!mm_auth_cache_lookup (cache, SENDER_A, DEVICE));
+    g_assert (mm_auth_cache_lookup (cache, SENDER_B, CONTROL));
+
+    mm_auth_cache_clear (cache);
+    g_assert (!mm_auth_cache_lookup (cache, SENDER_B, CONTROL));
+    g_assert_cmpuint (mm_auth_cache_get_n_senders (cache), ==, 0);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/MM/auth-cache/implicit",           test_implicit);
+    g_test_add_func ("/MM/auth-cache/challenge",          test_challenge_not_cached);
+    g_test_add_func ("/MM/auth-cache/challenge-retained", test_challenge_retained);
+    g_test_add_func ("/MM/auth-cache/no-sender",          test_no_sender);
+    g_test_add_func ("/MM/auth-cache/isolation",          test_isolation);
+    g_test_add_func ("/MM/auth-cache/expiry",             test_expiry);
+    g_test_add_func ("/MM/auth-cache/remove-sender",      test_remove_sender);
+
+    return g_test_run ();
+}
@@ -0,0 +1,400 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <ModemManager.h>
+#include "mm-errors-types.h"
+#include "mm-bearer-status-wait.h"
+#include "mm-log-test.h"
+
+#define MAX_CHECKS 64
+
+/*****************************************************************************/
+
+typedef struct {
+    GMainLoop                *loop;
+    GObject                  *source;
+    MMBearerStatusWait       *wait;
+    /* Status reported by every check; UNKNOWN fails the check */
+    MMBearerConnectionStatus  check_status;
+    gboolean                  check_error;
+    gint64                    start;
+    gint64                    check_times[MAX_CHECKS];
+    guint                     n_checks;
+    /* Result of the wait */
+    gboolean                  completed;
+    gboolean                  success;
+    GError                   *error;
+    gint64                    end;
+} TestContext;
+
+static TestContext *
+test_context_new (guint initial_interval_ms,
+                  guint max_interval_ms)
+{
+    TestContext *ctx;
+
+    ctx = g_new0 (TestContext, 1);
+    ctx->loop = g_main_loop_new (NULL, FALSE);
+    ctx->source = g_object_new (G_TYPE_OBJECT, NULL);
+    ctx->wait = mm_bearer_status_wait_new (ctx->source, initial_interval_ms, max_interval_ms);
+    ctx->check_status = MM_BEARER_CONNECTION_STATUS_DISCONNECTED;
+    ctx->start = g_get_monotonic_time ();
+    return ctx;
+}
+
+static void
+test_context_free (TestContext *ctx)
+{
+    g_assert (!mm_bearer_status_wait_is_running (ctx->wait));
+    mm_bearer_status_wait_free (ctx->wait);
+    g_object_unref (ctx->source);
+    g_main_loop_unref (ctx->loop);
+    g_clear_error (&ctx->error);
+    g_free (ctx);
+}
+
+static gboolean
+check_complete (GTask *task)
+{
+    TestContext *ctx;
+
+    ctx = g_task_get_task_data (task);
+    if (ctx->check_status == MM_BEARER_CONNECTION_STATUS_UNKNOWN && ctx->check_error)
+        g_task_return_new_error (task, MM_CORE_ERROR, MM_CORE_ERROR_FAILED, "check failed");
+    else
+        g_task_return_int (task, ctx->check_status);
+    g_object_unref (task);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+check (GObject             *source,
+       TestContext         *ctx,
+       GAsyncReadyCallback  callback,
+       gpointer             user_data)
+{
+    GTask *task;
+
+    g_assert_cmpuint (ctx->n_checks, <, MAX_CHECKS);
+    ctx->check_times[ctx->n_checks++] = g_get_monotonic_time ();
+
+    task = g_task_new (source, NULL, callback, user_data);
+    g_task_set_task_data (task, ctx, NULL);
+    g_idle_add ((GSourceFunc) check_complete, task);
+}
+
+static MMBearerConnectionStatus
+check_finish (GObject       *source,
+              GAsyncResult  *res,
+              GError       **error)
+{
+    GError *inner_error = NULL;
+    gssize  status;
+
+    status = g_task_propagate_int (G_TASK (res), &inner_error);
+    if (inner_error) {
+        g_propagate_error (error, inner_error);
+        return MM_BEARER_CONNECTION_STATUS_UNKNOWN;
+    }
+    return (MMBearerConnectionStatus) status;
+}
+
+static void
+wait_ready (GObject      *source,
+            GAsyncResult *res,
+            TestContext  *ctx)
+{
+    ctx->completed = TRUE;
+    ctx->end = g_get_monotonic_time ();
+    ctx->success = mm_bearer_status_wait_run_finish (res, &ctx->error);
+    g_main_loop_quit (ctx->loop);
+}
+
+static void
+run_wait (TestContext              *ctx,
+          MMBearerConnectionStatus  status,
+          guint                     first_check_delay_ms,
+          guint                     timeout_ms,
+          GCancellable             *cancellable)
+{
+    mm_bearer_status_wait_run (ctx->wait,
+                               status,
+                               first_check_delay_ms,
+                               timeout_ms,
+                               (MMBearerStatusWaitCheckFn) check,
+                               (MMBearerStatusWaitCheckFinishFn) check_finish,
+                               ctx,
+                               cancellable,
+                               (GAsyncReadyCallback) wait_ready,
+                               ctx);
+    g_assert (mm_bearer_status_wait_is_running (ctx->wait));
+}
+
+static gboolean
+quit_loop_cb (TestContext *ctx)
+{
+    g_main_loop_quit (ctx->loop);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+iterate (TestContext *ctx,
+         guint        ms)
+{
+    GSource *source;
+
+    /* The wait may complete, and quit the loop, before the timeout */
+    source = g_timeout_source_new (ms);
+    g_source_set_callback (source, (GSourceFunc) quit_loop_cb, ctx, NULL);
+    g_source_attach (source, NULL);
+    g_main_loop_run (ctx->loop);
+    g_source_destroy (source);
+    g_source_unref (source);
+}
+
+/*****************************************************************************/
+
+static void
+test_check (void)
+{
+    TestContext *ctx;
+
+    /* Already in the expected status, complete on the first check */
+    ctx = test_context_new (1000, 1000);
+    ctx->check_status = MM_BEARER_CONNECTION_STATUS_CONNECTED;
+    run_wait (ctx, MM_BEARER_CONNECTION_STATUS_CONNECTED, 0, 10000, NULL);
+    g_main_loop_run (ctx->loop);
+
+    g_assert (ctx->completed);
+    g_assert_no_error (ctx->error);
+    g_assert (ctx->success);
+    g_assert_cmpuint (ctx->n_checks, ==, 1);
+    test_context_free (ctx);
+}
+
+static void
+test_report (void)
+{
+    TestContext *ctx;
+
+    ctx = test_context_new (1000, 1000);
+    run_wait (ctx, MM_BEARER_CONNECTION_STATUS_CONNECTED, 0, 10000, NULL);
+    iterate (ctx, 50);
+    g_assert_cmpuint (ctx->n_checks, ==, 1);
+    g_assert (!ctx->completed);
+
+    /* Other reports are left to the caller */
+    g_assert (!mm_bearer_status_wait_report (ctx->wait, MM_BEARER_CONNECTION_STATUS_DISCONNECTING));
+    g_assert (mm_bearer_status_wait_is_running (ctx->wait));
+
+    /* The expected one completes the wait right away */
+    g_assert (mm_bearer_status_wait_report (ctx->wait, MM_BEARER_CONNECTION_STATUS_CONNECTED));
+    g_assert (!mm_bearer_status_wait_is_running (ctx->wait));
+    g_main_loop_run (ctx->loop);
+    g_assert (ctx->completed);
+    g_assert (ctx->success);
+    g_assert_cmpint (ctx->end - ctx->start, <, 500 * G_TIME_SPAN_MILLISECOND);
+
+    /* No wait, nothing consumed */
+    g_assert (!mm_bearer_status_wait_report (ctx->wait, MM_BEARER_CONNECTION_STATUS_CONNECTED));
+    test_context_free (ctx);
+}
+
+static void
+test_report_connection_failed (void)
+{
+    TestContext *ctx;
+
+    ctx = test_context_new (1000, 1000);
+    run_wait (ctx, MM_BEARER_CONNECTION_STATUS_CONNECTED, 0, 10000, NULL);
+    g_assert (mm_bearer_status_wait_report (ctx->wait, MM_BEARER_CONNECTION_STATUS_CONNECTION_FAILED));
+    g_main_loop_run (ctx->loop);
+    g_assert (ctx->completed);
+    g_assert (!ctx->success);
+    g_assert_error (ctx->error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED);
+    test_context_free (ctx);
+}
+
+static void
+test_backoff (void)
+{
+    TestContext *ctx;
+    guint        i;
+
+    /* Checks at 0, 20, 60, 140, 220... until the deadline */
+    ctx = test_context_new (20, 80);
+    run_wait (ctx, MM_BEARER_CONNECTION_STATUS_CONNECTED, 0, 400, NULL);
+    g_main_loop_run (ctx->loop);
+
+    g_assert (!ctx->success);
+    g_assert_error (ctx->error, MM_MOBILE_EQUIPMENT_ERROR, MM_MOBILE_EQUIPMENT_ERROR_NETWORK_TIMEOUT);
+    g_assert_cmpint (ctx->end - ctx->start, >=, 400 * G_TIME_SPAN_MILLISECOND);
+    g_assert_cmpuint (ctx->n_checks, >=, 4);
+    g_assert_cmpuint (ctx->n_checks, <=, 10);
+
+    /* Timers never fire early, so the intervals are lower bounds; the last
+     * ones are cut short by the deadline */
+    g_assert_cmpint (ctx->check_times[1] - ctx->check_times[0], >=, 20 * G_TIME_SPAN_MILLISECOND);
+    g_assert_cmpint (ctx->check_times[2] - ctx->check_times[1], >=, 40 * G_TIME_SPAN_MILLISECOND);
+    for (i = 3; i < ctx->n_checks - 2; i++)
+        g_assert_cmpint (ctx->check_times[i] - ctx->check_times[i - 1], >=, 80 * G_TIME_SPAN_MILLISECOND);
+    test_context_free (ctx);
+}
+
+static void
+test_report_restarts_backoff (void)
+{
+    TestContext *ctx;
+    guint        n_checks;
+
+    ctx = test_context_new (40, 2000);
+    run_wait (ctx, MM_BEARER_CONNECTION_STATUS_CONNECTED, 0, 10000, NULL);
+
+    /* Checks at 0, 40, 120, 280; next one after 320ms more */
+    iterate (ctx, 300);
+    n_checks = ctx->n_checks;
+    g_assert_cmpuint (n_checks, ==, 4);
+
+    /* A stale report triggers a check right away */
+    g_assert (!mm_bearer_status_wait_report (ctx->wait, MM_BEARER_CONNECTION_STATUS_DISCONNECTED));
+    iterate (ctx, 20);
+    g_assert_cmpuint (ctx->n_checks, ==, n_checks + 1);
+
+    ctx->check_status = MM_BEARER_CONNECTION_STATUS_CONNECTED;
+    iterate (ctx, 100);
+    g_assert (ctx->completed);
+    g_assert (ctx->success);
+    test_context_free (ctx);
+}
+
+static void
+test_first_check_delay (void)
+{
+    TestContext *ctx;
+
+    ctx = test_context_new (1000, 1000);
+    ctx->check_status = MM_BEARER_CONNECTION_STATUS_DISCONNECTED;
+    run_wait (ctx, MM_BEARER_CONNECTION_STATUS_DISCONNECTED, 100, 10000, NULL);
+
+    /* Reports during the delay don't trigger any check */
+    g_assert (!mm_bearer_status_wait_report (ctx->wait, MM_BEARER_CONNECTION_STATUS_CONNECTED));
+    iterate (ctx, 50);
+    g_assert_cmpuint (ctx->n_checks, ==, 0);
+
+    g_main_loop_run (ctx->loop);
+    g_assert (ctx->success);
+    g_assert_cmpuint (ctx->n_checks, ==, 1);
+    g_assert_cmpint (ctx->check_times[0] - ctx->start, >=, 100 * G_TIME_SPAN_MILLISECOND);
+    test_context_free (ctx);
+}
+
+static void
+test_cancel (void)
+{
+    TestContext  *ctx;
+    GCancellable *cancellable;
+
+    ctx = test_context_new (1000, 1000);
+    cancellable = g_cancellable_new ();
+    run_wait (ctx, MM_BEARER_CONNECTION_STATUS_CONNECTED, 0, 10000, cancellable);
+    iterate (ctx, 50);
+    g_assert (!ctx->completed);
+
+    /* Completes right away, without waiting for the next check */
+    g_cancellable_cancel (cancellable);
+    g_main_loop_run (ctx->loop);
+    g_assert (!ctx->success);
+    g_assert_error (ctx->error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+    g_assert_cmpint (ctx->end - ctx->start, <, 500 * G_TIME_SPAN_MILLISECOND);
+    g_assert_cmpuint (ctx->n_checks, ==, 1);
+
+    /* Late reports are ignored */
+    g_assert (!mm_bearer_status_wait_report (ctx->wait, MM_BEARER_CONNECTION_STATUS_CONNECTED));
+    g_object_unref (cancellable);
+    test_context_free (ctx);
+}
+
+static void
+test_cancel_before_run (void)
+{
+    TestContext  *ctx;
+    GCancellable *cancellable;
+
+    ctx = test_context_new (1000, 1000);
+    cancellable = g_cancellable_new ();
+    g_cancellable_cancel (cancellable);
+    run_wait (ctx, MM_BEARER_CONNECTION_STATUS_CONNECTED, 0, 10000, cancellable);
+    g_main_loop_run (ctx->loop);
+    g_assert_error (ctx->error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+    g_object_unref (cancellable);
+
+    /* Let the first check, if any, finish */
+    iterate (ctx, 20);
+    test_context_free (ctx);
+}
+
+static void
+check_failures (gboolean with_error)
+{
+    TestContext *ctx;
+
+    ctx = test_context_new (1, 1);
+    ctx->check_status = MM_BEARER_CONNECTION_STATUS_UNKNOWN;
+    ctx->check_error = with_error;
+    run_wait (ctx, MM_BEARER_CONNECTION_STATUS_CONNECTED, 0, 10000, NULL);
+    g_main_loop_run (ctx->loop);
+
+    /* Failed checks are retried a few times before giving up; the error is
+     * optional */
+    g_assert (!ctx->success);
+    g_assert_error (ctx->error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED);
+    g_assert_cmpuint (ctx->n_checks, >, 1);
+    g_assert_cmpint (ctx->end - ctx->start, <, 5 * G_TIME_SPAN_SECOND);
+    test_context_free (ctx);
+}
+
+static void
+test_check_failures (void)
+{
+    check_failures (TRUE);
+}
+
+static void
+test_check_failures_no_error (void)
+{
+    check_failures (FALSE);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/MM/bearer-status-wait/check",                    test_check);
+    g_test_add_func ("/MM/bearer-status-wait/report",                   test_report);
+    g_test_add_func ("/MM/bearer-status-wait/report-connection-failed", test_report_connection_failed);
+    g_test_add_func ("/MM/bearer-status-wait/backoff",                  test_backoff);
+    g_test_add_func ("/MM/bearer-status-wait/report-restarts-backoff",  test_report_restarts_backoff);
+    g_test_add_func ("/MM/bearer-status-wait/first-check-delay",        test_first_check_delay);
+    g_test_add_func ("/MM/bearer-status-wait/cancel",                   test_cancel);
+    g_test_add_func ("/MM/bearer-status-wait/cancel-before-run",        test_cancel_before_run);
+    g_test_add_func ("/MM/bearer-status-wait/check-failures",           test_check_failures);
+    g_test_add_func ("/MM/bearer-status-wait/check-failures-no-error",  test_check_failures_no_error);
+
+    return g_test_run ();
+}
@@ -713,6 +713,279 @@ test_text_split_two_pdu_utf16 (void)
     common_test_text_split (text, expected, MM_MODEM_CHARSET_UTF16);
 }
 
+/*****************************************************************************/
+/* Randomized tests, comparing against straightforward reference implementations */
+
+#define RANDOM_TEST_ITERATIONS 2000
+
+static void
+reference_gsm_pack (const guint8 *src,
+                    guint32       src_len,
+                    guint8        start_offset,
+                    guint8       *packed)
+{
+    guint32 i;
+    guint   j;
+
+    /* One bit at a time */
+    for (i = 0; i < src_len; i++) {
+        for (j = 0; j < 7; j++) {
+            guint32 bit;
+
+            bit = start_offset + (i * 7) + j;
+            if (src[i] & (1 << j))
+                packed[bit / 8] |= 1 << (bit % 8);
+        }
+    }
+}
+
+static void
+test_gsm7_pack_unpack_random (void)
+{
+    guint n;
+
+    for (n = 0; n < RANDOM_TEST_ITERATIONS; n++) {
+        g_autofree guint8 *src = NULL;
+        g_autofree guint8 *expected = NULL;
+        g_autofree guint8 *packed = NULL;
+        g_autofree guint8 *unpacked = NULL;
+        guint32            src_len;
+        guint32            packed_len = 0;
+        guint32            unpacked_len = 0;
+        guint8             start_offset;
+        guint32            i;
+
+        src_len = g_test_rand_int_range (0, 200);
+        start_offset = g_test_rand_int_range (0, 8);
+        src = g_malloc (src_len + 1);
+        for (i = 0; i < src_len; i++)
+            src[i] = g_test_rand_int_range (0, 128);
+
+        expected = g_malloc0 ((src_len * 7 + start_offset + 7) / 8 + 1);
+        reference_gsm_pack (src, src_len, start_offset, expected);
+
+        packed = mm_charset_gsm_pack (src, src_len, start_offset, &packed_len);
+        g_assert_cmpuint (packed_len, ==, (src_len * 7 + start_offset + 7) / 8);
+        g_assert_cmpmem (packed, packed_len, expected, packed_len);
+
+        unpacked = mm_charset_gsm_unpack (packed, src_len, start_offset, &unpacked_len);
+        g_assert_cmpmem (unpacked, unpacked_len, src, src_len);
+    }
+}
+
+static gunichar
+random_unichar (gboolean bmp_only)
+{
+    gunichar c;
+
+    /* Mostly ASCII and BMP chars, sometimes out of the BMP */
+    do {
+        switch (g_test_rand_int_range (0, bmp_only ? 3 : 4)) {
+            case 0:
+                c = g_test_rand_int_range (0x01, 0x80);
+                break;
+            case 1:
+                c = g_test_rand_int_range (0x80, 0x800);
+                break;
+            case 2:
+                c = g_test_rand_int_range (0x800, 0x10000);
+                break;
+            default:
+                c = g_test_rand_int_range (0x10000, 0x110000);
+                break;
+        }
+    } while (!g_unichar_validate (c));
+
+    return c;
+}
+
+static void
+common_test_utf16_random (MMModemCharset  charset,
+                          const gchar    *iconv_name)
+{
+    guint n;
+
+    for (n = 0; n < RANDOM_TEST_ITERATIONS; n++) {
+        g_autoptr(GString)    str = NULL;
+        g_autoptr(GByteArray) encoded = NULL;
+        g_autofree gchar     *expected = NULL;
+        g_autofree gchar     *decoded = NULL;
+        g_autoptr(GError)     error = NULL;
+        gsize                 expected_len = 0;
+        guint                 len;
+        guint                 i;
+
+        str = g_string_new (NULL);
+        len = g_test_rand_int_range (0, 100);
+        for (i = 0; i < len; i++)
+            g_string_append_unichar (str, random_unichar (charset == MM_MODEM_CHARSET_UCS2));
+
+        /* Compare against the iconv based conversion */
+        expected = g_convert (str->str, -1, iconv_name, "UTF-8", NULL, &expected_len, &error);
+        g_assert_no_error (error);
+
+        encoded = mm_modem_charset_bytearray_from_utf8 (str->str, charset, FALSE, &error);
+        g_assert_no_error (error);
+        g_assert_cmpmem (encoded->data, encoded->len, expected, expected_len);
+
+        decoded = mm_modem_charset_bytearray_to_utf8 (encoded, charset, FALSE, &error);
+        g_assert_no_error (error);
+        g_assert_cmpstr (decoded, ==, str->str);
+    }
+}
+
+static void
+test_ucs2_random (void)
+{
+    common_test_utf16_random (MM_MODEM_CHARSET_UCS2, "UCS-2BE");
+}
+
+static void
+test_utf16_random (void)
+{
+    common_test_utf16_random (MM_MODEM_CHARSET_UTF16, "UTF-16BE");
+}
+
+static void
+test_gsm7_random (void)
+{
+    /* All chars of the default and extended alphabets, except for '@', as
+     * trailing ones would be taken as padding */
+    static const gchar *alphabet =
+        "£$¥èéùìòÇ\nØø\rÅåΔ_ΦΓΛΩΠΨΣΘΞÆæßÉ !\"#¤%&'()*+,-./0123456789:;<=>?¡ABCDEFGHIJKLMNOPQRSTUVWXYZÄÖÑÜ§¿abcdefghijklmnopqrstuvwxyzäöñüà"
+        "\f^{}\\[~]|€";
+    glong alphabet_len;
+    guint n;
+
+    alphabet_len = g_utf8_strlen (alphabet, -1);
+
+    for (n = 0; n < RANDOM_TEST_ITERATIONS; n++) {
+        g_autoptr(GString) str = NULL;
+        guint              len;
+        guint              i;
+
+        str = g_string_new (NULL);
+        len = g_test_rand_int_range (1, 100);
+        for (i = 0; i < len; i++)
+            g_string_append_unichar (str, g_utf8_get_char (g_utf8_offset_to_pointer (alphabet, g_test_rand_int_range (0, alphabet_len))));
+
+        common_test_gsm7 (str->str);
+    }
+}
+
+static void
+test_to_utf8_random_input (void)
+{
+    static const MMModemCharset charsets[] = {
+        MM_MODEM_CHARSET_GSM,
+        MM_MODEM_CHARSET_IRA,
+        MM_MODEM_CHARSET_UCS2,
+        MM_MODEM_CHARSET_UTF16,
+        MM_MODEM_CHARSET_8859_1,
+    };
+    guint n;
+
+    /* Arbitrary input must never crash, and with transliteration enabled
+     * the output must always be valid UTF-8 (odd lengths are not valid in
+     * UCS-2 and UTF-16, though) */
+    for (n = 0; n < RANDOM_TEST_ITERATIONS; n++) {
+        g_autoptr(GByteArray) input = NULL;
+        MMModemCharset        charset;
+        guint                 len;
+        guint                 i;
+
+        charset = charsets[g_test_rand_int_range (0, G_N_ELEMENTS (charsets))];
+        len = g_test_rand_int_range (0, 64);
+        input = g_byte_array_sized_new (len);
+        for (i = 0; i < len; i++) {
+            guint8 byte;
+
+            byte = (charset == MM_MODEM_CHARSET_GSM) ? g_test_rand_int_range (0, 0x80) : g_test_rand_int_range (0, 0x100);
+            g_byte_array_append (input, &byte, 1);
+        }
+
+        for (i = 0; i < 2; i++) {
+            g_autofree gchar  *utf8 = NULL;
+            g_autoptr(GError)  error = NULL;
+
+            utf8 = mm_modem_charset_bytearray_to_utf8 (input, charset, (gboolean) i, &error);
+            if (i && ((charset != MM_MODEM_CHARSET_UCS2 && charset != MM_MODEM_CHARSET_UTF16) || !(len % 2))) {
+                g_assert_no_error (error);
+                g_assert_nonnull (utf8);
+            }
+            g_assert (utf8 ? !error : !!error);
+            if (utf8)
+                g_assert (g_utf8_validate (utf8, -1, NULL));
+        }
+    }
+}
+
+/*****************************************************************************/
+/* Benchmark */
+
+#define BENCHMARK_ITERATIONS 100000
+
+static void
+test_charsets_benchmark (void)
+{
+    /* A full single-part SMS in each encoding */
+    static const gchar *text_gsm7 =
+        "The quick brown fox jumps over the lazy dog {100€} and keeps on running until the end of the message is reached... Åå ÆæØø ÄäÖöÜü Ññ Ψ Ω Δ";
+    static const gchar *text_ucs2 =
+        "Быстрая коричневая лиса прыгает через ленивую собаку; 敏捷的棕色狐狸跳过了懒狗";
+    g_autoptr(GByteArray)  unpacked = NULL;
+    g_autoptr(GByteArray)  ucs2 = NULL;
+    g_autoptr(GError)      error = NULL;
+    gdouble                elapsed;
+    guint                  i;
+
+    if (!g_test_perf ()) {
+        g_test_skip ("only run in perf mode");
+        return;
+    }
+
+    unpacked = mm_modem_charset_bytearray_from_utf8 (text_gsm7, MM_MODEM_CHARSET_GSM, FALSE, &error);
+    g_assert_no_error (error);
+    ucs2 = mm_modem_charset_bytearray_from_utf8 (text_ucs2, MM_MODEM_CHARSET_UCS2, FALSE, &error);
+    g_assert_no_error (error);
+
+    g_test_timer_start ();
+    for (i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        g_autofree guint8 *packed = NULL;
+        g_autofree guint8 *unpacked_2 = NULL;
+        guint32            packed_len;
+        guint32            unpacked_len;
+
+        packed = mm_charset_gsm_pack (unpacked->data, unpacked->len, 0, &packed_len);
+        unpacked_2 = mm_charset_gsm_unpack (packed, unpacked->len, 0, &unpacked_len);
+    }
+    elapsed = g_test_timer_elapsed ();
+    g_test_message ("GSM-7 pack/unpack: %u iterations in %.3fs", BENCHMARK_ITERATIONS, elapsed);
+
+    g_test_timer_start ();
+    for (i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        g_autoptr(GByteArray) encoded = NULL;
+        g_autofree gchar     *decoded = NULL;
+
+        encoded = mm_modem_charset_bytearray_from_utf8 (text_gsm7, MM_MODEM_CHARSET_GSM, FALSE, NULL);
+        decoded = mm_modem_charset_bytearray_to_utf8 (encoded, MM_MODEM_CHARSET_GSM, FALSE, NULL);
+    }
+    elapsed = g_test_timer_elapsed ();
+    g_test_message ("GSM-7 <-> UTF-8: %u iterations in %.3fs", BENCHMARK_ITERATIONS, elapsed);
+
+    g_test_timer_start ();
+    for (i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        g_autoptr(GByteArray) encoded = NULL;
+        g_autofree gchar     *decoded = NULL;
+
+        encoded = mm_modem_charset_bytearray_from_utf8 (text_ucs2, MM_MODEM_CHARSET_UCS2, FALSE, NULL);
+        decoded = mm_modem_charset_bytearray_to_utf8 (encoded, MM_MODEM_CHARSET_UCS2, FALSE, NULL);
+    }
+    elapsed = g_test_timer_elapsed ();
+    g_test_message ("UCS-2 <-> UTF-8: %u iterations in %.3fs", BENCHMARK_ITERATIONS, elapsed);
+    g_test_minimized_result (elapsed, "%.3f s", elapsed);
+}
+
 int main (int argc, char **argv)
 {
     setlocale (LC_ALL, "");
@@ -752,5 +1025,13 @@ int main (int argc, char **argv)
     g_test_add_func ("/MM/charsets/text-split/ucs2/two-pdu",                        test_text_split_two_pdu_ucs2);
     g_test_add_func ("/MM/charsets/text-split/utf16/two-pdu",                       test_text_split_two_pdu_utf16);
 
+    g_test_add_func ("/MM/charsets/random/gsm7-pack-unpack", test_gsm7_pack_unpack_random);
+    g_test_add_func ("/MM/charsets/random/gsm7",             test_gsm7_random);
+    g_test_add_func ("/MM/charsets/random/ucs2",             test_ucs2_random);
+    g_test_add_func ("/MM/charsets/random/utf16",            test_utf16_random);
+    g_test_add_func ("/MM/charsets/random/to-utf8-input",    test_to_utf8_random_input);
+
+    g_test_add_func ("/MM/charsets/benchmark", test_charsets_benchmark);
+
     return g_test_run ();
 }
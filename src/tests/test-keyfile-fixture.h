@@ -0,0 +1,73 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#ifndef TEST_KEYFILE_FIXTURE_H
+#define TEST_KEYFILE_FIXTURE_H
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <glib-object.h>
+
+/* Common fixture for the tests of the caches kept in a key file on disk
+ * (see MMKeyfileStore): each test gets a path in its own temporary
+ * directory, which is removed with all its contents afterwards. */
+
+typedef struct {
+    gchar *dir;
+    gchar *path;
+} Fixture;
+
+static void
+fixture_setup (Fixture       *fixture,
+               gconstpointer  data)
+{
+    g_autofree gchar *basename = NULL;
+    g_autofree gchar *tmpl = NULL;
+
+    basename = g_path_get_basename (g_get_prgname ());
+    tmpl = g_strdup_printf ("%s-XXXXXX", basename);
+    fixture->dir = g_dir_make_tmp (tmpl, NULL);
+    g_assert_nonnull (fixture->dir);
+    fixture->path = g_build_filename (fixture->dir, "store", NULL);
+}
+
+static void
+fixture_teardown (Fixture       *fixture,
+                  gconstpointer  data)
+{
+    GDir        *dir;
+    const gchar *name;
+
+    /* Also cleans up any temporary file left behind */
+    dir = g_dir_open (fixture->dir, 0, NULL);
+    g_assert_nonnull (dir);
+    while ((name = g_dir_read_name (dir)) != NULL) {
+        g_autofree gchar *path = NULL;
+
+        path = g_build_filename (fixture->dir, name, NULL);
+        g_unlink (path);
+    }
+    g_dir_close (dir);
+
+    g_rmdir (fixture->dir);
+    g_free (fixture->path);
+    g_free (fixture->dir);
+}
+
+/* Creates the cache object of the given type on the fixture path, with
+ * additional construct properties given as a NULL-terminated list; all
+ * the caches take their file in a "path" property */
+#define fixture_new_object(fixture, type, ...) \
+    g_object_new ((type), "path", (fixture)->path, __VA_ARGS__)
+
+#endif /* TEST_KEYFILE_FIXTURE_H */
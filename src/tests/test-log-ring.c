@@ -0,0 +1,236 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+
+#include "mm-log-ring.h"
+#include "mm-log-test.h"
+
+/*****************************************************************************/
+
+static void
+push_string (MMLogRing   *ring,
+             const gchar *str,
+             gboolean     expected)
+{
+    g_assert_cmpint (mm_log_ring_push (ring, G_STRLOC, G_STRFUNC, 7, str, strlen (str)), ==, expected);
+}
+
+static void
+pop_string (MMLogRing   *ring,
+            const gchar *expected)
+{
+    const MMLogRecord *record;
+
+    record = mm_log_ring_peek (ring);
+    g_assert_nonnull (record);
+    g_assert_cmpstr (record->message, ==, expected);
+    g_assert_cmpuint (record->length, ==, strlen (expected));
+    g_assert_cmpint (record->syslog_level, ==, 7);
+    mm_log_ring_release (ring);
+}
+
+static void
+test_push_pop (void)
+{
+    g_autoptr(MMLogRing) ring = NULL;
+    guint                i;
+
+    /* Rounded up to a power of two */
+    ring = mm_log_ring_new (5);
+    g_assert_cmpuint (mm_log_ring_get_size (ring), ==, 8);
+    g_assert_null (mm_log_ring_peek (ring));
+
+    /* Several laps around the ring */
+    for (i = 0; i < 100; i++) {
+        g_autofree gchar *first = NULL;
+        g_autofree gchar *second = NULL;
+
+        first = g_strdup_printf ("message %u\n", 2 * i);
+        second = g_strdup_printf ("message %u\n", 2 * i + 1);
+        push_string (ring, first, TRUE);
+        push_string (ring, second, TRUE);
+        pop_string (ring, first);
+        pop_string (ring, second);
+        g_assert_null (mm_log_ring_peek (ring));
+    }
+    g_assert_cmpuint (mm_log_ring_steal_dropped (ring), ==, 0);
+}
+
+static void
+test_full (void)
+{
+    g_autoptr(MMLogRing) ring = NULL;
+    guint                i;
+
+    ring = mm_log_ring_new (4);
+    for (i = 0; i < 4; i++)
+        push_string (ring, "queued\n", TRUE);
+    for (i = 0; i < 3; i++)
+        push_string (ring, "dropped\n", FALSE);
+    g_assert_cmpuint (mm_log_ring_steal_dropped (ring), ==, 3);
+    g_assert_cmpuint (mm_log_ring_steal_dropped (ring), ==, 0);
+
+    /* Releasing one record allows pushing a new one */
+    pop_string (ring, "queued\n");
+    push_string (ring, "last\n", TRUE);
+    for (i = 0; i < 3; i++)
+        pop_string (ring, "queued\n");
+    pop_string (ring, "last\n");
+    g_assert_null (mm_log_ring_peek (ring));
+}
+
+static void
+test_truncate (void)
+{
+    g_autoptr(MMLogRing)  ring = NULL;
+    g_autofree gchar     *message = NULL;
+    const MMLogRecord    *record;
+
+    ring = mm_log_ring_new (1);
+    message = g_strnfill (3 * MM_LOG_RING_MESSAGE_SIZE, 'x');
+    push_string (ring, message, TRUE);
+
+    record = mm_log_ring_peek (ring);
+    g_assert_nonnull (record);
+    g_assert_cmpuint (record->length, ==, MM_LOG_RING_MESSAGE_SIZE - 1);
+    g_assert_cmpuint (strlen (record->message), ==, record->length);
+    g_assert (g_str_has_suffix (record->message, "...\n"));
+    mm_log_ring_release (ring);
+}
+
+/*****************************************************************************/
+
+#define N_PRODUCERS          4
+#define N_RECORDS_PER_THREAD 20000
+
+typedef struct {
+    MMLogRing *ring;
+    guint      id;
+} Producer;
+
+static gpointer
+producer_thread (Producer *producer)
+{
+    guint i;
+
+    for (i = 0; i < N_RECORDS_PER_THREAD; i++) {
+        gchar message[32];
+        gint  length;
+
+        length = g_snprintf (message, sizeof (message), "%u:%u\n", producer->id, i);
+        while (!mm_log_ring_push (producer->ring, NULL, NULL, 7, message, length))
+            g_thread_yield ();
+    }
+    return NULL;
+}
+
+static void
+test_threads (void)
+{
+    g_autoptr(MMLogRing)  ring = NULL;
+    g_autoptr(GHashTable) last_seen = NULL;
+    Producer              producers[N_PRODUCERS];
+    GThread              *threads[N_PRODUCERS];
+    guint                 n_records = 0;
+    guint                 i;
+
+    ring = mm_log_ring_new (64);
+    last_seen = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+    for (i = 0; i < N_PRODUCERS; i++) {
+        producers[i].ring = ring;
+        producers[i].id = i;
+        threads[i] = g_thread_new ("producer", (GThreadFunc) producer_thread, &producers[i]);
+    }
+
+    /* Records from each producer must be received complete and in order */
+    while (n_records < N_PRODUCERS * N_RECORDS_PER_THREAD) {
+        const MMLogRecord *record;
+        guint              id;
+        guint              seq;
+        gpointer           last;
+
+        record = mm_log_ring_peek (ring);
+        if (!record) {
+            g_thread_yield ();
+            continue;
+        }
+
+        g_assert_cmpint (sscanf (record->message, "%u:%u\n", &id, &seq), ==, 2);
+        if (g_hash_table_lookup_extended (last_seen, GUINT_TO_POINTER (id), NULL, &last))
+            g_assert_cmpuint (seq, ==, GPOINTER_TO_UINT (last) + 1);
+        else
+            g_assert_cmpuint (seq, ==, 0);
+        g_hash_table_insert (last_seen, GUINT_TO_POINTER (id), GUINT_TO_POINTER (seq));
+
+        mm_log_ring_release (ring);
+        n_records++;
+    }
+
+    for (i = 0; i < N_PRODUCERS; i++)
+        g_thread_join (threads[i]);
+    g_assert_null (mm_log_ring_peek (ring));
+}
+
+/*****************************************************************************/
+
+static void
+test_rate_limit (void)
+{
+    MMLogRateLimit rate_limit;
+    gint64         now = 1000 * G_USEC_PER_SEC;
+    guint          n_suppressed = 0;
+    guint          i;
+
+    mm_log_rate_limit_init (&rate_limit, 10, now);
+
+    /* Burst allowed right away */
+    for (i = 0; i < 10; i++) {
+        g_assert (mm_log_rate_limit_check (&rate_limit, 5, 10, now, &n_suppressed));
+        g_assert_cmpuint (n_suppressed, ==, 0);
+    }
+    for (i = 0; i < 7; i++)
+        g_assert (!mm_log_rate_limit_check (&rate_limit, 5, 10, now, &n_suppressed));
+
+    /* 5 per second: one message every 200ms */
+    now += 100 * 1000;
+    g_assert (!mm_log_rate_limit_check (&rate_limit, 5, 10, now, &n_suppressed));
+    now += 100 * 1000;
+    g_assert (mm_log_rate_limit_check (&rate_limit, 5, 10, now, &n_suppressed));
+    g_assert_cmpuint (n_suppressed, ==, 8);
+
+    /* Never refilled above the burst size */
+    now += 60 * G_USEC_PER_SEC;
+    for (i = 0; i < 10; i++)
+        g_assert (mm_log_rate_limit_check (&rate_limit, 5, 10, now, &n_suppressed));
+    g_assert (!mm_log_rate_limit_check (&rate_limit, 5, 10, now, &n_suppressed));
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/MM/log-ring/push-pop",   test_push_pop);
+    g_test_add_func ("/MM/log-ring/full",       test_full);
+    g_test_add_func ("/MM/log-ring/truncate",   test_truncate);
+    g_test_add_func ("/MM/log-ring/threads",    test_threads);
+    g_test_add_func ("/MM/log-ring/rate-limit", test_rate_limit);
+
+    return g_test_run ();
+}
@@ -22,6 +22,7 @@
 #define _LIBMM_INSIDE_MM
 #include <libmm-glib.h>
 #include "mm-modem-helpers.h"
+#include "mm-sms-part-3gpp.h"
 #include "mm-log-test.h"
 
 #define g_assert_cmpfloat_tolerance(val1, val2, tolerance)  \
@@ -407,6 +408,221 @@ test_cmgl_response_pantech_multiple (void *f, gpointer d)
     test_cmgl_response (str, expected, G_N_ELEMENTS (expected));
 }
 
+/* A valid deliver PDU, to be able to parse the entries completely */
+#define CMGL_TEST_PDU "07919730071111F10414D04937BD2C7797E9D3E614000811309291024061080442043504410442"
+
+typedef struct {
+    guint  n_entries;
+    guint  n_parts;
+    gint   last_index;
+} CmglChunksContext;
+
+static void
+cmgl_chunks_entry_cb (const gchar       *header,
+                      const gchar       *data,
+                      CmglChunksContext *ctx)
+{
+    MM3gppPduInfo *info;
+    MMSmsPart     *part;
+    GError        *error = NULL;
+
+    info = mm_3gpp_parse_pdu_cmgl_entry (header, data, &error);
+    g_assert_no_error (error);
+    g_assert_nonnull (info);
+    g_assert_cmpint (info->status, ==, 1);
+    g_assert_cmpstr (info->pdu, ==, CMGL_TEST_PDU);
+
+    /* Entries are reported in order */
+    g_assert_cmpint (info->index, >, ctx->last_index);
+    ctx->last_index = info->index;
+    ctx->n_entries++;
+
+    part = mm_sms_part_3gpp_new_from_pdu (info->index, info->pdu, NULL, NULL);
+    if (part) {
+        ctx->n_parts++;
+        mm_sms_part_free (part);
+    }
+    mm_3gpp_pdu_info_free (info);
+}
+
+static gchar *
+cmgl_build_response (guint n_entries)
+{
+    GString *str;
+    guint    i;
+
+    str = g_string_new (NULL);
+    for (i = 0; i < n_entries; i++)
+        g_string_append_printf (str,
+                                "+CMGL: %u,1,31\r\n"
+                                CMGL_TEST_PDU "\r\n",
+                                i);
+    return g_string_free (str, FALSE);
+}
+
+static void
+test_cmgl_response_chunks (void *f, gpointer d)
+{
+    g_autofree gchar *str = NULL;
+    gsize             len;
+    gsize             chunk_size;
+
+    str = cmgl_build_response (5);
+    len = strlen (str);
+
+    /* Any split of the response must give the same entries */
+    for (chunk_size = 1; chunk_size <= len; chunk_size++) {
+        g_autoptr(MM3gppCmglParser) parser = NULL;
+        CmglChunksContext           ctx = { .last_index = -1 };
+        gsize                       offset;
+
+        parser = mm_3gpp_cmgl_parser_new ((MM3gppCmglEntryFunc) cmgl_chunks_entry_cb, &ctx);
+        for (offset = 0; offset < len; offset += chunk_size)
+            mm_3gpp_cmgl_parser_feed (parser, &str[offset], MIN (chunk_size, len - offset));
+        mm_3gpp_cmgl_parser_finish (parser);
+
+        g_assert_cmpuint (ctx.n_entries, ==, 5);
+        g_assert_cmpuint (ctx.n_parts, ==, 5);
+    }
+}
+
+#define CMGL_BENCHMARK_ENTRIES 1000
+
+static void
+test_cmgl_response_benchmark (void *f, gpointer d)
+{
+    g_autoptr(MM3gppCmglParser)  parser = NULL;
+    g_autofree gchar            *str = NULL;
+    CmglChunksContext            ctx = { .last_index = -1 };
+    gsize                        len;
+    gsize                        offset;
+    gdouble                      elapsed;
+
+    if (!g_test_perf ()) {
+        g_test_skip ("only run in perf mode");
+        return;
+    }
+
+    str = cmgl_build_response (CMGL_BENCHMARK_ENTRIES);
+    len = strlen (str);
+
+    /* Feed the listing in chunks of the size of a serial port read */
+    g_test_timer_start ();
+    parser = mm_3gpp_cmgl_parser_new ((MM3gppCmglEntryFunc) cmgl_chunks_entry_cb, &ctx);
+    for (offset = 0; offset < len; offset += 256)
+        mm_3gpp_cmgl_parser_feed (parser, &str[offset], MIN (256, len - offset));
+    mm_3gpp_cmgl_parser_finish (parser);
+    elapsed = g_test_timer_elapsed ();
+
+    g_assert_cmpuint (ctx.n_entries, ==, CMGL_BENCHMARK_ENTRIES);
+    g_assert_cmpuint (ctx.n_parts, ==, CMGL_BENCHMARK_ENTRIES);
+
+    g_test_message ("%u entries (%" G_GSIZE_FORMAT " bytes) in %.3fs",
+                    ctx.n_entries, len, elapsed);
+    g_test_minimized_result (elapsed, "%.3f s", elapsed);
+}
+
+typedef struct {
+    const gchar *header;
+    guint        index;
+    const gchar *stat;
+    const gchar *number;
+    const gchar *timestamp;
+} CmglTextHeaderTest;
+
+static const CmglTextHeaderTest cmgl_text_header_tests[] = {
+    { "1,\"REC UNREAD\",\"+123\",,\"24/01/31,12:00:00+04\"", 1, "REC UNREAD", "+123", "24/01/31,12:00:00+04" },
+    /* Whitespace after the commas */
+    { "1, \"REC UNREAD\", \"+123\"", 1, "REC UNREAD", "+123", NULL },
+    { " 7, \"REC READ\", \"+3412345678\", \"Alice\", \"24/01/31,12:00:00+04\"", 7, "REC READ", "+3412345678", "24/01/31,12:00:00+04" },
+    /* Stored messages have no timestamp */
+    { "3,\"STO UNSENT\",\"+123\",", 3, "STO UNSENT", "+123", NULL },
+};
+
+static void
+test_cmgl_text_header (void *f, gpointer d)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (cmgl_text_header_tests); i++) {
+        const CmglTextHeaderTest *test = &cmgl_text_header_tests[i];
+        g_autoptr(GError)         error = NULL;
+        g_autofree gchar         *stat = NULL;
+        g_autofree gchar         *number = NULL;
+        g_autofree gchar         *timestamp = NULL;
+        guint                     idx = 0;
+        gboolean                  success;
+
+        success = mm_3gpp_parse_text_cmgl_header (test->header, &idx, &stat, &number, &timestamp, &error);
+        g_assert_no_error (error);
+        g_assert (success);
+        g_assert_cmpuint (idx, ==, test->index);
+        g_assert_cmpstr (stat, ==, test->stat);
+        g_assert_cmpstr (number, ==, test->number);
+        g_assert_cmpstr (timestamp, ==, test->timestamp);
+    }
+}
+
+static void
+test_cmgl_text_header_invalid (void *f, gpointer d)
+{
+    static const gchar *headers[] = {
+        "",
+        "1,\"REC UNREAD\"",
+        "x,\"REC UNREAD\",\"+123\"",
+    };
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (headers); i++) {
+        g_autoptr(GError)  error = NULL;
+        g_autofree gchar  *stat = NULL;
+        g_autofree gchar  *number = NULL;
+        g_autofree gchar  *timestamp = NULL;
+        guint              idx = 0;
+
+        g_assert (!mm_3gpp_parse_text_cmgl_header (headers[i], &idx, &stat, &number, &timestamp, &error));
+        g_assert_error (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED);
+    }
+}
+
+static void
+cmgl_text_entry_cb (const gchar *header,
+                    const gchar *data,
+                    GPtrArray   *numbers)
+{
+    g_autoptr(GError)  error = NULL;
+    g_autofree gchar  *stat = NULL;
+    g_autofree gchar  *number = NULL;
+    g_autofree gchar  *timestamp = NULL;
+    guint              idx = 0;
+
+    g_assert (mm_3gpp_parse_text_cmgl_header (header, &idx, &stat, &number, &timestamp, &error));
+    g_assert_no_error (error);
+    g_assert_cmpstr (stat, ==, "REC UNREAD");
+    g_ptr_array_add (numbers, g_strdup_printf ("%u:%s:%s", idx, number, data));
+}
+
+static void
+test_cmgl_text_response (void *f, gpointer d)
+{
+    g_autoptr(MM3gppCmglParser) parser = NULL;
+    g_autoptr(GPtrArray)        numbers = NULL;
+    const gchar                *str =
+        "+CMGL: 1, \"REC UNREAD\", \"+123\"\r\n"
+        "Hello\r\n"
+        "+CMGL: 2,\"REC UNREAD\",\"+456\",,\"24/01/31,12:00:00+04\"\r\n"
+        "World\r\n";
+
+    numbers = g_ptr_array_new_with_free_func (g_free);
+    parser = mm_3gpp_cmgl_parser_new ((MM3gppCmglEntryFunc) cmgl_text_entry_cb, numbers);
+    mm_3gpp_cmgl_parser_feed (parser, str, strlen (str));
+    mm_3gpp_cmgl_parser_finish (parser);
+
+    g_assert_cmpuint (numbers->len, ==, 2);
+    g_assert_cmpstr (g_ptr_array_index (numbers, 0), ==, "1:+123:Hello");
+    g_assert_cmpstr (g_ptr_array_index (numbers, 1), ==, "2:+456:World");
+}
+
 /*****************************************************************************/
 /* Test CMGR responses */
 
@@ -4573,6 +4789,55 @@ test_at_quote_string (void *f, gpointer d)
 
 /*****************************************************************************/
 
+typedef struct {
+    const gchar *commands[5];
+    const gchar *expected_line;
+    guint        expected_n_chained;
+} AtCommandChainTest;
+
+static const AtCommandChainTest at_command_chain_tests[] = {
+    /* Chained up to the V.250 command line length */
+    { { "+QGPSCFG=\"outport\",\"usbnmea\"", "+QGPS=1", "+QGPSXTRA=1", NULL },
+      "AT+QGPSCFG=\"outport\",\"usbnmea\";+QGPS=1", 2 },
+    { { "AT+CMEE=1", "+CREG=2", "AT+CGREG=2", NULL },
+      "AT+CMEE=1;+CREG=2;+CGREG=2", 3 },
+    /* Basic commands are never chained */
+    { { "+CMEE=1", "E0", "+CREG=2", NULL },
+      "AT+CMEE=1", 1 },
+    { { "ATZ", "+CMEE=1", NULL },
+      "", 0 },
+    /* Neither are command lines */
+    { { "+CMEE=1", "+CREG=2;+CGREG=2", NULL },
+      "AT+CMEE=1", 1 },
+    { { "+CMEE=1", "+CREG=2\r", NULL },
+      "AT+CMEE=1", 1 },
+    /* Commands longer than a whole command line */
+    { { "+CGDCONT=1,\"IP\",\"internet.operator.example.com\"", NULL },
+      "", 0 },
+};
+
+static void
+test_at_command_chain (void *f, gpointer d)
+{
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (at_command_chain_tests); i++) {
+        g_autoptr(GString) line = NULL;
+        guint              n_chained = 0;
+
+        line = g_string_new (NULL);
+        while (at_command_chain_tests[i].commands[n_chained] &&
+               mm_at_command_chain_append (line, at_command_chain_tests[i].commands[n_chained]))
+            n_chained++;
+
+        g_assert_cmpstr (line->str, ==, at_command_chain_tests[i].expected_line);
+        g_assert_cmpuint (n_chained, ==, at_command_chain_tests[i].expected_n_chained);
+        g_assert_cmpuint (line->len, <=, MM_AT_CHAINED_COMMAND_MAX_LENGTH + 2);
+    }
+}
+
+/*****************************************************************************/
+
 typedef struct {
     const gchar *response;
     gboolean     expected_error;
@@ -4847,6 +5112,11 @@ int main (int argc, char **argv)
     g_test_suite_add (suite, TESTCASE (test_cmgl_response_generic_multiple, NULL));
     g_test_suite_add (suite, TESTCASE (test_cmgl_response_pantech, NULL));
     g_test_suite_add (suite, TESTCASE (test_cmgl_response_pantech_multiple, NULL));
+    g_test_suite_add (suite, TESTCASE (test_cmgl_response_chunks, NULL));
+    g_test_suite_add (suite, TESTCASE (test_cmgl_response_benchmark, NULL));
+    g_test_suite_add (suite, TESTCASE (test_cmgl_text_header, NULL));
+    g_test_suite_add (suite, TESTCASE (test_cmgl_text_header_invalid, NULL));
+    g_test_suite_add (suite, TESTCASE (test_cmgl_text_response, NULL));
 
     g_test_suite_add (suite, TESTCASE (test_cmgr_response_generic, NULL));
     g_test_suite_add (suite, TESTCASE (test_cmgr_response_telit, NULL));
@@ -4884,6 +5154,7 @@ int main (int argc, char **argv)
     g_test_suite_add (suite, TESTCASE (test_bcd_to_string, NULL));
 
     g_test_suite_add (suite, TESTCASE (test_at_quote_string, NULL));
+    g_test_suite_add (suite, TESTCASE (test_at_command_chain, NULL));
 
     g_test_suite_add (suite, TESTCASE (test_cpol_response, NULL));
 
@@ -0,0 +1,190 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <unistd.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "mm-netlink.h"
+#include "mm-log-test.h"
+
+#define N_PACKETS 10
+
+/*****************************************************************************/
+
+static void
+sampler_add (MMNetlinkLinkSampler *sampler,
+             guint64               rx_bytes,
+             guint64               tx_bytes,
+             gint64                time,
+             gboolean              expected_rates,
+             guint64               expected_rx_bytes,
+             guint64               expected_tx_bytes)
+{
+    MMNetlinkLinkStats sample = { 0 };
+    MMNetlinkLinkStats totals;
+    guint64            rx_rate = 0;
+    guint64            tx_rate = 0;
+    guint64            previous_rx;
+    guint64            previous_tx;
+    gint64             elapsed;
+
+    elapsed = time - sampler->last_time;
+    previous_rx = sampler->last.rx_bytes;
+    previous_tx = sampler->last.tx_bytes;
+
+    /* Packets follow the bytes, to check all counters get the same base */
+    sample.rx_bytes = rx_bytes;
+    sample.tx_bytes = tx_bytes;
+    sample.rx_packets = rx_bytes / 100;
+    sample.tx_packets = tx_bytes / 100;
+
+    g_assert_cmpint (mm_netlink_link_sampler_add (sampler, &sample, time, &totals, &rx_rate, &tx_rate), ==, expected_rates);
+    g_assert_cmpuint (totals.rx_bytes, ==, expected_rx_bytes);
+    g_assert_cmpuint (totals.tx_bytes, ==, expected_tx_bytes);
+    g_assert_cmpuint (totals.rx_packets, ==, expected_rx_bytes / 100);
+    g_assert_cmpuint (totals.tx_packets, ==, expected_tx_bytes / 100);
+
+    if (expected_rates) {
+        g_assert_cmpuint (rx_rate, ==, (rx_bytes - previous_rx) * 8 * G_USEC_PER_SEC / elapsed);
+        g_assert_cmpuint (tx_rate, ==, (tx_bytes - previous_tx) * 8 * G_USEC_PER_SEC / elapsed);
+    }
+}
+
+static void
+test_sampler (void)
+{
+    MMNetlinkLinkSampler sampler = { 0 };
+
+    /* Counters found when the connection starts are the base */
+    sampler_add (&sampler, 100000, 20000, 1 * G_USEC_PER_SEC, FALSE, 0, 0);
+
+    /* Rates from the previous sample */
+    sampler_add (&sampler, 300000, 30000, 3 * G_USEC_PER_SEC, TRUE, 200000, 10000);
+    sampler_add (&sampler, 300000, 30000, 4 * G_USEC_PER_SEC, TRUE, 200000, 10000);
+
+    /* Interface recreated: no rates, totals go on from the new counters */
+    sampler_add (&sampler, 5000, 1000, 5 * G_USEC_PER_SEC, FALSE, 200000, 10000);
+    sampler_add (&sampler, 105000, 2000, 7 * G_USEC_PER_SEC, TRUE, 300000, 11000);
+
+    /* Only some counters going back is also a new interface */
+    sampler_add (&sampler, 105000, 1500, 8 * G_USEC_PER_SEC, FALSE, 300000, 11000);
+    sampler_add (&sampler, 106000, 1600, 9 * G_USEC_PER_SEC, TRUE, 301000, 11100);
+
+    /* A new connection starts from scratch */
+    memset (&sampler, 0, sizeof (sampler));
+    sampler_add (&sampler, 106000, 1600, 10 * G_USEC_PER_SEC, FALSE, 0, 0);
+}
+
+/*****************************************************************************/
+
+typedef struct {
+    GHashTable *link_stats;
+    GError     *error;
+    gboolean    done;
+} LinkStatsContext;
+
+static void
+get_link_stats_ready (MMNetlink        *netlink,
+                      GAsyncResult     *res,
+                      LinkStatsContext *ctx)
+{
+    ctx->link_stats = mm_netlink_get_link_stats_finish (netlink, res, &ctx->error);
+    ctx->done = TRUE;
+}
+
+static MMNetlinkLinkStats
+get_loopback_stats (MMNetlink *netlink)
+{
+    LinkStatsContext    ctx = { 0 };
+    MMNetlinkLinkStats *stats;
+    MMNetlinkLinkStats  result;
+
+    mm_netlink_get_link_stats (netlink, NULL, (GAsyncReadyCallback) get_link_stats_ready, &ctx);
+    while (!ctx.done)
+        g_main_context_iteration (NULL, TRUE);
+
+    g_assert_no_error (ctx.error);
+    g_assert_nonnull (ctx.link_stats);
+
+    /* The loopback interface is always there */
+    stats = g_hash_table_lookup (ctx.link_stats, "lo");
+    g_assert_nonnull (stats);
+    result = *stats;
+    g_hash_table_unref (ctx.link_stats);
+    return result;
+}
+
+static void
+test_link_stats (void)
+{
+    g_autoptr(MMNetlink)      netlink = NULL;
+    g_autoptr(GSocket)        udp_socket = NULL;
+    g_autoptr(GInetAddress)   loopback = NULL;
+    g_autoptr(GSocketAddress) address = NULL;
+    g_autoptr(GError)         error = NULL;
+    MMNetlinkLinkStats        before;
+    MMNetlinkLinkStats        after;
+    gint                      fd;
+    guint                     i;
+
+    /* Route netlink sockets may not be allowed, e.g. in build sandboxes */
+    fd = socket (AF_NETLINK, SOCK_DGRAM, NETLINK_ROUTE);
+    if (fd < 0) {
+        g_test_skip ("netlink not available");
+        return;
+    }
+    close (fd);
+
+    netlink = g_object_new (MM_TYPE_NETLINK, NULL);
+    before = get_loopback_stats (netlink);
+
+    /* Send some datagrams to ourselves through the loopback interface */
+    udp_socket = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP, &error);
+    g_assert_no_error (error);
+    loopback = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+    address = g_inet_socket_address_new (loopback, 0);
+    g_assert (g_socket_bind (udp_socket, address, FALSE, &error));
+    g_assert_no_error (error);
+    g_clear_object (&address);
+    address = g_socket_get_local_address (udp_socket, &error);
+    g_assert_no_error (error);
+    for (i = 0; i < N_PACKETS; i++) {
+        g_assert_cmpint (g_socket_send_to (udp_socket, address, "0123456789", 10, NULL, &error), ==, 10);
+        g_assert_no_error (error);
+    }
+
+    /* Other traffic may go through the interface meanwhile */
+    after = get_loopback_stats (netlink);
+    g_assert_cmpuint (after.tx_packets - before.tx_packets, >=, N_PACKETS);
+    g_assert_cmpuint (after.rx_packets - before.rx_packets, >=, N_PACKETS);
+    g_assert_cmpuint (after.tx_bytes - before.tx_bytes, >=, N_PACKETS * 10);
+    g_assert_cmpuint (after.rx_bytes - before.rx_bytes, >=, N_PACKETS * 10);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/MM/netlink/sampler",    test_sampler);
+    g_test_add_func ("/MM/netlink/link-stats", test_link_stats);
+
+    return g_test_run ();
+}
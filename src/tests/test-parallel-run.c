@@ -0,0 +1,363 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "mm-parallel-run.h"
+#include "mm-log-test.h"
+
+#define N_OPERATIONS 5
+
+/*****************************************************************************/
+
+typedef struct {
+    GObject      *source;
+    GCancellable *cancellable;
+    /* Operations started and not yet completed, oldest first */
+    GQueue        ongoing;
+    /* Indices of the operations, in the order they were started and
+     * finished */
+    GArray       *started;
+    GArray       *finished;
+    /* Operations skipped by the start callback */
+    guint         skip_mask;
+    /* Operations completed right from the start callback */
+    guint         sync_mask;
+    /* Group of each operation, if given */
+    const guint  *groups;
+    guint         max_ongoing;
+    gboolean      done;
+    GError       *error;
+} Fixture;
+
+static gboolean
+fake_start (Fixture             *fixture,
+            guint                index,
+            GCancellable        *cancellable,
+            GAsyncReadyCallback  callback,
+            gpointer             user_data)
+{
+    GTask *task;
+
+    g_assert (cancellable == fixture->cancellable);
+    if (fixture->skip_mask & (1 << index))
+        return FALSE;
+
+    g_array_append_val (fixture->started, index);
+
+    if (fixture->sync_mask & (1 << index)) {
+        task = g_task_new (fixture->source, NULL, NULL, NULL);
+        g_task_set_task_data (task, GUINT_TO_POINTER (index), NULL);
+        g_task_return_boolean (task, TRUE);
+        callback (fixture->source, G_ASYNC_RESULT (task), user_data);
+        g_object_unref (task);
+        return TRUE;
+    }
+
+    task = g_task_new (fixture->source, NULL, callback, user_data);
+    g_task_set_task_data (task, GUINT_TO_POINTER (index), NULL);
+    g_queue_push_tail (&fixture->ongoing, task);
+    fixture->max_ongoing = MAX (fixture->max_ongoing, g_queue_get_length (&fixture->ongoing));
+    return TRUE;
+}
+
+static guint
+fake_group (Fixture *fixture,
+            guint    index)
+{
+    return fixture->groups[index];
+}
+
+static void
+fake_finish (Fixture      *fixture,
+             guint         index,
+             GAsyncResult *res)
+{
+    g_autoptr(GError) error = NULL;
+
+    g_assert_cmpuint (GPOINTER_TO_UINT (g_task_get_task_data (G_TASK (res))), ==, index);
+
+    /* Errors are left to the finish callback */
+    if (!g_task_propagate_boolean (G_TASK (res), &error))
+        g_assert_error (error, G_IO_ERROR, G_IO_ERROR_FAILED);
+    g_array_append_val (fixture->finished, index);
+}
+
+/* Completes the nth oldest ongoing operation */
+static void
+complete_operation (Fixture  *fixture,
+                    guint     nth,
+                    gboolean  success)
+{
+    GTask *task;
+
+    task = g_queue_pop_nth (&fixture->ongoing, nth);
+    g_assert_nonnull (task);
+    if (success)
+        g_task_return_boolean (task, TRUE);
+    else
+        g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED, "failed");
+    g_object_unref (task);
+
+    /* Let the result be processed */
+    while (g_main_context_iteration (NULL, FALSE));
+}
+
+static void
+run_ready (GObject      *source,
+           GAsyncResult *res,
+           Fixture      *fixture)
+{
+    g_assert (!fixture->done);
+    mm_parallel_run_finish (res, &fixture->error);
+    fixture->done = TRUE;
+}
+
+static void
+run (Fixture *fixture,
+     guint    max_running)
+{
+    mm_parallel_run (fixture->source,
+                     N_OPERATIONS,
+                     max_running,
+                     (MMParallelRunStartFn) fake_start,
+                     fixture->groups ? (MMParallelRunGroupFn) fake_group : NULL,
+                     (MMParallelRunFinishFn) fake_finish,
+                     fixture,
+                     fixture->cancellable,
+                     (GAsyncReadyCallback) run_ready,
+                     fixture);
+}
+
+static void
+wait_run (Fixture *fixture)
+{
+    while (!fixture->done)
+        g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+assert_indices (GArray      *array,
+                const guint *indices,
+                guint        n_indices)
+{
+    g_assert_cmpmem (array->data, array->len * sizeof (guint), indices, n_indices * sizeof (guint));
+}
+
+/*****************************************************************************/
+
+static void
+fixture_setup (Fixture       *fixture,
+               gconstpointer  data)
+{
+    fixture->source = g_object_new (G_TYPE_OBJECT, NULL);
+    fixture->cancellable = g_cancellable_new ();
+    g_queue_init (&fixture->ongoing);
+    fixture->started = g_array_new (FALSE, FALSE, sizeof (guint));
+    fixture->finished = g_array_new (FALSE, FALSE, sizeof (guint));
+}
+
+static void
+fixture_teardown (Fixture       *fixture,
+                  gconstpointer  data)
+{
+    g_assert (g_queue_is_empty (&fixture->ongoing));
+    g_clear_error (&fixture->error);
+    g_array_unref (fixture->started);
+    g_array_unref (fixture->finished);
+    g_object_unref (fixture->cancellable);
+    g_object_unref (fixture->source);
+}
+
+/*****************************************************************************/
+
+static void
+test_serialized (Fixture       *fixture,
+                 gconstpointer  data)
+{
+    const guint order[] = { 0, 1, 2, 3, 4 };
+    guint       i;
+
+    run (fixture, 1);
+
+    /* Next one only started once the previous one is finished, even if
+     * failed */
+    for (i = 0; i < N_OPERATIONS; i++) {
+        g_assert_cmpuint (fixture->started->len, ==, i + 1);
+        g_assert (!fixture->done);
+        complete_operation (fixture, 0, (i % 2) == 0);
+    }
+
+    wait_run (fixture);
+    g_assert_no_error (fixture->error);
+    g_assert_cmpuint (fixture->max_ongoing, ==, 1);
+    assert_indices (fixture->started, order, G_N_ELEMENTS (order));
+    assert_indices (fixture->finished, order, G_N_ELEMENTS (order));
+}
+
+static void
+test_parallel (Fixture       *fixture,
+               gconstpointer  data)
+{
+    const guint started[] = { 0, 1, 2, 3, 4 };
+    const guint finished[] = { 1, 0, 3, 2, 4 };
+
+    /* Up to the max started right away */
+    run (fixture, 2);
+    g_assert_cmpuint (fixture->started->len, ==, 2);
+
+    /* Each finished operation leaves room for the next one, in whatever
+     * order they finish */
+    complete_operation (fixture, 1, TRUE);
+    g_assert_cmpuint (fixture->started->len, ==, 3);
+    complete_operation (fixture, 0, FALSE);
+    g_assert_cmpuint (fixture->started->len, ==, 4);
+    complete_operation (fixture, 1, TRUE);
+    g_assert_cmpuint (fixture->started->len, ==, 5);
+    complete_operation (fixture, 0, TRUE);
+    g_assert (!fixture->done);
+    complete_operation (fixture, 0, TRUE);
+
+    wait_run (fixture);
+    g_assert_no_error (fixture->error);
+    g_assert_cmpuint (fixture->max_ongoing, ==, 2);
+    assert_indices (fixture->started, started, G_N_ELEMENTS (started));
+    assert_indices (fixture->finished, finished, G_N_ELEMENTS (finished));
+}
+
+static void
+test_skip (Fixture       *fixture,
+           gconstpointer  data)
+{
+    const guint order[] = { 1, 4 };
+
+    /* Skipped operations don't take any of the running slots */
+    fixture->skip_mask = (1 << 0) | (1 << 2) | (1 << 3);
+    run (fixture, 1);
+    complete_operation (fixture, 0, TRUE);
+    complete_operation (fixture, 0, TRUE);
+
+    wait_run (fixture);
+    g_assert_no_error (fixture->error);
+    assert_indices (fixture->started, order, G_N_ELEMENTS (order));
+    assert_indices (fixture->finished, order, G_N_ELEMENTS (order));
+
+    /* Also when all are skipped */
+    g_array_set_size (fixture->started, 0);
+    g_array_set_size (fixture->finished, 0);
+    fixture->done = FALSE;
+    fixture->skip_mask = (1 << N_OPERATIONS) - 1;
+    run (fixture, 1);
+    wait_run (fixture);
+    g_assert_no_error (fixture->error);
+    g_assert_cmpuint (fixture->started->len, ==, 0);
+}
+
+static void
+test_group (Fixture       *fixture,
+            gconstpointer  data)
+{
+    const guint groups[] = { 1, 1, 0, 1, 0 };
+    const guint started[] = { 0, 2, 4, 1, 3 };
+    const guint finished[] = { 2, 0, 4, 1, 3 };
+
+    /* Operations of the same group wait for their turn, without holding
+     * the ones of other groups */
+    fixture->groups = groups;
+    run (fixture, 3);
+    assert_indices (fixture->started, started, 3);
+    complete_operation (fixture, 1, TRUE);
+    assert_indices (fixture->started, started, 3);
+    complete_operation (fixture, 0, TRUE);
+    assert_indices (fixture->started, started, 4);
+    complete_operation (fixture, 0, TRUE);
+    assert_indices (fixture->started, started, 4);
+    complete_operation (fixture, 0, TRUE);
+    assert_indices (fixture->started, started, 5);
+    g_assert (!fixture->done);
+    complete_operation (fixture, 0, TRUE);
+
+    wait_run (fixture);
+    g_assert_no_error (fixture->error);
+    assert_indices (fixture->started, started, G_N_ELEMENTS (started));
+    assert_indices (fixture->finished, finished, G_N_ELEMENTS (finished));
+}
+
+static void
+test_sync (Fixture       *fixture,
+           gconstpointer  data)
+{
+    const guint order[] = { 0, 1, 2, 3, 4 };
+
+    /* Operations completed right away don't take any of the running slots */
+    fixture->sync_mask = (1 << 0) | (1 << 1) | (1 << 3);
+    run (fixture, 1);
+    g_assert_cmpuint (fixture->started->len, ==, 3);
+    complete_operation (fixture, 0, TRUE);
+    g_assert_cmpuint (fixture->started->len, ==, 5);
+    complete_operation (fixture, 0, TRUE);
+
+    wait_run (fixture);
+    g_assert_no_error (fixture->error);
+    assert_indices (fixture->started, order, G_N_ELEMENTS (order));
+    assert_indices (fixture->finished, order, G_N_ELEMENTS (order));
+
+    /* Also when all of them are */
+    g_array_set_size (fixture->started, 0);
+    g_array_set_size (fixture->finished, 0);
+    fixture->done = FALSE;
+    fixture->sync_mask = (1 << N_OPERATIONS) - 1;
+    run (fixture, 2);
+    wait_run (fixture);
+    g_assert_no_error (fixture->error);
+    assert_indices (fixture->finished, order, G_N_ELEMENTS (order));
+}
+
+static void
+test_cancel (Fixture       *fixture,
+             gconstpointer  data)
+{
+    const guint order[] = { 0, 1 };
+
+    run (fixture, 2);
+    g_cancellable_cancel (fixture->cancellable);
+
+    /* No new operations started, the ongoing ones are waited for */
+    complete_operation (fixture, 0, TRUE);
+    g_assert_cmpuint (fixture->started->len, ==, 2);
+    g_assert (!fixture->done);
+    complete_operation (fixture, 0, TRUE);
+
+    wait_run (fixture);
+    g_assert_error (fixture->error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+    assert_indices (fixture->started, order, G_N_ELEMENTS (order));
+    assert_indices (fixture->finished, order, G_N_ELEMENTS (order));
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add ("/MM/parallel-run/serialized", Fixture, NULL, fixture_setup, test_serialized, fixture_teardown);
+    g_test_add ("/MM/parallel-run/parallel",   Fixture, NULL, fixture_setup, test_parallel,   fixture_teardown);
+    g_test_add ("/MM/parallel-run/skip",       Fixture, NULL, fixture_setup, test_skip,       fixture_teardown);
+    g_test_add ("/MM/parallel-run/group",      Fixture, NULL, fixture_setup, test_group,      fixture_teardown);
+    g_test_add ("/MM/parallel-run/sync",       Fixture, NULL, fixture_setup, test_sync,       fixture_teardown);
+    g_test_add ("/MM/parallel-run/cancel",     Fixture, NULL, fixture_setup, test_cancel,     fixture_teardown);
+
+    return g_test_run ();
+}
@@ -0,0 +1,149 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <ModemManager.h>
+#include <mm-errors-types.h>
+
+#include "mm-port-trace.h"
+#include "mm-log-test.h"
+
+/*****************************************************************************/
+
+static void
+common_check_record (MMPortTraceReader     *reader,
+                     guint16                port_id,
+                     MMPortTraceRecordType  type,
+                     const gchar           *data)
+{
+    g_autoptr(GError) error = NULL;
+    MMPortTraceRecord record;
+
+    g_assert (mm_port_trace_reader_next (reader, &record, &error));
+    g_assert_no_error (error);
+    g_assert_cmpuint (record.port_id, ==, port_id);
+    g_assert_cmpuint (record.type, ==, type);
+    g_assert_cmpuint (record.length, ==, strlen (data));
+    g_assert (memcmp (record.data, data, record.length) == 0);
+    g_assert_cmpint (record.timestamp, >, 0);
+}
+
+static void
+test_capture_read (void)
+{
+    g_autoptr(GError)            error = NULL;
+    g_autoptr(MMPortTraceReader) reader = NULL;
+    g_autofree gchar            *path = NULL;
+    MMPortTraceRecord            record;
+    guint16                      tty_id;
+    guint16                      wdm_id;
+    gint                         fd;
+
+    fd = g_file_open_tmp ("test-port-trace-XXXXXX", &path, &error);
+    g_assert_no_error (error);
+    close (fd);
+
+    g_assert (!mm_port_trace_is_enabled ());
+    g_assert (mm_port_trace_open (path, &error));
+    g_assert_no_error (error);
+    g_assert (mm_port_trace_is_enabled ());
+
+    tty_id = mm_port_trace_register_port ("ttyUSB2", MM_PORT_TRACE_PORT_TYPE_SERIAL);
+    wdm_id = mm_port_trace_register_port ("cdc-wdm0", MM_PORT_TRACE_PORT_TYPE_QMI);
+    g_assert_cmpuint (tty_id, !=, 0);
+    g_assert_cmpuint (wdm_id, !=, 0);
+    g_assert_cmpuint (tty_id, !=, wdm_id);
+
+    mm_port_trace_record (tty_id, MM_PORT_TRACE_RECORD_TYPE_TX, (const guint8 *) "AT\r", 3);
+    mm_port_trace_record (wdm_id, MM_PORT_TRACE_RECORD_TYPE_RX, (const guint8 *) "\x01\x02\x03", 3);
+    mm_port_trace_record (tty_id, MM_PORT_TRACE_RECORD_TYPE_RX, (const guint8 *) "\r\nOK\r\n", 6);
+    /* Unregistered ports are ignored */
+    mm_port_trace_record (0, MM_PORT_TRACE_RECORD_TYPE_RX, (const guint8 *) "ignored", 7);
+    mm_port_trace_close ();
+    g_assert (!mm_port_trace_is_enabled ());
+
+    reader = mm_port_trace_reader_new (path, &error);
+    g_assert_no_error (error);
+    g_assert (reader);
+
+    g_assert (mm_port_trace_reader_next (reader, &record, &error));
+    g_assert_cmpuint (record.type, ==, MM_PORT_TRACE_RECORD_TYPE_PORT);
+    g_assert_cmpuint (record.port_type, ==, MM_PORT_TRACE_PORT_TYPE_SERIAL);
+    g_assert_cmpstr (mm_port_trace_reader_get_port_name (reader, tty_id), ==, "ttyUSB2");
+    g_assert (mm_port_trace_reader_next (reader, &record, &error));
+    g_assert_cmpuint (record.port_type, ==, MM_PORT_TRACE_PORT_TYPE_QMI);
+    g_assert_cmpstr (mm_port_trace_reader_get_port_name (reader, wdm_id), ==, "cdc-wdm0");
+
+    common_check_record (reader, tty_id, MM_PORT_TRACE_RECORD_TYPE_TX, "AT\r");
+    common_check_record (reader, wdm_id, MM_PORT_TRACE_RECORD_TYPE_RX, "\x01\x02\x03");
+    common_check_record (reader, tty_id, MM_PORT_TRACE_RECORD_TYPE_RX, "\r\nOK\r\n");
+
+    /* End of capture */
+    g_assert (!mm_port_trace_reader_next (reader, &record, &error));
+    g_assert_no_error (error);
+
+    g_unlink (path);
+}
+
+static void
+test_read_invalid (void)
+{
+    g_autoptr(GError)            error = NULL;
+    g_autoptr(MMPortTraceReader) reader = NULL;
+    g_autofree gchar            *path = NULL;
+    MMPortTraceRecord            record;
+    gint                         fd;
+
+    fd = g_file_open_tmp ("test-port-trace-XXXXXX", &path, &error);
+    g_assert_no_error (error);
+    close (fd);
+
+    /* Not a capture */
+    g_assert (g_file_set_contents (path, "AT\r\nOK\r\n", -1, &error));
+    reader = mm_port_trace_reader_new (path, &error);
+    g_assert_error (error, MM_CORE_ERROR, MM_CORE_ERROR_INVALID_ARGS);
+    g_assert_null (reader);
+    g_clear_error (&error);
+
+    /* Truncated record */
+    g_assert (mm_port_trace_open (path, &error));
+    mm_port_trace_record (mm_port_trace_register_port ("ttyUSB0", MM_PORT_TRACE_PORT_TYPE_SERIAL),
+                          MM_PORT_TRACE_RECORD_TYPE_RX, (const guint8 *) "\r\nOK\r\n", 6);
+    mm_port_trace_close ();
+    g_assert (truncate (path, 12 + 16 + 7 + 16 + 3) == 0);
+
+    reader = mm_port_trace_reader_new (path, &error);
+    g_assert_no_error (error);
+    g_assert (mm_port_trace_reader_next (reader, &record, &error));
+    g_assert (!mm_port_trace_reader_next (reader, &record, &error));
+    g_assert_error (error, MM_CORE_ERROR, MM_CORE_ERROR_FAILED);
+
+    g_unlink (path);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/MM/port-trace/capture-read", test_capture_read);
+    g_test_add_func ("/MM/port-trace/read-invalid", test_read_invalid);
+
+    return g_test_run ();
+}
@@ -0,0 +1,241 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+
+#include <glib.h>
+
+#include "mm-kernel-device-generic.h"
+#include "mm-probe-cache.h"
+#include "mm-log-test.h"
+#include "test-keyfile-fixture.h"
+
+#define DEVICE_UID       "/sys/devices/pci0000:00/0000:00:14.0/usb1/1-1"
+#define OTHER_DEVICE_UID "/sys/devices/pci0000:00/0000:00:14.0/usb1/1-2"
+
+/*****************************************************************************/
+
+/* Stands for the port probe, with a single result */
+typedef struct {
+    MMKernelDevice *port;
+    gint            result;
+} TestProbe;
+
+static MMKernelDevice *
+test_probe_peek_port (TestProbe *probe)
+{
+    return probe->port;
+}
+
+static void
+test_probe_save (TestProbe   *probe,
+                 GKeyFile    *keyfile,
+                 const gchar *group)
+{
+    g_key_file_set_integer (keyfile, group, "result", probe->result);
+}
+
+static gboolean
+test_probe_load (TestProbe   *probe,
+                 GKeyFile    *keyfile,
+                 const gchar *group)
+{
+    g_autoptr(GError) error = NULL;
+
+    probe->result = g_key_file_get_integer (keyfile, group, "result", &error);
+    return !error;
+}
+
+static void
+test_probe_init (TestProbe   *probe,
+                 const gchar *device_uid,
+                 gint         result)
+{
+    g_autoptr(MMKernelEventProperties) properties = NULL;
+    g_autoptr(GError)                  error = NULL;
+
+    /* Virtual devices don't need to exist in sysfs */
+    properties = mm_kernel_event_properties_new ();
+    mm_kernel_event_properties_set_action (properties, "add");
+    mm_kernel_event_properties_set_subsystem (properties, "virtual");
+    mm_kernel_event_properties_set_name (properties, "ttyTEST0");
+    mm_kernel_event_properties_set_uid (properties, device_uid);
+    probe->port = mm_kernel_device_generic_new_with_rules (properties, NULL, &error);
+    g_assert_no_error (error);
+    g_assert_nonnull (probe->port);
+    probe->result = result;
+}
+
+static void
+test_probe_clear (TestProbe *probe)
+{
+    g_clear_object (&probe->port);
+}
+
+/*****************************************************************************/
+
+static void
+store (MMProbeCache *cache,
+       const gchar  *device_uid,
+       const gchar  *plugin_name,
+       TestProbe    *probe)
+{
+    GList probes = { probe, NULL, NULL };
+
+    mm_probe_cache_store (cache,
+                          device_uid,
+                          plugin_name,
+                          &probes,
+                          (MMProbeCachePeekPortFn) test_probe_peek_port,
+                          (MMProbeCacheSaveFn) test_probe_save);
+}
+
+static gboolean
+load (MMProbeCache *cache,
+      const gchar  *plugin_name,
+      TestProbe    *probe)
+{
+    return mm_probe_cache_load (cache,
+                                probe->port,
+                                plugin_name,
+                                (MMProbeCacheLoadFn) test_probe_load,
+                                probe);
+}
+
+/*****************************************************************************/
+
+static void
+test_hit (Fixture       *fixture,
+          gconstpointer  data)
+{
+    g_autoptr(MMProbeCache)  cache = NULL;
+    g_autofree gchar        *plugin_name = NULL;
+    TestProbe                probe = { 0 };
+
+    cache = fixture_new_object (fixture, MM_TYPE_PROBE_CACHE, NULL);
+    test_probe_init (&probe, DEVICE_UID, 42);
+    store (cache, DEVICE_UID, "generic", &probe);
+    test_probe_clear (&probe);
+
+    /* Not written right away */
+    g_assert (!g_file_test (fixture->path, G_FILE_TEST_EXISTS));
+    g_clear_object (&cache);
+    g_assert (g_file_test (fixture->path, G_FILE_TEST_EXISTS));
+
+    /* Read back by a new instance, as after a restart, for a new port of
+     * the same device */
+    cache = fixture_new_object (fixture, MM_TYPE_PROBE_CACHE, NULL);
+    g_assert_cmpuint (mm_probe_cache_get_n_ports (cache, DEVICE_UID), ==, 1);
+    g_assert_cmpuint (mm_probe_cache_get_n_ports (cache, OTHER_DEVICE_UID), ==, 0);
+    test_probe_init (&probe, DEVICE_UID, 0);
+    plugin_name = mm_probe_cache_lookup_plugin (cache, probe.port);
+    g_assert_cmpstr (plugin_name, ==, "generic");
+    g_assert (load (cache, "generic", &probe));
+    g_assert_cmpint (probe.result, ==, 42);
+    test_probe_clear (&probe);
+}
+
+static void
+test_miss (Fixture       *fixture,
+           gconstpointer  data)
+{
+    g_autoptr(MMProbeCache)  cache = NULL;
+    g_autofree gchar        *plugin_name = NULL;
+    TestProbe                probe = { 0 };
+
+    cache = fixture_new_object (fixture, MM_TYPE_PROBE_CACHE, NULL);
+    test_probe_init (&probe, DEVICE_UID, 42);
+
+    /* Nothing stored yet */
+    g_assert_null (mm_probe_cache_lookup_plugin (cache, probe.port));
+    g_assert (!load (cache, "generic", &probe));
+
+    /* Results are only given to the plugin that stored them */
+    store (cache, DEVICE_UID, "generic", &probe);
+    probe.result = 0;
+    g_assert (!load (cache, "other", &probe));
+    g_assert_cmpint (probe.result, ==, 0);
+    test_probe_clear (&probe);
+
+    /* Other devices are not affected */
+    test_probe_init (&probe, OTHER_DEVICE_UID, 0);
+    g_assert_null (mm_probe_cache_lookup_plugin (cache, probe.port));
+    g_assert (!load (cache, "generic", &probe));
+    test_probe_clear (&probe);
+
+    /* Disabled without a path */
+    g_clear_object (&cache);
+    cache = g_object_new (MM_TYPE_PROBE_CACHE, NULL);
+    test_probe_init (&probe, DEVICE_UID, 0);
+    store (cache, DEVICE_UID, "generic", &probe);
+    plugin_name = mm_probe_cache_lookup_plugin (cache, probe.port);
+    g_assert_null (plugin_name);
+    g_assert (!load (cache, "generic", &probe));
+    test_probe_clear (&probe);
+}
+
+static void
+test_invalidate (Fixture       *fixture,
+                 gconstpointer  data)
+{
+    g_autoptr(MMProbeCache)  cache = NULL;
+    g_autofree gchar        *plugin_name = NULL;
+    TestProbe                probe = { 0 };
+    TestProbe                other = { 0 };
+
+    cache = fixture_new_object (fixture, MM_TYPE_PROBE_CACHE, NULL);
+    test_probe_init (&probe, DEVICE_UID, 1);
+    test_probe_init (&other, OTHER_DEVICE_UID, 2);
+    store (cache, DEVICE_UID, "generic", &probe);
+    store (cache, OTHER_DEVICE_UID, "generic", &other);
+
+    /* Storing again replaces the previous results, with another plugin */
+    probe.result = 3;
+    store (cache, DEVICE_UID, "other", &probe);
+    g_assert (!load (cache, "generic", &probe));
+    g_assert (load (cache, "other", &probe));
+    g_assert_cmpint (probe.result, ==, 3);
+
+    /* Forgetting a device only drops its results, also from the file */
+    mm_probe_cache_forget (cache, DEVICE_UID);
+    g_assert_null (mm_probe_cache_lookup_plugin (cache, probe.port));
+    g_assert (!load (cache, "other", &probe));
+    g_assert_cmpuint (mm_probe_cache_get_n_ports (cache, DEVICE_UID), ==, 0);
+    g_clear_object (&cache);
+
+    cache = fixture_new_object (fixture, MM_TYPE_PROBE_CACHE, NULL);
+    g_assert_null (mm_probe_cache_lookup_plugin (cache, probe.port));
+    plugin_name = mm_probe_cache_lookup_plugin (cache, other.port);
+    g_assert_cmpstr (plugin_name, ==, "generic");
+    g_assert (load (cache, "generic", &other));
+    g_assert_cmpint (other.result, ==, 2);
+
+    /* Forgetting an unknown device is not an error */
+    mm_probe_cache_forget (cache, DEVICE_UID);
+
+    test_probe_clear (&probe);
+    test_probe_clear (&other);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add ("/MM/probe-cache/hit",        Fixture, NULL, fixture_setup, test_hit,        fixture_teardown);
+    g_test_add ("/MM/probe-cache/miss",       Fixture, NULL, fixture_setup, test_miss,       fixture_teardown);
+    g_test_add ("/MM/probe-cache/invalidate", Fixture, NULL, fixture_setup, test_invalidate, fixture_teardown);
+
+    return g_test_run ();
+}
@@ -34,6 +34,7 @@
 #include "libqcdm/src/utils.h"
 #include "libqcdm/src/com.h"
 #include "libqcdm/src/errors.h"
+#include "libqcdm/src/log-items.h"
 #include "mm-log-test.h"
 
 typedef struct {
@@ -397,6 +398,123 @@ test_leading_frame_markers (TestData *d)
     g_assert (wait_for_child (d, 3));
 }
 
+static void
+qcdm_log_item_count_cb (MMPortSerialQcdm *port,
+                        GByteArray *log_buffer,
+                        guint *n_log_items)
+{
+    g_assert_cmpuint (log_buffer->len, >=, 17);
+    g_assert_cmpuint (log_buffer->data[0], ==, 0x10);
+    (*n_log_items)++;
+}
+
+static void
+qcdm_log_items_test_child (int fd)
+{
+    MMPortSerialQcdm *port;
+    GMainLoop *loop;
+    gboolean success;
+    GError *error = NULL;
+    guint n_log_items = 0;
+
+    loop = g_main_loop_new (NULL, FALSE);
+
+    port = mm_port_serial_qcdm_new_fd (fd);
+    g_assert (port);
+
+    mm_port_serial_qcdm_add_unsolicited_msg_handler (port,
+                                                     DM_LOG_ITEM_WCDMA_RRC_STATE,
+                                                     (MMPortSerialQcdmUnsolicitedMsgFn)qcdm_log_item_count_cb,
+                                                     &n_log_items,
+                                                     NULL);
+
+    success = mm_port_serial_open (MM_PORT_SERIAL (port), &error);
+    g_assert_no_error (error);
+    g_assert (success);
+
+    qcdm_request_verinfo (port, (GAsyncReadyCallback)qcdm_verinfo_expect_success_cb, loop);
+    g_main_loop_run (loop);
+    g_main_loop_unref (loop);
+
+    mm_port_serial_close (MM_PORT_SERIAL (port));
+    g_object_unref (port);
+
+    /* Only the log items with a handler are reported */
+    exit (n_log_items == 3 ? 0 : 1);
+}
+
+static gsize
+build_log_item (guint16 log_code, guint8 value, char *buf, gsize len)
+{
+    char packet[32];
+
+    memset (packet, 0, sizeof (packet));
+    packet[0] = 0x10;  /* DIAG_CMD_LOG */
+    packet[2] = 13;    /* length after this field */
+    packet[4] = 13;
+    packet[6] = log_code & 0xFF;
+    packet[7] = log_code >> 8;
+    packet[16] = value;
+
+    return dm_encapsulate_buffer (packet, 17, sizeof (packet), buf, len);
+}
+
+/* Test that log items received before the response to a Version Info
+ * command are reported, whether they needed unescaping or not, and that
+ * the response is still parsed correctly afterwards.
+ */
+static void
+test_log_items_before_response (TestData *d)
+{
+    char req[512];
+    gsize req_len;
+    pid_t cpid;
+    GByteArray *rsp;
+    char buf[64];
+    gsize len;
+    const char verinfo_rsp[] = {
+        0x00, 0x41, 0x75, 0x67, 0x20, 0x31, 0x39, 0x20, 0x32, 0x30, 0x30, 0x38,
+        0x32, 0x30, 0x3a, 0x34, 0x38, 0x3a, 0x34, 0x37, 0x4f, 0x63, 0x74, 0x20,
+        0x32, 0x39, 0x20, 0x32, 0x30, 0x30, 0x37, 0x31, 0x39, 0x3a, 0x30, 0x30,
+        0x3a, 0x30, 0x30, 0x53, 0x43, 0x4e, 0x52, 0x5a, 0x2e, 0x2e, 0x2e, 0x2a,
+        0x06, 0x04, 0xb9, 0x0b, 0x02, 0x00, 0xb2, 0x19, 0xc4, 0x7e
+    };
+
+    signal (SIGCHLD, SIG_DFL);
+    cpid = fork ();
+    g_assert (cpid >= 0);
+
+    if (cpid == 0) {
+        /* In the child */
+        qcdm_log_items_test_child (d->secondary);
+        g_assert_not_reached ();
+    }
+    /* Parent */
+    d->child = cpid;
+
+    req_len = server_wait_request (d->main, req, sizeof (req));
+    g_assert (req_len == 1);
+    g_assert_cmpint (req[0], ==, 0x00);
+
+    rsp = g_byte_array_new ();
+    len = build_log_item (DM_LOG_ITEM_WCDMA_RRC_STATE, 0x03, buf, sizeof (buf));
+    g_byte_array_append (rsp, (const guint8 *) buf, len);
+    len = build_log_item (DM_LOG_ITEM_WCDMA_CELL_ID, 0x03, buf, sizeof (buf));
+    g_byte_array_append (rsp, (const guint8 *) buf, len);
+    /* Needs unescaping */
+    len = build_log_item (DM_LOG_ITEM_WCDMA_RRC_STATE, 0x7E, buf, sizeof (buf));
+    g_byte_array_append (rsp, (const guint8 *) buf, len);
+    len = build_log_item (DM_LOG_ITEM_WCDMA_RRC_STATE, 0x02, buf, sizeof (buf));
+    g_byte_array_append (rsp, (const guint8 *) buf, len);
+    g_byte_array_append (rsp, (const guint8 *) verinfo_rsp, sizeof (verinfo_rsp));
+
+    server_send_response (d->main, (const char *) rsp->data, rsp->len);
+    g_byte_array_unref (rsp);
+
+    /* We expect the child to exit normally */
+    g_assert (wait_for_child (d, 3));
+}
+
 static void
 test_pty_create (TestData *d)
 {
@@ -448,6 +566,7 @@ int main (int argc, char **argv)
     TESTCASE_PTY ("/MM/QCDM/Sierra-Cns-Rejected", test_sierra_cns_rejected);
     TESTCASE_PTY ("/MM/QCDM/Random-Data-Rejected", test_random_data_rejected);
     TESTCASE_PTY ("/MM/QCDM/Leading-Frame-Markers", test_leading_frame_markers);
+    TESTCASE_PTY ("/MM/QCDM/Log-Items-Before-Response", test_log_items_before_response);
 
     return g_test_run ();
 }
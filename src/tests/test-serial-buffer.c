@@ -0,0 +1,231 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <string.h>
+#include <glib.h>
+
+#include "mm-serial-buffer.h"
+#include "mm-port-serial-gps.h"
+#include "mm-log-test.h"
+
+/*****************************************************************************/
+
+static void
+common_check_contents (MMSerialBuffer *buffer,
+                       const gchar    *expected)
+{
+    const guint8 *data;
+    gsize         len;
+
+    data = mm_serial_buffer_peek (buffer, &len);
+    g_assert_cmpuint (len, ==, strlen (expected));
+    g_assert (memcmp (data, expected, len) == 0);
+}
+
+static void
+test_append_consume (void)
+{
+    g_autoptr(MMSerialBuffer) buffer = NULL;
+
+    buffer = mm_serial_buffer_new (16);
+    g_assert_cmpuint (mm_serial_buffer_get_length (buffer), ==, 0);
+
+    mm_serial_buffer_append (buffer, (const guint8 *) "0123456789", 10);
+    common_check_contents (buffer, "0123456789");
+
+    mm_serial_buffer_consume (buffer, 4);
+    common_check_contents (buffer, "456789");
+
+    mm_serial_buffer_truncate (buffer, 3);
+    common_check_contents (buffer, "456");
+
+    mm_serial_buffer_consume (buffer, 3);
+    g_assert_cmpuint (mm_serial_buffer_get_length (buffer), ==, 0);
+
+    mm_serial_buffer_append (buffer, (const guint8 *) "abc", 3);
+    mm_serial_buffer_clear (buffer);
+    g_assert_cmpuint (mm_serial_buffer_get_length (buffer), ==, 0);
+}
+
+static void
+test_generation (void)
+{
+    g_autoptr(MMSerialBuffer) buffer = NULL;
+    guint                     generation;
+    guint                     i;
+
+    buffer = mm_serial_buffer_new (16);
+    generation = mm_serial_buffer_get_generation (buffer);
+
+    /* Appending, even when it moves or grows the data, keeps it */
+    for (i = 0; i < 10; i++)
+        mm_serial_buffer_append (buffer, (const guint8 *) "0123456789", 10);
+    mm_serial_buffer_consume (buffer, 0);
+    mm_serial_buffer_truncate (buffer, mm_serial_buffer_get_length (buffer));
+    g_assert_cmpuint (mm_serial_buffer_get_generation (buffer), ==, generation);
+
+    /* Removing data changes it */
+    mm_serial_buffer_consume (buffer, 1);
+    g_assert_cmpuint (mm_serial_buffer_get_generation (buffer), !=, generation);
+    generation = mm_serial_buffer_get_generation (buffer);
+
+    mm_serial_buffer_truncate (buffer, 10);
+    g_assert_cmpuint (mm_serial_buffer_get_generation (buffer), !=, generation);
+    generation = mm_serial_buffer_get_generation (buffer);
+
+    mm_serial_buffer_clear (buffer);
+    g_assert_cmpuint (mm_serial_buffer_get_generation (buffer), !=, generation);
+}
+
+static void
+test_reuse_consumed (void)
+{
+    g_autoptr(MMSerialBuffer) buffer = NULL;
+    guint                     i;
+
+    buffer = mm_serial_buffer_new (16);
+
+    /* Keep a few pending bytes around while appending and consuming, the
+     * consumed space must be reused instead of growing the buffer */
+    mm_serial_buffer_append (buffer, (const guint8 *) "ab", 2);
+    for (i = 0; i < 1000; i++) {
+        mm_serial_buffer_append (buffer, (const guint8 *) "cdef", 4);
+        mm_serial_buffer_consume (buffer, 4);
+    }
+    common_check_contents (buffer, "ef");
+    g_assert_cmpuint (mm_serial_buffer_get_allocated_size (buffer), ==, 16);
+}
+
+static void
+test_grow (void)
+{
+    g_autoptr(MMSerialBuffer) buffer = NULL;
+    g_autoptr(GString)        expected = NULL;
+    guint                     i;
+
+    buffer = mm_serial_buffer_new (16);
+    expected = g_string_new (NULL);
+
+    for (i = 0; i < 100; i++) {
+        g_autofree gchar *chunk = NULL;
+
+        chunk = g_strdup_printf ("[%u]", i);
+        mm_serial_buffer_append (buffer, (const guint8 *) chunk, strlen (chunk));
+        g_string_append (expected, chunk);
+
+        /* Consume a bit every now and then */
+        if (i % 10 == 9) {
+            mm_serial_buffer_consume (buffer, 5);
+            g_string_erase (expected, 0, 5);
+        }
+    }
+    common_check_contents (buffer, expected->str);
+    g_assert_cmpuint (mm_serial_buffer_get_allocated_size (buffer), >=, expected->len);
+}
+
+/*****************************************************************************/
+
+static const gchar *nmea_traces[] = {
+    "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n",
+    "$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*39\r\n",
+    "$GPGSV,2,1,08,01,40,083,46,02,17,308,41,12,07,344,39,14,22,228,45*75\r\n",
+    "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n",
+    "$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K*48\r\n",
+};
+
+static void
+gps_trace_cb (MMPortSerialGps *port,
+              const gchar     *trace,
+              gpointer         user_data)
+{
+    guint *n_traces = user_data;
+
+    (*n_traces)++;
+}
+
+#define NMEA_STREAM_SIZE (8 * 1024 * 1024)
+
+static void
+gps_parse_chunk (MMPortSerialGps *port,
+                 MMSerialBuffer  *buffer,
+                 const gchar     *chunk,
+                 gsize            chunk_len)
+{
+    GByteArray *parsed = NULL;
+    GError     *error = NULL;
+
+    mm_serial_buffer_append (buffer, (const guint8 *) chunk, chunk_len);
+    MM_PORT_SERIAL_GET_CLASS (port)->parse_response (MM_PORT_SERIAL (port), buffer, &parsed, &error);
+    if (parsed)
+        g_byte_array_unref (parsed);
+    g_assert_no_error (error);
+}
+
+static void
+test_gps_nmea_benchmark (void)
+{
+    g_autoptr(MMPortSerialGps) port = NULL;
+    g_autoptr(MMSerialBuffer)  buffer = NULL;
+    guint                      n_traces = 0;
+    guint                      n_expected_traces = 0;
+    gsize                      n_bytes = 0;
+    gdouble                    elapsed;
+
+    if (!g_test_perf ()) {
+        g_test_skip ("only run in perf mode");
+        return;
+    }
+
+    port = mm_port_serial_gps_new ("ttyGPS0");
+    mm_port_serial_gps_add_trace_handler (port, gps_trace_cb, &n_traces, NULL);
+    buffer = mm_serial_buffer_new (500);
+
+    /* Feed each trace in two reads, as the serial port would do when data
+     * arrives while the trace is still being written by the modem */
+    g_test_timer_start ();
+    while (n_bytes < NMEA_STREAM_SIZE) {
+        const gchar *trace;
+        gsize        trace_len;
+
+        trace = nmea_traces[n_expected_traces % G_N_ELEMENTS (nmea_traces)];
+        trace_len = strlen (trace);
+        gps_parse_chunk (port, buffer, trace, trace_len / 2);
+        gps_parse_chunk (port, buffer, trace + trace_len / 2, trace_len - trace_len / 2);
+        n_bytes += trace_len;
+        n_expected_traces++;
+    }
+    elapsed = g_test_timer_elapsed ();
+
+    g_assert_cmpuint (n_traces, ==, n_expected_traces);
+
+    g_test_message ("%" G_GSIZE_FORMAT " bytes in %.3fs (%.1f MB/s), %u traces, buffer size %" G_GSIZE_FORMAT " bytes",
+                    n_bytes, elapsed, (n_bytes / elapsed) / (1024.0 * 1024.0),
+                    n_traces, mm_serial_buffer_get_allocated_size (buffer));
+    g_test_maximized_result (n_bytes / elapsed, "%.1f bytes/s", n_bytes / elapsed);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/ModemManager/serial-buffer/append-consume", test_append_consume);
+    g_test_add_func ("/ModemManager/serial-buffer/generation",     test_generation);
+    g_test_add_func ("/ModemManager/serial-buffer/reuse-consumed", test_reuse_consumed);
+    g_test_add_func ("/ModemManager/serial-buffer/grow",           test_grow);
+    g_test_add_func ("/ModemManager/serial-buffer/gps-nmea-benchmark", test_gps_nmea_benchmark);
+
+    return g_test_run ();
+}
@@ -0,0 +1,323 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "mm-shared-request.h"
+#include "mm-log-test.h"
+
+#define N_REQUESTS 3
+
+/*****************************************************************************/
+
+typedef struct {
+    GObject         *source;
+    MMSharedRequest *request;
+    /* Loads started and not yet completed, oldest first */
+    GQueue           loads;
+    guint            n_loads;
+    guint            n_cache_changed;
+    gint64           cached_time;
+} Fixture;
+
+typedef struct {
+    gboolean  done;
+    GVariant *result;
+    GError   *error;
+} Request;
+
+static void
+request_clear (Request *request)
+{
+    g_clear_pointer (&request->result, g_variant_unref);
+    g_clear_error (&request->error);
+    request->done = FALSE;
+}
+
+/*****************************************************************************/
+
+static void
+fake_load (GObject             *source,
+           GAsyncReadyCallback  callback,
+           gpointer             user_data)
+{
+    Fixture *fixture;
+
+    fixture = g_object_get_data (source, "fixture");
+    fixture->n_loads++;
+    g_queue_push_tail (&fixture->loads, g_task_new (source, NULL, callback, user_data));
+}
+
+static GVariant *
+fake_load_finish (GObject       *source,
+                  GAsyncResult  *res,
+                  GError       **error)
+{
+    return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+static void
+fake_cache_changed (GObject *source,
+                    gint64   cached_time)
+{
+    Fixture *fixture;
+
+    fixture = g_object_get_data (source, "fixture");
+    fixture->n_cache_changed++;
+    fixture->cached_time = cached_time;
+}
+
+static void
+complete_load (Fixture *fixture,
+               guint32  value)
+{
+    GTask *task;
+
+    task = g_queue_pop_head (&fixture->loads);
+    g_assert_nonnull (task);
+    g_task_return_pointer (task, g_variant_ref_sink (g_variant_new_uint32 (value)), (GDestroyNotify) g_variant_unref);
+    g_object_unref (task);
+}
+
+static void
+fail_load (Fixture *fixture)
+{
+    GTask *task;
+
+    task = g_queue_pop_head (&fixture->loads);
+    g_assert_nonnull (task);
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_TIMED_OUT, "timed out");
+    g_object_unref (task);
+}
+
+/*****************************************************************************/
+
+static void
+fixture_setup (Fixture       *fixture,
+               gconstpointer  data)
+{
+    fixture->source = g_object_new (G_TYPE_OBJECT, NULL);
+    g_object_set_data (fixture->source, "fixture", fixture);
+    g_queue_init (&fixture->loads);
+    fixture->request = mm_shared_request_new (fixture->source,
+                                              (MMSharedRequestLoadFn) fake_load,
+                                              (MMSharedRequestLoadFinishFn) fake_load_finish,
+                                              GPOINTER_TO_UINT (data),
+                                              (MMSharedRequestCacheChangedFn) fake_cache_changed);
+}
+
+static void
+fixture_teardown (Fixture       *fixture,
+                  gconstpointer  data)
+{
+    g_assert (g_queue_is_empty (&fixture->loads));
+    mm_shared_request_free (fixture->request);
+    g_object_unref (fixture->source);
+}
+
+static void
+request_ready (GObject      *source,
+               GAsyncResult *res,
+               Request      *request)
+{
+    g_assert (!request->done);
+    request->result = mm_shared_request_run_finish (res, &request->error);
+    request->done = TRUE;
+}
+
+static void
+run (Fixture *fixture,
+     Request *request)
+{
+    mm_shared_request_run (fixture->request, (GAsyncReadyCallback) request_ready, request);
+}
+
+static void
+wait_requests (Request *requests,
+               guint    n_requests)
+{
+    guint i;
+
+    for (i = 0; i < n_requests; i++) {
+        while (!requests[i].done)
+            g_main_context_iteration (NULL, TRUE);
+    }
+}
+
+static void
+assert_result (Request *request,
+               guint32  value)
+{
+    g_assert (request->done);
+    g_assert_no_error (request->error);
+    g_assert_nonnull (request->result);
+    g_assert_cmpuint (g_variant_get_uint32 (request->result), ==, value);
+}
+
+/*****************************************************************************/
+
+static void
+test_concurrent (Fixture       *fixture,
+                 gconstpointer  data)
+{
+    Request requests[N_REQUESTS] = { { 0 } };
+    guint   i;
+
+    /* A single load for all the requests received while it runs */
+    for (i = 0; i < N_REQUESTS; i++)
+        run (fixture, &requests[i]);
+    g_assert_cmpuint (fixture->n_loads, ==, 1);
+
+    complete_load (fixture, 42);
+    wait_requests (requests, N_REQUESTS);
+    for (i = 0; i < N_REQUESTS; i++) {
+        assert_result (&requests[i], 42);
+        request_clear (&requests[i]);
+    }
+
+    /* Without cache, the next request loads again */
+    run (fixture, &requests[0]);
+    g_assert_cmpuint (fixture->n_loads, ==, 2);
+    complete_load (fixture, 43);
+    wait_requests (requests, 1);
+    assert_result (&requests[0], 43);
+    request_clear (&requests[0]);
+
+    g_assert_cmpuint (fixture->n_cache_changed, ==, 0);
+}
+
+static void
+test_error (Fixture       *fixture,
+            gconstpointer  data)
+{
+    Request requests[N_REQUESTS] = { { 0 } };
+    guint   i;
+
+    for (i = 0; i < N_REQUESTS; i++)
+        run (fixture, &requests[i]);
+    g_assert_cmpuint (fixture->n_loads, ==, 1);
+
+    fail_load (fixture);
+    wait_requests (requests, N_REQUESTS);
+    for (i = 0; i < N_REQUESTS; i++) {
+        g_assert_error (requests[i].error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT);
+        g_assert_null (requests[i].result);
+        request_clear (&requests[i]);
+    }
+
+    /* Errors are never cached */
+    run (fixture, &requests[0]);
+    g_assert_cmpuint (fixture->n_loads, ==, 2);
+    complete_load (fixture, 1);
+    wait_requests (requests, 1);
+    request_clear (&requests[0]);
+}
+
+static void
+test_cache (Fixture       *fixture,
+            gconstpointer  data)
+{
+    Request request = { 0 };
+
+    run (fixture, &request);
+    complete_load (fixture, 7);
+    wait_requests (&request, 1);
+    assert_result (&request, 7);
+    request_clear (&request);
+    g_assert_cmpuint (fixture->n_cache_changed, ==, 1);
+    g_assert_cmpint (fixture->cached_time, >, 0);
+
+    /* Reused while valid */
+    run (fixture, &request);
+    wait_requests (&request, 1);
+    assert_result (&request, 7);
+    request_clear (&request);
+    g_assert_cmpuint (fixture->n_loads, ==, 1);
+
+    /* Cleared once expired */
+    while (fixture->n_cache_changed < 2)
+        g_main_context_iteration (NULL, TRUE);
+    g_assert_cmpint (fixture->cached_time, ==, 0);
+
+    run (fixture, &request);
+    g_assert_cmpuint (fixture->n_loads, ==, 2);
+    complete_load (fixture, 8);
+    wait_requests (&request, 1);
+    assert_result (&request, 8);
+    request_clear (&request);
+}
+
+static void
+test_invalidate (Fixture       *fixture,
+                 gconstpointer  data)
+{
+    Request            requests[N_REQUESTS] = { { 0 } };
+    Request            request = { 0 };
+    g_autoptr(GError)  error = NULL;
+    guint              i;
+
+    /* Cached results are cleared */
+    run (fixture, &request);
+    complete_load (fixture, 1);
+    wait_requests (&request, 1);
+    request_clear (&request);
+    g_assert_cmpint (fixture->cached_time, >, 0);
+
+    error = g_error_new_literal (G_IO_ERROR, G_IO_ERROR_CANCELLED, "invalidated");
+    mm_shared_request_invalidate (fixture->request, error);
+    g_assert_cmpint (fixture->cached_time, ==, 0);
+
+    /* Requests waiting for the ongoing load fail right away */
+    for (i = 0; i < N_REQUESTS; i++)
+        run (fixture, &requests[i]);
+    g_assert_cmpuint (fixture->n_loads, ==, 2);
+    mm_shared_request_invalidate (fixture->request, error);
+    wait_requests (requests, N_REQUESTS);
+    for (i = 0; i < N_REQUESTS; i++) {
+        g_assert_error (requests[i].error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+        request_clear (&requests[i]);
+    }
+
+    /* New requests don't wait for the invalidated load */
+    run (fixture, &request);
+    g_assert_cmpuint (fixture->n_loads, ==, 3);
+
+    /* And its result is dropped when it arrives */
+    complete_load (fixture, 2);
+    while (g_main_context_iteration (NULL, FALSE));
+    g_assert (!request.done);
+    g_assert_cmpint (fixture->cached_time, ==, 0);
+
+    complete_load (fixture, 3);
+    wait_requests (&request, 1);
+    assert_result (&request, 3);
+    request_clear (&request);
+    g_assert_cmpint (fixture->cached_time, >, 0);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    /* Test data is the cache time, in ms */
+    g_test_add ("/MM/shared-request/concurrent", Fixture, GUINT_TO_POINTER (0),     fixture_setup, test_concurrent, fixture_teardown);
+    g_test_add ("/MM/shared-request/error",      Fixture, GUINT_TO_POINTER (0),     fixture_setup, test_error,      fixture_teardown);
+    g_test_add ("/MM/shared-request/cache",      Fixture, GUINT_TO_POINTER (100),   fixture_setup, test_cache,      fixture_teardown);
+    g_test_add ("/MM/shared-request/invalidate", Fixture, GUINT_TO_POINTER (60000), fixture_setup, test_invalidate, fixture_teardown);
+
+    return g_test_run ();
+}
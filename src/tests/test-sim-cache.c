@@ -0,0 +1,221 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <ModemManager.h>
+#include "mm-sim-cache.h"
+#include "mm-log-test.h"
+#include "test-keyfile-fixture.h"
+
+#define ICCID "89014103211118510720"
+#define IMSI  "310410111851072"
+
+/*****************************************************************************/
+
+static MmGdbusSim *
+sim_new (const gchar *sim_identifier)
+{
+    MmGdbusSim *sim;
+
+    sim = mm_gdbus_sim_skeleton_new ();
+    mm_gdbus_sim_set_sim_identifier (sim, sim_identifier);
+    return sim;
+}
+
+static gboolean
+sim_cache_has (Fixture     *fixture,
+               const gchar *sim_identifier)
+{
+    g_autoptr(MMSimCache) cache = NULL;
+    g_autoptr(MmGdbusSim) sim = NULL;
+
+    cache = fixture_new_object (fixture, MM_TYPE_SIM_CACHE, NULL);
+    sim = sim_new (sim_identifier);
+    return mm_sim_cache_load (cache, sim);
+}
+
+/*****************************************************************************/
+
+static void
+test_store_load (Fixture       *fixture,
+                 gconstpointer  data)
+{
+    g_autoptr(MMSimCache) cache = NULL;
+    g_autoptr(MmGdbusSim) sim = NULL;
+    const gchar          *emergency_numbers[] = { "112", "911", NULL };
+    const guint8          gid1[] = { 0xBA, 0xAD };
+    GVariant             *value;
+    const guint8         *value_data;
+    gsize                 value_size = 0;
+    GStatBuf              st;
+
+    cache = fixture_new_object (fixture, MM_TYPE_SIM_CACHE, NULL);
+    sim = sim_new (ICCID);
+    mm_gdbus_sim_set_imsi (sim, IMSI);
+    mm_gdbus_sim_set_operator_identifier (sim, "310410");
+    mm_gdbus_sim_set_emergency_numbers (sim, emergency_numbers);
+    mm_gdbus_sim_set_gid1 (sim, g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE, gid1, sizeof (gid1), sizeof (guint8)));
+    mm_sim_cache_store (cache, sim);
+    g_clear_object (&sim);
+    g_clear_object (&cache);
+
+    /* Subscriber identifiers must not be readable by others */
+    g_assert_cmpint (g_stat (fixture->path, &st), ==, 0);
+    g_assert_cmpint (st.st_mode & 0777, ==, 0600);
+
+    /* Read back by a new instance, as after a restart */
+    cache = fixture_new_object (fixture, MM_TYPE_SIM_CACHE, NULL);
+    sim = sim_new (ICCID);
+    g_assert (mm_sim_cache_load (cache, sim));
+    g_assert_cmpstr (mm_gdbus_sim_get_imsi (sim), ==, IMSI);
+    g_assert_cmpstr (mm_gdbus_sim_get_operator_identifier (sim), ==, "310410");
+    g_assert_cmpuint (g_strv_length ((GStrv) mm_gdbus_sim_get_emergency_numbers (sim)), ==, 2);
+    g_assert_cmpstr (mm_gdbus_sim_get_emergency_numbers (sim)[0], ==, "112");
+    g_assert_cmpstr (mm_gdbus_sim_get_emergency_numbers (sim)[1], ==, "911");
+    value = mm_gdbus_sim_get_gid1 (sim);
+    g_assert_nonnull (value);
+    value_data = g_variant_get_fixed_array (value, &value_size, sizeof (guint8));
+    g_assert_cmpmem (value_data, value_size, gid1, sizeof (gid1));
+
+    /* Values never read from the card are not cached */
+    g_assert_null (mm_gdbus_sim_get_eid (sim));
+    g_assert_null (mm_gdbus_sim_get_operator_name (sim));
+    g_assert_null (mm_gdbus_sim_get_gid2 (sim));
+}
+
+static void
+test_unknown (Fixture       *fixture,
+              gconstpointer  data)
+{
+    g_autoptr(MMSimCache) cache = NULL;
+    g_autoptr(MmGdbusSim) sim = NULL;
+
+    cache = fixture_new_object (fixture, MM_TYPE_SIM_CACHE, NULL);
+    sim = sim_new (ICCID);
+    mm_gdbus_sim_set_imsi (sim, IMSI);
+    mm_sim_cache_store (cache, sim);
+
+    g_assert (!sim_cache_has (fixture, "89014103211118510721"));
+    /* SIMs without identifier are never cached */
+    g_assert (!sim_cache_has (fixture, NULL));
+}
+
+static void
+test_empty (Fixture       *fixture,
+            gconstpointer  data)
+{
+    g_autoptr(MMSimCache) cache = NULL;
+    g_autoptr(MmGdbusSim) sim = NULL;
+
+    /* A SIM known without any value is as good as unknown */
+    cache = fixture_new_object (fixture, MM_TYPE_SIM_CACHE, NULL);
+    sim = sim_new (ICCID);
+    mm_sim_cache_store (cache, sim);
+    g_assert (!mm_sim_cache_load (cache, sim));
+    g_assert (!sim_cache_has (fixture, ICCID));
+}
+
+static void
+test_disabled (Fixture       *fixture,
+               gconstpointer  data)
+{
+    g_autoptr(MMSimCache) cache = NULL;
+    g_autoptr(MmGdbusSim) sim = NULL;
+
+    cache = g_object_new (MM_TYPE_SIM_CACHE, NULL);
+    sim = sim_new (ICCID);
+    mm_gdbus_sim_set_imsi (sim, IMSI);
+    mm_sim_cache_store (cache, sim);
+    g_assert (!mm_sim_cache_load (cache, sim));
+    mm_sim_cache_forget (cache, ICCID);
+}
+
+static void
+test_prune (Fixture       *fixture,
+            gconstpointer  data)
+{
+    g_autoptr(GKeyFile)   keyfile = NULL;
+    g_autoptr(MMSimCache) cache = NULL;
+    g_autoptr(MmGdbusSim) sim = NULL;
+    guint                 i;
+
+    /* A full cache, where SIM05 is the least recently used one */
+    keyfile = g_key_file_new ();
+    for (i = 0; i < 16; i++) {
+        g_autofree gchar *group = NULL;
+
+        group = g_strdup_printf ("SIM%02u", i);
+        g_key_file_set_string (keyfile, group, "imsi", IMSI);
+        g_key_file_set_int64 (keyfile, group, "last-used", (i == 5) ? 1 : 1000 + i);
+    }
+    g_assert (g_key_file_save_to_file (keyfile, fixture->path, NULL));
+
+    cache = fixture_new_object (fixture, MM_TYPE_SIM_CACHE, NULL);
+    sim = sim_new (ICCID);
+    mm_gdbus_sim_set_imsi (sim, IMSI);
+    mm_sim_cache_store (cache, sim);
+
+    g_assert (sim_cache_has (fixture, ICCID));
+    g_assert (!sim_cache_has (fixture, "SIM05"));
+    for (i = 0; i < 16; i++) {
+        g_autofree gchar *sim_identifier = NULL;
+
+        if (i == 5)
+            continue;
+        sim_identifier = g_strdup_printf ("SIM%02u", i);
+        g_assert (sim_cache_has (fixture, sim_identifier));
+    }
+}
+
+static void
+test_forget (Fixture       *fixture,
+             gconstpointer  data)
+{
+    g_autoptr(MMSimCache) cache = NULL;
+    g_autoptr(MmGdbusSim) sim = NULL;
+
+    cache = fixture_new_object (fixture, MM_TYPE_SIM_CACHE, NULL);
+    sim = sim_new (ICCID);
+    mm_gdbus_sim_set_imsi (sim, IMSI);
+    mm_sim_cache_store (cache, sim);
+    g_assert (sim_cache_has (fixture, ICCID));
+
+    mm_sim_cache_forget (cache, ICCID);
+    g_assert (!mm_sim_cache_load (cache, sim));
+    g_assert (!sim_cache_has (fixture, ICCID));
+
+    /* Forgetting an unknown SIM is not an error */
+    mm_sim_cache_forget (cache, ICCID);
+    mm_sim_cache_forget (cache, NULL);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add ("/MM/sim-cache/store-load", Fixture, NULL, fixture_setup, test_store_load, fixture_teardown);
+    g_test_add ("/MM/sim-cache/unknown",    Fixture, NULL, fixture_setup, test_unknown,    fixture_teardown);
+    g_test_add ("/MM/sim-cache/empty",      Fixture, NULL, fixture_setup, test_empty,      fixture_teardown);
+    g_test_add ("/MM/sim-cache/disabled",   Fixture, NULL, fixture_setup, test_disabled,   fixture_teardown);
+    g_test_add ("/MM/sim-cache/prune",      Fixture, NULL, fixture_setup, test_prune,      fixture_teardown);
+    g_test_add ("/MM/sim-cache/forget",     Fixture, NULL, fixture_setup, test_forget,     fixture_teardown);
+
+    return g_test_run ();
+}
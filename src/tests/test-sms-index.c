@@ -0,0 +1,159 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <glib.h>
+
+#include <ModemManager.h>
+#include "mm-sms-index.h"
+#include "mm-log-test.h"
+
+#define NUMBER       "+34600000001"
+#define OTHER_NUMBER "+34600000002"
+
+#define BENCHMARK_PARTS 10000
+
+/* Messages are never dereferenced by the index */
+#define SMS(n) GUINT_TO_POINTER (n)
+
+/*****************************************************************************/
+
+static void
+test_part (void)
+{
+    MMSmsIndex *index;
+
+    index = mm_sms_index_new ();
+
+    mm_sms_index_add_part (index, MM_SMS_STORAGE_SM, 1, SMS (1));
+    mm_sms_index_add_part (index, MM_SMS_STORAGE_SM, 2, SMS (1));
+    mm_sms_index_add_part (index, MM_SMS_STORAGE_ME, 1, SMS (2));
+    g_assert (mm_sms_index_lookup_part (index, MM_SMS_STORAGE_SM, 1) == SMS (1));
+    g_assert (mm_sms_index_lookup_part (index, MM_SMS_STORAGE_SM, 2) == SMS (1));
+
+    /* The same index in another storage is another part */
+    g_assert (mm_sms_index_lookup_part (index, MM_SMS_STORAGE_ME, 1) == SMS (2));
+    g_assert_null (mm_sms_index_lookup_part (index, MM_SMS_STORAGE_ME, 2));
+    g_assert_null (mm_sms_index_lookup_part (index, MM_SMS_STORAGE_SM, 3));
+
+    /* Never replaced */
+    mm_sms_index_add_part (index, MM_SMS_STORAGE_SM, 1, SMS (3));
+    g_assert (mm_sms_index_lookup_part (index, MM_SMS_STORAGE_SM, 1) == SMS (1));
+
+    /* Only removed by the message owning it */
+    mm_sms_index_remove_part (index, MM_SMS_STORAGE_SM, 1, SMS (3));
+    g_assert (mm_sms_index_lookup_part (index, MM_SMS_STORAGE_SM, 1) == SMS (1));
+    mm_sms_index_remove_part (index, MM_SMS_STORAGE_SM, 1, SMS (1));
+    g_assert_null (mm_sms_index_lookup_part (index, MM_SMS_STORAGE_SM, 1));
+    g_assert (mm_sms_index_lookup_part (index, MM_SMS_STORAGE_SM, 2) == SMS (1));
+    g_assert (mm_sms_index_lookup_part (index, MM_SMS_STORAGE_ME, 1) == SMS (2));
+
+    /* Removing unknown parts is not an error */
+    mm_sms_index_remove_part (index, MM_SMS_STORAGE_SM, 1, SMS (1));
+
+    mm_sms_index_free (index);
+}
+
+static void
+test_multipart (void)
+{
+    MMSmsIndex *index;
+
+    index = mm_sms_index_new ();
+
+    mm_sms_index_add_multipart (index, MM_SMS_STORAGE_SM, NUMBER, 7, SMS (1));
+    g_assert (mm_sms_index_lookup_multipart (index, MM_SMS_STORAGE_SM, NUMBER, 7) == SMS (1));
+    g_assert_null (mm_sms_index_lookup_multipart (index, MM_SMS_STORAGE_SM, NUMBER, 8));
+
+    /* The same reference from another number is another message */
+    g_assert_null (mm_sms_index_lookup_multipart (index, MM_SMS_STORAGE_SM, OTHER_NUMBER, 7));
+    mm_sms_index_add_multipart (index, MM_SMS_STORAGE_SM, OTHER_NUMBER, 7, SMS (2));
+    g_assert (mm_sms_index_lookup_multipart (index, MM_SMS_STORAGE_SM, OTHER_NUMBER, 7) == SMS (2));
+    g_assert (mm_sms_index_lookup_multipart (index, MM_SMS_STORAGE_SM, NUMBER, 7) == SMS (1));
+
+    /* The same reference and number in another storage is another message */
+    g_assert_null (mm_sms_index_lookup_multipart (index, MM_SMS_STORAGE_ME, NUMBER, 7));
+    mm_sms_index_add_multipart (index, MM_SMS_STORAGE_ME, NUMBER, 7, SMS (5));
+    g_assert (mm_sms_index_lookup_multipart (index, MM_SMS_STORAGE_ME, NUMBER, 7) == SMS (5));
+    g_assert (mm_sms_index_lookup_multipart (index, MM_SMS_STORAGE_SM, NUMBER, 7) == SMS (1));
+
+    /* Parts without number */
+    g_assert_null (mm_sms_index_lookup_multipart (index, MM_SMS_STORAGE_SM, NULL, 7));
+    mm_sms_index_add_multipart (index, MM_SMS_STORAGE_SM, NULL, 7, SMS (3));
+    g_assert (mm_sms_index_lookup_multipart (index, MM_SMS_STORAGE_SM, NULL, 7) == SMS (3));
+
+    /* Never replaced, and only removed by the message owning it */
+    mm_sms_index_add_multipart (index, MM_SMS_STORAGE_SM, NUMBER, 7, SMS (4));
+    g_assert (mm_sms_index_lookup_multipart (index, MM_SMS_STORAGE_SM, NUMBER, 7) == SMS (1));
+    mm_sms_index_remove_multipart (index, MM_SMS_STORAGE_SM, NUMBER, 7, SMS (4));
+    g_assert (mm_sms_index_lookup_multipart (index, MM_SMS_STORAGE_SM, NUMBER, 7) == SMS (1));
+
+    /* A reused reference takes over once the previous message is removed */
+    mm_sms_index_remove_multipart (index, MM_SMS_STORAGE_SM, NUMBER, 7, SMS (1));
+    g_assert_null (mm_sms_index_lookup_multipart (index, MM_SMS_STORAGE_SM, NUMBER, 7));
+    mm_sms_index_add_multipart (index, MM_SMS_STORAGE_SM, NUMBER, 7, SMS (4));
+    g_assert (mm_sms_index_lookup_multipart (index, MM_SMS_STORAGE_SM, NUMBER, 7) == SMS (4));
+    g_assert (mm_sms_index_lookup_multipart (index, MM_SMS_STORAGE_SM, OTHER_NUMBER, 7) == SMS (2));
+    g_assert (mm_sms_index_lookup_multipart (index, MM_SMS_STORAGE_ME, NUMBER, 7) == SMS (5));
+
+    mm_sms_index_free (index);
+}
+
+static void
+test_benchmark (void)
+{
+    MMSmsIndex *index;
+    gdouble     elapsed;
+    guint       i;
+
+    if (!g_test_perf ()) {
+        g_test_skip ("only run in perf mode");
+        return;
+    }
+
+    /* As when listing a full storage on boot: every part is first checked,
+     * then indexed, in messages of 4 parts from 100 different senders */
+    index = mm_sms_index_new ();
+    g_test_timer_start ();
+    for (i = 0; i < BENCHMARK_PARTS; i++) {
+        g_autofree gchar *number = NULL;
+        gpointer          sms;
+
+        g_assert_null (mm_sms_index_lookup_part (index, MM_SMS_STORAGE_SM, i));
+        number = g_strdup_printf ("+346%08u", i % 100);
+        sms = mm_sms_index_lookup_multipart (index, MM_SMS_STORAGE_SM, number, (i / 400) % 256);
+        if (!sms) {
+            sms = SMS (i + 1);
+            mm_sms_index_add_multipart (index, MM_SMS_STORAGE_SM, number, (i / 400) % 256, sms);
+        }
+        mm_sms_index_add_part (index, MM_SMS_STORAGE_SM, i, sms);
+    }
+    elapsed = g_test_timer_elapsed ();
+    g_test_message ("%u parts indexed in %.3fs", BENCHMARK_PARTS, elapsed);
+    g_test_minimized_result (elapsed, "%.3f s", elapsed);
+
+    mm_sms_index_free (index);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/MM/sms-index/part",      test_part);
+    g_test_add_func ("/MM/sms-index/multipart", test_multipart);
+    g_test_add_func ("/MM/sms-index/benchmark", test_benchmark);
+
+    return g_test_run ();
+}
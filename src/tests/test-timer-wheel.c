@@ -0,0 +1,176 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include <config.h>
+#include <glib.h>
+
+#include "mm-context.h"
+#include "mm-timer-wheel.h"
+#include "mm-log-test.h"
+
+/*****************************************************************************/
+
+typedef struct {
+    guint   id;
+    /* Runs before the job removes itself */
+    guint   max_runs;
+    guint   n_runs;
+    gint64  last_run;
+    /* Another job to remove when run */
+    guint   remove_id;
+    /* Shared by the jobs of a test, to record the order in which they run */
+    GArray *order;
+} TestJob;
+
+static gboolean
+test_job_cb (TestJob *job)
+{
+    job->n_runs++;
+    job->last_run = g_get_monotonic_time ();
+    if (job->order)
+        g_array_append_val (job->order, job);
+    if (job->remove_id) {
+        mm_timer_wheel_remove (job->remove_id);
+        job->remove_id = 0;
+    }
+    return (job->n_runs < job->max_runs) ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+}
+
+static void
+test_job_add (TestJob *job,
+              guint    interval,
+              guint    max_runs)
+{
+    job->max_runs = max_runs;
+    job->id = mm_timer_wheel_add_seconds (interval, (GSourceFunc) test_job_cb, job);
+    g_assert_cmpuint (job->id, !=, 0);
+}
+
+static void
+test_job_wait (TestJob *job)
+{
+    while (job->n_runs < job->max_runs)
+        g_main_context_iteration (NULL, TRUE);
+}
+
+/*****************************************************************************/
+
+static void
+test_add (void)
+{
+    TestJob job = { 0 };
+    gint64  start;
+
+    start = g_get_monotonic_time ();
+    test_job_add (&job, 1, 2);
+    g_assert_cmpint (mm_timer_wheel_peek_wakeup (), >, start);
+
+    /* Run again after the interval until it removes itself */
+    test_job_wait (&job);
+    g_assert_cmpuint (job.n_runs, ==, 2);
+    g_assert_cmpint (job.last_run - start, >=, 2 * G_USEC_PER_SEC);
+    g_assert_cmpint (mm_timer_wheel_peek_wakeup (), ==, 0);
+}
+
+static void
+test_remove (void)
+{
+    TestJob soon = { 0 };
+    TestJob late = { 0 };
+    TestJob remover = { 0 };
+    TestJob removed = { 0 };
+    gint64  wakeup;
+
+    test_job_add (&late, 2, 1);
+    test_job_add (&soon, 1, 1);
+    wakeup = mm_timer_wheel_peek_wakeup ();
+    g_assert_cmpint (wakeup, >, 0);
+
+    /* The source is re-armed for the next job */
+    mm_timer_wheel_remove (soon.id);
+    g_assert_cmpint (mm_timer_wheel_peek_wakeup (), >, wakeup);
+    test_job_wait (&late);
+    g_assert_cmpuint (soon.n_runs, ==, 0);
+    g_assert_cmpint (mm_timer_wheel_peek_wakeup (), ==, 0);
+
+    /* Removed by a job run in the same wakeup, before it */
+    test_job_add (&remover, 1, 1);
+    test_job_add (&removed, 1, 1);
+    remover.remove_id = removed.id;
+    test_job_wait (&remover);
+    g_assert_cmpuint (removed.n_runs, ==, 0);
+    g_assert_cmpint (mm_timer_wheel_peek_wakeup (), ==, 0);
+
+    /* Removing unknown jobs is not an error */
+    mm_timer_wheel_remove (removed.id);
+}
+
+static void
+test_ordering (void)
+{
+    g_autoptr(GArray) order = NULL;
+    TestJob           slow = { 0 };
+    TestJob           fast1 = { 0 };
+    TestJob           fast2 = { 0 };
+
+    order = g_array_new (FALSE, FALSE, sizeof (TestJob *));
+    slow.order = fast1.order = fast2.order = order;
+
+    test_job_add (&slow, 2, 1);
+    test_job_add (&fast1, 1, 1);
+    test_job_add (&fast2, 1, 1);
+    test_job_wait (&slow);
+    test_job_wait (&fast1);
+    test_job_wait (&fast2);
+
+    /* Earliest deadline first, and in the order they were added if the same */
+    g_assert_cmpuint (order->len, ==, 3);
+    g_assert (g_array_index (order, TestJob *, 0) == &fast1);
+    g_assert (g_array_index (order, TestJob *, 1) == &fast2);
+    g_assert (g_array_index (order, TestJob *, 2) == &slow);
+}
+
+static void
+test_coalescing (void)
+{
+    TestJob first = { 0 };
+    TestJob second = { 0 };
+
+    /* Deadlines one second apart; the first job may be delayed up to one
+     * second (a quarter of its interval), so both share one wakeup */
+    test_job_add (&first, 4, 1);
+    test_job_add (&second, 5, 1);
+    test_job_wait (&first);
+    g_assert_cmpuint (second.n_runs, ==, 1);
+    g_assert_cmpint (ABS (second.last_run - first.last_run), <, G_USEC_PER_SEC / 2);
+    g_assert_cmpint (mm_timer_wheel_peek_wakeup (), ==, 0);
+}
+
+/*****************************************************************************/
+
+int main (int argc, char **argv)
+{
+    gchar *context_argv[] = { argv[0], (gchar *) "--test-no-suspend-resume", NULL };
+
+    g_test_init (&argc, &argv, NULL);
+
+    /* Jobs are run from the main loop, never talk to the sleep monitor */
+    mm_context_init (G_N_ELEMENTS (context_argv) - 1, context_argv);
+
+    g_test_add_func ("/MM/timer-wheel/add",        test_add);
+    g_test_add_func ("/MM/timer-wheel/remove",     test_remove);
+    g_test_add_func ("/MM/timer-wheel/ordering",   test_ordering);
+    g_test_add_func ("/MM/timer-wheel/coalescing", test_coalescing);
+
+    return g_test_run ();
+}
@@ -19,6 +19,8 @@
 #include <stdio.h>
 #include <locale.h>
 
+#include <glib/gstdio.h>
+
 #define _LIBMM_INSIDE_MM
 #include <libmm-glib.h>
 
@@ -41,6 +43,252 @@ test_load_cleanup_core (void)
     g_array_unref (rules);
 }
 
+static void
+test_index_core (void)
+{
+    GArray                      *rules;
+    GError                      *error = NULL;
+    g_autoptr(MMUdevRulesIndex)  index = NULL;
+    const MMUdevRuleProgram     *qdl_program;
+    const MMUdevRuleProgram     *other_program;
+
+    rules = mm_kernel_device_generic_rules_load (TESTUDEVRULESDIR, &error);
+    g_assert_no_error (error);
+    g_assert (rules);
+
+    index = mm_udev_rules_index_new (rules);
+    g_array_unref (rules);
+
+    /* The Qualcomm QDL rule only applies to 05c6:9008 */
+    qdl_program = mm_udev_rules_index_lookup_program (index, 0x05c6, 0x9008, "tty");
+    other_program = mm_udev_rules_index_lookup_program (index, 0x1234, 0x5678, "tty");
+    g_assert_cmpuint (qdl_program->n_steps, ==, other_program->n_steps + 1);
+    g_assert_cmpuint (qdl_program->n_steps, <, mm_udev_rules_index_get_n_rules (index));
+
+    /* Programs are built once per bucket */
+    g_assert (qdl_program == mm_udev_rules_index_lookup_program (index, 0x05c6, 0x9008, "tty"));
+    g_assert (qdl_program != mm_udev_rules_index_lookup_program (index, 0x05c6, 0x9008, "net"));
+}
+
+/************************************************************/
+
+#define SYNTHETIC_N_VENDORS  25
+#define SYNTHETIC_N_PRODUCTS 20
+#define SYNTHETIC_VID(v)     (0x1000 + (v))
+#define SYNTHETIC_PID(p)     (0x2000 + (p))
+
+/* Rule files mimicking the layout of the plugin port type rules */
+static gchar *
+synthetic_rules_dir_new (void)
+{
+    GError *error = NULL;
+    gchar  *dir;
+    guint   v;
+
+    dir = g_dir_make_tmp ("mm-test-udev-rules-XXXXXX", &error);
+    g_assert_no_error (error);
+
+    for (v = 0; v < SYNTHETIC_N_VENDORS; v++) {
+        g_autoptr(GString)  contents = NULL;
+        g_autofree gchar   *path = NULL;
+        guint               p;
+
+        contents = g_string_new (NULL);
+        g_string_append_printf (contents, "ACTION!=\"add|change|move|bind\", GOTO=\"mm_synthetic_%u_end\"\n", v);
+        g_string_append_printf (contents, "SUBSYSTEMS==\"usb\", ATTRS{idVendor}==\"%04x\", GOTO=\"mm_synthetic_%u_vendorcheck\"\n", SYNTHETIC_VID (v), v);
+        g_string_append_printf (contents, "GOTO=\"mm_synthetic_%u_end\"\n", v);
+        g_string_append_printf (contents, "LABEL=\"mm_synthetic_%u_vendorcheck\"\n", v);
+        g_string_append        (contents, "SUBSYSTEMS==\"usb\", ATTRS{bInterfaceNumber}==\"?*\", ENV{.MM_USBIFNUM}=\"$attr{bInterfaceNumber}\"\n");
+        for (p = 0; p < SYNTHETIC_N_PRODUCTS; p++)
+            g_string_append_printf (contents, "ATTRS{idProduct}==\"%04x\", ENV{.MM_USBIFNUM}==\"%02x\", ENV{ID_MM_PORT_TYPE_AT_PRIMARY}=\"1\"\n",
+                                    SYNTHETIC_PID (p), p % 4);
+        g_string_append_printf (contents, "LABEL=\"mm_synthetic_%u_end\"\n", v);
+
+        path = g_strdup_printf ("%s/77-mm-synthetic-%02u.rules", dir, v);
+        g_file_set_contents (path, contents->str, -1, &error);
+        g_assert_no_error (error);
+    }
+
+    return dir;
+}
+
+static void
+synthetic_rules_dir_free (gchar *dir)
+{
+    guint v;
+
+    for (v = 0; v < SYNTHETIC_N_VENDORS; v++) {
+        g_autofree gchar *path = NULL;
+
+        path = g_strdup_printf ("%s/77-mm-synthetic-%02u.rules", dir, v);
+        g_unlink (path);
+    }
+    g_rmdir (dir);
+    g_free (dir);
+}
+
+typedef struct {
+    guint16     vid;
+    guint16     pid;
+    guint8      interface_number;
+    GHashTable *properties;
+    guint       n_checks;
+} TestDevice;
+
+static gboolean
+test_device_check_condition (const MMUdevRuleCondition *condition,
+                             TestDevice                *device)
+{
+    device->n_checks++;
+
+    switch (condition->type) {
+    case MM_UDEV_RULE_CONDITION_TYPE_SUBSYSTEMS:
+        return (g_str_equal (condition->value, "usb") == condition->equal);
+    case MM_UDEV_RULE_CONDITION_TYPE_VID:
+        return ((device->vid == condition->number) == condition->equal);
+    case MM_UDEV_RULE_CONDITION_TYPE_PID:
+        return ((device->pid == condition->number) == condition->equal);
+    case MM_UDEV_RULE_CONDITION_TYPE_INTERFACE_NUMBER:
+        return ((device->interface_number == condition->number) == condition->equal);
+    case MM_UDEV_RULE_CONDITION_TYPE_PROPERTY:
+        return ((!g_strcmp0 (g_hash_table_lookup (device->properties, condition->name), condition->value)) == condition->equal);
+    default:
+        return !condition->equal;
+    }
+}
+
+static void
+test_device_set_property (const MMUdevCompiledRule *rule,
+                          TestDevice               *device)
+{
+    gchar *value;
+
+    if (rule->property_value_source == MM_UDEV_RULE_VALUE_SOURCE_INTERFACE_NUMBER)
+        value = g_strdup_printf ("%02x", device->interface_number);
+    else
+        value = g_strdup (rule->property_value);
+    g_hash_table_replace (device->properties, (gpointer) rule->property_name, value);
+}
+
+static void
+test_device_run (MMUdevRulesIndex *index,
+                 TestDevice       *device,
+                 const gchar      *subsystem)
+{
+    const MMUdevRuleProgram *program;
+
+    program = mm_udev_rules_index_lookup_program (index, device->vid, device->pid, subsystem);
+    mm_udev_rule_program_run (program,
+                              (MMUdevRuleConditionFunc) test_device_check_condition,
+                              (MMUdevRulePropertyFunc) test_device_set_property,
+                              device);
+}
+
+static MMUdevRulesIndex *
+synthetic_rules_index_new (void)
+{
+    gchar            *dir;
+    GArray           *rules;
+    GError           *error = NULL;
+    MMUdevRulesIndex *index;
+
+    dir = synthetic_rules_dir_new ();
+    rules = mm_kernel_device_generic_rules_load (dir, &error);
+    g_assert_no_error (error);
+    g_assert (rules);
+    g_assert_cmpuint (rules->len, ==, SYNTHETIC_N_VENDORS * (SYNTHETIC_N_PRODUCTS + 6));
+    synthetic_rules_dir_free (dir);
+
+    index = mm_udev_rules_index_new (rules);
+    g_array_unref (rules);
+    return index;
+}
+
+static void
+test_index_run (void)
+{
+    g_autoptr(MMUdevRulesIndex) index = NULL;
+    TestDevice                  device = { 0 };
+
+    index = synthetic_rules_index_new ();
+    device.properties = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+
+    /* Matching vendor, product and interface */
+    device.vid = SYNTHETIC_VID (3);
+    device.pid = SYNTHETIC_PID (5);
+    device.interface_number = 1;
+    test_device_run (index, &device, "tty");
+    g_assert_cmpstr (g_hash_table_lookup (device.properties, ".MM_USBIFNUM"), ==, "01");
+    g_assert_cmpstr (g_hash_table_lookup (device.properties, "ID_MM_PORT_TYPE_AT_PRIMARY"), ==, "1");
+
+    /* Matching vendor and product, but not interface */
+    g_hash_table_remove_all (device.properties);
+    device.interface_number = 0;
+    test_device_run (index, &device, "tty");
+    g_assert_cmpstr (g_hash_table_lookup (device.properties, ".MM_USBIFNUM"), ==, "00");
+    g_assert (!g_hash_table_contains (device.properties, "ID_MM_PORT_TYPE_AT_PRIMARY"));
+
+    /* Product of another vendor */
+    g_hash_table_remove_all (device.properties);
+    device.vid = 0x1234;
+    device.interface_number = 1;
+    test_device_run (index, &device, "tty");
+    g_assert_cmpuint (g_hash_table_size (device.properties), ==, 0);
+
+    g_hash_table_unref (device.properties);
+}
+
+#define BENCHMARK_N_DEVICES 1000
+
+static void
+test_index_benchmark (void)
+{
+    static const gchar          *subsystems[] = { "tty", "net", "usbmisc", "wwan" };
+    g_autoptr(MMUdevRulesIndex)  index = NULL;
+    g_autoptr(GRand)             rand = NULL;
+    guint64                      n_steps = 0;
+    guint64                      n_checks = 0;
+    guint                        n_matched = 0;
+    gdouble                      elapsed;
+    guint                        i;
+
+    if (!g_test_perf ()) {
+        g_test_skip ("only run in perf mode");
+        return;
+    }
+
+    index = synthetic_rules_index_new ();
+    rand = g_rand_new_with_seed (1000);
+
+    g_test_timer_start ();
+    for (i = 0; i < BENCHMARK_N_DEVICES; i++) {
+        TestDevice   device = { 0 };
+        const gchar *subsystem;
+
+        /* Half the devices from known vendors, half from unknown ones */
+        device.vid = (i % 2) ? SYNTHETIC_VID (g_rand_int_range (rand, 0, SYNTHETIC_N_VENDORS)) : g_rand_int_range (rand, 0x3000, 0xFFFF);
+        device.pid = SYNTHETIC_PID (g_rand_int_range (rand, 0, SYNTHETIC_N_PRODUCTS * 2));
+        device.interface_number = g_rand_int_range (rand, 0, 4);
+        device.properties = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+        subsystem = subsystems[g_rand_int_range (rand, 0, G_N_ELEMENTS (subsystems))];
+
+        test_device_run (index, &device, subsystem);
+        n_steps += mm_udev_rules_index_lookup_program (index, device.vid, device.pid, subsystem)->n_steps;
+        n_checks += device.n_checks;
+        if (g_hash_table_contains (device.properties, "ID_MM_PORT_TYPE_AT_PRIMARY"))
+            n_matched++;
+        g_hash_table_unref (device.properties);
+    }
+    elapsed = g_test_timer_elapsed ();
+
+    g_assert_cmpuint (n_steps, <, (guint64) BENCHMARK_N_DEVICES * mm_udev_rules_index_get_n_rules (index));
+
+    g_test_message ("%u devices in %.3fs: %u rules, %.1f rules per device, %.1f condition checks per device, %u matched",
+                    BENCHMARK_N_DEVICES, elapsed, mm_udev_rules_index_get_n_rules (index),
+                    (gdouble) n_steps / BENCHMARK_N_DEVICES, (gdouble) n_checks / BENCHMARK_N_DEVICES, n_matched);
+    g_test_minimized_result (elapsed / BENCHMARK_N_DEVICES, "%.2f us per device", (elapsed * 1000000) / BENCHMARK_N_DEVICES);
+}
+
 /************************************************************/
 
 int main (int argc, char **argv)
@@ -50,6 +298,9 @@ int main (int argc, char **argv)
     g_test_init (&argc, &argv, NULL);
 
     g_test_add_func ("/MM/test-udev-rules/load-cleanup-core", test_load_cleanup_core);
+    g_test_add_func ("/MM/test-udev-rules/index-core",        test_index_core);
+    g_test_add_func ("/MM/test-udev-rules/index-run",         test_index_run);
+    g_test_add_func ("/MM/test-udev-rules/index-benchmark",   test_index_benchmark);
 
     return g_test_run ();
 }
@@ -0,0 +1,411 @@
+/* -*- Mode: C; tab-width: 4; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details:
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <locale.h>
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
+
+#include <mm-port-trace.h>
+
+#define PROGRAM_NAME    "mmreplay"
+#define PROGRAM_VERSION PACKAGE_VERSION
+
+#define READ_BUFFER_SIZE 4096
+
+/* Globals */
+static GMainLoop         *loop;
+static MMPortTraceReader *reader;
+static GSocketService    *service;
+static GSocketConnection *connection;
+static GByteArray        *expected;
+static GByteArray        *pending_reply;
+static guint8             read_buffer[READ_BUFFER_SIZE];
+static guint16            port_id;
+static gint64             last_timestamp;
+static gint64             start_time;
+static guint              n_tx_bytes;
+static guint              n_rx_bytes;
+static guint              n_mismatches;
+static guint              send_id;
+static gboolean           capture_done;
+
+/* Context */
+static gchar    *capture_str;
+static gchar    *port_str;
+static gchar    *socket_str;
+static gboolean  realtime_flag;
+static gboolean  verbose_flag;
+static gboolean  version_flag;
+
+static GOptionEntry main_entries[] = {
+    { "capture", 'c', 0, G_OPTION_ARG_FILENAME, &capture_str,
+      "Path to the capture file",
+      "[PATH]"
+    },
+    { "port", 'p', 0, G_OPTION_ARG_STRING, &port_str,
+      "Name of the port to replay (default: first serial port in the capture)",
+      "[NAME]"
+    },
+    { "socket", 's', 0, G_OPTION_ARG_STRING, &socket_str,
+      "Unix socket to listen in (default: abstract:mmreplay)",
+      "[NAME]"
+    },
+    { "realtime", 'r', 0, G_OPTION_ARG_NONE, &realtime_flag,
+      "Keep the original delays between the replies of the modem",
+      NULL
+    },
+    { "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose_flag,
+      "Run action with verbose logs",
+      NULL
+    },
+    { "version", 'V', 0, G_OPTION_ARG_NONE, &version_flag,
+      "Print version",
+      NULL
+    },
+    { NULL }
+};
+
+static void
+print_version_and_exit (void)
+{
+    g_print ("\n"
+             PROGRAM_NAME " " PROGRAM_VERSION "\n"
+             "License GPLv2+: GNU GPL version 2 or later <http://gnu.org/licenses/gpl-2.0.html>\n"
+             "This is free software: you are free to change and redistribute it.\n"
+             "There is NO WARRANTY, to the extent permitted by law.\n"
+             "\n");
+    exit (EXIT_SUCCESS);
+}
+
+static void
+print_data (const gchar  *prefix,
+            const guint8 *data,
+            gsize         len)
+{
+    g_autoptr(GString) str = NULL;
+    gsize              i;
+
+    if (!verbose_flag)
+        return;
+
+    str = g_string_new (prefix);
+    g_string_append (str, " '");
+    for (i = 0; i < len; i++) {
+        if (g_ascii_isprint (data[i]))
+            g_string_append_c (str, data[i]);
+        else if (data[i] == '\r')
+            g_string_append (str, "<CR>");
+        else if (data[i] == '\n')
+            g_string_append (str, "<LF>");
+        else
+            g_string_append_printf (str, "\\%u", data[i]);
+    }
+    g_string_append_c (str, '\'');
+    g_print ("%s\n", str->str);
+}
+
+/*****************************************************************************/
+
+static void replay_next (void);
+
+static void
+replay_finish (void)
+{
+    gdouble elapsed;
+
+    elapsed = (g_get_monotonic_time () - start_time) / (gdouble) G_USEC_PER_SEC;
+    g_print ("replay finished in %.3fs: %u bytes received, %u bytes sent, %u mismatches\n",
+             elapsed, n_tx_bytes, n_rx_bytes, n_mismatches);
+    g_main_loop_quit (loop);
+}
+
+static gboolean
+send_cb (GByteArray *data)
+{
+    g_autoptr(GError) error = NULL;
+    GOutputStream    *output;
+
+    send_id = 0;
+
+    print_data ("<--", data->data, data->len);
+    output = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+    if (!g_output_stream_write_all (output, data->data, data->len, NULL, NULL, &error)) {
+        g_printerr ("error: couldn't send data: %s\n", error->message);
+        g_main_loop_quit (loop);
+        return G_SOURCE_REMOVE;
+    }
+    n_rx_bytes += data->len;
+
+    replay_next ();
+    return G_SOURCE_REMOVE;
+}
+
+static void
+replay_next (void)
+{
+    g_autoptr(GError) error = NULL;
+    MMPortTraceRecord record;
+
+    while (mm_port_trace_reader_next (reader, &record, &error)) {
+        GByteArray *reply;
+        gint64      delay;
+
+        if (record.port_id != port_id)
+            continue;
+
+        delay = last_timestamp ? record.timestamp - last_timestamp : 0;
+        last_timestamp = record.timestamp;
+
+        /* Data the client is expected to send, just queue it */
+        if (record.type == MM_PORT_TRACE_RECORD_TYPE_TX) {
+            g_byte_array_append (expected, record.data, record.length);
+            continue;
+        }
+
+        if (record.type != MM_PORT_TRACE_RECORD_TYPE_RX)
+            continue;
+
+        reply = g_byte_array_append (g_byte_array_sized_new (record.length), record.data, record.length);
+
+        /* Wait for the client to send whatever was sent before this reply */
+        if (expected->len > 0) {
+            pending_reply = reply;
+            return;
+        }
+
+        send_id = g_timeout_add_full (G_PRIORITY_DEFAULT,
+                                      realtime_flag ? (delay / 1000) : 0,
+                                      (GSourceFunc) send_cb,
+                                      reply,
+                                      (GDestroyNotify) g_byte_array_unref);
+        return;
+    }
+
+    if (error) {
+        g_printerr ("error: couldn't read capture: %s\n", error->message);
+        n_mismatches++;
+    }
+
+    /* Nothing else to send, finish once the client sent everything expected */
+    capture_done = TRUE;
+    if (expected->len == 0)
+        replay_finish ();
+}
+
+static void
+process_input (const guint8 *data,
+               gsize         len)
+{
+    gsize n_matched;
+
+    print_data ("-->", data, len);
+    n_tx_bytes += len;
+
+    n_matched = MIN (len, expected->len);
+    if (n_matched < len || memcmp (data, expected->data, n_matched) != 0) {
+        g_printerr ("warning: received data doesn't match the capture\n");
+        n_mismatches++;
+    }
+    g_byte_array_remove_range (expected, 0, n_matched);
+    if (expected->len > 0)
+        return;
+
+    if (capture_done) {
+        replay_finish ();
+        return;
+    }
+
+    /* Send the reply that was waiting for this data */
+    if (pending_reply)
+        send_id = g_idle_add_full (G_PRIORITY_DEFAULT,
+                                   (GSourceFunc) send_cb,
+                                   g_steal_pointer (&pending_reply),
+                                   (GDestroyNotify) g_byte_array_unref);
+}
+
+static void
+read_ready (GInputStream *input,
+            GAsyncResult *res)
+{
+    g_autoptr(GError) error = NULL;
+    gssize            n_read;
+
+    n_read = g_input_stream_read_finish (input, res, &error);
+    if (n_read <= 0) {
+        if (error)
+            g_printerr ("error: couldn't read data: %s\n", error->message);
+        else
+            g_printerr ("error: client disconnected\n");
+        g_main_loop_quit (loop);
+        return;
+    }
+
+    process_input (read_buffer, n_read);
+
+    if (g_main_loop_is_running (loop))
+        g_input_stream_read_async (input, read_buffer, sizeof (read_buffer), G_PRIORITY_DEFAULT, NULL,
+                                   (GAsyncReadyCallback) read_ready, NULL);
+}
+
+static gboolean
+incoming_cb (GSocketService    *socket_service,
+             GSocketConnection *socket_connection)
+{
+    GInputStream *input;
+
+    if (connection) {
+        g_printerr ("warning: only one client allowed\n");
+        return FALSE;
+    }
+
+    g_print ("client connected, replaying...\n");
+    connection = g_object_ref (socket_connection);
+    start_time = g_get_monotonic_time ();
+
+    input = g_io_stream_get_input_stream (G_IO_STREAM (connection));
+    g_input_stream_read_async (input, read_buffer, sizeof (read_buffer), G_PRIORITY_DEFAULT, NULL,
+                               (GAsyncReadyCallback) read_ready, NULL);
+
+    replay_next ();
+    return TRUE;
+}
+
+/*****************************************************************************/
+
+static gboolean
+find_port (GError **error)
+{
+    g_autoptr(MMPortTraceReader) ports_reader = NULL;
+    MMPortTraceRecord            record;
+
+    ports_reader = mm_port_trace_reader_new (capture_str, error);
+    if (!ports_reader)
+        return FALSE;
+
+    while (mm_port_trace_reader_next (ports_reader, &record, error)) {
+        const gchar *name;
+
+        if (record.type != MM_PORT_TRACE_RECORD_TYPE_PORT)
+            continue;
+
+        name = mm_port_trace_reader_get_port_name (ports_reader, record.port_id);
+        g_print ("found port '%s' in capture\n", name);
+        if ((port_str && g_str_equal (port_str, name)) ||
+            (!port_str && record.port_type == MM_PORT_TRACE_PORT_TYPE_SERIAL)) {
+            port_id = record.port_id;
+            return TRUE;
+        }
+    }
+
+    if (error && *error)
+        return FALSE;
+
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "port not found in capture");
+    return FALSE;
+}
+
+static gboolean
+setup_socket_service (GError **error)
+{
+    g_autoptr(GSocket)        socket = NULL;
+    g_autoptr(GSocketAddress) address = NULL;
+
+    socket = g_socket_new (G_SOCKET_FAMILY_UNIX, G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_DEFAULT, error);
+    if (!socket)
+        return FALSE;
+
+    address = (g_unix_socket_address_new_with_type (
+                   socket_str,
+                   -1,
+                   (g_str_has_prefix (socket_str, "abstract:") ?
+                    G_UNIX_SOCKET_ADDRESS_ABSTRACT :
+                    G_UNIX_SOCKET_ADDRESS_PATH)));
+    if (!g_socket_bind (socket, address, TRUE, error) ||
+        !g_socket_listen (socket, error))
+        return FALSE;
+
+    service = g_socket_service_new ();
+    g_signal_connect (service, "incoming", G_CALLBACK (incoming_cb), NULL);
+    if (!g_socket_listener_add_socket (G_SOCKET_LISTENER (service), socket, NULL, error))
+        return FALSE;
+
+    g_socket_service_start (service);
+    return TRUE;
+}
+
+int main (int argc, char **argv)
+{
+    GOptionContext    *context;
+    g_autoptr(GError)  error = NULL;
+
+    setlocale (LC_ALL, "");
+
+    /* Setup option context, process it and destroy it */
+    context = g_option_context_new ("- ModemManager port traffic replay");
+    g_option_context_add_main_entries (context, main_entries, NULL);
+    g_option_context_parse (context, &argc, &argv, NULL);
+    g_option_context_free (context);
+
+    if (version_flag)
+        print_version_and_exit ();
+
+    if (!capture_str) {
+        g_printerr ("error: no capture file specified\n");
+        exit (EXIT_FAILURE);
+    }
+
+    if (!socket_str)
+        socket_str = g_strdup ("abstract:mmreplay");
+
+    if (!find_port (&error)) {
+        g_printerr ("error: %s\n", error->message);
+        exit (EXIT_FAILURE);
+    }
+
+    reader = mm_port_trace_reader_new (capture_str, &error);
+    if (!reader) {
+        g_printerr ("error: %s\n", error->message);
+        exit (EXIT_FAILURE);
+    }
+
+    if (!setup_socket_service (&error)) {
+        g_printerr ("error: couldn't listen in socket: %s\n", error->message);
+        exit (EXIT_FAILURE);
+    }
+
+    expected = g_byte_array_new ();
+    loop = g_main_loop_new (NULL, FALSE);
+
+    g_print ("waiting for client in '%s'...\n", socket_str);
+    g_main_loop_run (loop);
+
+    if (send_id)
+        g_source_remove (send_id);
+    g_socket_service_stop (service);
+    g_clear_object (&service);
+    g_clear_object (&connection);
+    g_byte_array_unref (expected);
+    if (pending_reply)
+        g_byte_array_unref (pending_reply);
+    mm_port_trace_reader_free (reader);
+    g_main_loop_unref (loop);
+
+    return (n_mismatches > 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -264,16 +264,11 @@ start_cb (void)
     return G_SOURCE_REMOVE;
 }
 
-void
-_mm_log (gpointer     obj,
-         const gchar *module,
-         const gchar *loc,
-         const gchar *func,
-         MMLogLevel   level,
-         const gchar *fmt,
-         ...)
+static void
+log_printv (MMLogLevel   level,
+            const gchar *fmt,
+            va_list      args)
 {
-    va_list           args;
     g_autofree gchar *msg = NULL;
     const gchar      *level_str = NULL;
 
@@ -300,12 +295,43 @@ _mm_log (gpointer     obj,
         break;
     }
 
-    va_start (args, fmt);
     msg = g_strdup_vprintf (fmt, args);
-    va_end (args);
     g_print ("[%s] %s\n", level_str ? level_str : "unknown", msg);
 }
 
+void
+_mm_log (gpointer     obj,
+         const gchar *module,
+         const gchar *loc,
+         const gchar *func,
+         MMLogLevel   level,
+         const gchar *fmt,
+         ...)
+{
+    va_list args;
+
+    va_start (args, fmt);
+    log_printv (level, fmt, args);
+    va_end (args);
+}
+
+/* No rate limiting, all port traffic is shown */
+void
+_mm_log_ratelimited (gpointer     obj,
+                     const gchar *module,
+                     const gchar *loc,
+                     const gchar *func,
+                     MMLogLevel   level,
+                     const gchar *fmt,
+                     ...)
+{
+    va_list args;
+
+    va_start (args, fmt);
+    log_printv (level, fmt, args);
+    va_end (args);
+}
+
 int main (int argc, char **argv)
 {
     GOptionContext *context;